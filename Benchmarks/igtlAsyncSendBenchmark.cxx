@@ -0,0 +1,210 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for asynchronous sending
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Sends a burst of packed TRANSFORM messages over a loopback connection, as
+// a tracker thread would, and compares:
+//   sync        Socket::Send() from the calling thread (one send() per message)
+//   async       ClientSocket::StartAsyncSend(): the messages are queued and
+//               coalesced into one sendmsg() per batch by the I/O thread
+// The receiver reads in large blocks; with a <pause (ms)> argument it stops
+// reading for that time after every 1000 messages, like a slow viewer.
+// Reported per mode:
+//   rate        messages per second from the first Send() until received
+//   stall       longest time a Send() call took (the tracker thread stall)
+//   calls       system calls used to send (async: from the statistics)
+//   latency     mean time between queueing and sending (async only)
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+
+#include "igtlClientSocket.h"
+#include "igtlServerSocket.h"
+#include "igtlMultiThreader.h"
+#include "igtlOSUtil.h"
+#include "igtlTransformMessage.h"
+#include "igtlTimeStamp.h"
+
+
+struct ReceiverData
+{
+  igtl::ClientSocket* Socket;
+  igtlUint64          BytesToReceive;
+  igtlUint64          BytesReceived;
+  int                 PauseBytes;
+  int                 Pause;
+};
+
+// Stands in for the application; keeps the compiler from dropping the loops.
+static igtlUint64 Checksum = 0;
+
+
+void* Receiver(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ReceiverData* data = static_cast<ReceiverData*>(info->UserData);
+  std::vector<unsigned char> buffer(64 * 1024);
+  igtlUint64 sincePause = 0;
+  while (data->BytesReceived < data->BytesToReceive)
+    {
+    igtlUint64 remaining = data->BytesToReceive - data->BytesReceived;
+    int length = remaining < buffer.size() ? (int)remaining : (int)buffer.size();
+    int r = data->Socket->Receive(&buffer[0], length, 0);
+    if (r <= 0)
+      {
+      break;
+      }
+    Checksum += buffer[0];
+    data->BytesReceived += r;
+    sincePause += r;
+    if (data->Pause > 0 && sincePause >= (igtlUint64)data->PauseBytes)
+      {
+      igtl::Sleep(data->Pause);
+      sincePause = 0;
+      }
+    }
+  return NULL;
+}
+
+
+void Run(bool async, int numberOfMessages, int pause)
+{
+  igtl::ServerSocket::Pointer server = igtl::ServerSocket::New();
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  if (server->CreateServer(0) != 0 ||
+      client->ConnectToServer("localhost", server->GetServerPort()) != 0)
+    {
+    std::cerr << "Failed to connect." << std::endl;
+    exit(1);
+    }
+  igtl::ClientSocket::Pointer peer = server->WaitForConnection(1000);
+  if (peer.IsNull())
+    {
+    std::cerr << "Failed to accept the connection." << std::endl;
+    exit(1);
+    }
+
+  // Pre-packed messages with different device names.
+  const int numberOfTools = 8;
+  std::vector<igtl::TransformMessage::Pointer> messages;
+  for (int i = 0; i < numberOfTools; i ++)
+    {
+    igtl::TransformMessage::Pointer msg = igtl::TransformMessage::New();
+    char name[16];
+    sprintf(name, "Tool%d", i);
+    msg->SetDeviceName(name);
+    msg->Pack();
+    messages.push_back(msg);
+    }
+  int messageSize = messages[0]->GetPackSize();
+
+  ReceiverData data;
+  data.Socket = peer;
+  data.BytesToReceive = (igtlUint64)numberOfMessages * messageSize;
+  data.BytesReceived = 0;
+  data.PauseBytes = 1000 * messageSize;
+  data.Pause = pause;
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int id = threader->SpawnThread((igtl::ThreadFunctionType) &Receiver, &data);
+
+  if (async)
+    {
+    client->StartAsyncSend(256, igtl::AsyncSendQueue::Block);
+    }
+
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  ts->GetTime();
+  double start = ts->GetTimeStamp();
+  double maxStall = 0.0;
+  for (int i = 0; i < numberOfMessages; i ++)
+    {
+    igtl::TransformMessage* msg = messages[i % numberOfTools];
+    ts->GetTime();
+    double before = ts->GetTimeStamp();
+    client->Send(msg->GetPackPointer(), messageSize);
+    ts->GetTime();
+    if (ts->GetTimeStamp() - before > maxStall)
+      {
+      maxStall = ts->GetTimeStamp() - before;
+      }
+    }
+
+  igtl::AsyncSendStatistics statistics;
+  if (async)
+    {
+    client->FlushAsyncSend();
+    client->GetAsyncSendStatistics(&statistics);
+    }
+  threader->TerminateThread(id);
+  ts->GetTime();
+  double elapsed = ts->GetTimeStamp() - start;
+
+  std::cout << std::setw(8) << (async ? "async" : "sync")
+            << std::setw(12) << std::fixed << std::setprecision(1)
+            << numberOfMessages / elapsed / 1e3
+            << std::setw(12) << maxStall * 1e6;
+  if (async)
+    {
+    std::cout << std::setw(12) << statistics.SendCalls
+              << std::setw(12) << (double)statistics.TotalLatency / statistics.SentMessages / 1e3;
+    }
+  else
+    {
+    std::cout << std::setw(12) << numberOfMessages
+              << std::setw(12) << "-";
+    }
+  std::cout << std::endl;
+
+  if (data.BytesReceived != data.BytesToReceive)
+    {
+    std::cerr << "Received " << data.BytesReceived << " of " << data.BytesToReceive << " bytes." << std::endl;
+    }
+  client->CloseSocket();
+  peer->CloseSocket();
+  server->CloseSocket();
+}
+
+
+int main(int argc, char* argv[])
+{
+  int numberOfMessages = 200000;
+  int pause = 0;
+
+  if (argc > 1)
+    {
+    numberOfMessages = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+    pause = atoi(argv[2]);
+    }
+  if (argc > 3 || numberOfMessages <= 0 || pause < 0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<messages> [<pause (ms)>]]" << std::endl;
+    exit(0);
+    }
+
+  std::cout << std::setw(8) << "mode"
+            << std::setw(12) << "k msgs/s"
+            << std::setw(12) << "stall (us)"
+            << std::setw(12) << "calls"
+            << std::setw(12) << "lat. (us)" << std::endl;
+  Run(false, numberOfMessages, pause);
+  Run(true, numberOfMessages, pause);
+
+  // Printed so that the loops cannot be optimized away.
+  std::cerr << "checksum: " << Checksum << std::endl;
+  return 0;
+}
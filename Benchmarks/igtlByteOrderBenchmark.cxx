@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for byte order conversion
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures igtl_convert_byte_order_copy() (out of place) and
+// igtl_convert_byte_order() (in place) for each element width and each
+// implementation supported by the CPU. The in-place numbers correspond to
+// the message-specific convert_byte_order() functions; the out-of-place
+// numbers to the pack/unpack routines of NDARRAY and POLYDATA.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "igtl_util.h"
+#include "igtlTimeStamp.h"
+
+
+// Converts 'size' bytes repeatedly for at least 'minTime' seconds and returns
+// the throughput in GB/s.
+double MeasureThroughput(unsigned char* dst, const unsigned char* src, igtl_uint64 size,
+                         int elementSize, double minTime)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  igtl_uint64 iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (igtl_uint64 i = 0; i < iterations; i ++)
+      {
+      if (dst == src)
+        {
+        igtl_convert_byte_order(dst, size / elementSize, elementSize);
+        }
+      else
+        {
+        igtl_convert_byte_order_copy(dst, src, size / elementSize, elementSize);
+        }
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)(size * iterations) / elapsed / 1e9;
+}
+
+
+int main(int argc, char* argv[])
+{
+  igtl_uint64 maxSize = 64 * 1024 * 1024;
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    maxSize = (igtl_uint64) atol(argv[1]);
+    }
+  if (argc > 2)
+    {
+    minTime = atof(argv[2]);
+    }
+  if (argc > 3 || maxSize < 64)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<max size (bytes)> [<min time per run (s)>]]" << std::endl;
+    exit(0);
+    }
+
+  // Keep the implementations that the CPU supports.
+  const char* names[] = {"", "scalar", "ssse3", "avx2"};
+  std::vector<int> implementations;
+  for (int impl = IGTL_BYTE_ORDER_IMPL_SCALAR; impl <= IGTL_BYTE_ORDER_IMPL_AVX2; impl ++)
+    {
+    if (igtl_convert_byte_order_set_implementation(impl) == impl)
+      {
+      implementations.push_back(impl);
+      }
+    }
+
+  std::vector<unsigned char> src((size_t)maxSize);
+  std::vector<unsigned char> dst((size_t)maxSize);
+  for (size_t i = 0; i < src.size(); i ++)
+    {
+    src[i] = (unsigned char) (rand() & 0xFF);
+    }
+
+  std::cout << std::setw(12) << "bytes"
+            << std::setw(6) << "width"
+            << std::setw(10) << "mode";
+  for (size_t j = 0; j < implementations.size(); j ++)
+    {
+    std::cout << std::setw(10) << names[implementations[j]];
+    }
+  std::cout << "   (GB/s)" << std::endl;
+
+  for (igtl_uint64 size = 64; size <= maxSize; size *= 16)
+    {
+    for (int elementSize = 2; elementSize <= 8; elementSize *= 2)
+      {
+      for (int inPlace = 0; inPlace < 2; inPlace ++)
+        {
+        std::cout << std::setw(12) << size
+                  << std::setw(6) << elementSize * 8
+                  << std::setw(10) << (inPlace ? "in-place" : "copy");
+        for (size_t j = 0; j < implementations.size(); j ++)
+          {
+          igtl_convert_byte_order_set_implementation(implementations[j]);
+          const unsigned char* in = inPlace ? &dst[0] : &src[0];
+          double gbps = MeasureThroughput(&dst[0], in, size, elementSize, minTime);
+          std::cout << std::setw(10) << std::fixed << std::setprecision(2) << gbps;
+          }
+        std::cout << std::endl;
+        }
+      }
+    }
+
+  igtl_convert_byte_order_set_implementation(IGTL_BYTE_ORDER_IMPL_AUTO);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for CRC-64 implementations
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "igtl_util.h"
+#include "igtlTimeStamp.h"
+
+
+typedef igtl_uint64 (*CRC64Function)(const unsigned char*, igtl_uint64, igtl_uint64);
+
+struct CRC64Variant
+{
+  const char*   name;
+  CRC64Function function;
+};
+
+
+// Runs 'function' over 'size' bytes repeatedly for at least 'minTime' seconds
+// and returns the throughput in MB/s.
+double MeasureThroughput(CRC64Function function, const unsigned char* data,
+                         igtl_uint64 size, double minTime, igtl_uint64& crc)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  igtl_uint64 iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (igtl_uint64 i = 0; i < iterations; i ++)
+      {
+      crc = function(data, size, crc);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)(size * iterations) / elapsed / (1024.0 * 1024.0);
+}
+
+
+int main(int argc, char* argv[])
+{
+  igtl_uint64 maxSize = 64 * 1024 * 1024;
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    maxSize = (igtl_uint64) atol(argv[1]);
+    }
+  if (argc > 2)
+    {
+    minTime = atof(argv[2]);
+    }
+  if (argc > 3 || maxSize == 0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<max body size (bytes)> [<min time per run (s)>]]" << std::endl;
+    exit(0);
+    }
+
+  std::vector<CRC64Variant> variants;
+  CRC64Variant v;
+  v.name = "bytewise"; v.function = igtl_crc64_bytewise; variants.push_back(v);
+  v.name = "slice8";   v.function = igtl_crc64_slice8;   variants.push_back(v);
+  v.name = "slice16";  v.function = igtl_crc64_slice16;  variants.push_back(v);
+  if (igtl_crc64_clmul_supported())
+    {
+    v.name = "clmul";  v.function = igtl_crc64_clmul;    variants.push_back(v);
+    }
+
+  std::vector<unsigned char> buffer((size_t)maxSize);
+  for (size_t i = 0; i < buffer.size(); i ++)
+    {
+    buffer[i] = (unsigned char) (rand() & 0xFF);
+    }
+
+  std::cout << "crc64() uses implementation " << igtl_crc64_get_implementation()
+            << " (clmul supported: " << igtl_crc64_clmul_supported() << ")" << std::endl;
+  std::cout << std::setw(12) << "bytes";
+  for (size_t j = 0; j < variants.size(); j ++)
+    {
+    std::cout << std::setw(14) << variants[j].name;
+    }
+  std::cout << "   (MB/s)" << std::endl;
+
+  for (igtl_uint64 size = 64; size <= maxSize; size *= 4)
+    {
+    std::cout << std::setw(12) << size;
+    igtl_uint64 reference = igtl_crc64_bytewise(&buffer[0], size, 0);
+    for (size_t j = 0; j < variants.size(); j ++)
+      {
+      if (variants[j].function(&buffer[0], size, 0) != reference)
+        {
+        std::cerr << std::endl << "CRC mismatch for " << variants[j].name << std::endl;
+        return 1;
+        }
+      igtl_uint64 crc = 0;
+      double mbps = MeasureThroughput(variants[j].function, &buffer[0], size, minTime, crc);
+      std::cout << std::setw(14) << std::fixed << std::setprecision(1) << mbps;
+      }
+    std::cout << std::endl;
+    }
+
+  return 0;
+}
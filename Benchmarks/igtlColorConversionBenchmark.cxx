@@ -0,0 +1,145 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for color conversion kernels
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the RGB -> I420, I420 -> RGB and I420 -> gray RGB conversions
+// used by the video codecs, for each implementation supported by the CPU
+// and for 1 to <max threads> threads, across common frame sizes.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "igtlColorConversion.h"
+#include "igtlTimeStamp.h"
+
+
+typedef void (*ConversionFunction)(const igtlUint8*, igtlUint8*, int, int);
+
+struct Resolution
+{
+  const char* name;
+  int         width;
+  int         height;
+};
+
+
+// Runs 'function' repeatedly for at least 'minTime' seconds and returns the
+// time per frame in milliseconds.
+double MeasureFrameTime(ConversionFunction function, const igtlUint8* source, igtlUint8* destination,
+                        int width, int height, double minTime)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  long iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (long i = 0; i < iterations; i ++)
+      {
+      function(source, destination, width, height);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return elapsed * 1000.0 / (double)iterations;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int maxThreads = 4;
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    maxThreads = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+    minTime = atof(argv[2]);
+    }
+  if (argc > 3 || maxThreads < 1)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<max threads> [<min time per run (s)>]]" << std::endl;
+    exit(0);
+    }
+
+  const Resolution resolutions[] = {
+    {"VGA",   640,  480},
+    {"720p",  1280, 720},
+    {"1080p", 1920, 1080},
+    {"2160p", 3840, 2160}
+  };
+  const int numberOfResolutions = sizeof(resolutions) / sizeof(resolutions[0]);
+
+  // Keep the implementations that the CPU supports.
+  const char* names[] = {"", "scalar", "ssse3", "avx2"};
+  std::vector<int> implementations;
+  for (int impl = igtl::COLOR_CONVERSION_SCALAR; impl <= igtl::COLOR_CONVERSION_AVX2; impl ++)
+    {
+    if (igtl::SetColorConversionImplementation(impl) == impl)
+      {
+      implementations.push_back(impl);
+      }
+    }
+
+  const int maxPixels = 3840 * 2160;
+  std::vector<igtlUint8> rgb(maxPixels * 3);
+  std::vector<igtlUint8> i420(maxPixels * 3 / 2);
+  for (size_t i = 0; i < rgb.size(); i ++)
+    {
+    rgb[i] = (igtlUint8) (rand() & 0xFF);
+    }
+  igtl::ConvertRGBToI420(&rgb[0], &i420[0], 3840, 2160);
+
+  std::cout << std::setw(8) << "frame"
+            << std::setw(8) << "impl"
+            << std::setw(8) << "threads"
+            << std::setw(12) << "RGB->I420"
+            << std::setw(12) << "I420->RGB"
+            << std::setw(12) << "I420->gray"
+            << "   (ms per frame)" << std::endl;
+  for (int r = 0; r < numberOfResolutions; r ++)
+    {
+    for (size_t j = 0; j < implementations.size(); j ++)
+      {
+      igtl::SetColorConversionImplementation(implementations[j]);
+      for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+        igtl::SetColorConversionNumberOfThreads(threads);
+        const int w = resolutions[r].width;
+        const int h = resolutions[r].height;
+        double toI420 = MeasureFrameTime(igtl::ConvertRGBToI420, &rgb[0], &i420[0], w, h, minTime);
+        double toRGB  = MeasureFrameTime(igtl::ConvertI420ToRGB, &i420[0], &rgb[0], w, h, minTime);
+        double toGray = MeasureFrameTime(igtl::ConvertI420ToGrayRGB, &i420[0], &rgb[0], w, h, minTime);
+        std::cout << std::setw(8) << resolutions[r].name
+                  << std::setw(8) << names[implementations[j]]
+                  << std::setw(8) << threads
+                  << std::setw(12) << std::fixed << std::setprecision(3) << toI420
+                  << std::setw(12) << std::fixed << std::setprecision(3) << toRGB
+                  << std::setw(12) << std::fixed << std::setprecision(3) << toGray << std::endl;
+        }
+      }
+    }
+
+  return 0;
+}
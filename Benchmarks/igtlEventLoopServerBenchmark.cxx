@@ -0,0 +1,220 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Load test for the event loop server
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Connects N clients to an igtl::EventLoopServer running in a separate thread.
+// In each round, every client sends a TRANSFORM message and waits for the
+// server to echo it back. The round-trip latency of each message is measured
+// from its send to the arrival of the echo.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "igtlEventLoopServer.h"
+#include "igtlClientSocket.h"
+#include "igtlMessageHandler.h"
+#include "igtlMultiThreader.h"
+#include "igtlTransformMessage.h"
+#include "igtlTimeStamp.h"
+
+
+// Sends each received TRANSFORM message back to its sender unchanged.
+class EchoHandler : public igtl::MessageHandler
+{
+public:
+  igtlTypeMacro(EchoHandler, igtl::MessageHandler);
+  igtlNewMacro(EchoHandler);
+
+  virtual const char* GetMessageType() { return "TRANSFORM"; }
+#if OpenIGTLink_HEADER_VERSION >= 2
+  virtual std::string GetMessageType() const { return std::string("TRANSFORM"); }
+#endif
+  virtual igtl::MessageBase::Pointer CreateMessage()
+  {
+    igtl::TransformMessage::Pointer message = igtl::TransformMessage::New();
+    return igtl::MessageBase::Pointer(message.GetPointer());
+  }
+  virtual int ProcessReceivedMessage(igtl::Socket* socket, igtl::MessageBase* message)
+  {
+    return socket->Send(message->GetBufferPointer(), message->GetBufferSize());
+  }
+
+protected:
+  EchoHandler() {}
+  ~EchoHandler() {}
+};
+
+
+struct ServerThreadData
+{
+  igtl::EventLoopServer* server;
+  volatile int stop;
+};
+
+
+void* ServerThread(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ServerThreadData* data = static_cast<ServerThreadData*>(info->UserData);
+  while (!data->stop)
+    {
+    data->server->ProcessEvents(10);
+    }
+  return NULL;
+}
+
+
+double Percentile(std::vector<double>& values, double p)
+{
+  size_t i = (size_t)(p * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + i, values.end());
+  return values[i];
+}
+
+
+// Runs rounds over 'numberOfClients' connections for at least 'minTime' seconds.
+// Returns 0 on success.
+int RunLoad(int port, int numberOfClients, double minTime)
+{
+  std::vector<igtl::ClientSocket::Pointer> clients(numberOfClients);
+  for (int i = 0; i < numberOfClients; i ++)
+    {
+    clients[i] = igtl::ClientSocket::New();
+    if (clients[i]->ConnectToServer("localhost", port) != 0)
+      {
+      std::cerr << "Failed to connect client " << i << std::endl;
+      return 1;
+      }
+    }
+
+  igtl::TransformMessage::Pointer message = igtl::TransformMessage::New();
+  message->SetDeviceName("Tracker");
+  message->Pack();
+  int size = message->GetPackSize();
+  std::vector<char> reply(size);
+
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  std::vector<double> sendTime(numberOfClients);
+  std::vector<double> latencies;
+
+  ts->GetTime();
+  double start = ts->GetTimeStamp();
+  double elapsed = 0.0;
+  int rounds = 0;
+  while (elapsed < minTime || rounds < 3)
+    {
+    for (int i = 0; i < numberOfClients; i ++)
+      {
+      ts->GetTime();
+      sendTime[i] = ts->GetTimeStamp();
+      clients[i]->Send(message->GetPackPointer(), size);
+      }
+    for (int i = 0; i < numberOfClients; i ++)
+      {
+      if (clients[i]->Receive(&reply[0], size) != size)
+        {
+        std::cerr << "Failed to receive the reply for client " << i << std::endl;
+        return 1;
+        }
+      ts->GetTime();
+      latencies.push_back(ts->GetTimeStamp() - sendTime[i]);
+      }
+    rounds ++;
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    }
+
+  double sum = 0.0;
+  for (size_t i = 0; i < latencies.size(); i ++)
+    {
+    sum += latencies[i];
+    }
+  double mean = sum / latencies.size();
+  double p50 = Percentile(latencies, 0.50);
+  double p99 = Percentile(latencies, 0.99);
+  double maximum = *std::max_element(latencies.begin(), latencies.end());
+
+  std::cout << std::setw(12) << numberOfClients
+            << std::setw(10) << rounds
+            << std::setw(14) << std::fixed << std::setprecision(0) << latencies.size() / elapsed
+            << std::setw(12) << std::setprecision(1) << mean * 1e6
+            << std::setw(12) << p50 * 1e6
+            << std::setw(12) << p99 * 1e6
+            << std::setw(12) << maximum * 1e6 << std::endl;
+
+  for (int i = 0; i < numberOfClients; i ++)
+    {
+    clients[i]->CloseSocket();
+    }
+  return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int maxClients = 1000;
+  double minTime = 1.0;
+
+  if (argc > 1)
+    {
+    maxClients = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+    minTime = atof(argv[2]);
+    }
+  if (argc > 3 || maxClients < 1)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<max clients> [<min time per run (s)>]]" << std::endl;
+    exit(0);
+    }
+
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  EchoHandler::Pointer handler = EchoHandler::New();
+  server->AddMessageHandler(handler);
+  if (server->CreateServer(0) < 0)
+    {
+    std::cerr << "Failed to create the server" << std::endl;
+    return 1;
+    }
+  int port = server->GetServerPort();
+
+  ServerThreadData data;
+  data.server = server;
+  data.stop = 0;
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int threadID = threader->SpawnThread((igtl::ThreadFunctionType) &ServerThread, &data);
+
+  std::cout << std::setw(12) << "connections"
+            << std::setw(10) << "rounds"
+            << std::setw(14) << "msgs/s"
+            << std::setw(12) << "mean"
+            << std::setw(12) << "p50"
+            << std::setw(12) << "p99"
+            << std::setw(12) << "max"
+            << "   (latency in us)" << std::endl;
+
+  int r = 0;
+  for (int n = 10; n <= maxClients && r == 0; n *= 10)
+    {
+    r = RunLoad(port, n, minTime);
+    }
+
+  data.stop = 1;
+  threader->TerminateThread(threadID);
+  server->CloseServer();
+
+  return r;
+}
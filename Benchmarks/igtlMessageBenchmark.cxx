@@ -0,0 +1,532 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for message packing and unpacking
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the time per message and the throughput of each message class
+// (VIDEO if the library is built with video streaming) for three payload
+// sizes, with a version 1 header and with a version 2 header carrying 0 and
+// 8 meta data elements:
+//   pack        Pack() of a message whose content is set, including the CRC
+//   unpack      MessageFactory::CreateReceiveMessage(), copying the received
+//               body into the message (as Socket::Receive() would) and
+//               Unpack() without the CRC check
+//   unpack+crc  the same with the CRC check
+// The difference between the last two is the cost of the CRC; the byte order
+// conversion is part of both.
+//
+// With --csv, one line per measurement is printed in the format
+//   type,header_version,metadata,bytes,operation,ns_per_message,gb_per_s
+// where 'bytes' is the size of the packed message, so that the results of
+// different releases can be compared with a script.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "igtlConfigure.h"
+#include "igtlMessageFactory.h"
+#include "igtlTransformMessage.h"
+#include "igtlImageMessage.h"
+#include "igtlTimeStamp.h"
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+#include "igtlStringMessage.h"
+#include "igtlTrackingDataMessage.h"
+#include "igtlQuaternionTrackingDataMessage.h"
+#include "igtlPointMessage.h"
+#include "igtlNDArrayMessage.h"
+#include "igtlPolyDataMessage.h"
+#include "igtlBindMessage.h"
+#endif
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+#include "igtlVideoMessage.h"
+#endif
+
+
+static const char* Keys[] = {"PatientID", "Operator", "Sequence", "Timestamp",
+                             "Status", "Quality", "Reference", "Calibration"};
+
+static const char* Values[] = {"PT-000123", "jdoe", "Needle insertion", "1514764800.000",
+                               "OK", "0.98", "Patient reference", "2018-01-01"};
+
+static const int NumberOfMetaDataElements = 8;
+
+enum Mode {
+  Pack,
+  Unpack,
+  UnpackAndCheckCRC
+};
+
+static const char* ModeNames[] = {"pack", "unpack", "unpack+crc"};
+
+// Stands in for the application; keeps the compiler from dropping the loops.
+static igtlUint64 Checksum = 0;
+
+// Sets the content of a message of the class; see MessageType.
+typedef void (*SetContentFunction)(igtl::MessageBase* msg, int size);
+
+// A message class and the payload sizes it is measured with. The meaning of
+// the size depends on the class (number of elements, pixels, bytes, ...).
+struct MessageType
+{
+  const char*        Name;
+  SetContentFunction SetContent;
+  int                Sizes[3];
+};
+
+
+void SetTransformContent(igtl::MessageBase* base, int)
+{
+  igtl::TransformMessage* msg = static_cast<igtl::TransformMessage*>(base);
+  igtl::Matrix4x4 matrix;
+  igtl::IdentityMatrix(matrix);
+  matrix[0][3] = 10.0f;
+  msg->SetMatrix(matrix);
+}
+
+
+// 'size' is the width and height of an 8-bit image.
+void SetImageContent(igtl::MessageBase* base, int size)
+{
+  igtl::ImageMessage* msg = static_cast<igtl::ImageMessage*>(base);
+  msg->SetDimensions(size, size, 1);
+  msg->SetScalarType(igtl::ImageMessage::TYPE_UINT8);
+  msg->AllocateScalars();
+  memset(msg->GetScalarPointer(), 0x5A, msg->GetImageSize());
+}
+
+
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+// 'size' is the number of characters.
+void SetStringContent(igtl::MessageBase* base, int size)
+{
+  igtl::StringMessage* msg = static_cast<igtl::StringMessage*>(base);
+  msg->SetString(std::string(size, 'x'));
+}
+
+
+// 'size' is the number of tracking elements.
+void SetTrackingDataContent(igtl::MessageBase* base, int size)
+{
+  igtl::TrackingDataMessage* msg = static_cast<igtl::TrackingDataMessage*>(base);
+  for (int i = 0; i < size; i ++)
+    {
+    igtl::TrackingDataElement::Pointer element = igtl::TrackingDataElement::New();
+    char name[16];
+    sprintf(name, "Tool%d", i);
+    element->SetName(name);
+    element->SetType(igtl::TrackingDataElement::TYPE_6D);
+    element->SetPosition(i, 2.0 * i, 3.0 * i);
+    msg->AddTrackingDataElement(element);
+    }
+}
+
+
+// 'size' is the number of tracking elements.
+void SetQuaternionTrackingDataContent(igtl::MessageBase* base, int size)
+{
+  igtl::QuaternionTrackingDataMessage* msg = static_cast<igtl::QuaternionTrackingDataMessage*>(base);
+  for (int i = 0; i < size; i ++)
+    {
+    igtl::QuaternionTrackingDataElement::Pointer element = igtl::QuaternionTrackingDataElement::New();
+    char name[16];
+    sprintf(name, "Tool%d", i);
+    element->SetName(name);
+    element->SetType(igtl::QuaternionTrackingDataElement::TYPE_6D);
+    element->SetPosition(i, 2.0f * i, 3.0f * i);
+    element->SetQuaternion(0.0f, 0.0f, 0.0f, 1.0f);
+    msg->AddQuaternionTrackingDataElement(element);
+    }
+}
+
+
+// 'size' is the number of points.
+void SetPointContent(igtl::MessageBase* base, int size)
+{
+  igtl::PointMessage* msg = static_cast<igtl::PointMessage*>(base);
+  for (int i = 0; i < size; i ++)
+    {
+    igtl::PointElement::Pointer element = igtl::PointElement::New();
+    char name[16];
+    sprintf(name, "Point%d", i);
+    element->SetName(name);
+    element->SetGroupName("Fiducial");
+    element->SetRGBA(255, 0, 0, 255);
+    element->SetPosition(i, 2.0f * i, 3.0f * i);
+    element->SetRadius(1.5f);
+    element->SetOwner("Image");
+    msg->AddPointElement(element);
+    }
+}
+
+
+// The NDARRAY message refers to the array without owning it; the messages
+// are measured one after the other, so one array is enough.
+static igtl::Array<igtlFloat32> NDArrayData;
+
+// 'size' is the number of rows and columns of a 32-bit float array.
+void SetNDArrayContent(igtl::MessageBase* base, int size)
+{
+  igtl::NDArrayMessage* msg = static_cast<igtl::NDArrayMessage*>(base);
+  std::vector<igtlUint16> dimensions(2, (igtlUint16)size);
+  NDArrayData.SetSize(dimensions);
+  igtlFloat32* data = (igtlFloat32*)NDArrayData.GetRawArray();
+  for (int i = 0; i < size * size; i ++)
+    {
+    data[i] = (igtlFloat32)i;
+    }
+  msg->SetArray(igtl::NDArrayMessage::TYPE_FLOAT32, &NDArrayData);
+}
+
+
+// 'size' is the number of points, each with a scalar attribute; the points
+// form a strip of size - 2 triangles.
+void SetPolyDataContent(igtl::MessageBase* base, int size)
+{
+  igtl::PolyDataMessage* msg = static_cast<igtl::PolyDataMessage*>(base);
+  std::vector<igtlFloat32> coordinates(3 * size);
+  std::vector<igtlFloat32> scalars(size);
+  for (int i = 0; i < size; i ++)
+    {
+    coordinates[3 * i]     = (igtlFloat32)(i / 2);
+    coordinates[3 * i + 1] = (igtlFloat32)(i % 2);
+    coordinates[3 * i + 2] = 0.0f;
+    scalars[i] = (igtlFloat32)i;
+    }
+  int numberOfTriangles = size - 2;
+  std::vector<igtlUint32> offsets(numberOfTriangles + 1);
+  std::vector<igtlUint32> connectivity(3 * numberOfTriangles);
+  for (int i = 0; i < numberOfTriangles; i ++)
+    {
+    offsets[i] = 3 * i;
+    connectivity[3 * i]     = i;
+    connectivity[3 * i + 1] = i + 1;
+    connectivity[3 * i + 2] = i + 2;
+    }
+  offsets[numberOfTriangles] = 3 * numberOfTriangles;
+
+  igtl::PolyDataPointArray::Pointer points = igtl::PolyDataPointArray::New();
+  points->SetPoints(size, &coordinates[0]);
+  igtl::PolyDataCellArray::Pointer polygons = igtl::PolyDataCellArray::New();
+  polygons->SetCells(numberOfTriangles, &offsets[0], &connectivity[0]);
+  igtl::PolyDataAttribute::Pointer attribute = igtl::PolyDataAttribute::New();
+  attribute->SetType(igtl::PolyDataAttribute::POINT_SCALAR);
+  attribute->SetSize(size);
+  attribute->SetName("Scalars");
+  attribute->SetData(&scalars[0]);
+
+  msg->SetPoints(points);
+  msg->SetPolygons(polygons);
+  msg->AddAttribute(attribute);
+}
+
+
+// The BIND message refers to the bodies of the child messages as well.
+static std::vector<igtl::MessageBase::Pointer> BindChildren;
+
+// 'size' is the number of child TRANSFORM messages.
+void SetBindContent(igtl::MessageBase* base, int size)
+{
+  igtl::BindMessage* msg = static_cast<igtl::BindMessage*>(base);
+  msg->Init();
+  BindChildren.clear();
+  for (int i = 0; i < size; i ++)
+    {
+    igtl::TransformMessage::Pointer child = igtl::TransformMessage::New();
+    SetTransformContent(child, 0);
+    char name[32];
+    sprintf(name, "Transform%d", i);
+    child->SetDeviceName(name);
+    child->Pack();
+    msg->AppendChildMessage(child);
+    BindChildren.push_back(child.GetPointer());
+    }
+}
+#endif // OpenIGTLink_PROTOCOL_VERSION >= 2
+
+
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+// 'size' is the size of the bit stream in bytes.
+void SetVideoContent(igtl::MessageBase* base, int size)
+{
+  igtl::VideoMessage* msg = static_cast<igtl::VideoMessage*>(base);
+  msg->SetBitStreamSize(size);
+  msg->AllocateScalars();
+  msg->SetWidth(640);
+  msg->SetHeight(480);
+  unsigned char* p = msg->GetPackFragmentPointer(2);
+  for (int i = 0; i < size; i ++)
+    {
+    p[i] = (unsigned char)i;
+    }
+}
+#endif
+
+
+static const MessageType MessageTypes[] = {
+  {"TRANSFORM", SetTransformContent,              {1, 1, 1}},
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+  {"TDATA",     SetTrackingDataContent,           {1, 16, 256}},
+  {"QTDATA",    SetQuaternionTrackingDataContent, {1, 16, 256}},
+  {"POINT",     SetPointContent,                  {1, 16, 256}},
+#endif
+  {"IMAGE",     SetImageContent,                  {64, 512, 2048}},
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+  {"NDARRAY",   SetNDArrayContent,                {16, 256, 1024}},
+  {"POLYDATA",  SetPolyDataContent,               {256, 16384, 262144}},
+#endif
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  {"VIDEO",     SetVideoContent,                  {4096, 262144, 4194304}},
+#endif
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+  {"BIND",      SetBindContent,                   {1, 16, 256}},
+  {"STRING",    SetStringContent,                 {16, 1024, 65535}},
+#endif
+};
+
+static const int NumberOfMessageTypes = sizeof(MessageTypes) / sizeof(MessageTypes[0]);
+
+
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+// Factory functions for the message types that the default factory does not create.
+igtl::MessageBase::Pointer NewNDArrayMessage()
+{
+  igtl::NDArrayMessage::Pointer msg = igtl::NDArrayMessage::New();
+  return igtl::MessageBase::Pointer(msg.GetPointer());
+}
+
+
+igtl::MessageBase::Pointer NewBindMessage()
+{
+  igtl::BindMessage::Pointer msg = igtl::BindMessage::New();
+  return igtl::MessageBase::Pointer(msg.GetPointer());
+}
+#endif
+
+
+// Creates and packs a message with the given header version and number of
+// meta data elements. The header is set before the content, as classes such
+// as ImageMessage allocate the buffer for the content.
+igtl::MessageBase::Pointer CreateMessage(igtl::MessageFactory* factory, const MessageType& type,
+                                         int size, int headerVersion, int numberOfMetaDataElements)
+{
+  igtl::MessageBase::Pointer msg = factory->CreateSendMessage(type.Name, headerVersion);
+#if OpenIGTLink_HEADER_VERSION >= 2
+  for (int i = 0; i < numberOfMetaDataElements; i ++)
+    {
+    msg->SetMetaDataElement(Keys[i], IANA_TYPE_US_ASCII, Values[i]);
+    }
+#else
+  (void)numberOfMetaDataElements;
+#endif
+  msg->SetDeviceName("Device");
+  type.SetContent(msg, size);
+  msg->Pack();
+  return msg;
+}
+
+
+// Receives the packed message 'msg' and returns the result of Unpack().
+int ReceiveMessage(igtl::MessageFactory* factory, igtl::MessageHeader::Pointer& header,
+                   igtl::MessageBase* msg, int mode)
+{
+  igtl::MessageBase::Pointer received = factory->CreateReceiveMessage(header);
+  if (received.IsNull())
+    {
+    return 0;
+    }
+  memcpy(received->GetBufferBodyPointer(), msg->GetBufferBodyPointer(), msg->GetBufferBodySize());
+  int r = received->Unpack(mode == UnpackAndCheckCRC);
+  Checksum += received->GetBufferBodySize();
+  return r;
+}
+
+
+// Runs 'mode' repeatedly for at least 'minTime' seconds and returns the
+// time per message in nanoseconds.
+double MeasureTime(igtl::MessageFactory* factory, igtl::MessageBase* msg, int mode, double minTime)
+{
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitBuffer();
+  memcpy(header->GetBufferPointer(), msg->GetBufferPointer(), IGTL_HEADER_SIZE);
+  header->Unpack();
+
+  igtlUint64 iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    igtlUint64 start = igtl::TimeStamp::GetMonotonicTimeInNanoseconds();
+    for (igtlUint64 i = 0; i < iterations; i ++)
+      {
+      if (mode == Pack)
+        {
+        // Setting the device name makes Pack() pack the message again.
+        msg->SetDeviceName("Device");
+        msg->Pack();
+        Checksum += msg->GetBufferSize();
+        }
+      else
+        {
+        ReceiveMessage(factory, header, msg, mode);
+        }
+      }
+    elapsed = (double)(igtl::TimeStamp::GetMonotonicTimeInNanoseconds() - start);
+    if (elapsed >= minTime * 1e9)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return elapsed / (double)iterations;
+}
+
+
+int main(int argc, char* argv[])
+{
+  bool csv = false;
+  double minTime = 0.1;
+  const char* typeName = NULL;
+
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "--csv") == 0)
+    {
+    csv = true;
+    arg ++;
+    }
+  if (arg < argc)
+    {
+    minTime = atof(argv[arg ++]);
+    }
+  if (arg < argc)
+    {
+    typeName = argv[arg ++];
+    }
+  if (arg < argc || minTime <= 0.0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [--csv] [<min time per run (s)> [<message type>]]" << std::endl;
+    exit(0);
+    }
+  if (typeName)
+    {
+    int t = 0;
+    while (t < NumberOfMessageTypes && strcmp(typeName, MessageTypes[t].Name) != 0)
+      {
+      t ++;
+      }
+    if (t == NumberOfMessageTypes)
+      {
+      std::cerr << "Unknown message type: " << typeName << std::endl;
+      exit(1);
+      }
+    }
+
+  // Header versions and meta data counts
+  std::vector<int> headerVersions;
+  std::vector<int> metaDataCounts;
+  headerVersions.push_back(IGTL_HEADER_VERSION_1);
+  metaDataCounts.push_back(0);
+#if OpenIGTLink_HEADER_VERSION >= 2
+  headerVersions.push_back(IGTL_HEADER_VERSION_2);
+  metaDataCounts.push_back(0);
+  headerVersions.push_back(IGTL_HEADER_VERSION_2);
+  metaDataCounts.push_back(NumberOfMetaDataElements);
+#endif
+
+  // The default factory does not create NDARRAY and BIND messages.
+  igtl::MessageFactory::Pointer factory = igtl::MessageFactory::New();
+#if OpenIGTLink_PROTOCOL_VERSION >= 2
+  factory->AddMessageType("NDARRAY", &NewNDArrayMessage);
+  factory->AddMessageType("BIND", &NewBindMessage);
+#endif
+
+  if (csv)
+    {
+    std::cout << "type,header_version,metadata,bytes,operation,ns_per_message,gb_per_s" << std::endl;
+    }
+  else
+    {
+    std::cout << std::setw(10) << "type"
+              << std::setw(5) << "hdr"
+              << std::setw(6) << "meta"
+              << std::setw(11) << "bytes";
+    for (int mode = Pack; mode <= UnpackAndCheckCRC; mode ++)
+      {
+      std::cout << std::setw(12) << ModeNames[mode] << std::setw(8) << "GB/s";
+      }
+    std::cout << "   (ns/msg)" << std::endl;
+    }
+
+  for (int t = 0; t < NumberOfMessageTypes; t ++)
+    {
+    const MessageType& type = MessageTypes[t];
+    if (typeName && strcmp(typeName, type.Name) != 0)
+      {
+      continue;
+      }
+    // Types without a variable payload are measured once.
+    int numberOfSizes = (type.Sizes[0] == type.Sizes[2]) ? 1 : 3;
+    for (int s = 0; s < numberOfSizes; s ++)
+      {
+      for (size_t h = 0; h < headerVersions.size(); h ++)
+        {
+        igtl::MessageBase::Pointer msg = CreateMessage(factory, type, type.Sizes[s], headerVersions[h], metaDataCounts[h]);
+        igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+        header->InitBuffer();
+        memcpy(header->GetBufferPointer(), msg->GetBufferPointer(), IGTL_HEADER_SIZE);
+        header->Unpack();
+        if (!(ReceiveMessage(factory, header, msg, UnpackAndCheckCRC) & igtl::MessageHeader::UNPACK_BODY))
+          {
+          std::cerr << "Failed to unpack a " << type.Name << " message." << std::endl;
+          return 1;
+          }
+
+        int bytes = msg->GetBufferSize();
+        if (!csv)
+          {
+          std::cout << std::setw(10) << type.Name
+                    << std::setw(5) << headerVersions[h]
+                    << std::setw(6) << metaDataCounts[h]
+                    << std::setw(11) << bytes << std::flush;
+          }
+        for (int mode = Pack; mode <= UnpackAndCheckCRC; mode ++)
+          {
+          double ns = MeasureTime(factory, msg, mode, minTime);
+          double gbps = (double)bytes / ns;
+          if (csv)
+            {
+            std::cout << type.Name << ',' << headerVersions[h] << ',' << metaDataCounts[h] << ','
+                      << bytes << ',' << ModeNames[mode] << ','
+                      << std::fixed << std::setprecision(1) << ns << ','
+                      << std::setprecision(3) << gbps << std::endl;
+            }
+          else
+            {
+            std::cout << std::setw(12) << std::fixed << std::setprecision(0) << ns
+                      << std::setw(8) << std::setprecision(2) << gbps << std::flush;
+            }
+          }
+        if (!csv)
+          {
+          std::cout << std::endl;
+          }
+        }
+      }
+    }
+
+  // Printed so that the loops cannot be optimized away.
+  std::cerr << "checksum: " << Checksum << std::endl;
+  return 0;
+}
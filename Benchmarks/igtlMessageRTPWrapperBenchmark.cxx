@@ -0,0 +1,212 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for the RTP wrapper
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the packet queues of MessageRTPWrapper for messages of 1 KB to
+// 4 MB, in first-come-first-served (FCFS) and last-come-first-served (LIFO)
+// order:
+//   wrap->send     WrapMessageAndPushToBuffer() followed by
+//                  SendBufferedDataWithInterval() to a UDP socket on the
+//                  loopback interface.
+//   receive->unwrap PushDataIntoPacketBuffer() for every packet of a message
+//                  followed by UnWrapPacketWithTypeAndName() until the
+//                  message is reassembled.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <cstring>
+
+#include "igtlImageMessage.h"
+#include "igtlMessageRTPWrapper.h"
+#include "igtlUDPServerSocket.h"
+#include "igtlUDPClientSocket.h"
+#include "igtlTimeStamp.h"
+
+
+typedef std::vector<igtlUint8> Packet;
+
+
+igtl::ImageMessage::Pointer CreateMessage(int size)
+{
+  igtl::ImageMessage::Pointer message = igtl::ImageMessage::New();
+  message->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  message->SetDeviceName("Benchmark");
+  message->SetDimensions(size, 1, 1);
+  message->SetScalarType(igtl::ImageMessage::TYPE_UINT8);
+  message->AllocateScalars();
+  igtlUint8* scalars = (igtlUint8*)message->GetScalarPointer();
+  for (int i = 0; i < size; i ++)
+    {
+    scalars[i] = (igtlUint8) (rand() & 0xFF);
+    }
+  message->Pack();
+  return message;
+}
+
+
+void DeleteUnwrappedMessages(igtl::MessageRTPWrapper* wrapper)
+{
+  std::map<igtl_uint32, igtl::UnWrappedMessage*>::iterator it;
+  for (it = wrapper->unWrappedMessages.begin(); it != wrapper->unWrappedMessages.end(); ++it)
+    {
+    delete it->second;
+    }
+  wrapper->unWrappedMessages.clear();
+}
+
+
+// Wraps and sends 'message' repeatedly for at least 'minTime' seconds and
+// returns the number of messages per second.
+double MeasureWrapAndSend(igtl::ImageMessage* message, igtl::UDPServerSocket::Pointer& socket,
+                          bool fcfs, double minTime)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  igtl::MessageRTPWrapper::Pointer wrapper = igtl::MessageRTPWrapper::New();
+  wrapper->SetFCFS(fcfs);
+
+  long iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (long i = 0; i < iterations; i ++)
+      {
+      wrapper->WrapMessageAndPushToBuffer((igtl_uint8*)message->GetPackPointer(), message->GetPackSize());
+      wrapper->SendBufferedDataWithInterval(socket, 0);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)iterations / elapsed;
+}
+
+
+// Pushes the packets of a message and unwraps them repeatedly for at least
+// 'minTime' seconds and returns the number of messages per second.
+double MeasureReceiveAndUnwrap(const std::vector<Packet>& packets, bool fcfs, double minTime)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  igtl::MessageRTPWrapper::Pointer wrapper = igtl::MessageRTPWrapper::New();
+  wrapper->SetFCFS(fcfs);
+
+  long iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (long i = 0; i < iterations; i ++)
+      {
+      for (size_t j = 0; j < packets.size(); j ++)
+        {
+        wrapper->PushDataIntoPacketBuffer((igtlUint8*)&packets[j][0], (igtlUint16)packets[j].size());
+        }
+      while (wrapper->UnWrapPacketWithTypeAndName("IMAGE", "Benchmark"))
+        {
+        }
+      DeleteUnwrappedMessages(wrapper);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)iterations / elapsed;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int port = 48944;
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    port = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+    minTime = atof(argv[2]);
+    }
+  if (argc > 3 || port <= 0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<UDP port> [<min time per run (s)>]]" << std::endl;
+    exit(0);
+    }
+
+  // The receiving socket is never read; it only makes the loopback port
+  // reachable so that the kernel drops the packets silently.
+  igtl::UDPClientSocket::Pointer receiver = igtl::UDPClientSocket::New();
+  receiver->JoinNetwork("127.0.0.1", port);
+  igtl::UDPServerSocket::Pointer socket = igtl::UDPServerSocket::New();
+  if (socket->CreateUDPServer() < 0)
+    {
+    std::cerr << "Could not create a UDP socket." << std::endl;
+    exit(1);
+    }
+  socket->AddClient("127.0.0.1", port, 0);
+
+  const int sizes[] = {1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+  const int numberOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+  std::cout << std::setw(10) << "bytes"
+            << std::setw(9) << "packets"
+            << std::setw(7) << "order"
+            << std::setw(14) << "wrap->send"
+            << std::setw(17) << "receive->unwrap"
+            << "   (messages/s)" << std::endl;
+  for (int s = 0; s < numberOfSizes; s ++)
+    {
+    igtl::ImageMessage::Pointer message = CreateMessage(sizes[s]);
+
+    // Keep the packets of the message for the receiving side.
+    igtl::MessageRTPWrapper::Pointer wrapper = igtl::MessageRTPWrapper::New();
+    wrapper->WrapMessageAndPushToBuffer((igtl_uint8*)message->GetPackPointer(), message->GetPackSize());
+    const igtl::PacketBuffer& buffered = wrapper->GetOutGoingPackets();
+    std::vector<Packet> packets(buffered.GetNumberOfPackets());
+    for (size_t j = 0; j < packets.size(); j ++)
+      {
+      int length = 0;
+      const unsigned char* packet = buffered.GetPacket((int)j, &length);
+      packets[j].assign(packet, packet + length);
+      }
+
+    for (int fcfs = 1; fcfs >= 0; fcfs --)
+      {
+      double sent = MeasureWrapAndSend(message, socket, fcfs == 1, minTime);
+      double unwrapped = MeasureReceiveAndUnwrap(packets, fcfs == 1, minTime);
+      std::cout << std::setw(10) << sizes[s]
+                << std::setw(9) << packets.size()
+                << std::setw(7) << (fcfs ? "FCFS" : "LIFO")
+                << std::setw(14) << std::fixed << std::setprecision(1) << sent
+                << std::setw(17) << std::fixed << std::setprecision(1) << unwrapped << std::endl;
+      }
+    }
+
+  socket->CloseSocket();
+  receiver->CloseSocket();
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for message meta data
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the message rate of version 2 TDATA messages with 4 tracking
+// elements and 0 to 8 meta data elements, using a new message object for
+// each message as most applications do:
+//   pack        SetMetaDataElement() for each key and Pack()
+//   unpack      Unpack() of a received message whose meta data is not read
+//   unpack+get  Unpack() and GetMetaDataElement() for each key
+//   unpack+map  Unpack() and GetMetaData()
+// The body CRC is not checked, so that the numbers reflect the (de)serialization.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "igtlTrackingDataMessage.h"
+#include "igtlTimeStamp.h"
+
+
+static const char* Keys[] = {"PatientID", "Operator", "Sequence", "Timestamp",
+                             "Status", "Quality", "Reference", "Calibration"};
+
+static const char* Values[] = {"PT-000123", "jdoe", "Needle insertion", "1514764800.000",
+                               "OK", "0.98", "Patient reference", "2018-01-01"};
+
+static const int NumberOfTrackingElements = 4;
+
+enum Mode {
+  Pack,
+  Unpack,
+  UnpackAndGet,
+  UnpackAndMap
+};
+
+// Stands in for the application; keeps the compiler from dropping the loops.
+static igtlUint64 Checksum = 0;
+
+
+igtl::TrackingDataMessage::Pointer CreateMessage(int numberOfEntries,
+                                                 std::vector<igtl::TrackingDataElement::Pointer>& elements)
+{
+  igtl::TrackingDataMessage::Pointer msg = igtl::TrackingDataMessage::New();
+  msg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  msg->SetDeviceName("Tracker");
+  for (int i = 0; i < NumberOfTrackingElements; i ++)
+    {
+    msg->AddTrackingDataElement(elements[i]);
+    }
+  for (int i = 0; i < numberOfEntries; i ++)
+    {
+    msg->SetMetaDataElement(Keys[i], IANA_TYPE_US_ASCII, Values[i]);
+    }
+  msg->Pack();
+  return msg;
+}
+
+
+void ReceiveMessage(igtl::MessageHeader* header, const unsigned char* body, int bodySize,
+                    int numberOfEntries, int mode)
+{
+  igtl::TrackingDataMessage::Pointer msg = igtl::TrackingDataMessage::New();
+  msg->SetMessageHeader(header);
+  msg->AllocatePack();
+  memcpy(msg->GetPackBodyPointer(), body, bodySize);
+  msg->Unpack(0);
+
+  if (mode == UnpackAndGet)
+    {
+    std::string value;
+    for (int i = 0; i < numberOfEntries; i ++)
+      {
+      if (msg->GetMetaDataElement(Keys[i], value))
+        {
+        Checksum += value.size();
+        }
+      }
+    }
+  else if (mode == UnpackAndMap)
+    {
+    Checksum += msg->GetMetaData().size();
+    }
+  Checksum += msg->GetNumberOfTrackingDataElements();
+}
+
+
+// Runs 'mode' repeatedly for at least 'minTime' seconds and returns the
+// number of messages per second.
+double MeasureRate(int numberOfEntries, int mode, double minTime)
+{
+  std::vector<igtl::TrackingDataElement::Pointer> elements;
+  for (int i = 0; i < NumberOfTrackingElements; i ++)
+    {
+    igtl::TrackingDataElement::Pointer element = igtl::TrackingDataElement::New();
+    char name[16];
+    sprintf(name, "Tool%d", i);
+    element->SetName(name);
+    element->SetType(igtl::TrackingDataElement::TYPE_6D);
+    element->SetPosition(i, 2.0 * i, 3.0 * i);
+    elements.push_back(element);
+    }
+
+  // The packed message to be received.
+  igtl::TrackingDataMessage::Pointer packed = CreateMessage(numberOfEntries, elements);
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), packed->GetPackPointer(), IGTL_HEADER_SIZE);
+  header->Unpack();
+  const unsigned char* body = (const unsigned char*)packed->GetPackBodyPointer();
+  int bodySize = packed->GetPackBodySize();
+
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  long iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (long i = 0; i < iterations; i ++)
+      {
+      if (mode == Pack)
+        {
+        Checksum += CreateMessage(numberOfEntries, elements)->GetPackSize();
+        }
+      else
+        {
+        ReceiveMessage(header, body, bodySize, numberOfEntries, mode);
+        }
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)iterations / elapsed;
+}
+
+
+int main(int argc, char* argv[])
+{
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    minTime = atof(argv[1]);
+    }
+  if (argc > 2 || minTime <= 0.0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<min time per run (s)>]" << std::endl;
+    exit(0);
+    }
+
+  const int entries[] = {0, 4, 8};
+  const int numberOfEntryCounts = sizeof(entries) / sizeof(entries[0]);
+
+  std::cout << std::setw(8) << "entries"
+            << std::setw(12) << "pack"
+            << std::setw(12) << "unpack"
+            << std::setw(12) << "unpack+get"
+            << std::setw(12) << "unpack+map"
+            << "   (k msgs/s)" << std::endl;
+  for (int e = 0; e < numberOfEntryCounts; e ++)
+    {
+    std::cout << std::setw(8) << entries[e];
+    for (int mode = Pack; mode <= UnpackAndMap; mode ++)
+      {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1)
+                << MeasureRate(entries[e], mode, minTime) / 1e3 << std::flush;
+      }
+    std::cout << std::endl;
+    }
+
+  // Printed so that the loops cannot be optimized away.
+  std::cerr << "checksum: " << Checksum << std::endl;
+  return 0;
+}
@@ -0,0 +1,193 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for the NAL unit scanner
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the per-frame latency of splitting the bitstream of a video frame
+// into the slices handed to the H.264 decoder, for frames of 4 KB to 4 MB
+// with 1 to 32 slices:
+//   copy+scan  the former H264Decoder::DecodeBitStreamIntoFrame() loop, which
+//              copies the frame with a trailing start code and searches for
+//              start codes byte by byte.
+//   scanner    igtl::NALUnitScanner on the frame in place.
+// The frames are random Annex B streams with emulation prevention, so that
+// start codes only occur at slice boundaries as in an encoded stream.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "igtlNALUnitScanner.h"
+#include "igtlTimeStamp.h"
+
+
+// Stands in for the decoder; keeps the compiler from dropping the scans.
+static igtlUint64 Checksum = 0;
+
+static void DecodeSlice(const unsigned char* slice, igtlUint64 size)
+{
+  Checksum += size + slice[size - 1];
+}
+
+
+void SplitWithCopyAndScan(unsigned char* bitStream, igtlUint64 streamSize)
+{
+  unsigned char startCode[4] = {0, 0, 0, 1};
+  unsigned char* buf = new unsigned char[streamSize + 5];
+  memcpy(buf, bitStream, streamSize);
+  memcpy(buf + streamSize, startCode, 4);
+
+  igtlUint64 bufPos = 0;
+  while (bufPos < streamSize)
+    {
+    igtlUint64 i;
+    for (i = 0; i < streamSize; i ++)
+      {
+      if ((buf[bufPos + i] == 0 && buf[bufPos + i + 1] == 0 && buf[bufPos + i + 2] == 0 && buf[bufPos + i + 3] == 1
+           && i > 0) || (buf[bufPos + i] == 0 && buf[bufPos + i + 1] == 0 && buf[bufPos + i + 2] == 1 && i > 0))
+        {
+        break;
+        }
+      }
+    if (i >= 4)
+      {
+      DecodeSlice(buf + bufPos, i);
+      }
+    bufPos += i;
+    }
+  delete[] buf;
+}
+
+
+void SplitWithScanner(unsigned char* bitStream, igtlUint64 streamSize)
+{
+  igtl::NALUnitScanner scanner(bitStream, streamSize);
+  const igtlUint8* slice = NULL;
+  igtlUint64 size = 0;
+  while (scanner.GetNextNALUnit(&slice, &size))
+    {
+    if (size >= 4)
+      {
+      DecodeSlice(slice, size);
+      }
+    }
+}
+
+
+// Creates a frame of about 'size' bytes: SPS and PPS units followed by
+// 'numberOfSlices' slices of random payload.
+std::vector<unsigned char> CreateFrame(int size, int numberOfSlices)
+{
+  std::vector<unsigned char> frame;
+  const unsigned char sps[] = {0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1f, 0x8c, 0x8d, 0x40};
+  const unsigned char pps[] = {0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80};
+  frame.insert(frame.end(), sps, sps + sizeof(sps));
+  frame.insert(frame.end(), pps, pps + sizeof(pps));
+  for (int s = 0; s < numberOfSlices; s ++)
+    {
+    const unsigned char header[] = {0, 0, 1, 0x65};
+    frame.insert(frame.end(), header, header + sizeof(header));
+    int zeros = 0;
+    for (int i = 0; i < size / numberOfSlices; i ++)
+      {
+      unsigned char byte = (unsigned char) (rand() & 0xFF);
+      if (zeros == 2 && byte <= 3)
+        {
+        frame.push_back(3);
+        zeros = 0;
+        }
+      frame.push_back(byte);
+      zeros = byte == 0 ? zeros + 1 : 0;
+      }
+    // A slice must not end with a zero byte.
+    frame.push_back(0x80);
+    }
+  return frame;
+}
+
+
+// Splits 'frame' repeatedly for at least 'minTime' seconds and returns the
+// time per frame in microseconds.
+double MeasureLatency(void (*split)(unsigned char*, igtlUint64), std::vector<unsigned char>& frame,
+                      double minTime)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  long iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (long i = 0; i < iterations; i ++)
+      {
+      split(&frame[0], frame.size());
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return elapsed / (double)iterations * 1e6;
+}
+
+
+int main(int argc, char* argv[])
+{
+  double minTime = 0.2;
+
+  if (argc > 1)
+    {
+    minTime = atof(argv[1]);
+    }
+  if (argc > 2 || minTime <= 0.0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<min time per run (s)>]" << std::endl;
+    exit(0);
+    }
+
+  const int sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+  const int numberOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+  const int slices[] = {1, 8, 32};
+  const int numberOfSliceCounts = sizeof(slices) / sizeof(slices[0]);
+
+  std::cout << std::setw(10) << "bytes"
+            << std::setw(8) << "slices"
+            << std::setw(12) << "copy+scan"
+            << std::setw(12) << "scanner"
+            << std::setw(10) << "speedup"
+            << "   (us/frame)" << std::endl;
+  for (int s = 0; s < numberOfSizes; s ++)
+    {
+    for (int n = 0; n < numberOfSliceCounts; n ++)
+      {
+      std::vector<unsigned char> frame = CreateFrame(sizes[s], slices[n]);
+      double copyAndScan = MeasureLatency(SplitWithCopyAndScan, frame, minTime);
+      double scanner = MeasureLatency(SplitWithScanner, frame, minTime);
+      std::cout << std::setw(10) << frame.size()
+                << std::setw(8) << slices[n]
+                << std::setw(12) << std::fixed << std::setprecision(2) << copyAndScan
+                << std::setw(12) << std::fixed << std::setprecision(2) << scanner
+                << std::setw(9) << std::fixed << std::setprecision(1) << copyAndScan / scanner << "x"
+                << std::endl;
+      }
+    }
+
+  // Printed so that the scans cannot be optimized away.
+  std::cerr << "checksum: " << Checksum << std::endl;
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for the multi-threaded CRC-64
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "igtl_util.h"
+#include "igtlParallelCRC64.h"
+#include "igtlTimeStamp.h"
+
+
+// Computes the CRC of 'size' bytes with 'numberOfThreads' threads repeatedly
+// for at least 'minTime' seconds and returns the throughput in MB/s.
+double MeasureThroughput(const unsigned char* data, igtl_uint64 size, int numberOfThreads,
+                         double minTime, igtl_uint64& crc)
+{
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  igtl_uint64 iterations = 1;
+  double elapsed = 0.0;
+  while (1)
+    {
+    ts->GetTime();
+    double start = ts->GetTimeStamp();
+    for (igtl_uint64 i = 0; i < iterations; i ++)
+      {
+      crc = igtl::ParallelCRC64(data, size, 0, numberOfThreads);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - start;
+    if (elapsed >= minTime)
+      {
+      break;
+      }
+    iterations *= 2;
+    }
+
+  return (double)(size * iterations) / elapsed / (1024.0 * 1024.0);
+}
+
+
+int main(int argc, char* argv[])
+{
+  igtl_uint64 maxSize = 1024 * 1024 * 1024;
+  int maxThreads = 16;
+  double minTime = 0.5;
+
+  if (argc > 1)
+    {
+    maxSize = (igtl_uint64) atol(argv[1]) * 1024 * 1024;
+    }
+  if (argc > 2)
+    {
+    maxThreads = atoi(argv[2]);
+    }
+  if (argc > 3)
+    {
+    minTime = atof(argv[3]);
+    }
+  if (argc > 4 || maxSize == 0 || maxThreads < 1)
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " [<max body size (MB)> [<max threads> [<min time per run (s)>]]]" << std::endl;
+    exit(0);
+    }
+
+  std::vector<unsigned char> buffer((size_t)maxSize);
+  for (size_t i = 0; i < buffer.size(); i ++)
+    {
+    buffer[i] = (unsigned char) (rand() & 0xFF);
+    }
+
+  std::vector<int> threads;
+  for (int n = 1; n <= maxThreads; n *= 2)
+    {
+    threads.push_back(n);
+    }
+
+  std::cout << "crc64() uses implementation " << igtl_crc64_get_implementation() << std::endl;
+  std::cout << std::setw(10) << "MB";
+  for (size_t j = 0; j < threads.size(); j ++)
+    {
+    std::cout << std::setw(10) << threads[j] << "T";
+    }
+  std::cout << "   (MB/s)" << std::endl;
+
+  for (igtl_uint64 size = 64 * 1024 * 1024; size <= maxSize; size *= 2)
+    {
+    std::cout << std::setw(10) << size / (1024 * 1024);
+    igtl_uint64 reference = crc64(&buffer[0], size, 0);
+    for (size_t j = 0; j < threads.size(); j ++)
+      {
+      igtl_uint64 crc = 0;
+      double mbps = MeasureThroughput(&buffer[0], size, threads[j], minTime, crc);
+      if (crc != reference)
+        {
+        std::cerr << std::endl << "CRC mismatch with " << threads[j] << " threads" << std::endl;
+        return 1;
+        }
+      std::cout << std::setw(11) << std::fixed << std::setprecision(1) << mbps;
+      }
+    std::cout << std::endl;
+    }
+
+  return 0;
+}
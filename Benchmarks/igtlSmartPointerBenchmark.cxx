@@ -0,0 +1,157 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for SmartPointer copies
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Measures the cost of copying and destroying a SmartPointer, i.e. one
+// LightObject::Register() and UnRegister() pair, as in loops over the
+// elements of TDATA or POINT messages. With multiple threads, the pointers
+// either refer to one shared object (all threads update the same reference
+// count) or to a private object per thread.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "igtlMultiThreader.h"
+#include "igtlTrackingDataMessage.h"
+#include "igtlTimeStamp.h"
+
+
+struct ThreadData
+{
+  igtl::TrackingDataElement::Pointer element;
+  long iterations;
+  volatile int* start;
+  long sum;
+};
+
+
+// Copies and destroys the pointer 'iterations' times.
+long CopyPointer(igtl::TrackingDataElement::Pointer& element, long iterations)
+{
+  long sum = 0;
+  for (long i = 0; i < iterations; i ++)
+    {
+    igtl::TrackingDataElement::Pointer copy = element;
+    sum += copy->GetType();
+    }
+  return sum;
+}
+
+
+void* ThreadFunction(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ThreadData* data = static_cast<ThreadData*>(info->UserData);
+  while (!*data->start)
+    {
+    }
+  data->sum = CopyPointer(data->element, data->iterations);
+  return NULL;
+}
+
+
+// Returns the time per copy in nanoseconds.
+double Measure(int numberOfThreads, bool shared, long iterations)
+{
+  igtl::TrackingDataElement::Pointer sharedElement = igtl::TrackingDataElement::New();
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+
+  std::vector<ThreadData> data(numberOfThreads);
+  volatile int start = 0;
+  for (int i = 0; i < numberOfThreads; i ++)
+    {
+    data[i].element = shared ? sharedElement : igtl::TrackingDataElement::New();
+    data[i].iterations = iterations;
+    data[i].start = &start;
+    data[i].sum = 0;
+    }
+
+  double elapsed;
+  if (numberOfThreads == 1)
+    {
+    ts->GetTime();
+    double t0 = ts->GetTimeStamp();
+    data[0].sum = CopyPointer(data[0].element, iterations);
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - t0;
+    }
+  else
+    {
+    igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+    std::vector<int> ids(numberOfThreads);
+    for (int i = 0; i < numberOfThreads; i ++)
+      {
+      ids[i] = threader->SpawnThread((igtl::ThreadFunctionType) &ThreadFunction, &data[i]);
+      }
+    ts->GetTime();
+    double t0 = ts->GetTimeStamp();
+    start = 1;
+    for (int i = 0; i < numberOfThreads; i ++)
+      {
+      threader->TerminateThread(ids[i]);
+      }
+    ts->GetTime();
+    elapsed = ts->GetTimeStamp() - t0;
+    }
+
+  // Keep the loop from being optimized away.
+  long sum = 0;
+  for (int i = 0; i < numberOfThreads; i ++)
+    {
+    sum += data[i].sum;
+    }
+  if (sum < 0)
+    {
+    std::cerr << sum << std::endl;
+    }
+
+  return elapsed * 1e9 / ((double)iterations * numberOfThreads);
+}
+
+
+int main(int argc, char* argv[])
+{
+  long iterations = 10000000;
+  int maxThreads = 8;
+
+  if (argc > 1)
+    {
+    iterations = atol(argv[1]);
+    }
+  if (argc > 2)
+    {
+    maxThreads = atoi(argv[2]);
+    }
+  if (argc > 3 || iterations < 1 || maxThreads < 1)
+    {
+    std::cerr << "Usage: " << argv[0]
+              << " [<copies per thread> [<max threads>]]" << std::endl;
+    exit(0);
+    }
+
+  std::cout << std::setw(10) << "Threads"
+            << std::setw(14) << "Shared"
+            << std::setw(14) << "Private"
+            << "   (ns per copy and destroy)" << std::endl;
+  for (int n = 1; n <= maxThreads; n *= 2)
+    {
+    double shared = Measure(n, true, iterations);
+    double priv = Measure(n, false, iterations);
+    std::cout << std::setw(10) << n
+              << std::setw(14) << std::fixed << std::setprecision(2) << shared
+              << std::setw(14) << std::fixed << std::setprecision(2) << priv << std::endl;
+    }
+
+  return 0;
+}
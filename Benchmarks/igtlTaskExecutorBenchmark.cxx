@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library -- Benchmark for the task executor
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Runs a small parallel job (summing a buffer of <size> bytes split among
+// <threads> threads, as ParallelCRC64() or the color conversion of one video
+// frame does) repeatedly and compares:
+//   threader    MultiThreader::SingleMethodExecute(), which creates and joins
+//               the threads for every job
+//   executor    TaskExecutor::ParallelFor() on persistent workers (the
+//               calling thread and <threads> - 1 workers)
+// Reported per job size: the mean time per job in microseconds.
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+
+#include "igtlMultiThreader.h"
+#include "igtlTaskExecutor.h"
+#include "igtlTimeStamp.h"
+
+
+struct SumData
+{
+  const unsigned char* Buffer;
+  igtlInt64            Size;
+  int                  NumberOfParts;
+  igtlUint64           Sums[IGTL_MAX_THREADS];
+};
+
+// Stands in for the application; keeps the compiler from dropping the loops.
+static igtlUint64 Checksum = 0;
+
+
+void SumPart(SumData* data, igtlInt64 part)
+{
+  igtlInt64 begin = data->Size * part / data->NumberOfParts;
+  igtlInt64 end = data->Size * (part + 1) / data->NumberOfParts;
+  igtlUint64 sum = 0;
+  for (igtlInt64 i = begin; i < end; i ++)
+    {
+    sum += data->Buffer[i];
+    }
+  data->Sums[part] = sum;
+}
+
+
+void* SumThread(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  SumPart(static_cast<SumData*>(info->UserData), info->ThreadID);
+  return NULL;
+}
+
+
+void SumRange(void* ptr, igtlInt64 begin, igtlInt64 end)
+{
+  for (igtlInt64 part = begin; part < end; part ++)
+    {
+    SumPart(static_cast<SumData*>(ptr), part);
+    }
+}
+
+
+// Returns the mean time per job in microseconds.
+double Measure(bool executor, SumData* data, int numberOfJobs)
+{
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  threader->SetNumberOfThreads(data->NumberOfParts);
+  threader->SetSingleMethod((igtl::ThreadFunctionType) &SumThread, data);
+  igtl::TaskExecutor* tasks = igtl::TaskExecutor::GetGlobalExecutor();
+
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  ts->GetTime();
+  double start = ts->GetTimeStamp();
+  for (int i = 0; i < numberOfJobs; i ++)
+    {
+    if (executor)
+      {
+      tasks->ParallelFor(0, data->NumberOfParts, &SumRange, data);
+      }
+    else
+      {
+      threader->SingleMethodExecute();
+      }
+    for (int j = 0; j < data->NumberOfParts; j ++)
+      {
+      Checksum += data->Sums[j];
+      }
+    }
+  ts->GetTime();
+  return (ts->GetTimeStamp() - start) / numberOfJobs * 1e6;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int numberOfThreads = igtl::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  int numberOfJobs = 2000;
+
+  if (argc > 1)
+    {
+    numberOfThreads = atoi(argv[1]);
+    }
+  if (argc > 2)
+    {
+    numberOfJobs = atoi(argv[2]);
+    }
+  if (argc > 3 || numberOfThreads < 1 || numberOfThreads > IGTL_MAX_THREADS ||
+      numberOfJobs <= 0)
+    {
+    std::cerr << "Usage: " << argv[0] << " [<threads> [<jobs>]]" << std::endl;
+    exit(0);
+    }
+
+  igtl::TaskExecutor::GetGlobalExecutor()->SetNumberOfWorkers(numberOfThreads - 1);
+
+  std::vector<unsigned char> buffer(16 * 1024 * 1024);
+  for (size_t i = 0; i < buffer.size(); i ++)
+    {
+    buffer[i] = (unsigned char) (rand() & 0xFF);
+    }
+
+  std::cout << numberOfThreads << " threads" << std::endl;
+  std::cout << std::setw(10) << "KB"
+            << std::setw(14) << "threader"
+            << std::setw(14) << "executor" << "   (us/job)" << std::endl;
+  for (igtlInt64 size = 4 * 1024; size <= (igtlInt64)buffer.size(); size *= 8)
+    {
+    SumData data;
+    data.Buffer = &buffer[0];
+    data.Size = size;
+    data.NumberOfParts = numberOfThreads;
+    // Fewer jobs for the large sizes, so that each row takes similar time.
+    int jobs = numberOfJobs * 4096 / (int)(size / 1024 + 4096) + 1;
+    std::cout << std::setw(10) << size / 1024
+              << std::setw(14) << std::fixed << std::setprecision(1) << Measure(false, &data, jobs)
+              << std::setw(14) << Measure(true, &data, jobs) << std::endl;
+    }
+
+  // Printed so that the loops cannot be optimized away.
+  std::cerr << "checksum: " << Checksum << std::endl;
+  return 0;
+}
@@ -42,10 +42,101 @@ CHECK_FUNCTION_EXISTS(strnlen OpenIGTLink_HAVE_STRNLEN)
 # BlueGene/L applications" according to the BlueGene/L Application Development handbook
 CHECK_SYMBOL_EXISTS(SO_REUSEADDR "sys/types.h;sys/socket.h" OpenIGTLink_HAVE_SO_REUSEADDR)
 
+# Linux epoll() used by igtl::EventLoopServer. Other platforms fall back to select().
+CHECK_SYMBOL_EXISTS(epoll_create1 "sys/epoll.h" OpenIGTLink_HAVE_EPOLL)
+
+# Transparent huge pages (Linux) used by igtl::PooledBufferAllocator for large message buffers.
+CHECK_SYMBOL_EXISTS(MADV_HUGEPAGE "sys/mman.h" OpenIGTLink_HAVE_MADV_HUGEPAGE)
+
+# POSIX mmap() used by igtl::MessageCaptureReader to map capture files. Windows uses
+# file mapping objects; other platforms read the file into memory.
+CHECK_SYMBOL_EXISTS(mmap "sys/mman.h" OpenIGTLink_HAVE_MMAP)
+
+# POSIX clock_gettime() used by igtl::TimeStamp for the nanosecond realtime and monotonic clocks.
+# Other platforms fall back to gettimeofday().
+CHECK_SYMBOL_EXISTS(clock_gettime "time.h" OpenIGTLink_HAVE_CLOCK_GETTIME)
+
+# Linux sendmmsg()/recvmmsg() used by the batch UDP calls of igtl::GeneralSocket. Other platforms
+# send and receive one datagram per system call.
+SET(CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+CHECK_SYMBOL_EXISTS(sendmmsg "sys/types.h;sys/socket.h" OpenIGTLink_HAVE_SENDMMSG)
+CHECK_SYMBOL_EXISTS(recvmmsg "sys/types.h;sys/socket.h" OpenIGTLink_HAVE_RECVMMSG)
+SET(CMAKE_REQUIRED_DEFINITIONS)
+
 SET(HAVE_SOCKETS TRUE)
 # Cray Xt3/ Catamount doesn't have any socket support
 # this could also be determined by doing something like
 # check_symbol_exists(socket "sys/types.h;sys/socket.h" HAVE_SOCKETS)
 IF(CMAKE_SYSTEM MATCHES Catamount)
   SET(HAVE_SOCKETS FALSE)
-ENDIF(CMAKE_SYSTEM MATCHES Catamount)
\ No newline at end of file
+ENDIF(CMAKE_SYSTEM MATCHES Catamount)
+# x86 carry-less multiply (PCLMULQDQ) used by the accelerated crc64() in
+# igtl_util.c. The instruction set is enabled per function and selected at
+# runtime, so no global compiler flag is required.
+INCLUDE(CheckCSourceCompiles)
+CHECK_C_SOURCE_COMPILES("
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define TARGET_CLMUL
+#else
+#  include <cpuid.h>
+#  define TARGET_CLMUL __attribute__((target(\"pclmul,ssse3\")))
+#endif
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+TARGET_CLMUL static __m128i f(__m128i a, __m128i b)
+{
+  return _mm_shuffle_epi8(_mm_clmulepi64_si128(a, b, 0x11), b);
+}
+int main()
+{
+  __m128i z = _mm_setzero_si128();
+  z = f(z, z);
+  return _mm_cvtsi128_si32(z);
+}
+" OpenIGTLink_HAVE_PCLMUL)
+# x86 SSSE3 and AVX2 used by the byte order conversion and by the color
+# conversion kernels of the video streaming classes. As above, the instruction sets are enabled per function
+# and selected at runtime.
+CHECK_C_SOURCE_COMPILES("
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define TARGET_SSSE3
+#else
+#  include <cpuid.h>
+#  define TARGET_SSSE3 __attribute__((target(\"ssse3\")))
+#endif
+#include <tmmintrin.h>
+TARGET_SSSE3 static __m128i f(__m128i a, __m128i b)
+{
+  return _mm_shuffle_epi8(_mm_madd_epi16(a, b), b);
+}
+int main()
+{
+  __m128i z = _mm_setzero_si128();
+  z = f(z, z);
+  return _mm_cvtsi128_si32(z);
+}
+" OpenIGTLink_HAVE_SSSE3)
+CHECK_C_SOURCE_COMPILES("
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define TARGET_AVX2
+#else
+#  include <cpuid.h>
+#  define TARGET_AVX2 __attribute__((target(\"avx2\")))
+#endif
+#include <immintrin.h>
+TARGET_AVX2 static int f(const int* p)
+{
+  __m256i a = _mm256_loadu_si256((const __m256i*)p);
+  a = _mm256_permute4x64_epi64(_mm256_madd_epi16(a, a), 0xD8);
+  return _mm_cvtsi128_si32(_mm256_castsi256_si128(a));
+}
+int main()
+{
+  int p[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  return f(p);
+}
+" OpenIGTLink_HAVE_AVX2)
@@ -102,11 +102,9 @@ int main(int argc, char* argv[])
     //------------------------------------------------------------
     // Pack (serialize) and send
     imgMsg->Pack();
-    //socket->Send(imgMsg->GetPackPointer(), imgMsg->GetPackSize());
-    for (int i = 0; i < imgMsg->GetNumberOfPackFragments(); i ++)
-      {
-      socket->Send(imgMsg->GetPackFragmentPointer(i), imgMsg->GetPackFragmentSize(i));
-      }
+    // The header, image header and image are sent with a single system call
+    // without being copied into a single pack.
+    socket->SendFragments(imgMsg);
 
     
     igtl::Sleep(interval); // wait
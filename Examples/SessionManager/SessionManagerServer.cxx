@@ -183,6 +183,10 @@ int main(int argc, char* argv[])
         {
         break;
         }
+      if (r < 0) // No message
+        {
+        continue;
+        }
       std::cerr << "Message Type: " << tmh->GetData()->messagetype << std::endl;
       std::cerr << "Device Name: " << tmh->GetData()->devicename << std::endl;
       }
@@ -7,6 +7,7 @@
 //
 
 #include "igtlCodecCommonClasses.h"
+#include "igtlColorConversion.h"
 
 namespace igtl {
 
@@ -172,126 +173,79 @@ igtl_int64 GenericDecoder::getCurrentTime()
 
 int GenericDecoder::ConvertYUVToRGB(igtl_uint8 *YUVFrame, igtl_uint8* RGBFrame, int iHeight, int iWidth)
 {
-  int componentLength = iHeight*iWidth;
+  if (iWidth % 2 == 0 && iHeight % 2 == 0)
+    {
+    ConvertI420ToRGB(YUVFrame, RGBFrame, iWidth, iHeight);
+    return 1;
+    }
+
+  // Odd sizes: the chroma planes have (iWidth/2) x (iHeight/2) samples and
+  // the V plane starts iWidth*iHeight/4 bytes after the U plane, as in the
+  // decoded pictures. The last row or column uses the chroma of its neighbour.
+  const int halfWidth = iWidth / 2;
+  const int halfHeight = iHeight / 2;
   const igtl_uint8 *srcY = YUVFrame;
-  const igtl_uint8 *srcU = YUVFrame+componentLength;
-  const igtl_uint8 *srcV = YUVFrame+componentLength*5/4;
-  igtl_uint8 * YUV444 = new igtl_uint8[componentLength * 3];
-  igtl_uint8 *dstY = YUV444;
-  igtl_uint8 *dstU = dstY + componentLength;
-  igtl_uint8 *dstV = dstU + componentLength;
-  
-  memcpy(dstY, srcY, componentLength);
-  const int halfHeight = iHeight/2;
-  const int halfWidth = iWidth/2;
-  
-#pragma omp parallel for default(none) shared(dstV,dstU,srcV,srcU,iWidth)
-  for (int y = 0; y < halfHeight; y++)
+  const igtl_uint8 *srcU = YUVFrame + iWidth * iHeight;
+  const igtl_uint8 *srcV = srcU + iWidth * iHeight / 4;
+  for (int y = 0; y < iHeight; y ++)
     {
-    for (int x = 0; x < halfWidth; x++)
+    const int cy = (y / 2 < halfHeight) ? y / 2 : halfHeight - 1;
+    for (int x = 0; x < iWidth; x ++)
       {
-      dstU[2 * x + 2 * y*iWidth] = dstU[2 * x + 1 + 2 * y*iWidth] = srcU[x + y*iWidth/2];
-      dstV[2 * x + 2 * y*iWidth] = dstV[2 * x + 1 + 2 * y*iWidth] = srcV[x + y*iWidth/2];
+      const int cx = (x / 2 < halfWidth) ? x / 2 : halfWidth - 1;
+      int d = 0;
+      int e = 0;
+      if (cx >= 0 && cy >= 0)
+        {
+        d = (int)srcU[cy * halfWidth + cx] - 128;
+        e = (int)srcV[cy * halfWidth + cx] - 128;
+        }
+      const int c = ((int)srcY[y * iWidth + x] - 16) * 298;
+      const int r = (c + 409 * e) >> 8;
+      const int g = (c - 100 * d - 208 * e) >> 8;
+      const int b = (c + 517 * d) >> 8;
+      igtl_uint8 *p = RGBFrame + 3 * (y * iWidth + x);
+      p[0] = (igtl_uint8)(r < 0 ? 0 : (r > 255 ? 255 : r));
+      p[1] = (igtl_uint8)(g < 0 ? 0 : (g > 255 ? 255 : g));
+      p[2] = (igtl_uint8)(b < 0 ? 0 : (b > 255 ? 255 : b));
       }
-    memcpy(&dstU[(2 * y + 1)*iWidth], &dstU[(2 * y)*iWidth], iWidth);
-    memcpy(&dstV[(2 * y + 1)*iWidth], &dstV[(2 * y)*iWidth], iWidth);
     }
-  
-  
-  const int yOffset = 16;
-  const int cZero = 128;
-  int yMult, rvMult, guMult, gvMult, buMult;
-  yMult =   298;
-  rvMult = 409;
-  guMult = -100;
-  gvMult = -208;
-  buMult = 517;
-  
-  static unsigned char clp_buf[384+256+384];
-  static unsigned char *clip_buf = clp_buf+384;
-  
-  // initialize clipping table
-  memset(clp_buf, 0, 384);
-  
-  for (int i = 0; i < 256; i++)
-    {
-    clp_buf[384+i] = i;
-    }
-  memset(clp_buf+384+256, 255, 384);
-  
-  
-#pragma omp parallel for default(none) shared(dstY,dstU,dstV,RGBFrame,yMult,rvMult,guMult,gvMult,buMult,clip_buf,componentLength)// num_threads(2)
-  for (int i = 0; i < componentLength; ++i)
-    {
-    const int Y_tmp = ((int)dstY[i] - yOffset) * yMult;
-    const int U_tmp = (int)dstU[i] - cZero;
-    const int V_tmp = (int)dstV[i] - cZero;
-    
-    const int R_tmp = (Y_tmp                  + V_tmp * rvMult ) >> 8;//32 to 16 bit conversion by left shifting
-    const int G_tmp = (Y_tmp + U_tmp * guMult + V_tmp * gvMult ) >> 8;
-    const int B_tmp = (Y_tmp + U_tmp * buMult                  ) >> 8;
-    
-    RGBFrame[3*i]   = clip_buf[R_tmp];
-    RGBFrame[3*i+1] = clip_buf[G_tmp];
-    RGBFrame[3*i+2] = clip_buf[B_tmp];
-    }
-  delete [] YUV444;
-  YUV444 = NULL;
-  dstY = NULL;
-  dstU = NULL;
-  dstV = NULL;
   return 1;
 }
 
 int GenericDecoder::ConvertYUVToGrayImage(igtl_uint8 * YUV420Frame, igtl_uint8 *GrayFrame, int iHeight, int iWidth)
 {
-  int componentLength = iHeight*iWidth;
-  for (int i = 0,j= 0; i < 3*componentLength; i=i+3,j++) {
-    GrayFrame[i] = YUV420Frame[j];
-    GrayFrame[i+1] = YUV420Frame[j];
-    GrayFrame[i+2] = YUV420Frame[j];
-  }
+  ConvertI420ToGrayRGB(YUV420Frame, GrayFrame, iWidth, iHeight);
   return 1;
 }
 
 void GenericEncoder::ConvertRGBToYUV(igtlUint8 *rgb, igtlUint8 *destination, unsigned int width, unsigned int height)
 {
-  size_t image_size = width * height;
-  size_t upos = image_size;
-  size_t vpos = upos + upos / 4;
-  size_t i = 0;
-  
-  for (size_t line = 0; line < height; ++line)
+  if (width % 2 == 0 && height % 2 == 0)
     {
-    if (!(line % 2))
-      {
-      for (size_t x = 0; x < width; x += 2)
-        {
-        igtlUint8 r = rgb[3 * i];
-        igtlUint8 g = rgb[3 * i + 1];
-        igtlUint8 b = rgb[3 * i + 2];
-        
-        destination[i++] = ((66 * r + 129 * g + 25 * b) >> 8) + 16;
-        
-        destination[upos++] = ((-38 * r - 74 * g + 112 * b) >> 8) + 128;
-        destination[vpos++] = ((112 * r - 94 * g -18 * b) >> 8) + 128;
-        
-        r = rgb[3 * i];
-        g = rgb[3 * i + 1];
-        b = rgb[3 * i + 2];
-        
-        destination[i++] = ((66 * r + 129 * g + 25 * b) >> 8) + 16;
-        }
-      }
-    else
+    ConvertRGBToI420(rgb, destination, (int)width, (int)height);
+    return;
+    }
+
+  // Odd sizes: the layout matches GenericDecoder::ConvertYUVToRGB(). The
+  // chroma is sampled at the even rows and columns.
+  const unsigned int halfWidth = width / 2;
+  const unsigned int halfHeight = height / 2;
+  igtlUint8 *u = destination + width * height;
+  igtlUint8 *v = u + width * height / 4;
+  for (unsigned int y = 0; y < height; y ++)
+    {
+    for (unsigned int x = 0; x < width; x ++)
       {
-      for (size_t x = 0; x < width; x += 1)
+      const igtlUint8 *p = rgb + 3 * (y * width + x);
+      const int r = p[0];
+      const int g = p[1];
+      const int b = p[2];
+      destination[y * width + x] = ((66 * r + 129 * g + 25 * b) >> 8) + 16;
+      if (y % 2 == 0 && x % 2 == 0 && y / 2 < halfHeight && x / 2 < halfWidth)
         {
-        igtlUint8 r = rgb[3 * i];
-        igtlUint8 g = rgb[3 * i + 1];
-        igtlUint8 b = rgb[3 * i + 2];
-        
-        destination[i++] = ((66 * r + 129 * g + 25 * b) >> 8) + 16;
+        u[(y / 2) * halfWidth + x / 2] = ((-38 * r - 74 * g + 112 * b) >> 8) + 128;
+        v[(y / 2) * halfWidth + x / 2] = ((112 * r - 94 * g - 18 * b) >> 8) + 128;
         }
       }
     }
@@ -270,6 +270,12 @@ public:
    
    To do, use the latest conversion Scheme from ITU. 
    https://www.itu.int/dms_pubrec/itu-r/rec/bt/R-REC-BT.2020-2-201510-I!!PDF-E.pdf
+   
+   Frames with even dimensions are converted by the vectorized kernels in
+   igtlColorConversion.h, which produce identical output. For odd dimensions,
+   the chroma planes have (iWidth/2) x (iHeight/2) samples, the V plane starts
+   iWidth*iHeight/4 bytes after the U plane, and the last row or column uses
+   the chroma of its neighbour.
    */
   static int ConvertYUVToRGB(igtl_uint8 *YUVFrame, igtl_uint8* RGBFrame, int iHeight, int iWidth);
   
@@ -0,0 +1,770 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlColorConversion.h"
+#include "igtlConfigure.h"
+#include "igtlMutexLock.h"
+#include "igtlTaskExecutor.h"
+
+#if defined(OpenIGTLink_HAVE_SSSE3)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define IGTL_TARGET_SSSE3
+#    define IGTL_TARGET_AVX2
+#  else
+#    include <cpuid.h>
+#    define IGTL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#    define IGTL_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#  include <emmintrin.h>
+#  include <tmmintrin.h>
+#  if defined(OpenIGTLink_HAVE_AVX2)
+#    include <immintrin.h>
+#  endif
+#endif
+
+/*
+ * The kernels convert one row at a time and are bit-exact with the fixed-point
+ * formulas documented in igtlCodecCommonClasses.h:
+ *
+ *   Y = ((66 R + 129 G + 25 B) >> 8) + 16
+ *   U = ((-38 R - 74 G + 112 B) >> 8) + 128
+ *   V = ((112 R - 94 G - 18 B) >> 8) + 128
+ *
+ *   R = clip((298 (Y - 16)                  + 409 (V - 128)) >> 8)
+ *   G = clip((298 (Y - 16) - 100 (U - 128) - 208 (V - 128)) >> 8)
+ *   B = clip((298 (Y - 16) + 517 (U - 128)                 ) >> 8)
+ *
+ * where >> rounds toward negative infinity. Each SIMD kernel processes whole
+ * blocks of pixels and leaves the rest of the row to the scalar kernel.
+ */
+
+namespace igtl
+{
+
+typedef void (*RGBToI420RowFunction)(const igtlUint8* rgb, igtlUint8* y, igtlUint8* u, igtlUint8* v,
+                                     int x, int width);
+typedef void (*I420ToRGBRowFunction)(const igtlUint8* y, const igtlUint8* u, const igtlUint8* v,
+                                     igtlUint8* rgb, int x, int width);
+typedef void (*GrayToRGBRowFunction)(const igtlUint8* y, igtlUint8* rgb, int x, int width);
+
+struct ColorConversionKernels
+{
+  RGBToI420RowFunction RGBToI420;
+  I420ToRGBRowFunction I420ToRGB;
+  GrayToRGBRowFunction GrayToRGB;
+};
+
+
+//-----------------------------------------------------------------------------
+// Scalar kernels
+
+// Converts pixels [x, width) of a row. The chroma is written for the even
+// pixels, unless 'u' is NULL (odd rows).
+static void RGBToI420Row_Scalar(const igtlUint8* rgb, igtlUint8* y, igtlUint8* u, igtlUint8* v,
+                                int x, int width)
+{
+  for (; x < width; x ++)
+    {
+    const int r = rgb[3 * x];
+    const int g = rgb[3 * x + 1];
+    const int b = rgb[3 * x + 2];
+    y[x] = (igtlUint8)(((66 * r + 129 * g + 25 * b) >> 8) + 16);
+    if (u && !(x & 1))
+      {
+      u[x / 2] = (igtlUint8)(((-38 * r - 74 * g + 112 * b) >> 8) + 128);
+      v[x / 2] = (igtlUint8)(((112 * r - 94 * g - 18 * b) >> 8) + 128);
+      }
+    }
+}
+
+
+static inline igtlUint8 ClampToUint8(int value)
+{
+  return (igtlUint8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+
+static void I420ToRGBRow_Scalar(const igtlUint8* y, const igtlUint8* u, const igtlUint8* v,
+                                igtlUint8* rgb, int x, int width)
+{
+  for (; x < width; x ++)
+    {
+    const int yTmp = ((int)y[x] - 16) * 298;
+    const int uTmp = (int)u[x / 2] - 128;
+    const int vTmp = (int)v[x / 2] - 128;
+    rgb[3 * x]     = ClampToUint8((yTmp + vTmp * 409) >> 8);
+    rgb[3 * x + 1] = ClampToUint8((yTmp - uTmp * 100 - vTmp * 208) >> 8);
+    rgb[3 * x + 2] = ClampToUint8((yTmp + uTmp * 517) >> 8);
+    }
+}
+
+
+static void GrayToRGBRow_Scalar(const igtlUint8* y, igtlUint8* rgb, int x, int width)
+{
+  for (; x < width; x ++)
+    {
+    rgb[3 * x] = rgb[3 * x + 1] = rgb[3 * x + 2] = y[x];
+    }
+}
+
+
+static const ColorConversionKernels ScalarKernels =
+{
+  RGBToI420Row_Scalar,
+  I420ToRGBRow_Scalar,
+  GrayToRGBRow_Scalar
+};
+
+
+#if defined(OpenIGTLink_HAVE_SSSE3)
+
+//-----------------------------------------------------------------------------
+// SSSE3 kernels (16 pixels per iteration)
+
+// Splits 16 packed RGB pixels into one register per channel.
+IGTL_TARGET_SSSE3
+static inline void DeinterleaveRGB(const igtlUint8* rgb, __m128i* r, __m128i* g, __m128i* b)
+{
+  const __m128i a0 = _mm_loadu_si128((const __m128i*)(rgb));
+  const __m128i a1 = _mm_loadu_si128((const __m128i*)(rgb + 16));
+  const __m128i a2 = _mm_loadu_si128((const __m128i*)(rgb + 32));
+
+  *r = _mm_or_si128(_mm_or_si128(
+         _mm_shuffle_epi8(a0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+         _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+         _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+  *g = _mm_or_si128(_mm_or_si128(
+         _mm_shuffle_epi8(a0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+         _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+         _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+  *b = _mm_or_si128(_mm_or_si128(
+         _mm_shuffle_epi8(a0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+         _mm_shuffle_epi8(a1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+         _mm_shuffle_epi8(a2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+
+// Stores one register per channel as 16 packed RGB pixels.
+IGTL_TARGET_SSSE3
+static inline void InterleaveRGB(__m128i r, __m128i g, __m128i b, igtlUint8* rgb)
+{
+  _mm_storeu_si128((__m128i*)(rgb), _mm_or_si128(_mm_or_si128(
+    _mm_shuffle_epi8(r, _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5)),
+    _mm_shuffle_epi8(g, _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1))),
+    _mm_shuffle_epi8(b, _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1))));
+  _mm_storeu_si128((__m128i*)(rgb + 16), _mm_or_si128(_mm_or_si128(
+    _mm_shuffle_epi8(r, _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1)),
+    _mm_shuffle_epi8(g, _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10))),
+    _mm_shuffle_epi8(b, _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1))));
+  _mm_storeu_si128((__m128i*)(rgb + 32), _mm_or_si128(_mm_or_si128(
+    _mm_shuffle_epi8(r, _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1)),
+    _mm_shuffle_epi8(g, _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1))),
+    _mm_shuffle_epi8(b, _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15))));
+}
+
+
+// Y of 8 pixels in 16-bit lanes. 66 R + 129 G + 25 B <= 56100 fits in an
+// unsigned 16-bit lane, hence the logical shift.
+IGTL_TARGET_SSSE3
+static inline __m128i LumaFromRGB16(__m128i r, __m128i g, __m128i b)
+{
+  __m128i s = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                                          _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+                            _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+  return _mm_add_epi16(_mm_srli_epi16(s, 8), _mm_set1_epi16(16));
+}
+
+
+// U or V of 8 pixels in 16-bit lanes. The sum is within +/-112*255 and fits
+// in a signed 16-bit lane; the arithmetic shift rounds like >> on int.
+IGTL_TARGET_SSSE3
+static inline __m128i ChromaFromRGB16(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb)
+{
+  __m128i s = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+                                          _mm_mullo_epi16(g, _mm_set1_epi16(cg))),
+                            _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+  return _mm_add_epi16(_mm_srai_epi16(s, 8), _mm_set1_epi16(128));
+}
+
+
+IGTL_TARGET_SSSE3
+static inline __m128i CoefficientPair(short a, short b)
+{
+  return _mm_setr_epi16(a, b, a, b, a, b, a, b);
+}
+
+
+// R, G and B of 8 pixels from Y - 16, U - 128 and V - 128 in 16-bit lanes.
+// The products are summed in 32 bits by pmaddwd, so no intermediate rounds.
+IGTL_TARGET_SSSE3
+static inline void RGBFromYUV16(__m128i y, __m128i u, __m128i v, __m128i* r, __m128i* g, __m128i* b)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i yvLo = _mm_unpacklo_epi16(y, v);
+  const __m128i yvHi = _mm_unpackhi_epi16(y, v);
+  const __m128i yuLo = _mm_unpacklo_epi16(y, u);
+  const __m128i yuHi = _mm_unpackhi_epi16(y, u);
+  const __m128i v0Lo = _mm_unpacklo_epi16(v, zero);
+  const __m128i v0Hi = _mm_unpackhi_epi16(v, zero);
+
+  const __m128i kR  = CoefficientPair(298, 409);
+  const __m128i kG  = CoefficientPair(298, -100);
+  const __m128i kGV = CoefficientPair(-208, 0);
+  const __m128i kB  = CoefficientPair(298, 517);
+
+  *r = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(yvLo, kR), 8),
+                       _mm_srai_epi32(_mm_madd_epi16(yvHi, kR), 8));
+  *g = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, kG), _mm_madd_epi16(v0Lo, kGV)), 8),
+                       _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, kG), _mm_madd_epi16(v0Hi, kGV)), 8));
+  *b = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(yuLo, kB), 8),
+                       _mm_srai_epi32(_mm_madd_epi16(yuHi, kB), 8));
+}
+
+
+IGTL_TARGET_SSSE3
+static void RGBToI420Row_SSSE3(const igtlUint8* rgb, igtlUint8* y, igtlUint8* u, igtlUint8* v,
+                               int x, int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i evenMask = _mm_set1_epi16(0x00FF);
+
+  for (; x + 16 <= width; x += 16)
+    {
+    __m128i r, g, b;
+    DeinterleaveRGB(rgb + 3 * x, &r, &g, &b);
+    __m128i yLo = LumaFromRGB16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i yHi = LumaFromRGB16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero));
+    _mm_storeu_si128((__m128i*)(y + x), _mm_packus_epi16(yLo, yHi));
+    if (u)
+      {
+      // The even pixels are the low bytes of the 16-bit lanes.
+      const __m128i re = _mm_and_si128(r, evenMask);
+      const __m128i ge = _mm_and_si128(g, evenMask);
+      const __m128i be = _mm_and_si128(b, evenMask);
+      __m128i cu = ChromaFromRGB16(re, ge, be, -38, -74, 112);
+      __m128i cv = ChromaFromRGB16(re, ge, be, 112, -94, -18);
+      _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(cu, cu));
+      _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(cv, cv));
+      }
+    }
+  RGBToI420Row_Scalar(rgb, y, u, v, x, width);
+}
+
+
+IGTL_TARGET_SSSE3
+static void I420ToRGBRow_SSSE3(const igtlUint8* y, const igtlUint8* u, const igtlUint8* v,
+                               igtlUint8* rgb, int x, int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i k16  = _mm_set1_epi16(16);
+  const __m128i k128 = _mm_set1_epi16(128);
+
+  for (; x + 16 <= width; x += 16)
+    {
+    const __m128i yy = _mm_loadu_si128((const __m128i*)(y + x));
+    __m128i uu = _mm_loadl_epi64((const __m128i*)(u + x / 2));
+    __m128i vv = _mm_loadl_epi64((const __m128i*)(v + x / 2));
+    // Each chroma sample covers two pixels.
+    uu = _mm_unpacklo_epi8(uu, uu);
+    vv = _mm_unpacklo_epi8(vv, vv);
+
+    __m128i r0, g0, b0, r1, g1, b1;
+    RGBFromYUV16(_mm_sub_epi16(_mm_unpacklo_epi8(yy, zero), k16),
+                 _mm_sub_epi16(_mm_unpacklo_epi8(uu, zero), k128),
+                 _mm_sub_epi16(_mm_unpacklo_epi8(vv, zero), k128), &r0, &g0, &b0);
+    RGBFromYUV16(_mm_sub_epi16(_mm_unpackhi_epi8(yy, zero), k16),
+                 _mm_sub_epi16(_mm_unpackhi_epi8(uu, zero), k128),
+                 _mm_sub_epi16(_mm_unpackhi_epi8(vv, zero), k128), &r1, &g1, &b1);
+    // packus clamps to [0, 255] like the clipping table of the original code.
+    InterleaveRGB(_mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1), rgb + 3 * x);
+    }
+  I420ToRGBRow_Scalar(y, u, v, rgb, x, width);
+}
+
+
+IGTL_TARGET_SSSE3
+static void GrayToRGBRow_SSSE3(const igtlUint8* y, igtlUint8* rgb, int x, int width)
+{
+  for (; x + 16 <= width; x += 16)
+    {
+    const __m128i yy = _mm_loadu_si128((const __m128i*)(y + x));
+    igtlUint8* dst = rgb + 3 * x;
+    _mm_storeu_si128((__m128i*)(dst),
+      _mm_shuffle_epi8(yy, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5)));
+    _mm_storeu_si128((__m128i*)(dst + 16),
+      _mm_shuffle_epi8(yy, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10)));
+    _mm_storeu_si128((__m128i*)(dst + 32),
+      _mm_shuffle_epi8(yy, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15)));
+    }
+  GrayToRGBRow_Scalar(y, rgb, x, width);
+}
+
+
+static const ColorConversionKernels SSSE3Kernels =
+{
+  RGBToI420Row_SSSE3,
+  I420ToRGBRow_SSSE3,
+  GrayToRGBRow_SSSE3
+};
+
+
+#if defined(OpenIGTLink_HAVE_AVX2)
+
+//-----------------------------------------------------------------------------
+// AVX2 kernels (32 pixels per iteration). The arithmetic is done on 256-bit
+// registers; the RGB (de)interleaving uses the SSSE3 shuffles on each half,
+// since byte shuffles cannot cross the 128-bit lanes.
+
+IGTL_TARGET_AVX2
+static inline __m256i LumaFromRGB16_AVX2(__m256i r, __m256i g, __m256i b)
+{
+  __m256i s = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                                                _mm256_mullo_epi16(g, _mm256_set1_epi16(129))),
+                               _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+  return _mm256_add_epi16(_mm256_srli_epi16(s, 8), _mm256_set1_epi16(16));
+}
+
+
+IGTL_TARGET_AVX2
+static inline __m256i ChromaFromRGB16_AVX2(__m256i r, __m256i g, __m256i b, short cr, short cg, short cb)
+{
+  __m256i s = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr)),
+                                                _mm256_mullo_epi16(g, _mm256_set1_epi16(cg))),
+                               _mm256_mullo_epi16(b, _mm256_set1_epi16(cb)));
+  return _mm256_add_epi16(_mm256_srai_epi16(s, 8), _mm256_set1_epi16(128));
+}
+
+
+IGTL_TARGET_AVX2
+static inline __m256i CoefficientPair_AVX2(short a, short b)
+{
+  return _mm256_setr_epi16(a, b, a, b, a, b, a, b, a, b, a, b, a, b, a, b);
+}
+
+
+// Same as RGBFromYUV16() for 16 pixels. The unpack and pack instructions
+// work within 128-bit lanes, so the pixel order is preserved.
+IGTL_TARGET_AVX2
+static inline void RGBFromYUV16_AVX2(__m256i y, __m256i u, __m256i v, __m256i* r, __m256i* g, __m256i* b)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i yvLo = _mm256_unpacklo_epi16(y, v);
+  const __m256i yvHi = _mm256_unpackhi_epi16(y, v);
+  const __m256i yuLo = _mm256_unpacklo_epi16(y, u);
+  const __m256i yuHi = _mm256_unpackhi_epi16(y, u);
+  const __m256i v0Lo = _mm256_unpacklo_epi16(v, zero);
+  const __m256i v0Hi = _mm256_unpackhi_epi16(v, zero);
+
+  const __m256i kR  = CoefficientPair_AVX2(298, 409);
+  const __m256i kG  = CoefficientPair_AVX2(298, -100);
+  const __m256i kGV = CoefficientPair_AVX2(-208, 0);
+  const __m256i kB  = CoefficientPair_AVX2(298, 517);
+
+  *r = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_madd_epi16(yvLo, kR), 8),
+                          _mm256_srai_epi32(_mm256_madd_epi16(yvHi, kR), 8));
+  *g = _mm256_packs_epi32(
+         _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, kG), _mm256_madd_epi16(v0Lo, kGV)), 8),
+         _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, kG), _mm256_madd_epi16(v0Hi, kGV)), 8));
+  *b = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_madd_epi16(yuLo, kB), 8),
+                          _mm256_srai_epi32(_mm256_madd_epi16(yuHi, kB), 8));
+}
+
+
+// Packs two registers of 16 pixels in 16-bit lanes to 32 bytes in pixel order.
+IGTL_TARGET_AVX2
+static inline __m256i PackUint8_AVX2(__m256i a, __m256i b)
+{
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+
+IGTL_TARGET_AVX2
+static void RGBToI420Row_AVX2(const igtlUint8* rgb, igtlUint8* y, igtlUint8* u, igtlUint8* v,
+                              int x, int width)
+{
+  const __m256i evenMask = _mm256_set1_epi16(0x00FF);
+
+  for (; x + 32 <= width; x += 32)
+    {
+    __m128i r0, g0, b0, r1, g1, b1;
+    DeinterleaveRGB(rgb + 3 * x, &r0, &g0, &b0);
+    DeinterleaveRGB(rgb + 3 * x + 48, &r1, &g1, &b1);
+
+    __m256i ya = LumaFromRGB16_AVX2(_mm256_cvtepu8_epi16(r0), _mm256_cvtepu8_epi16(g0), _mm256_cvtepu8_epi16(b0));
+    __m256i yb = LumaFromRGB16_AVX2(_mm256_cvtepu8_epi16(r1), _mm256_cvtepu8_epi16(g1), _mm256_cvtepu8_epi16(b1));
+    _mm256_storeu_si256((__m256i*)(y + x), PackUint8_AVX2(ya, yb));
+
+    if (u)
+      {
+      // The 16-bit lanes hold the even pixels 0, 2, ... 30 in order.
+      const __m256i re = _mm256_and_si256(_mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1), evenMask);
+      const __m256i ge = _mm256_and_si256(_mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1), evenMask);
+      const __m256i be = _mm256_and_si256(_mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1), evenMask);
+      __m256i cu = ChromaFromRGB16_AVX2(re, ge, be, -38, -74, 112);
+      __m256i cv = ChromaFromRGB16_AVX2(re, ge, be, 112, -94, -18);
+      _mm_storeu_si128((__m128i*)(u + x / 2), _mm256_castsi256_si128(PackUint8_AVX2(cu, cu)));
+      _mm_storeu_si128((__m128i*)(v + x / 2), _mm256_castsi256_si128(PackUint8_AVX2(cv, cv)));
+      }
+    }
+  // Avoid the AVX-SSE transition penalty in the non-VEX SSSE3 code.
+  _mm256_zeroupper();
+  RGBToI420Row_SSSE3(rgb, y, u, v, x, width);
+}
+
+
+IGTL_TARGET_AVX2
+static void I420ToRGBRow_AVX2(const igtlUint8* y, const igtlUint8* u, const igtlUint8* v,
+                              igtlUint8* rgb, int x, int width)
+{
+  const __m256i k16  = _mm256_set1_epi16(16);
+  const __m256i k128 = _mm256_set1_epi16(128);
+
+  for (; x + 32 <= width; x += 32)
+    {
+    const __m128i y0 = _mm_loadu_si128((const __m128i*)(y + x));
+    const __m128i y1 = _mm_loadu_si128((const __m128i*)(y + x + 16));
+    const __m128i uu = _mm_loadu_si128((const __m128i*)(u + x / 2));
+    const __m128i vv = _mm_loadu_si128((const __m128i*)(v + x / 2));
+
+    __m256i ra, ga, ba, rb, gb, bb;
+    RGBFromYUV16_AVX2(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y0), k16),
+                      _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(uu, uu)), k128),
+                      _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(vv, vv)), k128),
+                      &ra, &ga, &ba);
+    RGBFromYUV16_AVX2(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y1), k16),
+                      _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(uu, uu)), k128),
+                      _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(vv, vv)), k128),
+                      &rb, &gb, &bb);
+
+    const __m256i r = PackUint8_AVX2(ra, rb);
+    const __m256i g = PackUint8_AVX2(ga, gb);
+    const __m256i b = PackUint8_AVX2(ba, bb);
+    InterleaveRGB(_mm256_castsi256_si128(r), _mm256_castsi256_si128(g), _mm256_castsi256_si128(b),
+                  rgb + 3 * x);
+    InterleaveRGB(_mm256_extracti128_si256(r, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(b, 1),
+                  rgb + 3 * x + 48);
+    }
+  // Avoid the AVX-SSE transition penalty in the non-VEX SSSE3 code.
+  _mm256_zeroupper();
+  I420ToRGBRow_SSSE3(y, u, v, rgb, x, width);
+}
+
+
+static const ColorConversionKernels AVX2Kernels =
+{
+  RGBToI420Row_AVX2,
+  I420ToRGBRow_AVX2,
+  GrayToRGBRow_SSSE3  // Limited by the shuffles; nothing to gain from AVX2
+};
+
+#endif // OpenIGTLink_HAVE_AVX2
+
+
+//-----------------------------------------------------------------------------
+// CPU feature detection. CPUID can be expensive (e.g. trapped by a
+// hypervisor), so each feature is queried once. Called with
+// ColorConversionLock held.
+
+static void ColorConversionCPUID(unsigned int leaf, unsigned int* ebx, unsigned int* ecx)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, (int)leaf, 0);
+  *ebx = (unsigned int)info[1];
+  *ecx = (unsigned int)info[2];
+#else
+  unsigned int eax, edx;
+  if ((unsigned int)__get_cpuid_max(0, NULL) < leaf)
+    {
+    *ebx = *ecx = 0;
+    return;
+    }
+  __cpuid_count(leaf, 0, eax, *ebx, *ecx, edx);
+#endif
+}
+
+
+static int CPUSupportsSSSE3()
+{
+  static int supported = -1;
+  if (supported < 0)
+    {
+    unsigned int ebx, ecx;
+    ColorConversionCPUID(1, &ebx, &ecx);
+    // ECX bit 9: SSSE3
+    supported = (ecx & (1U << 9)) ? 1 : 0;
+    }
+  return supported;
+}
+
+
+static int CPUSupportsAVX2()
+{
+  static int supported = -1;
+  if (supported < 0)
+    {
+    supported = 0;
+    unsigned int ebx, ecx;
+    ColorConversionCPUID(1, &ebx, &ecx);
+    // ECX bit 27: OSXSAVE, bit 28: AVX. The OS must also save the YMM
+    // registers (XCR0 bits 1 and 2).
+    if ((ecx & (1U << 27)) && (ecx & (1U << 28)))
+      {
+#if defined(_MSC_VER)
+      unsigned long long xcr0 = _xgetbv(0);
+#else
+      unsigned int xcr0Lo, xcr0Hi;
+      __asm__ __volatile__ ("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+      unsigned long long xcr0 = xcr0Lo;
+#endif
+      if ((xcr0 & 6) == 6)
+        {
+        ColorConversionCPUID(7, &ebx, &ecx);
+        // EBX bit 5: AVX2
+        supported = (ebx & (1U << 5)) ? 1 : 0;
+        }
+      }
+    }
+  return supported;
+}
+
+#endif // OpenIGTLink_HAVE_SSSE3
+
+
+//-----------------------------------------------------------------------------
+// Dispatch
+
+// The selection is guarded by ColorConversionLock, so that the first
+// conversions started from several threads select the kernels only once.
+static SimpleMutexLock ColorConversionLock;
+static int ColorConversionImplementation = -1;
+static const ColorConversionKernels* ColorConversionKernelSet = &ScalarKernels;
+static int ColorConversionNumberOfThreads = 1;
+
+// Frames with fewer pixels are converted by the calling thread.
+static const int ColorConversionMinimumParallelSize = 256 * 256;
+
+
+static int SelectColorConversionImplementation(int impl)
+{
+  if (impl == COLOR_CONVERSION_AUTO)
+    {
+    impl = COLOR_CONVERSION_AVX2;
+    }
+
+#if defined(OpenIGTLink_HAVE_SSSE3)
+  if (impl == COLOR_CONVERSION_AVX2)
+    {
+#if defined(OpenIGTLink_HAVE_AVX2)
+    if (CPUSupportsAVX2())
+      {
+      ColorConversionKernelSet = &AVX2Kernels;
+      ColorConversionImplementation = COLOR_CONVERSION_AVX2;
+      return ColorConversionImplementation;
+      }
+#endif
+    impl = COLOR_CONVERSION_SSSE3;
+    }
+  if (impl == COLOR_CONVERSION_SSSE3 && CPUSupportsSSSE3())
+    {
+    ColorConversionKernelSet = &SSSE3Kernels;
+    ColorConversionImplementation = COLOR_CONVERSION_SSSE3;
+    return ColorConversionImplementation;
+    }
+#endif
+
+  ColorConversionKernelSet = &ScalarKernels;
+  ColorConversionImplementation = COLOR_CONVERSION_SCALAR;
+  return ColorConversionImplementation;
+}
+
+
+int SetColorConversionImplementation(int impl)
+{
+  ColorConversionLock.Lock();
+  impl = SelectColorConversionImplementation(impl);
+  ColorConversionLock.Unlock();
+  return impl;
+}
+
+
+int GetColorConversionImplementation()
+{
+  ColorConversionLock.Lock();
+  if (ColorConversionImplementation < 0)
+    {
+    SelectColorConversionImplementation(COLOR_CONVERSION_AUTO);
+    }
+  int impl = ColorConversionImplementation;
+  ColorConversionLock.Unlock();
+  return impl;
+}
+
+
+void SetColorConversionNumberOfThreads(int numberOfThreads)
+{
+  ColorConversionLock.Lock();
+  ColorConversionNumberOfThreads = numberOfThreads > 1 ? numberOfThreads : 1;
+  ColorConversionLock.Unlock();
+}
+
+
+int GetColorConversionNumberOfThreads()
+{
+  ColorConversionLock.Lock();
+  int numberOfThreads = ColorConversionNumberOfThreads;
+  ColorConversionLock.Unlock();
+  return numberOfThreads;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frame conversion
+
+enum {
+  RGB_TO_I420,
+  I420_TO_RGB,
+  I420_TO_GRAY_RGB
+};
+
+struct ColorConversionJob
+{
+  int                           Type;
+  const igtlUint8*              Source;
+  igtlUint8*                    Destination;
+  int                           Width;
+  int                           Height;
+  int                           NumberOfBands;
+  const ColorConversionKernels* Kernels;
+};
+
+
+// Converts rows [begin, end). 'begin' must be even, so that each band starts
+// with the row that carries the chroma.
+static void ConvertColorRows(const ColorConversionJob* job, int begin, int end)
+{
+  const int width = job->Width;
+  const size_t planeSize = (size_t)width * job->Height;
+  const size_t chromaWidth = width / 2;
+
+  for (int row = begin; row < end; row ++)
+    {
+    const size_t chromaOffset = planeSize + chromaWidth * (row / 2);
+    switch (job->Type)
+      {
+      case RGB_TO_I420:
+        {
+        igtlUint8* i420 = job->Destination;
+        bool chroma = !(row & 1);
+        job->Kernels->RGBToI420(job->Source + (size_t)3 * width * row,
+                                i420 + (size_t)width * row,
+                                chroma ? i420 + chromaOffset : NULL,
+                                chroma ? i420 + chromaOffset + planeSize / 4 : NULL,
+                                0, width);
+        break;
+        }
+      case I420_TO_RGB:
+        job->Kernels->I420ToRGB(job->Source + (size_t)width * row,
+                                job->Source + chromaOffset,
+                                job->Source + chromaOffset + planeSize / 4,
+                                job->Destination + (size_t)3 * width * row,
+                                0, width);
+        break;
+      default:
+        job->Kernels->GrayToRGB(job->Source + (size_t)width * row,
+                                job->Destination + (size_t)3 * width * row,
+                                0, width);
+        break;
+      }
+    }
+}
+
+
+// Converts the bands [begin, end) of 'NumberOfBands' bands of whole row pairs.
+static void ConvertColorBands(void* ptr, igtlInt64 begin, igtlInt64 end)
+{
+  ColorConversionJob* job = static_cast<ColorConversionJob*>(ptr);
+
+  const int pairs = (job->Height + 1) / 2;
+  const int numberOfBands = job->NumberOfBands;
+  int first = 2 * (int)((long long)pairs * begin / numberOfBands);
+  int last = 2 * (int)((long long)pairs * end / numberOfBands);
+  if (last > job->Height)
+    {
+    last = job->Height;
+    }
+  ConvertColorRows(job, first, last);
+}
+
+
+static void ConvertColorFrame(int type, const igtlUint8* source, igtlUint8* destination, int width, int height)
+{
+  if (width <= 0 || height <= 0)
+    {
+    return;
+    }
+
+  // Taken once per frame, so the lock does not show in the conversion time.
+  ColorConversionLock.Lock();
+  if (ColorConversionImplementation < 0)
+    {
+    SelectColorConversionImplementation(COLOR_CONVERSION_AUTO);
+    }
+  const ColorConversionKernels* kernels = ColorConversionKernelSet;
+  int numberOfThreads = ColorConversionNumberOfThreads;
+  ColorConversionLock.Unlock();
+
+  ColorConversionJob job;
+  job.Type          = type;
+  job.Source        = source;
+  job.Destination   = destination;
+  job.Width         = width;
+  job.Height        = height;
+  job.NumberOfBands = 1;
+  job.Kernels       = kernels;
+
+  if (numberOfThreads > height / 2)
+    {
+    numberOfThreads = height / 2;
+    }
+  if (numberOfThreads <= 1 || (long long)width * height < ColorConversionMinimumParallelSize)
+    {
+    ConvertColorRows(&job, 0, height);
+    return;
+    }
+
+  job.NumberOfBands = numberOfThreads;
+  TaskExecutor::GetGlobalExecutor()->ParallelFor(0, numberOfThreads, &ConvertColorBands, &job);
+}
+
+
+void ConvertRGBToI420(const igtlUint8* rgb, igtlUint8* i420, int width, int height)
+{
+  ConvertColorFrame(RGB_TO_I420, rgb, i420, width, height);
+}
+
+
+void ConvertI420ToRGB(const igtlUint8* i420, igtlUint8* rgb, int width, int height)
+{
+  ConvertColorFrame(I420_TO_RGB, i420, rgb, width, height);
+}
+
+
+void ConvertI420ToGrayRGB(const igtlUint8* i420, igtlUint8* rgb, int width, int height)
+{
+  ConvertColorFrame(I420_TO_GRAY_RGB, i420, rgb, width, height);
+}
+
+} // namespace igtl
@@ -0,0 +1,63 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlColorConversion_h
+#define __igtlColorConversion_h
+
+#include "igtlWin32Header.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+/// Implementations of the color conversion kernels. All implementations
+/// produce identical output; they only differ in speed.
+enum {
+  COLOR_CONVERSION_AUTO = 0,  ///< The fastest implementation supported by the CPU
+  COLOR_CONVERSION_SCALAR,    ///< Portable C++
+  COLOR_CONVERSION_SSSE3,     ///< x86 SSSE3, 16 pixels per iteration
+  COLOR_CONVERSION_AVX2       ///< x86 AVX2, 32 pixels per iteration
+};
+
+/// Selects the kernels used by the functions below. If the CPU or the compiler
+/// does not support 'impl', the fastest supported implementation is selected.
+/// Returns the selected implementation.
+int IGTLCommon_EXPORT SetColorConversionImplementation(int impl);
+
+/// Returns the implementation in use (never COLOR_CONVERSION_AUTO).
+int IGTLCommon_EXPORT GetColorConversionImplementation();
+
+/// Sets the number of threads used to convert a frame. The rows of the frame
+/// are split into bands, which are converted concurrently by the workers of
+/// igtl::TaskExecutor::GetGlobalExecutor().
+/// Frames smaller than 256x256 pixels are always converted by the calling thread.
+/// The default is 1.
+void IGTLCommon_EXPORT SetColorConversionNumberOfThreads(int numberOfThreads);
+int  IGTLCommon_EXPORT GetColorConversionNumberOfThreads();
+
+/// Converts a frame of packed 8-bit RGB to I420 (the Y plane followed by the U
+/// and V planes at half resolution) with the fixed-point formulas documented
+/// in GenericDecoder. The chroma of each 2x2 block is taken from its top-left
+/// pixel. 'width' and 'height' must be even.
+void IGTLCommon_EXPORT ConvertRGBToI420(const igtlUint8* rgb, igtlUint8* i420, int width, int height);
+
+/// Converts an I420 frame to packed 8-bit RGB. 'width' and 'height' must be even.
+void IGTLCommon_EXPORT ConvertI420ToRGB(const igtlUint8* i420, igtlUint8* rgb, int width, int height);
+
+/// Copies the Y plane of an I420 frame to all three channels of packed 8-bit RGB.
+void IGTLCommon_EXPORT ConvertI420ToGrayRGB(const igtlUint8* i420, igtlUint8* rgb, int width, int height);
+
+} // namespace igtl
+
+#endif // __igtlColorConversion_h
@@ -44,6 +44,7 @@
  */
 
 #include "igtlH264Decoder.h"
+#include "igtlNALUnitScanner.h"
 
 namespace igtl {
 
@@ -152,18 +153,15 @@ int H264Decoder::DecodeBitStreamIntoFrame(unsigned char* kpH264BitStream,igtl_ui
   
   unsigned long long uiTimeStamp = 0;
   igtl_int64 iStart = 0, iEnd = 0, iTotal = 0;
-  igtl_int32 iSliceSize;
   igtl_int32 iSliceIndex = 0;
   igtl_uint32 iWidth = dimensions[0];
   igtl_uint32 iHeight = dimensions[1];
-  unsigned char* pBuf = NULL;
-  unsigned char uiStartCode[4] = {0, 0, 0, 1};
+  const unsigned char* pSlice = NULL;
+  igtl_uint64 iSliceSize = 0;
   
   unsigned char* pData[3] = {NULL};
   SBufferInfo sDstBufInfo;
   
-  igtl_int32 iBufPos = 0;
-  igtl_int32 i = 0;
   igtl_int32 iFrameCount = 0;
   igtl_int32 iEndOfStreamFlag = 0;
   //for coverage test purpose
@@ -175,38 +173,23 @@ int H264Decoder::DecodeBitStreamIntoFrame(unsigned char* kpH264BitStream,igtl_ui
   if (iStreamSize <= 0)
     {
     //fprintf (stderr, "Current Bit Stream File is too small, read error!!!!\n");
-    goto label_exit;
+    return -1;
     }
-  pBuf = new unsigned char[iStreamSize + 5];
-  if (pBuf == NULL)
-    {
-    //fprintf (stderr, "new buffer failed!\n");
-    goto label_exit;
-    }
-  memcpy (pBuf, kpH264BitStream, iStreamSize);
-  memcpy (pBuf + iStreamSize, &uiStartCode[0], 4); //confirmed_safe_unsafe_usage
   
+  // The slices are passed to the decoder directly from the bitstream; each
+  // one starts at a start code and ends at the next one.
+  NALUnitScanner scanner(kpH264BitStream, iStreamSize);
   while (true)
     {
-    if (iBufPos >= iStreamSize)
+    if (!scanner.GetNextNALUnit(&pSlice, &iSliceSize))
       {
       iEndOfStreamFlag = true;
       if (iEndOfStreamFlag)
         pDecoder->SetOption (DECODER_OPTION_END_OF_STREAM, (void*)&iEndOfStreamFlag);
       break;
       }
-    for (i = 0; i < iStreamSize; i++)
-      {
-      if ((pBuf[iBufPos + i] == 0 && pBuf[iBufPos + i + 1] == 0 && pBuf[iBufPos + i + 2] == 0 && pBuf[iBufPos + i + 3] == 1
-           && i > 0) || (pBuf[iBufPos + i] == 0 && pBuf[iBufPos + i + 1] == 0 && pBuf[iBufPos + i + 2] == 1 && i > 0))
-        {
-        break;
-        }
-      }
-    iSliceSize = i;
     if (iSliceSize < 4)
       { //too small size, no effective data, ignore
-        iBufPos += iSliceSize;
         continue;
       }
     
@@ -219,9 +202,9 @@ int H264Decoder::DecodeBitStreamIntoFrame(unsigned char* kpH264BitStream,igtl_ui
     sDstBufInfo.uiInBsTimeStamp = uiTimeStamp;
     sDstBufInfo.UsrData.sSystemBuffer.iWidth =
 #ifndef NO_DELAY_DECODING
-    pDecoder->DecodeFrameNoDelay (pBuf + iBufPos, iSliceSize, pData, &sDstBufInfo);
+    pDecoder->DecodeFrameNoDelay (pSlice, (int)iSliceSize, pData, &sDstBufInfo);
 #else
-    pDecoder->DecodeFrame2 (pBuf + iBufPos, iSliceSize, pData, &sDstBufInfo);
+    pDecoder->DecodeFrame2 (pSlice, (int)iSliceSize, pData, &sDstBufInfo);
 #endif
     
     iEnd    = getCurrentTime();
@@ -259,15 +242,8 @@ int H264Decoder::DecodeBitStreamIntoFrame(unsigned char* kpH264BitStream,igtl_ui
       {
       dElapsed = iTotal / 1e6;
       }
-    iBufPos += iSliceSize;
     ++ iSliceIndex;
     }
-  // coverity scan uninitial
-label_exit:
-  if (pBuf) {
-    delete[] pBuf;
-    pBuf = NULL;
-  }
   if (iFrameCount)
     {
     return 2;
@@ -0,0 +1,90 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlNALUnitScanner.h"
+
+#include <string.h>
+
+namespace igtl
+{
+
+const igtlUint8* FindNALStartCode(const igtlUint8* begin, const igtlUint8* end,
+                                  int* startCodeLength)
+{
+  if (end - begin < 3)
+    {
+    return end;
+    }
+
+  // Every start code ends with 0x01, which is rare in entropy-coded data, so
+  // memchr() skips most of the stream and only the candidates are checked.
+  const igtlUint8* p = begin + 2;
+  while (p < end)
+    {
+    p = static_cast<const igtlUint8*>(memchr(p, 0x01, end - p));
+    if (p == NULL)
+      {
+      break;
+      }
+    if (p[-1] == 0 && p[-2] == 0)
+      {
+      int length = (p - begin >= 3 && p[-3] == 0) ? 4 : 3;
+      if (startCodeLength)
+        {
+        *startCodeLength = length;
+        }
+      return p + 1 - length;
+      }
+    // The two bytes before the next candidate must be zero, so neither of
+    // the next two bytes can be one.
+    p += 3;
+    }
+  return end;
+}
+
+
+NALUnitScanner::NALUnitScanner(const igtlUint8* stream, igtlUint64 size)
+{
+  this->m_Position = stream;
+  this->m_End = stream + size;
+}
+
+
+bool NALUnitScanner::GetNextNALUnit(const igtlUint8** unit, igtlUint64* size)
+{
+  if (this->m_Position >= this->m_End)
+    {
+    return false;
+    }
+  // The unit starts at the current position and ends at the next start code
+  // after its own, so that a 4-byte start code is kept in one piece.
+  const igtlUint8* p = this->m_Position;
+  igtlUint64 left = this->m_End - p;
+  int startCodeLength = 0;
+  if (left >= 4 && p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1)
+    {
+    startCodeLength = 4;
+    }
+  else if (left >= 3 && p[0] == 0 && p[1] == 0 && p[2] == 1)
+    {
+    startCodeLength = 3;
+    }
+  const igtlUint8* next = FindNALStartCode(p + (startCodeLength ? startCodeLength : 1), this->m_End, NULL);
+  *unit = this->m_Position;
+  *size = next - this->m_Position;
+  this->m_Position = next;
+  return true;
+}
+
+} // namespace igtl
@@ -0,0 +1,52 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlNALUnitScanner_h
+#define __igtlNALUnitScanner_h
+
+#include "igtlWin32Header.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+/// Finds the first Annex B start code (00 00 01, or 00 00 00 01) that begins
+/// in [begin, end). Returns a pointer to the first byte of the start code and
+/// stores its length (3 or 4) in 'startCodeLength', or returns 'end' if the
+/// range contains no start code. The bytes are never copied; the search is
+/// done with memchr(), which the C library vectorizes.
+IGTLCommon_EXPORT const igtlUint8* FindNALStartCode(const igtlUint8* begin, const igtlUint8* end,
+                                                     int* startCodeLength);
+
+/// NALUnitScanner splits an H.264 or H.265 Annex B byte stream, e.g. the
+/// bitstream of a VideoMessage, into NAL units in place. Each unit starts at
+/// a start code and extends to the next start code or to the end of the
+/// stream, which is the form expected by the decoders.
+class IGTLCommon_EXPORT NALUnitScanner
+{
+public:
+  NALUnitScanner(const igtlUint8* stream, igtlUint64 size);
+
+  /// Gets the next NAL unit, including its start code. Returns false when
+  /// the end of the stream has been reached.
+  bool GetNextNALUnit(const igtlUint8** unit, igtlUint64* size);
+
+private:
+  const igtlUint8* m_Position;
+  const igtlUint8* m_End;
+};
+
+} // namespace igtl
+
+#endif // __igtlNALUnitScanner_h
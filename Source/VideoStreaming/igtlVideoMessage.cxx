@@ -241,6 +241,10 @@ namespace igtl {
 
     igtl_frame_convert_byte_order(frame_header);
 
+    // The frame header is followed by the bit stream, which has been written
+    // by the encoder; feed both to the CRC.
+    UpdateContentCRC(this->m_FrameHeader, CalculateContentBufferSize());
+
   #if OpenIGTLink_HEADER_VERSION >= 2
     if (m_HeaderVersion == IGTL_HEADER_VERSION_2)
       {
@@ -67,15 +67,25 @@ void* ThreadFunctionReadSocket(void* ptr)
   static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
   
   ReadSocketAndPush parentObj = *(static_cast<ReadSocketAndPush*>(info->UserData));
-  unsigned char UDPPacket[RTP_PAYLOAD_LENGTH+RTP_HEADER_LENGTH];
+  // Read the packets that are queued in the socket with one call and push them together.
+  const int packetSize = RTP_PAYLOAD_LENGTH+RTP_HEADER_LENGTH;
+  std::vector<unsigned char> buffer(PacketBatchMaximumNum*packetSize);
+  unsigned char* UDPPackets[PacketBatchMaximumNum];
+  int packetLengths[PacketBatchMaximumNum];
+  for (int i = 0; i < PacketBatchMaximumNum; i++)
+    {
+    UDPPackets[i] = &buffer[i*packetSize];
+    }
   while(1)
     {
-    int totMsgLen = parentObj.clientSocket->ReadSocket(UDPPacket, RTP_PAYLOAD_LENGTH+RTP_HEADER_LENGTH);
-    
-    WriteTimeInfo(UDPPacket, totMsgLen, parentObj.receiver);
-    if (totMsgLen>0)
+    int numberOfPackets = parentObj.clientSocket->ReadSocketBatch(UDPPackets, packetSize, packetLengths, PacketBatchMaximumNum);
+    if (numberOfPackets>0)
       {
-      parentObj.wrapper->PushDataIntoPacketBuffer(UDPPacket, totMsgLen);
+      for (int i = 0; i < numberOfPackets; i++)
+        {
+        WriteTimeInfo(UDPPackets[i], packetLengths[i], parentObj.receiver);
+        }
+      parentObj.wrapper->PushDataIntoPacketBuffer(UDPPackets, packetLengths, numberOfPackets);
       }
     }
 }
@@ -13,10 +13,43 @@
 
 #include "igtlVideoStreamIGTLinkServer.h"
 
+#include <algorithm>
+
+// Number of raw frames and packed messages that can be pending between the threads.
+#define IGTL_VIDEO_INCOMING_FRAME_SLOTS 4
+#define IGTL_VIDEO_ENCODED_FRAME_SLOTS  6
+
 namespace igtl {
 
 static void* ThreadFunctionServer(void* ptr);
 
+/// State of a stream added with AddVideoStream().
+struct VideoStreamIGTLinkServer::VideoStream
+{
+  std::string              name;
+  GenericEncoder*          encoder;
+  SourcePicture            picture;
+  bool                     isGrayImage;
+  igtl_uint64              frameSize;
+  
+  /// Raw I420 frames stamped with the capture time in nanoseconds.
+  igtl::FrameRingBuffer    rawFrames;
+  
+  /// Packed video messages stamped with the capture time of their frame.
+  igtl::FrameRingBuffer    encodedFrames;
+  
+  /// Set while the stream is in readyStreams or being encoded. Guarded by streamLock.
+  bool                     scheduled;
+  
+  igtl_uint32              messageID;
+  igtl_uint64              numberOfSentFrames;
+  igtl_uint64              numberOfDroppedFrames;
+  
+  /// Clocks of the producer and of the encoding thread.
+  igtl::TimeStamp::Pointer captureTimer;
+  igtl::TimeStamp::Pointer encodeTimer;
+};
+
 VideoStreamIGTLinkServer::VideoStreamIGTLinkServer(char *argv)
 {
   this->videoEncoder = NULL;
@@ -33,12 +66,11 @@ VideoStreamIGTLinkServer::VideoStreamIGTLinkServer(char *argv)
   this->socket = igtl::Socket::New();;
   this->conditionVar = igtl::ConditionVariable::New();
   this->glock = igtl::SimpleMutexLock::New();
-  this->glockInFrame = igtl::SimpleMutexLock::New();
   this->threader = igtl::MultiThreader::New();
   this->rtpWrapper = igtl::MessageRTPWrapper::New();
   this->ServerTimer = igtl::TimeStamp::New();
-  this->incommingFrames.clear();
-  this->encodedFrames.clear();
+  this->incommingFrames.Allocate(IGTL_VIDEO_INCOMING_FRAME_SLOTS, 0);
+  this->encodedFrames.Allocate(IGTL_VIDEO_ENCODED_FRAME_SLOTS, 0);
   this->netWorkBandWidth = 10000; // in Kbps
   this->interval = 30; //in ms
   this->transportMethod = UseTCP;
@@ -47,6 +79,10 @@ VideoStreamIGTLinkServer::VideoStreamIGTLinkServer(char *argv)
   this->sendPacketThreadID = -1;
   this->readFrameThreadID = -1;
   this->serverThreadID = -1;
+  this->streamReady = igtl::ConditionVariable::New();
+  this->streamFrameEncoded = igtl::ConditionVariable::New();
+  this->streamThreadsRunning = false;
+  this->numberOfEncodingThreads = 0;
   this->augments = std::string(argv);
   if(this->augments.c_str())
     {
@@ -54,6 +90,15 @@ VideoStreamIGTLinkServer::VideoStreamIGTLinkServer(char *argv)
     }
 }
 
+VideoStreamIGTLinkServer::~VideoStreamIGTLinkServer()
+{
+  this->StopVideoStreamThreads();
+  for (size_t i = 0; i < this->videoStreams.size(); i ++)
+    {
+    delete this->videoStreams[i];
+    }
+}
+
 int VideoStreamIGTLinkServer::SetEncoder(GenericEncoder* encoder)
 {
   this->videoEncoder = encoder;
@@ -478,7 +523,7 @@ static void* ThreadFunctionReadFrameFromFile(void* ptr)
     }
 #endif
     igtl_int32 iFrameIdx = 0;
-    while((igtl_int32)parentObj.server->iTotalFrameToEncode > 0)
+    while((igtl_int32)parentObj.server->iTotalFrameToEncode > 0 && !parentObj.server->incommingFrames.IsClosed())
       {
       iFrameIdx = 0;
 #if defined(_WIN32) || defined(_WIN64)
@@ -492,18 +537,12 @@ static void* ThreadFunctionReadFrameFromFile(void* ptr)
 #endif
       while (iFrameIdx < iFrameNumInFile && iFrameIdx < parentObj.server->iTotalFrameToEncode) {
         bool bCanBeRead = false;
-        igtl_uint8* pYUV = new igtl_uint8[kiPicResSize];
+        // Read the frame directly into a free slot; the oldest frame is dropped if the encoder falls behind.
+        igtl_uint8* pYUV = parentObj.server->incommingFrames.BeginWrite(kiPicResSize);
+        if (pYUV == NULL)
+          break; // stopped
         bCanBeRead = (fread (pYUV, 1, kiPicResSize, pFileYUV) == kiPicResSize);
-        parentObj.server->glockInFrame->Lock();
-        if (parentObj.server->incommingFrames.size()>3)
-          {
-          std::map<igtlUint32, igtl_uint8*>::iterator it = parentObj.server->incommingFrames.begin();
-          delete it->second;
-          it->second = NULL;
-          parentObj.server->incommingFrames.erase(it);
-          }
-        parentObj.server->incommingFrames.insert(std::pair<igtl_uint32, igtl_uint8*>(0, pYUV));
-        parentObj.server->glockInFrame->Unlock();
+        parentObj.server->incommingFrames.EndWrite(kiPicResSize);
         parentObj.server->iTotalFrameToEncode = parentObj.server->iTotalFrameToEncode - 1; // excluding skipped frame time
         igtl::Sleep(parentObj.server->interval);
         if (!bCanBeRead)
@@ -519,6 +558,8 @@ static void* ThreadFunctionReadFrameFromFile(void* ptr)
     fprintf (stderr, "Unable to open source sequence file (%s), check corresponding path!\n",
              parentObj.server->strSeqFile.c_str());
   }
+  // Let the consumer finish the pending frames and return.
+  parentObj.server->incommingFrames.Close();
   
   return NULL;
 }
@@ -530,42 +571,39 @@ static void* ThreadFunctionSendPacket(void* ptr)
   igtl::MultiThreader::ThreadInfo* info =
   static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
   serverPointer parentObj = *(static_cast<serverPointer*>(info->UserData));
-  while(1)
+  igtl_uint64 messageDataLength = 0;
+  igtl_uint8* messagePackPointer = NULL;
+  // Sleeps until a message is queued; returns NULL once the server is stopped.
+  while((messagePackPointer = parentObj.server->encodedFrames.BeginRead(&messageDataLength)) != NULL)
     {
-    parentObj.server->glock->Lock();
-    unsigned int frameNum = parentObj.server->encodedFrames.size();
-    parentObj.server->glock->Unlock();
-    if(frameNum)
+    parentObj.server->SendPackedMessage(messagePackPointer, messageDataLength);
+    parentObj.server->encodedFrames.EndRead();
+    }
+  return NULL;
+}
+
+void VideoStreamIGTLinkServer::SendPackedMessage(igtl_uint8* messagePackPointer, igtl_uint64 messageDataLength)
+{
+  this->glock->Lock();
+  if (this->transportMethod == VideoStreamIGTLinkServer::UseUDP)
+    {
+    this->rtpWrapper->WrapMessageAndSend(this->serverUDPSocket, messagePackPointer, (int)messageDataLength);
+    }
+  else if(this->transportMethod == VideoStreamIGTLinkServer::UseTCP)
+    {
+    if(this->socket)
       {
-      parentObj.server->glock->Lock();
-      VideoStreamIGTLinkServer::encodedFrame* frameCopy = new VideoStreamIGTLinkServer::encodedFrame();
-      std::map<igtlUint32, VideoStreamIGTLinkServer::encodedFrame*>::iterator it = parentObj.server->encodedFrames.begin();
-      frameCopy->messageDataLength = it->second->messageDataLength;
-      memcpy(frameCopy->messagePackPointer,it->second->messagePackPointer,it->second->messageDataLength);
-      delete it->second;
-      it->second = NULL;
-      parentObj.server->encodedFrames.erase(it);
-      if (parentObj.server->transportMethod == VideoStreamIGTLinkServer::UseUDP)
-        {
-        parentObj.server->rtpWrapper->WrapMessageAndSend(parentObj.server->serverUDPSocket, frameCopy->messagePackPointer, frameCopy->messageDataLength);
-        }
-      else if(parentObj.server->transportMethod == VideoStreamIGTLinkServer::UseTCP)
-        {
-        if(parentObj.server->socket)
-          {
-          parentObj.server->socket->Send(frameCopy->messagePackPointer, frameCopy->messageDataLength);
-          }
-        }
-      parentObj.server->glock->Unlock();
-      delete frameCopy;
+      this->socket->Send(messagePackPointer, (int)messageDataLength);
       }
-    igtl::Sleep(1);
     }
+  this->glock->Unlock();
 }
 
 int VideoStreamIGTLinkServer::StartReadFrameThread(int frameRate)
 {
   this->interval = 1000/frameRate;
+  int kiPicResSize = pSrcPic->picWidth*pSrcPic->picHeight*3>>1;
+  this->incommingFrames.Allocate(IGTL_VIDEO_INCOMING_FRAME_SLOTS, kiPicResSize);
   serverPointer ptr;
   ptr.server = this;
   readFrameThreadID = threader->SpawnThread((igtl::ThreadFunctionType)&ThreadFunctionReadFrameFromFile, &ptr);
@@ -575,6 +613,11 @@ int VideoStreamIGTLinkServer::StartReadFrameThread(int frameRate)
 
 int VideoStreamIGTLinkServer::StartSendPacketThread()
 {
+  if (this->encodedFrames.IsClosed())
+    {
+    // Restarted after Stop()
+    this->encodedFrames.Allocate(IGTL_VIDEO_ENCODED_FRAME_SLOTS, 0);
+    }
   serverPointer ptr;
   ptr.server = this;
   sendPacketThreadID = threader->SpawnThread((igtl::ThreadFunctionType)&ThreadFunctionSendPacket, &ptr);
@@ -582,64 +625,53 @@ int VideoStreamIGTLinkServer::StartSendPacketThread()
   return sendPacketThreadID;
 }
 
-void VideoStreamIGTLinkServer::CheckEncodedFrameMap()
+void VideoStreamIGTLinkServer::QueueEncodedFrame(igtl::MessageBase* message)
 {
-  if(this->encodedFrames.size()>5)
+  igtl_uint64 messageDataLength = message->GetBufferSize();
+  // Drops the oldest pending message if the sending thread falls behind.
+  igtl_uint8* messagePackPointer = this->encodedFrames.BeginWrite(messageDataLength);
+  if (messagePackPointer)
     {
-    std::map<igtlUint32, VideoStreamIGTLinkServer::encodedFrame*>::iterator it = this->encodedFrames.begin();
-    delete it->second;
-    it->second = NULL;
-    this->encodedFrames.erase(it);
+    memcpy(messagePackPointer, message->GetPackPointer(), messageDataLength);
+    this->encodedFrames.EndWrite(messageDataLength);
     }
 }
 
 void VideoStreamIGTLinkServer::SendOriginalData()
 {
   int kiPicResSize = pSrcPic->picWidth*pSrcPic->picHeight*3>>1;
-  igtl_uint8* pYUV = new igtl_uint8[kiPicResSize];
   static int messageID = -1;
-  while(this->iTotalFrameToEncode)
+  // Checking the pending frames after the counter reaches zero makes sure the last frame is sent.
+  while(this->iTotalFrameToEncode || this->incommingFrames.GetNumberOfFrames())
     {
-    this->glockInFrame->Lock();
-    int frameNum = this->incommingFrames.size();
-    this->glockInFrame->Unlock();
-    while(frameNum)
+    // Sleeps until the reading thread has queued a frame.
+    igtl_uint64 frameSize = 0;
+    igtl_uint8* pYUV = this->incommingFrames.BeginRead(&frameSize, 100);
+    if (pYUV == NULL)
       {
-      this->glockInFrame->Lock();
-      std::map<igtlUint32, igtl_uint8*>::iterator it = this->incommingFrames.begin();
-      memcpy(pYUV,it->second,kiPicResSize);
-      delete it->second;
-      it->second = NULL;
-      this->incommingFrames.erase(it);
-      frameNum = this->incommingFrames.size();
-      this->glockInFrame->Unlock();
-      messageID ++;
-      igtl::VideoMessage::Pointer videoMsg;
-      videoMsg = igtl::VideoMessage::New();
-      videoMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
-      videoMsg->SetDeviceName(this->deviceName.c_str());
-      videoMsg->SetBitStreamSize(kiPicResSize);
-      videoMsg->AllocateScalars();
-      int endian = (igtl_is_little_endian() == 1 ? IGTL_VIDEO_ENDIAN_LITTLE : IGTL_VIDEO_ENDIAN_BIG);
-      videoMsg->SetEndian(endian); //little endian is 2 big endian is 1
-      videoMsg->SetWidth(pSrcPic->picWidth);
-      videoMsg->SetHeight(pSrcPic->picHeight);
-      videoMsg->SetMessageID(messageID);
-      memcpy(videoMsg->GetPackFragmentPointer(2), pYUV, kiPicResSize);
-      ServerTimer->GetTime();
-      videoMsg->SetTimeStamp(ServerTimer);
-      videoMsg->Pack();
-      encodedFrame* frame = new encodedFrame();
-      memcpy(frame->messagePackPointer, videoMsg->GetPackPointer(), videoMsg->GetBufferSize());
-      frame->messageDataLength = videoMsg->GetBufferSize();
-      this->glock->Lock();
-      this->CheckEncodedFrameMap();
-      this->encodedFrames.insert(std::pair<igtlUint32, VideoStreamIGTLinkServer::encodedFrame*>(messageID, frame));
-      this->glock->Unlock();
+      if (this->incommingFrames.IsClosed())
+        break;
+      continue;
       }
+    messageID ++;
+    igtl::VideoMessage::Pointer videoMsg;
+    videoMsg = igtl::VideoMessage::New();
+    videoMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+    videoMsg->SetDeviceName(this->deviceName.c_str());
+    videoMsg->SetBitStreamSize(kiPicResSize);
+    videoMsg->AllocateScalars();
+    int endian = (igtl_is_little_endian() == 1 ? IGTL_VIDEO_ENDIAN_LITTLE : IGTL_VIDEO_ENDIAN_BIG);
+    videoMsg->SetEndian(endian); //little endian is 2 big endian is 1
+    videoMsg->SetWidth(pSrcPic->picWidth);
+    videoMsg->SetHeight(pSrcPic->picHeight);
+    videoMsg->SetMessageID(messageID);
+    memcpy(videoMsg->GetPackFragmentPointer(2), pYUV, kiPicResSize);
+    this->incommingFrames.EndRead();
+    ServerTimer->GetTime();
+    videoMsg->SetTimeStamp(ServerTimer);
+    videoMsg->Pack();
+    this->QueueEncodedFrame(videoMsg);
     }
-  delete[] pYUV;
-  pYUV = NULL;
 }
 
 int VideoStreamIGTLinkServer::EncodeFile(void)
@@ -659,67 +691,62 @@ int VideoStreamIGTLinkServer::EncodeFile(void)
   igtl_int32 iFrameIdx = 0;
   this->totalCompressedDataSize = 0;
   int iActualFrameEncodedCount = 0;
-  while(this->iTotalFrameToEncode)
+  while(this->iTotalFrameToEncode || this->incommingFrames.GetNumberOfFrames())
     {
-    this->glockInFrame->Lock();
-    int frameNum = this->incommingFrames.size();
-    this->glockInFrame->Unlock();
-    while(frameNum)
+    // Sleeps until the reading thread has queued a frame.
+    igtl_uint64 frameSize = 0;
+    igtl_uint8* pYUV = this->incommingFrames.BeginRead(&frameSize, 100);
+    if (pYUV == NULL)
       {
-      // To encoder this frame
-      this->glockInFrame->Lock();
-      std::map<igtlUint32, igtl_uint8*>::iterator it = this->incommingFrames.begin();
-      memcpy(this->pSrcPic->data[0],it->second,picSize*3/2);
-      delete it->second;
-      it->second = NULL;
-      this->incommingFrames.erase(it);
-      frameNum = this->incommingFrames.size();
-      this->glockInFrame->Unlock();
-      this->ServerTimer->GetTime();
-      this->encodeStartTime = this->ServerTimer->GetTimeStampInNanoseconds();
-      iStart = this->encodeStartTime;
-      igtl::VideoMessage::Pointer videoMsg = igtl::VideoMessage::New();
-      videoMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
-      videoMsg->SetDeviceName(this->deviceName.c_str());
-      int iEncFrames = this->videoEncoder->EncodeSingleFrameIntoVideoMSG(this->pSrcPic, videoMsg, false);
-      this->ServerTimer->GetTime();
-      this->encodeEndTime = this->ServerTimer->GetTimeStampInNanoseconds();
-      iTotal += this->encodeEndTime - iStart;
-      ++ iFrameIdx;
-      if (this->videoEncoder->GetVideoFrameType() == FrameTypeSkip) {
-        continue;
-      }
-      
-      if (iEncFrames == ResultSuccess ) {
-        static int messageID = -1;
-        messageID++;
-        this->totalCompressedDataSize += videoMsg->GetPackedBitStreamSize();
-        encodedFrame* frame = new encodedFrame();
-        memcpy(frame->messagePackPointer, videoMsg->GetPackPointer(), videoMsg->GetBufferSize());
-        frame->messageDataLength = videoMsg->GetBufferSize();
-        this->glock->Lock();
-        this->CheckEncodedFrameMap();
-        this->encodedFrames.insert(std::pair<igtlUint32, VideoStreamIGTLinkServer::encodedFrame*>(messageID, frame));
-        this->glock->Unlock();
-        igtl::Sleep(5);
-        iActualFrameEncodedCount ++;
-      } else {
-        fprintf (stderr, "EncodeFrame(), ret: %d, frame index: %d.\n", iEncFrames, iFrameIdx);
-      }
-      if (iActualFrameEncodedCount%10 == 0) {
-        double dElapsed = iTotal / 1e9;
-        float totalFrameSize = iActualFrameEncodedCount*3/2.0*this->pSrcPic->picWidth*this->pSrcPic->picHeight;
-        printf ("Width:\t\t%d\nHeight:\t\t%d\nFrames:\t\t%d\nencode time:\t%f sec\nFPS:\t\t%f fps\nCompressionRate:\t\t%f\n",
-                this->pSrcPic->picWidth, this->pSrcPic->picHeight,
-                iActualFrameEncodedCount, dElapsed, (iActualFrameEncodedCount * 1.0) / dElapsed, totalCompressedDataSize/totalFrameSize);
-      }
+      if (this->incommingFrames.IsClosed())
+        break;
+      continue;
       }
+    // To encoder this frame
+    memcpy(this->pSrcPic->data[0],pYUV,picSize*3/2);
+    this->incommingFrames.EndRead();
+    this->ServerTimer->GetTime();
+    this->encodeStartTime = this->ServerTimer->GetTimeStampInNanoseconds();
+    iStart = this->encodeStartTime;
+    igtl::VideoMessage::Pointer videoMsg = igtl::VideoMessage::New();
+    videoMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+    videoMsg->SetDeviceName(this->deviceName.c_str());
+    int iEncFrames = this->videoEncoder->EncodeSingleFrameIntoVideoMSG(this->pSrcPic, videoMsg, false);
+    this->ServerTimer->GetTime();
+    this->encodeEndTime = this->ServerTimer->GetTimeStampInNanoseconds();
+    iTotal += this->encodeEndTime - iStart;
+    ++ iFrameIdx;
+    if (this->videoEncoder->GetVideoFrameType() == FrameTypeSkip) {
+      continue;
+    }
+    
+    if (iEncFrames == ResultSuccess ) {
+      static int messageID = -1;
+      messageID++;
+      this->totalCompressedDataSize += videoMsg->GetPackedBitStreamSize();
+      this->QueueEncodedFrame(videoMsg);
+      iActualFrameEncodedCount ++;
+    } else {
+      fprintf (stderr, "EncodeFrame(), ret: %d, frame index: %d.\n", iEncFrames, iFrameIdx);
+    }
+    if (iActualFrameEncodedCount%10 == 0) {
+      double dElapsed = iTotal / 1e9;
+      float totalFrameSize = iActualFrameEncodedCount*3/2.0*this->pSrcPic->picWidth*this->pSrcPic->picHeight;
+      printf ("Width:\t\t%d\nHeight:\t\t%d\nFrames:\t\t%d\nencode time:\t%f sec\nFPS:\t\t%f fps\nCompressionRate:\t\t%f\n",
+              this->pSrcPic->picWidth, this->pSrcPic->picHeight,
+              iActualFrameEncodedCount, dElapsed, (iActualFrameEncodedCount * 1.0) / dElapsed, totalCompressedDataSize/totalFrameSize);
+    }
     }
   return 0;
 }
 
 void VideoStreamIGTLinkServer::Stop()
 {
+  // Wake up the reading, encoding and sending threads so that they return.
+  this->iTotalFrameToEncode = 0;
+  this->incommingFrames.Close();
+  this->encodedFrames.Close();
+  this->StopVideoStreamThreads();
   if(serverThreadID>=0)
     threader->TerminateThread(serverThreadID);
   if(readFrameThreadID>=0)
@@ -746,5 +773,297 @@ int VideoStreamIGTLinkServer::EncodeSingleFrame(igtl_uint8* picPointer, bool isG
   return encodeRet;
 }
 
+int VideoStreamIGTLinkServer::AddVideoStream(const std::string& name, GenericEncoder* encoder, int width, int height, bool isGrayImage)
+{
+  if (encoder == NULL || width <= 0 || height <= 0 || this->streamThreadsRunning)
+    {
+    return -1;
+    }
+  VideoStream* stream = new VideoStream;
+  stream->name = name;
+  stream->encoder = encoder;
+  stream->isGrayImage = isGrayImage;
+  stream->frameSize = (igtl_uint64)width * height * 3 / 2;
+  memset(&stream->picture, 0, sizeof(SourcePicture));
+  stream->picture.colorFormat = FormatI420;
+  stream->picture.picWidth = width;
+  stream->picture.picHeight = height;
+  stream->picture.stride[0] = width;
+  stream->picture.stride[1] = stream->picture.stride[2] = width >> 1;
+  stream->rawFrames.Allocate(IGTL_VIDEO_INCOMING_FRAME_SLOTS, stream->frameSize);
+  stream->encodedFrames.Allocate(IGTL_VIDEO_ENCODED_FRAME_SLOTS, 0);
+  stream->scheduled = false;
+  stream->messageID = 0;
+  stream->numberOfSentFrames = 0;
+  stream->numberOfDroppedFrames = 0;
+  stream->captureTimer = igtl::TimeStamp::New();
+  stream->encodeTimer = igtl::TimeStamp::New();
+  this->videoStreams.push_back(stream);
+  return (int)this->videoStreams.size() - 1;
+}
+
+int VideoStreamIGTLinkServer::GetNumberOfVideoStreams()
+{
+  return (int)this->videoStreams.size();
+}
+
+int VideoStreamIGTLinkServer::GetVideoStreamIndex(const std::string& name)
+{
+  for (size_t i = 0; i < this->videoStreams.size(); i ++)
+    {
+    if (this->videoStreams[i]->name == name)
+      {
+      return (int)i;
+      }
+    }
+  return -1;
+}
+
+int VideoStreamIGTLinkServer::PushFrame(int index, const igtl_uint8* frame)
+{
+  if (index < 0 || index >= (int)this->videoStreams.size())
+    {
+    return -1;
+    }
+  VideoStream* stream = this->videoStreams[index];
+  stream->captureTimer->GetTime();
+  igtl_uint64 captureTime = stream->captureTimer->GetTimeStampInNanoseconds();
+  // Drops the oldest pending frame if the encoders fall behind.
+  igtl_uint8* slot = stream->rawFrames.BeginWrite(stream->frameSize);
+  if (slot == NULL)
+    {
+    return -1; // stopped
+    }
+  memcpy(slot, frame, stream->frameSize);
+  stream->rawFrames.EndWrite(stream->frameSize, captureTime);
+  
+  // Hand the stream to an encoding thread unless one already has it. A thread that
+  // finishes a frame checks for pending frames under the same lock, so no frame is missed.
+  this->streamLock.Lock();
+  if (!stream->scheduled)
+    {
+    stream->scheduled = true;
+    this->readyStreams.push_back(stream);
+    this->streamReady->Signal();
+    }
+  this->streamLock.Unlock();
+  return 0;
+}
+
+void VideoStreamIGTLinkServer::SetNumberOfEncodingThreads(int numberOfThreads)
+{
+  this->numberOfEncodingThreads = numberOfThreads > 0 ? numberOfThreads : 0;
+}
+
+int VideoStreamIGTLinkServer::GetNumberOfEncodingThreads()
+{
+  return this->numberOfEncodingThreads;
+}
+
+int VideoStreamIGTLinkServer::StartVideoStreamThreads()
+{
+  if (this->streamThreadsRunning || this->videoStreams.empty())
+    {
+    return -1;
+    }
+  int numberOfThreads = this->numberOfEncodingThreads;
+  if (numberOfThreads == 0)
+    {
+    numberOfThreads = std::min((int)this->videoStreams.size(),
+                               igtl::MultiThreader::GetGlobalDefaultNumberOfThreads());
+    }
+  numberOfThreads = std::max(numberOfThreads, 1);
+  
+  // Restarted after Stop()
+  for (size_t i = 0; i < this->videoStreams.size(); i ++)
+    {
+    VideoStream* stream = this->videoStreams[i];
+    if (stream->rawFrames.IsClosed())
+      {
+      stream->numberOfDroppedFrames += stream->rawFrames.GetNumberOfDroppedFrames()
+        + stream->encodedFrames.GetNumberOfDroppedFrames();
+      stream->rawFrames.Allocate(IGTL_VIDEO_INCOMING_FRAME_SLOTS, stream->frameSize);
+      stream->encodedFrames.Allocate(IGTL_VIDEO_ENCODED_FRAME_SLOTS, 0);
+      stream->scheduled = false;
+      }
+    }
+  this->readyStreams.clear();
+  
+  this->streamThreadsRunning = true;
+  for (int i = 0; i < numberOfThreads; i ++)
+    {
+    this->streamThreadIDs.push_back(threader->SpawnThread((igtl::ThreadFunctionType)&ThreadFunctionEncodeStreams, this));
+    }
+  this->streamThreadIDs.push_back(threader->SpawnThread((igtl::ThreadFunctionType)&ThreadFunctionSendStreams, this));
+  return numberOfThreads;
+}
+
+void VideoStreamIGTLinkServer::StopVideoStreamThreads()
+{
+  this->streamLock.Lock();
+  this->streamThreadsRunning = false;
+  for (size_t i = 0; i < this->videoStreams.size(); i ++)
+    {
+    this->videoStreams[i]->rawFrames.Close();
+    this->videoStreams[i]->encodedFrames.Close();
+    }
+  this->streamReady->Broadcast();
+  this->streamFrameEncoded->Broadcast();
+  this->streamLock.Unlock();
+  for (size_t i = 0; i < this->streamThreadIDs.size(); i ++)
+    {
+    threader->TerminateThread(this->streamThreadIDs[i]);
+    }
+  this->streamThreadIDs.clear();
+}
+
+igtl_uint64 VideoStreamIGTLinkServer::GetNumberOfSentFrames(int index)
+{
+  if (index < 0 || index >= (int)this->videoStreams.size())
+    {
+    return 0;
+    }
+  this->streamLock.Lock();
+  igtl_uint64 sent = this->videoStreams[index]->numberOfSentFrames;
+  this->streamLock.Unlock();
+  return sent;
+}
+
+igtl_uint64 VideoStreamIGTLinkServer::GetNumberOfDroppedFrames(int index)
+{
+  if (index < 0 || index >= (int)this->videoStreams.size())
+    {
+    return 0;
+    }
+  VideoStream* stream = this->videoStreams[index];
+  return stream->numberOfDroppedFrames + stream->rawFrames.GetNumberOfDroppedFrames()
+    + stream->encodedFrames.GetNumberOfDroppedFrames();
+}
+
+void VideoStreamIGTLinkServer::EncodeStreamFrame(VideoStream* stream)
+{
+  igtl_uint64 frameSize = 0;
+  igtl_uint64 captureTime = 0;
+  igtl_uint8* pYUV = stream->rawFrames.BeginRead(&frameSize, 1, &captureTime);
+  if (pYUV == NULL)
+    {
+    return;
+    }
+  
+  // The encoder reads the frame in place.
+  int picSize = stream->picture.picWidth * stream->picture.picHeight;
+  stream->picture.data[0] = pYUV;
+  stream->picture.data[1] = pYUV + picSize;
+  stream->picture.data[2] = stream->picture.data[1] + (picSize >> 2);
+  stream->picture.timeStamp = (long long)(captureTime / 1000000);
+  
+  igtl::VideoMessage::Pointer videoMsg = igtl::VideoMessage::New();
+  videoMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  videoMsg->SetDeviceName(stream->name.c_str());
+  videoMsg->SetMessageID(stream->messageID ++);
+  stream->encodeTimer->SetTimeInNanoseconds(captureTime);
+  videoMsg->SetTimeStamp(stream->encodeTimer);
+  int iEncFrames = stream->encoder->EncodeSingleFrameIntoVideoMSG(&stream->picture, videoMsg, stream->isGrayImage);
+  stream->rawFrames.EndRead();
+  
+  if (iEncFrames != ResultSuccess || stream->encoder->GetVideoFrameType() == FrameTypeSkip)
+    {
+    return;
+    }
+  igtl_uint64 messageDataLength = videoMsg->GetBufferSize();
+  // Drops the oldest pending message of the stream if the send thread falls behind.
+  igtl_uint8* messagePackPointer = stream->encodedFrames.BeginWrite(messageDataLength);
+  if (messagePackPointer)
+    {
+    memcpy(messagePackPointer, videoMsg->GetPackPointer(), messageDataLength);
+    stream->encodedFrames.EndWrite(messageDataLength, captureTime);
+    this->streamLock.Lock();
+    this->streamFrameEncoded->Signal();
+    this->streamLock.Unlock();
+    }
+}
+
+void* VideoStreamIGTLinkServer::ThreadFunctionEncodeStreams(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info =
+  static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  VideoStreamIGTLinkServer* server = static_cast<VideoStreamIGTLinkServer*>(info->UserData);
+  
+  server->streamLock.Lock();
+  while (server->streamThreadsRunning)
+    {
+    if (server->readyStreams.empty())
+      {
+      server->streamReady->Wait(&server->streamLock);
+      continue;
+      }
+    VideoStream* stream = server->readyStreams.front();
+    server->readyStreams.pop_front();
+    server->streamLock.Unlock();
+    
+    // One frame at a time, so that the threads are shared fairly between the streams.
+    server->EncodeStreamFrame(stream);
+    
+    server->streamLock.Lock();
+    if (stream->rawFrames.GetNumberOfFrames() > 0)
+      {
+      server->readyStreams.push_back(stream);
+      }
+    else
+      {
+      stream->scheduled = false;
+      }
+    }
+  server->streamLock.Unlock();
+  return NULL;
+}
+
+void* VideoStreamIGTLinkServer::ThreadFunctionSendStreams(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info =
+  static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  VideoStreamIGTLinkServer* server = static_cast<VideoStreamIGTLinkServer*>(info->UserData);
+  
+  server->streamLock.Lock();
+  while (server->streamThreadsRunning)
+    {
+    // The streams are interleaved by capture time: the oldest encoded frame is sent first.
+    VideoStream* next = NULL;
+    igtl_uint64 oldest = 0;
+    for (size_t i = 0; i < server->videoStreams.size(); i ++)
+      {
+      igtl_uint64 captureTime;
+      if (server->videoStreams[i]->encodedFrames.GetOldestTimeStamp(&captureTime) &&
+          (next == NULL || captureTime < oldest))
+        {
+        next = server->videoStreams[i];
+        oldest = captureTime;
+        }
+      }
+    if (next == NULL)
+      {
+      server->streamFrameEncoded->Wait(&server->streamLock);
+      continue;
+      }
+    server->streamLock.Unlock();
+    
+    igtl_uint64 messageDataLength = 0;
+    igtl_uint8* messagePackPointer = next->encodedFrames.BeginRead(&messageDataLength, 1);
+    if (messagePackPointer)
+      {
+      server->SendPackedMessage(messagePackPointer, messageDataLength);
+      next->encodedFrames.EndRead();
+      }
+    
+    server->streamLock.Lock();
+    if (messagePackPointer)
+      {
+      next->numberOfSentFrames ++;
+      }
+    }
+  server->streamLock.Unlock();
+  return NULL;
+}
+
 }//namespace igtl
 
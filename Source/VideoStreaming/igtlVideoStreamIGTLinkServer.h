@@ -27,6 +27,8 @@
 #include <fstream>
 #include <cstring>
 #include <string>
+#include <vector>
+#include <deque>
 #include <cmath>
 #include <stdlib.h>
 #include "igtl_header.h"
@@ -38,6 +40,7 @@
 #include "igtlUDPServerSocket.h"
 #include "igtlMultiThreader.h"
 #include "igtlConditionVariable.h"
+#include "igtlFrameRingBuffer.h"
 #include "igtlMessageRTPWrapper.h"
 #include "igtlTimeStamp.h"
 #include "igtlCodecCommonClasses.h"
@@ -48,7 +51,7 @@ class IGTLCommon_EXPORT VideoStreamIGTLinkServer
 {
 public:
   VideoStreamIGTLinkServer(char *argv);
-  ~VideoStreamIGTLinkServer(){};
+  ~VideoStreamIGTLinkServer();
   
   /**
    Start the server, this function will be holding the main program for a client connection.
@@ -97,6 +100,11 @@ public:
    */
   void SendOriginalData();
   
+  /**
+   Send a packed message over the transport of the server (a UDP or TCP socket).
+   */
+  void SendPackedMessage(igtl_uint8* messagePackPointer, igtl_uint64 messageDataLength);
+  
   /**
    Set the server to wait for STT command or just send the bitstream when connection is setup.
    */
@@ -134,8 +142,6 @@ public:
   
   igtl::MultiThreader::Pointer threader;
   
-  igtl::SimpleMutexLock* glockInFrame;
-  
   igtl::SimpleMutexLock* glock;
   
   igtl::Socket::Pointer socket;
@@ -194,19 +200,17 @@ public:
   
   igtl::TimeStamp::Pointer ServerTimer;
   
-  class encodedFrame
-  {
-  public:
-    encodedFrame(){messageDataLength = 0;};
-    encodedFrame(encodedFrame const &anotherFrame){};
-    ~encodedFrame(){};
-    unsigned char messagePackPointer[RTP_PAYLOAD_LENGTH*(16384-2)];  // we use 14 bits for fragment number, 2^14 = 16384. maximum
-    igtl_uint32 messageDataLength;
-  };
-  
-  std::map<igtlUint32, igtl_uint8*> incommingFrames;
+  /**
+   Raw I420 frames passed from the frame reading thread to EncodeFile() or SendOriginalData().
+   The oldest frame is dropped when more than four frames are pending.
+   */
+  igtl::FrameRingBuffer incommingFrames;
   
-  std::map<igtlUint32, encodedFrame*> encodedFrames;
+  /**
+   Packed video messages passed to the packet sending thread.
+   The oldest message is dropped when more than six messages are pending.
+   */
+  igtl::FrameRingBuffer encodedFrames;
   
   int iTotalFrameToEncode;
   
@@ -214,9 +218,91 @@ public:
   
   int StartReadFrameThread(int frameRate);
   
+  /**
+   Add a named video stream. Several sources (e.g. endoscopes and ultrasound probes) can be
+   served by one server: each stream has its own encoder, which must be initialized for frames
+   of width x height pixels, and its own queues of raw and encoded frames. The server does not
+   take ownership of the encoder. Streams must be added before StartVideoStreamThreads() is
+   called. Returns the index of the stream, or -1 on failure.
+   */
+  int AddVideoStream(const std::string& name, GenericEncoder* encoder, int width, int height, bool isGrayImage = false);
+  
+  int GetNumberOfVideoStreams();
+  
+  /**
+   Get the index of the stream with the given name, or -1 if there is none.
+   */
+  int GetVideoStreamIndex(const std::string& name);
+  
+  /**
+   Queue an I420 frame of a stream for encoding. The frame is copied and stamped with the current
+   time. If the encoders fall behind, the oldest pending frame of the stream is dropped. Frames of
+   one stream must be pushed from one thread; different streams can be fed from different threads.
+   Returns 0 on success, or -1 if the stream does not exist or the server has been stopped.
+   */
+  int PushFrame(int stream, const igtl_uint8* frame);
+  
+  /**
+   Set the number of threads that encode the streams. A stream is encoded by one thread at a time,
+   so more threads than streams do not help. The default (0) uses one thread per stream, up to the
+   number of processors.
+   */
+  void SetNumberOfEncodingThreads(int numberOfThreads);
+  int GetNumberOfEncodingThreads();
+  
+  /**
+   Start the encoding threads and the thread that sends the encoded frames of all streams. The
+   send thread always sends the oldest encoded frame (by capture time) of all streams next.
+   */
+  int StartVideoStreamThreads();
+  
+  /**
+   Get the number of frames of a stream that have been sent, and the number of frames dropped
+   because the encoders or the send thread fell behind.
+   */
+  igtl_uint64 GetNumberOfSentFrames(int stream);
+  igtl_uint64 GetNumberOfDroppedFrames(int stream);
+  
 private:
   
-  void CheckEncodedFrameMap();
+  struct VideoStream;
+  
+  /**
+   Encode the next frame of a stream and queue the message for the send thread. Called by
+   the encoding threads.
+   */
+  void EncodeStreamFrame(VideoStream* stream);
+  
+  void StopVideoStreamThreads();
+  
+  static void* ThreadFunctionEncodeStreams(void* ptr);
+  
+  static void* ThreadFunctionSendStreams(void* ptr);
+  
+  std::vector<VideoStream*> videoStreams;
+  
+  /**
+   Streams with pending raw frames that are not being encoded, in the order they became ready.
+   */
+  std::deque<VideoStream*> readyStreams;
+  
+  igtl::SimpleMutexLock streamLock;
+  
+  igtl::ConditionVariable::Pointer streamReady;
+  
+  igtl::ConditionVariable::Pointer streamFrameEncoded;
+  
+  bool streamThreadsRunning;
+  
+  int numberOfEncodingThreads;
+  
+  std::vector<int> streamThreadIDs;
+  
+  
+  /**
+   Copy a packed message into the ring of messages to be sent.
+   */
+  void QueueEncodedFrame(igtl::MessageBase* message);
   
   void ReadInFileWithFrameRate(int rate);
   
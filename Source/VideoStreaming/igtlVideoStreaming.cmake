@@ -6,6 +6,8 @@ LIST(APPEND OpenIGTLink_SOURCES
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoStreamIGTLinkServer.cxx
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoStreamIGTLinkReceiver.cxx
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlCodecCommonClasses.cxx
+  ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlColorConversion.cxx
+  ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlNALUnitScanner.cxx
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoMetaMessage.cxx
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlI420Decoder.cxx
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlI420Encoder.cxx
@@ -20,6 +22,8 @@ LIST(APPEND OpenIGTLink_INCLUDE_FILES
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoStreamIGTLinkServer.h
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoStreamIGTLinkReceiver.h
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlCodecCommonClasses.h
+  ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlColorConversion.h
+  ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlNALUnitScanner.h
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlVideoMetaMessage.h
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlI420Decoder.h
   ${PROJECT_SOURCE_DIR}/Source/VideoStreaming/igtlI420Encoder.h
@@ -0,0 +1,280 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlAsyncSendQueue.h"
+#include "igtlSocket.h"
+
+#include <string.h>
+#include <vector>
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+AsyncSendQueue::AsyncSendQueue()
+{
+  this->m_Socket = NULL;
+  this->m_MaxBatchMessages = 0;
+  this->m_MaxBatchSize = 0;
+  this->m_ProducerClock = TimeStamp::New();
+  this->m_Threader = MultiThreader::New();
+  this->m_ThreadID = -1;
+  this->m_Running = false;
+  this->m_Discard = false;
+  this->m_Failed = false;
+  this->m_StatisticsStartTime = 0;
+  this->m_DroppedBeforeReset = 0;
+  memset(&this->m_Statistics, 0, sizeof(AsyncSendStatistics));
+}
+
+
+//-----------------------------------------------------------------------------
+AsyncSendQueue::~AsyncSendQueue()
+{
+  this->Stop(false);
+}
+
+
+//-----------------------------------------------------------------------------
+int AsyncSendQueue::Start(Socket* socket, int queueSize, int policy, igtl_uint64 maxBatchSize)
+{
+  if (this->m_Running || socket == NULL)
+    {
+    return -1;
+    }
+
+  this->m_Socket = socket;
+  // The slots grow to the size of the largest message queued in them.
+  this->m_Ring.Allocate(queueSize > 1 ? queueSize : 2, 0, policy);
+  this->m_MaxBatchMessages = queueSize > 1 ? queueSize : 2;
+  this->m_MaxBatchSize = maxBatchSize;
+  this->m_Discard = false;
+  this->m_Failed = false;
+  this->ResetStatistics();
+
+  this->m_Running = true;
+  this->m_ThreadID = this->m_Threader->SpawnThread((ThreadFunctionType) &AsyncSendQueue::ThreadFunction, this);
+  if (this->m_ThreadID < 0)
+    {
+    this->m_Running = false;
+    this->m_Ring.Close();
+    return -1;
+    }
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+int AsyncSendQueue::Enqueue(const void* const* fragments, const int* lengths, int numberOfFragments)
+{
+  igtl_uint64 size = 0;
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    size += lengths[i] > 0 ? lengths[i] : 0;
+    }
+
+  this->m_ProducerLock.Lock();
+  igtl_uint8* slot = this->m_Running ? this->m_Ring.BeginWrite(size) : NULL;
+  if (slot == NULL)
+    {
+    // Stopped, or closed by the I/O thread after a failed send.
+    this->m_ProducerLock.Unlock();
+    return 0;
+    }
+  igtl_uint8* p = slot;
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    if (lengths[i] > 0)
+      {
+      memcpy(p, fragments[i], lengths[i]);
+      p += lengths[i];
+      }
+    }
+  this->m_ProducerClock->GetTime();
+  this->m_Ring.EndWrite(size, this->m_ProducerClock->GetTimeStampInNanoseconds());
+  int queueLength = this->m_Ring.GetNumberOfFrames();
+  this->m_ProducerLock.Unlock();
+
+  this->m_StatisticsLock.Lock();
+  this->m_Statistics.QueuedMessages ++;
+  if (queueLength > this->m_Statistics.MaximumQueueLength)
+    {
+    this->m_Statistics.MaximumQueueLength = queueLength;
+    }
+  this->m_StatisticsLock.Unlock();
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+bool AsyncSendQueue::Flush(unsigned long msec)
+{
+  if (!this->m_Running)
+    {
+    return this->m_Ring.GetNumberOfFrames() == 0;
+    }
+  return this->m_Ring.WaitUntilEmpty(msec) && !this->GetSendFailed();
+}
+
+
+//-----------------------------------------------------------------------------
+void AsyncSendQueue::Stop(bool flush)
+{
+  if (!this->m_Running)
+    {
+    return;
+    }
+  // The I/O thread sends the remaining messages after the ring is closed,
+  // unless they are to be discarded.
+  this->m_StatisticsLock.Lock();
+  this->m_Discard = !flush;
+  this->m_StatisticsLock.Unlock();
+  this->m_Ring.Close();
+  this->m_Threader->TerminateThread(this->m_ThreadID);
+  this->m_ThreadID = -1;
+
+  this->m_ProducerLock.Lock();
+  this->m_Running = false;
+  this->m_ProducerLock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool AsyncSendQueue::GetSendFailed()
+{
+  this->m_StatisticsLock.Lock();
+  bool failed = this->m_Failed;
+  this->m_StatisticsLock.Unlock();
+  return failed;
+}
+
+
+//-----------------------------------------------------------------------------
+void AsyncSendQueue::GetStatistics(AsyncSendStatistics* statistics)
+{
+  TimeStamp::Pointer clock = TimeStamp::New();
+  clock->GetTime();
+  igtl_uint64 dropped = this->m_Ring.GetNumberOfDroppedFrames();
+  int queueLength = this->m_Ring.GetNumberOfFrames();
+
+  this->m_StatisticsLock.Lock();
+  *statistics = this->m_Statistics;
+  statistics->DroppedMessages = dropped - this->m_DroppedBeforeReset;
+  statistics->ElapsedTime = clock->GetTimeStampInNanoseconds() - this->m_StatisticsStartTime;
+  this->m_StatisticsLock.Unlock();
+  statistics->QueueLength = queueLength;
+}
+
+
+//-----------------------------------------------------------------------------
+void AsyncSendQueue::ResetStatistics()
+{
+  TimeStamp::Pointer clock = TimeStamp::New();
+  clock->GetTime();
+
+  this->m_StatisticsLock.Lock();
+  memset(&this->m_Statistics, 0, sizeof(AsyncSendStatistics));
+  this->m_StatisticsStartTime = clock->GetTimeStampInNanoseconds();
+  this->m_DroppedBeforeReset = this->m_Ring.GetNumberOfDroppedFrames();
+  this->m_StatisticsLock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void* AsyncSendQueue::ThreadFunction(void* ptr)
+{
+  MultiThreader::ThreadInfo* info = static_cast<MultiThreader::ThreadInfo*>(ptr);
+  AsyncSendQueue* queue = static_cast<AsyncSendQueue*>(info->UserData);
+  queue->SendLoop();
+  return NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+void AsyncSendQueue::SendLoop()
+{
+  int maxMessages = this->m_MaxBatchMessages;
+  std::vector<igtl_uint8*>  frames(maxMessages);
+  std::vector<igtl_uint64>  sizes(maxMessages);
+  std::vector<igtl_uint64>  timeStamps(maxMessages);
+  std::vector<const void*>  fragments(maxMessages);
+  std::vector<int>          lengths(maxMessages);
+  TimeStamp::Pointer clock = TimeStamp::New();
+
+  while (1)
+    {
+    int n = this->m_Ring.BeginReadFrames(&frames[0], &sizes[0], &timeStamps[0],
+                                         maxMessages, this->m_MaxBatchSize);
+    if (n == 0)
+      {
+      // Closed and drained.
+      break;
+      }
+
+    this->m_StatisticsLock.Lock();
+    bool discard = this->m_Discard;
+    this->m_StatisticsLock.Unlock();
+    if (discard)
+      {
+      this->m_Ring.EndRead();
+      continue;
+      }
+
+    igtl_uint64 bytes = 0;
+    for (int i = 0; i < n; i ++)
+      {
+      fragments[i] = frames[i];
+      lengths[i] = (int)sizes[i];
+      bytes += sizes[i];
+      }
+    int r = this->m_Socket->SendFragmentsDirect(&fragments[0], &lengths[0], n);
+    clock->GetTime();
+    igtl_uint64 now = clock->GetTimeStampInNanoseconds();
+
+    // The statistics and the failure are recorded before the frames are
+    // released, so that Flush() returns after they have been updated.
+    this->m_StatisticsLock.Lock();
+    if (r)
+      {
+      this->m_Statistics.SentMessages += n;
+      this->m_Statistics.SentBytes += bytes;
+      this->m_Statistics.SendCalls ++;
+      for (int i = 0; i < n; i ++)
+        {
+        igtl_uint64 latency = now > timeStamps[i] ? now - timeStamps[i] : 0;
+        this->m_Statistics.TotalLatency += latency;
+        if (latency > this->m_Statistics.MaximumLatency)
+          {
+          this->m_Statistics.MaximumLatency = latency;
+          }
+        }
+      }
+    else
+      {
+      this->m_Failed = true;
+      this->m_Discard = true;
+      }
+    this->m_StatisticsLock.Unlock();
+    this->m_Ring.EndRead();
+
+    if (!r)
+      {
+      // Wakes blocked producers; further messages are rejected and the
+      // queued ones are discarded.
+      this->m_Ring.Close();
+      }
+    }
+}
+
+} // namespace igtl
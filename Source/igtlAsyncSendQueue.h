@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlAsyncSendQueue_h
+#define __igtlAsyncSendQueue_h
+
+#include "igtlWin32Header.h"
+#include "igtlFrameRingBuffer.h"
+#include "igtlMultiThreader.h"
+#include "igtlMutexLock.h"
+#include "igtlTimeStamp.h"
+#include "igtl_types.h"
+
+namespace igtl
+{
+
+class Socket;
+
+/// Counters of an AsyncSendQueue. Latencies are in nanoseconds, measured from
+/// the time a message is queued until the system call that sends it returns.
+struct AsyncSendStatistics
+{
+  /// Messages accepted by the queue.
+  igtl_uint64 QueuedMessages;
+
+  /// Messages handed to the kernel.
+  igtl_uint64 SentMessages;
+
+  /// Messages dropped because the queue was full (DropOldest policy).
+  igtl_uint64 DroppedMessages;
+
+  /// Bytes handed to the kernel.
+  igtl_uint64 SentBytes;
+
+  /// System calls used to send SentMessages; SentMessages / SendCalls is the
+  /// average number of messages coalesced into one call.
+  igtl_uint64 SendCalls;
+
+  /// Sum and maximum of the latencies of the sent messages.
+  igtl_uint64 TotalLatency;
+  igtl_uint64 MaximumLatency;
+
+  /// Time since the queue was started or the statistics were reset, for the
+  /// throughput (SentBytes / ElapsedTime).
+  igtl_uint64 ElapsedTime;
+
+  /// Messages currently queued, and the largest number seen.
+  int         QueueLength;
+  int         MaximumQueueLength;
+};
+
+
+/// AsyncSendQueue sends data over a connected socket from a dedicated I/O
+/// thread, so that the threads producing messages do not wait for a slow
+/// receiver. Enqueue() copies a message into a slot of a FrameRingBuffer and
+/// returns. The I/O thread takes all queued messages, up to a batch size, and
+/// hands them to the kernel with one sendmsg() call (WSASend() on Windows),
+/// the same path as Socket::SendFragments(), so that e.g. 200 Hz TRANSFORM and TDATA streams are
+/// coalesced into few system calls instead of one per message.
+///
+/// When the queue is full, Enqueue() either drops the oldest queued message
+/// that is not being sent (DropOldest) or waits until the I/O thread has sent
+/// a batch (Block). Messages are always sent or dropped as a whole.
+///
+/// The queue is usually created through ClientSocket::StartAsyncSend(), after
+/// which Socket::Send() and SendFragments() enqueue the data.
+class IGTLCommon_EXPORT AsyncSendQueue
+{
+public:
+  enum OverflowPolicy {
+    DropOldest = FrameRingBuffer::DropOldest,
+    Block = FrameRingBuffer::Block
+  };
+
+  AsyncSendQueue();
+
+  /// Stops the I/O thread without sending the queued messages.
+  ~AsyncSendQueue();
+
+  /// Starts the I/O thread sending to 'socket' through a queue of
+  /// 'queueSize' messages. A batch holds as many queued messages as fit in
+  /// 'maxBatchSize' bytes, but at least one. Returns 0 on success, or -1 if
+  /// the queue is running.
+  int Start(Socket* socket, int queueSize, int policy, igtl_uint64 maxBatchSize);
+
+  /// Copies the fragments into the queue as one message. Returns 1 if the
+  /// message has been queued, or 0 if the queue is not running or a send has
+  /// failed.
+  int Enqueue(const void* const* fragments, const int* lengths, int numberOfFragments);
+
+  /// Waits until all queued messages have been sent, up to 'msec' milliseconds
+  /// between two batches (msec=0 implies no timeout). Returns true if the
+  /// queue is empty.
+  bool Flush(unsigned long msec=0);
+
+  /// Stops the I/O thread after sending the queued messages (flush=true) or
+  /// after the batch being sent. A send blocked by the receiver is only
+  /// interrupted by shutting the socket down.
+  void Stop(bool flush);
+
+  bool IsRunning() const { return this->m_Running; }
+
+  /// Returns true if a send has failed; the I/O thread stops at the first
+  /// failure and the queued messages are discarded.
+  bool GetSendFailed();
+
+  void GetStatistics(AsyncSendStatistics* statistics);
+  void ResetStatistics();
+
+protected:
+  static void* ThreadFunction(void* ptr);
+
+  /// Sends batches until the ring is closed and drained, or a send fails.
+  void SendLoop();
+
+  Socket*                m_Socket;
+  FrameRingBuffer        m_Ring;
+  int                    m_MaxBatchMessages;
+  igtl_uint64            m_MaxBatchSize;
+
+  // Serializes producers, since the ring has a single producer side.
+  SimpleMutexLock        m_ProducerLock;
+  TimeStamp::Pointer     m_ProducerClock;
+
+  MultiThreader::Pointer m_Threader;
+  int                    m_ThreadID;
+  bool                   m_Running;
+  bool                   m_Discard;
+
+  SimpleMutexLock        m_StatisticsLock;
+  AsyncSendStatistics    m_Statistics;
+  igtl_uint64            m_StatisticsStartTime;
+  igtl_uint64            m_DroppedBeforeReset;
+  bool                   m_Failed;
+
+private:
+  AsyncSendQueue(const AsyncSendQueue&); // Not implemented.
+  void operator=(const AsyncSendQueue&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlAsyncSendQueue_h
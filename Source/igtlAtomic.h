@@ -0,0 +1,120 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlAtomic_h
+#define __igtlAtomic_h
+
+#include "igtlConfigure.h"
+#include "igtl_types.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// Atomic operations on an int, used where a mutex round-trip per operation
+/// would be too expensive (e.g. the reference count of LightObject).
+/// The library does not require C++11, so the operations map to compiler
+/// intrinsics instead of std::atomic. IGTL_HAVE_ATOMIC_OPERATIONS is not
+/// defined on compilers without intrinsics; callers fall back to a mutex.
+///
+/// AtomicAdd() is a read-modify-write with acquire-release ordering, which
+/// is what reference counting needs: the decrement that drops the count to
+/// zero observes all writes made by other owners before their decrements.
+///
+/// AtomicCounterAdd() and AtomicCounterLoad() operate on 64-bit counters
+/// without ordering constraints. They are meant for statistics that are
+/// read while being updated and do not publish other data.
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define IGTL_HAVE_ATOMIC_OPERATIONS
+#define IGTL_ATOMIC_GCC_BUILTINS
+#elif defined(__clang__)
+#define IGTL_HAVE_ATOMIC_OPERATIONS
+#define IGTL_ATOMIC_GCC_BUILTINS
+#elif defined(_MSC_VER)
+#define IGTL_HAVE_ATOMIC_OPERATIONS
+#define IGTL_ATOMIC_MSVC_INTRINSICS
+#endif
+
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+
+namespace igtl
+{
+
+/// Atomically adds 'value' to '*counter' and returns the new value.
+inline int AtomicAdd(volatile int* counter, int value)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  return __atomic_add_fetch(counter, value, __ATOMIC_ACQ_REL);
+#else
+  // 'long' is 32-bit on Windows. Interlocked operations are full barriers.
+  return (int)_InterlockedExchangeAdd((volatile long*)counter, (long)value) + value;
+#endif
+}
+
+/// Atomically reads '*counter' (acquire).
+inline int AtomicLoad(const volatile int* counter)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+#else
+  return (int)_InterlockedCompareExchange((volatile long*)counter, 0, 0);
+#endif
+}
+
+/// Atomically writes 'value' to '*counter' (release).
+inline void AtomicStore(volatile int* counter, int value)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+#else
+  _InterlockedExchange((volatile long*)counter, (long)value);
+#endif
+}
+
+/// Atomically adds 'value' to the 64-bit counter '*counter' (relaxed).
+inline void AtomicCounterAdd(volatile igtl_uint64* counter, igtl_uint64 value)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+#else
+  _InterlockedExchangeAdd64((volatile __int64*)counter, (__int64)value);
+#endif
+}
+
+/// Atomically reads the 64-bit counter '*counter' (relaxed).
+inline igtl_uint64 AtomicCounterLoad(const volatile igtl_uint64* counter)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#else
+  return (igtl_uint64)_InterlockedCompareExchange64((volatile __int64*)counter, 0, 0);
+#endif
+}
+
+/// Atomically writes 'value' to the 64-bit counter '*counter' (relaxed).
+inline void AtomicCounterStore(volatile igtl_uint64* counter, igtl_uint64 value)
+{
+#if defined(IGTL_ATOMIC_GCC_BUILTINS)
+  __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+#else
+  _InterlockedExchange64((volatile __int64*)counter, (__int64)value);
+#endif
+}
+
+} // namespace igtl
+
+#endif // IGTL_HAVE_ATOMIC_OPERATIONS
+
+#endif // __igtlAtomic_h
@@ -0,0 +1,402 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlBufferAllocator.h"
+
+#include <stdlib.h>
+#include <new>
+
+#ifdef OpenIGTLink_HAVE_MADV_HUGEPAGE
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+  // The default allocator is never deleted, so that messages destroyed
+  // during static destruction can still release their buffers.
+  igtl::BufferAllocator* DefaultAllocator = NULL;
+
+  igtl::SimpleFastMutexLock& GetDefaultAllocatorLock()
+  {
+    static igtl::SimpleFastMutexLock lock;
+    return lock;
+  }
+}
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+BufferAllocator::BufferAllocator()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+BufferAllocator::~BufferAllocator()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned char* BufferAllocator::Allocate(igtlUint64 size, igtlUint64* capacity)
+{
+  unsigned char* buffer = new (std::nothrow) unsigned char[(size_t)size];
+  *capacity = buffer ? size : 0;
+  return buffer;
+}
+
+
+//-----------------------------------------------------------------------------
+void BufferAllocator::Release(unsigned char* buffer, igtlUint64 igtlNotUsed(capacity))
+{
+  delete [] buffer;
+}
+
+
+//-----------------------------------------------------------------------------
+BufferAllocator* BufferAllocator::GetDefault()
+{
+  SimpleFastMutexLock& lock = GetDefaultAllocatorLock();
+  lock.Lock();
+  if (DefaultAllocator == NULL)
+    {
+    BufferAllocator::Pointer allocator = BufferAllocator::New();
+    allocator->Register();
+    DefaultAllocator = allocator;
+    }
+  BufferAllocator* allocator = DefaultAllocator;
+  lock.Unlock();
+  return allocator;
+}
+
+
+//-----------------------------------------------------------------------------
+void BufferAllocator::SetDefault(BufferAllocator* allocator)
+{
+  BufferAllocator::Pointer newAllocator = allocator;
+  if (newAllocator.IsNull())
+    {
+    newAllocator = BufferAllocator::New();
+    }
+
+  SimpleFastMutexLock& lock = GetDefaultAllocatorLock();
+  lock.Lock();
+  BufferAllocator* old = DefaultAllocator;
+  newAllocator->Register();
+  DefaultAllocator = newAllocator;
+  lock.Unlock();
+
+  // Messages still using the previous allocator hold their own reference.
+  if (old)
+    {
+    old->UnRegister();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+PooledBufferAllocator::PooledBufferAllocator()
+{
+  this->m_MaximumPoolSize = 64 * 1024 * 1024;
+  this->m_PoolSize = 0;
+  this->m_UseHugePages = false;
+  this->m_NumberOfHits = 0;
+  this->m_NumberOfMisses = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+PooledBufferAllocator::~PooledBufferAllocator()
+{
+  this->Trim();
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned char* PooledBufferAllocator::Allocate(igtlUint64 size, igtlUint64* capacity)
+{
+  igtlUint64 blockSize;
+  int sizeClass = GetSizeClass(size, &blockSize);
+  if (sizeClass < 0)
+    {
+    *capacity = 0;
+    return NULL;
+    }
+
+  this->m_Mutex.Lock();
+  std::vector<unsigned char*>& freeBlocks = this->m_FreeBlocks[sizeClass];
+  if (!freeBlocks.empty())
+    {
+    unsigned char* block = freeBlocks.back();
+    freeBlocks.pop_back();
+    this->m_PoolSize -= blockSize;
+    this->m_NumberOfHits ++;
+    this->m_Mutex.Unlock();
+    *capacity = blockSize;
+    return block;
+    }
+  this->m_NumberOfMisses ++;
+  this->m_Mutex.Unlock();
+
+  unsigned char* block = this->AllocateBlock(blockSize);
+  *capacity = block ? blockSize : 0;
+  return block;
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::Release(unsigned char* buffer, igtlUint64 capacity)
+{
+  if (buffer == NULL)
+    {
+    return;
+    }
+
+  igtlUint64 blockSize;
+  int sizeClass = GetSizeClass(capacity, &blockSize);
+
+  this->m_Mutex.Lock();
+  if (sizeClass >= 0 && blockSize == capacity &&
+      this->m_PoolSize + blockSize <= this->m_MaximumPoolSize)
+    {
+    this->m_FreeBlocks[sizeClass].push_back(buffer);
+    this->m_PoolSize += blockSize;
+    buffer = NULL;
+    }
+  this->m_Mutex.Unlock();
+
+  if (buffer)
+    {
+    this->FreeBlock(buffer, capacity);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::SetMaximumPoolSize(igtlUint64 size)
+{
+  this->m_Mutex.Lock();
+  this->m_MaximumPoolSize = size;
+  this->ShrinkPool(size);
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 PooledBufferAllocator::GetMaximumPoolSize()
+{
+  this->m_Mutex.Lock();
+  igtlUint64 size = this->m_MaximumPoolSize;
+  this->m_Mutex.Unlock();
+  return size;
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::SetUseHugePages(bool use)
+{
+  this->m_Mutex.Lock();
+  this->m_UseHugePages = use;
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool PooledBufferAllocator::GetUseHugePages()
+{
+  this->m_Mutex.Lock();
+  bool use = this->m_UseHugePages;
+  this->m_Mutex.Unlock();
+  return use;
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 PooledBufferAllocator::GetPoolSize()
+{
+  this->m_Mutex.Lock();
+  igtlUint64 size = this->m_PoolSize;
+  this->m_Mutex.Unlock();
+  return size;
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 PooledBufferAllocator::GetNumberOfHits()
+{
+  this->m_Mutex.Lock();
+  igtlUint64 hits = this->m_NumberOfHits;
+  this->m_Mutex.Unlock();
+  return hits;
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 PooledBufferAllocator::GetNumberOfMisses()
+{
+  this->m_Mutex.Lock();
+  igtlUint64 misses = this->m_NumberOfMisses;
+  this->m_Mutex.Unlock();
+  return misses;
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::ResetCounters()
+{
+  this->m_Mutex.Lock();
+  this->m_NumberOfHits = 0;
+  this->m_NumberOfMisses = 0;
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::Trim()
+{
+  this->m_Mutex.Lock();
+  this->ShrinkPool(0);
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  this->m_Mutex.Lock();
+  os << "Maximum pool size: " << this->m_MaximumPoolSize << std::endl;
+  os << "Pool size: " << this->m_PoolSize << std::endl;
+  os << "Use huge pages: " << (this->m_UseHugePages ? "ON" : "OFF") << std::endl;
+  os << "Number of hits: " << this->m_NumberOfHits << std::endl;
+  os << "Number of misses: " << this->m_NumberOfMisses << std::endl;
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+int PooledBufferAllocator::GetSizeClass(igtlUint64 size, igtlUint64* blockSize)
+{
+  if (size > ((igtlUint64)1 << 62))
+    {
+    return -1;
+    }
+  if (size < MINIMUM_BLOCK_SIZE)
+    {
+    size = MINIMUM_BLOCK_SIZE;
+    }
+
+  // The classes between 2^e and 2^(e+1) are 5/4, 6/4, 7/4 and 8/4 of 2^e.
+  igtlUint64 s = size - 1;
+  int e = 0;
+  while ((s >> e) > 1)
+    {
+    e ++;
+    }
+  int sub = (int)((s >> (e - 2)) & 3);
+  *blockSize = (igtlUint64)(5 + sub) << (e - 2);
+  return e * 4 + sub;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned char* PooledBufferAllocator::AllocateBlock(igtlUint64 blockSize)
+{
+#ifdef OpenIGTLink_HAVE_MADV_HUGEPAGE
+  if (this->GetUseHugePages() && blockSize >= HUGE_PAGE_SIZE)
+    {
+    void* block = NULL;
+    if (posix_memalign(&block, HUGE_PAGE_SIZE, (size_t)blockSize) == 0)
+      {
+      // Only a hint; the block is usable even if the kernel declines.
+      madvise(block, (size_t)blockSize, MADV_HUGEPAGE);
+      return (unsigned char*)block;
+      }
+    }
+#endif
+  // Blocks from posix_memalign() and malloc() are both released by free().
+  return (unsigned char*)malloc((size_t)blockSize);
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::FreeBlock(unsigned char* block, igtlUint64 igtlNotUsed(blockSize))
+{
+  free(block);
+}
+
+
+//-----------------------------------------------------------------------------
+void PooledBufferAllocator::ShrinkPool(igtlUint64 size)
+{
+  for (int i = NUMBER_OF_SIZE_CLASSES - 1; i >= 0 && this->m_PoolSize > size; i --)
+    {
+    std::vector<unsigned char*>& freeBlocks = this->m_FreeBlocks[i];
+    if (freeBlocks.empty())
+      {
+      continue;
+      }
+    igtlUint64 blockSize = (igtlUint64)(5 + i % 4) << (i / 4 - 2);
+    while (!freeBlocks.empty() && this->m_PoolSize > size)
+      {
+      this->FreeBlock(freeBlocks.back(), blockSize);
+      freeBlocks.pop_back();
+      this->m_PoolSize -= blockSize;
+      }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+PinnedBuffer::PinnedBuffer()
+  : m_Buffer(NULL), m_Capacity(0)
+{
+}
+
+
+//-----------------------------------------------------------------------------
+PinnedBuffer::~PinnedBuffer()
+{
+  if (this->m_Buffer != NULL)
+    {
+    this->m_Allocator->Release(this->m_Buffer, this->m_Capacity);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void PinnedBuffer::SetBuffer(BufferAllocator* allocator, unsigned char* buffer, igtlUint64 capacity)
+{
+  if (this->m_Buffer != NULL)
+    {
+    this->m_Allocator->Release(this->m_Buffer, this->m_Capacity);
+    }
+  this->m_Allocator = allocator;
+  this->m_Buffer    = buffer;
+  this->m_Capacity  = capacity;
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned char* PinnedBuffer::TakeBuffer()
+{
+  unsigned char* buffer = this->m_Buffer;
+  this->m_Buffer   = NULL;
+  this->m_Capacity = 0;
+  return buffer;
+}
+
+} // namespace igtl
@@ -0,0 +1,202 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlBufferAllocator_h
+#define __igtlBufferAllocator_h
+
+#include <vector>
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlSimpleFastMutexLock.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+/// BufferAllocator provides the memory for the serialized (packed) messages.
+/// MessageBase requests a buffer when a message is packed or received and
+/// hands it back when the buffer is too small for the next message, when
+/// MessageBase::ReleaseBuffer() is called, or when the message is deleted.
+///
+/// This base class allocates every buffer with new[]. Subclasses can
+/// override Allocate() and Release() to recycle buffers (see
+/// PooledBufferAllocator) or to use special memory. The allocator used by
+/// new messages is returned by GetDefault(); it can be replaced for the
+/// whole process with SetDefault(), or for a single message with
+/// MessageBase::SetBufferAllocator().
+class IGTLCommon_EXPORT BufferAllocator: public Object
+{
+public:
+  igtlTypeMacro(igtl::BufferAllocator, igtl::Object)
+  igtlNewMacro(igtl::BufferAllocator);
+
+  /// Allocates a buffer of at least 'size' bytes. The actual size of the
+  /// buffer, which may be larger, is stored in 'capacity' and must be passed
+  /// to Release(). Returns NULL on failure.
+  virtual unsigned char* Allocate(igtlUint64 size, igtlUint64* capacity);
+
+  /// Releases a buffer returned by Allocate().
+  virtual void Release(unsigned char* buffer, igtlUint64 capacity);
+
+  /// Returns the allocator used by new messages. By default, this is the
+  /// plain new[] allocator. Pooling is enabled by passing a
+  /// PooledBufferAllocator to SetDefault().
+  static BufferAllocator* GetDefault();
+
+  /// Replaces the allocator used by new messages. Messages created before
+  /// keep their allocator. Passing NULL restores the plain new[] allocator.
+  static void SetDefault(BufferAllocator* allocator);
+
+protected:
+  BufferAllocator();
+  ~BufferAllocator();
+
+private:
+  BufferAllocator(const BufferAllocator&); // Not implemented.
+  void operator=(const BufferAllocator&); // Not implemented.
+};
+
+
+/// PooledBufferAllocator keeps released buffers in size classes and reuses
+/// them for later requests of a similar size, so that a stream of messages
+/// of varying size (e.g. IMAGE, VIDEO or POLYDATA) does not allocate and
+/// free memory for each message. The size classes are spaced at a quarter
+/// of a power of two, so at most 25% of a buffer is unused.
+///
+/// The total size of the kept buffers is limited by SetMaximumPoolSize();
+/// buffers larger than the limit are never kept. The number of requests
+/// served from the pool (hits) and by new allocations (misses) can be
+/// used to tune the limit. The allocator is thread-safe.
+///
+/// If huge pages are enabled, buffers of HUGE_PAGE_SIZE or more are
+/// aligned to the huge page size and the kernel is advised to back them
+/// with transparent huge pages (Linux only; ignored on other platforms).
+/// This reduces TLB misses when large images are packed, checksummed and
+/// sent.
+class IGTLCommon_EXPORT PooledBufferAllocator: public BufferAllocator
+{
+public:
+  igtlTypeMacro(igtl::PooledBufferAllocator, igtl::BufferAllocator)
+  igtlNewMacro(igtl::PooledBufferAllocator);
+
+  enum {
+    MINIMUM_BLOCK_SIZE = 256,
+    HUGE_PAGE_SIZE     = 2 * 1024 * 1024
+  };
+
+  virtual unsigned char* Allocate(igtlUint64 size, igtlUint64* capacity);
+  virtual void Release(unsigned char* buffer, igtlUint64 capacity);
+
+  /// Sets the maximum total size (in bytes) of the buffers kept for reuse.
+  /// Kept buffers beyond the new limit are freed. The default is 64 MB.
+  void SetMaximumPoolSize(igtlUint64 size);
+  igtlUint64 GetMaximumPoolSize();
+
+  /// Enables huge pages for buffers of HUGE_PAGE_SIZE bytes or more.
+  /// Off by default.
+  void SetUseHugePages(bool use);
+  bool GetUseHugePages();
+
+  /// Returns the total size of the buffers kept for reuse.
+  igtlUint64 GetPoolSize();
+
+  /// Returns the number of requests served from the pool.
+  igtlUint64 GetNumberOfHits();
+
+  /// Returns the number of requests that required a new allocation.
+  igtlUint64 GetNumberOfMisses();
+
+  void ResetCounters();
+
+  /// Frees all buffers kept for reuse.
+  void Trim();
+
+protected:
+  PooledBufferAllocator();
+  ~PooledBufferAllocator();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Returns the size class of a request of 'size' bytes and stores the
+  /// size of the buffers in the class in 'blockSize'.
+  static int GetSizeClass(igtlUint64 size, igtlUint64* blockSize);
+
+  unsigned char* AllocateBlock(igtlUint64 blockSize);
+  void FreeBlock(unsigned char* block, igtlUint64 blockSize);
+
+  /// Frees kept buffers, largest first, until the pool fits in 'size' bytes.
+  /// The mutex must be locked.
+  void ShrinkPool(igtlUint64 size);
+
+  enum {
+    NUMBER_OF_SIZE_CLASSES = 64 * 4
+  };
+
+  std::vector<unsigned char*> m_FreeBlocks[NUMBER_OF_SIZE_CLASSES];
+
+  igtlUint64 m_MaximumPoolSize;
+  igtlUint64 m_PoolSize;
+  bool       m_UseHugePages;
+  igtlUint64 m_NumberOfHits;
+  igtlUint64 m_NumberOfMisses;
+
+  SimpleFastMutexLock m_Mutex;
+
+private:
+  PooledBufferAllocator(const PooledBufferAllocator&); // Not implemented.
+  void operator=(const PooledBufferAllocator&); // Not implemented.
+};
+
+
+/// PinnedBuffer takes over a buffer returned by a BufferAllocator and hands
+/// it back to the allocator when the last reference is released. MessageBase
+/// pins its buffer when views into the received data are created (see
+/// BufferView), so that the buffer outlives the message and is not reused
+/// for the next message while a view still refers to it.
+class IGTLCommon_EXPORT PinnedBuffer: public LightObject
+{
+public:
+  igtlTypeMacro(igtl::PinnedBuffer, igtl::LightObject)
+  igtlNewMacro(igtl::PinnedBuffer);
+
+  /// Takes over 'buffer', which must have been returned by 'allocator'
+  /// with the given capacity.
+  void SetBuffer(BufferAllocator* allocator, unsigned char* buffer, igtlUint64 capacity);
+
+  unsigned char* GetBuffer()   { return this->m_Buffer; }
+  igtlUint64     GetCapacity() { return this->m_Capacity; }
+
+  /// Returns the buffer to the caller, who becomes responsible for handing it
+  /// back to the allocator.
+  unsigned char* TakeBuffer();
+
+protected:
+  PinnedBuffer();
+  ~PinnedBuffer();
+
+  BufferAllocator::Pointer m_Allocator;
+  unsigned char*           m_Buffer;
+  igtlUint64               m_Capacity;
+
+private:
+  PinnedBuffer(const PinnedBuffer&); // Not implemented.
+  void operator=(const PinnedBuffer&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlBufferAllocator_h
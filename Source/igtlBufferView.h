@@ -0,0 +1,70 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlBufferView_h
+#define __igtlBufferView_h
+
+#include <cstddef>
+
+#include "igtlLightObject.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+/// BufferView is a typed view of an array that is stored in the buffer of a
+/// received message, e.g. the N-D array of an NDARRAY message or the points
+/// of a POLYDATA message unpacked with SetZeroCopyUnpack(true). The elements
+/// are in host byte order and can be read and modified in place.
+///
+/// A view holds a reference to the buffer (see PinnedBuffer), so the
+/// elements stay valid after the message has been deleted or reused to
+/// receive another message. Views are cheap to copy; the buffer is handed
+/// back to its allocator when the last view and the message let go of it.
+template <class T>
+class BufferView
+{
+public:
+  typedef T ValueType;
+
+  BufferView() : m_Data(NULL), m_Size(0) {}
+
+  /// Creates a view of 'size' elements at 'data'. 'owner' is the object that
+  /// owns the memory; it is referenced for the lifetime of the view.
+  BufferView(T* data, igtlUint64 size, LightObject* owner)
+    : m_Owner(owner), m_Data(data), m_Size(size) {}
+
+  /// Gets a pointer to the first element (NULL for an empty view).
+  T*         GetPointer() const { return this->m_Data; }
+
+  /// Gets the number of elements.
+  igtlUint64 GetSize() const    { return this->m_Size; }
+
+  /// Returns true if the view does not refer to any element.
+  bool       IsEmpty() const    { return this->m_Size == 0; }
+
+  T&         operator[](igtlUint64 i) const { return this->m_Data[i]; }
+
+  T*         begin() const      { return this->m_Data; }
+  T*         end() const        { return this->m_Data + this->m_Size; }
+
+private:
+  LightObject::Pointer m_Owner;
+  T*                   m_Data;
+  igtlUint64           m_Size;
+};
+
+} // namespace igtl
+
+#endif // __igtlBufferView_h
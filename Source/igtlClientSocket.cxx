@@ -46,8 +46,7 @@ int ClientSocket::ConnectToServer(const char* hostName, int port, bool logErrorI
   if (this->m_SocketDescriptor != -1)
     {
     igtlWarningMacro("Client connection already exists. Closing it.");
-    this->CloseSocket(this->m_SocketDescriptor);
-    this->m_SocketDescriptor = -1;
+    this->CloseSocket();
     }
   
   this->m_SocketDescriptor = this->CreateSocket();
@@ -71,6 +70,67 @@ int ClientSocket::ConnectToServer(const char* hostName, int port, bool logErrorI
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int ClientSocket::StartAsyncSend(int queueSize, int policy, igtlUint64 maxBatchSize)
+{
+  if (!this->GetConnected())
+    {
+    igtlErrorMacro("Asynchronous sending requires a connected socket.");
+    return -1;
+    }
+  if (this->m_SendQueue)
+    {
+    igtlWarningMacro("Asynchronous sending has already been started.");
+    return -1;
+    }
+
+  AsyncSendQueue* queue = new AsyncSendQueue;
+  if (queue->Start(this, queueSize, policy, maxBatchSize) < 0)
+    {
+    delete queue;
+    igtlErrorMacro("Failed to start the send thread.");
+    return -1;
+    }
+  this->m_SendQueue = queue;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void ClientSocket::StopAsyncSend(bool flush)
+{
+  this->DeleteSendQueue(flush);
+}
+
+//-----------------------------------------------------------------------------
+bool ClientSocket::FlushAsyncSend(unsigned long msec)
+{
+  if (this->m_SendQueue == NULL)
+    {
+    return true;
+    }
+  return this->m_SendQueue->Flush(msec);
+}
+
+//-----------------------------------------------------------------------------
+bool ClientSocket::GetAsyncSendStatistics(AsyncSendStatistics* statistics)
+{
+  if (this->m_SendQueue == NULL)
+    {
+    return false;
+    }
+  this->m_SendQueue->GetStatistics(statistics);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void ClientSocket::ResetAsyncSendStatistics()
+{
+  if (this->m_SendQueue)
+    {
+    this->m_SendQueue->ResetStatistics();
+    }
+}
+
 //-----------------------------------------------------------------------------
 void ClientSocket::PrintSelf(std::ostream& os) const
 {
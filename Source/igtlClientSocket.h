@@ -31,6 +31,7 @@
 #define __igtlClientSocket_h
 
 #include "igtlSocket.h"
+#include "igtlAsyncSendQueue.h"
 #include "igtlWin32Header.h"
 
 namespace igtl
@@ -46,7 +47,40 @@ public:
 
   /// Connects to host. Returns 0 on success, -1 on error.
   int ConnectToServer(const char* hostname, int port, bool logErrorIfServerConnectionFailed = true); 
-  
+
+  /// Starts sending from a dedicated I/O thread. Send() and SendFragments()
+  /// then copy the data into a queue of 'queueSize' messages and return
+  /// without waiting for the receiver. The I/O thread sends all queued
+  /// messages, up to 'maxBatchSize' bytes, with one system call. When the
+  /// queue is full, the oldest queued message is dropped
+  /// (AsyncSendQueue::DropOldest) or the sender waits (AsyncSendQueue::Block).
+  /// After a failed send, Send() returns 0. Must be called after the
+  /// connection has been established; closing the socket stops the thread.
+  /// Returns 0 on success, -1 on error.
+  int StartAsyncSend(int queueSize=64, int policy=AsyncSendQueue::Block,
+                     igtlUint64 maxBatchSize=64*1024);
+
+  /// Stops the I/O thread after sending the queued messages (flush=true) or
+  /// after the batch being sent, discarding the others (flush=false).
+  /// Send() then sends from the calling thread again. To interrupt a send
+  /// blocked by the receiver, close the socket instead.
+  void StopAsyncSend(bool flush=true);
+
+  /// Waits until the queued messages have been sent, up to 'msec'
+  /// milliseconds without progress (msec=0 implies no timeout). Returns true
+  /// if all messages have been sent.
+  bool FlushAsyncSend(unsigned long msec=0);
+
+  /// Returns true if asynchronous sending is active.
+  bool GetAsyncSend() { return this->m_SendQueue != NULL; }
+
+  /// Gets the counters of the asynchronous sender. Returns false if it is not
+  /// active.
+  bool GetAsyncSendStatistics(AsyncSendStatistics* statistics);
+
+  /// Resets the counters of the asynchronous sender.
+  void ResetAsyncSendStatistics();
+
 protected:
   ClientSocket();
   ~ClientSocket();
@@ -0,0 +1,267 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlClockOffsetEstimator.h"
+
+#include <math.h>
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+ClockOffsetEstimator::ClockOffsetEstimator() : Object()
+{
+  this->m_WindowSize  = 8;
+  this->m_RequestTime = 0;
+  this->m_Offset      = 0;
+  this->m_Delay       = 0;
+  this->m_Jitter      = 0.0;
+}
+
+
+//-----------------------------------------------------------------------------
+ClockOffsetEstimator::~ClockOffsetEstimator()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::SetWindowSize(int size)
+{
+  this->m_Lock.Lock();
+  this->m_WindowSize = size > 0 ? size : 1;
+  while ((int)this->m_Samples.size() > this->m_WindowSize)
+    {
+    this->m_Samples.pop_front();
+    }
+  this->UpdateEstimate();
+  this->m_Lock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::AddSample(igtlUint64 t0, igtlUint64 t1, igtlUint64 t2, igtlUint64 t3)
+{
+  // Differences of the time stamps are small, so they are exact in 64 bits.
+  Sample sample;
+  sample.Offset = ((igtlInt64)(t1 - t0) + (igtlInt64)(t2 - t3)) / 2;
+  sample.Delay  = (igtlInt64)(t3 - t0) - (igtlInt64)(t2 - t1);
+  if (sample.Delay < 0)
+    {
+    // Clock resolution; the peer took longer to reply than the round trip.
+    sample.Delay = 0;
+    }
+
+  this->m_Lock.Lock();
+  this->m_Samples.push_back(sample);
+  if ((int)this->m_Samples.size() > this->m_WindowSize)
+    {
+    this->m_Samples.pop_front();
+    }
+  this->UpdateEstimate();
+  this->m_Lock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockOffsetEstimator::SendRequest(Socket* socket)
+{
+  ClockSyncMessage::Pointer request = ClockSyncMessage::New();
+  TimeStamp::Pointer ts = TimeStamp::New();
+  ts->GetTime();
+  igtlUint64 t0 = ts->GetTimeStampUint64();
+  request->SetOriginateTime(t0);
+  request->SetTimeStamp(ts);
+  request->Pack();
+
+  this->m_Lock.Lock();
+  this->m_RequestTime = t0;
+  this->m_Lock.Unlock();
+
+  return socket->Send(request->GetPackPointer(), request->GetPackSize());
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockOffsetEstimator::AddReply(ClockSyncMessage* reply, TimeStamp* receiveTime)
+{
+  TimeStamp::Pointer ts = TimeStamp::New();
+  ts->GetTime();
+  igtlUint64 t3 = receiveTime ? receiveTime->GetTimeStampInNanoseconds() :
+                                ts->GetTimeStampInNanoseconds();
+
+  // Accept each reply once, and only for the last request: a late reply to
+  // an earlier request would include the time the request was overtaken.
+  this->m_Lock.Lock();
+  bool expected = !reply->IsRequest() && this->m_RequestTime != 0 &&
+                  reply->GetOriginateTime() == this->m_RequestTime;
+  if (expected)
+    {
+    this->m_RequestTime = 0;
+    }
+  this->m_Lock.Unlock();
+  if (!expected)
+    {
+    return 0;
+    }
+
+  ts->SetTime(reply->GetOriginateTime());
+  igtlUint64 t0 = ts->GetTimeStampInNanoseconds();
+  ts->SetTime(reply->GetReceiveTime());
+  igtlUint64 t1 = ts->GetTimeStampInNanoseconds();
+  ts->SetTime(reply->GetTransmitTime());
+  igtlUint64 t2 = ts->GetTimeStampInNanoseconds();
+  this->AddSample(t0, t1, t2, t3);
+
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockOffsetEstimator::SendReply(Socket* socket, ClockSyncMessage* request, TimeStamp* receiveTime)
+{
+  ClockSyncMessage::Pointer reply = ClockSyncMessage::New();
+  TimeStamp::Pointer ts = TimeStamp::New();
+  if (receiveTime)
+    {
+    reply->SetReceiveTime(receiveTime->GetTimeStampUint64());
+    }
+  else
+    {
+    ts->GetTime();
+    reply->SetReceiveTime(ts->GetTimeStampUint64());
+    }
+  reply->SetOriginateTime(request->GetOriginateTime());
+  reply->SetDeviceName(request->GetDeviceName());
+
+  ts->GetTime();
+  reply->SetTransmitTime(ts->GetTimeStampUint64());
+  reply->SetTimeStamp(ts);
+  reply->Pack();
+
+  return socket->Send(reply->GetPackPointer(), reply->GetPackSize());
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockOffsetEstimator::GetNumberOfSamples()
+{
+  this->m_Lock.Lock();
+  int n = (int)this->m_Samples.size();
+  this->m_Lock.Unlock();
+  return n;
+}
+
+
+//-----------------------------------------------------------------------------
+double ClockOffsetEstimator::GetOffset()
+{
+  this->m_Lock.Lock();
+  double offset = (double)this->m_Offset / 1e9;
+  this->m_Lock.Unlock();
+  return offset;
+}
+
+
+//-----------------------------------------------------------------------------
+double ClockOffsetEstimator::GetRoundTripDelay()
+{
+  this->m_Lock.Lock();
+  double delay = (double)this->m_Delay / 1e9;
+  this->m_Lock.Unlock();
+  return delay;
+}
+
+
+//-----------------------------------------------------------------------------
+double ClockOffsetEstimator::GetJitter()
+{
+  this->m_Lock.Lock();
+  double jitter = this->m_Jitter;
+  this->m_Lock.Unlock();
+  return jitter;
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::ConvertToLocalTime(TimeStamp* ts)
+{
+  this->m_Lock.Lock();
+  igtlInt64 offset = this->m_Offset;
+  this->m_Lock.Unlock();
+  ts->SetTimeInNanoseconds(ts->GetTimeStampInNanoseconds() - (igtlUint64)offset);
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::Reset()
+{
+  this->m_Lock.Lock();
+  this->m_Samples.clear();
+  this->m_RequestTime = 0;
+  this->UpdateEstimate();
+  this->m_Lock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::UpdateEstimate()
+{
+  if (this->m_Samples.empty())
+    {
+    this->m_Offset = 0;
+    this->m_Delay  = 0;
+    this->m_Jitter = 0.0;
+    return;
+    }
+
+  // The latest of the samples with the smallest delay.
+  std::deque<Sample>::const_iterator best = this->m_Samples.begin();
+  std::deque<Sample>::const_iterator it;
+  for (it = this->m_Samples.begin(); it != this->m_Samples.end(); ++ it)
+    {
+    if (it->Delay <= best->Delay)
+      {
+      best = it;
+      }
+    }
+  this->m_Offset = best->Offset;
+  this->m_Delay  = best->Delay;
+
+  double sum = 0.0;
+  for (it = this->m_Samples.begin(); it != this->m_Samples.end(); ++ it)
+    {
+    double d = (double)(it->Offset - best->Offset) / 1e9;
+    sum += d * d;
+    }
+  this->m_Jitter = this->m_Samples.size() > 1 ?
+    sqrt(sum / (double)(this->m_Samples.size() - 1)) : 0.0;
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockOffsetEstimator::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  std::string indent = "    ";
+
+  os << indent << "Window size: " << this->m_WindowSize << std::endl;
+  os << indent << "Number of samples: " << this->m_Samples.size() << std::endl;
+  os << indent << "Offset (ns): " << this->m_Offset << std::endl;
+  os << indent << "Round-trip delay (ns): " << this->m_Delay << std::endl;
+  os << indent << "Jitter (s): " << this->m_Jitter << std::endl;
+}
+
+} // namespace igtl
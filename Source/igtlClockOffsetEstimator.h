@@ -0,0 +1,136 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlClockOffsetEstimator_h
+#define __igtlClockOffsetEstimator_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlMutexLock.h"
+#include "igtlClockSyncMessage.h"
+#include "igtlSocket.h"
+#include "igtlTimeStamp.h"
+#include "igtlTypes.h"
+
+#include <deque>
+
+namespace igtl
+{
+
+/// ClockOffsetEstimator estimates the offset between the clock of a peer and
+/// the local clock from CLOCKSYNC round trips over one connection, so that
+/// the time stamp in the header of a message from the peer can be compared
+/// with the local time (e.g. to measure the latency from a tracker to the
+/// navigation software).
+///
+/// Each round trip gives four time stamps: t0 when the request was sent and
+/// t3 when the reply was received (local clock), t1 when the peer received
+/// the request and t2 when it sent the reply (peer clock). As in NTP, the
+/// offset of the peer clock is ((t1 - t0) + (t2 - t3)) / 2 and the
+/// round-trip delay is (t3 - t0) - (t2 - t1); the offset is exact if the
+/// delays in both directions are equal. The estimator keeps the last
+/// WindowSize samples and reports the offset of the sample with the smallest
+/// delay, which is the least disturbed by queuing. The jitter is the RMS
+/// difference between the offsets of the samples and the reported offset.
+///
+/// Use one estimator per connection, e.g. through igtl::ClockSyncHandler:
+///
+///     estimator->SendRequest(socket);
+///     ...
+///     // when a CLOCKSYNC reply has been received:
+///     estimator->AddReply(reply, receiveTime);
+///     double latency = now - (headerTime - estimator->GetOffset());
+class IGTLCommon_EXPORT ClockOffsetEstimator : public Object
+{
+public:
+  igtlTypeMacro(igtl::ClockOffsetEstimator, igtl::Object)
+  igtlNewMacro(igtl::ClockOffsetEstimator);
+
+  /// Sets the number of recent samples the estimate is taken from
+  /// (default: 8).
+  void SetWindowSize(int size);
+  int  GetWindowSize() const { return this->m_WindowSize; }
+
+  /// Adds the time stamps of a round trip, in nanoseconds since 1970:
+  /// t0 and t3 on the local clock, t1 and t2 on the peer clock.
+  void AddSample(igtlUint64 t0, igtlUint64 t1, igtlUint64 t2, igtlUint64 t3);
+
+  /// Captures the time and sends a CLOCKSYNC request over 'socket'. Returns
+  /// the result of Socket::Send(). Only the reply to the last request is
+  /// accepted by AddReply().
+  int SendRequest(Socket* socket);
+
+  /// Adds the round trip of a CLOCKSYNC reply that has been received at
+  /// 'receiveTime' (now, if NULL). Returns 1 if the sample has been added,
+  /// or 0 if the message is not the reply to the last request.
+  int AddReply(ClockSyncMessage* reply, TimeStamp* receiveTime=NULL);
+
+  /// Sends the reply to a CLOCKSYNC request that has been received at
+  /// 'receiveTime' (now, if NULL). This is the responder's side, which does
+  /// not need an estimator. Returns the result of Socket::Send().
+  static int SendReply(Socket* socket, ClockSyncMessage* request, TimeStamp* receiveTime=NULL);
+
+  /// Returns the number of samples in the window.
+  int    GetNumberOfSamples();
+
+  /// Returns the offset of the peer clock from the local clock in seconds
+  /// (peer time - local time), or 0 if there is no sample.
+  double GetOffset();
+
+  /// Returns the round-trip delay of the sample the offset is taken from,
+  /// in seconds.
+  double GetRoundTripDelay();
+
+  /// Returns the jitter of the offset in seconds.
+  double GetJitter();
+
+  /// Converts a time stamp of the peer clock (e.g. from a message header)
+  /// to the local clock.
+  void   ConvertToLocalTime(TimeStamp* ts);
+
+  /// Discards all samples and the pending request.
+  void   Reset();
+
+protected:
+  ClockOffsetEstimator();
+  ~ClockOffsetEstimator();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Selects the sample with the smallest delay and computes the jitter.
+  void UpdateEstimate();
+
+  struct Sample
+  {
+    igtlInt64 Offset; // ns
+    igtlInt64 Delay;  // ns
+  };
+
+  SimpleMutexLock     m_Lock;
+  std::deque<Sample>  m_Samples;
+  int                 m_WindowSize;
+
+  /// Originate time of the last request (64-bit fixed point), or 0.
+  igtlUint64          m_RequestTime;
+
+  igtlInt64           m_Offset;
+  igtlInt64           m_Delay;
+  double              m_Jitter;
+};
+
+} // namespace igtl
+
+#endif // __igtlClockOffsetEstimator_h
@@ -0,0 +1,97 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlClockSyncHandler.h"
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+ClockSyncHandler::ClockSyncHandler() : MessageHandler()
+{
+  this->m_Buffer = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+ClockSyncHandler::~ClockSyncHandler()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+MessageBase::Pointer ClockSyncHandler::CreateMessage()
+{
+  ClockSyncMessage::Pointer message = ClockSyncMessage::New();
+  return MessageBase::Pointer(message.GetPointer());
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockSyncHandler::ProcessReceivedMessage(Socket* socket, MessageBase* message)
+{
+  // The message has just been received; take the time before unpacking.
+  TimeStamp::Pointer receiveTime = TimeStamp::New();
+  receiveTime->GetTime();
+
+  ClockSyncMessage* clockSync = dynamic_cast<ClockSyncMessage*>(message);
+  if (clockSync == NULL ||
+      !(clockSync->Unpack(1) & MessageBase::UNPACK_BODY))
+    {
+    return 0;
+    }
+
+  if (clockSync->IsRequest())
+    {
+    ClockOffsetEstimator::SendReply(socket, clockSync, receiveTime);
+    }
+  else
+    {
+    this->GetEstimator(socket)->AddReply(clockSync, receiveTime);
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int ClockSyncHandler::SendRequest(Socket* socket)
+{
+  return this->GetEstimator(socket)->SendRequest(socket);
+}
+
+
+//-----------------------------------------------------------------------------
+ClockOffsetEstimator* ClockSyncHandler::GetEstimator(Socket* socket)
+{
+  this->m_Lock.Lock();
+  ClockOffsetEstimator::Pointer& estimator = this->m_Estimators[socket];
+  if (estimator.IsNull())
+    {
+    estimator = ClockOffsetEstimator::New();
+    }
+  ClockOffsetEstimator* p = estimator;
+  this->m_Lock.Unlock();
+  return p;
+}
+
+
+//-----------------------------------------------------------------------------
+void ClockSyncHandler::RemoveEstimator(Socket* socket)
+{
+  this->m_Lock.Lock();
+  this->m_Estimators.erase(socket);
+  this->m_Lock.Unlock();
+}
+
+} // namespace igtl
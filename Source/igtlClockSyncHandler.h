@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlClockSyncHandler_h
+#define __igtlClockSyncHandler_h
+
+#include "igtlObject.h"
+#include "igtlMacro.h"
+#include "igtlMessageHandler.h"
+#include "igtlMutexLock.h"
+#include "igtlClockOffsetEstimator.h"
+
+#include <map>
+#include <string>
+
+namespace igtl
+{
+
+/// ClockSyncHandler handles CLOCKSYNC messages received by an
+/// igtl::EventLoopServer or igtl::SessionManager. It answers the requests of
+/// the peers and passes the replies to the requests sent with SendRequest()
+/// to a ClockOffsetEstimator per connection, so that the offset and jitter
+/// of each peer's clock are available while other messages flow over the
+/// same connections:
+///
+///     igtl::ClockSyncHandler::Pointer clockSync = igtl::ClockSyncHandler::New();
+///     server->AddMessageHandler(clockSync);
+///     ...
+///     clockSync->SendRequest(socket);   // e.g. once per second
+///     ...
+///     double offset = clockSync->GetEstimator(socket)->GetOffset();
+///
+/// Both peers must register a handler (or answer the requests with
+/// ClockOffsetEstimator::SendReply()).
+class IGTLCommon_EXPORT ClockSyncHandler: public MessageHandler
+{
+public:
+  igtlTypeMacro(igtl::ClockSyncHandler, igtl::MessageHandler)
+  igtlNewMacro(igtl::ClockSyncHandler);
+
+public:
+  virtual const char* GetMessageType() { return "CLOCKSYNC"; }
+#if OpenIGTLink_HEADER_VERSION >= 2
+  virtual std::string GetMessageType() const { return std::string("CLOCKSYNC"); }
+#endif
+
+  virtual MessageBase::Pointer CreateMessage();
+
+  /// Answers a request, or adds a reply to the estimator of 'socket'.
+  virtual int ProcessReceivedMessage(Socket* socket, MessageBase* message);
+
+  /// Sends a request over 'socket'. Returns the result of Socket::Send().
+  int SendRequest(Socket* socket);
+
+  /// Returns the estimator of the connection 'socket', creating it if needed.
+  ClockOffsetEstimator* GetEstimator(Socket* socket);
+
+  /// Discards the estimator of 'socket', e.g. after the connection has been
+  /// closed.
+  void RemoveEstimator(Socket* socket);
+
+protected:
+  ClockSyncHandler();
+  ~ClockSyncHandler();
+
+  typedef std::map<Socket*, ClockOffsetEstimator::Pointer> EstimatorMap;
+
+  SimpleMutexLock m_Lock;
+  EstimatorMap    m_Estimators;
+};
+
+} // namespace igtl
+
+#endif // __igtlClockSyncHandler_h
@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlClockSyncMessage.h"
+
+#include "igtl_util.h"
+
+#include <string.h>
+
+namespace igtl {
+
+// Size of the body: originate, receive and transmit time stamps.
+#define IGTL_CLOCKSYNC_SIZE   24
+
+ClockSyncMessage::ClockSyncMessage():
+  MessageBase()
+{
+  this->m_SendMessageType = "CLOCKSYNC";
+  this->m_OriginateTime   = 0;
+  this->m_ReceiveTime     = 0;
+  this->m_TransmitTime    = 0;
+}
+
+
+ClockSyncMessage::~ClockSyncMessage()
+{
+}
+
+
+int ClockSyncMessage::CalculateContentBufferSize()
+{
+  return IGTL_CLOCKSYNC_SIZE;
+}
+
+
+int ClockSyncMessage::PackContent()
+{
+  AllocateBuffer();
+
+  igtlUint64 times[3];
+  times[0] = this->m_OriginateTime;
+  times[1] = this->m_ReceiveTime;
+  times[2] = this->m_TransmitTime;
+  if (igtl_is_little_endian())
+    {
+    for (int i = 0; i < 3; i ++)
+      {
+      times[i] = BYTE_SWAP_INT64(times[i]);
+      }
+    }
+  memcpy(this->m_Content, times, IGTL_CLOCKSYNC_SIZE);
+
+  return 1;
+}
+
+
+int ClockSyncMessage::UnpackContent()
+{
+  if (this->CalculateReceiveContentSize() < IGTL_CLOCKSYNC_SIZE)
+    {
+    return 0;
+    }
+
+  igtlUint64 times[3];
+  memcpy(times, this->m_Content, IGTL_CLOCKSYNC_SIZE);
+  if (igtl_is_little_endian())
+    {
+    for (int i = 0; i < 3; i ++)
+      {
+      times[i] = BYTE_SWAP_INT64(times[i]);
+      }
+    }
+  this->m_OriginateTime = times[0];
+  this->m_ReceiveTime   = times[1];
+  this->m_TransmitTime  = times[2];
+
+  return 1;
+}
+
+
+} // namespace igtl
@@ -0,0 +1,78 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlClockSyncMessage_h
+#define __igtlClockSyncMessage_h
+
+#include "igtlObject.h"
+#include "igtlMessageBase.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+/// The CLOCKSYNC message type is used to measure the offset between the
+/// clocks of two peers, in the same way as NTP. The body consists of three
+/// time stamps in the 64-bit fixed-point format of the header time stamp:
+///
+///   Originate  time at which the requester sent the request
+///   Receive    time at which the responder received the request
+///   Transmit   time at which the responder sent the reply
+///
+/// A request only has Originate set; the responder copies it to its reply.
+/// Together with the time at which the requester receives the reply, the four
+/// time stamps give the clock offset and the round-trip delay (see
+/// igtl::ClockOffsetEstimator). This message type is not part of the
+/// OpenIGTLink protocol specification; both peers must support it.
+class IGTLCommon_EXPORT ClockSyncMessage: public MessageBase
+{
+public:
+  igtlTypeMacro(igtl::ClockSyncMessage, igtl::MessageBase);
+  igtlNewMacro(igtl::ClockSyncMessage);
+
+public:
+
+  /// Sets/gets the time stamps in the 64-bit fixed-point format used in
+  /// OpenIGTLink (see TimeStamp::GetTimeStampUint64()).
+  void        SetOriginateTime(igtlUint64 tm) { this->m_OriginateTime = tm; }
+  igtlUint64  GetOriginateTime() const        { return this->m_OriginateTime; }
+  void        SetReceiveTime(igtlUint64 tm)   { this->m_ReceiveTime = tm; }
+  igtlUint64  GetReceiveTime() const          { return this->m_ReceiveTime; }
+  void        SetTransmitTime(igtlUint64 tm)  { this->m_TransmitTime = tm; }
+  igtlUint64  GetTransmitTime() const         { return this->m_TransmitTime; }
+
+  /// Returns true if the message is a request, i.e. the responder's time
+  /// stamps are not set.
+  bool        IsRequest() const { return this->m_ReceiveTime == 0 && this->m_TransmitTime == 0; }
+
+protected:
+  ClockSyncMessage();
+  ~ClockSyncMessage();
+
+protected:
+
+  virtual int  CalculateContentBufferSize();
+  virtual int  PackContent();
+  virtual int  UnpackContent();
+
+  igtlUint64   m_OriginateTime;
+  igtlUint64   m_ReceiveTime;
+  igtlUint64   m_TransmitTime;
+
+};
+
+
+} // namespace igtl
+
+#endif // __igtlClockSyncMessage_h
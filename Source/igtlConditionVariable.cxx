@@ -193,6 +193,13 @@ bool ConditionVariable::Wait(SimpleMutexLock *mutex, igtl_uint32 waitTime)
   int millisecond = waitTime%1000;
   targetTime.tv_sec  = tval.tv_sec + seconds;
   targetTime.tv_nsec = tval.tv_usec*1000 + (millisecond * 1000000);
+  if (targetTime.tv_nsec >= 1000000000)
+    {
+    // tv_nsec must be less than one second, or pthread_cond_timedwait()
+    // fails with EINVAL without waiting.
+    targetTime.tv_sec  += 1;
+    targetTime.tv_nsec -= 1000000000;
+    }
   int rv = pthread_cond_timedwait(&m_ConditionVariable, &mutex->GetMutexLock(), &targetTime);
   if (rv == 0) returnCode = true;
   return returnCode;
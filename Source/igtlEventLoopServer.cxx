@@ -0,0 +1,779 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlEventLoopServer.h"
+#include "igtlMessageHeader.h"
+#include "igtlStatistics.h"
+#include "igtl_header.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  #include <windows.h>
+  #include <winsock2.h>
+#else
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <sys/time.h>
+  #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <errno.h>
+  #if defined(OpenIGTLink_HAVE_EPOLL)
+    #include <sys/epoll.h>
+  #endif
+#endif
+
+#include <string.h>
+#include <algorithm>
+
+// Size of the receive buffer shared by the connections. Bodies larger than this
+// are received directly into the message buffer.
+#define IGTL_EVENT_LOOP_RECEIVE_BUFFER_SIZE 65536
+
+// Maximum number of events handled by one epoll_wait() call.
+#define IGTL_EVENT_LOOP_MAX_EVENTS          256
+
+namespace igtl
+{
+
+struct EventLoopServer::Connection
+{
+  ClientSocket::Pointer Socket;
+  int                   Descriptor;
+  size_t                Index;  // position in m_Connections
+
+  MessageHeader::Pointer Header;
+  int                    HeaderBytes;
+
+  MessageHandler*        Handler;  // NULL while skipping a body
+  MessageBase::Pointer   Message;  // reused while the type does not change
+  bool                   Receiving; // the handler reads the body through ReceiveMessage()
+  int                    BodySize;
+  int                    BodyBytes;
+
+  igtl_uint64            HeaderTime;     // when the header was completed, if Statistics is enabled
+  TrafficStatistics*     TypeStatistics; // of the last message type received
+
+  bool                   Capturing;
+  unsigned char          CapturedHeader[IGTL_HEADER_SIZE];  // as received, if capturing
+};
+
+namespace
+{
+
+// Switches the blocking mode of a socket.
+int SetNonBlocking(int socketdescriptor, int nonBlocking)
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  u_long mode = nonBlocking ? 1 : 0;
+  return ioctlsocket(socketdescriptor, FIONBIO, &mode) == 0 ? 0 : -1;
+#else
+  int flags = fcntl(socketdescriptor, F_GETFL, 0);
+  if (flags < 0)
+    {
+    return -1;
+    }
+  flags = nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  return fcntl(socketdescriptor, F_SETFL, flags);
+#endif
+}
+
+// Returns non-zero if the last socket call failed only because it would block
+// or has been interrupted.
+int IsTransientError()
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  int e = WSAGetLastError();
+  return (e == WSAEWOULDBLOCK || e == WSAEINTR);
+#else
+  return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+#endif
+}
+
+// Receives at most 'length' bytes from a readable socket. Since the socket is
+// readable, a single recv() does not block. Returns the number of bytes received,
+// 0 if no data is available, or -1 if the connection has been closed or failed.
+int ReceiveAvailable(int socketdescriptor, void* data, int length)
+{
+  int n = recv(socketdescriptor, (char*)data, length, 0);
+  if (n > 0)
+    {
+    return n;
+    }
+  if (n < 0 && IsTransientError())
+    {
+    return 0;
+    }
+  return -1;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+EventLoopServer::EventLoopServer()
+{
+  this->m_ServerSocket = NULL;
+  this->m_ServerSocketDescriptor = -1;
+  this->m_EpollDescriptor = -1;
+  this->m_ReceiveBuffer.resize(IGTL_EVENT_LOOP_RECEIVE_BUFFER_SIZE);
+}
+
+
+//-----------------------------------------------------------------------------
+EventLoopServer::~EventLoopServer()
+{
+  this->CloseServer();
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::CreateServer(int port)
+{
+  if (this->m_ServerSocket.IsNotNull())
+    {
+    igtlWarningMacro("Server already exists. Closing old server.");
+    this->CloseServer();
+    }
+
+  ServerSocket::Pointer serverSocket = ServerSocket::New();
+  if (serverSocket->CreateServer(port) < 0)
+    {
+    return -1;
+    }
+  int sd = serverSocket->GetSocketDescriptor();
+
+  // ServerSocket::CreateServer() listens with a backlog of one connection,
+  // which is too short when many clients connect at the same time.
+  // The listening socket is made non-blocking so that AcceptConnections()
+  // can accept until no connection is pending.
+  if (listen(sd, SOMAXCONN) != 0 || SetNonBlocking(sd, 1) != 0)
+    {
+    return -1;
+    }
+
+  if (this->InitializeEventLoop() != 0)
+    {
+    return -1;
+    }
+#if defined(OpenIGTLink_HAVE_EPOLL)
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL; // NULL indicates the server socket.
+  if (epoll_ctl(this->m_EpollDescriptor, EPOLL_CTL_ADD, sd, &ev) != 0)
+    {
+    return -1;
+    }
+#endif
+
+  this->m_ServerSocket = serverSocket;
+  this->m_ServerSocketDescriptor = sd;
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::GetServerPort()
+{
+  if (this->m_ServerSocket.IsNull())
+    {
+    return 0;
+    }
+  return this->m_ServerSocket->GetServerPort();
+}
+
+
+//-----------------------------------------------------------------------------
+void EventLoopServer::CloseServer()
+{
+  while (!this->m_Connections.empty())
+    {
+    this->CloseConnection(this->m_Connections.back());
+    }
+
+#if defined(OpenIGTLink_HAVE_EPOLL)
+  if (this->m_EpollDescriptor >= 0)
+    {
+    close(this->m_EpollDescriptor);
+    this->m_EpollDescriptor = -1;
+    }
+#endif
+
+  if (this->m_ServerSocket.IsNotNull())
+    {
+    this->m_ServerSocket->CloseSocket();
+    this->m_ServerSocket = NULL;
+    }
+  this->m_ServerSocketDescriptor = -1;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::AddMessageHandler(MessageHandler* handler, const char* deviceName)
+{
+  if (handler == NULL || !this->m_MessageHandlerMap.Add(handler, deviceName))
+    {
+    return 0;
+    }
+  // A handler that cannot create a message reads the body through ReceiveMessage().
+  if (handler->CreateMessage().IsNull() &&
+      std::find(this->m_ReceivingHandlers.begin(), this->m_ReceivingHandlers.end(), handler) ==
+      this->m_ReceivingHandlers.end())
+    {
+    this->m_ReceivingHandlers.push_back(handler);
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::RemoveMessageHandler(MessageHandler* handler)
+{
+  if (!this->m_MessageHandlerMap.Remove(handler))
+    {
+    return 0;
+    }
+  this->m_ReceivingHandlers.erase(std::remove(this->m_ReceivingHandlers.begin(),
+                                              this->m_ReceivingHandlers.end(), handler),
+                                  this->m_ReceivingHandlers.end());
+  // Bodies being received for this handler are skipped.
+  for (size_t i = 0; i < this->m_Connections.size(); i ++)
+    {
+    Connection* connection = this->m_Connections[i];
+    if (connection->Handler == handler)
+      {
+      connection->Handler = NULL;
+      connection->Message = NULL;
+      connection->Receiving = false;
+      }
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::AddConnection(ClientSocket* socket)
+{
+  if (socket == NULL || !socket->GetConnected())
+    {
+    return 0;
+    }
+  if (this->InitializeEventLoop() != 0)
+    {
+    return 0;
+    }
+  return this->RegisterConnection(socket);
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::ProcessEvents(unsigned long msec)
+{
+  if (this->m_ServerSocketDescriptor < 0 && this->m_Connections.empty())
+    {
+    return -1;
+    }
+
+  int dispatched = 0;
+
+#if defined(OpenIGTLink_HAVE_EPOLL)
+
+  struct epoll_event events[IGTL_EVENT_LOOP_MAX_EVENTS];
+  int timeout = (msec == 0) ? -1 : (int)msec;
+  int n = epoll_wait(this->m_EpollDescriptor, events, IGTL_EVENT_LOOP_MAX_EVENTS, timeout);
+  if (n < 0)
+    {
+    return IsTransientError() ? 0 : -1;
+    }
+  for (int i = 0; i < n; i ++)
+    {
+    Connection* connection = static_cast<Connection*>(events[i].data.ptr);
+    if (connection == NULL)
+      {
+      this->AcceptConnections();
+      }
+    else
+      {
+      int r = this->ReadConnection(connection);
+      if (r > 0)
+        {
+        dispatched += r;
+        }
+      }
+    }
+
+#else // select()
+
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  int maxDescriptor = this->m_ServerSocketDescriptor;
+  if (this->m_ServerSocketDescriptor >= 0)
+    {
+    FD_SET(this->m_ServerSocketDescriptor, &readSet);
+    }
+  for (size_t i = 0; i < this->m_Connections.size(); i ++)
+    {
+    int sd = this->m_Connections[i]->Descriptor;
+    FD_SET(sd, &readSet);
+    if (sd > maxDescriptor)
+      {
+      maxDescriptor = sd;
+      }
+    }
+
+  struct timeval tval;
+  struct timeval* tvalptr = NULL;
+  if (msec > 0)
+    {
+    tval.tv_sec = msec / 1000;
+    tval.tv_usec = (msec % 1000) * 1000;
+    tvalptr = &tval;
+    }
+  int n = select(maxDescriptor + 1, &readSet, NULL, NULL, tvalptr);
+  if (n < 0)
+    {
+    return IsTransientError() ? 0 : -1;
+    }
+  if (n == 0)
+    {
+    return 0;
+    }
+
+  // Take the readable connections before accepting, since accepting and
+  // closing connections reorder m_Connections.
+  std::vector<Connection*> readable;
+  for (size_t i = 0; i < this->m_Connections.size(); i ++)
+    {
+    if (FD_ISSET(this->m_Connections[i]->Descriptor, &readSet))
+      {
+      readable.push_back(this->m_Connections[i]);
+      }
+    }
+  if (this->m_ServerSocketDescriptor >= 0 && FD_ISSET(this->m_ServerSocketDescriptor, &readSet))
+    {
+    this->AcceptConnections();
+    }
+  for (size_t i = 0; i < readable.size(); i ++)
+    {
+    int r = this->ReadConnection(readable[i]);
+    if (r > 0)
+      {
+      dispatched += r;
+      }
+    }
+
+#endif
+
+  return dispatched;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::GetNumberOfConnections()
+{
+  return (int)this->m_Connections.size();
+}
+
+
+//-----------------------------------------------------------------------------
+ClientSocket* EventLoopServer::GetConnection(int i)
+{
+  if (i < 0 || i >= (int)this->m_Connections.size())
+    {
+    return NULL;
+    }
+  return this->m_Connections[i]->Socket;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::Broadcast(MessageBase* message)
+{
+  int sent = 0;
+  for (size_t i = 0; i < this->m_Connections.size(); i ++)
+    {
+    if (this->m_Connections[i]->Socket->SendFragments(message))
+      {
+      sent ++;
+      }
+    }
+  return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::InitializeEventLoop()
+{
+#if defined(OpenIGTLink_HAVE_EPOLL)
+  if (this->m_EpollDescriptor < 0)
+    {
+    this->m_EpollDescriptor = epoll_create1(0);
+    if (this->m_EpollDescriptor < 0)
+      {
+      igtlErrorMacro("Failed to create an epoll instance.");
+      return -1;
+      }
+    }
+#endif
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void EventLoopServer::AcceptConnections()
+{
+  while (1)
+    {
+    int sd = this->m_ServerSocket->Accept(this->m_ServerSocketDescriptor);
+    if (sd < 0)
+      {
+      // No more pending connections.
+      return;
+      }
+
+    // Some platforms let the accepted socket inherit the non-blocking mode of the
+    // server socket; the client sockets must block when sending.
+    SetNonBlocking(sd, 0);
+    int on = 1;
+    setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on));
+
+    ClientSocket::Pointer socket = ClientSocket::New();
+    socket->m_SocketDescriptor = sd;
+    this->RegisterConnection(socket);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::RegisterConnection(ClientSocket* socket)
+{
+  int sd = socket->GetSocketDescriptor();
+
+#if !defined(OpenIGTLink_HAVE_EPOLL)
+  #if defined(_WIN32) && !defined(__CYGWIN__)
+  int overflow = (this->m_Connections.size() + 1 >= FD_SETSIZE);
+  #else
+  int overflow = (sd >= FD_SETSIZE);
+  #endif
+  if (overflow)
+    {
+    igtlWarningMacro("Too many connections for select(). Connection refused.");
+    socket->CloseSocket();
+    return 0;
+    }
+#endif
+
+  Connection* connection = new Connection;
+  connection->Socket = socket;
+  connection->Descriptor = sd;
+  connection->Header = MessageHeader::New();
+  connection->Header->InitBuffer();
+  connection->HeaderBytes = 0;
+  connection->Handler = NULL;
+  connection->Message = NULL;
+  connection->Receiving = false;
+  connection->BodySize = 0;
+  connection->BodyBytes = 0;
+  connection->HeaderTime = 0;
+  connection->TypeStatistics = NULL;
+  connection->Capturing = false;
+
+#if defined(OpenIGTLink_HAVE_EPOLL)
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = connection;
+  if (epoll_ctl(this->m_EpollDescriptor, EPOLL_CTL_ADD, sd, &ev) != 0)
+    {
+    igtlWarningMacro("Failed to register a connection. Connection refused.");
+    socket->CloseSocket();
+    delete connection;
+    return 0;
+    }
+#endif
+
+  connection->Index = this->m_Connections.size();
+  this->m_Connections.push_back(connection);
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::ReadConnection(Connection* connection)
+{
+  if (connection->Receiving)
+    {
+    return this->ReceiveWithHandler(connection);
+    }
+
+  // A large remainder of a body is received directly into the message buffer
+  // to avoid copying it through the shared receive buffer.
+  if (connection->HeaderBytes == IGTL_HEADER_SIZE && connection->Message.IsNotNull() &&
+      connection->BodySize - connection->BodyBytes >= (int)this->m_ReceiveBuffer.size())
+    {
+    char* body = (char*)connection->Message->GetBufferBodyPointer();
+    int n = ReceiveAvailable(connection->Descriptor, body + connection->BodyBytes,
+                             connection->BodySize - connection->BodyBytes);
+    if (n < 0)
+      {
+      this->CloseConnection(connection);
+      return -1;
+      }
+    if (Statistics::GetEnabled())
+      {
+      connection->Socket->GetStatistics()->Increment(TrafficStatistics::ReceivedBytes, n);
+      }
+    connection->BodyBytes += n;
+    if (connection->BodyBytes == connection->BodySize)
+      {
+      return this->DispatchMessage(connection);
+      }
+    return 0;
+    }
+
+  int size = (int)this->m_ReceiveBuffer.size();
+  if (!this->m_ReceivingHandlers.empty())
+    {
+    // Stop at the end of the current header or body, so that the body of the
+    // next message stays in the socket for a handler that reads it itself.
+    int remaining = (connection->HeaderBytes < IGTL_HEADER_SIZE) ?
+      IGTL_HEADER_SIZE - connection->HeaderBytes : connection->BodySize - connection->BodyBytes;
+    if (remaining < size)
+      {
+      size = remaining;
+      }
+    }
+  int n = ReceiveAvailable(connection->Descriptor, &this->m_ReceiveBuffer[0], size);
+  if (n < 0)
+    {
+    this->CloseConnection(connection);
+    return -1;
+    }
+  if (n > 0 && Statistics::GetEnabled())
+    {
+    connection->Socket->GetStatistics()->Increment(TrafficStatistics::ReceivedBytes, n);
+    }
+  return this->ConsumeData(connection, &this->m_ReceiveBuffer[0], n);
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::ConsumeData(Connection* connection, const char* data, int size)
+{
+  int dispatched = 0;
+  while (size > 0)
+    {
+    if (connection->HeaderBytes < IGTL_HEADER_SIZE)
+      {
+      int n = IGTL_HEADER_SIZE - connection->HeaderBytes;
+      if (n > size)
+        {
+        n = size;
+        }
+      memcpy((char*)connection->Header->GetBufferPointer() + connection->HeaderBytes, data, n);
+      connection->HeaderBytes += n;
+      data += n;
+      size -= n;
+      if (connection->HeaderBytes == IGTL_HEADER_SIZE)
+        {
+        this->StartBody(connection);
+        if (connection->Receiving)
+          {
+          // The reads stop at the end of the header; the handler reads the body.
+          if (connection->BodySize == 0)
+            {
+            dispatched += this->ReceiveWithHandler(connection);
+            }
+          return dispatched;
+          }
+        if (connection->BodySize == 0)
+          {
+          dispatched += this->DispatchMessage(connection);
+          }
+        }
+      }
+    else
+      {
+      int n = connection->BodySize - connection->BodyBytes;
+      if (n > size)
+        {
+        n = size;
+        }
+      if (connection->Message.IsNotNull())
+        {
+        memcpy((char*)connection->Message->GetBufferBodyPointer() + connection->BodyBytes, data, n);
+        }
+      connection->BodyBytes += n;
+      data += n;
+      size -= n;
+      if (connection->BodyBytes == connection->BodySize)
+        {
+        dispatched += this->DispatchMessage(connection);
+        }
+      }
+    }
+  return dispatched;
+}
+
+
+//-----------------------------------------------------------------------------
+void EventLoopServer::StartBody(Connection* connection)
+{
+  connection->Capturing = this->m_CaptureWriter.IsNotNull();
+  if (connection->Capturing)
+    {
+    memcpy(connection->CapturedHeader, connection->Header->GetBufferPointer(), IGTL_HEADER_SIZE);
+    }
+  connection->Header->Unpack();
+  connection->BodyBytes = 0;
+  connection->HeaderTime = Statistics::GetEnabled() ? Statistics::GetTime() : 0;
+
+#if OpenIGTLink_HEADER_VERSION >= 2
+  MessageHandler* handler = this->m_MessageHandlerMap.Find(connection->Header->GetMessageType().c_str(),
+                                                           connection->Header->GetDeviceName());
+#else
+  MessageHandler* handler = this->m_MessageHandlerMap.Find(connection->Header->GetDeviceType(),
+                                                           connection->Header->GetDeviceName());
+#endif
+
+  if (handler != connection->Handler || connection->Message.IsNull())
+    {
+    connection->Handler = handler;
+    connection->Message = handler ? handler->CreateMessage() : NULL;
+    }
+  connection->Receiving = (handler != NULL && connection->Message.IsNull());
+  if (connection->Receiving)
+    {
+    connection->Capturing = false;
+    }
+  if (handler == NULL)
+    {
+    // The body of a message without a handler is kept for the capture only;
+    // the buffer is released once the capture has been turned off.
+    if (!connection->Capturing)
+      {
+      connection->Message = NULL;
+      }
+    else if (connection->Message.IsNull())
+      {
+      connection->Message = MessageBase::New();
+      }
+    }
+
+  if (connection->Message.IsNotNull())
+    {
+    connection->Message->SetMessageHeader(connection->Header);
+    connection->Message->AllocateBuffer();
+    connection->BodySize = connection->Message->GetBufferBodySize();
+    }
+  else
+    {
+    // No handler for this type; the body is skipped.
+    connection->BodySize = connection->Header->GetBodySizeToRead();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::ReceiveWithHandler(Connection* connection)
+{
+  // ReceiveMessage() returns the position in the body after receiving, or -1
+  // if the completed message could not be unpacked.
+  int pos = connection->Handler->ReceiveMessage(connection->Socket, connection->Header,
+                                                connection->BodyBytes);
+  if (pos < 0 || pos >= connection->BodySize)
+    {
+    connection->BodyBytes = connection->BodySize;
+    return this->DispatchMessage(connection);
+    }
+  if (pos <= connection->BodyBytes)
+    {
+    // Nothing has been received from a readable socket; the peer has disconnected.
+    this->CloseConnection(connection);
+    return -1;
+    }
+  connection->BodyBytes = pos;
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+int EventLoopServer::DispatchMessage(Connection* connection)
+{
+  int dispatched = 0;
+  if (connection->HeaderTime != 0)
+    {
+    igtl_uint64 duration = Statistics::GetTime() - connection->HeaderTime;
+    const char* type = connection->Header->GetDeviceType();
+    if (connection->TypeStatistics == NULL || connection->TypeStatistics->GetName() != type)
+      {
+      connection->TypeStatistics = Statistics::GetMessageTypeStatistics(type);
+      }
+    TrafficStatistics* statistics[2] = { connection->Socket->GetStatistics(), connection->TypeStatistics };
+    for (int i = 0; i < 2; i ++)
+      {
+      statistics[i]->AddDuration(TrafficStatistics::ReceiveBody, duration);
+      statistics[i]->Increment(TrafficStatistics::ReceivedMessages);
+      }
+    }
+  if (connection->Capturing && this->m_CaptureWriter.IsNotNull())
+    {
+    const void* body = connection->Message.IsNotNull() ? connection->Message->GetBufferBodyPointer() : NULL;
+    this->m_CaptureWriter->WriteMessage(connection->CapturedHeader, body, connection->BodySize);
+    }
+  if (connection->Handler && connection->Message.IsNotNull())
+    {
+    connection->Handler->ProcessReceivedMessage(connection->Socket, connection->Message);
+    dispatched = 1;
+    }
+  else if (connection->Receiving)
+    {
+    // Processed by ReceiveMessage().
+    dispatched = 1;
+    }
+  connection->Receiving = false;
+  connection->Header->InitBuffer();
+  connection->HeaderBytes = 0;
+  connection->BodySize = 0;
+  connection->BodyBytes = 0;
+  return dispatched;
+}
+
+
+//-----------------------------------------------------------------------------
+void EventLoopServer::CloseConnection(Connection* connection)
+{
+  // Closing the socket also removes it from the epoll set.
+  connection->Socket->CloseSocket();
+
+  // Move the last connection into the vacated slot.
+  Connection* last = this->m_Connections.back();
+  this->m_Connections[connection->Index] = last;
+  last->Index = connection->Index;
+  this->m_Connections.pop_back();
+
+  delete connection;
+}
+
+
+//-----------------------------------------------------------------------------
+void EventLoopServer::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  os << "Server port: " << (this->m_ServerSocket.IsNotNull() ? this->m_ServerSocket->GetServerPort() : 0) << std::endl;
+  os << "Number of connections: " << this->m_Connections.size() << std::endl;
+  os << "Number of message handlers: " << this->m_MessageHandlerMap.GetNumberOfEntries() << std::endl;
+}
+
+} // namespace igtl
@@ -0,0 +1,178 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlEventLoopServer_h
+#define __igtlEventLoopServer_h
+
+#include <vector>
+
+#include "igtlObject.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlMessageBase.h"
+#include "igtlMessageHandler.h"
+#include "igtlMessageHandlerMap.h"
+#include "igtlServerSocket.h"
+#include "igtlClientSocket.h"
+#include "igtlMessageCaptureWriter.h"
+
+namespace igtl
+{
+
+/// The EventLoopServer class serves many clients from a single thread.
+/// Instead of blocking on one socket at a time, it waits for any of the
+/// connections to become readable (epoll() on Linux, select() elsewhere),
+/// reads whatever has arrived and keeps the partially received header and
+/// body of each connection until the message is complete. Completed messages
+/// are passed to the MessageHandler registered for their type (and optionally
+/// device name) through MessageHandler::ProcessReceivedMessage(). Messages
+/// without a handler are skipped. Connections opened by the application
+/// (e.g. to other servers) can be added with AddConnection() and are served
+/// in the same loop.
+///
+/// The following code shows how to run a server:
+///
+///     igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+///     server->AddMessageHandler(transformHandler);
+///     server->AddMessageHandler(imageHandler);
+///     if (server->CreateServer(18944) < 0) { ... }
+///     while (running)
+///       {
+///       server->ProcessEvents(100);
+///       }
+///
+/// Each readable connection is read once per event, so a connection that sends
+/// continuously cannot starve the others. Sending is not affected: the client
+/// sockets stay in blocking mode, and handlers can reply through the socket
+/// passed to ProcessReceivedMessage().
+class IGTLCommon_EXPORT EventLoopServer: public Object
+{
+public:
+  igtlTypeMacro(igtl::EventLoopServer, igtl::Object)
+  igtlNewMacro(igtl::EventLoopServer);
+
+  /// Creates a server socket at a given port and starts accepting connections.
+  /// Returns -1 on error. 0 on success.
+  int CreateServer(int port);
+
+  /// Returns the port on which the server is running.
+  int GetServerPort();
+
+  /// Closes all connections and the server socket.
+  void CloseServer();
+
+  /// Registers a message handler. Only one handler can be registered for
+  /// each message type, or for each pair of message type and device name if
+  /// 'deviceName' is specified. The handlers defined by
+  /// igtlMessageHandlerClassMacro() implement CreateMessage(), and each
+  /// connection receives into a message created by the handler. A handler
+  /// that only implements ReceiveMessage() reads the body from the socket
+  /// itself, blocking the loop until the body has been received; while such
+  /// a handler is registered, the connections are not read beyond the end of
+  /// the current message, and its messages are not captured.
+  /// Returns 1 on success, 0 otherwise.
+  int AddMessageHandler(MessageHandler* handler, const char* deviceName=NULL);
+
+  /// Unregisters a message handler. Returns 1 on success, 0 otherwise.
+  int RemoveMessageHandler(MessageHandler* handler);
+
+  /// Adds a connected socket, e.g. a ClientSocket connected to another server,
+  /// to the sockets served by the loop. Returns 1 on success, 0 otherwise.
+  int AddConnection(ClientSocket* socket);
+
+  /// Waits for events for up to 'msec' milliseconds (msec=0 implies no timeout),
+  /// then accepts new connections and reads from all readable connections.
+  /// Returns the number of messages passed to the handlers, or -1 on error or
+  /// if there is neither a server socket nor a connection.
+  int ProcessEvents(unsigned long msec=0);
+
+  /// Returns the number of connected clients.
+  int GetNumberOfConnections();
+
+  /// Returns the socket of the i-th connection. The order changes when a
+  /// connection is closed.
+  ClientSocket* GetConnection(int i);
+
+  /// Sends a packed message to all connected clients. Returns the number of
+  /// clients the message has been sent to.
+  int Broadcast(MessageBase* message);
+
+  /// Records every message received from the connections, including those
+  /// without a handler, to 'writer' as it has been received. Passing NULL
+  /// stops recording.
+  void SetCaptureWriter(MessageCaptureWriter* writer) { this->m_CaptureWriter = writer; }
+  MessageCaptureWriter* GetCaptureWriter() { return this->m_CaptureWriter; }
+
+protected:
+  EventLoopServer();
+  ~EventLoopServer();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Receive state of a connection; defined in igtlEventLoopServer.cxx.
+  struct Connection;
+
+  /// Creates the epoll instance if it does not exist yet. Returns 0 on success.
+  int InitializeEventLoop();
+
+  /// Accepts all pending connections.
+  void AcceptConnections();
+
+  /// Starts serving a connected socket. Returns 1 on success, 0 otherwise.
+  int RegisterConnection(ClientSocket* socket);
+
+  /// Reads from a readable connection and dispatches the completed messages.
+  /// Returns the number of dispatched messages, or -1 if the connection has been closed.
+  int ReadConnection(Connection* connection);
+
+  /// Consumes 'size' bytes received from the connection into its header and body buffers.
+  int ConsumeData(Connection* connection, const char* data, int size);
+
+  /// Prepares receiving the body after the header of 'connection' has been completed.
+  void StartBody(Connection* connection);
+
+  /// Lets a handler without CreateMessage() read the body from the socket.
+  /// Returns the number of dispatched messages, or -1 if the connection has been closed.
+  int ReceiveWithHandler(Connection* connection);
+
+  /// Passes the completed message to its handler and resets the receive state.
+  int DispatchMessage(Connection* connection);
+
+  void CloseConnection(Connection* connection);
+
+protected:
+  ServerSocket::Pointer m_ServerSocket;
+  int m_ServerSocketDescriptor;
+  int m_EpollDescriptor;
+
+  std::vector<Connection*> m_Connections;
+
+  MessageHandlerMap m_MessageHandlerMap;
+
+  /// Registered handlers that only implement ReceiveMessage().
+  std::vector<MessageHandler*> m_ReceivingHandlers;
+
+  /// Buffer shared by all connections for receiving headers and small bodies.
+  std::vector<char> m_ReceiveBuffer;
+
+  MessageCaptureWriter::Pointer m_CaptureWriter;
+
+private:
+  EventLoopServer(const EventLoopServer&); // Not implemented.
+  void operator=(const EventLoopServer&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlEventLoopServer_h
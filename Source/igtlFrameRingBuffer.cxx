@@ -0,0 +1,303 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlFrameRingBuffer.h"
+
+#include <algorithm>
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+FrameRingBuffer::FrameRingBuffer()
+{
+  this->m_Policy = DropOldest;
+  this->m_Head = 0;
+  this->m_Count = 0;
+  this->m_Reading = 0;
+  this->m_Writing = false;
+  this->m_Closed = false;
+  this->m_NumberOfDroppedFrames = 0;
+  this->m_FrameAvailable = ConditionVariable::New();
+  this->m_SlotAvailable = ConditionVariable::New();
+}
+
+
+//-----------------------------------------------------------------------------
+FrameRingBuffer::~FrameRingBuffer()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+void FrameRingBuffer::Allocate(int numberOfSlots, igtl_uint64 slotSize, int policy)
+{
+  this->m_Mutex.Lock();
+  this->m_Slots.resize(numberOfSlots > 0 ? numberOfSlots : 1);
+  for (size_t i = 0; i < this->m_Slots.size(); i ++)
+    {
+    // Keep at least one byte so that the slot always has a valid address.
+    this->m_Slots[i].Buffer.resize(slotSize > 0 ? (size_t)slotSize : 1);
+    this->m_Slots[i].Size = 0;
+    this->m_Slots[i].TimeStamp = 0;
+    }
+  this->m_Policy = policy;
+  this->m_Head = 0;
+  this->m_Count = 0;
+  this->m_Reading = 0;
+  this->m_Writing = false;
+  this->m_Closed = false;
+  this->m_NumberOfDroppedFrames = 0;
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+igtl_uint8* FrameRingBuffer::BeginWrite(igtl_uint64 size)
+{
+  this->m_Mutex.Lock();
+  int n = (int)this->m_Slots.size();
+  while (!this->m_Closed && n > 0 && this->m_Count == n)
+    {
+    if (this->m_Policy == DropOldest && this->m_Count > this->m_Reading)
+      {
+      // Drop the oldest frame that is not being read. The later frames move
+      // up by one slot, so the dropped slot is the one to be written.
+      for (int i = this->m_Reading; i < this->m_Count - 1; i ++)
+        {
+        Slot& slot = this->m_Slots[(this->m_Head + i) % n];
+        Slot& next = this->m_Slots[(this->m_Head + i + 1) % n];
+        slot.Buffer.swap(next.Buffer);
+        std::swap(slot.Size, next.Size);
+        std::swap(slot.TimeStamp, next.TimeStamp);
+        }
+      this->m_Count --;
+      this->m_NumberOfDroppedFrames ++;
+      break;
+      }
+    // All frames are being read, or the consumer must not miss any frame.
+    this->m_SlotAvailable->Wait(&this->m_Mutex);
+    }
+  if (this->m_Closed || n == 0)
+    {
+    this->m_Mutex.Unlock();
+    return NULL;
+    }
+  Slot& slot = this->m_Slots[(this->m_Head + this->m_Count) % n];
+  this->m_Writing = true;
+  this->m_Mutex.Unlock();
+
+  // The slot is owned by the producer until EndWrite().
+  if (slot.Buffer.size() < size)
+    {
+    slot.Buffer.resize((size_t)size);
+    }
+  return &slot.Buffer[0];
+}
+
+
+//-----------------------------------------------------------------------------
+void FrameRingBuffer::EndWrite(igtl_uint64 size, igtl_uint64 timeStamp)
+{
+  this->m_Mutex.Lock();
+  if (this->m_Writing)
+    {
+    int n = (int)this->m_Slots.size();
+    Slot& slot = this->m_Slots[(this->m_Head + this->m_Count) % n];
+    slot.Size = size;
+    slot.TimeStamp = timeStamp;
+    this->m_Count ++;
+    this->m_Writing = false;
+    this->m_FrameAvailable->Signal();
+    }
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+igtl_uint8* FrameRingBuffer::BeginRead(igtl_uint64* size, unsigned long msec, igtl_uint64* timeStamp)
+{
+  this->m_Mutex.Lock();
+  while (this->m_Count == 0 && !this->m_Closed)
+    {
+    if (msec == 0)
+      {
+      this->m_FrameAvailable->Wait(&this->m_Mutex);
+      }
+    else if (!this->m_FrameAvailable->Wait(&this->m_Mutex, (igtl_uint32)msec))
+      {
+      break;
+      }
+    }
+  if (this->m_Count == 0 || this->m_Reading)
+    {
+    this->m_Mutex.Unlock();
+    return NULL;
+    }
+  Slot& slot = this->m_Slots[this->m_Head];
+  this->m_Reading = 1;
+  if (size)
+    {
+    *size = slot.Size;
+    }
+  if (timeStamp)
+    {
+    *timeStamp = slot.TimeStamp;
+    }
+  this->m_Mutex.Unlock();
+  return &slot.Buffer[0];
+}
+
+
+//-----------------------------------------------------------------------------
+int FrameRingBuffer::BeginReadFrames(igtl_uint8** frames, igtl_uint64* sizes, igtl_uint64* timeStamps,
+                                     int maxFrames, igtl_uint64 maxBytes, unsigned long msec)
+{
+  this->m_Mutex.Lock();
+  while (this->m_Count == 0 && !this->m_Closed)
+    {
+    if (msec == 0)
+      {
+      this->m_FrameAvailable->Wait(&this->m_Mutex);
+      }
+    else if (!this->m_FrameAvailable->Wait(&this->m_Mutex, (igtl_uint32)msec))
+      {
+      break;
+      }
+    }
+  if (this->m_Count == 0 || this->m_Reading)
+    {
+    this->m_Mutex.Unlock();
+    return 0;
+    }
+
+  // One slot is left to the producer, so that DropOldest does not have to
+  // wait for the frames being read.
+  int n = (int)this->m_Slots.size();
+  int available = this->m_Count < n - 1 ? this->m_Count : (n > 1 ? n - 1 : 1);
+  int count = 0;
+  igtl_uint64 bytes = 0;
+  while (count < available && count < maxFrames)
+    {
+    Slot& slot = this->m_Slots[(this->m_Head + count) % n];
+    if (count > 0 && bytes + slot.Size > maxBytes)
+      {
+      break;
+      }
+    frames[count] = &slot.Buffer[0];
+    sizes[count] = slot.Size;
+    if (timeStamps)
+      {
+      timeStamps[count] = slot.TimeStamp;
+      }
+    bytes += slot.Size;
+    count ++;
+    }
+  this->m_Reading = count;
+  this->m_Mutex.Unlock();
+  return count;
+}
+
+
+//-----------------------------------------------------------------------------
+void FrameRingBuffer::EndRead()
+{
+  this->m_Mutex.Lock();
+  if (this->m_Reading)
+    {
+    this->m_Head = (this->m_Head + this->m_Reading) % (int)this->m_Slots.size();
+    this->m_Count -= this->m_Reading;
+    this->m_Reading = 0;
+    this->m_SlotAvailable->Broadcast();
+    }
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool FrameRingBuffer::WaitUntilEmpty(unsigned long msec)
+{
+  this->m_Mutex.Lock();
+  while (this->m_Count > 0 && !this->m_Closed)
+    {
+    if (msec == 0)
+      {
+      this->m_SlotAvailable->Wait(&this->m_Mutex);
+      }
+    else if (!this->m_SlotAvailable->Wait(&this->m_Mutex, (igtl_uint32)msec))
+      {
+      break;
+      }
+    }
+  bool empty = this->m_Count == 0;
+  this->m_Mutex.Unlock();
+  return empty;
+}
+
+
+//-----------------------------------------------------------------------------
+void FrameRingBuffer::Close()
+{
+  this->m_Mutex.Lock();
+  this->m_Closed = true;
+  this->m_FrameAvailable->Broadcast();
+  this->m_SlotAvailable->Broadcast();
+  this->m_Mutex.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+bool FrameRingBuffer::IsClosed()
+{
+  this->m_Mutex.Lock();
+  bool closed = this->m_Closed;
+  this->m_Mutex.Unlock();
+  return closed;
+}
+
+
+//-----------------------------------------------------------------------------
+int FrameRingBuffer::GetNumberOfFrames()
+{
+  this->m_Mutex.Lock();
+  int count = this->m_Count;
+  this->m_Mutex.Unlock();
+  return count;
+}
+
+
+//-----------------------------------------------------------------------------
+bool FrameRingBuffer::GetOldestTimeStamp(igtl_uint64* timeStamp)
+{
+  this->m_Mutex.Lock();
+  bool pending = this->m_Count > 0;
+  if (pending)
+    {
+    *timeStamp = this->m_Slots[this->m_Head].TimeStamp;
+    }
+  this->m_Mutex.Unlock();
+  return pending;
+}
+
+
+//-----------------------------------------------------------------------------
+igtl_uint64 FrameRingBuffer::GetNumberOfDroppedFrames()
+{
+  this->m_Mutex.Lock();
+  igtl_uint64 dropped = this->m_NumberOfDroppedFrames;
+  this->m_Mutex.Unlock();
+  return dropped;
+}
+
+} // namespace igtl
@@ -0,0 +1,170 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlFrameRingBuffer_h
+#define __igtlFrameRingBuffer_h
+
+#include <vector>
+
+#include "igtlWin32Header.h"
+#include "igtlMutexLock.h"
+#include "igtlConditionVariable.h"
+#include "igtl_types.h"
+
+namespace igtl
+{
+
+/// FrameRingBuffer passes frames (e.g. video frames or packed messages) from
+/// one producer thread to one consumer thread through a fixed number of
+/// preallocated slots. The producer fills a slot in place between
+/// BeginWrite() and EndWrite(); the consumer reads the oldest frame in place
+/// between BeginRead() and EndRead(). The frame data is never copied by the
+/// ring and the mutex is only held to hand a slot over, not while the slot
+/// is being filled or read.
+///
+/// A consumer waiting for a frame sleeps on a condition variable until a frame
+/// is published or the ring is closed. When the ring is full, the producer
+/// either drops the oldest pending frame that is not being read (DropOldest,
+/// for live streams where only the latest frames matter) or waits for the
+/// consumer (Block). The consumer may also take several consecutive frames at
+/// once with BeginReadFrames(), e.g. to send them with one system call.
+///
+/// A slot is resized only when a frame larger than any previous frame in the
+/// slot is written, so once the slots have grown to the frame size no memory
+/// is allocated.
+///
+/// Each frame can carry a time stamp (e.g. the capture time in nanoseconds),
+/// which lets a consumer serving several rings pick the oldest frame with
+/// GetOldestTimeStamp().
+///
+///     igtl::FrameRingBuffer ring;
+///     ring.Allocate(4, frameSize);
+///
+///     // producer thread
+///     igtl_uint8* slot = ring.BeginWrite(frameSize);
+///     fread(slot, 1, frameSize, fp);
+///     ring.EndWrite(frameSize);
+///     ...
+///     ring.Close();
+///
+///     // consumer thread
+///     igtl_uint64 size;
+///     while (igtl_uint8* frame = ring.BeginRead(&size))
+///       {
+///       Encode(frame, size);
+///       ring.EndRead();
+///       }
+class IGTLCommon_EXPORT FrameRingBuffer
+{
+public:
+  enum OverflowPolicy {
+    DropOldest,
+    Block
+  };
+
+  FrameRingBuffer();
+  ~FrameRingBuffer();
+
+  /// Allocates 'numberOfSlots' slots of 'slotSize' bytes and reopens the ring.
+  /// Pending frames are discarded. Must not be called while a producer or
+  /// consumer is using the ring.
+  void Allocate(int numberOfSlots, igtl_uint64 slotSize, int policy=DropOldest);
+
+  /// Returns a slot of at least 'size' bytes to be filled by the producer.
+  /// If the ring is full, the oldest pending frame is dropped or the call
+  /// waits, depending on the overflow policy. Returns NULL if the ring has
+  /// been closed.
+  igtl_uint8* BeginWrite(igtl_uint64 size);
+
+  /// Publishes the slot returned by BeginWrite() as a frame of 'size' bytes
+  /// with the given time stamp and wakes the consumer.
+  void EndWrite(igtl_uint64 size, igtl_uint64 timeStamp=0);
+
+  /// Returns the oldest pending frame and stores its size in 'size' and its
+  /// time stamp in 'timeStamp' (if not NULL). Waits up to 'msec' milliseconds
+  /// (msec=0 implies no timeout) if no frame is pending. Returns NULL on
+  /// timeout, or if the ring has been closed and all frames have been read.
+  igtl_uint8* BeginRead(igtl_uint64* size, unsigned long msec=0, igtl_uint64* timeStamp=NULL);
+
+  /// Returns up to 'maxFrames' of the oldest pending frames in 'frames', with
+  /// their sizes in 'sizes' and time stamps in 'timeStamps' (if not NULL).
+  /// Frames are added while their total size does not exceed 'maxBytes', but
+  /// the oldest frame is always returned; one slot is always left to the
+  /// producer. Waits like BeginRead(). Returns the number of frames, or 0 on
+  /// timeout or if the ring has been closed and all frames have been read.
+  int BeginReadFrames(igtl_uint8** frames, igtl_uint64* sizes, igtl_uint64* timeStamps,
+                      int maxFrames, igtl_uint64 maxBytes, unsigned long msec=0);
+
+  /// Releases the frames returned by BeginRead() or BeginReadFrames() and wakes
+  /// a waiting producer.
+  void EndRead();
+
+  /// Waits until the consumer has released all pending frames, up to 'msec'
+  /// milliseconds between two released batches (msec=0 implies no timeout).
+  /// Does not wait once the ring has been closed. Returns true if the ring is
+  /// empty.
+  bool WaitUntilEmpty(unsigned long msec=0);
+
+  /// Closes the ring and wakes both threads. The consumer can still read the
+  /// pending frames; BeginWrite() fails until the ring is allocated again.
+  void Close();
+
+  bool IsClosed();
+
+  /// Returns the number of published frames that have not been released by
+  /// the consumer yet.
+  int GetNumberOfFrames();
+
+  int GetNumberOfSlots() { return (int)this->m_Slots.size(); }
+
+  /// Stores the time stamp of the oldest pending frame in 'timeStamp'.
+  /// Returns false if no frame is pending. Does not wait.
+  bool GetOldestTimeStamp(igtl_uint64* timeStamp);
+
+  /// Returns the number of frames dropped because the ring was full.
+  igtl_uint64 GetNumberOfDroppedFrames();
+
+protected:
+  struct Slot
+  {
+    std::vector<igtl_uint8> Buffer;
+    igtl_uint64             Size;
+    igtl_uint64             TimeStamp;
+  };
+
+  std::vector<Slot> m_Slots;
+  int               m_Policy;
+
+  // Index of the oldest published frame and the number of published frames.
+  // The consumer owns the m_Reading slots from m_Head on; the producer owns
+  // the slot after the last published frame while m_Writing is set.
+  int               m_Head;
+  int               m_Count;
+  int               m_Reading;
+  bool              m_Writing;
+  bool              m_Closed;
+  igtl_uint64       m_NumberOfDroppedFrames;
+
+  SimpleMutexLock              m_Mutex;
+  ConditionVariable::Pointer   m_FrameAvailable;
+  ConditionVariable::Pointer   m_SlotAvailable;
+
+private:
+  FrameRingBuffer(const FrameRingBuffer&); // Not implemented.
+  void operator=(const FrameRingBuffer&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlFrameRingBuffer_h
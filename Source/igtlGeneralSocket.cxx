@@ -26,9 +26,14 @@
  
  =========================================================================*/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sendmmsg() and recvmmsg()
+#endif
+
 #include "igtlGeneralSocket.h"
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #include <winsock2.h>
@@ -622,6 +627,119 @@ namespace igtl
   }
 
   
+  //-----------------------------------------------------------------------------
+  int GeneralSocket::SendUDPBatch(const unsigned char* const* packets, const int* lengths, int numberOfPackets)
+  {
+    if (!this->GetConnected())
+      {
+      return 0;
+      }
+    igtl_uint8 ttlArg = 1; // 1 is the default value , valid value from 0 to 255
+    TTL_TYPE ttl = (TTL_TYPE)ttlArg;
+    if (setsockopt(this->m_SocketDescriptor, IPPROTO_IP, IP_MULTICAST_TTL,
+                   (const char*)&ttl, sizeof ttl) < 0) {
+      return 0;
+    }
+    
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_addr.s_addr = inet_addr(this->IPAddress);
+    dest.sin_port = htons(this->PortNum);
+    
+    int numberOfSent = 0;
+  #if defined(OpenIGTLink_HAVE_SENDMMSG)
+    // The messages are passed in chunks to keep the headers on the stack.
+    const int chunkSize = 64;
+    struct mmsghdr messages[chunkSize];
+    struct iovec   vectors[chunkSize];
+    while (numberOfSent < numberOfPackets)
+      {
+      int n = numberOfPackets - numberOfSent;
+      if (n > chunkSize)
+        {
+        n = chunkSize;
+        }
+      memset(messages, 0, sizeof(struct mmsghdr) * n);
+      for (int i = 0; i < n; i ++)
+        {
+        vectors[i].iov_base = (void*)packets[numberOfSent + i];
+        vectors[i].iov_len  = lengths[numberOfSent + i];
+        messages[i].msg_hdr.msg_name    = &dest;
+        messages[i].msg_hdr.msg_namelen = sizeof(dest);
+        messages[i].msg_hdr.msg_iov     = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen  = 1;
+        }
+      int sent = sendmmsg(this->m_SocketDescriptor, messages, n, 0);
+      if (sent <= 0)
+        {
+        break;
+        }
+      numberOfSent += sent;
+      }
+  #else
+    for (; numberOfSent < numberOfPackets; numberOfSent ++)
+      {
+      int n = sendto(this->m_SocketDescriptor, (const char*)packets[numberOfSent], lengths[numberOfSent], 0,
+                     (struct sockaddr*)&dest, sizeof dest);
+      if (n < 0)
+        {
+        break;
+        }
+      }
+  #endif
+    return numberOfSent;
+  }
+  
+  //-----------------------------------------------------------------------------
+  int GeneralSocket::ReceiveUDPBatch(unsigned char* const* buffers, int bufferSize, int* lengths, int maxPackets)
+  {
+    if (!this->GetConnected() || maxPackets <= 0)
+      {
+      return 0;
+      }
+  #if defined(OpenIGTLink_HAVE_RECVMMSG)
+    const int chunkSize = 64;
+    struct mmsghdr messages[chunkSize];
+    struct iovec   vectors[chunkSize];
+    int n = maxPackets < chunkSize ? maxPackets : chunkSize;
+    memset(messages, 0, sizeof(struct mmsghdr) * n);
+    for (int i = 0; i < n; i ++)
+      {
+      vectors[i].iov_base = buffers[i];
+      vectors[i].iov_len  = bufferSize;
+      messages[i].msg_hdr.msg_iov    = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+      }
+    // Wait for the first datagram only; the socket timeout applies to this wait.
+    int received = recvmmsg(this->m_SocketDescriptor, messages, n, MSG_WAITFORONE, NULL);
+    if (received < 0)
+      {
+      // The socket timeout is reported as EAGAIN or EWOULDBLOCK.
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? -1 : 0;
+      }
+    for (int i = 0; i < received; i ++)
+      {
+      lengths[i] = (int)messages[i].msg_len;
+      }
+    return received;
+  #else
+    int n = this->ReceiveUDP(buffers[0], bufferSize);
+  #if !defined(_WIN32) || defined(__CYGWIN__)
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      {
+      return 0;
+      }
+  #endif
+    if (n <= 0)
+      {
+      return n;
+      }
+    lengths[0] = n;
+    return 1;
+  #endif
+  }
+
   //-----------------------------------------------------------------------------
   int GeneralSocket::SetTimeout(int timeout)
   {
@@ -118,6 +118,21 @@ namespace igtl
     /// by SetTimeout() or SetReceiveTimeout().
     int ReceiveUDP(void* data, int length);
 
+    /// Sends 'numberOfPackets' UDP datagrams, where packets[i] holds lengths[i] bytes, to the
+    /// address and port set by SetIPAddress() and SetPortNumber(). On Linux, the datagrams are
+    /// passed to the kernel with as few sendmmsg() calls as possible; on other platforms they
+    /// are sent one by one. Returns the number of datagrams sent, which is less than
+    /// 'numberOfPackets' if an error occurs.
+    int SendUDPBatch(const unsigned char* const* packets, const int* lengths, int numberOfPackets);
+    
+    /// Receives up to 'maxPackets' UDP datagrams. Datagram i is stored in buffers[i], which holds
+    /// 'bufferSize' bytes, and its length in lengths[i]. The call blocks until a datagram arrives,
+    /// unless a timeout is set, and then returns the datagrams that are already queued without
+    /// waiting further. On Linux, the datagrams are received with a single recvmmsg() call; on
+    /// other platforms one datagram is received per call.
+    /// 0 on error, -1 on timeout, else the number of datagrams received is returned.
+    int ReceiveUDPBatch(unsigned char* const* buffers, int bufferSize, int* lengths, int maxPackets);
+
     
     /// Set sending/receiving timeout for the existing socket in millisecond.
     /// This function should be called after opening the socket.
@@ -215,7 +230,7 @@ namespace igtl
     int m_SendTimeoutFlag;
     int m_ReceiveTimeoutFlag;
     
-    short PortNum;
+    igtl_uint16 PortNum;
     char IPAddress[IP4AddressStrLen];    
   };
   
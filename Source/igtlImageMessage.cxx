@@ -391,7 +391,12 @@ int ImageMessage::PackContent()
                         image_header);
 
   igtl_image_convert_byte_order(image_header);
-  
+
+  // The image data has been written by the caller through GetScalarPointer();
+  // feed it to the CRC following the header.
+  UpdateContentCRC(m_ImageHeader, IGTL_IMAGE_HEADER_SIZE);
+  UpdateContentCRC(m_Image, GetSubVolumeImageSize());
+
   return 1;
 
 }
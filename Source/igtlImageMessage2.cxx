@@ -498,6 +498,37 @@ int ImageMessage2::GetPackFragmentSize(int id)
   return 0;
 }
 
+
+int ImageMessage2::GetNumberOfBufferFragments()
+{
+  // When the pack only contains header
+  if (this->m_MessageSize == IGTL_HEADER_SIZE)
+    {
+    return 1;
+    }
+  return this->GetNumberOfPackFragments();
+}
+
+
+void* ImageMessage2::GetBufferFragmentPointer(int id)
+{
+  if (this->m_MessageSize == IGTL_HEADER_SIZE)
+    {
+    return (id == 0) ? (void*) this->m_Header : NULL;
+    }
+  return this->GetPackFragmentPointer(id);
+}
+
+
+int ImageMessage2::GetBufferFragmentSize(int id)
+{
+  if (this->m_MessageSize == IGTL_HEADER_SIZE)
+    {
+    return (id == 0) ? IGTL_HEADER_SIZE : 0;
+    }
+  return this->GetPackFragmentSize(id);
+}
+
 #endif // FRAGMENTED_PACK  
 
 
@@ -287,6 +287,12 @@ public:
 
   /// Gets the size of the specified fragment. (for fragmented pack support)
   int   GetPackFragmentSize(int id);
+
+  /// Returns the pack fragments once the image has been allocated, so that
+  /// the message can be sent without creating a single pack.
+  virtual int   GetNumberOfBufferFragments();
+  virtual void* GetBufferFragmentPointer(int id);
+  virtual int   GetBufferFragmentSize(int id);
 #endif // FRAGMENTED_PACK 
 
 
@@ -30,6 +30,7 @@
 #include "igtlLightObject.h"
 #include "igtlObjectFactory.h"
 #include "igtlFastMutexLock.h"
+#include "igtlAtomic.h"
 
 #include <list>
 #include <memory>
@@ -149,9 +150,13 @@ void
 LightObject
 ::Register() const
 {
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicAdd(&m_ReferenceCount, 1);
+#else
   m_ReferenceCountLock.Lock();
   m_ReferenceCount++;
   m_ReferenceCountLock.Unlock();
+#endif
 }
 
 
@@ -162,10 +167,16 @@ void
 LightObject
 ::UnRegister() const
 {
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  // The decrement has acquire-release semantics, so the thread that drops
+  // the count to zero sees every write made through the other references.
+  int tmpReferenceCount = AtomicAdd(&m_ReferenceCount, -1);
+#else
   m_ReferenceCountLock.Lock();
   int tmpReferenceCount = --m_ReferenceCount;
   m_ReferenceCountLock.Unlock();
-  
+#endif
+
   // ReferenceCount in now unlocked.  We may have a race condition
   // to delete the object.
   if ( tmpReferenceCount <= 0)
@@ -182,9 +193,13 @@ void
 LightObject
 ::SetReferenceCount(int ref)
 {
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicStore(&m_ReferenceCount, ref);
+#else
   m_ReferenceCountLock.Lock();
   m_ReferenceCount = ref;
   m_ReferenceCountLock.Unlock();
+#endif
 
   if ( ref <= 0)
     {
@@ -125,10 +125,12 @@ protected:
   virtual void PrintHeader(std::ostream& os) const;
   virtual void PrintTrailer(std::ostream& os) const;
   
-  /** Number of uses of this object by other objects. */
+  /** Number of uses of this object by other objects. Updated with atomic
+   * operations where the compiler provides them (see igtlAtomic.h). */
   mutable volatile int m_ReferenceCount;
 
-  /** Mutex lock to protect modification to the reference count */
+  /** Mutex lock to protect modification to the reference count on
+   * compilers without atomic operations. */
   mutable SimpleFastMutexLock m_ReferenceCountLock;
 
 private:
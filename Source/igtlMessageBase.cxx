@@ -14,6 +14,7 @@
 
 #include "igtlMessageBase.h"
 #include "igtlMessageFactory.h"
+#include "igtlParallelCRC64.h"
 #include "igtl_header.h"
 #include "igtl_util.h"
 
@@ -21,6 +22,7 @@
 #include <string>
 #include <cstring>
 #include <limits>
+#include <new>
 
 namespace
 {
@@ -46,31 +48,154 @@ MessageBase::MessageBase()
     , m_IsHeaderUnpacked(false)
     , m_IsBodyUnpacked(false)
     , m_IsBodyPacked(false)
+    , m_BodyCRC(0)
+    , m_ContentCRCSize(0)
+    , m_FeedContentCRC(true)
+    , m_CRCNumberOfThreads(1)
+    , m_ParallelCRCThreshold(16 * 1024 * 1024)
+    , m_BufferAllocator(BufferAllocator::GetDefault())
+    , m_BufferCapacity(0)
+    , m_TypeStatistics(NULL)
 #if OpenIGTLink_HEADER_VERSION >= 2
     , m_ExtendedHeader(NULL)
     , m_IsExtendedHeaderUnpacked(false)
     , m_MetaData(NULL)
     , m_MessageId(0)
+    , m_IsMetaDataPending(false)
     , m_MetaDataMap(MetaDataMap())
+    , m_IsMetaDataMapValid(true)
 #endif
 {
 }
 
 MessageBase::~MessageBase()
 {
-  if (this->m_MessageSize > 0 && this->m_Header != NULL)
+#if OpenIGTLink_HEADER_VERSION >= 2
+  // No need to copy the meta data out of the buffer
+  m_IsMetaDataPending = false;
+  m_MetaDataStore.Clear();
+#endif
+  this->ReleaseBuffer();
+}
+
+void MessageBase::SetBufferAllocator(BufferAllocator* allocator)
+{
+  if (allocator == m_BufferAllocator.GetPointer())
+    {
+    return;
+    }
+  ReleaseBuffer();
+  m_BufferAllocator = allocator ? allocator : BufferAllocator::GetDefault();
+}
+
+void MessageBase::ReleaseBuffer()
+{
+#if OpenIGTLink_HEADER_VERSION >= 2
+  DetachMetaData();
+#endif
+  if (m_PinnedBuffer.IsNotNull())
     {
-    delete [] m_Header;
-    m_MessageSize = 0;
-    m_Header      = NULL;
-    m_Body        = NULL;
-    m_Content     = NULL;
+    // Released by the PinnedBuffer once no view refers to it
+    m_PinnedBuffer = NULL;
+    }
+  else if (m_Header != NULL)
+    {
+    if (m_BufferCapacity > 0)
+      {
+      m_BufferAllocator->Release(m_Header, m_BufferCapacity);
+      }
+    else if (m_MessageSize > 0)
+      {
+      // Allocated by a child class
+      delete [] m_Header;
+      }
+    }
+  m_BufferCapacity = 0;
+  m_MessageSize = 0;
+  m_Header      = NULL;
+  m_Body        = NULL;
+  m_Content     = NULL;
+  m_IsHeaderUnpacked = false;
+  m_IsBodyUnpacked   = false;
+  m_IsBodyPacked     = false;
+#if OpenIGTLink_HEADER_VERSION >= 2
+  m_ExtendedHeader = NULL;
+  m_MetaDataHeader = NULL;
+  m_MetaData = NULL;
+#endif
+}
+
+void MessageBase::ResizeBuffer(int messageSize, bool keepCapacity)
+{
 #if OpenIGTLink_HEADER_VERSION >= 2
-    m_ExtendedHeader = NULL;
-    m_MetaDataHeader = NULL;
-    m_MetaData = NULL;
+  DetachMetaData();
 #endif
+  bool pinned = false;
+  if (m_PinnedBuffer.IsNotNull())
+    {
+    // The buffer can be reused only if the message holds the last reference to it.
+    if (m_PinnedBuffer->GetReferenceCount() == 1)
+      {
+      m_PinnedBuffer->TakeBuffer();
+      }
+    else
+      {
+      pinned = true;
+      }
+    m_PinnedBuffer = NULL;
+    }
+
+  if (m_Header != NULL && !pinned && (igtlUint64)messageSize <= m_BufferCapacity &&
+      (keepCapacity || (igtlUint64)messageSize * 2 >= m_BufferCapacity))
+    {
+    return;
+    }
+
+  igtlUint64 capacity = 0;
+  unsigned char* buffer = m_BufferAllocator->Allocate(messageSize, &capacity);
+  if (buffer == NULL)
+    {
+    throw std::bad_alloc();
+    }
+  if (m_Header != NULL)
+    {
+    // m_MessageSize may already have been set to the new size by a child class.
+    igtlUint64 used = m_MessageSize > 0 ? m_MessageSize : 0;
+    if (m_BufferCapacity > 0 && used > m_BufferCapacity)
+      {
+      used = m_BufferCapacity;
+      }
+    memcpy(buffer, m_Header, (size_t)std::min<igtlUint64>(used, messageSize));
+    if (pinned)
+      {
+      // Still referenced by views; released by the PinnedBuffer
+      }
+    else if (m_BufferCapacity > 0)
+      {
+      m_BufferAllocator->Release(m_Header, m_BufferCapacity);
+      }
+    else
+      {
+      // Allocated by a child class
+      delete [] m_Header;
+      }
     }
+  m_Header = buffer;
+  m_BufferCapacity = capacity;
+}
+
+LightObject* MessageBase::PinBuffer()
+{
+  if (m_PinnedBuffer.IsNull())
+    {
+    if (m_Header == NULL || m_BufferCapacity == 0)
+      {
+      return NULL;
+      }
+    m_PinnedBuffer = PinnedBuffer::New();
+    m_PinnedBuffer->SetBuffer(m_BufferAllocator, m_Header, m_BufferCapacity);
+    }
+  return m_PinnedBuffer;
 }
 
 int MessageBase::CalculateContentBufferSize()
@@ -89,7 +214,10 @@ igtl::MessageBase::Pointer MessageBase::Clone()
     int bodySize = this->m_MessageSize - IGTL_HEADER_SIZE;
     clone->InitBuffer();
     clone->CopyHeader(this);
-    clone->AllocateBuffer(bodySize);
+    // The body is copied as it is, including the extended header and the
+    // meta data of version 2, so the buffer must match the message size.
+    clone->ResizeBuffer(this->m_MessageSize);
+    clone->m_Body = &clone->m_Header[IGTL_HEADER_SIZE];
     if (bodySize > 0)
       {
       clone->CopyBody(this);
@@ -97,7 +225,10 @@ igtl::MessageBase::Pointer MessageBase::Clone()
 
 #if OpenIGTLink_HEADER_VERSION >= 2
     clone->m_MetaDataHeader = this->m_MetaDataHeader;
-    clone->m_MetaDataMap = this->m_MetaDataMap;
+    this->ParseMetaData();
+    clone->m_MetaDataStore = this->m_MetaDataStore;
+    clone->m_IsMetaDataPending = false;
+    clone->m_IsMetaDataMapValid = false;
     clone->m_IsExtendedHeaderUnpacked = this->m_IsExtendedHeaderUnpacked;
 #endif
 
@@ -175,13 +306,8 @@ igtlUint32 MessageBase::GetMetaDataSize()
 {
   if( m_HeaderVersion >= IGTL_HEADER_VERSION_2 )
     {
-    igtlUint32 metaDataSize(0);
-    for (MetaDataMap::const_iterator it = m_MetaDataMap.begin(); it != m_MetaDataMap.end(); ++it)
-      {
-      metaDataSize += it->first.length() + it->second.second.length();
-      }
-
-    return metaDataSize;
+    ParseMetaData();
+    return m_MetaDataStore.GetDataSize();
     }
   else
     {
@@ -193,7 +319,8 @@ igtlUint16 MessageBase::GetMetaDataHeaderSize()
 {
   if( m_HeaderVersion >= IGTL_HEADER_VERSION_2 )
     {
-    return (m_MetaDataMap.size()*sizeof(igtl_metadata_header_entry)) + sizeof(igtlUint16); // index_count is at beginning of header
+    ParseMetaData();
+    return (m_MetaDataStore.GetNumberOfEntries()*sizeof(igtl_metadata_header_entry)) + sizeof(igtlUint16); // index_count is at beginning of header
     }
   else
     {
@@ -214,16 +341,16 @@ void MessageBase::SetMessageID(igtlUint32 idValue)
 
 bool MessageBase::SetMetaDataElement(const std::string& key, IANA_ENCODING_TYPE encodingScheme, std::string value)
 {
-  igtl_metadata_header_entry entry;
-  if (key.length() > std::numeric_limits<igtl_uint16>::max())
+  if (key.length() > std::numeric_limits<igtl_uint16>::max() ||
+      value.length() > std::numeric_limits<igtl_uint32>::max())
     {
     return false;
     }
-  entry.key_size = static_cast<igtl_uint16>(key.length());
-  entry.value_encoding = static_cast<igtlUint16>(encodingScheme);
-  entry.value_size = value.length();
 
-  m_MetaDataMap[key] = std::pair<IANA_ENCODING_TYPE, std::string>(encodingScheme, value);
+  ParseMetaData();
+  m_MetaDataStore.Set(key.data(), static_cast<igtl_uint16>(key.length()), static_cast<igtlUint16>(encodingScheme),
+                      value.data(), static_cast<igtl_uint32>(value.length()));
+  m_IsMetaDataMapValid = false;
 
   m_IsBodyPacked = false;
 
@@ -308,10 +435,12 @@ bool MessageBase::GetMetaDataElement(const std::string& key, std::string& value)
 
 bool MessageBase::GetMetaDataElement(const std::string& key, IANA_ENCODING_TYPE& encoding, std::string& value) const
 {
-  if (m_MetaDataMap.find(key) != m_MetaDataMap.end())
+  ParseMetaData();
+  int i = m_MetaDataStore.Find(key.data(), key.length());
+  if (i >= 0)
     {
-    encoding = m_MetaDataMap.find(key)->second.first;
-    value = m_MetaDataMap.find(key)->second.second;
+    encoding = static_cast<IANA_ENCODING_TYPE>(m_MetaDataStore.GetEncoding(i));
+    value.assign(m_MetaDataStore.GetValue(i), m_MetaDataStore.GetValueSize(i));
     return true;
     }
 
@@ -320,9 +449,59 @@ bool MessageBase::GetMetaDataElement(const std::string& key, IANA_ENCODING_TYPE&
 
 const MessageBase::MetaDataMap& MessageBase::GetMetaData() const
 {
+  ParseMetaData();
+  if (!m_IsMetaDataMapValid)
+    {
+    // The entries are sorted by key, so each one is inserted at the end.
+    m_MetaDataMap.clear();
+    for (int i = 0; i < m_MetaDataStore.GetNumberOfEntries(); i++)
+      {
+      m_MetaDataMap.insert(m_MetaDataMap.end(), MetaDataMap::value_type(
+        std::string(m_MetaDataStore.GetKey(i), m_MetaDataStore.GetKeySize(i)),
+        std::pair<IANA_ENCODING_TYPE, std::string>(static_cast<IANA_ENCODING_TYPE>(m_MetaDataStore.GetEncoding(i)),
+          std::string(m_MetaDataStore.GetValue(i), m_MetaDataStore.GetValueSize(i)))));
+      }
+    m_IsMetaDataMapValid = true;
+    }
   return this->m_MetaDataMap;
 }
 
+void MessageBase::ParseMetaData() const
+{
+  if (!m_IsMetaDataPending)
+    {
+    return;
+    }
+  m_IsMetaDataPending = false;
+  m_IsMetaDataMapValid = false;
+
+  // The meta data header and the meta data are at the end of the body.
+  const unsigned char* end = m_Header + m_MessageSize;
+  if (m_MetaDataHeader == NULL || m_MetaData == NULL || m_Body == NULL ||
+      m_MetaDataHeader < m_Body || m_MetaDataHeader > m_MetaData || m_MetaData > end)
+    {
+    m_MetaDataStore.Clear();
+    return;
+    }
+  m_MetaDataStore.Attach(m_MetaDataHeader, m_MetaData - m_MetaDataHeader, m_MetaData, end - m_MetaData);
+}
+
+void MessageBase::DetachMetaData()
+{
+  ParseMetaData();
+  m_MetaDataStore.Detach();
+}
+
+void MessageBase::DiscardReceivedMetaData()
+{
+  if (m_IsMetaDataPending || m_MetaDataStore.IsAttached())
+    {
+    m_IsMetaDataPending = false;
+    m_MetaDataStore.Clear();
+    m_IsMetaDataMapValid = false;
+    }
+}
+
 bool MessageBase::PackExtendedHeader()
 {
   if( m_HeaderVersion == IGTL_HEADER_VERSION_2 )
@@ -351,62 +530,15 @@ bool MessageBase::PackMetaData()
 {
   if( m_HeaderVersion == IGTL_HEADER_VERSION_2 )
     {
-    if (m_MetaDataMap.size() > std::numeric_limits<igtl_uint16>::max())
+    DetachMetaData();
+    if (m_MetaDataStore.GetNumberOfEntries() > std::numeric_limits<igtl_uint16>::max())
       {
       return false;
       }
-    igtl_uint16 index_count = static_cast<igtl_uint16>(m_MetaDataMap.size()); // first two byte are the total number of meta data
-    if(igtl_is_little_endian())
-      {
-      index_count = BYTE_SWAP_INT16(index_count);
-      }
-
-    // Pack meta data header key/encoding/value trios
-    memcpy(m_MetaDataHeader, &index_count, META_DATA_INDEX_COUNT_SIZE);
 
-    if (m_MetaDataMap.size() > 0)
-      {
-      unsigned char* entryPointer = &m_MetaDataHeader[META_DATA_INDEX_COUNT_SIZE];
-      for (MetaDataMap::const_iterator it = m_MetaDataMap.begin(); it != m_MetaDataMap.end();++it)
-        {
-        igtl_metadata_header_entry entry;
-        entry.key_size = it->first.length();
-        entry.value_encoding = it->second.first;
-        entry.value_size = it->second.second.length();
-
-        if(igtl_is_little_endian())
-          {
-          entry.key_size = BYTE_SWAP_INT16(entry.key_size);
-          entry.value_encoding = BYTE_SWAP_INT16(entry.value_encoding);
-          entry.value_size = BYTE_SWAP_INT32(entry.value_size);
-          }
-        memcpy(&entryPointer[0], &entry.key_size, sizeof(igtlUint16));
-        memcpy(&entryPointer[2], &entry.value_encoding, sizeof(igtlUint16));
-        memcpy(&entryPointer[4], &entry.value_size, sizeof(igtlUint32));
-
-        entryPointer += sizeof(igtl_metadata_header_entry);
-        }
-
-      // Pack meta data key/value pairs
-      std::string key("");
-      std::string value("");
-
-      unsigned char* metaDataPointer = m_MetaData;
-      int i(0);
-      for (MetaDataMap::iterator it = m_MetaDataMap.begin(); it != m_MetaDataMap.end(); ++it, ++i)
-        {
-        memcpy(metaDataPointer, it->first.c_str(), it->first.length());
-        metaDataPointer += it->first.length();
-        memcpy(metaDataPointer, it->second.second.c_str(), it->second.second.length());
-        metaDataPointer += it->second.second.length();
-        }
-
-      return true;
-      }
-    else
-      {
-      return true;
-      }
+    // Pack meta data header key/encoding/value trios followed by the key/value pairs
+    m_MetaDataStore.Serialize(m_MetaDataHeader, m_MetaData);
+    return true;
     }
 
   return false;
@@ -441,53 +573,11 @@ bool MessageBase::UnpackMetaData()
 {
   if (m_HeaderVersion == IGTL_HEADER_VERSION_2)
     {
-    // Parse the header
-    igtl_uint16 index_count = 0; // first two byte are the total number of meta data
-    memcpy(&index_count, m_MetaDataHeader, META_DATA_INDEX_COUNT_SIZE);
-    if(igtl_is_little_endian())
-      {
-      index_count = BYTE_SWAP_INT16(index_count);
-      }
-
-    if( index_count == 0 )
-      {
-      return true;
-      }
-
-    std::vector<igtl_metadata_header_entry> metaDataEntries;
-    igtl_metadata_header_entry entry;
-    unsigned char* entryPointer = &m_MetaDataHeader[META_DATA_INDEX_COUNT_SIZE];
-    for (int i = 0; i < index_count; i++)
-      {
-      memcpy(&entry.key_size, &entryPointer[0], sizeof(igtlUint16));
-      memcpy(&entry.value_encoding, &entryPointer[2], sizeof(igtlUint16));
-      memcpy(&entry.value_size, &entryPointer[4], sizeof(igtlUint32));
-      if(igtl_is_little_endian())
-        {
-        entry.key_size = BYTE_SWAP_INT16(entry.key_size);
-        entry.value_encoding = BYTE_SWAP_INT16(entry.value_encoding);
-        entry.value_size = BYTE_SWAP_INT32(entry.value_size);
-        }
-      metaDataEntries.push_back(entry);
-
-      entryPointer += sizeof(igtl_metadata_header_entry);
-      }
-
-    // Parse the meta data
-    m_MetaDataMap.clear();
-
-    unsigned char* metaDataPointer = m_MetaData;
-    for (int i = 0; i < index_count; i++)
-      {
-      std::string key;
-      key.assign(metaDataPointer, metaDataPointer + metaDataEntries[i].key_size);
-      metaDataPointer += metaDataEntries[i].key_size;
-      std::string value;
-      value.assign(metaDataPointer, metaDataPointer + metaDataEntries[i].value_size);
-      metaDataPointer += metaDataEntries[i].value_size;
-      m_MetaDataMap[key] = std::pair<IANA_ENCODING_TYPE, std::string>((IANA_ENCODING_TYPE)metaDataEntries[i].value_encoding, value);
-      }
-
+    // The meta data is parsed by ParseMetaData() when first accessed, so
+    // receivers that do not read it do not pay for it.
+    m_MetaDataStore.Clear();
+    m_IsMetaDataPending = true;
+    m_IsMetaDataMapValid = false;
     return true;
     }
 
@@ -538,10 +628,37 @@ int MessageBase::Pack()
     return 0;
     }
 
+  igtl_uint64 startTime = Statistics::GetEnabled() ? Statistics::GetTime() : 0;
+
+#if OpenIGTLink_HEADER_VERSION >= 2
+  // The content is packed over the buffer the meta data may still refer to.
+  DetachMetaData();
+#endif
+
+  // Size of the part of the body preceding the content
+  igtl_uint64 contentOffset = 0;
+
 #if OpenIGTLink_HEADER_VERSION >= 2
   PackExtendedHeader();
+  if (m_HeaderVersion == IGTL_HEADER_VERSION_2)
+    {
+    contentOffset = sizeof(igtl_extended_header);
+    }
 #endif
 
+  // Start the running CRC. Child classes may feed the content to it while packing
+  // (see UpdateContentCRC()); otherwise the CRC is computed over the body below.
+  // Large bodies are checksummed with multiple threads after packing if enabled.
+  bool parallelCRC = m_CRCNumberOfThreads > 1 &&
+    contentOffset + CalculateContentBufferSize() >= m_ParallelCRCThreshold;
+  m_FeedContentCRC = !parallelCRC;
+  m_BodyCRC = crc64(0, 0, 0LL); // initial crc
+  m_ContentCRCSize = 0;
+  if (contentOffset > 0)
+    {
+    m_BodyCRC = crc64(m_Body, contentOffset, m_BodyCRC);
+    }
+
   // Derived classes will re-call allocate pack with their required content size
   PackContent();
 
@@ -554,7 +671,6 @@ int MessageBase::Pack()
   // pack header
   igtl_header* h = (igtl_header*) m_Header;
 
-  igtl_uint64 crc = crc64(0, 0, 0LL); // initial crc
   h->header_version   = m_HeaderVersion;
 
   igtl_uint64 ts  =  m_TimeStampSec & 0xFFFFFFFF;
@@ -562,7 +678,29 @@ int MessageBase::Pack()
 
   h->timestamp = ts;
   h->body_size = GetBufferBodySize();
-  h->crc       = crc64((unsigned char*)m_Body, h->body_size, crc);
+
+  igtl_uint64 contentSize = h->body_size - contentOffset;
+#if OpenIGTLink_HEADER_VERSION >= 2
+  if (m_HeaderVersion == IGTL_HEADER_VERSION_2)
+    {
+    contentSize -= GetMetaDataHeaderSize() + GetMetaDataSize();
+    }
+#endif
+
+  if (parallelCRC)
+    {
+    h->crc = ParallelCRC64(m_Body, h->body_size, crc64(0, 0, 0LL), m_CRCNumberOfThreads);
+    }
+  else if (m_ContentCRCSize == contentSize)
+    {
+    // The content has been fed while packing; only the meta data remains.
+    igtl_uint64 offset = contentOffset + contentSize;
+    h->crc = crc64((unsigned char*)&m_Body[offset], h->body_size - offset, m_BodyCRC);
+    }
+  else
+    {
+    h->crc = crc64((unsigned char*)m_Body, h->body_size, crc64(0, 0, 0LL));
+    }
 
   strncpy(h->name, m_SendMessageType.c_str(), 12);
 
@@ -570,6 +708,14 @@ int MessageBase::Pack()
 
   igtl_header_convert_byte_order(h);
 
+  if (startTime != 0)
+    {
+    TrafficStatistics* statistics = GetTypeStatistics(m_SendMessageType);
+    statistics->AddDuration(TrafficStatistics::Pack, Statistics::GetTime() - startTime);
+    statistics->Increment(TrafficStatistics::PackedMessages);
+    statistics->Increment(TrafficStatistics::PackedBytes, GetBufferSize());
+    }
+
   return 1;
 }
 
@@ -629,6 +775,29 @@ int MessageBase::GetBufferBodySize()
   return GetBufferSize() - IGTL_HEADER_SIZE;
 }
 
+int MessageBase::GetNumberOfBufferFragments()
+{
+  return 1;
+}
+
+void* MessageBase::GetBufferFragmentPointer(int id)
+{
+  if (id == 0)
+    {
+    return GetBufferPointer();
+    }
+  return NULL;
+}
+
+int MessageBase::GetBufferFragmentSize(int id)
+{
+  if (id == 0)
+    {
+    return GetBufferSize();
+    }
+  return 0;
+}
+
 int MessageBase::CalculateReceiveContentSize()
 {
 #if OpenIGTLink_HEADER_VERSION >= 2
@@ -660,6 +829,21 @@ int MessageBase::PackContent()
   return 0;
 }
 
+void MessageBase::UpdateContentCRC(const void* data, igtlUint64 size)
+{
+  if (!m_FeedContentCRC)
+    {
+    return;
+    }
+  m_BodyCRC = crc64((unsigned char*)data, size, m_BodyCRC);
+  m_ContentCRCSize += size;
+}
+
+igtlUint64* MessageBase::GetContentCRCPointer()
+{
+  return m_FeedContentCRC ? &m_BodyCRC : NULL;
+}
+
 int MessageBase::UnpackContent()
 {
   return 0;
@@ -695,20 +879,17 @@ void MessageBase::InitBuffer()
   if (m_Header == NULL)
     {
     // For the first time
-    m_Header = new unsigned char [message_size];
     m_IsHeaderUnpacked = false;
     m_IsBodyUnpacked = false;
     }
   else if (m_MessageSize != message_size)
     {
-    // If the pack area exists but needs to be reallocated
+    // If the pack area exists but the size changes
     // m_IsHeaderUnpacked status is not changed in this case.
-    unsigned char* old = m_Header;
-    m_Header = new unsigned char [message_size];
-    memcpy(m_Header, old, std::min<int>(m_MessageSize, message_size));
-    delete [] old;
     m_IsBodyUnpacked = false;
     }
+  // The buffer is kept for the body that follows the header.
+  ResizeBuffer(message_size, true);
   m_Body   = &m_Header[IGTL_HEADER_SIZE];
 #if OpenIGTLink_HEADER_VERSION >= 2
   if (m_HeaderVersion == IGTL_HEADER_VERSION_2)
@@ -745,21 +926,17 @@ void MessageBase::AllocateBuffer(int contentSize)
   if (m_Header == NULL)
     {
     // For the first time
-    m_Header = new unsigned char [message_size];
     m_IsHeaderUnpacked = false;
     m_IsBodyUnpacked = false;
     m_IsBodyPacked = false;
     }
   else if (m_MessageSize != message_size)
     {
-    // If the pack area exists but needs to be reallocated
+    // If the pack area exists but the size changes
     // m_IsHeaderUnpacked status is not changed in this case.
-    unsigned char* old = m_Header;
-    m_Header = new unsigned char [message_size];
-    memcpy(m_Header, old, std::min<int>(m_MessageSize, message_size));
-    delete [] old;
     m_IsBodyUnpacked = false;
     }
+  ResizeBuffer(message_size);
   m_Body   = &m_Header[IGTL_HEADER_SIZE];
 
 #if OpenIGTLink_HEADER_VERSION >= 2
@@ -876,16 +1053,37 @@ void MessageBase::UnpackBody(int crccheck, int& r)
   igtl_header* h   = (igtl_header*) m_Header;
   igtl_uint64  crc = crc64(0, 0, 0LL); // initial crc
 
+  igtl_uint64 startTime = Statistics::GetEnabled() ? Statistics::GetTime() : 0;
+  TrafficStatistics* statistics = NULL;
+  if (startTime != 0)
+    {
+    statistics = GetTypeStatistics(m_ReceiveMessageType);
+    }
+
   if (crccheck)
     {
     // Calculate CRC of the body
-    crc = crc64((unsigned char*)m_Body, m_BodySizeToRead, crc);
+    if (m_CRCNumberOfThreads > 1 && (igtlUint64)m_BodySizeToRead >= m_ParallelCRCThreshold)
+      {
+      crc = ParallelCRC64(m_Body, m_BodySizeToRead, crc, m_CRCNumberOfThreads);
+      }
+    else
+      {
+      crc = crc64((unsigned char*)m_Body, m_BodySizeToRead, crc);
+      }
     }
   else
     {
     crc = h->crc;
     }
 
+  if (statistics && crccheck)
+    {
+    igtl_uint64 crcTime = Statistics::GetTime();
+    statistics->AddDuration(TrafficStatistics::CRC, crcTime - startTime);
+    startTime = crcTime;
+    }
+
   if (crc == h->crc)
     {
     // Unpack (deserialize) the Body
@@ -898,15 +1096,39 @@ void MessageBase::UnpackBody(int crccheck, int& r)
 #endif
     m_IsBodyUnpacked = true;
     r |= UNPACK_BODY;
+    if (statistics)
+      {
+      statistics->AddDuration(TrafficStatistics::Unpack, Statistics::GetTime() - startTime);
+      statistics->Increment(TrafficStatistics::UnpackedMessages);
+      statistics->Increment(TrafficStatistics::UnpackedBytes, m_BodySizeToRead);
+      }
     }
   else
     {
     m_IsBodyUnpacked = false;
+    if (statistics)
+      {
+      statistics->Increment(TrafficStatistics::CRCErrors);
+      }
     }
 }
 
+TrafficStatistics* MessageBase::GetTypeStatistics(const std::string& type)
+{
+  // The lookup locks a global map; most messages are of one type all along.
+  if (m_TypeStatistics == NULL || m_TypeStatistics->GetName() != type)
+    {
+    m_TypeStatistics = Statistics::GetMessageTypeStatistics(type);
+    }
+  return m_TypeStatistics;
+}
+
 void MessageBase::AllocateUnpack(int bodySizeToRead)
 {
+#if OpenIGTLink_HEADER_VERSION >= 2
+  // The body of another message is about to be received into the buffer.
+  DiscardReceivedMetaData();
+#endif
   if (bodySizeToRead <= 0)
     {
     bodySizeToRead = 0;
@@ -918,21 +1140,17 @@ void MessageBase::AllocateUnpack(int bodySizeToRead)
   if (m_Header == NULL)
     {
     // For the first time
-    m_Header = new unsigned char [message_size];
     m_IsHeaderUnpacked = false;
     m_IsBodyUnpacked = false;
     m_IsBodyPacked = false;
     }
   else if (m_MessageSize != message_size)
     {
-    // If the pack area exists but needs to be reallocated
+    // If the pack area exists but the size changes
     // m_IsHeaderUnpacked status is not changed in this case.
-    unsigned char* old = m_Header;
-    m_Header = new unsigned char [message_size];
-    memcpy(m_Header, old, std::min<int>(m_MessageSize, message_size));
-    delete [] old;
     m_IsBodyUnpacked = false;
     }
+  ResizeBuffer(message_size);
   m_Body   = &m_Header[IGTL_HEADER_SIZE];
 
 #if OpenIGTLink_HEADER_VERSION >= 2
@@ -967,9 +1185,20 @@ int MessageBase::Copy(const MessageBase* mb)
     {
     // Set the header version before calling any functions, as it determines later behavior
     m_HeaderVersion = mb->m_HeaderVersion;
+#if OpenIGTLink_HEADER_VERSION >= 2
+    DiscardReceivedMetaData();
+#endif
 
     int bodySize = mb->m_MessageSize - IGTL_HEADER_SIZE;
-    AllocateBuffer(bodySize);
+    if (bodySize > 0)
+      {
+      AllocateBuffer(bodySize);
+      }
+    else
+      {
+      // Only the header (e.g. before receiving the body); the buffer is kept for the body.
+      InitBuffer();
+      }
     CopyHeader(mb);
     if (bodySize > 0)
       {
@@ -15,11 +15,14 @@
 #ifndef __igtlMessageBase_h
 #define __igtlMessageBase_h
 
+#include "igtlBufferAllocator.h"
 #include "igtlMacro.h"
 #include "igtlMath.h"
 #include "igtlMessageHeader.h"
+#include "igtlMetaDataStore.h"
 #include "igtlObject.h"
 #include "igtlObjectFactory.h"
+#include "igtlStatistics.h"
 #include "igtlTimeStamp.h"
 #include "igtl_header.h"
 #include "igtl_types.h"
@@ -156,6 +159,8 @@ namespace igtl
     bool GetMetaDataElement(const std::string& key, IANA_ENCODING_TYPE& encoding, std::string& value) const;
 
     /// Get meta data map
+    /// The map is built on the first call after the meta data has changed, so
+    /// GetMetaDataElement() is cheaper for looking up a few keys.
     const MetaDataMap& GetMetaData() const;
 
     /// Pack the extended header
@@ -170,6 +175,7 @@ namespace igtl
     bool UnpackExtendedHeader();
 
     /// Unpack Extended header and the meta data
+    /// The meta data is only parsed when it is first accessed.
     bool UnpackMetaData();
 #endif
 
@@ -205,6 +211,17 @@ namespace igtl
     ///                              deserialized
     int Unpack(int crccheck = 0);
 
+    /// Sets the number of threads used to compute the body CRC in Pack() and Unpack(1).
+    /// Bodies of at least GetParallelCRCThreshold() bytes are split into blocks that are
+    /// checksummed concurrently (see igtl::ParallelCRC64()); the CRC is identical to the
+    /// serial one. The default, 1, computes the CRC serially.
+    igtlSetMacro(CRCNumberOfThreads, int);
+    igtlGetConstMacro(CRCNumberOfThreads, int);
+
+    /// Sets the minimum body size (in bytes) for the multi-threaded CRC computation.
+    igtlSetMacro(ParallelCRCThreshold, igtlUint64);
+    igtlGetConstMacro(ParallelCRCThreshold, igtlUint64);
+
     /// Gets a pointer to the raw byte array for the serialized data including the header and the body.
     void* GetBufferPointer();
     void* GetPackPointer() { return GetBufferPointer(); }
@@ -221,6 +238,19 @@ namespace igtl
     int GetBufferBodySize();
     int GetPackBodySize() { return GetBufferBodySize(); }
 
+    /// Gets the number of fragments of the serialized message. Message classes that keep the
+    /// header and the body in separate memory areas (e.g. ImageMessage2) return more than one
+    /// fragment; all other classes return a single fragment covering the whole buffer.
+    /// Sending the fragments in order (e.g. with Socket::SendFragments()) produces the same
+    /// byte stream as sending GetBufferPointer()/GetBufferSize(), without concatenating them.
+    virtual int GetNumberOfBufferFragments();
+
+    /// Gets a pointer to the specified fragment of the serialized message.
+    virtual void* GetBufferFragmentPointer(int id);
+
+    /// Gets the size of the specified fragment of the serialized message.
+    virtual int GetBufferFragmentSize(int id);
+
     /// Calculate the size of the received content data
     /// Returns -1 if the extended header has not been properly initialized (meta data size, meta data header size, etc...)
     /// Used when receiving data, not sending
@@ -244,6 +274,18 @@ namespace igtl
     void InitBuffer();
     void InitPack() { InitBuffer(); }
 
+    /// Sets the allocator that provides the memory for the serialized message.
+    /// Messages use BufferAllocator::GetDefault() unless another allocator is set.
+    /// The current buffer, if any, is handed back to the previous allocator, so the
+    /// allocator should be set before the message is packed or received.
+    void SetBufferAllocator(BufferAllocator* allocator);
+    BufferAllocator* GetBufferAllocator() { return m_BufferAllocator; }
+
+    /// Hands the buffer back to the allocator, e.g. to return it to a pool while the
+    /// message object is kept for later use. The message must be allocated again
+    /// (InitPack(), AllocatePack() or Copy()) before it is used.
+    void ReleaseBuffer();
+
     /// Copy() copies contents from the specified Massage class.
     /// If the type of the specified class is the same as this class,
     /// general header and body are copied.
@@ -277,6 +319,22 @@ namespace igtl
     /// Size of body to allocate is determined from v1 message header field 'body_size'
     virtual void AllocateUnpack(int bodySizeToRead);
 
+    /// Makes m_Header hold at least 'messageSize' bytes, keeping the serialized data
+    /// up to the smaller of the old and the new size. The buffer is replaced if it is
+    /// too small, or if 'messageSize' is less than half of its capacity, so that
+    /// messages of similar size reuse it without copying, while a message that once
+    /// held a large body does not keep the allocation. If 'keepCapacity' is true
+    /// (e.g. only the header is needed before the next body), a large enough buffer
+    /// is always kept.
+    void ResizeBuffer(int messageSize, bool keepCapacity=false);
+
+    /// Transfers the buffer to a PinnedBuffer and returns it, so that BufferView objects
+    /// can refer to the received data after the message is deleted or reused. The message
+    /// keeps reading the buffer, but the next allocation (InitPack(), AllocatePack(), Copy(),
+    /// etc.) obtains a new buffer unless no view refers to the pinned one any more.
+    /// Returns NULL if the buffer has not been allocated by m_BufferAllocator.
+    LightObject* PinBuffer();
+
     /// Copies the serialized body data
     int CopyBody(const MessageBase* mb);
 
@@ -290,6 +348,21 @@ namespace igtl
     /// If it's a v3 message, body is ext header + content + metadataheader + metadata<optional>
     void UnpackBody(int crccheck, int& r);
 
+    /// Returns the igtl::Statistics entry of the message type 'type'.
+    TrafficStatistics* GetTypeStatistics(const std::string& type);
+
+    /// Feeds 'size' bytes of the serialized content to the running body CRC. Child classes
+    /// may call this from PackContent() right after writing each chunk of the content, in
+    /// the order of the byte stream. If the chunks cover the whole content, Pack() does not
+    /// make a second pass over the content to compute the CRC.
+    void UpdateContentCRC(const void* data, igtlUint64 size);
+
+    /// Returns a pointer to the running body CRC for C packers that update it themselves
+    /// (e.g. igtl_ndarray_pack_crc64()), or NULL if the CRC is not computed while packing
+    /// because the body is checksummed with multiple threads afterwards. When a pointer is
+    /// returned, the packed size must be added to m_ContentCRCSize.
+    igtlUint64* GetContentCRCPointer();
+
   protected:
     int            m_MessageSize;
 
@@ -340,6 +413,36 @@ namespace igtl
     /// Packing (serialization) status for the body
     bool           m_IsBodyPacked;
 
+    /// Running CRC of the body while Pack() is in progress. It covers the extended header
+    /// and the first m_ContentCRCSize bytes of the content. PackContent() updates it through
+    /// UpdateContentCRC() or GetContentCRCPointer().
+    igtlUint64     m_BodyCRC;
+
+    /// Number of content bytes included in m_BodyCRC.
+    igtlUint64     m_ContentCRCSize;
+
+    /// True if PackContent() feeds the content to m_BodyCRC.
+    bool           m_FeedContentCRC;
+
+    /// Number of threads for the body CRC computation.
+    int            m_CRCNumberOfThreads;
+
+    /// Minimum body size for the multi-threaded CRC computation.
+    igtlUint64     m_ParallelCRCThreshold;
+
+    /// Allocator of m_Header.
+    BufferAllocator::Pointer m_BufferAllocator;
+
+    /// Allocated size of m_Header; may be larger than m_MessageSize. Zero if m_Header
+    /// has not been allocated by m_BufferAllocator.
+    igtlUint64     m_BufferCapacity;
+
+    /// Owner of m_Header while views into the buffer may exist (see PinBuffer()).
+    PinnedBuffer::Pointer m_PinnedBuffer;
+
+    /// Statistics of the last message type packed or unpacked; see GetTypeStatistics().
+    TrafficStatistics*    m_TypeStatistics;
+
 #if OpenIGTLink_HEADER_VERSION >= 2
   protected:
     /// A pointer to the serialized extended header.
@@ -357,8 +460,29 @@ namespace igtl
     /// Message ID
     igtlUint32                                                                m_MessageId;
 
-    /// Map storing the key value pairs
-    MetaDataMap                                                               m_MetaDataMap;
+    /// Meta data elements. The keys and values of a received message are parsed on first
+    /// access and refer to the message buffer until the buffer is reused or released.
+    mutable MetaDataStore                                                     m_MetaDataStore;
+
+    /// True if the meta data of a received message has not been parsed yet.
+    mutable bool                                                              m_IsMetaDataPending;
+
+    /// Map of the key value pairs, built from m_MetaDataStore by GetMetaData()
+    mutable MetaDataMap                                                       m_MetaDataMap;
+
+    /// True if m_MetaDataMap is up to date.
+    mutable bool                                                              m_IsMetaDataMapValid;
+
+    /// Parses the meta data of a received message into m_MetaDataStore.
+    void ParseMetaData() const;
+
+    /// Copies the keys and values of a received message out of the buffer.
+    /// Called before the buffer is modified or released.
+    void DetachMetaData();
+
+    /// Discards the meta data of a received message before another message
+    /// is copied or received into the buffer.
+    void DiscardReceivedMetaData();
 
 #endif // if OpenIGTLink_HEADER_VERSION >= 2
 
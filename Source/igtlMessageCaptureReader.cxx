@@ -0,0 +1,524 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMessageCaptureReader.h"
+#include "igtlMessageHeader.h"
+
+#include "igtl_header.h"
+#include "igtl_util.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  #include <windows.h>
+#elif defined(OpenIGTLink_HAVE_MMAP)
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define IGTL_CAPTURE_USE_MMAP
+#endif
+
+namespace igtl
+{
+
+namespace
+{
+
+// Reads a number in network byte order.
+igtlUint64 GetUint64(const unsigned char* p)
+{
+  igtlUint64 value;
+  memcpy(&value, p, sizeof(value));
+  if (igtl_is_little_endian())
+    {
+    value = BYTE_SWAP_INT64(value);
+    }
+  return value;
+}
+
+igtlUint32 GetUint32(const unsigned char* p)
+{
+  igtlUint32 value;
+  memcpy(&value, p, sizeof(value));
+  if (igtl_is_little_endian())
+    {
+    value = BYTE_SWAP_INT32(value);
+    }
+  return value;
+}
+
+// Offset of the body size in the message header
+#define IGTL_CAPTURE_BODY_SIZE_OFFSET  42
+
+// Hands out a copy-on-write mapping of one record as the buffer of a
+// message. Other requests (e.g. for the header before the body size is
+// known) are served from the heap. The mapping is removed when the message
+// releases its buffer.
+class MappedRecordAllocator: public BufferAllocator
+{
+public:
+  igtlTypeMacro(MappedRecordAllocator, igtl::BufferAllocator)
+  igtlNewMacro(MappedRecordAllocator);
+
+  void SetView(void* view, igtlUint64 viewSize, unsigned char* record, igtlUint64 recordSize)
+  {
+    this->m_View = view;
+    this->m_ViewSize = viewSize;
+    this->m_Record = record;
+    this->m_RecordSize = recordSize;
+  }
+
+  bool IsHandedOut() { return this->m_HandedOut; }
+
+  virtual unsigned char* Allocate(igtlUint64 size, igtlUint64* capacity)
+  {
+    if (this->m_View && !this->m_HandedOut && size == this->m_RecordSize)
+      {
+      this->m_HandedOut = true;
+      *capacity = size;
+      return this->m_Record;
+      }
+    return BufferAllocator::Allocate(size, capacity);
+  }
+
+  virtual void Release(unsigned char* buffer, igtlUint64 capacity)
+  {
+    if (this->m_HandedOut && buffer == this->m_Record)
+      {
+      this->Unmap();
+      return;
+      }
+    BufferAllocator::Release(buffer, capacity);
+  }
+
+protected:
+  MappedRecordAllocator()
+  {
+    this->m_View = NULL;
+    this->m_ViewSize = 0;
+    this->m_Record = NULL;
+    this->m_RecordSize = 0;
+    this->m_HandedOut = false;
+  }
+
+  ~MappedRecordAllocator()
+  {
+    this->Unmap();
+  }
+
+  void Unmap()
+  {
+    if (this->m_View)
+      {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+      UnmapViewOfFile(this->m_View);
+#elif defined(IGTL_CAPTURE_USE_MMAP)
+      munmap(this->m_View, (size_t)this->m_ViewSize);
+#endif
+      this->m_View = NULL;
+      this->m_Record = NULL;
+      }
+  }
+
+  void*          m_View;
+  igtlUint64     m_ViewSize;
+  unsigned char* m_Record;
+  igtlUint64     m_RecordSize;
+  bool           m_HandedOut;
+};
+
+}
+
+
+//-----------------------------------------------------------------------------
+MessageCaptureReader::MessageCaptureReader()
+{
+  this->m_Data = NULL;
+  this->m_Size = 0;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  this->m_FileHandle = INVALID_HANDLE_VALUE;
+  this->m_MappingHandle = NULL;
+#else
+  this->m_FileDescriptor = -1;
+#endif
+  this->m_IsCopied = false;
+  this->m_IndexRecovered = false;
+  this->m_MessageFactory = MessageFactory::New();
+  this->m_MappingThreshold = 64 * 1024;
+}
+
+
+//-----------------------------------------------------------------------------
+MessageCaptureReader::~MessageCaptureReader()
+{
+  this->Close();
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureReader::Open(const char* filename)
+{
+  this->Close();
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  this->m_FileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                   NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  LARGE_INTEGER size;
+  if (this->m_FileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->m_FileHandle, &size) ||
+      (igtlUint64)size.QuadPart < IGTL_CAPTURE_FILE_HEADER_SIZE)
+    {
+    this->Close();
+    return -1;
+    }
+  this->m_Size = (igtlUint64)size.QuadPart;
+  this->m_MappingHandle = CreateFileMappingA(this->m_FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (this->m_MappingHandle)
+    {
+    this->m_Data = (const unsigned char*)MapViewOfFile(this->m_MappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+#elif defined(IGTL_CAPTURE_USE_MMAP)
+  this->m_FileDescriptor = open(filename, O_RDONLY);
+  struct stat st;
+  if (this->m_FileDescriptor < 0 || fstat(this->m_FileDescriptor, &st) != 0 ||
+      (igtlUint64)st.st_size < IGTL_CAPTURE_FILE_HEADER_SIZE)
+    {
+    this->Close();
+    return -1;
+    }
+  this->m_Size = (igtlUint64)st.st_size;
+  void* data = mmap(NULL, (size_t)this->m_Size, PROT_READ, MAP_SHARED, this->m_FileDescriptor, 0);
+  if (data != MAP_FAILED)
+    {
+    this->m_Data = (const unsigned char*)data;
+    }
+#else
+  FILE* file = fopen(filename, "rb");
+  if (file && fseek(file, 0, SEEK_END) == 0)
+    {
+    long size = ftell(file);
+    if (size >= IGTL_CAPTURE_FILE_HEADER_SIZE && fseek(file, 0, SEEK_SET) == 0)
+      {
+      unsigned char* data = new unsigned char[size];
+      if (fread(data, 1, size, file) == (size_t)size)
+        {
+        this->m_Data = data;
+        this->m_Size = size;
+        this->m_IsCopied = true;
+        }
+      else
+        {
+        delete [] data;
+        }
+      }
+    }
+  if (file)
+    {
+    fclose(file);
+    }
+#endif
+
+  if (this->m_Data == NULL ||
+      memcmp(this->m_Data, IGTL_CAPTURE_FILE_MAGIC, 8) != 0 ||
+      GetUint32(&this->m_Data[8]) != IGTL_CAPTURE_VERSION)
+    {
+    this->Close();
+    return -1;
+    }
+
+  if (!this->ReadIndex())
+    {
+    this->m_IndexRecovered = true;
+    this->ScanRecords(this->m_Size);
+    }
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureReader::Close()
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  if (this->m_Data)
+    {
+    UnmapViewOfFile(this->m_Data);
+    }
+  if (this->m_MappingHandle)
+    {
+    CloseHandle(this->m_MappingHandle);
+    this->m_MappingHandle = NULL;
+    }
+  if (this->m_FileHandle != INVALID_HANDLE_VALUE)
+    {
+    CloseHandle(this->m_FileHandle);
+    this->m_FileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+  if (this->m_Data && this->m_IsCopied)
+    {
+    delete [] this->m_Data;
+    }
+#if defined(IGTL_CAPTURE_USE_MMAP)
+  else if (this->m_Data)
+    {
+    munmap((void*)this->m_Data, (size_t)this->m_Size);
+    }
+  if (this->m_FileDescriptor >= 0)
+    {
+    close(this->m_FileDescriptor);
+    this->m_FileDescriptor = -1;
+    }
+#endif
+#endif
+  this->m_Data = NULL;
+  this->m_Size = 0;
+  this->m_IsCopied = false;
+  this->m_IndexRecovered = false;
+  this->m_Offsets.clear();
+  this->m_Times.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 MessageCaptureReader::GetMessageTime(int i)
+{
+  if (i < 0 || i >= (int)this->m_Times.size())
+    {
+    return 0;
+    }
+  return this->m_Times[i];
+}
+
+
+//-----------------------------------------------------------------------------
+const void* MessageCaptureReader::GetMessagePointer(int i)
+{
+  if (i < 0 || i >= (int)this->m_Offsets.size())
+    {
+    return NULL;
+    }
+  return &this->m_Data[this->m_Offsets[i] + IGTL_CAPTURE_RECORD_HEADER_SIZE];
+}
+
+
+//-----------------------------------------------------------------------------
+igtlUint64 MessageCaptureReader::GetMessageSize(int i)
+{
+  if (i < 0 || i >= (int)this->m_Offsets.size())
+    {
+    return 0;
+    }
+  return GetUint64(&this->m_Data[this->m_Offsets[i] + 8]);
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureReader::FindMessage(igtlUint64 time)
+{
+  // The receive times of a capture are in order unless the clock has been
+  // set back; lower_bound() then finds one of the candidates.
+  return (int)(std::lower_bound(this->m_Times.begin(), this->m_Times.end(), time) - this->m_Times.begin());
+}
+
+
+//-----------------------------------------------------------------------------
+MessageBase::Pointer MessageCaptureReader::CreateMessage(int i)
+{
+  if (i < 0 || i >= (int)this->m_Offsets.size())
+    {
+    return NULL;
+    }
+
+  igtlUint64 offset = this->m_Offsets[i] + IGTL_CAPTURE_RECORD_HEADER_SIZE;
+  igtlUint64 size = this->GetMessageSize(i);
+  const unsigned char* record = &this->m_Data[offset];
+
+  MessageHeader::Pointer header = MessageHeader::New();
+  header->InitBuffer();
+  memcpy(header->GetBufferPointer(), record, IGTL_HEADER_SIZE);
+  header->Unpack();
+
+  if (!this->m_MessageFactory->IsValid(header))
+    {
+    return NULL;
+    }
+#if OpenIGTLink_HEADER_VERSION >= 2
+  std::string messageType(header->GetMessageType());
+#else
+  std::string messageType(header->GetDeviceType());
+#endif
+  std::transform(messageType.begin(), messageType.end(), messageType.begin(), ::toupper);
+  MessageBase::Pointer message = this->m_MessageFactory->GetMessageTypeNewPointer(messageType)();
+
+  // A large body is mapped; the message allocates the record size once it
+  // knows the body size from the header.
+  igtlUint64 bodySize = size - IGTL_HEADER_SIZE;
+  BufferAllocator::Pointer allocator;
+  if (bodySize > 0 && bodySize >= this->m_MappingThreshold)
+    {
+    allocator = this->MapRecord(offset, size);
+    }
+  if (allocator.IsNotNull())
+    {
+    message->SetBufferAllocator(allocator);
+    }
+
+  message->SetMessageHeader(header);
+  message->AllocateBuffer();
+
+  if (allocator.IsNull() || !static_cast<MappedRecordAllocator*>(allocator.GetPointer())->IsHandedOut())
+    {
+    memcpy(message->GetBufferBodyPointer(), record + IGTL_HEADER_SIZE, (size_t)bodySize);
+    }
+  return message;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureReader::SetMessageFactory(MessageFactory* factory)
+{
+  this->m_MessageFactory = factory ? factory : MessageFactory::New().GetPointer();
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureReader::ReadIndex()
+{
+  if (this->m_Size < IGTL_CAPTURE_FILE_HEADER_SIZE + IGTL_CAPTURE_TRAILER_SIZE)
+    {
+    return 0;
+    }
+  const unsigned char* trailer = &this->m_Data[this->m_Size - IGTL_CAPTURE_TRAILER_SIZE];
+  if (memcmp(&trailer[16], IGTL_CAPTURE_INDEX_MAGIC, 8) != 0)
+    {
+    return 0;
+    }
+  igtlUint64 indexOffset = GetUint64(&trailer[0]);
+  igtlUint64 count = GetUint64(&trailer[8]);
+  if (indexOffset < IGTL_CAPTURE_FILE_HEADER_SIZE ||
+      indexOffset > this->m_Size - IGTL_CAPTURE_TRAILER_SIZE ||
+      count != (this->m_Size - IGTL_CAPTURE_TRAILER_SIZE - indexOffset) / IGTL_CAPTURE_INDEX_ENTRY_SIZE)
+    {
+    return 0;
+    }
+
+  const unsigned char* entry = &this->m_Data[indexOffset];
+  for (igtlUint64 i = 0; i < count; i ++, entry += IGTL_CAPTURE_INDEX_ENTRY_SIZE)
+    {
+    igtlUint64 offset = GetUint64(&entry[0]);
+    if (!this->IsValidRecord(offset, indexOffset))
+      {
+      this->m_Offsets.clear();
+      this->m_Times.clear();
+      return 0;
+      }
+    this->m_Offsets.push_back(offset);
+    this->m_Times.push_back(GetUint64(&entry[8]));
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureReader::ScanRecords(igtlUint64 end)
+{
+  // Stops at the first incomplete record, e.g. the one being written when
+  // the writer has been terminated.
+  igtlUint64 offset = IGTL_CAPTURE_FILE_HEADER_SIZE;
+  while (this->IsValidRecord(offset, end))
+    {
+    igtlUint64 size = GetUint64(&this->m_Data[offset + 8]);
+    this->m_Offsets.push_back(offset);
+    this->m_Times.push_back(GetUint64(&this->m_Data[offset]));
+    igtlUint64 padded = (size + IGTL_CAPTURE_ALIGNMENT - 1) / IGTL_CAPTURE_ALIGNMENT * IGTL_CAPTURE_ALIGNMENT;
+    offset += IGTL_CAPTURE_RECORD_HEADER_SIZE + padded;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureReader::IsValidRecord(igtlUint64 offset, igtlUint64 end)
+{
+  if (offset < IGTL_CAPTURE_FILE_HEADER_SIZE || end > this->m_Size || offset > end ||
+      end - offset < IGTL_CAPTURE_RECORD_HEADER_SIZE + IGTL_HEADER_SIZE)
+    {
+    return 0;
+    }
+  igtlUint64 size = GetUint64(&this->m_Data[offset + 8]);
+  const unsigned char* message = &this->m_Data[offset + IGTL_CAPTURE_RECORD_HEADER_SIZE];
+  igtlUint64 bodySize = GetUint64(&message[IGTL_CAPTURE_BODY_SIZE_OFFSET]);
+  return (size >= IGTL_HEADER_SIZE &&
+          size <= end - offset - IGTL_CAPTURE_RECORD_HEADER_SIZE &&
+          bodySize == size - IGTL_HEADER_SIZE) ? 1 : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+BufferAllocator::Pointer MessageCaptureReader::MapRecord(igtlUint64 offset, igtlUint64 size)
+{
+  void* view = NULL;
+  igtlUint64 delta = 0;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  if (this->m_MappingHandle)
+    {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    delta = offset % info.dwAllocationGranularity;
+    igtlUint64 start = offset - delta;
+    view = MapViewOfFile(this->m_MappingHandle, FILE_MAP_COPY, (DWORD)(start >> 32),
+                         (DWORD)(start & 0xFFFFFFFF), (SIZE_T)(delta + size));
+    }
+#elif defined(IGTL_CAPTURE_USE_MMAP)
+  if (!this->m_IsCopied)
+    {
+    igtlUint64 pageSize = (igtlUint64)sysconf(_SC_PAGESIZE);
+    delta = offset % pageSize;
+    view = mmap(NULL, (size_t)(delta + size), PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                this->m_FileDescriptor, (off_t)(offset - delta));
+    if (view == MAP_FAILED)
+      {
+      view = NULL;
+      }
+    }
+#endif
+
+  if (view == NULL)
+    {
+    return NULL;
+    }
+  MappedRecordAllocator::Pointer allocator = MappedRecordAllocator::New();
+  allocator->SetView(view, delta + size, (unsigned char*)view + delta, size);
+  return BufferAllocator::Pointer(allocator.GetPointer());
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureReader::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  std::string indent = "    ";
+
+  os << indent << "File size: " << this->m_Size << std::endl;
+  os << indent << "Number of messages: " << this->m_Offsets.size() << std::endl;
+  os << indent << "Index recovered: " << (this->m_IndexRecovered ? "yes" : "no") << std::endl;
+  os << indent << "Mapping threshold: " << this->m_MappingThreshold << std::endl;
+}
+
+} // namespace igtl
@@ -0,0 +1,146 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlMessageCaptureReader_h
+#define __igtlMessageCaptureReader_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlMessageBase.h"
+#include "igtlMessageFactory.h"
+#include "igtlMessageCaptureWriter.h"
+
+#include <vector>
+
+namespace igtl
+{
+
+/// MessageCaptureReader reads the capture files written by
+/// igtl::MessageCaptureWriter. The file is mapped into memory, so the packed
+/// messages can be accessed (e.g. re-sent by igtl::MessageReplayer) without
+/// reading or copying them:
+///
+///     igtl::MessageCaptureReader::Pointer reader = igtl::MessageCaptureReader::New();
+///     if (reader->Open("session.igtlcap") < 0) { ... }
+///     for (int i = 0; i < reader->GetNumberOfMessages(); i ++)
+///       {
+///       igtl::MessageBase::Pointer message = reader->CreateMessage(i);
+///       igtl::ImageMessage* image = dynamic_cast<igtl::ImageMessage*>(message.GetPointer());
+///       if (image && (image->Unpack(1) & igtl::MessageHeader::UNPACK_BODY)) { ... }
+///       }
+///
+/// CreateMessage() returns a message whose header is unpacked and whose body is
+/// ready to be unpacked, like a message created by
+/// MessageFactory::CreateReceiveMessage() and received from a socket. Bodies
+/// of at least GetMappingThreshold() bytes (e.g. images and video frames) are
+/// not copied: the message buffer is a copy-on-write mapping of the record,
+/// so only the pages modified by Unpack() (which converts the byte order in
+/// place) are copied. Smaller bodies are copied, which is faster than
+/// mapping them. Messages stay valid after the reader has been closed.
+class IGTLCommon_EXPORT MessageCaptureReader: public Object
+{
+public:
+  igtlTypeMacro(igtl::MessageCaptureReader, igtl::Object)
+  igtlNewMacro(igtl::MessageCaptureReader);
+
+  /// Opens a capture file and reads its index, or rebuilds it if the file
+  /// has not been closed by the writer. Returns 0 on success, -1 if the file
+  /// cannot be opened or is not a capture file.
+  int Open(const char* filename);
+
+  void Close();
+
+  bool IsOpen() { return this->m_Data != NULL; }
+
+  /// Returns true if the index has been rebuilt from the records.
+  bool GetIndexRecovered() { return this->m_IndexRecovered; }
+
+  int GetNumberOfMessages() { return (int)this->m_Offsets.size(); }
+
+  /// Returns the receive time of the i-th message in nanoseconds since 1970.
+  igtlUint64 GetMessageTime(int i);
+
+  /// Returns the i-th packed message (header and body in network byte
+  /// order) and its size. The pointer is valid until Close().
+  const void* GetMessagePointer(int i);
+  igtlUint64  GetMessageSize(int i);
+
+  /// Returns the index of the first message received at or after 'time',
+  /// or GetNumberOfMessages() if there is none.
+  int FindMessage(igtlUint64 time);
+
+  /// Returns the i-th message; see the class description. Returns NULL if
+  /// 'i' is out of range or the message type is not known to the message
+  /// factory.
+  MessageBase::Pointer CreateMessage(int i);
+
+  /// Sets the factory used by CreateMessage(). A default factory with the
+  /// standard message types is used unless another one is set.
+  void SetMessageFactory(MessageFactory* factory);
+  MessageFactory* GetMessageFactory() { return this->m_MessageFactory; }
+
+  /// Bodies of at least this size are mapped instead of copied by
+  /// CreateMessage(). The default is 64 KB.
+  igtlSetMacro(MappingThreshold, igtlUint64);
+  igtlGetConstMacro(MappingThreshold, igtlUint64);
+
+protected:
+  MessageCaptureReader();
+  ~MessageCaptureReader();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Reads the index at the end of the file. Returns 0 if it is missing or
+  /// invalid.
+  int ReadIndex();
+
+  /// Rebuilds the index from the records up to 'end'.
+  void ScanRecords(igtlUint64 end);
+
+  /// Returns 1 if a complete record starts at 'offset' and ends before 'end'.
+  int IsValidRecord(igtlUint64 offset, igtlUint64 end);
+
+  /// Returns an allocator that hands out a copy-on-write mapping of the
+  /// given part of the file, or NULL if it cannot be mapped.
+  BufferAllocator::Pointer MapRecord(igtlUint64 offset, igtlUint64 size);
+
+  const unsigned char*    m_Data;
+  igtlUint64              m_Size;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  void*                   m_FileHandle;
+  void*                   m_MappingHandle;
+#else
+  int                     m_FileDescriptor;
+#endif
+  /// Set if the file has been read into memory instead of being mapped.
+  bool                    m_IsCopied;
+
+  std::vector<igtlUint64> m_Offsets;
+  std::vector<igtlUint64> m_Times;
+  bool                    m_IndexRecovered;
+
+  MessageFactory::Pointer m_MessageFactory;
+  igtlUint64              m_MappingThreshold;
+
+private:
+  MessageCaptureReader(const MessageCaptureReader&); // Not implemented.
+  void operator=(const MessageCaptureReader&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlMessageCaptureReader_h
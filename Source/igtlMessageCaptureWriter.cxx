@@ -0,0 +1,268 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMessageCaptureWriter.h"
+
+#include "igtl_header.h"
+#include "igtl_util.h"
+
+#include <string.h>
+
+namespace igtl
+{
+
+namespace
+{
+
+// Stores 'value' at 'p' in network byte order.
+void PutUint64(unsigned char* p, igtlUint64 value)
+{
+  if (igtl_is_little_endian())
+    {
+    value = BYTE_SWAP_INT64(value);
+    }
+  memcpy(p, &value, sizeof(value));
+}
+
+void PutUint32(unsigned char* p, igtlUint32 value)
+{
+  if (igtl_is_little_endian())
+    {
+    value = BYTE_SWAP_INT32(value);
+    }
+  memcpy(p, &value, sizeof(value));
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+MessageCaptureWriter::MessageCaptureWriter()
+{
+  this->m_File = NULL;
+  this->m_Offset = 0;
+  this->m_TimeStamp = TimeStamp::New();
+}
+
+
+//-----------------------------------------------------------------------------
+MessageCaptureWriter::~MessageCaptureWriter()
+{
+  this->Close();
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::Open(const char* filename)
+{
+  this->Close();
+
+  this->m_Lock.Lock();
+  this->m_File = fopen(filename, "wb");
+  if (this->m_File == NULL)
+    {
+    this->m_Lock.Unlock();
+    return -1;
+    }
+  this->m_Offset = 0;
+  this->m_Index.clear();
+
+  unsigned char header[IGTL_CAPTURE_FILE_HEADER_SIZE];
+  memcpy(header, IGTL_CAPTURE_FILE_MAGIC, 8);
+  PutUint32(&header[8], IGTL_CAPTURE_VERSION);
+  PutUint32(&header[12], 0);
+  int r = this->WriteData(header, sizeof(header));
+  this->m_Lock.Unlock();
+
+  if (!r)
+    {
+    this->Close();
+    return -1;
+    }
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureWriter::Close()
+{
+  this->m_Lock.Lock();
+  if (this->m_File)
+    {
+    // The index follows the last record; the trailer at the end of the
+    // file points to it.
+    igtlUint64 indexOffset = this->m_Offset;
+    std::vector<unsigned char> index(this->m_Index.size() * 8 + IGTL_CAPTURE_TRAILER_SIZE);
+    for (size_t i = 0; i < this->m_Index.size(); i ++)
+      {
+      PutUint64(&index[i * 8], this->m_Index[i]);
+      }
+    unsigned char* trailer = &index[this->m_Index.size() * 8];
+    PutUint64(&trailer[0], indexOffset);
+    PutUint64(&trailer[8], this->m_Index.size() / 2);
+    memcpy(&trailer[16], IGTL_CAPTURE_INDEX_MAGIC, 8);
+    if (this->WriteData(&index[0], index.size()))
+      {
+      fclose(this->m_File);
+      this->m_File = NULL;
+      }
+    }
+  this->m_Index.clear();
+  this->m_Lock.Unlock();
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::WriteMessage(MessageBase* message, igtlUint64 time)
+{
+  if (message == NULL)
+    {
+    return 0;
+    }
+
+  int n = message->GetNumberOfBufferFragments();
+  std::vector<const void*> fragments(n);
+  std::vector<igtlUint64> sizes(n);
+  for (int i = 0; i < n; i ++)
+    {
+    fragments[i] = message->GetBufferFragmentPointer(i);
+    sizes[i] = message->GetBufferFragmentSize(i);
+    }
+
+  this->m_Lock.Lock();
+  int r = this->WriteRecord(&fragments[0], &sizes[0], n, time);
+  this->m_Lock.Unlock();
+  return r;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::WriteMessage(const void* header, const void* body, igtlUint64 bodySize,
+                                       igtlUint64 time)
+{
+  const void* fragments[2];
+  igtlUint64  sizes[2];
+  fragments[0] = header;
+  sizes[0] = IGTL_HEADER_SIZE;
+  fragments[1] = body;
+  sizes[1] = bodySize;
+
+  this->m_Lock.Lock();
+  int r = this->WriteRecord(fragments, sizes, bodySize > 0 ? 2 : 1, time);
+  this->m_Lock.Unlock();
+  return r;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::Flush()
+{
+  this->m_Lock.Lock();
+  int r = (this->m_File && fflush(this->m_File) == 0) ? 0 : -1;
+  this->m_Lock.Unlock();
+  return r;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::GetNumberOfMessages()
+{
+  this->m_Lock.Lock();
+  int n = (int)(this->m_Index.size() / 2);
+  this->m_Lock.Unlock();
+  return n;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::WriteRecord(const void* const* fragments, const igtlUint64* sizes,
+                                      int numberOfFragments, igtlUint64 time)
+{
+  if (this->m_File == NULL)
+    {
+    return 0;
+    }
+
+  igtlUint64 size = 0;
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    size += sizes[i];
+    }
+  if (size < IGTL_HEADER_SIZE)
+    {
+    return 0;
+    }
+
+  if (time == 0)
+    {
+    this->m_TimeStamp->GetTime();
+    time = this->m_TimeStamp->GetTimeStampInNanoseconds();
+    }
+
+  igtlUint64 offset = this->m_Offset;
+  unsigned char recordHeader[IGTL_CAPTURE_RECORD_HEADER_SIZE];
+  PutUint64(&recordHeader[0], time);
+  PutUint64(&recordHeader[8], size);
+  if (!this->WriteData(recordHeader, sizeof(recordHeader)))
+    {
+    return 0;
+    }
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    if (!this->WriteData(fragments[i], sizes[i]))
+      {
+      return 0;
+      }
+    }
+  static const unsigned char padding[IGTL_CAPTURE_ALIGNMENT] = { 0 };
+  igtlUint64 remainder = size % IGTL_CAPTURE_ALIGNMENT;
+  if (remainder > 0 && !this->WriteData(padding, IGTL_CAPTURE_ALIGNMENT - remainder))
+    {
+    return 0;
+    }
+
+  this->m_Index.push_back(offset);
+  this->m_Index.push_back(time);
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageCaptureWriter::WriteData(const void* data, igtlUint64 size)
+{
+  if (size > 0 && fwrite(data, 1, (size_t)size, this->m_File) != (size_t)size)
+    {
+    // The file ends with an incomplete record; the reader skips it.
+    fclose(this->m_File);
+    this->m_File = NULL;
+    return 0;
+    }
+  this->m_Offset += size;
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageCaptureWriter::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  std::string indent = "    ";
+
+  os << indent << "Open: " << (this->m_File ? "yes" : "no") << std::endl;
+  os << indent << "Number of messages: " << this->m_Index.size() / 2 << std::endl;
+  os << indent << "File size: " << this->m_Offset << std::endl;
+}
+
+} // namespace igtl
@@ -0,0 +1,125 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlMessageCaptureWriter_h
+#define __igtlMessageCaptureWriter_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlMessageBase.h"
+#include "igtlMutexLock.h"
+#include "igtlTimeStamp.h"
+
+#include <stdio.h>
+#include <vector>
+
+// Layout of the capture files; see MessageCaptureWriter.
+#define IGTL_CAPTURE_FILE_MAGIC          "IGTLCAPT"
+#define IGTL_CAPTURE_INDEX_MAGIC         "IGTLCIDX"
+#define IGTL_CAPTURE_VERSION             1
+#define IGTL_CAPTURE_FILE_HEADER_SIZE    16
+#define IGTL_CAPTURE_RECORD_HEADER_SIZE  16
+#define IGTL_CAPTURE_INDEX_ENTRY_SIZE    16
+#define IGTL_CAPTURE_TRAILER_SIZE        24
+#define IGTL_CAPTURE_ALIGNMENT           8
+
+namespace igtl
+{
+
+/// MessageCaptureWriter records packed messages, each with the time it has
+/// been received, to a capture file that can be read with
+/// igtl::MessageCaptureReader and re-sent with igtl::MessageReplayer.
+///
+/// The messages are appended to the file as they are written; Close() then
+/// appends an index of the messages, so that the reader can seek to any
+/// message without scanning the file. If the program ends without closing
+/// the file, the reader rebuilds the index from the messages.
+///
+/// The format, with all numbers in network byte order as in the protocol:
+///
+///     file header     "IGTLCAPT", uint32 version (1), uint32 reserved
+///     record          uint64 receive time (ns since 1970), uint64 size,
+///                     the message (header and body) as sent, zero padding
+///                     to a multiple of 8 bytes
+///     ...
+///     index           uint64 offset of the record, uint64 receive time
+///     ...             (one entry per record)
+///     trailer         uint64 offset of the index, uint64 number of
+///                     entries, "IGTLCIDX"
+///
+/// A writer can be shared by several threads, e.g. by the connections of
+/// an igtl::EventLoopServer (see EventLoopServer::SetCaptureWriter()).
+class IGTLCommon_EXPORT MessageCaptureWriter: public Object
+{
+public:
+  igtlTypeMacro(igtl::MessageCaptureWriter, igtl::Object)
+  igtlNewMacro(igtl::MessageCaptureWriter);
+
+  /// Creates (or truncates) a capture file. Returns 0 on success, -1 on error.
+  int Open(const char* filename);
+
+  /// Writes the index and closes the file.
+  void Close();
+
+  bool IsOpen() { return this->m_File != NULL; }
+
+  /// Writes a packed message, e.g. one about to be sent. 'time' is the
+  /// receive time in nanoseconds since 1970; 0 stands for the current time.
+  /// Returns 1 on success, 0 on error. After a write error the file is
+  /// closed without the index.
+  int WriteMessage(MessageBase* message, igtlUint64 time=0);
+
+  /// Writes a message as received from a socket: the header in network
+  /// byte order (IGTL_HEADER_SIZE bytes, i.e. before MessageHeader::Unpack()
+  /// converts it) and the body. Returns 1 on success, 0 on error.
+  int WriteMessage(const void* header, const void* body, igtlUint64 bodySize, igtlUint64 time=0);
+
+  /// Flushes the written messages to the file. Returns 0 on success, -1 on error.
+  int Flush();
+
+  /// Returns the number of messages written since Open().
+  int GetNumberOfMessages();
+
+protected:
+  MessageCaptureWriter();
+  ~MessageCaptureWriter();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Appends a record made of the given fragments. The lock must be held.
+  int WriteRecord(const void* const* fragments, const igtlUint64* sizes, int numberOfFragments,
+                  igtlUint64 time);
+
+  /// Writes 'size' bytes and advances m_Offset. Returns 1 on success.
+  int WriteData(const void* data, igtlUint64 size);
+
+  FILE*                   m_File;
+  igtlUint64              m_Offset;
+
+  /// Offset and receive time of each record.
+  std::vector<igtlUint64> m_Index;
+
+  TimeStamp::Pointer      m_TimeStamp;
+  SimpleMutexLock         m_Lock;
+
+private:
+  MessageCaptureWriter(const MessageCaptureWriter&); // Not implemented.
+  void operator=(const MessageCaptureWriter&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlMessageCaptureWriter_h
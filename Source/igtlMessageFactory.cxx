@@ -20,6 +20,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include "igtlClientSocket.h"
 #include "igtlStatusMessage.h"
 #include "igtlCapabilityMessage.h"
+#include "igtlClockSyncMessage.h"
 
 #if OpenIGTLink_PROTOCOL_VERSION >= 2
 #include "igtlPointMessage.h"
@@ -62,6 +63,7 @@ MessageFactory::MessageFactory()
   this->AddMessageType("STATUS", (PointerToMessageBaseNew)&igtl::StatusMessage::New);
   this->AddMessageType("GET_STATUS", (PointerToMessageBaseNew)&igtl::GetStatusMessage::New);
   this->AddMessageType("CAPABILITY", (PointerToMessageBaseNew)&igtl::CapabilityMessage::New);
+  this->AddMessageType("CLOCKSYNC", (PointerToMessageBaseNew)&igtl::ClockSyncMessage::New);
 #if OpenIGTLink_PROTOCOL_VERSION >= 2
   this->AddMessageType("POINT", (PointerToMessageBaseNew)&igtl::PointMessage::New);
   this->AddMessageType("GET_POINT", (PointerToMessageBaseNew)&igtl::GetPointMessage::New);
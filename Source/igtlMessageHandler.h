@@ -36,6 +36,16 @@ class IGTLCommon_EXPORT MessageHandler: public Object
 #endif
   virtual int ReceiveMessage(Socket*, MessageBase*, int) { return 0; };
 
+  /// Creates a new message object of the type handled by this handler.
+  /// Servers that receive from several connections at once (e.g. igtl::EventLoopServer)
+  /// use it to keep one receive buffer per connection. Returns NULL if not supported.
+  virtual MessageBase::Pointer CreateMessage() { return NULL; }
+
+  /// Unpacks and processes a message created by CreateMessage(), whose body has been
+  /// received completely from 'socket'. Returns 1 if the message has been processed,
+  /// or 0 if it could not be unpacked (e.g. CRC error).
+  virtual int ProcessReceivedMessage(Socket*, MessageBase*) { return 0; }
+
   void SetMessageBuffer(MessageBase* buffer) { this->m_Buffer = buffer; }
   MessageBase * GetMessageBuffer() { return this->m_Buffer; }
 
@@ -69,6 +69,22 @@ using igtl::SmartPointer;
         }                                                               \
       return s + pos;  /* return current position in the body */        \
     }                                                                   \
+    virtual ::igtl::MessageBase::Pointer CreateMessage()          \
+    {                                                             \
+      messagetype::Pointer message = messagetype::New();          \
+      return ::igtl::MessageBase::Pointer(message.GetPointer());  \
+    }                                                             \
+    virtual int ProcessReceivedMessage(::igtl::Socket*, ::igtl::MessageBase* message) \
+    {                                                             \
+      messagetype* m = dynamic_cast<messagetype*>(message);       \
+      if (m == NULL ||                                            \
+          !(m->Unpack(this->m_CheckCRC) & ::igtl::MessageBase::UNPACK_BODY)) \
+        {                                                         \
+        return 0;                                                 \
+        }                                                         \
+      Process(m, this->m_Data);                                   \
+      return 1;                                                   \
+    }                                                             \
     virtual void CheckCRC(int i)                                  \
     {                                                             \
       if (i == 0)                                                 \
@@ -145,6 +161,22 @@ using igtl::SmartPointer;
         }                                                               \
       return s + pos;  /* return current position in the body */        \
     }                                                                   \
+    virtual ::igtl::MessageBase::Pointer CreateMessage()                \
+    {                                                                   \
+      messagetype::Pointer message = messagetype::New();                \
+      return ::igtl::MessageBase::Pointer(message.GetPointer());        \
+    }                                                                   \
+    virtual int ProcessReceivedMessage(::igtl::Socket*, ::igtl::MessageBase* message) \
+    {                                                                   \
+      messagetype* m = dynamic_cast<messagetype*>(message);             \
+      if (m == NULL ||                                                  \
+          !(m->Unpack(this->m_CheckCRC) & ::igtl::MessageBase::UNPACK_BODY)) \
+        {                                                               \
+        return 0;                                                       \
+        }                                                               \
+      Process(m, this->m_Data);                                         \
+      return 1;                                                         \
+    }                                                                   \
     virtual void CheckCRC(int i)                                        \
     {                                                                   \
       if (i == 0)                                                       \
@@ -0,0 +1,223 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMessageHandlerMap.h"
+
+#include <string.h>
+
+// Initial number of slots; must be a power of two.
+#define IGTL_HANDLER_MAP_INITIAL_CAPACITY 16
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+MessageHandlerMap::MessageHandlerMap()
+{
+  this->m_NumberOfEntries = 0;
+  this->m_NumberOfDeviceEntries = 0;
+  this->Resize(IGTL_HANDLER_MAP_INITIAL_CAPACITY);
+}
+
+
+//-----------------------------------------------------------------------------
+MessageHandlerMap::~MessageHandlerMap()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageHandlerMap::Add(MessageHandler* handler, const char* deviceName)
+{
+  if (handler == NULL)
+    {
+    return 0;
+    }
+
+  char key[KEY_SIZE];
+  MakeKey(key, handler->GetMessageType(), deviceName);
+  if (this->m_Table[this->FindSlot(key)].Handler != NULL)
+    {
+    // A handler has already been registered for the key.
+    return 0;
+    }
+
+  // Keep the load factor at or below 1/2.
+  if ((size_t)(this->m_NumberOfEntries + 1) * 2 > this->m_Table.size())
+    {
+    this->Resize(this->m_Table.size() * 2);
+    }
+  this->Insert(key, handler);
+  this->m_NumberOfEntries ++;
+  if (deviceName && deviceName[0] != '\0')
+    {
+    this->m_NumberOfDeviceEntries ++;
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageHandlerMap::Remove(MessageHandler* handler)
+{
+  // Removal is rare; rebuilding the table avoids tombstones in the probe sequences.
+  std::vector<Entry> entries;
+  int removed = 0;
+  for (size_t i = 0; i < this->m_Table.size(); i ++)
+    {
+    if (this->m_Table[i].Handler == NULL)
+      {
+      continue;
+      }
+    if (this->m_Table[i].Handler == handler)
+      {
+      removed ++;
+      }
+    else
+      {
+      entries.push_back(this->m_Table[i]);
+      }
+    }
+  if (removed == 0)
+    {
+    return 0;
+    }
+
+  this->Clear();
+  for (size_t i = 0; i < entries.size(); i ++)
+    {
+    this->Insert(entries[i].Key, entries[i].Handler);
+    this->m_NumberOfEntries ++;
+    if (entries[i].Key[IGTL_HEADER_TYPE_SIZE] != '\0')
+      {
+      this->m_NumberOfDeviceEntries ++;
+      }
+    }
+  return 1;
+}
+
+
+//-----------------------------------------------------------------------------
+MessageHandler* MessageHandlerMap::Find(const char* type, const char* deviceName) const
+{
+  char key[KEY_SIZE];
+  if (this->m_NumberOfDeviceEntries > 0 && deviceName && deviceName[0] != '\0')
+    {
+    MakeKey(key, type, deviceName);
+    MessageHandler* handler = this->m_Table[this->FindSlot(key)].Handler;
+    if (handler)
+      {
+      return handler;
+      }
+    }
+  MakeKey(key, type, NULL);
+  return this->m_Table[this->FindSlot(key)].Handler;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageHandlerMap::Clear()
+{
+  for (size_t i = 0; i < this->m_Table.size(); i ++)
+    {
+    this->m_Table[i].Handler = NULL;
+    }
+  this->m_NumberOfEntries = 0;
+  this->m_NumberOfDeviceEntries = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Length of 'str' up to the size of the header field; the names in the
+// header are not null-terminated when they fill the field.
+static size_t FieldLength(const char* str, size_t fieldSize)
+{
+  const char* end = (const char*)memchr(str, '\0', fieldSize);
+  return end ? (size_t)(end - str) : fieldSize;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageHandlerMap::MakeKey(char* key, const char* type, const char* deviceName)
+{
+  // Same layout as the type and device name fields of the header:
+  // zero-padded and not necessarily null-terminated.
+  memset(key, 0, KEY_SIZE);
+  if (type)
+    {
+    memcpy(key, type, FieldLength(type, IGTL_HEADER_TYPE_SIZE));
+    }
+  if (deviceName)
+    {
+    memcpy(key + IGTL_HEADER_TYPE_SIZE, deviceName, FieldLength(deviceName, IGTL_HEADER_NAME_SIZE));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+unsigned int MessageHandlerMap::Hash(const char* key)
+{
+  // 32-bit FNV-1a
+  unsigned int h = 2166136261U;
+  for (int i = 0; i < KEY_SIZE; i ++)
+    {
+    h ^= (unsigned char)key[i];
+    h *= 16777619U;
+    }
+  return h;
+}
+
+
+//-----------------------------------------------------------------------------
+size_t MessageHandlerMap::FindSlot(const char* key) const
+{
+  size_t mask = this->m_Table.size() - 1;
+  size_t i = Hash(key) & mask;
+  while (this->m_Table[i].Handler != NULL &&
+         memcmp(this->m_Table[i].Key, key, KEY_SIZE) != 0)
+    {
+    i = (i + 1) & mask;
+    }
+  return i;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageHandlerMap::Insert(const char* key, MessageHandler* handler)
+{
+  Entry& entry = this->m_Table[this->FindSlot(key)];
+  memcpy(entry.Key, key, KEY_SIZE);
+  entry.Handler = handler;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageHandlerMap::Resize(size_t capacity)
+{
+  std::vector<Entry> old;
+  old.swap(this->m_Table);
+
+  Entry empty;
+  memset(&empty, 0, sizeof(Entry));
+  this->m_Table.assign(capacity, empty);
+  for (size_t i = 0; i < old.size(); i ++)
+    {
+    if (old[i].Handler != NULL)
+      {
+      this->Insert(old[i].Key, old[i].Handler);
+      }
+    }
+}
+
+} // namespace igtl
@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlMessageHandlerMap_h
+#define __igtlMessageHandlerMap_h
+
+#include <vector>
+
+#include "igtlWin32Header.h"
+#include "igtlMessageHandler.h"
+#include "igtl_header.h"
+
+namespace igtl
+{
+
+/// MessageHandlerMap finds the message handler for a received message in
+/// constant time. Handlers are keyed on the message type name, as stored in
+/// the 12-byte type field of the header, and optionally on the 20-byte device
+/// name field. A handler registered with a device name takes precedence
+/// over a handler registered for the type only.
+///
+/// The keys are stored zero-padded at their wire length in an open-addressing
+/// hash table, so a lookup costs one hash over 32 bytes and usually a single
+/// comparison.
+class IGTLCommon_EXPORT MessageHandlerMap
+{
+public:
+  MessageHandlerMap();
+  ~MessageHandlerMap();
+
+  /// Registers 'handler' for its message type (MessageHandler::GetMessageType()).
+  /// If 'deviceName' is given, the handler only receives messages from that device.
+  /// Returns 1 on success, or 0 if a handler is already registered for the key.
+  int Add(MessageHandler* handler, const char* deviceName=NULL);
+
+  /// Unregisters all entries of 'handler'. Returns 1 if any entry has been removed.
+  int Remove(MessageHandler* handler);
+
+  /// Returns the handler for the message type and device name, or NULL.
+  /// 'deviceName' may be NULL.
+  MessageHandler* Find(const char* type, const char* deviceName) const;
+
+  /// Returns the number of registered entries.
+  int GetNumberOfEntries() const { return m_NumberOfEntries; }
+
+  void Clear();
+
+protected:
+  enum {
+    KEY_SIZE = IGTL_HEADER_TYPE_SIZE + IGTL_HEADER_NAME_SIZE
+  };
+
+  struct Entry
+  {
+    char            Key[KEY_SIZE];
+    MessageHandler* Handler;  // NULL for an empty slot
+  };
+
+  static void MakeKey(char* key, const char* type, const char* deviceName);
+  static unsigned int Hash(const char* key);
+
+  /// Returns the slot holding 'key', or the empty slot where it would be inserted.
+  size_t FindSlot(const char* key) const;
+
+  void Insert(const char* key, MessageHandler* handler);
+  void Resize(size_t capacity);
+
+  std::vector<Entry> m_Table;
+  int                m_NumberOfEntries;
+  int                m_NumberOfDeviceEntries;
+};
+
+} // namespace igtl
+
+#endif // __igtlMessageHandlerMap_h
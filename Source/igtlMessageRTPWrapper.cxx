@@ -18,6 +18,177 @@
 
 namespace igtl {
   
+  PacketBuffer::PacketBuffer(int numberOfSlots, int slotSize)
+  {
+    this->m_NumberOfSlots = numberOfSlots;
+    this->m_SlotSize = slotSize;
+    this->m_Head = 0;
+    this->m_NumberOfPackets = 0;
+    this->m_TotalLength = 0;
+    this->m_NumberOfDroppedPackets = 0;
+  }
+  
+  void PacketBuffer::Allocate(int numberOfSlots, int slotSize)
+  {
+    this->m_NumberOfSlots = numberOfSlots;
+    this->m_SlotSize = slotSize;
+    // Release the old slots; the new ones are allocated by the next PushBack().
+    std::vector<unsigned char>().swap(this->m_Slots);
+    std::vector<int>().swap(this->m_PacketLengths);
+    this->Clear();
+  }
+  
+  int PacketBuffer::PushBack(const unsigned char* packet, int length)
+  {
+    if (length < 0 || length > this->m_SlotSize || this->m_NumberOfSlots <= 0)
+      {
+      return 0;
+      }
+    if (this->m_Slots.empty())
+      {
+      this->m_Slots.resize((size_t)this->m_NumberOfSlots * this->m_SlotSize);
+      this->m_PacketLengths.resize(this->m_NumberOfSlots);
+      }
+    if (this->m_NumberOfPackets == this->m_NumberOfSlots)
+      {
+      // Drop the oldest packet.
+      this->m_TotalLength -= this->m_PacketLengths[this->m_Head];
+      this->m_Head = (this->m_Head + 1) % this->m_NumberOfSlots;
+      this->m_NumberOfPackets --;
+      this->m_NumberOfDroppedPackets ++;
+      }
+    int slot = (this->m_Head + this->m_NumberOfPackets) % this->m_NumberOfSlots;
+    memcpy(&this->m_Slots[(size_t)slot * this->m_SlotSize], packet, length);
+    this->m_PacketLengths[slot] = length;
+    this->m_NumberOfPackets ++;
+    this->m_TotalLength += length;
+    return 1;
+  }
+  
+  int PacketBuffer::PopFront(unsigned char* packet)
+  {
+    if (this->m_NumberOfPackets == 0)
+      {
+      return 0;
+      }
+    int slot = this->m_Head;
+    int length = this->m_PacketLengths[slot];
+    memcpy(packet, &this->m_Slots[(size_t)slot * this->m_SlotSize], length);
+    this->m_Head = (this->m_Head + 1) % this->m_NumberOfSlots;
+    this->m_NumberOfPackets --;
+    this->m_TotalLength -= length;
+    return length;
+  }
+  
+  int PacketBuffer::PopBack(unsigned char* packet)
+  {
+    if (this->m_NumberOfPackets == 0)
+      {
+      return 0;
+      }
+    int slot = (this->m_Head + this->m_NumberOfPackets - 1) % this->m_NumberOfSlots;
+    int length = this->m_PacketLengths[slot];
+    memcpy(packet, &this->m_Slots[(size_t)slot * this->m_SlotSize], length);
+    this->m_NumberOfPackets --;
+    this->m_TotalLength -= length;
+    return length;
+  }
+  
+  const unsigned char* PacketBuffer::GetPacket(int i, int* length) const
+  {
+    if (i < 0 || i >= this->m_NumberOfPackets)
+      {
+      *length = 0;
+      return NULL;
+      }
+    int slot = (this->m_Head + i) % this->m_NumberOfSlots;
+    *length = this->m_PacketLengths[slot];
+    return &this->m_Slots[(size_t)slot * this->m_SlotSize];
+  }
+  
+  void PacketBuffer::Clear()
+  {
+    this->m_Head = 0;
+    this->m_NumberOfPackets = 0;
+    this->m_TotalLength = 0;
+  }
+  
+  
+  ReorderBuffer::ReorderBuffer(BufferAllocator* allocator)
+  {
+    this->filledPacketNum = 0;
+    this->totFragNumber = 0;
+    this->receivedLastFrag = false;
+    this->receivedFirstFrag = false;
+    this->m_Allocator = allocator ? allocator : BufferAllocator::GetDefault();
+    this->m_MemorySize = 0;
+  }
+  
+  ReorderBuffer::~ReorderBuffer()
+  {
+    for (size_t i = 0; i < this->m_Fragments.size(); i ++)
+      {
+      if (this->m_Fragments[i].Page)
+        {
+        this->m_Allocator->Release(this->m_Fragments[i].Page, this->m_Fragments[i].Capacity);
+        }
+      }
+  }
+  
+  int ReorderBuffer::AddFragment(int index, const unsigned char* data, igtl_uint32 length)
+  {
+    // 14 bits are used for the fragment number.
+    if (index < 0 || index >= 16384 || (this->receivedLastFrag && (igtl_uint32)index >= this->totFragNumber))
+      {
+      return 0;
+      }
+    if ((size_t)index >= this->m_Fragments.size())
+      {
+      Fragment empty = {NULL, 0, 0};
+      this->m_Fragments.resize(index + 1, empty);
+      }
+    Fragment& fragment = this->m_Fragments[index];
+    if (fragment.Page)
+      {
+      return 0;
+      }
+    fragment.Page = this->m_Allocator->Allocate(length > 0 ? length : 1, &fragment.Capacity);
+    if (fragment.Page == NULL)
+      {
+      return 0;
+      }
+    memcpy(fragment.Page, data, length);
+    fragment.Length = length;
+    this->m_MemorySize += fragment.Capacity;
+    this->filledPacketNum ++;
+    return 1;
+  }
+  
+  bool ReorderBuffer::IsComplete() const
+  {
+    return this->receivedFirstFrag && this->receivedLastFrag && this->filledPacketNum == this->totFragNumber;
+  }
+  
+  igtl_uint64 ReorderBuffer::GetMessageLength() const
+  {
+    igtl_uint64 length = 0;
+    for (size_t i = 0; i < this->m_Fragments.size(); i ++)
+      {
+      length += this->m_Fragments[i].Length;
+      }
+    return length;
+  }
+  
+  void ReorderBuffer::CopyMessage(unsigned char* message) const
+  {
+    for (size_t i = 0; i < this->m_Fragments.size(); i ++)
+      {
+      memcpy(message, this->m_Fragments[i].Page, this->m_Fragments[i].Length);
+      message += this->m_Fragments[i].Length;
+      }
+  }
+  
+  
   MessageRTPWrapper::MessageRTPWrapper():Object()
   {
     this->SeqNum = 0;
@@ -26,6 +197,7 @@ namespace igtl {
     this->numberOfDataFrag = 1;
     this->numberOfDataFragToSent = 1;
     this->packedMsg = NULL;
+    this->packedMsgSize = 0;
     this->appSpecificFreq = 100;
     this->status = PacketReady;
     this->curMSGLocation = 0;
@@ -33,8 +205,6 @@ namespace igtl {
     this->fragmentNumber = 0;
     this->MSGHeader= new igtl_uint8[IGTL_HEADER_SIZE + IGTL_EXTENDED_HEADER_SIZE];
     this->glock = igtl::SimpleMutexLock::New();
-    this->incommingPackets =  igtl::PacketBuffer();
-    this->reorderBuffer = new igtl::ReorderBuffer();
     this->reorderBufferMap = std::map<igtl_uint32, igtl::ReorderBuffer*>();
     this->fragmentNumberList=std::vector<igtl_uint16>();
     this->PacketSendTimeStampList = std::vector<igtl_uint64>();
@@ -50,32 +220,56 @@ namespace igtl {
   MessageRTPWrapper::~MessageRTPWrapper()
   {
     glock->Lock();
-    std::map<igtl_uint32, igtl::ReorderBuffer*>::iterator itr = this->reorderBufferMap.begin();
-    while (itr != this->reorderBufferMap.end())
+    std::map<igtl_uint32, igtl::ReorderBuffer*>::iterator itr;
+    for (itr = this->reorderBufferMap.begin(); itr != this->reorderBufferMap.end(); ++itr)
       {
-      // found it - delete it
-      itr->second->~ReorderBuffer();
-      this->reorderBufferMap.erase(itr);
-      if(this->reorderBufferMap.size()==0)
-        {
-        break;
-        }
-      itr++;
+      delete itr->second;
       }
-    std::map<igtl_uint32, igtl::UnWrappedMessage*>::iterator itr2 = this->unWrappedMessages.begin();
-    while (itr2 != this->unWrappedMessages.end())
+    this->reorderBufferMap.clear();
+    std::map<igtl_uint32, igtl::UnWrappedMessage*>::iterator itr2;
+    for (itr2 = this->unWrappedMessages.begin(); itr2 != this->unWrappedMessages.end(); ++itr2)
       {
-      // found it - delete it
-      itr2->second->~UnWrappedMessage();
-      this->unWrappedMessages.erase(itr2);
-      if(this->unWrappedMessages.size()==0)
-        {
-        break;
-        }
-      itr2++;
+      delete itr2->second;
       }
+    this->unWrappedMessages.clear();
     glock->Unlock();
     glock = NULL;
+    delete[] this->packedMsg;
+    delete[] this->MSGHeader;
+  }
+  
+  
+  void MessageRTPWrapper::SetRTPPayloadLength(unsigned int payloadLength)
+  {
+    this->RTPPayloadLength = payloadLength;
+    int slotSize = payloadLength + RTP_HEADER_LENGTH;
+    this->glock->Lock();
+    if (slotSize > this->outgoingPackets.GetSlotSize())
+      {
+      this->outgoingPackets.Allocate(this->outgoingPackets.GetNumberOfSlots(), slotSize);
+      }
+    if (slotSize > this->incommingPackets.GetSlotSize())
+      {
+      this->incommingPackets.Allocate(this->incommingPackets.GetNumberOfSlots(), slotSize);
+      }
+    this->glock->Unlock();
+  }
+  
+  
+  int MessageRTPWrapper::GetNumberOfReorderBuffers()
+  {
+    return (int)this->reorderBufferMap.size();
+  }
+  
+  igtl_uint64 MessageRTPWrapper::GetReorderBufferMemorySize()
+  {
+    igtl_uint64 size = 0;
+    std::map<igtl_uint32, igtl::ReorderBuffer*>::iterator itr;
+    for (itr = this->reorderBufferMap.begin(); itr != this->reorderBufferMap.end(); ++itr)
+      {
+      size += itr->second->GetMemorySize();
+      }
+    return size;
   }
   
   
@@ -120,61 +314,72 @@ namespace igtl {
   int MessageRTPWrapper::PushDataIntoPacketBuffer(igtlUint8* UDPPacket, igtlUint16 PacketLen)
   {
     this->glock->Lock();
-    if(this->incommingPackets.pPacketLengthInByte.size()>PacketMaximumBufferNum)
-      {
-      igtlUint16 firstMsgLen = this->incommingPackets.pPacketLengthInByte[0];
-      this->incommingPackets.pPacketLengthInByte.erase(this->incommingPackets.pPacketLengthInByte.begin());
-      this->incommingPackets.pBsBuf.erase(this->incommingPackets.pBsBuf.begin(), this->incommingPackets.pBsBuf.begin()+firstMsgLen);
-      this->incommingPackets.totalLength -= firstMsgLen;
-      }
-    this->incommingPackets.pPacketLengthInByte.push_back(PacketLen);
-    this->incommingPackets.pBsBuf.insert(this->incommingPackets.pBsBuf.end(), UDPPacket, UDPPacket+PacketLen);
-    this->incommingPackets.totalLength += PacketLen;
-    if (this->incommingPackets.totalLength  == this->incommingPackets.pBsBuf.size())
-      {
-      this->glock->Unlock();
-      return 1;
-      
-      }
-    else
+    int r = this->incommingPackets.PushBack(UDPPacket, PacketLen);
+    this->glock->Unlock();
+    return r;
+  }
+  
+  int MessageRTPWrapper::PushDataIntoPacketBuffer(igtlUint8* const* UDPPackets, const int* PacketLens, int numberOfPackets)
+  {
+    int numberOfPushed = 0;
+    this->glock->Lock();
+    for (int i = 0; i < numberOfPackets; i ++)
       {
-      this->glock->Unlock();
-      return 0;
+      numberOfPushed += this->incommingPackets.PushBack(UDPPackets[i], PacketLens[i]);
       }
+    this->glock->Unlock();
+    return numberOfPushed;
   }
   
   int MessageRTPWrapper::SendBufferedDataWithInterval(igtl::UDPServerSocket::Pointer &socket, int interval) //interval is in nanosecond
   {
-    int totalMsgLen = this->outgoingPackets.totalLength;
+    this->glock->Lock();
+    int totalMsgLen = this->outgoingPackets.GetTotalLength();
+    this->glock->Unlock();
     int sendMsgLen = 0;
-    while (this->outgoingPackets.pPacketLengthInByte.size())
+    const unsigned char* packets[PacketBatchMaximumNum];
+    int packetLengths[PacketBatchMaximumNum];
+    while (1)
       {
-      igtlUint8 * UDPPacket;
-      igtlUint16 currentMsgLen;
+      // Take up to PacketBatchMaximumNum packets from the buffer and send them with one call.
+      int numberOfPackets = 0;
       this->glock->Lock();
-      if(this->FCFS==true)
+      size_t slotSize = this->outgoingPackets.GetSlotSize();
+      if (this->outgoingPacket.size() < PacketBatchMaximumNum * slotSize)
         {
-        currentMsgLen = this->outgoingPackets.pPacketLengthInByte[0];
-        UDPPacket = new igtlUint8[currentMsgLen];
-        memcpy(UDPPacket, this->outgoingPackets.pBsBuf.data(), currentMsgLen);
-        this->outgoingPackets.pPacketLengthInByte.erase(this->outgoingPackets.pPacketLengthInByte.begin());
-        this->outgoingPackets.pBsBuf.erase(this->outgoingPackets.pBsBuf.begin(), this->outgoingPackets.pBsBuf.begin()+currentMsgLen);
-        this->outgoingPackets.totalLength -= currentMsgLen;
+        this->outgoingPacket.resize(PacketBatchMaximumNum * slotSize);
         }
-      else
+      while (numberOfPackets < PacketBatchMaximumNum)
         {
-        int packetNum = outgoingPackets.pPacketLengthInByte.size();
-        currentMsgLen = this->outgoingPackets.pPacketLengthInByte[packetNum-1];
-        UDPPacket = new igtlUint8[currentMsgLen];
-        memcpy(UDPPacket, this->outgoingPackets.pBsBuf.data() + this->outgoingPackets.pBsBuf.size()-currentMsgLen, currentMsgLen);
-        this->outgoingPackets.pPacketLengthInByte.erase(this->outgoingPackets.pPacketLengthInByte.end()-1);
-        this->outgoingPackets.pBsBuf.erase(this->outgoingPackets.pBsBuf.begin() + this->outgoingPackets.pBsBuf.size()-currentMsgLen, this->outgoingPackets.pBsBuf.end());
-        this->outgoingPackets.totalLength -= currentMsgLen;
+        unsigned char* UDPPacket = &this->outgoingPacket[numberOfPackets * slotSize];
+        int currentMsgLen;
+        if(this->FCFS==true)
+          {
+          currentMsgLen = this->outgoingPackets.PopFront(UDPPacket);
+          }
+        else
+          {
+          currentMsgLen = this->outgoingPackets.PopBack(UDPPacket);
+          }
+        if (currentMsgLen == 0)
+          {
+          break;
+          }
+        packets[numberOfPackets] = UDPPacket;
+        packetLengths[numberOfPackets] = currentMsgLen;
+        numberOfPackets ++;
         }
       this->glock->Unlock();
-      int numByteSent = socket->WriteSocket(UDPPacket, currentMsgLen);
-      sendMsgLen += numByteSent;
-      if (numByteSent != currentMsgLen)
+      if (numberOfPackets == 0)
+        {
+        break;
+        }
+      int numberOfSent = socket->WriteSocketBatch(packets, packetLengths, numberOfPackets);
+      for (int i = 0; i < numberOfSent; i ++)
+        {
+        sendMsgLen += packetLengths[i];
+        }
+      if (numberOfSent != numberOfPackets)
         {
         return 0;
         }
@@ -203,26 +408,13 @@ namespace igtl {
       if (status == igtl::MessageRTPWrapper::ProcessFragment || status == igtl::MessageRTPWrapper::PacketReady)
         {
         this->glock->Lock();
-        if(this->outgoingPackets.pPacketLengthInByte.size()>PacketMaximumBufferNum)
-          {
-          igtlUint16 firstMsgLen = this->outgoingPackets.pPacketLengthInByte[0];
-          this->outgoingPackets.pPacketLengthInByte.erase(this->outgoingPackets.pPacketLengthInByte.begin());
-          this->outgoingPackets.pBsBuf.erase(this->outgoingPackets.pBsBuf.begin(), this->outgoingPackets.pBsBuf.begin()+firstMsgLen);
-          this->outgoingPackets.totalLength -= firstMsgLen;
-          }
-        this->outgoingPackets.pPacketLengthInByte.push_back(this->GetPackedMSGLocation());
-        this->outgoingPackets.pBsBuf.insert(this->outgoingPackets.pBsBuf.end(), this->GetPackPointer(), this->GetPackPointer()+this->GetPackedMSGLocation());
-        this->outgoingPackets.totalLength += this->GetPackedMSGLocation();
-        this->PacketTotalLengthList.push_back(this->GetPackedMSGLocation());
-        if (this->outgoingPackets.totalLength  == this->outgoingPackets.pBsBuf.size())
-          {
-          this->glock->Unlock();
-          }
-        else
+        int r = this->outgoingPackets.PushBack(this->GetPackPointer(), this->GetPackedMSGLocation());
+        this->glock->Unlock();
+        if (r == 0)
           {
-          this->glock->Unlock();
           return 0;
           }
+        this->PacketTotalLengthList.push_back(this->GetPackedMSGLocation());
         }
       leftmessageContent = messageContentPointer + this->GetCurMSGLocation();
       leftMsgLen = MSGContentLength - this->GetCurMSGLocation();
@@ -233,31 +425,24 @@ namespace igtl {
   
   int MessageRTPWrapper::UnWrapPacketWithTypeAndName(const char *deviceType, const char * deviceName)
   {
-    if (this->incommingPackets.pPacketLengthInByte.size())
+    this->glock->Lock();
+    if (this->incommingPacket.size() < (size_t)this->incommingPackets.GetSlotSize())
+      {
+      this->incommingPacket.resize(this->incommingPackets.GetSlotSize());
+      }
+    igtlUint8 * UDPPacket = &this->incommingPacket[0];
+    igtlUint16 totMsgLen;
+    if(this->FCFS==true)
+      {
+      totMsgLen = this->incommingPackets.PopFront(UDPPacket);
+      }
+    else
+      {
+      totMsgLen = this->incommingPackets.PopBack(UDPPacket);
+      }
+    this->glock->Unlock();
+    if (totMsgLen)
       {
-      this->glock->Lock();
-      igtlUint8 * UDPPacket;
-      igtlUint16 totMsgLen;
-      if(this->FCFS==true)
-        {
-        totMsgLen = this->incommingPackets.pPacketLengthInByte[0];
-        UDPPacket = new igtlUint8[totMsgLen];
-        memcpy(UDPPacket, this->incommingPackets.pBsBuf.data(), totMsgLen);
-        this->incommingPackets.pPacketLengthInByte.erase(this->incommingPackets.pPacketLengthInByte.begin());
-        this->incommingPackets.pBsBuf.erase(this->incommingPackets.pBsBuf.begin(), this->incommingPackets.pBsBuf.begin()+totMsgLen);
-        this->incommingPackets.totalLength -= totMsgLen;
-        }
-      else
-        {
-        int packetNum = incommingPackets.pPacketLengthInByte.size();
-        totMsgLen = this->incommingPackets.pPacketLengthInByte[packetNum-1];
-        UDPPacket = new igtlUint8[totMsgLen];
-        memcpy(UDPPacket, this->incommingPackets.pBsBuf.data() + this->incommingPackets.pBsBuf.size()-totMsgLen, totMsgLen);
-        this->incommingPackets.pPacketLengthInByte.erase(this->incommingPackets.pPacketLengthInByte.end()-1);
-        this->incommingPackets.pBsBuf.erase(this->incommingPackets.pBsBuf.begin() + this->incommingPackets.pBsBuf.size()-totMsgLen, this->incommingPackets.pBsBuf.end());
-        this->incommingPackets.totalLength -= totMsgLen;
-        }
-      this->glock->Unlock();
       // Set up the RTP header:
       igtl_uint32  rtpProfileBytes, timeIncrement;
       rtpProfileBytes = *((igtl_uint32*)UDPPacket);
@@ -288,119 +473,84 @@ namespace igtl {
           {
           fragmentField = BYTE_SWAP_INT16(fragmentField);
           }
-        //this->reorderBufferMap.erase(it);
-        if (reorderBufferMap.size()>ReorderBufferMaximumSize) // get rid of the first reoderBuffer when waiting for a long time
+        header->Unpack();
+        if (strcmp(header->GetDeviceType(),deviceType)!=0 || strcmp(header->GetDeviceName(),deviceName)!=0)
           {
-          if(reorderBufferMap.begin()->first != messageID)
+          if (fragmentField==NoFragmentIndicator)
             {
-            reorderBufferMap.erase(reorderBufferMap.begin());
+            curPackedMSGLocation += header->GetBodySizeToRead()+IGTL_HEADER_SIZE;
+            continue;
             }
-          else
+          break;
+          }
+        if(fragmentField==NoFragmentIndicator) // fragment doesn't exist
+          {
+          igtl_uint32 messageLength = header->GetBodySizeToRead()+IGTL_HEADER_SIZE;
+          if (curPackedMSGLocation + messageLength > totMsgLen)
             {
-            reorderBufferMap.erase(reorderBufferMap.begin()++);
+            break;
             }
+          igtl::UnWrappedMessage* message = new igtl::UnWrappedMessage(messageLength);
+          memcpy(message->messagePackPointer, UDPPacket + curPackedMSGLocation, messageLength);
+          glock->Lock();
+          unWrappedMessages.insert(std::pair<igtl_uint32, igtl::UnWrappedMessage*>(messageID,message));
+          glock->Unlock();
+          status = MessageReady;
+          curPackedMSGLocation += messageLength;
+          continue;
           }
+        
         std::map<igtl_uint32, igtl::ReorderBuffer*>::iterator it = this->reorderBufferMap.find(messageID);
         if (it == this->reorderBufferMap.end())
           {
-          this->reorderBufferMap.insert(std::pair<igtl_uint32,igtl::ReorderBuffer*>(messageID,new igtl::ReorderBuffer()));
-          it = this->reorderBufferMap.find(messageID);
-          
+          if (reorderBufferMap.size()>=ReorderBufferMaximumSize) // get rid of the oldest reorderBuffer when waiting for a long time
+            {
+            delete reorderBufferMap.begin()->second;
+            reorderBufferMap.erase(reorderBufferMap.begin());
+            }
+          it = this->reorderBufferMap.insert(std::pair<igtl_uint32,igtl::ReorderBuffer*>(messageID,new igtl::ReorderBuffer())).first;
           }
-        this->reorderBuffer = it->second;
-        header->Unpack();
-        if(fragmentField==NoFragmentIndicator) // fragment doesn't exist
+        igtl::ReorderBuffer* reorderBuffer = it->second;
+        int payloadOffset = RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE;
+        if(fragmentField==FragmentBeginIndicator)
           {
-          if (strcmp(header->GetDeviceType(),deviceType)==0 && strcmp(header->GetDeviceName(),deviceName)==0)
+          // The first fragment keeps its message header, with the fragment field cleared.
+          *(UDPPacket + curPackedMSGLocation + IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE-FragmentIndexBytes) = NoFragmentIndicator; // set the fragment no. to 0000
+          reorderBuffer->AddFragment(0, UDPPacket + curPackedMSGLocation, totMsgLen-curPackedMSGLocation);
+          reorderBuffer->receivedFirstFrag = true;
+          }
+        else if(fragmentField>=FragmentEndIndicator)// this is the last fragment
+          {
+          if (!reorderBuffer->receivedLastFrag)
             {
-            memcpy(this->reorderBuffer->firstFragBuffer, UDPPacket + curPackedMSGLocation, header->GetBodySizeToRead()+IGTL_HEADER_SIZE);
-            this->reorderBuffer->filledPacketNum = 1;
-            reorderBuffer->receivedFirstFrag = true;
+            reorderBuffer->totFragNumber = fragmentField - FragmentEndIndicator + 1;
             reorderBuffer->receivedLastFrag = true;
-            reorderBuffer->firstPacketLen = header->GetBodySizeToRead()+IGTL_HEADER_SIZE;
-            igtl::UnWrappedMessage* message = new igtl::UnWrappedMessage();
-            message->messageDataLength = reorderBuffer->firstPacketLen;
-            memcpy(message->messagePackPointer, reorderBuffer->firstFragBuffer, reorderBuffer->firstPacketLen);
-            glock->Lock();
-            unWrappedMessages.insert(std::pair<igtl_uint32, igtl::UnWrappedMessage*>(it->first,message));
-            glock->Unlock();
-            delete it->second;
-            it->second = NULL;
-            this->reorderBufferMap.erase(it);
-            status = MessageReady;
             }
-          curPackedMSGLocation += header->GetBodySizeToRead()+IGTL_HEADER_SIZE;
+          reorderBuffer->AddFragment(fragmentField - FragmentEndIndicator, UDPPacket + payloadOffset, totMsgLen-payloadOffset);
           }
-        else
+        else if(fragmentField>FragmentBeginIndicator && fragmentField<FragmentEndIndicator)
           {
-          if (strcmp(header->GetDeviceType(),deviceType)==0 && strcmp(header->GetDeviceName(),deviceName)==0)
-            {
-            int bodyMsgLength = (RTPPayloadLength-IGTL_HEADER_SIZE-IGTL_EXTENDED_HEADER_SIZE);//this is the length of the body within a full fragment Packet
-            if(fragmentField==FragmentBeginIndicator)// To do, fix the issue when later fragment arrives earlier than the beginning fragment
-              {
-              *(UDPPacket + curPackedMSGLocation + IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE-FragmentIndexBytes) = NoFragmentIndicator; // set the fragment no. to 0000
-              memcpy(reorderBuffer->firstFragBuffer, UDPPacket + curPackedMSGLocation, totMsgLen-curPackedMSGLocation);
-              reorderBuffer->firstPacketLen = totMsgLen-curPackedMSGLocation;
-              curPackedMSGLocation = totMsgLen;
-              reorderBuffer->receivedFirstFrag = true;
-              status = WaitingForAnotherPacket;
-              }
-            else if(fragmentField>=FragmentEndIndicator)// this is the last fragment
-              {
-              reorderBuffer->totFragNumber = fragmentField - FragmentEndIndicator + 1;
-              memcpy(reorderBuffer->lastFragBuffer, UDPPacket + RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE, totMsgLen-(RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE));
-              reorderBuffer->receivedLastFrag = true;
-              reorderBuffer->lastPacketLen = totMsgLen-(RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE);
-              curPackedMSGLocation = totMsgLen;
-              status = WaitingForAnotherPacket;
-              }
-            else if(fragmentField>FragmentBeginIndicator && fragmentField<FragmentEndIndicator)
-              {
-              int curFragNumber = fragmentField - FragmentBeginIndicator;
-              memcpy(reorderBuffer->buffer+(curFragNumber-1)*bodyMsgLength, UDPPacket + RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE, totMsgLen-(RTP_HEADER_LENGTH+IGTL_HEADER_SIZE+IGTL_EXTENDED_HEADER_SIZE));
-              status = WaitingForAnotherPacket;
-              }
-            reorderBuffer->filledPacketNum++;
-            if(reorderBuffer->receivedFirstFrag == true && reorderBuffer->receivedLastFrag == true && reorderBuffer->filledPacketNum == reorderBuffer->totFragNumber)
-              {
-              igtl::UnWrappedMessage* message = new igtl::UnWrappedMessage();
-              message->messageDataLength = reorderBuffer->lastPacketLen+reorderBuffer->firstPacketLen+ (reorderBuffer->totFragNumber-2)*(RTPPayloadLength-IGTL_HEADER_SIZE-IGTL_EXTENDED_HEADER_SIZE);
-              memcpy(message->messagePackPointer, reorderBuffer->firstFragBuffer, reorderBuffer->firstPacketLen);
-              memcpy(message->messagePackPointer+reorderBuffer->firstPacketLen, reorderBuffer->buffer, (RTPPayloadLength-IGTL_HEADER_SIZE-IGTL_EXTENDED_HEADER_SIZE)*(reorderBuffer->totFragNumber-2));
-              memcpy(message->messagePackPointer+reorderBuffer->firstPacketLen+(RTPPayloadLength-IGTL_HEADER_SIZE-IGTL_EXTENDED_HEADER_SIZE)*(reorderBuffer->totFragNumber-2), reorderBuffer->lastFragBuffer, reorderBuffer->lastPacketLen);
-              glock->Lock();
-              unWrappedMessages.insert(std::pair<igtl_uint32, igtl::UnWrappedMessage*>(it->first,message));
-              glock->Unlock();
-              std::map<igtl_uint32, igtl::ReorderBuffer*>::iterator it_forDelete= this->reorderBufferMap.begin();
-              while(it_forDelete != this->reorderBufferMap.end())
-                {
-                delete it_forDelete->second;
-                it_forDelete->second = NULL;
-                this->reorderBufferMap.erase(it_forDelete);
-                if (this->reorderBufferMap.size())
-                  {
-                  if (it_forDelete->first == it->first)
-                    {
-                    break;
-                    }
-                  }
-                else
-                  {
-                  break;
-                  }
-                it_forDelete = this->reorderBufferMap.begin();
-                }
-              status = MessageReady;
-              }
-            }
-          else
+          reorderBuffer->AddFragment(fragmentField - FragmentBeginIndicator, UDPPacket + payloadOffset, totMsgLen-payloadOffset);
+          }
+        status = WaitingForAnotherPacket;
+        if(reorderBuffer->IsComplete())
+          {
+          igtl::UnWrappedMessage* message = new igtl::UnWrappedMessage((igtl_uint32)reorderBuffer->GetMessageLength());
+          reorderBuffer->CopyMessage(message->messagePackPointer);
+          glock->Lock();
+          unWrappedMessages.insert(std::pair<igtl_uint32, igtl::UnWrappedMessage*>(it->first,message));
+          glock->Unlock();
+          // The fragments of older messages that are still incomplete are not expected any more.
+          igtl_uint32 completedID = it->first;
+          while (this->reorderBufferMap.size() && this->reorderBufferMap.begin()->first <= completedID)
             {
-            curPackedMSGLocation = totMsgLen;
+            delete this->reorderBufferMap.begin()->second;
+            this->reorderBufferMap.erase(this->reorderBufferMap.begin());
             }
-          break;
+          status = MessageReady;
           }
+        break;
         }
-      delete[] UDPPacket;
       return 1;
       }
     return 0;
@@ -505,8 +655,12 @@ namespace igtl {
       }
     if (status == PacketReady)
       {
-      delete packedMsg;
-      packedMsg = new unsigned char[RTPPayloadLength + RTP_HEADER_LENGTH];
+      if (packedMsgSize < RTPPayloadLength + RTP_HEADER_LENGTH)
+        {
+        delete[] packedMsg;
+        packedMsgSize = RTPPayloadLength + RTP_HEADER_LENGTH;
+        packedMsg = new unsigned char[packedMsgSize];
+        }
       AvailabeBytesNum = RTPPayloadLength;
       curMSGLocation = 0;
       curPackedMSGLocation = 0;
@@ -16,11 +16,13 @@
 #define __igtlMessageRTPWrapper_h
 
 #include <string>
+#include <vector>
 
 #include "igtlObject.h"
 #include "igtlMacro.h"
 #include "igtlMath.h"
 #include "igtlMessageBase.h"
+#include "igtlBufferAllocator.h"
 #include "igtlMessageFactory.h"
 #include "igtlUDPServerSocket.h"
 #include "igtlUDPClientSocket.h"
@@ -33,6 +35,8 @@
 
 /// This number defines the maximum number for UDP packet buffering, to avoid overflow of the buffer, the first buffered packet will be
 #define PacketMaximumBufferNum 1000
+/// The maximum number of UDP packets sent or received with one system call.
+#define PacketBatchMaximumNum 64
 #define ReorderBufferMaximumSize 200
 #define FragmentIndexBytes 2
 #define FragmentBeginIndicator 0X8000
@@ -109,38 +113,128 @@ namespace igtl
   ///  First 10 Bytes from  m_ExtendedHeader
   
 
-  class PacketBuffer {
+  /// PacketBuffer queues UDP packets in a fixed number of preallocated slots
+  /// of equal size (one RTP packet each). The slots form a ring, so packets
+  /// are added at the back and removed from the front (first come, first
+  /// served) or from the back (last come, first served) in constant time,
+  /// regardless of the number of buffered packets. When all slots are in use,
+  /// the oldest packet is dropped to make room for a new one.
+  ///
+  /// The slot memory is allocated when the first packet is added and reused
+  /// for all later packets. PacketBuffer is not thread-safe; MessageRTPWrapper
+  /// guards its buffers with its lock.
+  class IGTLCommon_EXPORT PacketBuffer {
   public:
-    PacketBuffer(){pPacketLengthInByte.reserve(PacketMaximumBufferNum); totalLength= 0; pBsBuf.reserve(PacketMaximumBufferNum*(RTP_PAYLOAD_LENGTH+RTP_HEADER_LENGTH));};
-    ~PacketBuffer(){pPacketLengthInByte.clear();pBsBuf.clear();};
-    std::vector<int>  pPacketLengthInByte;       ///< length of udp packet size in byte from 0 to number of packet - 1
-    std::vector<unsigned char> pBsBuf;       ///< buffer of Packet contained
-    int totalLength;
+    PacketBuffer(int numberOfSlots=PacketMaximumBufferNum, int slotSize=RTP_PAYLOAD_LENGTH+RTP_HEADER_LENGTH);
+    ~PacketBuffer(){};
+
+    /// Sets the number of slots and the maximum packet size. Buffered packets
+    /// are discarded.
+    void Allocate(int numberOfSlots, int slotSize);
+
+    /// Copies a packet of 'length' bytes to the back of the queue. Returns 1 on
+    /// success, or 0 if the packet does not fit in a slot.
+    int PushBack(const unsigned char* packet, int length);
+
+    /// Copies the oldest packet to 'packet', which must hold GetSlotSize()
+    /// bytes, and removes it. Returns the length of the packet, or 0 if the
+    /// buffer is empty.
+    int PopFront(unsigned char* packet);
+
+    /// Copies the newest packet to 'packet', which must hold GetSlotSize()
+    /// bytes, and removes it. Returns the length of the packet, or 0 if the
+    /// buffer is empty.
+    int PopBack(unsigned char* packet);
+
+    /// Returns a pointer to the i-th buffered packet, counted from the oldest
+    /// one, and stores its length in 'length'.
+    const unsigned char* GetPacket(int i, int* length) const;
+
+    /// Discards all buffered packets.
+    void Clear();
+
+    int GetNumberOfPackets() const { return this->m_NumberOfPackets; };
+
+    int GetNumberOfSlots() const { return this->m_NumberOfSlots; };
+
+    int GetSlotSize() const { return this->m_SlotSize; };
+
+    /// Returns the total length of the buffered packets in bytes.
+    int GetTotalLength() const { return this->m_TotalLength; };
+
+    /// Returns the number of packets dropped because all slots were in use.
+    igtl_uint64 GetNumberOfDroppedPackets() const { return this->m_NumberOfDroppedPackets; };
+
+  protected:
+    std::vector<unsigned char> m_Slots;
+    std::vector<int>           m_PacketLengths;
+    int                        m_NumberOfSlots;
+    int                        m_SlotSize;
+
+    // Slot index of the oldest packet and the number of buffered packets.
+    int                        m_Head;
+    int                        m_NumberOfPackets;
+    int                        m_TotalLength;
+    igtl_uint64                m_NumberOfDroppedPackets;
   };
   
   
-  class ReorderBuffer
+  /// ReorderBuffer collects the fragments of one message until all of them
+  /// have arrived, in any order. Each fragment is copied to a page of its own
+  /// size obtained from a BufferAllocator (the shared pool by default), so an
+  /// incomplete message only holds memory for the fragments received so far.
+  /// The fragment table grows with the highest fragment index seen; the
+  /// number of fragments is known once the last fragment has arrived.
+  class IGTLCommon_EXPORT ReorderBuffer
   {
   public:
-    ReorderBuffer(){firstPacketLen=0;lastPacketLen=0;filledPacketNum=0; totFragNumber = 0;receivedLastFrag=false;receivedFirstFrag=false;};
-    ReorderBuffer(ReorderBuffer const &anotherBuffer){firstPacketLen=anotherBuffer.firstPacketLen;lastPacketLen=anotherBuffer.lastPacketLen;filledPacketNum=anotherBuffer.filledPacketNum;receivedLastFrag=anotherBuffer.receivedLastFrag;receivedFirstFrag=anotherBuffer.receivedFirstFrag;};
-    ~ReorderBuffer(){};
-    unsigned char buffer[RTP_PAYLOAD_LENGTH*(16384-2)];  // we use 14 bits for fragment number, 2^14 = 16384. maximum
-    unsigned char firstFragBuffer[RTP_PAYLOAD_LENGTH];
-    unsigned char lastFragBuffer[RTP_PAYLOAD_LENGTH];
-    igtl_uint32 firstPacketLen;
-    igtl_uint32 lastPacketLen;
+    ReorderBuffer(BufferAllocator* allocator=NULL);
+    ~ReorderBuffer();
+
+    /// Stores a copy of fragment 'index' (0 for the first fragment). Returns 1
+    /// if the fragment has been stored, or 0 if it is a duplicate, if the index
+    /// is out of range or if no memory is available.
+    int AddFragment(int index, const unsigned char* data, igtl_uint32 length);
+
+    /// Returns true if all fragments from the first to the last have arrived.
+    bool IsComplete() const;
+
+    /// Returns the total length of the stored fragments in bytes.
+    igtl_uint64 GetMessageLength() const;
+
+    /// Copies the stored fragments in order to 'message', which must hold
+    /// GetMessageLength() bytes.
+    void CopyMessage(unsigned char* message) const;
+
+    /// Returns the size of the memory held for the fragments in bytes.
+    igtl_uint64 GetMemorySize() const { return this->m_MemorySize; };
+
     igtl_uint32 filledPacketNum;
     igtl_uint32 totFragNumber;
     bool receivedLastFrag;
     bool receivedFirstFrag;
+
+  protected:
+    struct Fragment
+    {
+      unsigned char* Page;
+      igtlUint64     Capacity;
+      igtl_uint32    Length;
+    };
+
+    std::vector<Fragment>    m_Fragments;
+    BufferAllocator::Pointer m_Allocator;
+    igtl_uint64              m_MemorySize;
+
+  private:
+    ReorderBuffer(const ReorderBuffer&); // Not implemented.
+    void operator=(const ReorderBuffer&); // Not implemented.
   };
   
   class UnWrappedMessage
   {
   public:
-    UnWrappedMessage(){messageDataLength = 0; messagePackPointer = new unsigned char[RTP_PAYLOAD_LENGTH*(16384-2)];};
-    UnWrappedMessage(UnWrappedMessage const &anotherMessage){};
+    UnWrappedMessage(igtl_uint32 length=0){messageDataLength = length; messagePackPointer = length ? new unsigned char[length] : NULL;};
     ~UnWrappedMessage(){
       if(messagePackPointer)
       {
@@ -148,8 +242,11 @@ namespace igtl
         messagePackPointer = NULL;
       }
     };
-    unsigned char* messagePackPointer;  // we use 14 bits for fragment number, 2^14 = 16384. maximum
+    unsigned char* messagePackPointer;  // the reassembled message, messageDataLength bytes
     igtl_uint32 messageDataLength;
+  private:
+    UnWrappedMessage(UnWrappedMessage const &anotherMessage); // Not implemented.
+    void operator=(UnWrappedMessage const &anotherMessage); // Not implemented.
   };
   
   class IGTLCommon_EXPORT MessageRTPWrapper: public Object
@@ -206,6 +303,10 @@ namespace igtl
     
     int PushDataIntoPacketBuffer(igtlUint8* UDPPacket, igtlUint16 PacketLen);
     
+    /// Pushes 'numberOfPackets' received packets, e.g. read by UDPClientSocket::ReadSocketBatch(),
+    /// into the incomming packet buffer. Returns the number of packets pushed.
+    int PushDataIntoPacketBuffer(igtlUint8* const* UDPPackets, const int* PacketLens, int numberOfPackets);
+    
     int UnWrapPacketWithTypeAndName(const char *deviceType, const char * deviceName);
     
     igtl::MessageBase::Pointer UnWrapMessage(igtl_uint8* messageContent, int totMsgLen);
@@ -223,10 +324,10 @@ namespace igtl
     void SetMSGHeader(igtl_uint8* header);
     
     ///Get the wrapped outgoing UDP packet
-    PacketBuffer GetOutGoingPackets(){return outgoingPackets;};
+    const PacketBuffer& GetOutGoingPackets(){return outgoingPackets;};
     
     ///Get the incomming UDP packet
-    PacketBuffer GetInCommingPackets(){return incommingPackets;};
+    const PacketBuffer& GetInCommingPackets(){return incommingPackets;};
     
     int GetCurMSGLocation(){return this->curMSGLocation;};
     
@@ -234,10 +335,17 @@ namespace igtl
     
     int GetRTPWrapperStatus(){return status;};
     
-    void SetRTPPayloadLength(unsigned int payloadLength){this->RTPPayloadLength = payloadLength;};
+    ///Set the maximum payload length of a packet. The packet buffers are enlarged if needed.
+    void SetRTPPayloadLength(unsigned int payloadLength);
     
     unsigned int GetRTPPayloadLength(){return this->RTPPayloadLength;};
     
+    ///Get the number of messages whose fragments are being collected
+    int GetNumberOfReorderBuffers();
+    
+    ///Get the memory held for the fragments of incomplete messages in bytes
+    igtl_uint64 GetReorderBufferMemorySize();
+    
     std::map<igtl_uint32, igtl::UnWrappedMessage*> unWrappedMessages;
     
     igtl::SimpleMutexLock* glock;
@@ -256,6 +364,7 @@ namespace igtl
   private:
     unsigned int RTPPayloadLength;
     igtl_uint8* packedMsg;
+    unsigned int packedMsgSize;
     igtl_uint8* MSGHeader;
     unsigned int curMSGLocation;
     unsigned int curPackedMSGLocation;
@@ -269,10 +378,11 @@ namespace igtl
     igtl_uint32 SSRC;
     igtl_uint32 CSRC;
     igtl_uint32 fragmentTimeIncrement;
-    igtl::ReorderBuffer* reorderBuffer;
     std::map<igtl_uint32, igtl::ReorderBuffer*> reorderBufferMap;
     PacketBuffer incommingPackets;
     PacketBuffer outgoingPackets;
+    std::vector<igtl_uint8> incommingPacket; // the packet being unwrapped
+    std::vector<igtl_uint8> outgoingPacket; // the packets being sent, PacketBatchMaximumNum slots
     igtl::TimeStamp::Pointer wrapperTimer;
     bool FCFS; //first come first serve
     void SleepInNanoSecond(int nanoSecond);
@@ -0,0 +1,162 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMessageReplayer.h"
+#include "igtlAtomic.h"
+#include "igtlOSUtil.h"
+#include "igtlTimeStamp.h"
+
+// Number of messages passed to one Socket::SendFragments() call at the
+// maximum rate.
+#define IGTL_REPLAY_BATCH_SIZE  64
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+MessageReplayer::MessageReplayer()
+{
+  this->m_Reader = NULL;
+  this->m_Socket = NULL;
+  this->m_Speed = 1.0;
+  this->m_StopRequested = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+MessageReplayer::~MessageReplayer()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageReplayer::Replay(int first, int last)
+{
+  if (this->m_Reader.IsNull() || this->m_Socket.IsNull())
+    {
+    return -1;
+    }
+  int n = this->m_Reader->GetNumberOfMessages();
+  if (last < 0 || last >= n)
+    {
+    last = n - 1;
+    }
+  if (first < 0)
+    {
+    first = 0;
+    }
+
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicStore(&this->m_StopRequested, 0);
+#else
+  this->m_StopRequested = 0;
+#endif
+
+  int sent = 0;
+  if (this->m_Speed <= 0.0)
+    {
+    // As fast as possible: several messages per system call.
+    const void* fragments[IGTL_REPLAY_BATCH_SIZE];
+    int         lengths[IGTL_REPLAY_BATCH_SIZE];
+    for (int i = first; i <= last && !this->IsStopRequested(); i += IGTL_REPLAY_BATCH_SIZE)
+      {
+      int count = last - i + 1 < IGTL_REPLAY_BATCH_SIZE ? last - i + 1 : IGTL_REPLAY_BATCH_SIZE;
+      for (int j = 0; j < count; j ++)
+        {
+        fragments[j] = this->m_Reader->GetMessagePointer(i + j);
+        lengths[j] = (int)this->m_Reader->GetMessageSize(i + j);
+        }
+      if (!this->m_Socket->SendFragments(fragments, lengths, count))
+        {
+        break;
+        }
+      sent += count;
+      }
+    return sent;
+    }
+
+  igtlUint64 start = TimeStamp::GetMonotonicTimeInNanoseconds();
+  igtlUint64 firstTime = this->m_Reader->GetMessageTime(first);
+  for (int i = first; i <= last && !this->IsStopRequested(); i ++)
+    {
+    igtlUint64 time = this->m_Reader->GetMessageTime(i);
+    igtlUint64 elapsed = time > firstTime ? time - firstTime : 0;
+    this->WaitUntil(start + (igtlUint64)((double)elapsed / this->m_Speed));
+
+    if (!this->m_Socket->Send(this->m_Reader->GetMessagePointer(i),
+                              (int)this->m_Reader->GetMessageSize(i)))
+      {
+      break;
+      }
+    sent ++;
+    }
+  return sent;
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageReplayer::Stop()
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicStore(&this->m_StopRequested, 1);
+#else
+  this->m_StopRequested = 1;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+int MessageReplayer::IsStopRequested()
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  return AtomicLoad(&this->m_StopRequested);
+#else
+  return this->m_StopRequested;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageReplayer::WaitUntil(igtlUint64 time)
+{
+  for (;;)
+    {
+    igtlUint64 now = TimeStamp::GetMonotonicTimeInNanoseconds();
+    if (now >= time || this->IsStopRequested())
+      {
+      return;
+      }
+    // Sleep until about a millisecond before the time, then spin.
+    igtlUint64 remaining = time - now;
+    if (remaining > 2000000)
+      {
+      igtl::Sleep((int)(remaining / 1000000) - 1);
+      }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void MessageReplayer::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+
+  std::string indent = "    ";
+
+  os << indent << "Speed: " << this->m_Speed << std::endl;
+  os << indent << "Number of messages: "
+     << (this->m_Reader.IsNotNull() ? this->m_Reader->GetNumberOfMessages() : 0) << std::endl;
+}
+
+} // namespace igtl
@@ -0,0 +1,95 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlMessageReplayer_h
+#define __igtlMessageReplayer_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlMessageCaptureReader.h"
+#include "igtlSocket.h"
+
+namespace igtl
+{
+
+/// MessageReplayer re-sends the messages of a capture file (see
+/// igtl::MessageCaptureReader) over a socket, e.g. to reproduce a recorded
+/// session for a regression test or to load a server:
+///
+///     igtl::MessageReplayer::Pointer replayer = igtl::MessageReplayer::New();
+///     replayer->SetReader(reader);
+///     replayer->SetSocket(socket);
+///     replayer->SetSpeed(2.0);      // twice as fast as recorded
+///     int sent = replayer->Replay();
+///
+/// The messages are sent as recorded, directly from the mapped file. With a
+/// speed of 1 the intervals between the messages are those between their
+/// receive times; other speeds scale the intervals, and a speed of 0 sends
+/// the messages as fast as the socket accepts them, several per system call.
+/// For intervals shorter than a few milliseconds the replaying thread spins
+/// rather than sleeps to keep the timing.
+class IGTLCommon_EXPORT MessageReplayer: public Object
+{
+public:
+  igtlTypeMacro(igtl::MessageReplayer, igtl::Object)
+  igtlNewMacro(igtl::MessageReplayer);
+
+  void SetReader(MessageCaptureReader* reader) { this->m_Reader = reader; }
+  MessageCaptureReader* GetReader() { return this->m_Reader; }
+
+  void SetSocket(Socket* socket) { this->m_Socket = socket; }
+  Socket* GetSocket() { return this->m_Socket; }
+
+  /// Sets the replay speed relative to the recording; 0 replays at the
+  /// maximum rate. The default is 1.
+  igtlSetMacro(Speed, double);
+  igtlGetConstMacro(Speed, double);
+
+  /// Sends the messages 'first' to 'last' (the last message of the capture
+  /// if negative) and returns the number of messages sent, which is smaller
+  /// than requested if the socket fails or Stop() is called. Returns -1 if
+  /// the reader or the socket is not set.
+  int Replay(int first=0, int last=-1);
+
+  /// Makes a Replay() running in another thread return after the current
+  /// message.
+  void Stop();
+
+protected:
+  MessageReplayer();
+  ~MessageReplayer();
+
+  void PrintSelf(std::ostream& os) const;
+
+  /// Waits until the monotonic clock reaches 'time' (in nanoseconds).
+  void WaitUntil(igtlUint64 time);
+
+  /// Returns 1 if Stop() has been called.
+  int IsStopRequested();
+
+  MessageCaptureReader::Pointer m_Reader;
+  Socket::Pointer               m_Socket;
+  double                        m_Speed;
+  volatile int                  m_StopRequested;
+
+private:
+  MessageReplayer(const MessageReplayer&); // Not implemented.
+  void operator=(const MessageReplayer&); // Not implemented.
+};
+
+} // namespace igtl
+
+#endif // __igtlMessageReplayer_h
@@ -0,0 +1,401 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMetaDataStore.h"
+#include "igtl_header.h"
+#include "igtl_util.h"
+
+#include <string.h>
+
+namespace igtl
+{
+
+namespace
+{
+
+// Orders keys like std::string::compare().
+int CompareKeys(const char* a, size_t aSize, const char* b, size_t bSize)
+{
+  int r = memcmp(a, b, aSize < bSize ? aSize : bSize);
+  if (r != 0)
+    {
+    return r;
+    }
+  return aSize < bSize ? -1 : (aSize > bSize ? 1 : 0);
+}
+
+} // namespace
+
+
+MetaDataStore::MetaDataStore()
+{
+  this->Reset();
+}
+
+
+MetaDataStore::MetaDataStore(const MetaDataStore& store)
+{
+  this->Reset();
+  this->CopyFrom(store);
+}
+
+
+MetaDataStore::~MetaDataStore()
+{
+  this->Clear();
+}
+
+
+MetaDataStore& MetaDataStore::operator=(const MetaDataStore& store)
+{
+  if (this != &store)
+    {
+    this->Clear();
+    this->CopyFrom(store);
+    }
+  return *this;
+}
+
+
+void MetaDataStore::Reset()
+{
+  this->m_Entries = this->m_InlineEntries;
+  this->m_NumberOfEntries = 0;
+  this->m_EntryCapacity = INLINE_ENTRIES;
+  this->m_Bytes = this->m_InlineBytes;
+  this->m_Data = this->m_Bytes;
+  this->m_NumberOfBytes = 0;
+  this->m_ByteCapacity = INLINE_BYTES;
+  this->m_DataSize = 0;
+  this->m_AttachedSize = 0;
+  this->m_Attached = false;
+}
+
+
+void MetaDataStore::Clear()
+{
+  if (this->m_Entries != this->m_InlineEntries)
+    {
+    delete [] this->m_Entries;
+    }
+  if (this->m_Bytes != this->m_InlineBytes)
+    {
+    delete [] this->m_Bytes;
+    }
+  this->Reset();
+}
+
+
+int MetaDataStore::Search(const char* key, size_t keySize) const
+{
+  int low = 0;
+  int high = this->m_NumberOfEntries;
+  while (low < high)
+    {
+    int mid = (low + high) / 2;
+    int r = CompareKeys(this->GetKey(mid), this->m_Entries[mid].KeySize, key, keySize);
+    if (r == 0)
+      {
+      return mid;
+      }
+    if (r < 0)
+      {
+      low = mid + 1;
+      }
+    else
+      {
+      high = mid;
+      }
+    }
+  return ~low;
+}
+
+
+int MetaDataStore::Find(const char* key, size_t keySize) const
+{
+  int i = this->Search(key, keySize);
+  return i >= 0 ? i : -1;
+}
+
+
+MetaDataStore::Entry& MetaDataStore::InsertEntry(int index)
+{
+  if (this->m_NumberOfEntries == this->m_EntryCapacity)
+    {
+    int capacity = this->m_EntryCapacity * 2;
+    Entry* entries = new Entry[capacity];
+    memcpy(entries, this->m_Entries, this->m_NumberOfEntries * sizeof(Entry));
+    if (this->m_Entries != this->m_InlineEntries)
+      {
+      delete [] this->m_Entries;
+      }
+    this->m_Entries = entries;
+    this->m_EntryCapacity = capacity;
+    }
+  memmove(&this->m_Entries[index + 1], &this->m_Entries[index],
+          (this->m_NumberOfEntries - index) * sizeof(Entry));
+  this->m_NumberOfEntries ++;
+  return this->m_Entries[index];
+}
+
+
+igtlUint32 MetaDataStore::AppendBytes(const char* bytes, igtlUint32 size)
+{
+  igtlUint32 required = this->m_NumberOfBytes + size;
+  if (required > this->m_ByteCapacity)
+    {
+    igtlUint32 capacity = this->m_ByteCapacity * 2;
+    if (capacity < required)
+      {
+      capacity = required;
+      }
+    unsigned char* newBytes = new unsigned char[capacity];
+    memcpy(newBytes, this->m_Bytes, this->m_NumberOfBytes);
+    if (this->m_Bytes != this->m_InlineBytes)
+      {
+      delete [] this->m_Bytes;
+      }
+    this->m_Bytes = newBytes;
+    this->m_Data = newBytes;
+    this->m_ByteCapacity = capacity;
+    }
+  igtlUint32 offset = this->m_NumberOfBytes;
+  memcpy(&this->m_Bytes[offset], bytes, size);
+  this->m_NumberOfBytes = required;
+  return offset;
+}
+
+
+void MetaDataStore::Set(const char* key, igtlUint16 keySize, igtlUint16 encoding,
+                        const char* value, igtlUint32 valueSize)
+{
+  this->Detach();
+
+  int i = this->Search(key, keySize);
+  if (i >= 0)
+    {
+    Entry& entry = this->m_Entries[i];
+    this->m_DataSize -= entry.ValueSize;
+    if (valueSize <= entry.ValueSize)
+      {
+      memcpy(&this->m_Bytes[entry.ValueOffset], value, valueSize);
+      }
+    else
+      {
+      entry.ValueOffset = this->AppendBytes(value, valueSize);
+      }
+    entry.ValueSize = valueSize;
+    entry.Encoding = encoding;
+    this->m_DataSize += valueSize;
+
+    // Values replaced over and over (e.g. a counter set for every message)
+    // must not grow the byte array without bound.
+    if (this->m_NumberOfBytes > INLINE_BYTES &&
+        this->m_NumberOfBytes - this->m_DataSize > this->m_DataSize)
+      {
+      this->Compact();
+      }
+    return;
+    }
+
+  igtlUint32 keyOffset = this->AppendBytes(key, keySize);
+  igtlUint32 valueOffset = this->AppendBytes(value, valueSize);
+  Entry& entry = this->InsertEntry(~i);
+  entry.KeyOffset = keyOffset;
+  entry.KeySize = keySize;
+  entry.Encoding = encoding;
+  entry.ValueOffset = valueOffset;
+  entry.ValueSize = valueSize;
+  this->m_DataSize += keySize + valueSize;
+}
+
+
+bool MetaDataStore::Attach(const unsigned char* header, igtlUint64 headerSize,
+                           const unsigned char* data, igtlUint64 dataSize)
+{
+  this->Clear();
+  this->m_Data = data;
+  this->m_AttachedSize = dataSize;
+  this->m_Attached = true;
+
+  if (headerSize < sizeof(igtlUint16))
+    {
+    return headerSize == 0;
+    }
+  igtlUint16 indexCount;
+  memcpy(&indexCount, header, sizeof(igtlUint16));
+  if (igtl_is_little_endian())
+    {
+    indexCount = BYTE_SWAP_INT16(indexCount);
+    }
+
+  const unsigned char* entryPointer = &header[sizeof(igtlUint16)];
+  igtlUint64 offset = 0;
+  for (int n = 0; n < indexCount; n ++)
+    {
+    if (sizeof(igtlUint16) + (n + 1) * sizeof(igtl_metadata_header_entry) > headerSize)
+      {
+      return false;
+      }
+    igtl_metadata_header_entry wireEntry;
+    memcpy(&wireEntry.key_size, &entryPointer[0], sizeof(igtlUint16));
+    memcpy(&wireEntry.value_encoding, &entryPointer[2], sizeof(igtlUint16));
+    memcpy(&wireEntry.value_size, &entryPointer[4], sizeof(igtlUint32));
+    if (igtl_is_little_endian())
+      {
+      wireEntry.key_size = BYTE_SWAP_INT16(wireEntry.key_size);
+      wireEntry.value_encoding = BYTE_SWAP_INT16(wireEntry.value_encoding);
+      wireEntry.value_size = BYTE_SWAP_INT32(wireEntry.value_size);
+      }
+    entryPointer += sizeof(igtl_metadata_header_entry);
+
+    if (offset + wireEntry.key_size + wireEntry.value_size > dataSize)
+      {
+      return false;
+      }
+
+    // A key that appears more than once takes the last value.
+    const char* key = (const char*)&data[offset];
+    int i = this->Search(key, wireEntry.key_size);
+    if (i >= 0)
+      {
+      this->m_DataSize -= this->m_Entries[i].ValueSize;
+      }
+    else
+      {
+      i = ~i;
+      Entry& entry = this->InsertEntry(i);
+      entry.KeyOffset = (igtlUint32)offset;
+      entry.KeySize = wireEntry.key_size;
+      this->m_DataSize += wireEntry.key_size;
+      }
+    Entry& entry = this->m_Entries[i];
+    entry.Encoding = wireEntry.value_encoding;
+    entry.ValueOffset = (igtlUint32)(offset + wireEntry.key_size);
+    entry.ValueSize = wireEntry.value_size;
+    this->m_DataSize += wireEntry.value_size;
+    offset += wireEntry.key_size + wireEntry.value_size;
+    }
+
+  return true;
+}
+
+
+void MetaDataStore::Detach()
+{
+  if (!this->m_Attached)
+    {
+    return;
+    }
+  this->m_Attached = false;
+  this->m_AttachedSize = 0;
+  this->Compact();
+}
+
+
+void MetaDataStore::Compact()
+{
+  // The source may be the inline storage that is about to be rewritten.
+  const unsigned char* source = this->m_Data;
+  unsigned char copy[INLINE_BYTES];
+  if (source == this->m_InlineBytes)
+    {
+    memcpy(copy, this->m_InlineBytes, this->m_NumberOfBytes);
+    source = copy;
+    }
+
+  unsigned char* bytes = this->m_InlineBytes;
+  igtlUint32 capacity = INLINE_BYTES;
+  if (this->m_DataSize > INLINE_BYTES)
+    {
+    bytes = new unsigned char[this->m_DataSize];
+    capacity = this->m_DataSize;
+    }
+
+  igtlUint32 offset = 0;
+  for (int i = 0; i < this->m_NumberOfEntries; i ++)
+    {
+    Entry& entry = this->m_Entries[i];
+    memcpy(&bytes[offset], &source[entry.KeyOffset], entry.KeySize);
+    entry.KeyOffset = offset;
+    offset += entry.KeySize;
+    memcpy(&bytes[offset], &source[entry.ValueOffset], entry.ValueSize);
+    entry.ValueOffset = offset;
+    offset += entry.ValueSize;
+    }
+
+  if (this->m_Bytes != this->m_InlineBytes && this->m_Bytes != bytes)
+    {
+    delete [] this->m_Bytes;
+    }
+  this->m_Bytes = bytes;
+  this->m_Data = bytes;
+  this->m_ByteCapacity = capacity;
+  this->m_NumberOfBytes = offset;
+}
+
+
+void MetaDataStore::CopyFrom(const MetaDataStore& store)
+{
+  if (store.m_NumberOfEntries > this->m_EntryCapacity)
+    {
+    this->m_Entries = new Entry[store.m_NumberOfEntries];
+    this->m_EntryCapacity = store.m_NumberOfEntries;
+    }
+  memcpy(this->m_Entries, store.m_Entries, store.m_NumberOfEntries * sizeof(Entry));
+  this->m_NumberOfEntries = store.m_NumberOfEntries;
+  this->m_DataSize = store.m_DataSize;
+
+  // The offsets refer to the bytes of 'store' until compacted.
+  this->m_Data = store.m_Data;
+  this->Compact();
+}
+
+
+void MetaDataStore::Serialize(unsigned char* header, unsigned char* data) const
+{
+  igtlUint16 indexCount = (igtlUint16)this->m_NumberOfEntries;
+  if (igtl_is_little_endian())
+    {
+    indexCount = BYTE_SWAP_INT16(indexCount);
+    }
+  memcpy(header, &indexCount, sizeof(igtlUint16));
+
+  unsigned char* entryPointer = &header[sizeof(igtlUint16)];
+  for (int i = 0; i < this->m_NumberOfEntries; i ++)
+    {
+    const Entry& entry = this->m_Entries[i];
+    igtl_metadata_header_entry wireEntry;
+    wireEntry.key_size = entry.KeySize;
+    wireEntry.value_encoding = entry.Encoding;
+    wireEntry.value_size = entry.ValueSize;
+    if (igtl_is_little_endian())
+      {
+      wireEntry.key_size = BYTE_SWAP_INT16(wireEntry.key_size);
+      wireEntry.value_encoding = BYTE_SWAP_INT16(wireEntry.value_encoding);
+      wireEntry.value_size = BYTE_SWAP_INT32(wireEntry.value_size);
+      }
+    memcpy(&entryPointer[0], &wireEntry.key_size, sizeof(igtlUint16));
+    memcpy(&entryPointer[2], &wireEntry.value_encoding, sizeof(igtlUint16));
+    memcpy(&entryPointer[4], &wireEntry.value_size, sizeof(igtlUint32));
+    entryPointer += sizeof(igtl_metadata_header_entry);
+
+    memcpy(data, this->GetKey(i), entry.KeySize);
+    data += entry.KeySize;
+    memcpy(data, this->GetValue(i), entry.ValueSize);
+    data += entry.ValueSize;
+    }
+}
+
+} // namespace igtl
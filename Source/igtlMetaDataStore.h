@@ -0,0 +1,148 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlMetaDataStore_h
+#define __igtlMetaDataStore_h
+
+#include "igtlWin32Header.h"
+#include "igtlTypes.h"
+
+#include <stddef.h>
+
+namespace igtl
+{
+
+/// MetaDataStore holds the meta data elements (key, value encoding and value)
+/// of a message in a compact form: a table of entries sorted by key, whose
+/// keys and values are spans in a byte array. Up to INLINE_ENTRIES entries and
+/// INLINE_BYTES bytes of keys and values are stored in the object itself, so
+/// the meta data of a typical message does not allocate any memory.
+///
+/// A received meta data block can be attached without copying the keys and
+/// values: Attach() only parses the entry table, and the spans refer to the
+/// message buffer until Detach() copies them. The caller must detach the store
+/// before the buffer is modified or released.
+///
+/// The entries are kept in the order of std::map<std::string, ...>, i.e. sorted
+/// by the bytes of the key; setting an existing key replaces its value.
+class IGTLCommon_EXPORT MetaDataStore
+{
+public:
+  enum {
+    INLINE_ENTRIES = 8,
+    INLINE_BYTES = 256
+  };
+
+  MetaDataStore();
+  MetaDataStore(const MetaDataStore& store);
+  ~MetaDataStore();
+
+  /// Copies the entries of 'store'. The copy never refers to a message buffer.
+  MetaDataStore& operator=(const MetaDataStore& store);
+
+  /// Removes all entries.
+  void Clear();
+
+  /// Sets the value of 'key', adding the entry if it does not exist yet.
+  void Set(const char* key, igtlUint16 keySize, igtlUint16 encoding,
+           const char* value, igtlUint32 valueSize);
+
+  /// Replaces the entries with the serialized meta data: the meta data header
+  /// ('header', 'headerSize' bytes; index count followed by the entry table in
+  /// network byte order) and the keys and values ('data', 'dataSize' bytes).
+  /// The keys and values are not copied. Returns false if the meta data is
+  /// truncated; the entries preceding the truncated one are kept.
+  bool Attach(const unsigned char* header, igtlUint64 headerSize,
+              const unsigned char* data, igtlUint64 dataSize);
+
+  /// Copies the keys and values of an attached meta data block into the store.
+  void Detach();
+
+  /// Returns true if the keys and values refer to an attached buffer.
+  bool IsAttached() const { return this->m_Attached; }
+
+  /// Returns the index of the entry for 'key', or -1 if there is none.
+  int Find(const char* key, size_t keySize) const;
+
+  int GetNumberOfEntries() const { return this->m_NumberOfEntries; }
+
+  const char* GetKey(int i) const
+    { return (const char*)&this->m_Data[this->m_Entries[i].KeyOffset]; }
+  igtlUint16 GetKeySize(int i) const { return this->m_Entries[i].KeySize; }
+  igtlUint16 GetEncoding(int i) const { return this->m_Entries[i].Encoding; }
+  const char* GetValue(int i) const
+    { return (const char*)&this->m_Data[this->m_Entries[i].ValueOffset]; }
+  igtlUint32 GetValueSize(int i) const { return this->m_Entries[i].ValueSize; }
+
+  /// Returns the total size of the keys and values.
+  igtlUint32 GetDataSize() const { return this->m_DataSize; }
+
+  /// Writes the index count and the entry table to 'header', and the keys and
+  /// values to 'data', in the order of the entries.
+  void Serialize(unsigned char* header, unsigned char* data) const;
+
+protected:
+  struct Entry
+  {
+    igtlUint32 KeyOffset;
+    igtlUint32 ValueOffset;
+    igtlUint32 ValueSize;
+    igtlUint16 KeySize;
+    igtlUint16 Encoding;
+  };
+
+  /// Returns the index of the entry for 'key', or the bitwise complement of
+  /// the index at which it would be inserted.
+  int Search(const char* key, size_t keySize) const;
+
+  /// Inserts an entry at 'index', growing the entry table if needed.
+  Entry& InsertEntry(int index);
+
+  /// Appends 'size' bytes to the byte array and returns their offset.
+  igtlUint32 AppendBytes(const char* bytes, igtlUint32 size);
+
+  /// Drops the bytes of replaced values.
+  void Compact();
+
+  /// Copies the entries and the live bytes of 'store', in entry order.
+  void CopyFrom(const MetaDataStore& store);
+
+  /// Points the entries and byte array at the inline storage.
+  void Reset();
+
+  Entry*               m_Entries;
+  int                  m_NumberOfEntries;
+  int                  m_EntryCapacity;
+
+  // Keys and values; either m_Bytes or an attached buffer.
+  const unsigned char* m_Data;
+  unsigned char*       m_Bytes;
+  igtlUint32           m_NumberOfBytes;
+  igtlUint32           m_ByteCapacity;
+
+  // Size of the keys and values of the entries. m_Bytes may hold more bytes
+  // for replaced values.
+  igtlUint32           m_DataSize;
+
+  // Size of the attached buffer.
+  igtlUint64           m_AttachedSize;
+  bool                 m_Attached;
+
+  Entry                m_InlineEntries[INLINE_ENTRIES];
+  unsigned char        m_InlineBytes[INLINE_BYTES];
+};
+
+} // namespace igtl
+
+#endif // __igtlMetaDataStore_h
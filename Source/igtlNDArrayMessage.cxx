@@ -18,6 +18,7 @@
 
 #include "igtl_header.h"
 #include "igtl_ndarray.h"
+#include "igtl_util.h"
 
 // Disable warning C4996 (strncpy() may be unsafe) in Windows. 
 #define _CRT_SECURE_NO_WARNINGS
@@ -30,6 +31,7 @@ namespace igtl {
 ArrayBase::ArrayBase()
 {
   this->m_ByteArray = NULL;
+  this->m_IsView = false;
   this->m_Size.clear();
 }
 
@@ -37,25 +39,30 @@ ArrayBase::ArrayBase()
 ArrayBase::~ArrayBase()
 {
 
-  if (this->m_ByteArray)
+  if (this->m_ByteArray && !this->IsView())
     {
-    delete (igtlUint8 *) this->m_ByteArray;
+    delete [] (igtlUint8 *) this->m_ByteArray;
     }
 }
   
 int ArrayBase::SetSize(IndexType size)
 {
 
-  if (this->m_Size == size)
+  if (this->m_Size == size && !this->IsView())
     {
     // If the size of the array is same as specified,
     // do nothing
     return 1;
     }
 
-  if (this->m_ByteArray != NULL)
+  if (this->IsView())
+    {
+    this->m_IsView = false;
+    this->m_Owner = NULL;
+    }
+  else if (this->m_ByteArray != NULL)
     {
-    delete (igtlUint8 *) this->m_ByteArray;
+    delete [] (igtlUint8 *) this->m_ByteArray;
     }
   this->m_Size = size;
 
@@ -73,6 +80,26 @@ int ArrayBase::SetSize(IndexType size)
 }
 
 
+int ArrayBase::SetArrayView(IndexType size, void * array, LightObject * owner)
+{
+  if (array == NULL)
+    {
+    return 0;
+    }
+
+  if (this->m_ByteArray != NULL && !this->IsView())
+    {
+    delete [] (igtlUint8 *) this->m_ByteArray;
+    }
+  this->m_Size = size;
+  this->m_ByteArray = array;
+  this->m_IsView = true;
+  this->m_Owner = owner;
+
+  return 1;
+}
+
+
 int ArrayBase::SetArray(void * array)
 {
   if (this->m_ByteArray)
@@ -144,11 +171,14 @@ NDArrayMessage::NDArrayMessage():
   this->m_SendMessageType = "NDARRAY";
   this->m_Array = NULL;
   this->m_Type = 0;
+  this->m_ZeroCopyUnpack = false;
+  this->m_OwnsArray = false;
 }
 
 
 NDArrayMessage::~NDArrayMessage()
 {
+  this->DeleteViewArray();
 }
 
 
@@ -161,6 +191,7 @@ int NDArrayMessage::SetArray(int type, ArrayBase * a)
     return 0;
     }
   this->m_Type = type;
+  this->DeleteViewArray();
 
   if (a)
     {
@@ -213,31 +244,38 @@ int NDArrayMessage::PackContent()
     {
     s[i] = size[i];
     }
-  int r = igtl_ndarray_alloc_info(&info, s);
-  delete [] s;
 
-  if (r == 0)
+  // Pack directly from the raw array; the array is converted to the network
+  // byte order and fed to the CRC chunk by chunk.
+  info.size  = s;
+  info.array = this->m_Array->GetRawArray();
+  igtlUint64* crc = this->GetContentCRCPointer();
+  int r = igtl_ndarray_pack_crc64(&info, this->m_Content, IGTL_TYPE_PREFIX_NONE, crc);
+  if (r && crc)
     {
-    return 0;
+    this->m_ContentCRCSize += igtl_ndarray_get_size(&info, IGTL_TYPE_PREFIX_NONE);
     }
+  delete [] s;
 
-// size.data() doesn't work for some environtments (MacOS X 10.5 and Win32, as far as I know)
-//  if (igtl_ndarray_alloc_info(&info, size.data()) == 0)
-//    {
-//    return 0;
-//    }
-
-  memcpy(info.array, this->m_Array->GetRawArray(), this->m_Array->GetRawArraySize());
-  igtl_ndarray_pack(&info, this->m_Content, IGTL_TYPE_PREFIX_NONE);
-
-  return 1;
+  return r;
 }
 
 
 int NDArrayMessage::UnpackContent()
 {
+  this->DeleteViewArray();
+
+  if (this->m_ZeroCopyUnpack && this->UnpackContentView())
+    {
+    return 1;
+    }
+
   igtl_ndarray_info info;
-  igtl_ndarray_unpack(IGTL_TYPE_PREFIX_NONE, this->m_Content, &info, this->CalculateReceiveContentSize());
+  if (igtl_ndarray_unpack(IGTL_TYPE_PREFIX_NONE, this->m_Content, &info, this->CalculateReceiveContentSize()) == 0)
+    {
+    igtl_ndarray_free_info(&info);
+    return 0;
+    }
 
   this->m_Type = info.type;
   ArrayBase::IndexType size;
@@ -247,44 +285,156 @@ int NDArrayMessage::UnpackContent()
     size[i] = info.size[i];
     }
 
-  switch (this->m_Type)
+  this->m_Array = CreateArray(this->m_Type);
+  if (this->m_Array == NULL)
+    {
+    igtl_ndarray_free_info(&info);
+    return 0;
+    }
+
+  this->m_Array->SetSize(size);
+  memcpy(this->m_Array->GetRawArray(), info.array, this->m_Array->GetRawArraySize());
+  igtl_ndarray_free_info(&info);
+
+  return 1;
+}
+
+
+int NDArrayMessage::UnpackContentView()
+{
+  igtlUint64 contentSize = this->CalculateReceiveContentSize();
+  if (contentSize < IGTL_NDARRAY_HEADER_SIZE)
+    {
+    return 0;
+    }
+
+  unsigned char * ptr = this->m_Content;
+  int type = ptr[0];
+  int dim  = ptr[1];
+  igtlUint64 headerSize = IGTL_NDARRAY_HEADER_SIZE + sizeof(igtlUint16) * dim;
+  if (contentSize < headerSize)
+    {
+    return 0;
+    }
+
+  ArrayBase::IndexType size(dim);
+  igtlUint64 len = 1;
+  if (dim > 0)
+    {
+    igtl_convert_byte_order_copy(&size[0], ptr + IGTL_NDARRAY_HEADER_SIZE, dim, sizeof(igtlUint16));
+    }
+  for (int i = 0; i < dim; i ++)
+    {
+    len *= size[i];
+    }
+
+  ArrayBase * array = CreateArray(type);
+  if (array == NULL)
+    {
+    return 0;
+    }
+
+  // Move the array towards the start of the content, over the type, dimension and
+  // size fields that have been read, so that the elements are aligned. A complex
+  // value is a pair of 64-bit values.
+  igtlUint64 nbyte;
+  switch (type)
     {
-    case TYPE_INT8:
-      this->m_Array = new Array<igtlInt8>;
-      break;
-    case TYPE_UINT8:
-      this->m_Array = new Array<igtlUint8>;
-      break;
     case TYPE_INT16:
-      this->m_Array = new Array<igtlInt16>;
-      break;
     case TYPE_UINT16:
-      this->m_Array = new Array<igtlUint16>;
+      nbyte = 2;
       break;
     case TYPE_INT32:
-      this->m_Array = new Array<igtlInt32>;
-      break;
     case TYPE_UINT32:
-      this->m_Array = new Array<igtlUint32>;
-      break;
     case TYPE_FLOAT32:
-      this->m_Array = new Array<igtlFloat32>;
+      nbyte = 4;
       break;
     case TYPE_FLOAT64:
-      this->m_Array = new Array<igtlFloat64>;
-      break;
     case TYPE_COMPLEX:
-      this->m_Array = new Array<igtlComplex>;
+      nbyte = 8;
       break;
     default:
-      return 0;
+      nbyte = 1;
       break;
     }
+  unsigned char * data = ptr + headerSize;
+  igtlUint64 shift = (igtlUint64) ((size_t) data % nbyte);
+  igtlUint64 count = len * (type == TYPE_COMPLEX ? 2 : 1);
+  if (contentSize - headerSize < count * nbyte || shift > headerSize ||
+      this->PinBuffer() == NULL)
+    {
+    delete array;
+    return 0;
+    }
+
+  if (shift == 0)
+    {
+    igtl_convert_byte_order(data, count, (int) nbyte);
+    }
+  else
+    {
+    igtl_convert_byte_order_copy(data - shift, data, count, (int) nbyte);
+    }
+
+  // The message does not reference the buffer through the array, so that the buffer
+  // can be reused for the next message unless views are held by the application.
+  array->SetArrayView(size, data - shift);
+  this->m_Array = array;
+  this->m_Type = type;
+  this->m_OwnsArray = true;
 
-  this->m_Array->SetSize(size);
-  memcpy(this->m_Array->GetRawArray(), info.array, this->m_Array->GetRawArraySize());
-  
   return 1;
 }
 
+
+ArrayBase * NDArrayMessage::CreateArray(int type)
+{
+  switch (type)
+    {
+    case TYPE_INT8:
+      return new Array<igtlInt8>;
+    case TYPE_UINT8:
+      return new Array<igtlUint8>;
+    case TYPE_INT16:
+      return new Array<igtlInt16>;
+    case TYPE_UINT16:
+      return new Array<igtlUint16>;
+    case TYPE_INT32:
+      return new Array<igtlInt32>;
+    case TYPE_UINT32:
+      return new Array<igtlUint32>;
+    case TYPE_FLOAT32:
+      return new Array<igtlFloat32>;
+    case TYPE_FLOAT64:
+      return new Array<igtlFloat64>;
+    case TYPE_COMPLEX:
+      return new Array<igtlComplex>;
+    default:
+      return NULL;
+    }
+}
+
+
+igtlUint64 NDArrayMessage::GetNumberOfElements()
+{
+  igtlUint64 len = 1;
+  ArrayBase::IndexType size = this->m_Array->GetSize();
+  for (ArrayBase::IndexType::iterator iter = size.begin(); iter != size.end(); iter ++)
+    {
+    len *= *iter;
+    }
+  return len;
+}
+
+
+void NDArrayMessage::DeleteViewArray()
+{
+  if (this->m_OwnsArray)
+    {
+    delete this->m_Array;
+    this->m_Array = NULL;
+    this->m_OwnsArray = false;
+    }
+}
+
 } // namespace igtl
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include "igtlObject.h"
 #include "igtlMath.h"
 #include "igtlMessageBase.h"
+#include "igtlBufferView.h"
 #include "igtlTypes.h"
 
 #define IGTL_STRING_MESSAGE_DEFAULT_ENCODING 3 /* Default encoding -- ANSI-X3.5-1968 */
@@ -36,11 +37,12 @@ public:
 
 protected:
   ArrayBase();
-  ~ArrayBase();
 
 public:
+  virtual ~ArrayBase();
 
   /// Sets the size of the N-D array. Returns non-zero value, if success.
+  /// If the array is a view, it is replaced by an array owned by the class.
   int                     SetSize(IndexType size);
 
   /// Gets the size of the N-D array.
@@ -59,6 +61,14 @@ public:
   /// Gets the raw byte array stored in the class.
   void *                  GetRawArray()     { return this->m_ByteArray; };
 
+  /// Makes the class refer to 'array', which holds the elements of an array of
+  /// 'size', instead of a copy. If 'owner' is specified, it is referenced until
+  /// the array is resized or deleted, to keep the memory allocated.
+  int                     SetArrayView(IndexType size, void * array, LightObject * owner = NULL);
+
+  /// Returns true if the class refers to memory set by SetArrayView().
+  bool                    IsView()          { return this->m_IsView; };
+
 protected:
 
   /// Gets the size of a element of the array.
@@ -80,6 +90,12 @@ private:
   /// A pointer to the byte array data.
   void *                  m_ByteArray;
 
+  /// True if m_ByteArray is not owned by the class.
+  bool                    m_IsView;
+
+  /// The owner of m_ByteArray if the array is a view.
+  LightObject::Pointer    m_Owner;
+
 };
 
 
@@ -150,6 +166,33 @@ public:
   /// Gets the type of elements of the array. (e.g. TYPE_INT8)
   int         GetType()  { return this->m_Type; } ;
 
+  /// Enables zero-copy unpacking. When enabled, Unpack() converts the N-D array to
+  /// the host byte order in the receive buffer and GetArray() returns an array that
+  /// refers to the buffer instead of a copy. That array is owned by the message and
+  /// valid until the message is reused or deleted; use GetArrayView() to keep the
+  /// data beyond that. The serialized body is no longer in the network byte order
+  /// after unpacking. If the array cannot be aligned to its element size in the
+  /// buffer, it is copied as in the default mode. Disabled by default.
+  void        SetZeroCopyUnpack(bool zeroCopy) { this->m_ZeroCopyUnpack = zeroCopy; };
+  bool        GetZeroCopyUnpack() { return this->m_ZeroCopyUnpack; };
+
+  /// Returns a view of the elements of an array unpacked with zero-copy unpacking.
+  /// The view keeps the receive buffer allocated while it exists, even after the
+  /// message is deleted or reused. Returns an empty view if the array is not a
+  /// view of the buffer, if the message has been reused since, or if the size of
+  /// T does not match the element type.
+  template <typename T>
+  BufferView<T> GetArrayView()
+  {
+    if (!this->m_OwnsArray || this->m_PinnedBuffer.IsNull() ||
+        this->m_Array->GetRawArraySize() != (igtlUint64) sizeof(T) * this->GetNumberOfElements())
+      {
+      return BufferView<T>();
+      }
+    return BufferView<T>(static_cast<T*>(this->m_Array->GetRawArray()),
+                         this->GetNumberOfElements(), this->m_PinnedBuffer);
+  }
+
 protected:
   NDArrayMessage();
   ~NDArrayMessage();
@@ -159,13 +202,32 @@ protected:
   virtual int  CalculateContentBufferSize();
   virtual int  PackContent();
   virtual int  UnpackContent();
-  
+
+  /// Unpacks the content in place for zero-copy unpacking. Returns 0 if the array
+  /// must be copied instead.
+  int          UnpackContentView();
+
+  /// Creates an empty array of the element type 'type'.
+  static ArrayBase * CreateArray(int type);
+
+  /// Gets the number of elements of m_Array.
+  igtlUint64   GetNumberOfElements();
+
+  /// Deletes m_Array if it has been created by zero-copy unpacking.
+  void         DeleteViewArray();
+
   /// A pointer to the N-D array.
   ArrayBase *  m_Array;
 
   /// A variable for the type of the N-D array.
   int          m_Type;
 
+  /// True if Unpack() creates a view of the receive buffer.
+  bool         m_ZeroCopyUnpack;
+
+  /// True if m_Array has been created by zero-copy unpacking and is owned by the message.
+  bool         m_OwnsArray;
+
 };
 
 
@@ -0,0 +1,91 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlParallelCRC64.h"
+#include "igtlTaskExecutor.h"
+
+#include "igtl_util.h"
+
+#include <vector>
+
+namespace igtl
+{
+
+// Minimum number of bytes per block
+static const igtlUint64 ParallelCRC64MinimumBlockSize = 1024 * 1024;
+
+struct ParallelCRC64Data
+{
+  const unsigned char*    Data;
+  igtlUint64              Size;
+  igtlUint64              BlockSize;
+  int                     NumberOfBlocks;
+  std::vector<igtlUint64> BlockCRC;
+};
+
+
+static igtlUint64 ParallelCRC64BlockLength(const ParallelCRC64Data* data, int id)
+{
+  igtlUint64 begin = data->BlockSize * id;
+  if (id == data->NumberOfBlocks - 1)
+    {
+    return data->Size - begin;
+    }
+  return data->BlockSize;
+}
+
+
+static void ParallelCRC64Blocks(void* ptr, igtlInt64 begin, igtlInt64 end)
+{
+  ParallelCRC64Data* data = static_cast<ParallelCRC64Data*>(ptr);
+  for (int id = (int)begin; id < (int)end; id ++)
+    {
+    igtlUint64 length = ParallelCRC64BlockLength(data, id);
+    data->BlockCRC[id] = crc64(const_cast<unsigned char*>(data->Data + data->BlockSize * id), length, 0LL);
+    }
+}
+
+
+igtlUint64 ParallelCRC64(const void* data, igtlUint64 size, igtlUint64 crc, int numberOfThreads)
+{
+  // Selects the CRC implementation before the threads use it
+  crc = crc64((unsigned char*)data, 0, crc);
+
+  if (numberOfThreads > 1 && size / numberOfThreads < ParallelCRC64MinimumBlockSize)
+    {
+    numberOfThreads = (int)(size / ParallelCRC64MinimumBlockSize);
+    }
+  if (numberOfThreads <= 1)
+    {
+    return crc64((unsigned char*)data, size, crc);
+    }
+
+  ParallelCRC64Data blocks;
+  blocks.Data           = static_cast<const unsigned char*>(data);
+  blocks.Size           = size;
+  blocks.BlockSize      = size / numberOfThreads;
+  blocks.NumberOfBlocks = numberOfThreads;
+  blocks.BlockCRC.resize(numberOfThreads, 0);
+
+  TaskExecutor::GetGlobalExecutor()->ParallelFor(0, numberOfThreads, &ParallelCRC64Blocks, &blocks);
+
+  for (int i = 0; i < numberOfThreads; i ++)
+    {
+    crc = igtl_crc64_combine(crc, blocks.BlockCRC[i], ParallelCRC64BlockLength(&blocks, i));
+    }
+
+  return crc;
+}
+
+} // namespace igtl
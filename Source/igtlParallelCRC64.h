@@ -0,0 +1,35 @@
+/*=========================================================================
+
+  Program:   The OpenIGTLink Library
+  Language:  C++
+  Web page:  http://openigtlink.org/
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlParallelCRC64_h
+#define __igtlParallelCRC64_h
+
+#include "igtlWin32Header.h"
+#include "igtlTypes.h"
+
+namespace igtl
+{
+
+  /** Computes the CRC-64 of 'size' bytes at 'data' starting from 'crc', as crc64() does.
+   *  The data is split into 'numberOfThreads' blocks, which are checksummed concurrently
+   *  by the workers of TaskExecutor::GetGlobalExecutor() and merged with
+   *  igtl_crc64_combine(); the result is identical to the serial computation. Falls back
+   *  to crc64() if 'numberOfThreads' <= 1 or the blocks would be too small to amortize
+   *  the hand-over to the workers. */
+  igtlUint64 IGTLCommon_EXPORT ParallelCRC64(const void* data, igtlUint64 size, igtlUint64 crc,
+                                             int numberOfThreads);
+
+}
+
+#endif // __igtlParallelCRC64_h
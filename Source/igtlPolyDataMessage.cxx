@@ -42,11 +42,19 @@ PolyDataPointArray::~PolyDataPointArray()
 
 void PolyDataPointArray::Clear()
 {
+  this->m_StorageMode = CONTIGUOUS_STORAGE;
+  this->m_Coordinates.clear();
   this->m_Data.clear();
 }
 
 void PolyDataPointArray::SetNumberOfPoints(int n)
 {
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    this->m_Coordinates.resize(n * 3);
+    return;
+    }
+
   this->m_Data.resize(n);
 
   std::vector< Point >::iterator iter;
@@ -58,29 +66,25 @@ void PolyDataPointArray::SetNumberOfPoints(int n)
   
 int PolyDataPointArray::GetNumberOfPoints()
 {
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Coordinates.size() / 3;
+    }
   return this->m_Data.size();
 }
   
 int PolyDataPointArray::SetPoint(unsigned int id, igtlFloat32 * point)
 {
-  if (id >= this->m_Data.size())
-    {
-    return 0;
-    }
-  Point & dst = this->m_Data[id];
-  dst[0] = point[0];
-  dst[1] = point[1];
-  dst[2] = point[2];
-  return 1;
+  return this->SetPoint(id, point[0], point[1], point[2]);
 }
   
 int PolyDataPointArray::SetPoint(unsigned int id, igtlFloat32 x, igtlFloat32 y, igtlFloat32 z)
 {
-  if (id >= this->m_Data.size())
+  igtlFloat32 * dst = this->GetPointAddress(id);
+  if (dst == NULL)
     {
     return 0;
     }
-  Point & dst = this->m_Data[id];
   dst[0] = x;
   dst[1] = y;
   dst[2] = z;
@@ -89,18 +93,19 @@ int PolyDataPointArray::SetPoint(unsigned int id, igtlFloat32 x, igtlFloat32 y,
   
 int PolyDataPointArray::AddPoint(igtlFloat32 * point)
 {
-  Point newPoint;
-  newPoint.resize(3);
-  newPoint[0] = point[0];
-  newPoint[1] = point[1];
-  newPoint[2] = point[2];
-  this->m_Data.push_back(newPoint);
-  
-  return 1;
+  return this->AddPoint(point[0], point[1], point[2]);
 }
   
 int PolyDataPointArray::AddPoint(igtlFloat32 x, igtlFloat32 y, igtlFloat32 z)
 {
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    this->m_Coordinates.push_back(x);
+    this->m_Coordinates.push_back(y);
+    this->m_Coordinates.push_back(z);
+    return 1;
+    }
+
   Point newPoint;
   newPoint.resize(3);
   newPoint[0] = x;
@@ -113,32 +118,150 @@ int PolyDataPointArray::AddPoint(igtlFloat32 x, igtlFloat32 y, igtlFloat32 z)
   
 int PolyDataPointArray::GetPoint(unsigned int id, igtlFloat32 & x, igtlFloat32 & y, igtlFloat32 & z)
 {
-  if (id >= this->m_Data.size())
+  igtlFloat32 * src = this->GetPointAddress(id);
+  if (src == NULL)
     {
     return 0;
     }
-  Point & dst = this->m_Data[id];
-  x = dst[0];
-  y = dst[1];
-  z = dst[2];
+  x = src[0];
+  y = src[1];
+  z = src[2];
   return 1;
 }
 
 int PolyDataPointArray::GetPoint(unsigned int id, igtlFloat32 * point)
 {
-  if (id >= this->m_Data.size())
+  return this->GetPoint(id, point[0], point[1], point[2]);
+}
+
+void PolyDataPointArray::SetPoints(igtlUint32 n, const igtlFloat32 * xyz)
+{
+  this->m_StorageMode = CONTIGUOUS_STORAGE;
+  this->m_Data.clear();
+  this->m_Coordinates.assign(xyz, xyz + (size_t)n * 3);
+}
+
+int PolyDataPointArray::GetPoints(igtlFloat32 * xyz)
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
     {
-    return 0;
+    if (!this->m_Coordinates.empty())
+      {
+      memcpy(xyz, &this->m_Coordinates[0], this->m_Coordinates.size() * sizeof(igtlFloat32));
+      }
+    return 1;
+    }
+
+  std::vector< Point >::iterator iter;
+  for (iter = this->m_Data.begin(); iter != this->m_Data.end(); iter ++)
+    {
+    *(xyz++) = (*iter)[0];
+    *(xyz++) = (*iter)[1];
+    *(xyz++) = (*iter)[2];
     }
-  Point & dst = this->m_Data[id];
-  point[0] = dst[0];
-  point[1] = dst[1];
-  point[2] = dst[2];
   return 1;
 }
 
+igtlFloat32 * PolyDataPointArray::GetCoordinatePointer()
+{
+  this->SetStorageMode(CONTIGUOUS_STORAGE);
+  if (this->m_Coordinates.empty())
+    {
+    return NULL;
+    }
+  return &this->m_Coordinates[0];
+}
+
+void PolyDataPointArray::SetStorageMode(int mode)
+{
+  if (mode == this->m_StorageMode)
+    {
+    return;
+    }
+
+  if (mode == CONTIGUOUS_STORAGE)
+    {
+    this->m_Coordinates.resize(this->m_Data.size() * 3);
+    this->GetPoints(this->m_Coordinates.empty() ? NULL : &this->m_Coordinates[0]);
+    this->m_Data.clear();
+    this->m_StorageMode = CONTIGUOUS_STORAGE;
+    }
+  else if (mode == ELEMENT_STORAGE)
+    {
+    this->GetElementData();
+    }
+}
+
+igtlFloat32 * PolyDataPointArray::GetPointAddress(unsigned int id)
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    if (id >= this->m_Coordinates.size() / 3)
+      {
+      return NULL;
+      }
+    return &this->m_Coordinates[id * 3];
+    }
+
+  if (id >= this->m_Data.size())
+    {
+    return NULL;
+    }
+  return &this->m_Data[id][0];
+}
+
+std::vector<PolyDataPointArray::Point> & PolyDataPointArray::GetElementData()
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    size_t n = this->m_Coordinates.size() / 3;
+    this->m_Data.resize(n);
+    for (size_t i = 0; i < n; i ++)
+      {
+      this->m_Data[i].assign(&this->m_Coordinates[i * 3], &this->m_Coordinates[i * 3] + 3);
+      }
+    // Release the memory; the points are now in m_Data.
+    std::vector<igtlFloat32>().swap(this->m_Coordinates);
+    this->m_StorageMode = ELEMENT_STORAGE;
+    }
+  return this->m_Data;
+}
+
+size_t PolyDataPointArray::GetNumberOfElements() const
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Coordinates.size() / 3;
+    }
+  return this->m_Data.size();
+}
+
+PolyDataPointArray::Point PolyDataPointArray::GetElement(size_t id) const
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return Point(&this->m_Coordinates[id * 3], &this->m_Coordinates[id * 3] + 3);
+    }
+  return this->m_Data[id];
+}
+
 /// Implement support for C++11 ranged for loops
-igtlRangeBasedForBodyMacro(PolyDataPointArray, std::vector<PolyDataPointArray::Point>, m_Data);
+std::vector<PolyDataPointArray::Point>::iterator PolyDataPointArray::begin() { return GetElementData().begin(); }
+std::vector<PolyDataPointArray::Point>::iterator PolyDataPointArray::end() { return GetElementData().end(); }
+PolyDataPointArray::const_iterator PolyDataPointArray::begin() const { return const_iterator(this, 0); }
+PolyDataPointArray::const_iterator PolyDataPointArray::end() const { return const_iterator(this, GetNumberOfElements()); }
+std::vector<PolyDataPointArray::Point>::reverse_iterator PolyDataPointArray::rbegin() { return GetElementData().rbegin(); }
+std::vector<PolyDataPointArray::Point>::reverse_iterator PolyDataPointArray::rend() { return GetElementData().rend(); }
+PolyDataPointArray::const_reverse_iterator PolyDataPointArray::rbegin() const { return const_reverse_iterator(end()); }
+PolyDataPointArray::const_reverse_iterator PolyDataPointArray::rend() const { return const_reverse_iterator(begin()); }
+std::vector<PolyDataPointArray::Point>::iterator begin(PolyDataPointArray& list) { return list.begin(); }
+std::vector<PolyDataPointArray::Point>::iterator end(PolyDataPointArray& list) { return list.end(); }
+PolyDataPointArray::const_iterator begin(const PolyDataPointArray& list) { return list.begin(); }
+PolyDataPointArray::const_iterator end(const PolyDataPointArray& list) { return list.end(); }
+std::vector<PolyDataPointArray::Point>::reverse_iterator rbegin(PolyDataPointArray& list) { return list.rbegin(); }
+std::vector<PolyDataPointArray::Point>::reverse_iterator rend(PolyDataPointArray& list) { return list.rend(); }
+PolyDataPointArray::const_reverse_iterator rbegin(const PolyDataPointArray& list) { return list.rbegin(); }
+PolyDataPointArray::const_reverse_iterator rend(const PolyDataPointArray& list) { return list.rend(); }
 
 // Description:
 // PolyDataCellArray class to pass vertices, lines, polygons, and triangle strips
@@ -153,38 +276,63 @@ PolyDataCellArray::~PolyDataCellArray()
 
 void PolyDataCellArray::Clear()
 {
+  this->m_StorageMode = CONTIGUOUS_STORAGE;
+  this->m_Offsets.assign(1, 0);
+  this->m_Connectivity.clear();
   this->m_Data.clear();
 }
   
 igtlUint32 PolyDataCellArray::GetNumberOfCells()
 {
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Offsets.size() - 1;
+    }
   return this->m_Data.size();
 }
   
 void PolyDataCellArray::AddCell(int n, igtlUint32 * cell)
 {
+  if (n <= 0)
+    {
+    return;
+    }
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    this->m_Connectivity.insert(this->m_Connectivity.end(), cell, cell + n);
+    this->m_Offsets.push_back(this->m_Connectivity.size());
+    return;
+    }
+
   std::list<igtlUint32> newCell;
   for (int i = 0; i < n; i ++)
     {
     newCell.push_back(cell[i]);
     }
-  if (n > 0)
-    {
-    this->m_Data.push_back(newCell);
-    }
+  this->m_Data.push_back(newCell);
 }
 
 void PolyDataCellArray::AddCell(const Cell& cell)
 {
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    this->m_Connectivity.insert(this->m_Connectivity.end(), cell.begin(), cell.end());
+    this->m_Offsets.push_back(this->m_Connectivity.size());
+    return;
+    }
   this->m_Data.push_back(cell);
 }
 
 igtlUint32 PolyDataCellArray::GetCellSize(unsigned int id)
 {
-  if (id >= this->m_Data.size())
+  if (id >= this->GetNumberOfCells())
     {
       return 0;
     }
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Offsets[id + 1] - this->m_Offsets[id];
+    }
   return this->m_Data[id].size();
 }
   
@@ -192,6 +340,12 @@ igtlUint32 PolyDataCellArray::GetTotalSize()
 {
   igtlUint32 size;
 
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    size = this->GetNumberOfCells() + this->m_Connectivity.size();
+    return size * sizeof(igtlUint32);
+    }
+
   size = 0;
   std::vector< std::list<igtlUint32> >::iterator iter;
   for (iter = this->m_Data.begin(); iter != this->m_Data.end(); iter ++)
@@ -204,10 +358,20 @@ igtlUint32 PolyDataCellArray::GetTotalSize()
 
 int PolyDataCellArray::GetCell(unsigned int id, igtlUint32 * cell)
 {
-  if (id >= this->m_Data.size())
+  if (id >= this->GetNumberOfCells())
     {
     return 0;
     }
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    igtlUint32 n = this->m_Offsets[id + 1] - this->m_Offsets[id];
+    if (n > 0)
+      {
+      memcpy(cell, &this->m_Connectivity[this->m_Offsets[id]], n * sizeof(igtlUint32));
+      }
+    return 1;
+    }
+
   std::list<igtlUint32> & src = this->m_Data[id];
   std::list<igtlUint32>::iterator iter;
   
@@ -222,10 +386,17 @@ int PolyDataCellArray::GetCell(unsigned int id, igtlUint32 * cell)
 
 int PolyDataCellArray::GetCell(unsigned int id, std::list<igtlUint32>& cell)
 {
-  if (id >= this->m_Data.size())
+  if (id >= this->GetNumberOfCells())
     {
     return 0;
     }
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    cell.assign(this->m_Connectivity.begin() + this->m_Offsets[id],
+                this->m_Connectivity.begin() + this->m_Offsets[id + 1]);
+    return 1;
+    }
+
   std::list<igtlUint32> & src = this->m_Data[id];
   cell.resize(src.size());
 
@@ -240,8 +411,206 @@ int PolyDataCellArray::GetCell(unsigned int id, std::list<igtlUint32>& cell)
   return 1;
 }
 
+int PolyDataCellArray::SetCells(igtlUint32 numberOfCells, const igtlUint32 * offsets, const igtlUint32 * connectivity)
+{
+  if (offsets[0] != 0)
+    {
+    return 0;
+    }
+  for (igtlUint32 i = 0; i < numberOfCells; i ++)
+    {
+    if (offsets[i + 1] < offsets[i])
+      {
+      return 0;
+      }
+    }
+
+  this->m_StorageMode = CONTIGUOUS_STORAGE;
+  this->m_Data.clear();
+  this->m_Offsets.assign(offsets, offsets + numberOfCells + 1);
+  this->m_Connectivity.assign(connectivity, connectivity + offsets[numberOfCells]);
+  return 1;
+}
+
+igtlUint32 PolyDataCellArray::GetConnectivitySize()
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Connectivity.size();
+    }
+  return this->GetTotalSize() / sizeof(igtlUint32) - this->GetNumberOfCells();
+}
+
+int PolyDataCellArray::GetCells(igtlUint32 * offsets, igtlUint32 * connectivity)
+{
+  this->SetStorageMode(CONTIGUOUS_STORAGE);
+  memcpy(offsets, &this->m_Offsets[0], this->m_Offsets.size() * sizeof(igtlUint32));
+  if (!this->m_Connectivity.empty())
+    {
+    memcpy(connectivity, &this->m_Connectivity[0], this->m_Connectivity.size() * sizeof(igtlUint32));
+    }
+  return 1;
+}
+
+const igtlUint32 * PolyDataCellArray::GetOffsetPointer()
+{
+  this->SetStorageMode(CONTIGUOUS_STORAGE);
+  return &this->m_Offsets[0];
+}
+
+const igtlUint32 * PolyDataCellArray::GetConnectivityPointer()
+{
+  this->SetStorageMode(CONTIGUOUS_STORAGE);
+  if (this->m_Connectivity.empty())
+    {
+    return NULL;
+    }
+  return &this->m_Connectivity[0];
+}
+
+void PolyDataCellArray::GetPackedCells(igtlUint32 * data)
+{
+  igtlUint32 numberOfCells = this->GetNumberOfCells();
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    const igtlUint32 * src = this->m_Connectivity.empty() ? NULL : &this->m_Connectivity[0];
+    for (igtlUint32 i = 0; i < numberOfCells; i ++)
+      {
+      igtlUint32 n = this->m_Offsets[i + 1] - this->m_Offsets[i];
+      *(data++) = n;
+      if (n > 0)
+        {
+        memcpy(data, src, n * sizeof(igtlUint32));
+        data += n;
+        src += n;
+        }
+      }
+    return;
+    }
+
+  for (igtlUint32 i = 0; i < numberOfCells; i ++)
+    {
+    *data = this->GetCellSize(i);
+    data ++;
+    this->GetCell(i, data);
+    data += this->GetCellSize(i);
+    }
+}
+
+int PolyDataCellArray::SetPackedCells(igtlUint32 numberOfCells, const igtlUint32 * data, igtlUint32 size)
+{
+  igtlUint32 length = size / sizeof(igtlUint32);
+  if (numberOfCells > length)
+    {
+    return 0;
+    }
+
+  this->Clear();
+  this->m_Offsets.resize(numberOfCells + 1);
+  this->m_Connectivity.resize(length - numberOfCells);
+
+  igtlUint32 * dst = this->m_Connectivity.empty() ? NULL : &this->m_Connectivity[0];
+  igtlUint32 pos = 0;
+  for (igtlUint32 i = 0; i < numberOfCells; i ++)
+    {
+    igtlUint32 n = *(data++);
+    if (n > length - numberOfCells - pos)
+      {
+      this->Clear();
+      return 0;
+      }
+    memcpy(dst + pos, data, n * sizeof(igtlUint32));
+    data += n;
+    pos += n;
+    this->m_Offsets[i + 1] = pos;
+    }
+  if (pos != length - numberOfCells)
+    {
+    this->Clear();
+    return 0;
+    }
+  return 1;
+}
+
+void PolyDataCellArray::SetStorageMode(int mode)
+{
+  if (mode == this->m_StorageMode)
+    {
+    return;
+    }
+
+  if (mode == CONTIGUOUS_STORAGE)
+    {
+    std::vector<Cell> data;
+    data.swap(this->m_Data);
+    this->Clear();
+    std::vector<Cell>::iterator iter;
+    for (iter = data.begin(); iter != data.end(); iter ++)
+      {
+      this->AddCell(*iter);
+      }
+    }
+  else if (mode == ELEMENT_STORAGE)
+    {
+    this->GetElementData();
+    }
+}
+
+std::vector<PolyDataCellArray::Cell> & PolyDataCellArray::GetElementData()
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    size_t n = this->m_Offsets.size() - 1;
+    this->m_Data.resize(n);
+    for (size_t i = 0; i < n; i ++)
+      {
+      this->m_Data[i].assign(this->m_Connectivity.begin() + this->m_Offsets[i],
+                             this->m_Connectivity.begin() + this->m_Offsets[i + 1]);
+      }
+    // Release the memory; the cells are now in m_Data.
+    std::vector<igtlUint32>().swap(this->m_Connectivity);
+    std::vector<igtlUint32>().swap(this->m_Offsets);
+    this->m_StorageMode = ELEMENT_STORAGE;
+    }
+  return this->m_Data;
+}
+
+size_t PolyDataCellArray::GetNumberOfElements() const
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return this->m_Offsets.size() - 1;
+    }
+  return this->m_Data.size();
+}
+
+PolyDataCellArray::Cell PolyDataCellArray::GetElement(size_t id) const
+{
+  if (this->m_StorageMode == CONTIGUOUS_STORAGE)
+    {
+    return Cell(this->m_Connectivity.begin() + this->m_Offsets[id],
+                this->m_Connectivity.begin() + this->m_Offsets[id + 1]);
+    }
+  return this->m_Data[id];
+}
+
 /// Implement support for C++11 ranged for loops
-igtlRangeBasedForBodyMacro(PolyDataCellArray, std::vector<PolyDataCellArray::Cell>, m_Data);
+std::vector<PolyDataCellArray::Cell>::iterator PolyDataCellArray::begin() { return GetElementData().begin(); }
+std::vector<PolyDataCellArray::Cell>::iterator PolyDataCellArray::end() { return GetElementData().end(); }
+PolyDataCellArray::const_iterator PolyDataCellArray::begin() const { return const_iterator(this, 0); }
+PolyDataCellArray::const_iterator PolyDataCellArray::end() const { return const_iterator(this, GetNumberOfElements()); }
+std::vector<PolyDataCellArray::Cell>::reverse_iterator PolyDataCellArray::rbegin() { return GetElementData().rbegin(); }
+std::vector<PolyDataCellArray::Cell>::reverse_iterator PolyDataCellArray::rend() { return GetElementData().rend(); }
+PolyDataCellArray::const_reverse_iterator PolyDataCellArray::rbegin() const { return const_reverse_iterator(end()); }
+PolyDataCellArray::const_reverse_iterator PolyDataCellArray::rend() const { return const_reverse_iterator(begin()); }
+std::vector<PolyDataCellArray::Cell>::iterator begin(PolyDataCellArray& list) { return list.begin(); }
+std::vector<PolyDataCellArray::Cell>::iterator end(PolyDataCellArray& list) { return list.end(); }
+PolyDataCellArray::const_iterator begin(const PolyDataCellArray& list) { return list.begin(); }
+PolyDataCellArray::const_iterator end(const PolyDataCellArray& list) { return list.end(); }
+std::vector<PolyDataCellArray::Cell>::reverse_iterator rbegin(PolyDataCellArray& list) { return list.rbegin(); }
+std::vector<PolyDataCellArray::Cell>::reverse_iterator rend(PolyDataCellArray& list) { return list.rend(); }
+PolyDataCellArray::const_reverse_iterator rbegin(const PolyDataCellArray& list) { return list.rbegin(); }
+PolyDataCellArray::const_reverse_iterator rend(const PolyDataCellArray& list) { return list.rend(); }
 
 // Description:
 // Attribute class used for passing attribute data
@@ -358,11 +727,9 @@ int PolyDataAttribute::SetData(igtlFloat32 * data)
     return 0;
     }
 
-  std::vector<igtlFloat32>::iterator iter;
-  for (iter = this->m_Data.begin(); iter != this->m_Data.end(); iter ++)
+  if (!this->m_Data.empty())
     {
-    *iter = *data;
-    data ++;
+    memcpy(&this->m_Data[0], data, this->m_Data.size() * sizeof(igtlFloat32));
     }
 
   return 1;
@@ -375,15 +742,22 @@ int PolyDataAttribute::GetData(igtlFloat32 * data)
     return 0;
     }
 
-  std::vector<igtlFloat32>::iterator iter;
-  for (iter = this->m_Data.begin(); iter != this->m_Data.end(); iter ++)
+  if (!this->m_Data.empty())
     {
-    *data = *iter;
-    data ++;
+    memcpy(data, &this->m_Data[0], this->m_Data.size() * sizeof(igtlFloat32));
     }
   return 1;
 }
 
+igtlFloat32 * PolyDataAttribute::GetDataPointer()
+{
+  if (this->m_Data.empty())
+    {
+    return NULL;
+    }
+  return &this->m_Data[0];
+}
+
 int PolyDataAttribute::SetNthData(unsigned int n, igtlFloat32 * data)
 {
   if (n >= this->m_Size)
@@ -515,6 +889,7 @@ std::vector<igtlFloat32>::const_reverse_iterator rend(const PolyDataAttribute& l
 PolyDataMessage::PolyDataMessage()
 {
   this->m_SendMessageType = "POLYDATA";
+  this->m_ZeroCopyUnpack = false;
   Clear();
 }
 
@@ -587,6 +962,9 @@ void IGTLCommon_EXPORT SetPolyDataInfo(igtl_polydata_info * info, PolyDataMessag
 }
 
 
+// Sets the attributes in 'info'. The names and values refer to the storage of
+// the attributes in 'pdm' and must not be freed; call UnSetPolyDataInfoAttribute()
+// before igtl_polydata_free_info().
 void IGTLCommon_EXPORT SetPolyDataInfoAttribute(igtl_polydata_info * info, PolyDataMessage * pdm)
 {
 
@@ -599,27 +977,8 @@ void IGTLCommon_EXPORT SetPolyDataInfoAttribute(igtl_polydata_info * info, PolyD
       attr->type = src->GetType();
       attr->ncomponents = src->GetNumberOfComponents();
       attr->n = src->GetSize();
-      //attr->name = const_cast<char*>(src->GetName());
-      // TODO: aloways allocating memory isn't a good approach...
-      if (attr->name)
-        {
-        free(attr->name);
-        }
-      attr->name =  (char *) malloc(strlen(src->GetName())+1);
-      if (attr->name)
-        {
-        strcpy(attr->name, src->GetName());
-        }
-      if (attr->data)
-        {
-        free(attr->data);
-        }
-      igtlUint32 size = attr->ncomponents * attr->n;
-      attr->data = (igtlFloat32*)malloc((size_t)size*sizeof(igtlFloat32));
-      if (attr->data)
-        {
-        src->GetData(attr->data);
-        }
+      attr->name = const_cast<char*>(src->GetName());
+      attr->data = src->GetDataPointer();
       attr ++;
       }
     }
@@ -635,21 +994,27 @@ void IGTLCommon_EXPORT UnSetPolyDataInfoAttribute(igtl_polydata_info * info)
     attr->type = 0;
     attr->ncomponents = 0;
     attr->n = 0;
-    if (attr->name)
-      {
-      free(attr->name);
-      attr->name = NULL;
-      }
-    if (attr->data)
-      {
-      free(attr->data);
-      attr->data = NULL;
-      }
+    attr->name = NULL;
+    attr->data = NULL;
     attr ++;
     }
 }
 
 
+// Writes the cells in 'cells' to 'buffer' in the layout of the POLYDATA
+// message and returns a pointer to them, or NULL if there are no cells.
+static igtlUint32 * GetPackedCellData(PolyDataCellArray * cells, std::vector<igtlUint32> & buffer)
+{
+  if (cells == NULL || cells->GetNumberOfCells() == 0)
+    {
+    return NULL;
+    }
+  buffer.resize(cells->GetTotalSize() / sizeof(igtlUint32));
+  cells->GetPackedCells(&buffer[0]);
+  return &buffer[0];
+}
+
+
 int PolyDataMessage::CalculateContentBufferSize()
 {
   // TODO: The current implementation of GetBodyPackSize() allocates
@@ -709,91 +1074,62 @@ int PolyDataMessage::PackContent()
 
   SetPolyDataInfo(&info, this);
 
-  if (igtl_polydata_alloc_info(&info) == 0)
-    {
-    return 0;
-    }
-
-  //SetPolyDataInfoAttribute(&info, this);
-
-  // Points
-  if (info.points)
+  // The points and the attribute values are converted to the network byte
+  // order directly from their arrays. Only the cells are rearranged to the
+  // (N, i1, ... iN) layout of the message first.
+  std::vector<igtlFloat32> points;
+  if (info.header.npoints > 0)
     {
-    igtlFloat32 * ptr_f = info.points;
-    for (int i = 0; i < this->m_Points->GetNumberOfPoints(); i ++)
+    if (this->m_Points->GetStorageMode() == PolyDataPointArray::CONTIGUOUS_STORAGE)
       {
-      igtlFloat32 points[3];
-      this->m_Points->GetPoint(i, points);
-      *(ptr_f++) = points[0];
-      *(ptr_f++) = points[1];
-      *(ptr_f++) = points[2];
+      info.points = this->m_Points->GetCoordinatePointer();
       }
-    }
-
-  //Vertices
-  if (info.vertices)
-    {
-    igtlUint32 * ptr_i = info.vertices;
-    for (unsigned int i = 0; i < this->m_Vertices->GetNumberOfCells(); i ++)
+    else
       {
-      *ptr_i = this->m_Vertices->GetCellSize(i);
-      ptr_i ++;
-      this->m_Vertices->GetCell(i, ptr_i);
-      ptr_i += this->m_Vertices->GetCellSize(i);
+      points.resize(info.header.npoints * 3);
+      this->m_Points->GetPoints(&points[0]);
+      info.points = &points[0];
       }
     }
 
-  //Lines
-  if (info.lines)
-    {
-    igtlUint32 * ptr_i = info.lines;
-    for (unsigned int i = 0; i < this->m_Lines->GetNumberOfCells(); i ++)
-      {
-      *ptr_i = this->m_Lines->GetCellSize(i);
-      ptr_i ++;
-      this->m_Lines->GetCell(i, ptr_i);
-      ptr_i += this->m_Lines->GetCellSize(i);
-      }
-    }
+  std::vector<igtlUint32> vertices;
+  std::vector<igtlUint32> lines;
+  std::vector<igtlUint32> polygons;
+  std::vector<igtlUint32> triangleStrips;
+  info.vertices        = GetPackedCellData(this->m_Vertices, vertices);
+  info.lines           = GetPackedCellData(this->m_Lines, lines);
+  info.polygons        = GetPackedCellData(this->m_Polygons, polygons);
+  info.triangle_strips = GetPackedCellData(this->m_TriangleStrips, triangleStrips);
 
-  //Polygons
-  if (info.polygons)
+  std::vector<igtl_polydata_attribute> attributes(info.header.nattributes);
+  if (info.header.nattributes > 0)
     {
-    igtlUint32 * ptr_i = info.polygons;
-    for (unsigned int i = 0; i < this->m_Polygons->GetNumberOfCells(); i ++)
-      {
-      *ptr_i = this->m_Polygons->GetCellSize(i);
-      ptr_i ++;
-      this->m_Polygons->GetCell(i, ptr_i);
-      ptr_i += this->m_Polygons->GetCellSize(i);
-      }
+    info.attributes = &attributes[0];
+    SetPolyDataInfoAttribute(&info, this);
     }
 
-  //TriangleStrips
-  if (info.triangle_strips)
+  // Each section is converted to the network byte order and fed to the CRC
+  // chunk by chunk, while it is written to the content.
+  igtlUint64* crc = this->GetContentCRCPointer();
+  int r = igtl_polydata_pack_crc64(&info, this->m_Content, IGTL_TYPE_PREFIX_NONE, crc);
+  if (r && crc)
     {
-    igtlUint32 * ptr_i = info.triangle_strips;
-    for (unsigned int i = 0; i < this->m_TriangleStrips->GetNumberOfCells(); i ++)
-      {
-      *ptr_i = this->m_TriangleStrips->GetCellSize(i);
-      ptr_i ++;
-      this->m_TriangleStrips->GetCell(i, ptr_i);
-      ptr_i += this->m_TriangleStrips->GetCellSize(i);
-      }
+    this->m_ContentCRCSize += igtl_polydata_get_size(&info, IGTL_TYPE_PREFIX_NONE);
     }
 
-  SetPolyDataInfoAttribute(&info, this);
-
-  igtl_polydata_pack(&info, this->m_Content, IGTL_TYPE_PREFIX_NONE);
-  
-  igtl_polydata_free_info(&info);
-
-  return 1;
+  return r;
 }
 
 
 int PolyDataMessage::UnpackContent()
 {
+  this->ClearViews();
+
+  if (this->m_ZeroCopyUnpack && this->PinBuffer() != NULL)
+    {
+    return this->UnpackContentView();
+    }
+
   igtl_polydata_info info;
 
   igtl_polydata_init_info(&info);
@@ -804,6 +1140,7 @@ int PolyDataMessage::UnpackContent()
 
   if ( r == 0)
     {
+    igtl_polydata_free_info(&info);
     return 0;
     }
   
@@ -815,73 +1152,34 @@ int PolyDataMessage::UnpackContent()
   this->m_Points->Clear();
   if (info.header.npoints > 0)
     {
-    this->m_Points->SetNumberOfPoints(info.header.npoints);
-    for (unsigned int i = 0; i < info.header.npoints; i ++)
-      {
-      this->m_Points->SetPoint(i, &(info.points[i*3]));
-      }
+    this->m_Points->SetPoints(info.header.npoints, info.points);
     }
 
-  igtlUint32 * ptr;
-
-  // Vertices
+  // Cells
   if (this->m_Vertices.IsNull())
     {
     this->m_Vertices = igtl::PolyDataCellArray::New();
     }
-  this->m_Vertices->Clear();
-  ptr = info.vertices;
-  for (unsigned int i = 0; i < info.header.nvertices; i ++)
-    {
-    unsigned int n = *ptr;
-    ptr ++;
-    this->m_Vertices->AddCell(n, ptr);
-    ptr += n;
-    }
-
-  // Lines
   if (this->m_Lines.IsNull())
     {
     this->m_Lines = igtl::PolyDataCellArray::New();
     }
-  this->m_Lines->Clear();
-  ptr = info.lines;
-  for (unsigned int i = 0; i < info.header.nlines; i ++)
-    {
-    unsigned int n = *ptr;
-    ptr ++;
-    this->m_Lines->AddCell(n, ptr);
-    ptr += n;
-    }
-
-  // Polygons
   if (this->m_Polygons.IsNull())
     {
     this->m_Polygons = igtl::PolyDataCellArray::New();
     }
-  this->m_Polygons->Clear();
-  ptr = info.polygons;
-  for (unsigned int i = 0; i < info.header.npolygons; i ++)
-    {
-    unsigned int n = *ptr;
-    ptr ++;
-    this->m_Polygons->AddCell(n, ptr);
-    ptr += n;
-    }
-
-  // TriangleStrips
   if (this->m_TriangleStrips.IsNull())
     {
     this->m_TriangleStrips = igtl::PolyDataCellArray::New();
     }
-  this->m_TriangleStrips->Clear();
-  ptr = info.triangle_strips;
-  for (unsigned int i = 0; i < info.header.ntriangle_strips; i ++)
+  if (!this->m_Vertices->SetPackedCells(info.header.nvertices, info.vertices, info.header.size_vertices) ||
+      !this->m_Lines->SetPackedCells(info.header.nlines, info.lines, info.header.size_lines) ||
+      !this->m_Polygons->SetPackedCells(info.header.npolygons, info.polygons, info.header.size_polygons) ||
+      !this->m_TriangleStrips->SetPackedCells(info.header.ntriangle_strips, info.triangle_strips,
+                                              info.header.size_triangle_strips))
     {
-    unsigned int n = *ptr;
-    ptr ++;
-    this->m_TriangleStrips->AddCell(n, ptr);
-    ptr += n;
+    igtl_polydata_free_info(&info);
+    return 0;
     }
   
   // Attributes
@@ -904,6 +1202,7 @@ int PolyDataMessage::UnpackContent()
       }
     }
 
+  igtl_polydata_free_info(&info);
 
   return 1;
 }
@@ -939,8 +1238,215 @@ void PolyDataMessage::Clear()
     }
   // TODO: is this OK?
   this->m_Attributes.clear();
+  ClearViews();
 }
 
+int PolyDataMessage::UnpackContentView()
+{
+  igtlUint64 contentSize = this->CalculateReceiveContentSize();
+  unsigned char * content = this->m_Content;
+  unsigned char * ptr = content;
+
+  // POLYDATA header, which consists of 32-bit fields only
+  igtl_polydata_header header;
+  if (contentSize < sizeof(igtl_polydata_header))
+    {
+    return 0;
+    }
+  igtl_convert_byte_order_copy(&header, ptr, sizeof(igtl_polydata_header) / sizeof(igtlUint32),
+                               sizeof(igtlUint32));
+  ptr += sizeof(igtl_polydata_header);
+
+  // Points and cells form one block of 32-bit values
+  igtlUint32 cellSizes[4] = {header.size_vertices, header.size_lines,
+                             header.size_polygons, header.size_triangle_strips};
+  igtlUint64 blockSize = (igtlUint64) header.npoints * 3 * sizeof(igtlFloat32);
+  for (int i = 0; i < 4; i ++)
+    {
+    if (cellSizes[i] % sizeof(igtlUint32) != 0)
+      {
+      return 0;
+      }
+    blockSize += cellSizes[i];
+    }
+  if ((igtlUint64) (ptr - content) + blockSize > contentSize)
+    {
+    return 0;
+    }
+  unsigned char * block = ptr;
+  ptr += blockSize;
+
+  // Attribute headers and names
+  std::vector<igtl_polydata_attribute> attributes(header.nattributes);
+  std::vector<std::string> names(header.nattributes);
+  if ((igtlUint64) (ptr - content) + (igtlUint64) header.nattributes * sizeof(igtl_polydata_attribute_header)
+      > contentSize)
+    {
+    return 0;
+    }
+  for (unsigned int i = 0; i < header.nattributes; i ++)
+    {
+    igtl_polydata_attribute_header * attHeader = (igtl_polydata_attribute_header *) ptr;
+    attributes[i].type        = attHeader->type;
+    attributes[i].ncomponents = attHeader->ncomponents;
+    igtl_convert_byte_order_copy(&attributes[i].n, &attHeader->n, 1, sizeof(igtlUint32));
+    ptr += sizeof(igtl_polydata_attribute_header);
+    }
+  igtlUint64 totalNameLength = 0;
+  for (unsigned int i = 0; i < header.nattributes; i ++)
+    {
+    unsigned char * end = (unsigned char *) memchr(ptr, '\0', (size_t) (contentSize - (ptr - content)));
+    if (end == NULL || end - ptr > IGTL_POLY_MAX_ATTR_NAME_LEN)
+      {
+      return 0;
+      }
+    names[i].assign((const char *) ptr, end - ptr);
+    totalNameLength += (end - ptr) + 1;
+    ptr = end + 1;
+    }
+  if (totalNameLength % 2 > 0)
+    {
+    ptr ++;
+    }
+
+  // Attribute data, with the same numbers of values as igtl_polydata_unpack()
+  std::vector<igtlUint64> attributeSizes(header.nattributes);
+  igtlUint64 attributeBlockSize = 0;
+  for (unsigned int i = 0; i < header.nattributes; i ++)
+    {
+    igtlUint64 n = attributes[i].n;
+    if (attributes[i].type == IGTL_POLY_ATTR_TYPE_SCALAR)
+      {
+      n *= attributes[i].ncomponents;
+      }
+    else if (attributes[i].type == IGTL_POLY_ATTR_TYPE_NORMAL ||
+             attributes[i].type == IGTL_POLY_ATTR_TYPE_VECTOR)
+      {
+      n *= 3;
+      }
+    else
+      {
+      n *= 9;
+      }
+    attributeSizes[i] = n;
+    attributeBlockSize += n * sizeof(igtlFloat32);
+    }
+  if ((igtlUint64) (ptr - content) + attributeBlockSize > contentSize)
+    {
+    return 0;
+    }
+  unsigned char * attributeBlock = ptr;
+
+  // Convert each block in place. A block that is not aligned to 4 bytes is moved
+  // towards the start of the content, over the headers that have been read.
+  unsigned char * dst = block - (size_t) block % sizeof(igtlUint32);
+  igtl_convert_byte_order_copy(dst, block, blockSize / sizeof(igtlUint32), sizeof(igtlUint32));
+  block = dst;
+  dst = attributeBlock - (size_t) attributeBlock % sizeof(igtlFloat32);
+  igtl_convert_byte_order_copy(dst, attributeBlock, attributeBlockSize / sizeof(igtlFloat32),
+                               sizeof(igtlFloat32));
+  attributeBlock = dst;
+
+  // Locate the arrays
+  this->m_PointsView = (igtlFloat32 *) block;
+  this->m_PointsViewSize = (igtlUint64) header.npoints * 3;
+  block += this->m_PointsViewSize * sizeof(igtlFloat32);
+  for (int i = 0; i < 4; i ++)
+    {
+    this->m_CellViews[i] = (igtlUint32 *) block;
+    this->m_CellViewSizes[i] = cellSizes[i] / sizeof(igtlUint32);
+    block += cellSizes[i];
+    }
+
+  // The point and cell arrays are left empty
+  if (this->m_Points.IsNull())
+    {
+    this->m_Points = igtl::PolyDataPointArray::New();
+    }
+  this->m_Points->Clear();
+  PolyDataCellArray::Pointer * cells[4] = {&this->m_Vertices, &this->m_Lines,
+                                           &this->m_Polygons, &this->m_TriangleStrips};
+  for (int i = 0; i < 4; i ++)
+    {
+    if (cells[i]->IsNull())
+      {
+      *cells[i] = igtl::PolyDataCellArray::New();
+      }
+    (*cells[i])->Clear();
+    }
+
+  this->m_Attributes.clear();
+  this->m_AttributeViews.resize(header.nattributes);
+  this->m_AttributeViewSizes.resize(header.nattributes);
+  for (unsigned int i = 0; i < header.nattributes; i ++)
+    {
+    PolyDataAttribute::Pointer pda = PolyDataAttribute::New();
+    pda->SetType(attributes[i].type, attributes[i].ncomponents);
+    pda->SetName(names[i].c_str());
+    this->m_Attributes.push_back(pda);
+    this->m_AttributeViews[i] = (igtlFloat32 *) attributeBlock;
+    this->m_AttributeViewSizes[i] = attributeSizes[i];
+    attributeBlock += attributeSizes[i] * sizeof(igtlFloat32);
+    }
+
+  return 1;
+}
+
+
+void PolyDataMessage::ClearViews()
+{
+  this->m_PointsView = NULL;
+  this->m_PointsViewSize = 0;
+  for (int i = 0; i < 4; i ++)
+    {
+    this->m_CellViews[i] = NULL;
+    this->m_CellViewSizes[i] = 0;
+    }
+  this->m_AttributeViews.clear();
+  this->m_AttributeViewSizes.clear();
+}
+
+
+BufferView<igtlFloat32> PolyDataMessage::GetPointsView()
+{
+  return this->GetView(this->m_PointsView, this->m_PointsViewSize);
+}
+
+
+BufferView<igtlUint32> PolyDataMessage::GetVerticesView()
+{
+  return this->GetView(this->m_CellViews[0], this->m_CellViewSizes[0]);
+}
+
+
+BufferView<igtlUint32> PolyDataMessage::GetLinesView()
+{
+  return this->GetView(this->m_CellViews[1], this->m_CellViewSizes[1]);
+}
+
+
+BufferView<igtlUint32> PolyDataMessage::GetPolygonsView()
+{
+  return this->GetView(this->m_CellViews[2], this->m_CellViewSizes[2]);
+}
+
+
+BufferView<igtlUint32> PolyDataMessage::GetTriangleStripsView()
+{
+  return this->GetView(this->m_CellViews[3], this->m_CellViewSizes[3]);
+}
+
+
+BufferView<igtlFloat32> PolyDataMessage::GetAttributeView(AttributeList::size_type id)
+{
+  if (id >= this->m_AttributeViews.size())
+    {
+    return BufferView<igtlFloat32>();
+    }
+  return this->GetView(this->m_AttributeViews[id], this->m_AttributeViewSizes[id]);
+}
+
+
 void PolyDataMessage::ClearAttributes()
 {
   std::vector<PolyDataAttribute::Pointer>::iterator iter;
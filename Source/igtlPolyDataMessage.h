@@ -15,12 +15,15 @@
 #ifndef __igtlPolyDataMessage_h
 #define __igtlPolyDataMessage_h
 
+#include <cstddef>
+#include <iterator>
 #include <string>
 
 #include "igtlObject.h"
 #include "igtlMacro.h"
 #include "igtlMath.h"
 #include "igtlMessageBase.h"
+#include "igtlBufferView.h"
 #include "igtlTypes.h"
 
 namespace igtl
@@ -100,7 +103,47 @@ protected:
   
   
   
+/// Read-only iterator over the points of a PolyDataPointArray or the cells of a
+/// PolyDataCellArray. It reads whichever storage is current and returns a copy
+/// of each element, so that iterating a const array neither converts the
+/// storage nor invalidates the pointers to it.
+template <class TArray, class TElement>
+class PolyDataConstIterator
+{
+public:
+  typedef std::bidirectional_iterator_tag iterator_category;
+  typedef TElement        value_type;
+  typedef std::ptrdiff_t  difference_type;
+  typedef const TElement* pointer;
+  typedef TElement        reference;
+
+  PolyDataConstIterator() : m_Array(NULL), m_Index(0) {}
+  PolyDataConstIterator(const TArray* array, size_t index) : m_Array(array), m_Index(index) {}
+
+  TElement operator*() const { return this->m_Array->GetElement(this->m_Index); }
+
+  PolyDataConstIterator& operator++() { ++ this->m_Index; return *this; }
+  PolyDataConstIterator operator++(int) { PolyDataConstIterator i(*this); ++ this->m_Index; return i; }
+  PolyDataConstIterator& operator--() { -- this->m_Index; return *this; }
+  PolyDataConstIterator operator--(int) { PolyDataConstIterator i(*this); -- this->m_Index; return i; }
+
+  bool operator==(const PolyDataConstIterator& i) const { return this->m_Array == i.m_Array && this->m_Index == i.m_Index; }
+  bool operator!=(const PolyDataConstIterator& i) const { return !(*this == i); }
+
+private:
+  const TArray* m_Array;
+  size_t        m_Index;
+};
+
 // A class to manage a point array.
+//
+// The coordinates of the points are stored in a single contiguous array of
+// x, y, z triplets, so that large meshes can be set, read, packed and
+// unpacked in bulk (see SetPoints(), GetPoints() and GetCoordinatePointer()).
+// The array is converted to one vector per point (ELEMENT_STORAGE) only if
+// it is iterated with the non-const begin()/end(), e.g. in a range-based for
+// loop; the conversion invalidates the pointer returned by
+// GetCoordinatePointer(). Iterating a const array does not convert it.
 class IGTLCommon_EXPORT PolyDataPointArray : public Object {
 
  public:
@@ -108,6 +151,12 @@ class IGTLCommon_EXPORT PolyDataPointArray : public Object {
   /// A vector to represent coordinates of a point.
   typedef std::vector<igtlFloat32> Point;
 
+  /// Storage modes.
+  enum {
+    CONTIGUOUS_STORAGE,
+    ELEMENT_STORAGE
+  };
+
  public:
   igtlTypeMacro(igtl::PolyDataPointArray, igtl::Object);
   igtlNewMacro(igtl::PolyDataPointArray);
@@ -147,17 +196,79 @@ class IGTLCommon_EXPORT PolyDataPointArray : public Object {
   /// Gets the coordinates of the point specified by 'id'
   int  GetPoint(unsigned int id, igtlFloat32 * point);
 
-  /// Implement support for C++11 ranged for loops
-  igtlRangeBasedForHeaderMemberMacro(std::vector<Point>);
+  /// Replaces all points with 'n' points. 'xyz' contains the coordinates
+  /// as x0, y0, z0, x1, y1, z1, ...
+  void SetPoints(igtlUint32 n, const igtlFloat32 * xyz);
+
+  /// Copies the coordinates of all points to 'xyz', which must have room
+  /// for 3 * GetNumberOfPoints() values.
+  int  GetPoints(igtlFloat32 * xyz);
+
+  /// Returns a pointer to the coordinates of all points (3 * GetNumberOfPoints()
+  /// values), or NULL if the array is empty. The pointer is valid until
+  /// the number of points or the storage mode changes. Iterating a non-const
+  /// array with begin()/end() changes the storage mode.
+  igtlFloat32 * GetCoordinatePointer();
+
+  /// Sets the storage mode (CONTIGUOUS_STORAGE or ELEMENT_STORAGE) and
+  /// converts the points if necessary.
+  void SetStorageMode(int mode);
+  int  GetStorageMode() const { return this->m_StorageMode; };
+
+  /// Implement support for C++11 ranged for loops. The const versions iterate
+  /// copies of the points in either storage mode.
+  typedef PolyDataConstIterator<PolyDataPointArray, Point> const_iterator;
+  typedef std::reverse_iterator<const_iterator>           const_reverse_iterator;
+  std::vector<Point>::iterator begin();
+  std::vector<Point>::iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+  std::vector<Point>::reverse_iterator rbegin();
+  std::vector<Point>::reverse_iterator rend();
+  const_reverse_iterator rbegin() const;
+  const_reverse_iterator rend() const;
 
  private:
-  /// A list of the points.
+  friend class PolyDataConstIterator<PolyDataPointArray, Point>;
+
+  /// Returns the coordinates of the point specified by 'id', or NULL.
+  igtlFloat32 * GetPointAddress(unsigned int id);
+
+  /// Converts the points to ELEMENT_STORAGE and returns the list of points.
+  std::vector<Point> & GetElementData();
+
+  /// Returns the number of points and a copy of the point specified by 'id'
+  /// without changing the storage mode.
+  size_t GetNumberOfElements() const;
+  Point  GetElement(size_t id) const;
+
+  /// The storage mode.
+  int m_StorageMode;
+
+  /// The coordinates of the points in CONTIGUOUS_STORAGE.
+  std::vector<igtlFloat32> m_Coordinates;
+
+  /// A list of the points in ELEMENT_STORAGE.
   std::vector< Point > m_Data;
 };
 
-igtlRangeBasedForHeaderExternalMacro(PolyDataPointArray, std::vector<PolyDataPointArray::Point>, IGTLCommon_EXPORT);
+IGTLCommon_EXPORT std::vector<PolyDataPointArray::Point>::iterator begin(PolyDataPointArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataPointArray::Point>::iterator end(PolyDataPointArray& list);
+IGTLCommon_EXPORT PolyDataPointArray::const_iterator begin(const PolyDataPointArray& list);
+IGTLCommon_EXPORT PolyDataPointArray::const_iterator end(const PolyDataPointArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataPointArray::Point>::reverse_iterator rbegin(PolyDataPointArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataPointArray::Point>::reverse_iterator rend(PolyDataPointArray& list);
+IGTLCommon_EXPORT PolyDataPointArray::const_reverse_iterator rbegin(const PolyDataPointArray& list);
+IGTLCommon_EXPORT PolyDataPointArray::const_reverse_iterator rend(const PolyDataPointArray& list);
 
 // The PolyDataCellArray class is used to pass vertices, lines, polygons, and triangle strips
+//
+// The cells are stored in two contiguous arrays: the point indices of all
+// cells (connectivity) and the position of the first index of each cell
+// in it (offsets), as in VTK. The points of cell i are connectivity[offsets[i]]
+// to connectivity[offsets[i+1]-1]. The array is converted to one list per
+// cell (ELEMENT_STORAGE) only if it is iterated with the non-const
+// begin()/end(). Iterating a const array does not convert it.
 class IGTLCommon_EXPORT PolyDataCellArray : public Object {
   
  public:
@@ -168,6 +279,12 @@ class IGTLCommon_EXPORT PolyDataCellArray : public Object {
     NULL_POINT = 0xFFFFFFFF,
   };
 
+  /// Storage modes.
+  enum {
+    CONTIGUOUS_STORAGE,
+    ELEMENT_STORAGE
+  };
+
  public:
   igtlTypeMacro(igtl::PolyDataCellArray, igtl::Object);
   igtlNewMacro(igtl::PolyDataCellArray);
@@ -211,16 +328,86 @@ class IGTLCommon_EXPORT PolyDataCellArray : public Object {
   /// Gets the cell specified by the 'id'. A list of points in the cell will be stored in the 'cell'.
   int        GetCell(unsigned int id, Cell& cell);
 
-  /// Implement support for C++11 ranged for loops
-  igtlRangeBasedForHeaderMemberMacro(std::vector<Cell>);
+  /// Replaces all cells with 'numberOfCells' cells. 'offsets' has
+  /// numberOfCells + 1 values, starting with 0 and not decreasing; the last
+  /// value is the number of point indices in 'connectivity'.
+  /// Returns 0 if 'offsets' is invalid.
+  int        SetCells(igtlUint32 numberOfCells, const igtlUint32 * offsets, const igtlUint32 * connectivity);
+
+  /// Gets the number of point indices in all cells.
+  igtlUint32 GetConnectivitySize();
+
+  /// Copies the cells to 'offsets' (GetNumberOfCells() + 1 values) and
+  /// 'connectivity' (GetConnectivitySize() values).
+  int        GetCells(igtlUint32 * offsets, igtlUint32 * connectivity);
+
+  /// Return pointers to the offsets and the point indices of all cells (see
+  /// SetCells()). The pointers are valid until the cells or the storage mode
+  /// change. Iterating a non-const array with begin()/end() changes the
+  /// storage mode. GetConnectivityPointer() returns NULL if there are no
+  /// indices.
+  const igtlUint32 * GetOffsetPointer();
+  const igtlUint32 * GetConnectivityPointer();
+
+  /// Writes the cells in the layout of the POLYDATA message, i.e.
+  /// (N, i1, ... iN) for each cell, to 'data', which must have room for
+  /// GetTotalSize() bytes. The values are in the host byte order.
+  void       GetPackedCells(igtlUint32 * data);
+
+  /// Replaces all cells with 'numberOfCells' cells stored in the layout of
+  /// the POLYDATA message. 'size' is the size of 'data' in bytes. Returns 0
+  /// if the cells do not match 'size'.
+  int        SetPackedCells(igtlUint32 numberOfCells, const igtlUint32 * data, igtlUint32 size);
+
+  /// Sets the storage mode (CONTIGUOUS_STORAGE or ELEMENT_STORAGE) and
+  /// converts the cells if necessary.
+  void       SetStorageMode(int mode);
+  int        GetStorageMode() const { return this->m_StorageMode; };
+
+  /// Implement support for C++11 ranged for loops. The const versions iterate
+  /// copies of the cells in either storage mode.
+  typedef PolyDataConstIterator<PolyDataCellArray, Cell> const_iterator;
+  typedef std::reverse_iterator<const_iterator>         const_reverse_iterator;
+  std::vector<Cell>::iterator begin();
+  std::vector<Cell>::iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+  std::vector<Cell>::reverse_iterator rbegin();
+  std::vector<Cell>::reverse_iterator rend();
+  const_reverse_iterator rbegin() const;
+  const_reverse_iterator rend() const;
 
  private:
-  /// A lists of the cells. Each cell consists of multiple points. 
+  friend class PolyDataConstIterator<PolyDataCellArray, Cell>;
+
+  /// Converts the cells to ELEMENT_STORAGE and returns the list of cells.
+  std::vector<Cell> & GetElementData();
+
+  /// Returns the number of cells and a copy of the cell specified by 'id'
+  /// without changing the storage mode.
+  size_t GetNumberOfElements() const;
+  Cell   GetElement(size_t id) const;
+
+  /// The storage mode.
+  int m_StorageMode;
+
+  /// The offsets and point indices of the cells in CONTIGUOUS_STORAGE.
+  std::vector<igtlUint32> m_Offsets;
+  std::vector<igtlUint32> m_Connectivity;
+
+  /// A lists of the cells in ELEMENT_STORAGE. Each cell consists of multiple points.
   std::vector<Cell> m_Data;
 };
 
 /// Implement support for C++11 ranged for loops
-igtlRangeBasedForHeaderExternalMacro(PolyDataCellArray, std::vector<PolyDataCellArray::Cell>, IGTLCommon_EXPORT);
+IGTLCommon_EXPORT std::vector<PolyDataCellArray::Cell>::iterator begin(PolyDataCellArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataCellArray::Cell>::iterator end(PolyDataCellArray& list);
+IGTLCommon_EXPORT PolyDataCellArray::const_iterator begin(const PolyDataCellArray& list);
+IGTLCommon_EXPORT PolyDataCellArray::const_iterator end(const PolyDataCellArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataCellArray::Cell>::reverse_iterator rbegin(PolyDataCellArray& list);
+IGTLCommon_EXPORT std::vector<PolyDataCellArray::Cell>::reverse_iterator rend(PolyDataCellArray& list);
+IGTLCommon_EXPORT PolyDataCellArray::const_reverse_iterator rbegin(const PolyDataCellArray& list);
+IGTLCommon_EXPORT PolyDataCellArray::const_reverse_iterator rend(const PolyDataCellArray& list);
 
 /// Attribute class used for passing attribute data.
 class IGTLCommon_EXPORT PolyDataAttribute : public Object {
@@ -289,6 +476,11 @@ class IGTLCommon_EXPORT PolyDataAttribute : public Object {
   /// Gets the attribute as a byte array.
   int         GetData(igtlFloat32 * data);
 
+  /// Returns a pointer to the attribute values (GetSize() * GetNumberOfComponents()
+  /// values), or NULL if there are none. The pointer is valid until the size
+  /// or the type changes.
+  igtlFloat32 * GetDataPointer();
+
   /// Sets the Nth data.
   int         SetNthData(unsigned int n, igtlFloat32 * data);
 
@@ -399,7 +591,40 @@ public:
 
   /// Gets an attribute specified by 'type'.
   PolyDataAttribute * GetAttribute(int type);
- 
+
+  /// Enables zero-copy unpacking. When enabled, Unpack() converts the points, cells
+  /// and attribute data to the host byte order in the receive buffer instead of
+  /// copying them. The point and cell arrays are left empty, and the attributes only
+  /// carry their type and name; the data are accessed with GetPointsView(),
+  /// GetVerticesView(), GetLinesView(), GetPolygonsView(), GetTriangleStripsView()
+  /// and GetAttributeView(). The serialized body is no longer in the network byte
+  /// order after unpacking. Disabled by default.
+  void SetZeroCopyUnpack(bool zeroCopy) { this->m_ZeroCopyUnpack = zeroCopy; };
+  bool GetZeroCopyUnpack() { return this->m_ZeroCopyUnpack; };
+
+  /// Gets the coordinates of the points (x1, y1, z1, x2, y2, z2, ...) unpacked with
+  /// zero-copy unpacking. Like the other views below, the view keeps the receive
+  /// buffer allocated while it exists, even after the message is deleted or reused.
+  /// The views are empty if zero-copy unpacking has not been used for the last
+  /// message or if the message has been reused since.
+  BufferView<igtlFloat32> GetPointsView();
+
+  /// Gets the vertices in the serialized form (N1, i1, i2, ..., N2, ...) unpacked
+  /// with zero-copy unpacking.
+  BufferView<igtlUint32>  GetVerticesView();
+
+  /// Gets the lines in the serialized form unpacked with zero-copy unpacking.
+  BufferView<igtlUint32>  GetLinesView();
+
+  /// Gets the polygons in the serialized form unpacked with zero-copy unpacking.
+  BufferView<igtlUint32>  GetPolygonsView();
+
+  /// Gets the triangle strips in the serialized form unpacked with zero-copy unpacking.
+  BufferView<igtlUint32>  GetTriangleStripsView();
+
+  /// Gets the data of the attribute specified by 'id' unpacked with zero-copy unpacking.
+  BufferView<igtlFloat32> GetAttributeView(AttributeList::size_type id);
+
 protected:
   PolyDataMessage();
   ~PolyDataMessage();
@@ -409,6 +634,23 @@ protected:
   virtual int  PackContent();
   virtual int  UnpackContent();
 
+  /// Unpacks the content in place for zero-copy unpacking.
+  int          UnpackContentView();
+
+  /// Forgets the arrays located by UnpackContentView().
+  void         ClearViews();
+
+  /// Returns a view of 'size' elements at 'data' in the pinned receive buffer.
+  template <typename T>
+  BufferView<T> GetView(T* data, igtlUint64 size)
+  {
+    if (data == NULL || this->m_PinnedBuffer.IsNull())
+      {
+      return BufferView<T>();
+      }
+    return BufferView<T>(data, size, this->m_PinnedBuffer);
+  }
+
   /// A pointer to the array of points.
   PolyDataPointArray::Pointer m_Points;
 
@@ -427,6 +669,19 @@ protected:
   /// A list of pointers to the attributes.
   AttributeList m_Attributes;
 
+  /// True if Unpack() creates views of the receive buffer.
+  bool          m_ZeroCopyUnpack;
+
+  /// Locations and numbers of elements of the arrays in the receive buffer after
+  /// zero-copy unpacking. The cell arrays are vertices, lines, polygons and
+  /// triangle strips. The message does not reference the buffer through them.
+  igtlFloat32*  m_PointsView;
+  igtlUint64    m_PointsViewSize;
+  igtlUint32*   m_CellViews[4];
+  igtlUint64    m_CellViewSizes[4];
+  std::vector<igtlFloat32*> m_AttributeViews;
+  std::vector<igtlUint64>   m_AttributeViewSizes;
+
 };
 
 } // namespace igtl
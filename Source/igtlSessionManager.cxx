@@ -31,14 +31,10 @@ namespace igtl
 
 SessionManager::SessionManager()
 {
-  this->m_MessageHandlerList.clear();
   this->m_Mode = MODE_SERVER;
+  this->m_ConfigurationUpdated = false;
 
-  this->m_Header = igtl::MessageHeader::New();
-  this->m_TimeStamp = igtl::TimeStamp::New();
-
-  this->m_CurrentReadIndex = 0;
-  this->m_HeaderDeserialized = 0;
+  this->m_EventLoop = EventLoopServer::New();
 }
 
 
@@ -47,275 +43,147 @@ SessionManager::~SessionManager()
 }
 
 
-int SessionManager::AddMessageHandler(MessageHandler* handler)
+int SessionManager::AddMessageHandler(MessageHandler* handler, const char* deviceName)
 {
-  // Check if there is any handler for the same message type
-  std::vector< MessageHandler* >::iterator iter;
-  for (iter = this->m_MessageHandlerList.begin(); iter != this->m_MessageHandlerList.end(); iter ++)
-    {
-    if ( (*iter)->GetMessageType() == handler->GetMessageType() )
-      {
-      return 0;
-      }
-    }
-
-  // If not, add the handler to the list.
-  this->m_MessageHandlerList.push_back(handler);
-
-  return 1;
+  // Fails if there is a handler for the same message type (and device name).
+  return this->m_EventLoop->AddMessageHandler(handler, deviceName);
 }
 
 
 int SessionManager::RemoveMessageHandler(MessageHandler* handler)
 {
-  // Check if there is any handler for the same message type
-  std::vector< MessageHandler* >::iterator iter;
-  for (iter = this->m_MessageHandlerList.begin(); iter != this->m_MessageHandlerList.end(); iter ++)
-    {
-    if (*iter == handler)
-      {
-      this->m_MessageHandlerList.erase(iter);
-      return 1;
-      }
-    }
-  return 0;
+  return this->m_EventLoop->RemoveMessageHandler(handler);
 }
 
 
 int SessionManager::Connect()
 {
-  
-  this->m_Socket = NULL;
-
   if (this->m_Mode == MODE_CLIENT)
     {
-    ClientSocket::Pointer clientSocket;
-    clientSocket = ClientSocket::New();
-    //this->DebugOff();
     if (this->m_Hostname.length() == 0)
       {
       return 0;
       }
-    //this->m_Socket->SetConnectTimeout(1000);
-    int r = clientSocket->ConnectToServer(this->m_Hostname.c_str(), this->m_Port);
-    if (r == 0) // if connected to server
-      {
-      //clientSocket->SetReceiveTimeout(0);
-      this->m_Socket = clientSocket;
-      }
-    else
-      {
-      return 0;
-      }
+    return this->AddConnection(this->m_Hostname.c_str(), this->m_Port);
     }
-  else
+
+  // Start the server, or restart it if the port has been changed.
+  if (this->m_EventLoop->GetServerPort() == 0 || this->m_ConfigurationUpdated)
     {
-    ServerSocket::Pointer serverSocket;
-    serverSocket = ServerSocket::New();
-    int r = serverSocket->CreateServer(this->m_Port);
-    if (r < 0)
+    if (this->m_EventLoop->CreateServer(this->m_Port) < 0)
       {
       return 0;
       }
+    this->m_ConfigurationUpdated = false;
+    }
 
-    if (serverSocket.IsNotNull())
-      {
-      //this->ServerSocket->CreateServer(this->m_Port);
-      this->m_Socket = serverSocket->WaitForConnection(10000);
-      }
-    
-    if (this->m_Socket.IsNotNull() && this->m_Socket->GetConnected()) // if client connected
-      {
-      this->m_Socket->DebugOff();
-      }
-    else
-      {
-      return 0;
-      }
+  // Wait for the first client.
+  for (int i = 0; i < 100 && this->m_EventLoop->GetNumberOfConnections() == 0; i ++)
+    {
+    this->m_EventLoop->ProcessEvents(100);
     }
 
-  this->m_Socket->SetReceiveBlocking(0); // Psuedo non-blocking
-  this->m_CurrentReadIndex = 0;
-  this->m_HeaderDeserialized = 0;
-  return 1;
+  return (this->m_EventLoop->GetNumberOfConnections() > 0) ? 1 : 0;
 }
 
 
-int SessionManager::Disconnect()
+int SessionManager::AddConnection(const char* hostname, int port)
 {
-  if (this->m_Socket.IsNotNull())
+  ClientSocket::Pointer clientSocket = ClientSocket::New();
+  if (clientSocket->ConnectToServer(hostname, port) != 0)
     {
-    this->m_Socket->CloseSocket();
+    return 0;
     }
+  return this->AddConnection(clientSocket);
+}
 
+
+int SessionManager::AddConnection(ClientSocket* socket)
+{
+  return this->m_EventLoop->AddConnection(socket);
+}
+
+
+int SessionManager::Disconnect()
+{
+  this->m_EventLoop->CloseServer();
   return 0;
 }
 
-int SessionManager::ProcessMessage()
+
+int SessionManager::ProcessMessage(int msec)
 {
-  // The workflow of this function is as follows:
+  // The receive state of each connection is kept by the event loop:
   //
-  //  HEADER:
-  //   IF the message is (a) a new message:
-  //       start reading the header;
-  //   ELSE IF the message is a message in progress:
-  //       if the process is reading the header:
-  //           continue to read the header;
-  //   ELSE:
-  //       GOTO BODY;
-  //   
-  //   IF the header has not been received:
-  //       GOTO BODY;
-  //   ELSE
-  //       RETURN;
-  //   
-  //  BODY:
-  //   IF the process has not started reading the body:
-  //       check the body type;
-  //       find an appropriate handler;
-  //       start reading the body
-  //   ELSE:
-  //       continue to read the body
+  //  - A readable connection is read once; the received bytes complete the
+  //    header first, then the body.
+  //  - When the header is complete, the handler is looked up by the message
+  //    type (and device name), and a message of the handler's type is
+  //    allocated for the body. The body is skipped if there is no handler.
+  //  - When the body is complete, the message is unpacked and processed by
+  //    the handler, and the connection starts reading the next header.
   //
+  if (this->m_EventLoop->GetNumberOfConnections() == 0 &&
+      this->m_EventLoop->GetServerPort() == 0)
+    {
+    return 0; // Disconnected
+    }
 
-  //--------------------------------------------------
-  // Header
-  if (this->m_CurrentReadIndex == 0)
+  // The event loop waits without a timeout if it is given 0 ms.
+  unsigned long timeout = 1; // Pseudo non-blocking
+  if (msec > 0)
     {
-    // Initialize receive buffer
-    this->m_Header->InitBuffer();
-  
-    // Receive generic header from the socket
-    int r = this->m_Socket->Receive(this->m_Header->GetBufferPointer(), this->m_Header->GetBufferSize(), 0);
-    if (r == 0)
-      {
-      this->m_CurrentReadIndex = 0;
-      this->m_HeaderDeserialized = 0;
-      return 0; // Disconnected
-      }
-    if (r != this->m_Header->GetBufferSize())
-      {
-      // Only a part of header has arrived.
-      if (r < 0) // timeout
-        {
-        this->m_CurrentReadIndex = 0;
-        }
-      else
-        {
-        this->m_CurrentReadIndex = r;
-        }
-      return -1;
-      }
-    // The header has been received.
-    this->m_CurrentReadIndex = IGTL_HEADER_SIZE;
+    timeout = (unsigned long)msec;
     }
-  else if (this->m_CurrentReadIndex < IGTL_HEADER_SIZE)
+  else if (msec < 0)
     {
-    // Message transfer was interrupted in the header
-    int r = this->m_Socket->Receive((void*)((char*)this->m_Header->GetBufferPointer()+this->m_CurrentReadIndex),
-                                    this->m_Header->GetBufferSize()-this->m_CurrentReadIndex, 0);
-    if (r == 0)
-      {
-      this->m_CurrentReadIndex = 0;
-      this->m_HeaderDeserialized = 0;
-      return 0; // Disconnected
-      }
-    if (r != this->m_Header->GetBufferSize()-this->m_CurrentReadIndex)
-      {
-      // Only a part of header has arrived.
-      if (r > 0) // exclude a case of timeout 
-        {
-        this->m_CurrentReadIndex += r;
-        }
-      return -1;
-      }
-    // The header has been received.
-    this->m_CurrentReadIndex = IGTL_HEADER_SIZE;
+    timeout = 0;
     }
-  
 
-  //--------------------------------------------------
-  // Body
-  if (this->m_HeaderDeserialized == 0)
+  int connected = (this->m_EventLoop->GetNumberOfConnections() > 0);
+  for (;;)
     {
-    // Deserialize the header
-    this->m_Header->Unpack();
-    
-    // Get time stamp
-    igtlUint32 sec;
-    igtlUint32 nanosec;
-   
-    this->m_Header->GetTimeStamp(this->m_TimeStamp);
-    this->m_TimeStamp->GetTimeStamp(&sec, &nanosec);
-    //std::cerr << "Time stamp: "
-    //          << sec << "." << std::setw(9) << std::setfill('0') 
-    //          << nanosec << std::endl;
-
-    // Look for a message handler that matches to the message type.
-    int found = 0;
-    std::vector< MessageHandler* >::iterator iter;
-    for (iter = this->m_MessageHandlerList.begin(); iter != this->m_MessageHandlerList.end(); iter ++)
+    int r = this->m_EventLoop->ProcessEvents(timeout);
+    if (this->m_EventLoop->GetNumberOfConnections() == 0 &&
+        (connected || this->m_EventLoop->GetServerPort() == 0))
       {
-#if OpenIGTLink_HEADER_VERSION >= 2
-      if ( this->m_Header->GetMessageType() == (*iter)->GetMessageType() )
-#else
-      if (strcmp(this->m_Header->GetDeviceType(), (*iter)->GetMessageType()) == 0)
-#endif
-        {
-        this->m_CurrentMessageHandler = *iter;
-        found = 1;
-        break;
-        }
+      return 0; // Disconnected
       }
-      
-    // If there is no message handler, skip the message
-    if (!found)
+    if (r > 0)
       {
-#if OpenIGTLink_HEADER_VERSION >= 2
-      std::cerr << "Receiving: " << this->m_Header->GetMessageType() << std::endl;
-#else
-      std::cerr << "Receiving: " << this->m_Header->GetDeviceType() << std::endl;
-#endif
-      this->m_Socket->Skip(this->m_Header->GetBodySizeToRead(), 0);
-      // Reset the index counter to be ready for the next message
-      this->m_CurrentReadIndex = 0;
-      this->m_HeaderDeserialized = 0;
-      return 1;
+      return r;
       }
-
-    this->m_HeaderDeserialized = 1;
-    }
-
-  int r = this->m_CurrentMessageHandler->ReceiveMessage(this->m_Socket, this->m_Header,
-                                                        this->m_CurrentReadIndex-IGTL_HEADER_SIZE);
-  if (r == this->m_Header->GetBodySizeToRead())
-    {
-    this->m_CurrentReadIndex = 0;
-    this->m_HeaderDeserialized = 0;
-    }
-  else
-    {
-    this->m_CurrentReadIndex += IGTL_HEADER_SIZE + r;
+    if (r < 0 || msec >= 0)
+      {
+      return -1;
+      }
+    // Blocking: wait until a message has been completed.
+    connected = (this->m_EventLoop->GetNumberOfConnections() > 0);
     }
-
-  return 1;
 }  
   
 
 int SessionManager::PushMessage(MessageBase* message)
 {
-  
-  if (message && this->m_Socket.IsNotNull() && this->m_Socket->GetConnected()) // if client connected
-    {
-    return this->m_Socket->Send(message->GetBufferPointer(), message->GetBufferSize());
-    }
-  else
+  if (message == NULL)
     {
     return 0;
     }
+  return (this->m_EventLoop->Broadcast(message) > 0) ? 1 : 0;
 }
 
 
+int SessionManager::GetNumberOfConnections()
+{
+  return this->m_EventLoop->GetNumberOfConnections();
 }
 
 
+ClientSocket* SessionManager::GetConnection(int i)
+{
+  return this->m_EventLoop->GetConnection(i);
+}
+
+
+}
+
@@ -18,6 +18,8 @@
 #include "igtlObject.h"
 #include "igtlMacro.h"
 #include "igtlMessageHandler.h"
+#include "igtlClientSocket.h"
+#include "igtlEventLoopServer.h"
 
 
 #include <vector>
@@ -48,17 +50,44 @@ class IGTLCommon_EXPORT SessionManager: public Object
   int            GetMode() {return this->m_Mode; }
 
   // Description:
-  // Register / Unregister a message handler
-  int            AddMessageHandler(MessageHandler*);
+  // Register / Unregister a message handler. If a device name is specified,
+  // the handler only receives messages from that device, and takes precedence
+  // over the handler registered for the message type only.
+  int            AddMessageHandler(MessageHandler*, const char* deviceName=NULL);
   int            RemoveMessageHandler(MessageHandler*);
 
   // Description:
-  // Functions to manage the session
+  // Functions to manage the session.
+  // In MODE_SERVER, Connect() starts the server and waits up to 10 seconds for
+  // the first client; clients connecting later are accepted by ProcessMessage().
+  // In MODE_CLIENT, Connect() connects to the host and port set by SetHostname()
+  // and SetPort(). AddConnection() adds another connection in either mode, so that
+  // one session manager can serve all peers. Disconnect() closes all connections.
   int            Connect();
+  int            AddConnection(const char* hostname, int port);
+  int            AddConnection(ClientSocket* socket);
   int            Disconnect();
-  int            ProcessMessage();
+
+  // Description:
+  // Receives from all connections and passes the completed messages to the
+  // handlers. The partially received header and body are kept per connection
+  // until the rest arrives. If 'msec' is 0 (default), the call is pseudo
+  // non-blocking and returns after waiting at most 1 millisecond; if 'msec' is
+  // positive, it waits up to 'msec' milliseconds; if 'msec' is negative, it
+  // blocks until a message has been processed or the last connection has been
+  // closed. Returns the number of processed messages, -1 if no message has
+  // been completed (e.g. the timeout expired, or the server is still waiting
+  // for a client), or 0 if the connections have been closed.
+  int            ProcessMessage(int msec=0);
+
+  // Description:
+  // Sends a packed message to all connections. Returns 1 if the message has
+  // been sent to at least one connection, 0 otherwise.
   int            PushMessage(MessageBase*);
 
+  int            GetNumberOfConnections();
+  ClientSocket*  GetConnection(int i);
+
  protected:
   SessionManager();
   ~SessionManager();
@@ -70,19 +99,9 @@ class IGTLCommon_EXPORT SessionManager: public Object
   int            m_Mode;
 
   // Description:
-  // m_CurrentReadIndex is used to save the current position of the message.
-  // The index becomes >0 when message transfer is interrupted and only a part
-  // of message has arrived. 
-  int            m_CurrentReadIndex;
-  int            m_HeaderDeserialized;
-
-  MessageHandler* m_CurrentMessageHandler;
-
-  std::vector< MessageHandler* > m_MessageHandlerList;
-  Socket::Pointer  m_Socket;
-
-  igtl::MessageHeader::Pointer m_Header;
-  igtl::TimeStamp::Pointer m_TimeStamp;
+  // The event loop keeps the receive state of each connection and looks up
+  // the message handlers.
+  EventLoopServer::Pointer m_EventLoop;
 
 };
 
@@ -27,6 +27,9 @@
 =========================================================================*/
 
 #include "igtlSocket.h"
+#include "igtlAsyncSendQueue.h"
+#include "igtlAtomic.h"
+#include "igtlMessageBase.h"
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
   #include <windows.h>
@@ -40,9 +43,13 @@
   #include <netdb.h>
   #include <unistd.h>
   #include <sys/time.h>
+  #include <sys/uio.h>
+  #include <limits.h>
 #endif
 
+#include <errno.h>
 #include <string.h>
+#include <vector>
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #define WSA_VERSION MAKEWORD(1,1)
@@ -64,11 +71,18 @@ Socket::Socket()
   this->m_SocketDescriptor = -1;
   this->m_SendTimeoutFlag = 0;
   this->m_ReceiveTimeoutFlag = 0;
+  this->m_SendQueue = NULL;
+  this->m_StatisticsCreated = 0;
 }
 
 //-----------------------------------------------------------------------------
 Socket::~Socket()
 {
+  if (this->m_Statistics.IsNotNull())
+    {
+    Statistics::RemoveConnection(this);
+    }
+  this->AbortSendQueue();
   if (this->m_SocketDescriptor != -1)
     {
     this->CloseSocket(this->m_SocketDescriptor);
@@ -76,6 +90,30 @@ Socket::~Socket()
     }
 }
 
+//-----------------------------------------------------------------------------
+TrafficStatistics* Socket::GetStatistics()
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  if (AtomicLoad(&this->m_StatisticsCreated))
+    {
+    return this->m_Statistics;
+    }
+#endif
+  // The socket may be used by a sending and a receiving thread.
+  this->m_StatisticsLock.Lock();
+  if (this->m_Statistics.IsNull())
+    {
+    this->m_Statistics = TrafficStatistics::New();
+    Statistics::AddConnection(this, this->m_Statistics);
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+    AtomicStore(&this->m_StatisticsCreated, 1);
+#endif
+    }
+  TrafficStatistics* statistics = this->m_Statistics;
+  this->m_StatisticsLock.Unlock();
+  return statistics;
+}
+
 //-----------------------------------------------------------------------------
 int Socket::CreateSocket()
 {
@@ -286,6 +324,46 @@ int Socket::GetPort(int sock)
   return ntohs(sockinfo.sin_port);
 }
 
+//-----------------------------------------------------------------------------
+void Socket::CloseSocket()
+{
+  this->AbortSendQueue();
+  this->CloseSocket(this->m_SocketDescriptor);
+  this->m_SocketDescriptor = -1;
+}
+
+//-----------------------------------------------------------------------------
+void Socket::DeleteSendQueue(bool flush)
+{
+  if (this->m_SendQueue == NULL)
+    {
+    return;
+    }
+  this->m_SendQueue->Stop(flush);
+  delete this->m_SendQueue;
+  this->m_SendQueue = NULL;
+}
+
+//-----------------------------------------------------------------------------
+void Socket::AbortSendQueue()
+{
+  if (this->m_SendQueue == NULL)
+    {
+    return;
+    }
+  // The socket is being closed, so a send blocked by the receiver is
+  // interrupted by shutting it down.
+  if (this->m_SocketDescriptor >= 0)
+    {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    shutdown(this->m_SocketDescriptor, SD_BOTH);
+#else
+    shutdown(this->m_SocketDescriptor, SHUT_RDWR);
+#endif
+    }
+  this->DeleteSendQueue(false);
+}
+
 //-----------------------------------------------------------------------------
 void Socket::CloseSocket(int socketdescriptor)
 {
@@ -308,6 +386,28 @@ int Socket::Send(const void* data, int length)
     // nothing to send.
     return 1;
     }
+  if (!Statistics::GetEnabled())
+    {
+    return this->m_SendQueue ? this->m_SendQueue->Enqueue(&data, &length, 1)
+                             : this->SendDirect(data, length);
+    }
+
+  igtl_uint64 start = Statistics::GetTime();
+  int r = this->m_SendQueue ? this->m_SendQueue->Enqueue(&data, &length, 1)
+                            : this->SendDirect(data, length);
+  TrafficStatistics* statistics = this->GetStatistics();
+  statistics->AddDuration(TrafficStatistics::Send, Statistics::GetTime() - start);
+  statistics->Increment(TrafficStatistics::SendCalls);
+  if (r)
+    {
+    statistics->Increment(TrafficStatistics::SentBytes, length);
+    }
+  return r;
+}
+
+//-----------------------------------------------------------------------------
+int Socket::SendDirect(const void* data, int length)
+{
   const char* buffer = reinterpret_cast<const char*>(data);
   int total = 0;
   do
@@ -339,6 +439,13 @@ int Socket::Send(const void* data, int length)
     int n = send(this->m_SocketDescriptor, buffer+total, length-total, flags);
     if(n < 0)
       {
+#if !defined(_WIN32) || defined(__CYGWIN__)
+      if (errno == EINTR)
+        {
+        // Interrupted by a signal before anything was sent.
+        continue;
+        }
+#endif
       // FIXME : Use exceptions ?  igtlErrorMacro("Socket Error: Send failed.");
       return 0;
       }
@@ -347,6 +454,161 @@ int Socket::Send(const void* data, int length)
   return 1;
 }
 
+//-----------------------------------------------------------------------------
+int Socket::SendFragments(const void* const* fragments, const int* lengths, int numberOfFragments)
+{
+  if (!this->GetConnected())
+    {
+    return 0;
+    }
+  if (!Statistics::GetEnabled())
+    {
+    return this->m_SendQueue ? this->m_SendQueue->Enqueue(fragments, lengths, numberOfFragments)
+                             : this->SendFragmentsDirect(fragments, lengths, numberOfFragments);
+    }
+
+  igtl_uint64 start = Statistics::GetTime();
+  int r = this->m_SendQueue ? this->m_SendQueue->Enqueue(fragments, lengths, numberOfFragments)
+                            : this->SendFragmentsDirect(fragments, lengths, numberOfFragments);
+  TrafficStatistics* statistics = this->GetStatistics();
+  statistics->AddDuration(TrafficStatistics::Send, Statistics::GetTime() - start);
+  statistics->Increment(TrafficStatistics::SendCalls);
+  if (r)
+    {
+    igtl_uint64 length = 0;
+    for (int i = 0; i < numberOfFragments; i ++)
+      {
+      length += lengths[i];
+      }
+    statistics->Increment(TrafficStatistics::SentBytes, length);
+    }
+  return r;
+}
+
+//-----------------------------------------------------------------------------
+int Socket::SendFragmentsDirect(const void* const* fragments, const int* lengths, int numberOfFragments)
+{
+  if (!this->GetConnected())
+    {
+    return 0;
+    }
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  std::vector<WSABUF> buffers;
+  buffers.reserve(numberOfFragments);
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    if (lengths[i] > 0)
+      {
+      WSABUF b;
+      b.buf = const_cast<char*>(reinterpret_cast<const char*>(fragments[i]));
+      b.len = static_cast<ULONG>(lengths[i]);
+      buffers.push_back(b);
+      }
+    }
+  if (buffers.empty())
+    {
+    // nothing to send.
+    return 1;
+    }
+  // A blocking WSASend() returns only after all the buffers have been sent.
+  DWORD sent = 0;
+  if (WSASend(this->m_SocketDescriptor, &buffers[0], static_cast<DWORD>(buffers.size()),
+              &sent, 0, NULL, NULL) != 0)
+    {
+    return 0;
+    }
+  return 1;
+#else
+  std::vector<struct iovec> iov;
+  iov.reserve(numberOfFragments);
+  for (int i = 0; i < numberOfFragments; i ++)
+    {
+    if (lengths[i] > 0)
+      {
+      struct iovec v;
+      v.iov_base = const_cast<void*>(fragments[i]);
+      v.iov_len  = static_cast<size_t>(lengths[i]);
+      iov.push_back(v);
+      }
+    }
+
+  int flags;
+  #if defined(MSG_NOSIGNAL) // For Linux > 2.2
+  flags = MSG_NOSIGNAL;
+  #else
+    #if defined(SO_NOSIGPIPE) // Mac OS X
+  int set = 1;
+  setsockopt(this->m_SocketDescriptor, SOL_SOCKET, SO_NOSIGPIPE, (void *)&set, sizeof(int));
+    #endif
+  flags = 0;
+  #endif
+
+  #if defined(IOV_MAX)
+  const size_t maxIov = IOV_MAX;
+  #else
+  const size_t maxIov = 16;
+  #endif
+
+  size_t first = 0;
+  while (first < iov.size())
+    {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = &iov[first];
+    msg.msg_iovlen = (iov.size() - first < maxIov) ? iov.size() - first : maxIov;
+
+    ssize_t n = sendmsg(this->m_SocketDescriptor, &msg, flags);
+    if (n < 0)
+      {
+      if (errno == EINTR)
+        {
+        // Interrupted by a signal before anything was sent.
+        continue;
+        }
+      return 0;
+      }
+
+    // Skip the fragments written completely and adjust a partially written one.
+    size_t remaining = static_cast<size_t>(n);
+    while (first < iov.size() && remaining >= iov[first].iov_len)
+      {
+      remaining -= iov[first].iov_len;
+      first ++;
+      }
+    if (remaining > 0)
+      {
+      iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+      iov[first].iov_len -= remaining;
+      }
+    }
+  return 1;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+int Socket::SendFragments(MessageBase* message)
+{
+  if (message == NULL)
+    {
+    return 0;
+    }
+
+  int n = message->GetNumberOfBufferFragments();
+  std::vector<const void*> fragments(n);
+  std::vector<int> lengths(n);
+  for (int i = 0; i < n; i ++)
+    {
+    fragments[i] = message->GetBufferFragmentPointer(i);
+    lengths[i]   = message->GetBufferFragmentSize(i);
+    }
+  if (n == 0)
+    {
+    return 1;
+    }
+  return this->SendFragments(&fragments[0], &lengths[0], n);
+}
+
 //-----------------------------------------------------------------------------
 int Socket::Receive(void* data, int length, int readFully/*=1*/)
 {
@@ -399,6 +661,11 @@ int Socket::Receive(void* data, int length, int readFully/*=1*/)
 
     total += n;
     } while(readFully && total < length);
+
+  if (Statistics::GetEnabled())
+    {
+    this->GetStatistics()->Increment(TrafficStatistics::ReceivedBytes, total);
+    }
   return total;
 }
 
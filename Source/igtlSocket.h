@@ -44,6 +44,8 @@
 #include "igtlObjectFactory.h"
 #include "igtlMacro.h"
 #include "igtlWin32Header.h"
+#include "igtlSimpleFastMutexLock.h"
+#include "igtlStatistics.h"
 
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
@@ -56,6 +58,8 @@ namespace igtl
 {
 
 class SocketCollection;
+class MessageBase;
+class AsyncSendQueue;
 
 /// class IGTL_EXPORT Socket
 class IGTLCommon_EXPORT Socket : public Object
@@ -69,18 +73,30 @@ public:
   /// Check is the socket is alive.
   bool GetConnected() { return (this->m_SocketDescriptor >=0); }
   
-  /// Close the socket.
-  void CloseSocket() {
-    this->CloseSocket(this->m_SocketDescriptor);
-    this->m_SocketDescriptor = -1;
-  }
+  /// Close the socket. Data queued for asynchronous sending
+  /// (see ClientSocket::StartAsyncSend()) and not sent yet is discarded.
+  void CloseSocket();
  
   /// These methods send data over the socket.
   /// Returns 1 on success, 0 on error and raises vtkCommand::ErrorEvent.
   /// SIGPIPE or other signal may be raised on systems (e.g., Sun Solaris) where
   /// MSG_NOSIGNAL flag is not supported for the socket send method.
+  /// If asynchronous sending is active, the data is queued and 1 means that it
+  /// has been queued.
   int Send(const void* data, int length);
 
+  /// Sends 'numberOfFragments' memory areas, in order, as one contiguous stream.
+  /// The fragments are handed to the kernel together (sendmsg() on POSIX systems,
+  /// WSASend() on Windows), so neither an intermediate copy nor one system call
+  /// per fragment is needed. Returns 1 on success, 0 on error.
+  /// If asynchronous sending is active, the fragments are queued as one message.
+  int SendFragments(const void* const* fragments, const int* lengths, int numberOfFragments);
+
+  /// Sends a packed message using the fragments given by
+  /// MessageBase::GetBufferFragmentPointer() and GetBufferFragmentSize().
+  /// Returns 1 on success, 0 on error.
+  int SendFragments(MessageBase* message);
+
   /// Receive data from the socket.
   /// This call blocks until some data is read from the socket, unless timeout is set
   /// by SetTimeout() or SetReceiveTimeout().
@@ -112,6 +128,12 @@ public:
   /// Get socket address
   int GetSocketAddressAndPort(std::string& address, int & port);
 
+  /// Returns the statistics of this connection, which are updated while
+  /// igtl::Statistics is enabled. They are created, and listed among the
+  /// connections, on the first call, so that a socket used while the
+  /// statistics are disabled does not carry them.
+  TrafficStatistics* GetStatistics();
+
   /// Skip reading data from the socket.
   /// The Skip() call has been newly introduced to the igtlSocket,
   /// after the class is imported from VTK, thus the call is
@@ -129,7 +151,35 @@ protected:
 
   //BTX
   friend class vtkSocketCollection;
+  friend class EventLoopServer;
+  friend class AsyncSendQueue;
+  friend class Statistics;
   //ETX
+
+  /// Queue of the asynchronous sender, or NULL if the data is sent by the
+  /// calling thread.
+  AsyncSendQueue* m_SendQueue;
+
+  /// Stops the asynchronous sender and deletes its queue. The queued data
+  /// is sent first if 'flush' is set, and discarded otherwise; the batch
+  /// being sent is always completed. The socket stays usable.
+  void DeleteSendQueue(bool flush);
+
+  /// Shuts the socket down, so that a send blocked by the receiver returns,
+  /// and deletes the queue without sending the queued data. Called when the
+  /// socket is closed.
+  void AbortSendQueue();
+
+  /// Sends the fragments from the calling thread, bypassing the queue.
+  int SendFragmentsDirect(const void* const* fragments, const int* lengths, int numberOfFragments);
+
+  /// Sends the data from the calling thread, bypassing the queue.
+  int SendDirect(const void* data, int length);
+
+  /// Counters and durations of this connection, created by GetStatistics().
+  TrafficStatistics::Pointer m_Statistics;
+  volatile int               m_StatisticsCreated;
+  SimpleFastMutexLock        m_StatisticsLock;
  
   /// Creates an endpoint for communication and returns the descriptor.
   /// -1 indicates error.
@@ -0,0 +1,596 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlStatistics.h"
+#include "igtlAtomic.h"
+#include "igtlConditionVariable.h"
+#include "igtlMultiThreader.h"
+#include "igtlMutexLock.h"
+#include "igtlSocket.h"
+#include "igtlTimeStamp.h"
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+// Counters shared between threads
+
+#ifndef IGTL_HAVE_ATOMIC_OPERATIONS
+static SimpleMutexLock StatisticsCounterLock;
+#endif
+
+static void AddToCounter(volatile igtl_uint64* counter, igtl_uint64 value)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicCounterAdd(counter, value);
+#else
+  StatisticsCounterLock.Lock();
+  *counter += value;
+  StatisticsCounterLock.Unlock();
+#endif
+}
+
+static igtl_uint64 LoadCounter(const volatile igtl_uint64* counter)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  return AtomicCounterLoad(counter);
+#else
+  StatisticsCounterLock.Lock();
+  igtl_uint64 result = *counter;
+  StatisticsCounterLock.Unlock();
+  return result;
+#endif
+}
+
+static void StoreCounter(volatile igtl_uint64* counter, igtl_uint64 value)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicCounterStore(counter, value);
+#else
+  StatisticsCounterLock.Lock();
+  *counter = value;
+  StatisticsCounterLock.Unlock();
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// LatencyHistogram
+
+// Durations below 2^(SUB_BUCKET_BITS + 1) have a bucket each; each power of
+// two above is split into 2^SUB_BUCKET_BITS buckets.
+#define IGTL_HISTOGRAM_SUB_BUCKET_BITS  3
+#define IGTL_HISTOGRAM_SUB_BUCKETS      (1 << IGTL_HISTOGRAM_SUB_BUCKET_BITS)
+#define IGTL_HISTOGRAM_MAX_EXPONENT     40
+
+LatencyHistogram::LatencyHistogram()
+{
+  this->Reset();
+}
+
+
+int LatencyHistogram::GetBucketIndex(igtl_uint64 duration)
+{
+  if (duration < 2 * IGTL_HISTOGRAM_SUB_BUCKETS)
+    {
+    return (int)duration;
+    }
+  if (duration >> IGTL_HISTOGRAM_MAX_EXPONENT)
+    {
+    return NumberOfBuckets - 1;
+    }
+
+  // Position of the highest bit.
+  int exponent = 0;
+  igtl_uint64 v = duration;
+  if (v >> 32) { v >>= 32; exponent += 32; }
+  if (v >> 16) { v >>= 16; exponent += 16; }
+  if (v >> 8)  { v >>= 8;  exponent += 8;  }
+  if (v >> 4)  { v >>= 4;  exponent += 4;  }
+  if (v >> 2)  { v >>= 2;  exponent += 2;  }
+  if (v >> 1)  { exponent += 1; }
+
+  int shift = exponent - IGTL_HISTOGRAM_SUB_BUCKET_BITS;
+  int sub = (int)(duration >> shift) & (IGTL_HISTOGRAM_SUB_BUCKETS - 1);
+  return (shift + 1) * IGTL_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+
+igtl_uint64 LatencyHistogram::GetBucketLowerBound(int i)
+{
+  if (i < 2 * IGTL_HISTOGRAM_SUB_BUCKETS)
+    {
+    return (igtl_uint64)i;
+    }
+  int shift = i / IGTL_HISTOGRAM_SUB_BUCKETS - 1;
+  int sub = i % IGTL_HISTOGRAM_SUB_BUCKETS;
+  return (igtl_uint64)(IGTL_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+}
+
+
+igtl_uint64 LatencyHistogram::GetBucketUpperBound(int i)
+{
+  if (i < 2 * IGTL_HISTOGRAM_SUB_BUCKETS)
+    {
+    return (igtl_uint64)i + 1;
+    }
+  int shift = i / IGTL_HISTOGRAM_SUB_BUCKETS - 1;
+  return GetBucketLowerBound(i) + ((igtl_uint64)1 << shift);
+}
+
+
+void LatencyHistogram::Add(igtl_uint64 duration)
+{
+  AddToCounter(&this->m_Buckets[GetBucketIndex(duration)], 1);
+  AddToCounter(&this->m_Count, 1);
+  AddToCounter(&this->m_Total, duration);
+}
+
+
+igtl_uint64 LatencyHistogram::GetCount() const
+{
+  return LoadCounter(&this->m_Count);
+}
+
+
+igtl_uint64 LatencyHistogram::GetTotal() const
+{
+  return LoadCounter(&this->m_Total);
+}
+
+
+double LatencyHistogram::GetMean() const
+{
+  igtl_uint64 count = this->GetCount();
+  return count > 0 ? (double)this->GetTotal() / (double)count : 0.0;
+}
+
+
+igtl_uint64 LatencyHistogram::GetPercentile(double percentile) const
+{
+  // The buckets are read one by one while they may be updated, so the sum
+  // of the buckets is used rather than m_Count.
+  igtl_uint64 counts[NumberOfBuckets];
+  igtl_uint64 total = 0;
+  for (int i = 0; i < NumberOfBuckets; i ++)
+    {
+    counts[i] = LoadCounter(&this->m_Buckets[i]);
+    total += counts[i];
+    }
+  if (total == 0)
+    {
+    return 0;
+    }
+
+  double rank = percentile / 100.0 * (double)total;
+  igtl_uint64 sum = 0;
+  for (int i = 0; i < NumberOfBuckets; i ++)
+    {
+    sum += counts[i];
+    if (counts[i] > 0 && (double)sum >= rank)
+      {
+      return GetBucketUpperBound(i);
+      }
+    }
+  return GetBucketUpperBound(NumberOfBuckets - 1);
+}
+
+
+igtl_uint64 LatencyHistogram::GetBucketCount(int i) const
+{
+  if (i < 0 || i >= NumberOfBuckets)
+    {
+    return 0;
+    }
+  return LoadCounter(&this->m_Buckets[i]);
+}
+
+
+void LatencyHistogram::Reset()
+{
+  for (int i = 0; i < NumberOfBuckets; i ++)
+    {
+    StoreCounter(&this->m_Buckets[i], 0);
+    }
+  StoreCounter(&this->m_Count, 0);
+  StoreCounter(&this->m_Total, 0);
+}
+
+
+//-----------------------------------------------------------------------------
+// TrafficStatistics
+
+TrafficStatistics::TrafficStatistics() : Object()
+{
+  for (int i = 0; i < NumberOfCounters; i ++)
+    {
+    this->m_Counters[i] = 0;
+    }
+  this->m_ResetTime = Statistics::GetTime();
+}
+
+
+TrafficStatistics::~TrafficStatistics()
+{
+}
+
+
+void TrafficStatistics::Increment(int counter, igtl_uint64 value)
+{
+  AddToCounter(&this->m_Counters[counter], value);
+}
+
+
+igtl_uint64 TrafficStatistics::GetCounter(int counter) const
+{
+  return LoadCounter(&this->m_Counters[counter]);
+}
+
+
+void TrafficStatistics::AddDuration(int stage, igtl_uint64 duration)
+{
+  this->m_Histograms[stage].Add(duration);
+}
+
+
+igtl_uint64 TrafficStatistics::GetElapsedTime() const
+{
+  return Statistics::GetTime() - LoadCounter(&this->m_ResetTime);
+}
+
+
+void TrafficStatistics::Reset()
+{
+  for (int i = 0; i < NumberOfCounters; i ++)
+    {
+    StoreCounter(&this->m_Counters[i], 0);
+    }
+  for (int i = 0; i < NumberOfStages; i ++)
+    {
+    this->m_Histograms[i].Reset();
+    }
+  StoreCounter(&this->m_ResetTime, Statistics::GetTime());
+}
+
+
+const char* TrafficStatistics::GetCounterName(int counter)
+{
+  static const char* names[NumberOfCounters] =
+    {
+    "send calls", "sent bytes", "received bytes", "received messages",
+    "packed messages", "packed bytes", "unpacked messages", "unpacked bytes",
+    "CRC errors"
+    };
+  return (counter >= 0 && counter < NumberOfCounters) ? names[counter] : "";
+}
+
+
+const char* TrafficStatistics::GetStageName(int stage)
+{
+  static const char* names[NumberOfStages] =
+    {
+    "send", "receive body", "pack", "unpack", "CRC"
+    };
+  return (stage >= 0 && stage < NumberOfStages) ? names[stage] : "";
+}
+
+
+void TrafficStatistics::Print(std::ostream& os) const
+{
+  double elapsed = (double)this->GetElapsedTime() / 1e9;
+
+  os << this->m_Name << " (" << std::fixed << std::setprecision(1) << elapsed << " s)" << std::endl;
+  for (int i = 0; i < NumberOfCounters; i ++)
+    {
+    igtl_uint64 value = this->GetCounter(i);
+    if (value == 0)
+      {
+      continue;
+      }
+    os << "  " << std::left << std::setw(18) << GetCounterName(i) << std::right
+       << std::setw(14) << value
+       << std::setw(14) << std::setprecision(1) << (elapsed > 0 ? value / elapsed : 0.0) << " /s"
+       << std::endl;
+    }
+  for (int i = 0; i < NumberOfStages; i ++)
+    {
+    const LatencyHistogram& histogram = this->m_Histograms[i];
+    igtl_uint64 count = histogram.GetCount();
+    if (count == 0)
+      {
+      continue;
+      }
+    os << "  " << std::left << std::setw(18) << GetStageName(i) << std::right
+       << std::setw(14) << count
+       << "  mean " << std::setprecision(2) << histogram.GetMean() / 1e3
+       << " us, p50 <" << histogram.GetPercentile(50) / 1e3
+       << " us, p99 <" << histogram.GetPercentile(99) / 1e3
+       << " us" << std::endl;
+    }
+}
+
+
+void TrafficStatistics::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+  this->Print(os);
+}
+
+
+//-----------------------------------------------------------------------------
+// Statistics
+
+namespace
+{
+
+volatile int StatisticsEnabled = 0;
+
+// Statistics per message type, and of the open connections.
+SimpleMutexLock StatisticsLock;
+typedef std::map<std::string, TrafficStatistics::Pointer> TypeStatisticsMap;
+TypeStatisticsMap* TypeStatistics = NULL;
+typedef std::map<Socket*, TrafficStatistics::Pointer> ConnectionStatisticsMap;
+ConnectionStatisticsMap* ConnectionStatistics = NULL;
+
+// Periodic dump thread
+SimpleMutexLock            DumpLock;
+ConditionVariable::Pointer DumpCondition;
+MultiThreader::Pointer     DumpThreader;
+int                        DumpThreadID = -1;
+bool                       DumpStopping = false;
+std::ostream*              DumpStream = NULL;
+int                        DumpInterval = 0;
+bool                       DumpReset = false;
+
+// Prints 'statistics' if they have seen traffic.
+void PrintActive(std::ostream& os, TrafficStatistics* statistics)
+{
+  for (int i = 0; i < TrafficStatistics::NumberOfCounters; i ++)
+    {
+    if (statistics->GetCounter(i) > 0)
+      {
+      statistics->Print(os);
+      return;
+      }
+    }
+}
+
+void* DumpThread(void*)
+{
+  DumpLock.Lock();
+  while (!DumpStopping)
+    {
+    DumpCondition->Wait(&DumpLock, DumpInterval);
+    if (DumpStopping)
+      {
+      break;
+      }
+    Statistics::Print(*DumpStream);
+    if (DumpReset)
+      {
+      Statistics::Reset();
+      }
+    }
+  DumpLock.Unlock();
+  return NULL;
+}
+
+} // namespace
+
+
+// Updates the names of the connections; StatisticsLock must be held.
+void Statistics::UpdateConnectionNames()
+{
+  if (ConnectionStatistics == NULL)
+    {
+    return;
+    }
+  ConnectionStatisticsMap::iterator it;
+  for (it = ConnectionStatistics->begin(); it != ConnectionStatistics->end(); ++ it)
+    {
+    std::ostringstream name;
+    name << "connection " << it->first->GetSocketDescriptor();
+    it->second->SetName(name.str());
+    }
+}
+
+
+void Statistics::SetEnabled(bool enabled)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  AtomicStore(&StatisticsEnabled, enabled ? 1 : 0);
+#else
+  StatisticsEnabled = enabled ? 1 : 0;
+#endif
+}
+
+
+bool Statistics::GetEnabled()
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  return AtomicLoad(&StatisticsEnabled) != 0;
+#else
+  return StatisticsEnabled != 0;
+#endif
+}
+
+
+igtl_uint64 Statistics::GetTime()
+{
+  return TimeStamp::GetMonotonicTimeInNanoseconds();
+}
+
+
+TrafficStatistics* Statistics::GetMessageTypeStatistics(const std::string& type)
+{
+  StatisticsLock.Lock();
+  if (TypeStatistics == NULL)
+    {
+    // Never deleted, so that the returned pointers stay valid.
+    TypeStatistics = new TypeStatisticsMap;
+    }
+  TrafficStatistics::Pointer& statistics = (*TypeStatistics)[type];
+  if (statistics.IsNull())
+    {
+    statistics = TrafficStatistics::New();
+    statistics->SetName(type);
+    }
+  TrafficStatistics* p = statistics;
+  StatisticsLock.Unlock();
+  return p;
+}
+
+
+void Statistics::GetMessageTypeStatistics(std::vector<TrafficStatistics::Pointer>& list)
+{
+  StatisticsLock.Lock();
+  if (TypeStatistics)
+    {
+    TypeStatisticsMap::iterator it;
+    for (it = TypeStatistics->begin(); it != TypeStatistics->end(); ++ it)
+      {
+      list.push_back(it->second);
+      }
+    }
+  StatisticsLock.Unlock();
+}
+
+
+void Statistics::GetConnectionStatistics(std::vector<TrafficStatistics::Pointer>& list)
+{
+  StatisticsLock.Lock();
+  UpdateConnectionNames();
+  if (ConnectionStatistics)
+    {
+    ConnectionStatisticsMap::iterator it;
+    for (it = ConnectionStatistics->begin(); it != ConnectionStatistics->end(); ++ it)
+      {
+      list.push_back(it->second);
+      }
+    }
+  StatisticsLock.Unlock();
+}
+
+
+void Statistics::Print(std::ostream& os)
+{
+  // The names are printed with the lock held, as UpdateConnectionNames()
+  // may rewrite them from another thread.
+  std::ostringstream text;
+  StatisticsLock.Lock();
+  UpdateConnectionNames();
+  if (ConnectionStatistics)
+    {
+    ConnectionStatisticsMap::iterator it;
+    for (it = ConnectionStatistics->begin(); it != ConnectionStatistics->end(); ++ it)
+      {
+      PrintActive(text, it->second);
+      }
+    }
+  if (TypeStatistics)
+    {
+    TypeStatisticsMap::iterator it;
+    for (it = TypeStatistics->begin(); it != TypeStatistics->end(); ++ it)
+      {
+      PrintActive(text, it->second);
+      }
+    }
+  StatisticsLock.Unlock();
+  os << text.str() << std::flush;
+}
+
+
+void Statistics::Reset()
+{
+  std::vector<TrafficStatistics::Pointer> list;
+  GetConnectionStatistics(list);
+  GetMessageTypeStatistics(list);
+  for (size_t i = 0; i < list.size(); i ++)
+    {
+    list[i]->Reset();
+    }
+}
+
+
+int Statistics::StartPeriodicDump(std::ostream* os, int interval, bool reset)
+{
+  DumpLock.Lock();
+  if (DumpThreadID >= 0 || os == NULL)
+    {
+    DumpLock.Unlock();
+    return -1;
+    }
+  if (DumpCondition.IsNull())
+    {
+    DumpCondition = ConditionVariable::New();
+    DumpThreader = MultiThreader::New();
+    }
+  DumpStopping = false;
+  DumpStream = os;
+  DumpInterval = interval > 0 ? interval : 1;
+  DumpReset = reset;
+  DumpThreadID = DumpThreader->SpawnThread((ThreadFunctionType)&DumpThread, NULL);
+  DumpLock.Unlock();
+  return 0;
+}
+
+
+void Statistics::StopPeriodicDump()
+{
+  DumpLock.Lock();
+  int id = DumpThreadID;
+  if (id < 0)
+    {
+    DumpLock.Unlock();
+    return;
+    }
+  DumpStopping = true;
+  DumpCondition->Signal();
+  DumpLock.Unlock();
+
+  DumpThreader->TerminateThread(id);
+
+  DumpLock.Lock();
+  DumpThreadID = -1;
+  DumpLock.Unlock();
+}
+
+
+void Statistics::AddConnection(Socket* socket, TrafficStatistics* statistics)
+{
+  StatisticsLock.Lock();
+  if (ConnectionStatistics == NULL)
+    {
+    ConnectionStatistics = new ConnectionStatisticsMap;
+    }
+  (*ConnectionStatistics)[socket] = statistics;
+  StatisticsLock.Unlock();
+}
+
+
+void Statistics::RemoveConnection(Socket* socket)
+{
+  StatisticsLock.Lock();
+  if (ConnectionStatistics)
+    {
+    ConnectionStatistics->erase(socket);
+    }
+  StatisticsLock.Unlock();
+}
+
+} // namespace igtl
@@ -0,0 +1,229 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlStatistics_h
+#define __igtlStatistics_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtl_types.h"
+
+#include <string>
+#include <vector>
+
+namespace igtl
+{
+
+class Socket;
+
+/// LatencyHistogram counts durations in nanoseconds in log-linear buckets:
+/// durations below 16 ns have a bucket each, and every power-of-two range
+/// above is split into 8 buckets, so that a bucket is at most 12.5% wide.
+/// Durations of 2^40 ns (about 18 minutes) and more share the last bucket.
+/// Add() is lock-free and may be called from several threads.
+class IGTLCommon_EXPORT LatencyHistogram
+{
+public:
+  enum
+  {
+    NumberOfBuckets = 304
+  };
+
+  LatencyHistogram();
+
+  /// Adds a duration in nanoseconds.
+  void        Add(igtl_uint64 duration);
+
+  /// Returns the number and the sum of the durations added.
+  igtl_uint64 GetCount() const;
+  igtl_uint64 GetTotal() const;
+
+  /// Returns the mean duration in nanoseconds, or 0 if the histogram is empty.
+  double      GetMean() const;
+
+  /// Returns an upper bound of the given percentile (0 - 100) of the
+  /// durations, i.e. the upper end of the bucket that contains it.
+  igtl_uint64 GetPercentile(double percentile) const;
+
+  /// Returns the number of durations in bucket 'i'.
+  igtl_uint64 GetBucketCount(int i) const;
+
+  /// Returns the bucket of 'duration', and the range [lower, upper) of
+  /// durations counted in bucket 'i'.
+  static int         GetBucketIndex(igtl_uint64 duration);
+  static igtl_uint64 GetBucketLowerBound(int i);
+  static igtl_uint64 GetBucketUpperBound(int i);
+
+  void        Reset();
+
+protected:
+  volatile igtl_uint64 m_Buckets[NumberOfBuckets];
+  volatile igtl_uint64 m_Count;
+  volatile igtl_uint64 m_Total;
+};
+
+
+/// TrafficStatistics holds the counters and duration histograms of one
+/// connection or one message type. The library updates them while
+/// igtl::Statistics is enabled; see there.
+class IGTLCommon_EXPORT TrafficStatistics : public Object
+{
+public:
+  igtlTypeMacro(igtl::TrafficStatistics, igtl::Object)
+  igtlNewMacro(igtl::TrafficStatistics);
+
+  enum Counter
+  {
+    /// Socket::Send() and SendFragments() calls, and the bytes sent.
+    SendCalls,
+    SentBytes,
+    /// Bytes received by Socket::Receive() or igtl::EventLoopServer.
+    ReceivedBytes,
+    /// Messages received completely by igtl::EventLoopServer.
+    ReceivedMessages,
+    /// Messages packed (MessageBase::Pack()) and their size with header.
+    PackedMessages,
+    PackedBytes,
+    /// Message bodies unpacked (MessageBase::Unpack()) and their size.
+    UnpackedMessages,
+    UnpackedBytes,
+    /// Bodies rejected by the CRC check.
+    CRCErrors,
+    NumberOfCounters
+  };
+
+  enum Stage
+  {
+    /// Time spent in Socket::Send() or SendFragments(), i.e. how long the
+    /// sender was blocked (with asynchronous sending, the time to queue).
+    Send,
+    /// Time from the complete header to the complete body of a message
+    /// received by igtl::EventLoopServer.
+    ReceiveBody,
+    /// Time spent in MessageBase::Pack(), including the CRC.
+    Pack,
+    /// Time spent unpacking a body after its CRC has been checked.
+    Unpack,
+    /// Time spent checking the CRC of a received body.
+    CRC,
+    NumberOfStages
+  };
+
+  /// Name of the connection or message type.
+  const std::string& GetName() const { return this->m_Name; }
+  void               SetName(const std::string& name) { this->m_Name = name; }
+
+  void         Increment(int counter, igtl_uint64 value=1);
+  igtl_uint64  GetCounter(int counter) const;
+
+  void         AddDuration(int stage, igtl_uint64 duration);
+  const LatencyHistogram& GetHistogram(int stage) const { return this->m_Histograms[stage]; }
+
+  /// Returns the time in nanoseconds since the statistics have been created
+  /// or reset, to turn the counters into rates.
+  igtl_uint64  GetElapsedTime() const;
+
+  /// Clears the counters and histograms.
+  void         Reset();
+
+  /// Writes the non-zero counters with their rates, and the mean, median and
+  /// 99th percentile of each non-empty histogram.
+  void         Print(std::ostream& os) const;
+
+  static const char* GetCounterName(int counter);
+  static const char* GetStageName(int stage);
+
+protected:
+  TrafficStatistics();
+  ~TrafficStatistics();
+
+  void PrintSelf(std::ostream& os) const;
+
+  std::string          m_Name;
+  volatile igtl_uint64 m_Counters[NumberOfCounters];
+  LatencyHistogram     m_Histograms[NumberOfStages];
+  volatile igtl_uint64 m_ResetTime;
+};
+
+
+/// Statistics collects the throughput and latency of the library per
+/// connection and per message type. It is disabled by default; while it is
+/// disabled each instrumented call only reads a flag.
+///
+/// While it is enabled:
+///  - every Socket counts its send calls, sent and received bytes and the
+///    time spent sending (see Socket::GetStatistics()),
+///  - MessageBase::Pack() and Unpack() record their durations and the CRC
+///    check time per message type,
+///  - igtl::EventLoopServer (and igtl::SessionManager) record the time from
+///    the header to the complete body of each message, per connection and
+///    per message type.
+///
+/// The statistics can be queried, printed with Print(), or written
+/// periodically by a background thread:
+///
+///     igtl::Statistics::SetEnabled(true);
+///     igtl::Statistics::StartPeriodicDump(&std::cerr, 5000);
+///     ...
+///     igtl::TrafficStatistics* s = igtl::Statistics::GetMessageTypeStatistics("IMAGE");
+///     double p99 = s->GetHistogram(igtl::TrafficStatistics::Unpack).GetPercentile(99) / 1e3; // us
+class IGTLCommon_EXPORT Statistics
+{
+public:
+  /// Enables or disables the collection at runtime.
+  static void SetEnabled(bool enabled);
+  static bool GetEnabled();
+
+  /// Returns the monotonic time in nanoseconds used for the durations.
+  static igtl_uint64 GetTime();
+
+  /// Returns the statistics of a message type, creating them if needed. The
+  /// object stays valid until the program ends.
+  static TrafficStatistics* GetMessageTypeStatistics(const std::string& type);
+
+  /// Appends the statistics of all message types and of all open
+  /// connections to 'list'.
+  static void GetMessageTypeStatistics(std::vector<TrafficStatistics::Pointer>& list);
+  static void GetConnectionStatistics(std::vector<TrafficStatistics::Pointer>& list);
+
+  /// Writes the statistics of all connections and message types that have
+  /// seen traffic.
+  static void Print(std::ostream& os);
+
+  /// Clears all counters and histograms.
+  static void Reset();
+
+  /// Starts a thread that calls Print(*os) every 'interval' milliseconds
+  /// and resets the statistics if 'reset' is set, so that each dump covers
+  /// one interval. 'os' must remain valid until StopPeriodicDump(). Returns 0
+  /// on success, -1 if a dump thread is running already.
+  static int  StartPeriodicDump(std::ostream* os, int interval, bool reset=false);
+  static void StopPeriodicDump();
+
+  /// Called by Socket to list its statistics among the connections.
+  static void AddConnection(Socket* socket, TrafficStatistics* statistics);
+  static void RemoveConnection(Socket* socket);
+
+private:
+  Statistics(); // Not implemented.
+
+  /// Names the connections after their socket descriptors.
+  static void UpdateConnectionNames();
+};
+
+} // namespace igtl
+
+#endif // __igtlStatistics_h
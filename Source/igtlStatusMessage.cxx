@@ -130,7 +130,10 @@ int StatusMessage::UnpackContent()
   strncpy(this->m_ErrorName, status_header->error_name, IGTL_STATUS_ERROR_NAME_LENGTH);
 
   // make sure that the status message in the pack ends with '\0'
-  if (m_StatusMessage[this->m_BodySizeToRead-IGTL_STATUS_HEADER_SIZE-1] == '\0')
+  // (the content excludes the extended header and meta data of version 2)
+  int contentSize = this->CalculateReceiveContentSize();
+  if (contentSize > IGTL_STATUS_HEADER_SIZE &&
+      m_StatusMessage[contentSize-IGTL_STATUS_HEADER_SIZE-1] == '\0')
     {
     this->m_StatusMessageString = m_StatusMessage;
     }
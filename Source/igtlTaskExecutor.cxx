@@ -0,0 +1,618 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlTaskExecutor.h"
+#include "igtlAtomic.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  #include <windows.h>
+#elif defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+namespace igtl
+{
+
+//-----------------------------------------------------------------------------
+// Counters shared between threads
+
+#ifndef IGTL_HAVE_ATOMIC_OPERATIONS
+static SimpleMutexLock TaskCounterLock;
+#endif
+
+static int AddToCounter(volatile int* counter, int value)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  return AtomicAdd(counter, value);
+#else
+  TaskCounterLock.Lock();
+  int result = (*counter += value);
+  TaskCounterLock.Unlock();
+  return result;
+#endif
+}
+
+static int LoadCounter(const volatile int* counter)
+{
+#ifdef IGTL_HAVE_ATOMIC_OPERATIONS
+  return AtomicLoad(counter);
+#else
+  TaskCounterLock.Lock();
+  int result = *counter;
+  TaskCounterLock.Unlock();
+  return result;
+#endif
+}
+
+
+// Binds the calling thread to 'core', or lets it run on any core if core < 0.
+static bool SetCurrentThreadAffinity(int core)
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  DWORD_PTR processMask;
+  DWORD_PTR systemMask;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    {
+    return false;
+    }
+  DWORD_PTR mask = processMask;
+  if (core >= 0)
+    {
+    mask = (DWORD_PTR)1 << (core % (8 * sizeof(DWORD_PTR)));
+    }
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__) && defined(CPU_SET)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (core >= 0)
+    {
+    CPU_SET(core % CPU_SETSIZE, &set);
+    }
+  else
+    {
+    // The kernel limits the mask to the cores the process may use.
+    for (int i = 0; i < CPU_SETSIZE; i ++)
+      {
+      CPU_SET(i, &set);
+      }
+    }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)core;
+  return false;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+TaskGroup::TaskGroup()
+{
+  this->m_NumberOfPendingTasks = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+int TaskGroup::GetNumberOfPendingTasks() const
+{
+  return LoadCounter(&this->m_NumberOfPendingTasks);
+}
+
+
+//-----------------------------------------------------------------------------
+TaskFuture::TaskFuture()
+{
+  this->m_Executor = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+TaskFuture::~TaskFuture()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+bool TaskFuture::IsDone() const
+{
+  return this->m_Group.GetNumberOfPendingTasks() == 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskFuture::Wait()
+{
+  if (this->m_Executor && !this->IsDone())
+    {
+    this->m_Executor->Wait(&this->m_Group);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+static SimpleMutexLock GlobalTaskExecutorLock;
+static TaskExecutor*   GlobalTaskExecutor = NULL;
+
+TaskExecutor* TaskExecutor::GetGlobalExecutor()
+{
+  GlobalTaskExecutorLock.Lock();
+  if (GlobalTaskExecutor == NULL)
+    {
+    // Not deleted: the workers cannot be joined safely while the library is
+    // being unloaded on all platforms.
+    GlobalTaskExecutor = new TaskExecutor;
+    GlobalTaskExecutor->StartWorkers(MultiThreader::GetGlobalDefaultNumberOfThreads() - 1);
+    }
+  GlobalTaskExecutorLock.Unlock();
+  return GlobalTaskExecutor;
+}
+
+
+//-----------------------------------------------------------------------------
+TaskExecutor::TaskExecutor()
+{
+  this->m_Threader = MultiThreader::New();
+  this->m_NumberOfQueuedTasks = 0;
+  this->m_NumberOfSleepingWorkers = 0;
+  this->m_NextQueue = 0;
+  this->m_WorkAvailable = ConditionVariable::New();
+  this->m_TaskCompleted = ConditionVariable::New();
+  this->m_NumberOfStartedWorkers = 0;
+  this->m_Stopping = false;
+  this->m_AffinityGeneration = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+TaskExecutor::~TaskExecutor()
+{
+  this->StopWorkers();
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::SetNumberOfWorkers(int numberOfWorkers)
+{
+  this->StopWorkers();
+  this->StartWorkers(numberOfWorkers);
+}
+
+
+//-----------------------------------------------------------------------------
+int TaskExecutor::SetCoreAffinity(const int* cores, int numberOfCores)
+{
+  this->m_Mutex.Lock();
+  this->m_Cores.clear();
+  for (int i = 0; i < numberOfCores; i ++)
+    {
+    this->m_Cores.push_back(cores[i]);
+    }
+  this->m_AffinityGeneration ++;
+  this->m_WorkAvailable->Broadcast();
+  this->m_Mutex.Unlock();
+
+#if (defined(_WIN32) && !defined(__CYGWIN__)) || (defined(__linux__) && defined(CPU_SET))
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::StartWorkers(int numberOfWorkers)
+{
+  if (numberOfWorkers > IGTL_MAX_THREADS)
+    {
+    numberOfWorkers = IGTL_MAX_THREADS;
+    }
+
+  this->m_Stopping = false;
+  this->m_NumberOfStartedWorkers = 0;
+  for (int i = 0; i < numberOfWorkers; i ++)
+    {
+    Worker* worker = new Worker;
+    worker->Executor = this;
+    worker->Index = i;
+    worker->ThreadID = -1;
+    this->m_Workers.push_back(worker);
+    }
+  int spawned = 0;
+  for (int i = 0; i < numberOfWorkers; i ++)
+    {
+    Worker* worker = this->m_Workers[i];
+    worker->ThreadID = this->m_Threader->SpawnThread((ThreadFunctionType) &TaskExecutor::WorkerThreadFunction, worker);
+    if (worker->ThreadID >= 0)
+      {
+      spawned ++;
+      }
+    }
+
+  // Submit() looks up the calling worker, so each worker must have recorded
+  // its thread ID before the first task is queued.
+  this->m_Mutex.Lock();
+  while (this->m_NumberOfStartedWorkers < spawned)
+    {
+    this->m_TaskCompleted->Wait(&this->m_Mutex);
+    }
+  this->m_Mutex.Unlock();
+
+  if (spawned < numberOfWorkers)
+    {
+    igtlWarningMacro("Started " << spawned << " of " << numberOfWorkers << " worker threads.");
+    this->StopWorkers();
+    this->StartWorkers(spawned);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::StopWorkers()
+{
+  // The workers run the queued tasks before they exit.
+  this->m_Mutex.Lock();
+  this->m_Stopping = true;
+  this->m_WorkAvailable->Broadcast();
+  this->m_Mutex.Unlock();
+
+  // Running workers may still steal from any queue.
+  for (size_t i = 0; i < this->m_Workers.size(); i ++)
+    {
+    if (this->m_Workers[i]->ThreadID >= 0)
+      {
+      this->m_Threader->TerminateThread(this->m_Workers[i]->ThreadID);
+      }
+    }
+  for (size_t i = 0; i < this->m_Workers.size(); i ++)
+    {
+    delete this->m_Workers[i];
+    }
+  this->m_Workers.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+void* TaskExecutor::WorkerThreadFunction(void* ptr)
+{
+  MultiThreader::ThreadInfo* info = static_cast<MultiThreader::ThreadInfo*>(ptr);
+  Worker* worker = static_cast<Worker*>(info->UserData);
+  worker->Executor->WorkerLoop(worker);
+  return NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::WorkerLoop(Worker* worker)
+{
+  worker->SystemThreadID = MultiThreader::GetCurrentThreadID();
+  this->m_Mutex.Lock();
+  this->m_NumberOfStartedWorkers ++;
+  this->m_TaskCompleted->Broadcast();
+  this->m_Mutex.Unlock();
+
+  int generation = -1;
+  while (1)
+    {
+    Task task;
+    if (this->TakeTask(worker->Index, &task))
+      {
+      this->RunTask(task);
+      continue;
+      }
+
+    this->m_Mutex.Lock();
+    if (generation != this->m_AffinityGeneration)
+      {
+      generation = this->m_AffinityGeneration;
+      int core = this->m_Cores.empty() ? -1 : this->m_Cores[worker->Index % this->m_Cores.size()];
+      this->m_Mutex.Unlock();
+      SetCurrentThreadAffinity(core);
+      continue;
+      }
+
+    // Submit() signals only if it sees a sleeping worker; the counter is
+    // raised before the queues are checked again, so no task is missed.
+    AddToCounter(&this->m_NumberOfSleepingWorkers, 1);
+    while (LoadCounter(&this->m_NumberOfQueuedTasks) == 0 && !this->m_Stopping &&
+           generation == this->m_AffinityGeneration)
+      {
+      this->m_WorkAvailable->Wait(&this->m_Mutex);
+      }
+    AddToCounter(&this->m_NumberOfSleepingWorkers, -1);
+    bool stop = this->m_Stopping && LoadCounter(&this->m_NumberOfQueuedTasks) == 0;
+    this->m_Mutex.Unlock();
+    if (stop)
+      {
+      break;
+      }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+int TaskExecutor::GetCurrentWorkerIndex() const
+{
+  MultiThreaderIDType self = MultiThreader::GetCurrentThreadID();
+  for (size_t i = 0; i < this->m_Workers.size(); i ++)
+    {
+    if (MultiThreader::ThreadsEqual(this->m_Workers[i]->SystemThreadID, self))
+      {
+      return (int)i;
+      }
+    }
+  return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::Enqueue(const Task& task)
+{
+  int n = (int)this->m_Workers.size();
+  int index = this->GetCurrentWorkerIndex();
+  if (index < 0)
+    {
+    index = (int)((unsigned int)AddToCounter(&this->m_NextQueue, 1) % (unsigned int)n);
+    }
+  Worker* worker = this->m_Workers[index];
+  worker->QueueLock.Lock();
+  worker->Queue.push_back(task);
+  worker->QueueLock.Unlock();
+
+  AddToCounter(&this->m_NumberOfQueuedTasks, 1);
+  if (LoadCounter(&this->m_NumberOfSleepingWorkers) > 0)
+    {
+    this->m_Mutex.Lock();
+    this->m_WorkAvailable->Signal();
+    this->m_Mutex.Unlock();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::Submit(TaskFunctionType function, void* data, TaskGroup* group)
+{
+  if (this->m_Workers.empty())
+    {
+    function(data);
+    return;
+    }
+
+  if (group)
+    {
+    AddToCounter(&group->m_NumberOfPendingTasks, 1);
+    }
+  Task task;
+  task.Function = function;
+  task.Data = data;
+  task.Group = group;
+  task.Owner = NULL;
+  this->Enqueue(task);
+}
+
+
+//-----------------------------------------------------------------------------
+TaskFuture::Pointer TaskExecutor::Submit(TaskFunctionType function, void* data)
+{
+  TaskFuture::Pointer future = TaskFuture::New();
+  if (this->m_Workers.empty())
+    {
+    function(data);
+    return future;
+    }
+
+  future->m_Executor = this;
+  AddToCounter(&future->m_Group.m_NumberOfPendingTasks, 1);
+  // The task keeps the future alive until it has run.
+  future->Register();
+  Task task;
+  task.Function = function;
+  task.Data = data;
+  task.Group = &future->m_Group;
+  task.Owner = future.GetPointer();
+  this->Enqueue(task);
+  return future;
+}
+
+
+//-----------------------------------------------------------------------------
+bool TaskExecutor::TakeTask(int index, Task* task)
+{
+  int n = (int)this->m_Workers.size();
+  if (n == 0 || LoadCounter(&this->m_NumberOfQueuedTasks) == 0)
+    {
+    return false;
+    }
+
+  if (index >= 0)
+    {
+    Worker* worker = this->m_Workers[index];
+    worker->QueueLock.Lock();
+    if (!worker->Queue.empty())
+      {
+      *task = worker->Queue.back();
+      worker->Queue.pop_back();
+      worker->QueueLock.Unlock();
+      AddToCounter(&this->m_NumberOfQueuedTasks, -1);
+      return true;
+      }
+    worker->QueueLock.Unlock();
+    }
+
+  int start = index >= 0 ? index + 1 : 0;
+  for (int i = 0; i < n; i ++)
+    {
+    Worker* victim = this->m_Workers[(start + i) % n];
+    if (victim->Index == index)
+      {
+      continue;
+      }
+    victim->QueueLock.Lock();
+    if (!victim->Queue.empty())
+      {
+      *task = victim->Queue.front();
+      victim->Queue.pop_front();
+      victim->QueueLock.Unlock();
+      AddToCounter(&this->m_NumberOfQueuedTasks, -1);
+      return true;
+      }
+    victim->QueueLock.Unlock();
+    }
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::RunTask(const Task& task)
+{
+  task.Function(task.Data);
+
+  if (task.Group && AddToCounter(&task.Group->m_NumberOfPendingTasks, -1) == 0)
+    {
+    this->m_Mutex.Lock();
+    this->m_TaskCompleted->Broadcast();
+    this->m_Mutex.Unlock();
+    }
+  if (task.Owner)
+    {
+    task.Owner->UnRegister();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+bool TaskExecutor::RunPendingTask()
+{
+  Task task;
+  if (!this->TakeTask(this->GetCurrentWorkerIndex(), &task))
+    {
+    return false;
+    }
+  this->RunTask(task);
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::Wait(TaskGroup* group)
+{
+  while (LoadCounter(&group->m_NumberOfPendingTasks) > 0)
+    {
+    if (this->RunPendingTask())
+      {
+      continue;
+      }
+    // The remaining tasks of the group are running on other threads.
+    this->m_Mutex.Lock();
+    while (LoadCounter(&group->m_NumberOfPendingTasks) > 0 &&
+           LoadCounter(&this->m_NumberOfQueuedTasks) == 0)
+      {
+      this->m_TaskCompleted->Wait(&this->m_Mutex);
+      }
+    this->m_Mutex.Unlock();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// ParallelFor
+
+struct TaskExecutorRange
+{
+  TaskExecutor::RangeFunctionType Function;
+  void*                           Data;
+  igtlInt64                       Begin;
+  igtlInt64                       End;
+  igtlInt64                       ChunkSize;
+  int                             NumberOfChunks;
+  volatile int                    NextChunk;
+};
+
+
+// Runs chunks of the range until all have been taken.
+static void RunRangeChunks(void* ptr)
+{
+  TaskExecutorRange* range = static_cast<TaskExecutorRange*>(ptr);
+  int chunk;
+  while ((chunk = AddToCounter(&range->NextChunk, 1) - 1) < range->NumberOfChunks)
+    {
+    igtlInt64 begin = range->Begin + range->ChunkSize * chunk;
+    igtlInt64 end = begin + range->ChunkSize;
+    if (end > range->End)
+      {
+      end = range->End;
+      }
+    range->Function(range->Data, begin, end);
+    }
+}
+
+
+void TaskExecutor::ParallelFor(igtlInt64 begin, igtlInt64 end, RangeFunctionType function,
+                               void* data, igtlInt64 grainSize)
+{
+  if (end <= begin)
+    {
+    return;
+    }
+  int numberOfThreads = (int)this->m_Workers.size() + 1;
+  igtlInt64 size = end - begin;
+  if (numberOfThreads == 1 || size <= grainSize)
+    {
+    function(data, begin, end);
+    return;
+    }
+
+  igtlInt64 chunkSize = (size + 4 * numberOfThreads - 1) / (4 * numberOfThreads);
+  if (chunkSize < grainSize)
+    {
+    chunkSize = grainSize;
+    }
+  if (chunkSize < 1)
+    {
+    chunkSize = 1;
+    }
+
+  TaskExecutorRange range;
+  range.Function = function;
+  range.Data = data;
+  range.Begin = begin;
+  range.End = end;
+  range.ChunkSize = chunkSize;
+  range.NumberOfChunks = (int)((size + chunkSize - 1) / chunkSize);
+  range.NextChunk = 0;
+
+  // Each helper task takes chunks until none is left, so idle threads
+  // balance the load without one task per chunk.
+  int numberOfHelpers = range.NumberOfChunks - 1;
+  if (numberOfHelpers > numberOfThreads - 1)
+    {
+    numberOfHelpers = numberOfThreads - 1;
+    }
+  TaskGroup group;
+  for (int i = 0; i < numberOfHelpers; i ++)
+    {
+    this->Submit(&RunRangeChunks, &range, &group);
+    }
+  RunRangeChunks(&range);
+  this->Wait(&group);
+}
+
+
+//-----------------------------------------------------------------------------
+void TaskExecutor::PrintSelf(std::ostream& os) const
+{
+  this->Superclass::PrintSelf(os);
+  os << "NumberOfWorkers: " << this->m_Workers.size() << std::endl;
+}
+
+} // namespace igtl
@@ -0,0 +1,223 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Module:    git@github.com:openigtlink/OpenIGTLink.git
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#ifndef __igtlTaskExecutor_h
+#define __igtlTaskExecutor_h
+
+#include "igtlObject.h"
+#include "igtlObjectFactory.h"
+#include "igtlMacro.h"
+#include "igtlWin32Header.h"
+#include "igtlConditionVariable.h"
+#include "igtlMultiThreader.h"
+#include "igtlMutexLock.h"
+#include "igtlTypes.h"
+
+#include <deque>
+#include <vector>
+
+namespace igtl
+{
+
+class TaskExecutor;
+
+/// TaskGroup counts the tasks submitted with it that have not finished yet,
+/// so that a thread can wait for all of them with TaskExecutor::Wait().
+/// A group must not be destroyed while it has pending tasks.
+class IGTLCommon_EXPORT TaskGroup
+{
+public:
+  TaskGroup();
+
+  /// Returns the number of submitted tasks that have not finished.
+  int GetNumberOfPendingTasks() const;
+
+protected:
+  friend class TaskExecutor;
+  volatile int m_NumberOfPendingTasks;
+
+private:
+  TaskGroup(const TaskGroup&); // Not implemented.
+  void operator=(const TaskGroup&); // Not implemented.
+};
+
+
+/// TaskFuture represents a single task submitted with
+/// TaskExecutor::Submit(function, data). The result of the task is whatever
+/// the task function writes to its data; it is valid once IsDone() returns
+/// true or Wait() has returned.
+class IGTLCommon_EXPORT TaskFuture : public Object
+{
+public:
+  igtlTypeMacro(igtl::TaskFuture, igtl::Object)
+  igtlNewMacro(igtl::TaskFuture);
+
+  /// Returns true if the task has finished.
+  bool IsDone() const;
+
+  /// Waits until the task has finished, running other queued tasks meanwhile.
+  void Wait();
+
+protected:
+  TaskFuture();
+  ~TaskFuture();
+
+  friend class TaskExecutor;
+  // Not a smart pointer: the last reference to the future may be released
+  // by a worker, which must not destroy its executor. Queued tasks keep the
+  // executor from finishing its destruction until they have run.
+  TaskExecutor*              m_Executor;
+  TaskGroup                  m_Group;
+};
+
+
+/// TaskExecutor runs short tasks on a set of persistent worker threads, so
+/// that work parallelized per message (e.g. the body CRC or the color
+/// conversion of a video frame) does not pay for creating and joining
+/// threads as MultiThreader::SingleMethodExecute() does.
+///
+/// Each worker has its own task queue. A task submitted by a worker goes to
+/// the back of that worker's queue and is taken from there (last in, first
+/// out, while its data is still in the cache); other tasks are distributed
+/// round-robin. A worker whose queue is empty steals the oldest task of
+/// another worker before it sleeps. A thread waiting for tasks with Wait() or
+/// ParallelFor() runs queued tasks itself, so tasks may submit and wait for
+/// other tasks without blocking a worker.
+///
+/// Tasks are plain functions taking a data pointer, like the thread
+/// functions of MultiThreader:
+///
+///     static void Square(void* data) { int* v = (int*)data; *v *= *v; }
+///     ...
+///     int value = 3;
+///     igtl::TaskFuture::Pointer future = executor->Submit(&Square, &value);
+///     future->Wait();   // value is 9
+///
+/// The executor shared by the library is returned by GetGlobalExecutor().
+/// With no workers (e.g. on a single core), tasks run on the submitting
+/// thread.
+class IGTLCommon_EXPORT TaskExecutor : public Object
+{
+public:
+  igtlTypeMacro(igtl::TaskExecutor, igtl::Object)
+  igtlNewMacro(igtl::TaskExecutor);
+
+  typedef void (*TaskFunctionType)(void* data);
+
+  /// Function called by ParallelFor() for the indices [begin, end).
+  typedef void (*RangeFunctionType)(void* data, igtlInt64 begin, igtlInt64 end);
+
+  /// Returns the executor used by the library's parallel code paths
+  /// (ParallelCRC64(), the color conversion of VideoStreaming). It is
+  /// created on first use with one worker less than
+  /// MultiThreader::GetGlobalDefaultNumberOfThreads(), since the calling
+  /// thread takes part in the work, and is never destroyed.
+  static TaskExecutor* GetGlobalExecutor();
+
+  /// Stops the current workers after the queued tasks have run and starts
+  /// 'numberOfWorkers' new ones (at most IGTL_MAX_THREADS). Must not be
+  /// called while tasks are being submitted or waited for.
+  void SetNumberOfWorkers(int numberOfWorkers);
+  int  GetNumberOfWorkers() const { return (int)this->m_Workers.size(); }
+
+  /// Binds worker i to core cores[i % numberOfCores]; numberOfCores = 0
+  /// lets the workers run on any core again. The workers apply the setting
+  /// before they take their next task. Returns 0 on success, or -1 if
+  /// thread affinity is not supported on this platform.
+  int SetCoreAffinity(const int* cores, int numberOfCores);
+
+  /// Queues 'function(data)' as a task counted by 'group' (may be NULL).
+  void Submit(TaskFunctionType function, void* data, TaskGroup* group);
+
+  /// Queues 'function(data)' and returns a future to wait for it.
+  TaskFuture::Pointer Submit(TaskFunctionType function, void* data);
+
+  /// Waits until all tasks of 'group' have finished, running queued tasks
+  /// on the calling thread meanwhile.
+  void Wait(TaskGroup* group);
+
+  /// Calls 'function(data, b, e)' for consecutive sub-ranges [b, e) that
+  /// cover [begin, end), concurrently on the calling thread and the workers,
+  /// and returns when all have finished. The sub-ranges have at least
+  /// 'grainSize' indices (except the last one); the range is split into
+  /// about four sub-ranges per thread, which the threads take in order.
+  void ParallelFor(igtlInt64 begin, igtlInt64 end, RangeFunctionType function,
+                   void* data, igtlInt64 grainSize=1);
+
+  /// Runs one queued task on the calling thread. Returns false if no task
+  /// was queued.
+  bool RunPendingTask();
+
+protected:
+  TaskExecutor();
+  ~TaskExecutor();
+
+  void PrintSelf(std::ostream& os) const;
+
+  struct Task
+  {
+    TaskFunctionType Function;
+    void*            Data;
+    TaskGroup*       Group;
+    // Released after the task has run (the future of the task).
+    LightObject*     Owner;
+  };
+
+  struct Worker
+  {
+    TaskExecutor*       Executor;
+    int                 Index;
+    int                 ThreadID;
+    MultiThreaderIDType SystemThreadID;
+    SimpleMutexLock     QueueLock;
+    std::deque<Task>    Queue;
+  };
+
+  void StartWorkers(int numberOfWorkers);
+  void StopWorkers();
+
+  static void* WorkerThreadFunction(void* ptr);
+  void WorkerLoop(Worker* worker);
+
+  void Enqueue(const Task& task);
+
+  /// Takes a task from the back of worker 'index' (if index >= 0), or from
+  /// the front of the other workers' queues.
+  bool TakeTask(int index, Task* task);
+  void RunTask(const Task& task);
+
+  /// Returns the index of the worker running the calling thread, or -1.
+  int GetCurrentWorkerIndex() const;
+
+  std::vector<Worker*>       m_Workers;
+  MultiThreader::Pointer     m_Threader;
+
+  // Tasks in all queues, and workers waiting for m_WorkAvailable.
+  volatile int               m_NumberOfQueuedTasks;
+  volatile int               m_NumberOfSleepingWorkers;
+  volatile int               m_NextQueue;
+
+  SimpleMutexLock            m_Mutex;
+  ConditionVariable::Pointer m_WorkAvailable;
+  ConditionVariable::Pointer m_TaskCompleted;
+  int                        m_NumberOfStartedWorkers;
+  bool                       m_Stopping;
+
+  std::vector<int>           m_Cores;
+  int                        m_AffinityGeneration;
+};
+
+} // namespace igtl
+
+#endif // __igtlTaskExecutor_h
@@ -42,6 +42,7 @@
   #include <windows.h>
 #else
   #include <sys/time.h>
+  #include <time.h>
 #endif  // defined(WIN32) || defined(_WIN32)
 
 #include <string.h>
@@ -115,11 +116,18 @@ TimeStamp::TimeStamp(): Object()
   this->m_WinClockOrigin = clock();
   this->m_Frequency = 1000000;
 
+#elif defined(OpenIGTLink_HAVE_CLOCK_GETTIME)
+
+  this->m_Frequency = 1000000000;
+
 #else
 
   this->m_Frequency = 1000000;
 
 #endif  // defined(WIN32) || defined(_WIN32)
+
+  this->m_Second     = 0;
+  this->m_Nanosecond = 0;
 }
 
 
@@ -148,6 +156,15 @@ void TimeStamp::GetTime()
   this->m_Second     = this->m_WinTimeOrigin + ( c1 - this->m_WinClockOrigin ) / CLOCKS_PER_SEC;
   this->m_Nanosecond = (c1 - this->m_WinClockOrigin ) % CLOCKS_PER_SEC * ( 1e9 / CLOCKS_PER_SEC );
 
+#elif defined(OpenIGTLink_HAVE_CLOCK_GETTIME)
+
+  struct timespec tspec;
+
+  ::clock_gettime( CLOCK_REALTIME, &tspec );
+
+  this->m_Second     = tspec.tv_sec;
+  this->m_Nanosecond = tspec.tv_nsec;
+
 #else
 
   struct timeval tval;
@@ -161,6 +178,46 @@ void TimeStamp::GetTime()
   
 }
 
+
+void TimeStamp::GetMonotonicTime()
+{
+  this->SetTimeInNanoseconds(GetMonotonicTimeInNanoseconds());
+}
+
+
+igtlUint64 TimeStamp::GetMonotonicTimeInNanoseconds()
+{
+#if defined(WIN32) || defined(_WIN32)
+
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER tick;
+
+  ::QueryPerformanceFrequency( &frequency );
+  ::QueryPerformanceCounter( &tick );
+
+  return static_cast<igtlUint64>( tick.QuadPart / frequency.QuadPart ) * 1000000000 +
+         static_cast<igtlUint64>( ( tick.QuadPart % frequency.QuadPart ) * 1000000000 / frequency.QuadPart );
+
+#elif defined(OpenIGTLink_HAVE_CLOCK_GETTIME)
+
+  struct timespec tspec;
+
+  ::clock_gettime( CLOCK_MONOTONIC, &tspec );
+
+  return static_cast<igtlUint64>( tspec.tv_sec ) * 1000000000 + tspec.tv_nsec;
+
+#else
+
+  // No monotonic clock; use the system time.
+  struct timeval tval;
+
+  ::gettimeofday( &tval, 0 );
+
+  return static_cast<igtlUint64>( tval.tv_sec ) * 1000000000 + tval.tv_usec * 1000;
+
+#endif  // defined(WIN32) || defined(_WIN32)
+}
+
 void TimeStamp::SetTime(double tm)
 {
   double second = floor(tm);
@@ -191,8 +248,9 @@ void TimeStamp::SetTime(igtlUint64 tm)
 //-----------------------------------------------------------------------------
 void TimeStamp::SetTimeInNanoseconds(igtlUint64 tm)
 {
-  igtlUint64 sec = tm / 1e9; // integer rounding
-  igtlUint64 nano = sec * 1e9; // round it back up to get whole number of seconds expressed in nanoseconds.
+  // Integer arithmetic: a double cannot represent every nanosecond since 1970.
+  igtlUint64 sec = tm / 1000000000; // integer rounding
+  igtlUint64 nano = sec * 1000000000; // round it back up to get whole number of seconds expressed in nanoseconds.
   this->m_Second = static_cast<igtlInt32>(sec);
   this->m_Nanosecond = static_cast<igtlInt32>(tm - nano);
 }
@@ -230,7 +288,7 @@ igtlUint64 TimeStamp::GetTimeStampUint64()
 //-----------------------------------------------------------------------------
 igtlUint64 TimeStamp::GetTimeStampInNanoseconds() const
 {
-  igtlUint64 tmp = this->m_Second * 1e9;
+  igtlUint64 tmp = static_cast<igtlUint64>(static_cast<igtlUint32>(this->m_Second)) * 1000000000;
   tmp += this->m_Nanosecond;
   return tmp;
 }
@@ -43,8 +43,23 @@ public:
   igtlGetConstMacro(Nanosecond, igtlUint32);
 
   /// Gets the current time from the system's clock and save it as a time stamp.
+  /// The clock is the wall-clock time (UTC) used for the time stamps in the
+  /// message headers. It has nanosecond resolution where clock_gettime() is
+  /// available, and may jump when the system time is adjusted.
   void   GetTime();
 
+  /// Gets the current time from a monotonic clock, which is not affected by
+  /// adjustments of the system time, and save it as a time stamp. Its origin
+  /// is arbitrary (e.g. the boot time), so the time stamp is only meaningful
+  /// relative to other monotonic time stamps of the same host; use it to
+  /// measure intervals.
+  void   GetMonotonicTime();
+
+  /// Returns the time of the monotonic clock used by GetMonotonicTime() in
+  /// nanoseconds, without creating a TimeStamp (e.g. to time short
+  /// operations).
+  static igtlUint64 GetMonotonicTimeInNanoseconds();
+
   /// Sets the time by double floating-point value.
   void   SetTime(double tm);
 
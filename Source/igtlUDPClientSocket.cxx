@@ -59,6 +59,17 @@ int UDPClientSocket::ReadSocket(unsigned char* buffer, unsigned bufferSize) {
   int bytesRead = ReceiveUDP(buffer, bufferSize);
   return bytesRead;
 }
+//-----------------------------------------------------------------------------
+int UDPClientSocket::ReadSocketBatch(unsigned char* const* buffers, unsigned bufferSize, int* lengths, int maxPackets)
+{
+  if (!this->m_SocketDescriptor)
+  {
+    igtlErrorMacro("Failed to create socket.");
+    return -1;
+  }
+  return this->ReceiveUDPBatch(buffers, bufferSize, lengths, maxPackets);
+}
+
 //-----------------------------------------------------------------------------
 void UDPClientSocket::PrintSelf(std::ostream& os) const
 {
@@ -48,6 +48,12 @@ public:
   int JoinNetwork(const char* groupIPAddr, int portNum);
 
   int ReadSocket(unsigned char* buffer, unsigned bufferSize);
+
+  /// Reads up to 'maxPackets' datagrams with one system call where available.
+  /// Datagram i is stored in buffers[i], which holds 'bufferSize' bytes, and
+  /// its length in lengths[i]. Blocks until the first datagram arrives.
+  /// Returns the number of datagrams read, 0 on error or -1 on timeout.
+  int ReadSocketBatch(unsigned char* const* buffers, unsigned bufferSize, int* lengths, int maxPackets);
   
 protected:
   UDPClientSocket();
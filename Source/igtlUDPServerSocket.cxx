@@ -124,6 +124,31 @@ int UDPServerSocket::WriteSocket(unsigned char* buffer, unsigned bufferSize)
   return numByteSend;
 }
 
+//-----------------------------------------------------------------------------
+int UDPServerSocket::WriteSocketBatch(const unsigned char* const* packets, const int* lengths, int numberOfPackets)
+{
+  if (this->groups.empty() && this->clients.empty())
+  {
+    return 0;
+  }
+  int numberOfSent = numberOfPackets;
+  for(std::vector<GroupDest>::size_type i = 0; i < this->groups.size(); i++)
+  {
+    this->SetIPAddress((const char*)this->groups[i].address);
+    this->SetPortNumber(this->groups[i].portNum);
+    int n = this->SendUDPBatch(packets, lengths, numberOfPackets);
+    numberOfSent = n < numberOfSent ? n : numberOfSent;
+  }
+  for(std::vector<ClientDest>::size_type i = 0; i < this->clients.size(); i++)
+  {
+    this->SetIPAddress((const char*)this->clients[i].address);
+    this->SetPortNumber(this->clients[i].portNum);
+    int n = this->SendUDPBatch(packets, lengths, numberOfPackets);
+    numberOfSent = n < numberOfSent ? n : numberOfSent;
+  }
+  return numberOfSent;
+}
+
 //-----------------------------------------------------------------------------
 int UDPServerSocket::CreateUDPServer()
 {
@@ -107,6 +107,14 @@ public:
   // Write the data to all clients
   int WriteSocket(unsigned char* buffer, unsigned bufferSize);
 
+  // Description:
+  // Write 'numberOfPackets' packets, where packets[i] holds lengths[i] bytes,
+  // to all groups and clients. The packets are sent to each destination
+  // with as few system calls as possible (see GeneralSocket::SendUDPBatch()).
+  // Returns the number of packets sent to every destination, or 0 if there
+  // is no destination.
+  int WriteSocketBatch(const unsigned char* const* packets, const int* lengths, int numberOfPackets);
+
 protected:
   UDPServerSocket();
   ~UDPServerSocket();
@@ -173,35 +173,16 @@ void igtl_export igtl_image_get_matrix_4x4(float _matrix[4][4], igtl_image_heade
 
 void igtl_export igtl_image_convert_byte_order(igtl_image_header * header)
 {
-  int i;
-  igtl_uint32 tmp[12];
-
   if (igtl_is_little_endian()) 
     {
-
     header->header_version = BYTE_SWAP_INT16(header->header_version);
 
-    for (i = 0; i < 3; i ++) 
-      {
-      header->size[i] = BYTE_SWAP_INT16(header->size[i]);
-      header->subvol_size[i] = BYTE_SWAP_INT16(header->subvol_size[i]);
-      header->subvol_offset[i] = BYTE_SWAP_INT16(header->subvol_offset[i]);
-      }
-
-    memcpy(tmp, header->matrix, sizeof(igtl_uint32)*12);
-
-    /* 
-     * TODO: The following loop may cause segmentation fault, when it is compiled
-     * with '-ftree-vectorize' optimization option on 64-bit Linux.
-     * ('-ftree-vectorize' becomes active, when '-O3' optimization is specified.)
-     * -- code has been updated on June 24 -- needs test
-     */
-    for (i = 0; i < 12; i ++) 
-      {
-      tmp[i] =  BYTE_SWAP_INT32(tmp[i]);
-      }
-    memcpy(header->matrix, tmp, sizeof(igtl_uint32)*12);
-
+    /* igtl_convert_byte_order() does not assume that the fields are aligned,
+     * which the packed header does not guarantee. */
+    igtl_convert_byte_order(header->size, 3, sizeof(igtl_uint16));
+    igtl_convert_byte_order(header->matrix, 12, sizeof(igtl_float32));
+    /* subvol_offset[3] is followed by subvol_size[3] */
+    igtl_convert_byte_order(header->subvol_offset, 6, sizeof(igtl_uint16));
     }
 }
 
@@ -88,6 +88,7 @@ int igtl_export igtl_ndarray_alloc_info(igtl_ndarray_info * info, const igtl_uin
     if (info->array == NULL)
       {
       free(info->size);
+      info->size = NULL;
       return 0;
       }
 
@@ -119,22 +120,10 @@ int igtl_export igtl_ndarray_unpack(int type, void * byte_array, igtl_ndarray_in
 {
   char * ptr;
   igtl_uint16 dim;
-  igtl_uint16 * size;
+  igtl_uint16 size[256]; /* 'dim' is an 8-bit field */
   igtl_uint16 i;
   igtl_uint64 len;
-
-  igtl_uint16 * ptr16_src;
-  igtl_uint16 * ptr16_src_end;
-  igtl_uint16 * ptr16_dst;
-
-  igtl_uint32 * ptr32_src;
-  igtl_uint32 * ptr32_src_end;
-  igtl_uint32 * ptr32_dst;
-
-  igtl_uint64 * ptr64_src;
-  igtl_uint64 * ptr64_src_end;
-  igtl_uint64 * ptr64_dst;
-
+  int nbyte;
 
   if (byte_array == NULL || info == NULL)
     {
@@ -153,29 +142,12 @@ int igtl_export igtl_ndarray_unpack(int type, void * byte_array, igtl_ndarray_in
   ptr ++;
 
   /*** Size array field ***/
-  size = (igtl_uint16 *) ptr;
   dim  = info->dim;
-  if (igtl_is_little_endian())
+  if (pack_size < IGTL_NDARRAY_HEADER_SIZE + sizeof(igtl_uint16) * dim)
     {
-    /* Change byte order -- this overwrites memory area for the pack !!*/
-    for (i = 0; i < dim; i ++)
-      {
-      size[i] = BYTE_SWAP_INT16(size[i]);
-      }
-    }
-
-  igtl_ndarray_alloc_info(info, size);
-
-  memcpy(info->size, size, sizeof(igtl_uint16) * dim);
-  if (igtl_is_little_endian())
-    {
-    /* Resotore the overwritten memory area */
-    /* Don't use size[] array after this !! */
-    for (i = 0; i < dim; i ++)
-      {
-      size[i] = BYTE_SWAP_INT16(size[i]);
-      }
+    return 0;
     }
+  igtl_convert_byte_order_copy(size, ptr, dim, sizeof(igtl_uint16));
   ptr += sizeof(igtl_uint16) * dim;
 
   /*** N-D array field ***/
@@ -183,55 +155,29 @@ int igtl_export igtl_ndarray_unpack(int type, void * byte_array, igtl_ndarray_in
   len = 1;
   for (i = 0; i < dim; i ++)
     {
-    len *= info->size[i];
+    len *= size[i];
     }
 
-  /* Copy array */
-  if (igtl_ndarray_get_nbyte(info->type) == 1 || !igtl_is_little_endian())
+  /* Check if the pack size is valid */
+  nbyte = igtl_ndarray_get_nbyte(info->type);
+  if (nbyte == 0 ||
+      pack_size - IGTL_NDARRAY_HEADER_SIZE - sizeof(igtl_uint16) * dim < len * nbyte)
     {
-    /* If single-byte data type is used or the program runs on a big-endian machine,
-       just copy the array from the pack to the strucutre */
-    memcpy(info->array, ptr, (size_t)(len * igtl_ndarray_get_nbyte(info->type)));
-    }
-  else if (igtl_ndarray_get_nbyte(info->type) == 2) /* 16-bit */
-    {
-    ptr16_src = (igtl_uint16 *) ptr;
-    ptr16_src_end = ptr16_src + len;
-    ptr16_dst = (igtl_uint16 *) info->array;
-    while (ptr16_src < ptr16_src_end)
-      {
-      *ptr16_dst = BYTE_SWAP_INT16(*ptr16_src);
-      ptr16_dst ++;
-      ptr16_src ++;
-      }
+    return 0;
     }
-  else if (igtl_ndarray_get_nbyte(info->type) == 4) /* 32-bit */
+
+  if (igtl_ndarray_alloc_info(info, size) == 0)
     {
-    ptr32_src = (igtl_uint32 *) ptr;
-    ptr32_src_end = ptr32_src + len;
-    ptr32_dst = (igtl_uint32 *) info->array;
-    while (ptr32_src < ptr32_src_end)
-      {
-      *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-      ptr32_dst ++;
-      ptr32_src ++;
-      }
+    return 0;
     }
-  else /* 64-bit or Complex type */
+
+  /* Copy array. A complex value is converted as a pair of 64-bit values */
+  if (nbyte > 8)
     {
-    ptr64_src = (igtl_uint64 *) ptr;
-    /* Adding number of elements to the pointer -- 64-bit: len * 1; Complex: len * 2*/
-    ptr64_src_end = ptr64_src + len * igtl_ndarray_get_nbyte(info->type)/8;
-    ptr64_dst = (igtl_uint64 *) info->array;
-    while (ptr64_src < ptr64_src_end)
-      {
-      *ptr64_dst = BYTE_SWAP_INT64(*ptr64_src);
-      ptr64_dst ++;
-      ptr64_src ++;
-      }
+    len *= nbyte / 8;
+    nbyte = 8;
     }
-
-  /* TODO: check if the pack size is valid */
+  igtl_convert_byte_order_copy(info->array, ptr, len, nbyte);
 
   return 1;
 
@@ -239,25 +185,18 @@ int igtl_export igtl_ndarray_unpack(int type, void * byte_array, igtl_ndarray_in
 
 
 int igtl_export igtl_ndarray_pack(igtl_ndarray_info * info, void * byte_array, int type)
+{
+  return igtl_ndarray_pack_crc64(info, byte_array, type, NULL);
+}
+
+
+int igtl_export igtl_ndarray_pack_crc64(igtl_ndarray_info * info, void * byte_array, int type, igtl_uint64 * crc)
 {
   char * ptr;
   igtl_uint16 dim;
-  igtl_uint16 * size;
   igtl_uint16 i;
   igtl_uint64 len;
-
-  igtl_uint16 * ptr16_src;
-  igtl_uint16 * ptr16_src_end;
-  igtl_uint16 * ptr16_dst;
-
-  igtl_uint32 * ptr32_src;
-  igtl_uint32 * ptr32_src_end;
-  igtl_uint32 * ptr32_dst;
-
-  igtl_uint64 * ptr64_src;
-  igtl_uint64 * ptr64_src_end;
-  igtl_uint64 * ptr64_dst;
-
+  int nbyte;
 
   if (byte_array == NULL || info == NULL)
     {
@@ -275,22 +214,15 @@ int igtl_export igtl_ndarray_pack(igtl_ndarray_info * info, void * byte_array, i
   ptr ++;
 
   /*** Size array field ***/
-  size = (igtl_uint16 *) ptr;
-  if (igtl_is_little_endian())
-    {
-    for (i = 0; i < info->dim; i ++)
-      {
-      size[i] = BYTE_SWAP_INT16(info->size[i]);
-      }
-    }
-  else
-    {
-    memcpy(ptr, info->size, sizeof(igtl_uint16) * info->dim);
-    }
-
   dim = info->dim;
+  igtl_convert_byte_order_copy(ptr, info->size, dim, sizeof(igtl_uint16));
   ptr += sizeof(igtl_uint16) * dim;
 
+  if (crc)
+    {
+    *crc = crc64((unsigned char *) byte_array, (igtl_uint64) (ptr - (char *) byte_array), *crc);
+    }
+
   /*** N-D array field ***/
   /* Calculate number of elements in N-D array */
   len = 1;
@@ -299,49 +231,21 @@ int igtl_export igtl_ndarray_pack(igtl_ndarray_info * info, void * byte_array, i
     len *= info->size[i];
     }
 
-  /* Copy array */
-  if (igtl_ndarray_get_nbyte(info->type) == 1 || !igtl_is_little_endian())
+  /* Copy array. A complex value is converted as a pair of 64-bit values */
+  nbyte = igtl_ndarray_get_nbyte(info->type);
+  if (nbyte > 8)
     {
-    /* If single-byte data type is used or the program runs on a big-endian machine,
-       just copy the array from the pack to the strucutre */
-    memcpy(ptr, info->array, (size_t) (len * igtl_ndarray_get_nbyte(info->type)));
-    }
-  else if (igtl_ndarray_get_nbyte(info->type) == 2) /* 16-bit */
-    {
-    ptr16_src = (igtl_uint16 *) info->array;
-    ptr16_src_end = ptr16_src + len;
-    ptr16_dst = (igtl_uint16 *) ptr;
-    while (ptr16_src < ptr16_src_end)
-      {
-      *ptr16_dst = BYTE_SWAP_INT16(*ptr16_src);
-      ptr16_dst ++;
-      ptr16_src ++;
-      }
+    len *= nbyte / 8;
+    nbyte = 8;
     }
-  else if (igtl_ndarray_get_nbyte(info->type) == 4) /* 32-bit */
+
+  if (crc)
     {
-    ptr32_src = (igtl_uint32 *) info->array;
-    ptr32_src_end = ptr32_src + len;
-    ptr32_dst = (igtl_uint32 *) ptr;
-    while (ptr32_src < ptr32_src_end)
-      {
-      *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-      ptr32_dst ++;
-      ptr32_src ++;
-      }
+    *crc = igtl_convert_byte_order_copy_crc64(ptr, info->array, len, nbyte, *crc);
     }
-  else /* 64-bit or Complex type */
+  else
     {
-    ptr64_src = (igtl_uint64 *) info->array;
-    /* Adding number of elements to the pointer -- 64-bit: len * 1; Complex: len * 2*/
-    ptr64_src_end = ptr64_src + len * igtl_ndarray_get_nbyte(info->type)/8;
-    ptr64_dst = (igtl_uint64 *) ptr;
-    while (ptr64_src < ptr64_src_end)
-      {
-      *ptr64_dst = BYTE_SWAP_INT64(*ptr64_src);
-      ptr64_dst ++;
-      ptr64_src ++;
-      }
+    igtl_convert_byte_order_copy(ptr, info->array, len, nbyte);
     }
 
   return 1;
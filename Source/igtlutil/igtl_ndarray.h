@@ -75,6 +75,10 @@ int igtl_export igtl_ndarray_unpack(int type, void * byte_array, igtl_ndarray_in
  *  (none, or GET_) by IGTL_TYPE_PREFIX_* macro. Returns 1 if success, otherwise 0. */
 int igtl_export igtl_ndarray_pack(igtl_ndarray_info * info, void * byte_array, int type);
 
+/** Same as igtl_ndarray_pack(), but also feeds the packed bytes to the CRC-64 pointed by
+ *  'crc' while they are written. If 'crc' is NULL, it behaves as igtl_ndarray_pack(). */
+int igtl_export igtl_ndarray_pack_crc64(igtl_ndarray_info * info, void * byte_array, int type, igtl_uint64 * crc);
+
 /** Calculates size of N-D array body including
  * size table (defined by UINT16[dim]) and array data. */
 igtl_uint64 igtl_export igtl_ndarray_get_size(igtl_ndarray_info * info, int type);
@@ -20,23 +20,14 @@
 
 void igtl_export igtl_point_convert_byte_order(igtl_point_element* pointlist, int nitem)
 {
-  igtl_point_element* elem;
   int i;
-  int j;
-  igtl_int32* tmp;
-      
-  for (i = 0; i < nitem; i ++)
+
+  if (igtl_is_little_endian())
     {
-    elem = &(pointlist[i]);
-    if (igtl_is_little_endian()) 
+    for (i = 0; i < nitem; i ++)
       {
-      for (j = 0; j < 3; j ++)
-        {
-        tmp = (igtl_int32*)&(elem->position[j]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        }
-      tmp = (igtl_int32*)&(elem->radius);
-      *tmp = BYTE_SWAP_INT32(*tmp);
+      /* position[3] is followed by radius */
+      igtl_convert_byte_order(pointlist[i].position, 4, sizeof(igtl_float32));
       }
     }
 }
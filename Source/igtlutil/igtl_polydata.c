@@ -233,10 +233,6 @@ int igtl_export igtl_polydata_free_info(igtl_polydata_info * info)
 
 int igtl_polydata_convert_byteorder_topology(igtl_uint32 * dst, igtl_uint32 * src, igtl_uint32 size)
 {
-  igtl_uint32 * ptr32_src;
-  igtl_uint32 * ptr32_src_end;
-  igtl_uint32 * ptr32_dst;
-
   if (size == 0)
     {
     return 1;
@@ -248,22 +244,7 @@ int igtl_polydata_convert_byteorder_topology(igtl_uint32 * dst, igtl_uint32 * sr
     return 0;
     }
 
-  if (!igtl_is_little_endian())
-    {
-    memcpy((void*)dst, (void*)src, size);
-    }
-  else
-    {
-    ptr32_src = (igtl_uint32 *) src;
-    ptr32_src_end = ptr32_src + (size/sizeof(igtl_uint32));
-    ptr32_dst = (igtl_uint32 *) dst;
-    while (ptr32_src < ptr32_src_end)
-      {
-      *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-      ptr32_dst ++;
-      ptr32_src ++;
-      }
-    }
+  igtl_convert_byte_order_copy(dst, src, size/sizeof(igtl_uint32), sizeof(igtl_uint32));
 
   return 1;
 }
@@ -276,9 +257,6 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
   igtl_polydata_header * header;
   char * ptr;
 
-  igtl_uint32 * ptr32_src;
-  igtl_uint32 * ptr32_src_end;
-  igtl_uint32 * ptr32_dst;
   igtl_uint32   s;
 
   igtl_polydata_attribute_header * att_header;
@@ -298,23 +276,9 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
 
   /* POLYDATA header */
   header = (igtl_polydata_header *) byte_array;
-  if (igtl_is_little_endian())
-    {
-    info->header.npoints              = BYTE_SWAP_INT32(header->npoints);
-    info->header.nvertices            = BYTE_SWAP_INT32(header->nvertices);
-    info->header.size_vertices        = BYTE_SWAP_INT32(header->size_vertices);
-    info->header.nlines               = BYTE_SWAP_INT32(header->nlines);
-    info->header.size_lines           = BYTE_SWAP_INT32(header->size_lines);
-    info->header.npolygons            = BYTE_SWAP_INT32(header->npolygons);
-    info->header.size_polygons        = BYTE_SWAP_INT32(header->size_polygons);
-    info->header.ntriangle_strips     = BYTE_SWAP_INT32(header->ntriangle_strips);
-    info->header.size_triangle_strips = BYTE_SWAP_INT32(header->size_triangle_strips);
-    info->header.nattributes          = BYTE_SWAP_INT32(header->nattributes);
-    }
-  else
-    {
-    memcpy(&(info->header), header, sizeof(igtl_polydata_header));
-    }
+  /* The header consists of 32-bit fields only */
+  igtl_convert_byte_order_copy(&(info->header), header,
+                               sizeof(igtl_polydata_header)/sizeof(igtl_uint32), sizeof(igtl_uint32));
   
   /* Allocate memory to read data */
   /* TODO: compare the size of info before copying the header. */
@@ -326,22 +290,7 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
   
   /* POINT section */
   ptr = (char*) byte_array + sizeof(igtl_polydata_header);
-  if (!igtl_is_little_endian())
-    {
-    memcpy(info->points, ptr, sizeof(igtl_float32)*info->header.npoints*3);
-    }
-  else 
-    {
-    ptr32_src = (igtl_uint32 *) ptr;
-    ptr32_src_end = ptr32_src + info->header.npoints*3;
-    ptr32_dst = (igtl_uint32 *) info->points;
-    while (ptr32_src < ptr32_src_end)
-      {
-      *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-      ptr32_dst ++;
-      ptr32_src ++;
-      }
-    }
+  igtl_convert_byte_order_copy(info->points, ptr, (igtl_uint64) info->header.npoints*3, sizeof(igtl_float32));
 
   ptr += sizeof(igtl_float32)*info->header.npoints*3;
 
@@ -439,22 +388,7 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
       s = n * sizeof(igtl_float32);
       }
     info->attributes[i].data = (igtl_float32*)malloc((size_t)s);
-    ptr32_dst = (igtl_uint32*)info->attributes[i].data;
-    ptr32_src = (igtl_uint32*)ptr;
-    ptr32_src_end = ptr32_src + n;
-    if (igtl_is_little_endian())
-      {
-      while (ptr32_src < ptr32_src_end)
-        {
-        *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-        ptr32_dst ++;
-        ptr32_src ++;
-        }
-      }
-    else
-      {
-      memcpy(ptr32_dst, ptr32_src, s);
-      }
+    igtl_convert_byte_order_copy(info->attributes[i].data, ptr, n, sizeof(igtl_float32));
     ptr += s;
     }
   
@@ -463,15 +397,33 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
 
 
 int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array, int type)
+{
+  return igtl_polydata_pack_crc64(info, byte_array, type, NULL);
+}
+
+
+/* Converts a section of 32-bit values to network byte order and, if 'crc' is not
+ * NULL, feeds the written bytes to the CRC. */
+static void igtl_polydata_pack_section32(char * dst, const void * src, igtl_uint64 n, igtl_uint64 * crc)
+{
+  if (crc)
+    {
+    *crc = igtl_convert_byte_order_copy_crc64(dst, src, n, sizeof(igtl_uint32), *crc);
+    }
+  else
+    {
+    igtl_convert_byte_order_copy(dst, src, n, sizeof(igtl_uint32));
+    }
+}
+
+
+int igtl_export igtl_polydata_pack_crc64(igtl_polydata_info * info, void * byte_array, int type, igtl_uint64 * crc)
 {
   /* size = number of ponits (not number of bytes). In case of vertices, this is specfied 
      by size_vertices in igtl_polydata_header. */
   igtl_polydata_header * header;
   char * ptr;
-
-  igtl_uint32 * ptr32_src;
-  igtl_uint32 * ptr32_src_end;
-  igtl_uint32 * ptr32_dst;
+  char * ptr_att;
 
   igtl_polydata_attribute_header * att_header;
   igtl_polydata_attribute * att;
@@ -490,42 +442,16 @@ int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array,
 
   /* POLYDATA header */
   header = (igtl_polydata_header *) byte_array;
-  if (igtl_is_little_endian())
-    {
-    header->npoints              = BYTE_SWAP_INT32(info->header.npoints);
-    header->nvertices            = BYTE_SWAP_INT32(info->header.nvertices);
-    header->size_vertices        = BYTE_SWAP_INT32(info->header.size_vertices);
-    header->nlines               = BYTE_SWAP_INT32(info->header.nlines);
-    header->size_lines           = BYTE_SWAP_INT32(info->header.size_lines);
-    header->npolygons            = BYTE_SWAP_INT32(info->header.npolygons);
-    header->size_polygons        = BYTE_SWAP_INT32(info->header.size_polygons);
-    header->ntriangle_strips     = BYTE_SWAP_INT32(info->header.ntriangle_strips);
-    header->size_triangle_strips = BYTE_SWAP_INT32(info->header.size_triangle_strips);
-    header->nattributes          = BYTE_SWAP_INT32(info->header.nattributes);
-    }
-  else
+  igtl_convert_byte_order_copy(header, &(info->header),
+                               sizeof(igtl_polydata_header)/sizeof(igtl_uint32), sizeof(igtl_uint32));
+  if (crc)
     {
-    memcpy(header, &(info->header), sizeof(igtl_polydata_header));
+    *crc = crc64((unsigned char *) header, sizeof(igtl_polydata_header), *crc);
     }
-  
+
   /* POINT section */
   ptr = (char*) byte_array + sizeof(igtl_polydata_header);
-  if (!igtl_is_little_endian())
-    {
-    memcpy((void*)ptr, (void*)info->points, sizeof(igtl_float32)*info->header.npoints*3);
-    }
-  else
-    {
-    ptr32_src = (igtl_uint32 *) info->points;
-    ptr32_src_end = ptr32_src + info->header.npoints*3;
-    ptr32_dst = (igtl_uint32 *) ptr;
-    while (ptr32_src < ptr32_src_end)
-      {
-      *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-      ptr32_dst ++;
-      ptr32_src ++;
-      }
-    }
+  igtl_polydata_pack_section32(ptr, info->points, (igtl_uint64) info->header.npoints*3, crc);
 
   ptr += sizeof(igtl_float32)*info->header.npoints*3;
 
@@ -540,26 +466,23 @@ int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array,
     }
 
   /* VERTICES section */
-  igtl_polydata_convert_byteorder_topology((igtl_uint32*)ptr, info->vertices,
-                                           info->header.size_vertices);
+  igtl_polydata_pack_section32(ptr, info->vertices, info->header.size_vertices/sizeof(igtl_uint32), crc);
   ptr += info->header.size_vertices;
 
   /* LINES section */
-  igtl_polydata_convert_byteorder_topology((igtl_uint32*)ptr, info->lines,
-                                           info->header.size_lines);
+  igtl_polydata_pack_section32(ptr, info->lines, info->header.size_lines/sizeof(igtl_uint32), crc);
   ptr += info->header.size_lines;
 
   /* POLYGONS section */
-  igtl_polydata_convert_byteorder_topology((igtl_uint32*)ptr, info->polygons,
-                                           info->header.size_polygons);
+  igtl_polydata_pack_section32(ptr, info->polygons, info->header.size_polygons/sizeof(igtl_uint32), crc);
   ptr += info->header.size_polygons;
 
   /* TRIANGLE_STRIPS section */
-  igtl_polydata_convert_byteorder_topology((igtl_uint32*)ptr, info->triangle_strips,
-                                           info->header.size_triangle_strips);
+  igtl_polydata_pack_section32(ptr, info->triangle_strips, info->header.size_triangle_strips/sizeof(igtl_uint32), crc);
   ptr += info->header.size_triangle_strips;
 
   /* Attribute header */
+  ptr_att = ptr;
   for (i = 0; i < info->header.nattributes; i ++)
     {
     att = &(info->attributes[i]);
@@ -614,6 +537,11 @@ int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array,
     ptr ++;
     }
 
+  if (crc)
+    {
+    *crc = crc64((unsigned char *) ptr_att, (igtl_uint64) (ptr - ptr_att), *crc);
+    }
+
   /* Attributes */
   for (i = 0; i < info->header.nattributes; i ++)
     {
@@ -642,22 +570,7 @@ int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array,
       n = 9 * info->attributes[i].n;
       size = n * sizeof(igtl_float32);
       }
-    if (igtl_is_little_endian())
-      {
-      ptr32_dst = (igtl_uint32*)ptr;
-      ptr32_src = (igtl_uint32*)info->attributes[i].data;
-      ptr32_src_end = ptr32_src + n;
-      while (ptr32_src < ptr32_src_end)
-        {
-        *ptr32_dst = BYTE_SWAP_INT32(*ptr32_src);
-        ptr32_dst ++;
-        ptr32_src ++;
-        }
-      }
-    else
-      {
-      memcpy(ptr, info->attributes[i].data, size);
-      }
+    igtl_polydata_pack_section32(ptr, info->attributes[i].data, n, crc);
     ptr += size;
     }
 
@@ -723,6 +636,11 @@ igtl_uint64 igtl_export igtl_polydata_get_size(igtl_polydata_info * info, int ty
       n = 3 * info->attributes[i].n;
       size = n * sizeof(igtl_float32);
       }
+    else if (info->attributes[i].type == IGTL_POLY_ATTR_TYPE_TCOORDS)
+      {
+      n = 3 * info->attributes[i].n;
+      size = n * sizeof(igtl_float32);
+      }
     else /* TENSOR */
       {
       n = 9 * info->attributes[i].n;
@@ -124,6 +124,10 @@ int igtl_export igtl_polydata_unpack(int type, void * byte_array, igtl_polydata_
  *  Returns 1 if success, otherwise 0. */
 int igtl_export igtl_polydata_pack(igtl_polydata_info * info, void * byte_array, int type);
 
+/** Same as igtl_polydata_pack(), but also feeds the packed bytes to the CRC-64 pointed by
+ *  'crc' while they are written. If 'crc' is NULL, it behaves as igtl_polydata_pack(). */
+int igtl_export igtl_polydata_pack_crc64(igtl_polydata_info * info, void * byte_array, int type, igtl_uint64 * crc);
+
 /** igtl_polydata_get_size() calculates the size of polydata header, consisting of
  *  POLYDATA hearder section (including number of child messages) and
  *  name table section based on a igtl_polydata_header.
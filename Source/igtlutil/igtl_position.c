@@ -21,66 +21,19 @@
 
 void igtl_export igtl_position_convert_byte_order(igtl_position* pos)
 {
-
-  igtl_uint32 tmp[4];
-
-  if (igtl_is_little_endian())
-    {
-    /* position */
-    memcpy((void*)tmp, (void*)(pos->position), sizeof(igtl_float32)*3);
-    tmp[0]  = BYTE_SWAP_INT32(tmp[0]);
-    tmp[1]  = BYTE_SWAP_INT32(tmp[1]);
-    tmp[2]  = BYTE_SWAP_INT32(tmp[2]);
-    memcpy((void*)(pos->position), (void*)tmp, sizeof(igtl_float32)*3);
-
-    /* quaternion */
-    memcpy((void*)tmp, (void*)(pos->quaternion), sizeof(igtl_float32)*4);
-    tmp[0]  = BYTE_SWAP_INT32(tmp[0]);
-    tmp[1]  = BYTE_SWAP_INT32(tmp[1]);
-    tmp[2]  = BYTE_SWAP_INT32(tmp[2]);
-    tmp[3]  = BYTE_SWAP_INT32(tmp[3]);
-    memcpy((void*)(pos->quaternion), (void*)tmp, sizeof(igtl_float32)*4);
-    }
+  /* position[3] is followed by quaternion[4] */
+  igtl_convert_byte_order(pos->position, 7, sizeof(igtl_float32));
 }
 
 void igtl_export igtl_position_convert_byte_order_position_only(igtl_position* pos)
 {
-
-  igtl_uint32 tmp[4];
-
-  if (igtl_is_little_endian())
-    {
-    /* position */
-    memcpy((void*)tmp, (void*)(pos->position), sizeof(igtl_float32)*3);
-    tmp[0]  = BYTE_SWAP_INT32(tmp[0]);
-    tmp[1]  = BYTE_SWAP_INT32(tmp[1]);
-    tmp[2]  = BYTE_SWAP_INT32(tmp[2]);
-    memcpy((void*)(pos->position), (void*)tmp, sizeof(igtl_float32)*3);
-    }
+  igtl_convert_byte_order(pos->position, 3, sizeof(igtl_float32));
 }
 
 void igtl_export igtl_position_convert_byte_order_quaternion3(igtl_position* pos)
 {
-
-  igtl_uint32 tmp[4];
-
-  if (igtl_is_little_endian())
-    {
-    /* position */
-    memcpy((void*)tmp, (void*)(pos->position), sizeof(igtl_float32)*3);
-    tmp[0]  = BYTE_SWAP_INT32(tmp[0]);
-    tmp[1]  = BYTE_SWAP_INT32(tmp[1]);
-    tmp[2]  = BYTE_SWAP_INT32(tmp[2]);
-    memcpy((void*)(pos->position), (void*)tmp, sizeof(igtl_float32)*3);
-
-    /* quaternion */
-    memcpy((void*)tmp, (void*)(pos->quaternion), sizeof(igtl_float32)*3);
-    tmp[0]  = BYTE_SWAP_INT32(tmp[0]);
-    tmp[1]  = BYTE_SWAP_INT32(tmp[1]);
-    tmp[2]  = BYTE_SWAP_INT32(tmp[2]);
-    memcpy((void*)(pos->quaternion), (void*)tmp, sizeof(igtl_float32)*3);
-    }
-
+  /* position[3] is followed by the first three elements of quaternion[4] */
+  igtl_convert_byte_order(pos->position, 6, sizeof(igtl_float32));
 }
 
 
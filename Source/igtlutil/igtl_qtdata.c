@@ -20,27 +20,14 @@
 
 void igtl_export igtl_qtdata_convert_byte_order(igtl_qtdata_element* qtdatalist, int nitem)
 {
-  igtl_qtdata_element* elem;
   int i;
-  int j;
-  int k;
-  igtl_int32* tmp;
-      
-  for (i = 0; i < nitem; i ++)
+
+  if (igtl_is_little_endian())
     {
-    elem = &(qtdatalist[i]);
-    if (igtl_is_little_endian()) 
+    for (i = 0; i < nitem; i ++)
       {
-      for (j = 0; j < 3; j ++)
-        {
-        tmp = (igtl_int32*)&(elem->position[j]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        }
-      for (k = 0; k < 4; k ++)
-        {
-        tmp = (igtl_int32*)&(elem->quaternion[k]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        }
+      /* position[3] is followed by quaternion[4] */
+      igtl_convert_byte_order(qtdatalist[i].position, 7, sizeof(igtl_float32));
       }
     }
 }
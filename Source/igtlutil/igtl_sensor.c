@@ -31,20 +31,13 @@ igtl_uint32 igtl_export igtl_sensor_get_data_size(igtl_sensor_header * header)
 
 void igtl_export igtl_sensor_convert_byte_order(igtl_sensor_header* header, igtl_float64* data)
 {
-  int i;
   int larray;
-  igtl_uint64* tmp;
 
   if (igtl_is_little_endian()) 
     {
     larray = (int) header->larray; /* NOTE: larray is 8-bit (doesn't depend on endianness) */
     header->unit = BYTE_SWAP_INT64(header->unit);
-    
-    tmp = (igtl_uint64*) data;
-    for (i = 0; i < larray; i ++)
-      {
-      tmp[i] = BYTE_SWAP_INT64(tmp[i]);
-      }
+    igtl_convert_byte_order(data, larray, sizeof(igtl_float64));
     }
 }
 
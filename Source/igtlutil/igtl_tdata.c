@@ -20,21 +20,13 @@
 
 void igtl_export igtl_tdata_convert_byte_order(igtl_tdata_element* tdatalist, int nitem)
 {
-  igtl_tdata_element* elem;
   int i;
-  int j;
-  igtl_int32* tmp;
-      
-  for (i = 0; i < nitem; i ++)
+
+  if (igtl_is_little_endian())
     {
-    elem = &(tdatalist[i]);
-    if (igtl_is_little_endian()) 
+    for (i = 0; i < nitem; i ++)
       {
-      for (j = 0; j < 12; j ++)
-        {
-        tmp = (igtl_int32*)&(elem->transform[j]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        }
+      igtl_convert_byte_order(tdatalist[i].transform, 12, sizeof(igtl_float32));
       }
     }
 }
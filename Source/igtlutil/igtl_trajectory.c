@@ -20,25 +20,14 @@
 
 void igtl_export igtl_trajectory_convert_byte_order(igtl_trajectory_element* trajectorylist, int nitem)
 {
-  igtl_trajectory_element* elem;
   int i;
-  int j;
-  igtl_int32* tmp;
-      
-  for (i = 0; i < nitem; i ++)
+
+  if (igtl_is_little_endian())
     {
-    elem = &(trajectorylist[i]);
-    if (igtl_is_little_endian()) 
+    for (i = 0; i < nitem; i ++)
       {
-      for (j = 0; j < 3; j ++)
-        {
-        tmp = (igtl_int32*)&(elem->entry_pos[j]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        tmp = (igtl_int32*)&(elem->target_pos[j]);
-        *tmp = BYTE_SWAP_INT32(*tmp);
-        }
-      tmp = (igtl_int32*)&(elem->radius);
-      *tmp = BYTE_SWAP_INT32(*tmp);
+      /* entry_pos[3] is followed by target_pos[3] and radius */
+      igtl_convert_byte_order(trajectorylist[i].entry_pos, 7, sizeof(igtl_float32));
       }
     }
 }
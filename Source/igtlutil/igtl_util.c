@@ -12,7 +12,16 @@
 
 =========================================================================*/
 
+#include <string.h>
+
 #include "igtl_util.h"
+#include "igtlConfigure.h"
+
+#if defined(OpenIGTLink_USE_PTHREADS)
+  #include <pthread.h>
+#elif defined(_WIN32)
+  #include <windows.h>
+#endif
 
 int igtl_export igtl_is_little_endian()
 {
@@ -21,147 +30,983 @@ int igtl_export igtl_is_little_endian()
 }
 
 
+/*
+ * One-time initialization. igtl_call_once() runs 'func' exactly once, and
+ * the data written by 'func' is visible to every thread when any call
+ * returns; the tables and function pointers below are initialized that way
+ * because crc64() etc. may be called from several threads at the same time
+ * (e.g. by ParallelCRC64).
+ */
+
+#if defined(OpenIGTLink_USE_PTHREADS)
+
+typedef pthread_once_t igtl_once_flag;
+#define IGTL_ONCE_INIT PTHREAD_ONCE_INIT
+
+static void igtl_call_once(igtl_once_flag* flag, void (*func)(void))
+{
+  pthread_once(flag, func);
+}
+
+#elif defined(_WIN32)
+
+/* 0: not run, 1: running, 2: done */
+typedef volatile LONG igtl_once_flag;
+#define IGTL_ONCE_INIT 0
+
+static void igtl_call_once(igtl_once_flag* flag, void (*func)(void))
+{
+  if (InterlockedCompareExchange(flag, 2, 2) == 2)
+    {
+    return;
+    }
+  if (InterlockedCompareExchange(flag, 1, 0) == 0)
+    {
+    func();
+    InterlockedExchange(flag, 2);
+    return;
+    }
+  while (InterlockedCompareExchange(flag, 2, 2) != 2)
+    {
+    Sleep(0);
+    }
+}
+
+#else
+
+/* No thread support */
+typedef int igtl_once_flag;
+#define IGTL_ONCE_INIT 0
+
+static void igtl_call_once(igtl_once_flag* flag, void (*func)(void))
+{
+  if (!*flag)
+    {
+    *flag = 1;
+    func();
+    }
+}
+
+#endif
+
+
+/*
+ * CRC-64 (ECMA-182 polynomial, MSB first, no reflection, no final XOR).
+ *
+ * crc64() dispatches to one of the following variants, all of which produce
+ * identical results:
+ *   - bytewise : the original one-byte-per-step table lookup.
+ *   - slice8   : slicing-by-8; eight table lookups per 8 bytes of input.
+ *   - slice16  : slicing-by-16; sixteen table lookups per 16 bytes of input.
+ *   - clmul    : 128-bit folding with the x86 carry-less multiply instruction
+ *                (PCLMULQDQ). Only available when the compiler supports it
+ *                (OpenIGTLink_HAVE_PCLMUL) and the CPU reports the feature.
+ *
+ * The slicing tables and folding constants are derived from crc64_table,
+ * and the variant for the CPU is selected, once by crc64_initialize() at the
+ * first call of any of the functions below.
+ */
+
+#define IGTL_CRC64_POLY 0x42F0E1EBA9EA3693ULL
+
+static const igtl_uint64 crc64_table[256] = {
+  0x0000000000000000ULL,0x42F0E1EBA9EA3693ULL,
+  0x85E1C3D753D46D26ULL,0xC711223CFA3E5BB5ULL,
+  0x493366450E42ECDFULL,0x0BC387AEA7A8DA4CULL,
+  0xCCD2A5925D9681F9ULL,0x8E224479F47CB76AULL,
+  0x9266CC8A1C85D9BEULL,0xD0962D61B56FEF2DULL,
+  0x17870F5D4F51B498ULL,0x5577EEB6E6BB820BULL,
+  0xDB55AACF12C73561ULL,0x99A54B24BB2D03F2ULL,
+  0x5EB4691841135847ULL,0x1C4488F3E8F96ED4ULL,
+  0x663D78FF90E185EFULL,0x24CD9914390BB37CULL,
+  0xE3DCBB28C335E8C9ULL,0xA12C5AC36ADFDE5AULL,
+  0x2F0E1EBA9EA36930ULL,0x6DFEFF5137495FA3ULL,
+  0xAAEFDD6DCD770416ULL,0xE81F3C86649D3285ULL,
+  0xF45BB4758C645C51ULL,0xB6AB559E258E6AC2ULL,
+  0x71BA77A2DFB03177ULL,0x334A9649765A07E4ULL,
+  0xBD68D2308226B08EULL,0xFF9833DB2BCC861DULL,
+  0x388911E7D1F2DDA8ULL,0x7A79F00C7818EB3BULL,
+  0xCC7AF1FF21C30BDEULL,0x8E8A101488293D4DULL,
+  0x499B3228721766F8ULL,0x0B6BD3C3DBFD506BULL,
+  0x854997BA2F81E701ULL,0xC7B97651866BD192ULL,
+  0x00A8546D7C558A27ULL,0x4258B586D5BFBCB4ULL,
+  0x5E1C3D753D46D260ULL,0x1CECDC9E94ACE4F3ULL,
+  0xDBFDFEA26E92BF46ULL,0x990D1F49C77889D5ULL,
+  0x172F5B3033043EBFULL,0x55DFBADB9AEE082CULL,
+  0x92CE98E760D05399ULL,0xD03E790CC93A650AULL,
+  0xAA478900B1228E31ULL,0xE8B768EB18C8B8A2ULL,
+  0x2FA64AD7E2F6E317ULL,0x6D56AB3C4B1CD584ULL,
+  0xE374EF45BF6062EEULL,0xA1840EAE168A547DULL,
+  0x66952C92ECB40FC8ULL,0x2465CD79455E395BULL,
+  0x3821458AADA7578FULL,0x7AD1A461044D611CULL,
+  0xBDC0865DFE733AA9ULL,0xFF3067B657990C3AULL,
+  0x711223CFA3E5BB50ULL,0x33E2C2240A0F8DC3ULL,
+  0xF4F3E018F031D676ULL,0xB60301F359DBE0E5ULL,
+  0xDA050215EA6C212FULL,0x98F5E3FE438617BCULL,
+  0x5FE4C1C2B9B84C09ULL,0x1D14202910527A9AULL,
+  0x93366450E42ECDF0ULL,0xD1C685BB4DC4FB63ULL,
+  0x16D7A787B7FAA0D6ULL,0x5427466C1E109645ULL,
+  0x4863CE9FF6E9F891ULL,0x0A932F745F03CE02ULL,
+  0xCD820D48A53D95B7ULL,0x8F72ECA30CD7A324ULL,
+  0x0150A8DAF8AB144EULL,0x43A04931514122DDULL,
+  0x84B16B0DAB7F7968ULL,0xC6418AE602954FFBULL,
+  0xBC387AEA7A8DA4C0ULL,0xFEC89B01D3679253ULL,
+  0x39D9B93D2959C9E6ULL,0x7B2958D680B3FF75ULL,
+  0xF50B1CAF74CF481FULL,0xB7FBFD44DD257E8CULL,
+  0x70EADF78271B2539ULL,0x321A3E938EF113AAULL,
+  0x2E5EB66066087D7EULL,0x6CAE578BCFE24BEDULL,
+  0xABBF75B735DC1058ULL,0xE94F945C9C3626CBULL,
+  0x676DD025684A91A1ULL,0x259D31CEC1A0A732ULL,
+  0xE28C13F23B9EFC87ULL,0xA07CF2199274CA14ULL,
+  0x167FF3EACBAF2AF1ULL,0x548F120162451C62ULL,
+  0x939E303D987B47D7ULL,0xD16ED1D631917144ULL,
+  0x5F4C95AFC5EDC62EULL,0x1DBC74446C07F0BDULL,
+  0xDAAD56789639AB08ULL,0x985DB7933FD39D9BULL,
+  0x84193F60D72AF34FULL,0xC6E9DE8B7EC0C5DCULL,
+  0x01F8FCB784FE9E69ULL,0x43081D5C2D14A8FAULL,
+  0xCD2A5925D9681F90ULL,0x8FDAB8CE70822903ULL,
+  0x48CB9AF28ABC72B6ULL,0x0A3B7B1923564425ULL,
+  0x70428B155B4EAF1EULL,0x32B26AFEF2A4998DULL,
+  0xF5A348C2089AC238ULL,0xB753A929A170F4ABULL,
+  0x3971ED50550C43C1ULL,0x7B810CBBFCE67552ULL,
+  0xBC902E8706D82EE7ULL,0xFE60CF6CAF321874ULL,
+  0xE224479F47CB76A0ULL,0xA0D4A674EE214033ULL,
+  0x67C58448141F1B86ULL,0x253565A3BDF52D15ULL,
+  0xAB1721DA49899A7FULL,0xE9E7C031E063ACECULL,
+  0x2EF6E20D1A5DF759ULL,0x6C0603E6B3B7C1CAULL,
+  0xF6FAE5C07D3274CDULL,0xB40A042BD4D8425EULL,
+  0x731B26172EE619EBULL,0x31EBC7FC870C2F78ULL,
+  0xBFC9838573709812ULL,0xFD39626EDA9AAE81ULL,
+  0x3A28405220A4F534ULL,0x78D8A1B9894EC3A7ULL,
+  0x649C294A61B7AD73ULL,0x266CC8A1C85D9BE0ULL,
+  0xE17DEA9D3263C055ULL,0xA38D0B769B89F6C6ULL,
+  0x2DAF4F0F6FF541ACULL,0x6F5FAEE4C61F773FULL,
+  0xA84E8CD83C212C8AULL,0xEABE6D3395CB1A19ULL,
+  0x90C79D3FEDD3F122ULL,0xD2377CD44439C7B1ULL,
+  0x15265EE8BE079C04ULL,0x57D6BF0317EDAA97ULL,
+  0xD9F4FB7AE3911DFDULL,0x9B041A914A7B2B6EULL,
+  0x5C1538ADB04570DBULL,0x1EE5D94619AF4648ULL,
+  0x02A151B5F156289CULL,0x4051B05E58BC1E0FULL,
+  0x87409262A28245BAULL,0xC5B073890B687329ULL,
+  0x4B9237F0FF14C443ULL,0x0962D61B56FEF2D0ULL,
+  0xCE73F427ACC0A965ULL,0x8C8315CC052A9FF6ULL,
+  0x3A80143F5CF17F13ULL,0x7870F5D4F51B4980ULL,
+  0xBF61D7E80F251235ULL,0xFD913603A6CF24A6ULL,
+  0x73B3727A52B393CCULL,0x31439391FB59A55FULL,
+  0xF652B1AD0167FEEAULL,0xB4A25046A88DC879ULL,
+  0xA8E6D8B54074A6ADULL,0xEA16395EE99E903EULL,
+  0x2D071B6213A0CB8BULL,0x6FF7FA89BA4AFD18ULL,
+  0xE1D5BEF04E364A72ULL,0xA3255F1BE7DC7CE1ULL,
+  0x64347D271DE22754ULL,0x26C49CCCB40811C7ULL,
+  0x5CBD6CC0CC10FAFCULL,0x1E4D8D2B65FACC6FULL,
+  0xD95CAF179FC497DAULL,0x9BAC4EFC362EA149ULL,
+  0x158E0A85C2521623ULL,0x577EEB6E6BB820B0ULL,
+  0x906FC95291867B05ULL,0xD29F28B9386C4D96ULL,
+  0xCEDBA04AD0952342ULL,0x8C2B41A1797F15D1ULL,
+  0x4B3A639D83414E64ULL,0x09CA82762AAB78F7ULL,
+  0x87E8C60FDED7CF9DULL,0xC51827E4773DF90EULL,
+  0x020905D88D03A2BBULL,0x40F9E43324E99428ULL,
+  0x2CFFE7D5975E55E2ULL,0x6E0F063E3EB46371ULL,
+  0xA91E2402C48A38C4ULL,0xEBEEC5E96D600E57ULL,
+  0x65CC8190991CB93DULL,0x273C607B30F68FAEULL,
+  0xE02D4247CAC8D41BULL,0xA2DDA3AC6322E288ULL,
+  0xBE992B5F8BDB8C5CULL,0xFC69CAB42231BACFULL,
+  0x3B78E888D80FE17AULL,0x7988096371E5D7E9ULL,
+  0xF7AA4D1A85996083ULL,0xB55AACF12C735610ULL,
+  0x724B8ECDD64D0DA5ULL,0x30BB6F267FA73B36ULL,
+  0x4AC29F2A07BFD00DULL,0x08327EC1AE55E69EULL,
+  0xCF235CFD546BBD2BULL,0x8DD3BD16FD818BB8ULL,
+  0x03F1F96F09FD3CD2ULL,0x41011884A0170A41ULL,
+  0x86103AB85A2951F4ULL,0xC4E0DB53F3C36767ULL,
+  0xD8A453A01B3A09B3ULL,0x9A54B24BB2D03F20ULL,
+  0x5D45907748EE6495ULL,0x1FB5719CE1045206ULL,
+  0x919735E51578E56CULL,0xD367D40EBC92D3FFULL,
+  0x1476F63246AC884AULL,0x568617D9EF46BED9ULL,
+  0xE085162AB69D5E3CULL,0xA275F7C11F7768AFULL,
+  0x6564D5FDE549331AULL,0x279434164CA30589ULL,
+  0xA9B6706FB8DFB2E3ULL,0xEB46918411358470ULL,
+  0x2C57B3B8EB0BDFC5ULL,0x6EA7525342E1E956ULL,
+  0x72E3DAA0AA188782ULL,0x30133B4B03F2B111ULL,
+  0xF7021977F9CCEAA4ULL,0xB5F2F89C5026DC37ULL,
+  0x3BD0BCE5A45A6B5DULL,0x79205D0E0DB05DCEULL,
+  0xBE317F32F78E067BULL,0xFCC19ED95E6430E8ULL,
+  0x86B86ED5267CDBD3ULL,0xC4488F3E8F96ED40ULL,
+  0x0359AD0275A8B6F5ULL,0x41A94CE9DC428066ULL,
+  0xCF8B0890283E370CULL,0x8D7BE97B81D4019FULL,
+  0x4A6ACB477BEA5A2AULL,0x089A2AACD2006CB9ULL,
+  0x14DEA25F3AF9026DULL,0x562E43B4931334FEULL,
+  0x913F6188692D6F4BULL,0xD3CF8063C0C759D8ULL,
+  0x5DEDC41A34BBEEB2ULL,0x1F1D25F19D51D821ULL,
+  0xD80C07CD676F8394ULL,0x9AFCE626CE85B507ULL,
+};
+
+/* crc64_slice_table[k][i] = (i * x^(64+8k)) mod P */
+static igtl_uint64 crc64_slice_table[16][256];
+
+/* x^n mod P for the folding distances used by the CLMUL variant */
+static igtl_uint64 crc64_fold_k512[2];   /* x^576, x^512 */
+static igtl_uint64 crc64_fold_k384[2];   /* x^448, x^384 */
+static igtl_uint64 crc64_fold_k256[2];   /* x^320, x^256 */
+static igtl_uint64 crc64_fold_k128[2];   /* x^192, x^128 */
+
+/* crc64_shift_table[k] = x^(8 * 2^k) mod P, used to append 2^k zero bytes
+ * to a CRC in igtl_crc64_combine() */
+static igtl_uint64 crc64_shift_table[64];
+
+static igtl_once_flag crc64_once = IGTL_ONCE_INIT;
+
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+static int crc64_has_clmul = 0;
+static int crc64_cpu_has_clmul();
+#endif
+
+typedef igtl_uint64 (*crc64_function)(const unsigned char*, igtl_uint64, igtl_uint64);
+static crc64_function crc64_impl = 0;
+static int crc64_impl_id = IGTL_CRC64_IMPL_AUTO;
+
+static int crc64_select_implementation(int impl);
+
+
+static igtl_uint64 crc64_xpow_mod(int n)
+{
+  igtl_uint64 r = 1ULL;
+  int i;
+
+  for (i = 0; i < n; i ++)
+    {
+    r = (r & 0x8000000000000000ULL) ? ((r << 1) ^ IGTL_CRC64_POLY) : (r << 1);
+    }
+  return r;
+}
+
+
+/* (a * b) mod P */
+static igtl_uint64 crc64_mul_mod(igtl_uint64 a, igtl_uint64 b)
+{
+  igtl_uint64 r = 0;
+  int i;
+
+  for (i = 63; i >= 0; i --)
+    {
+    r = (r & 0x8000000000000000ULL) ? ((r << 1) ^ IGTL_CRC64_POLY) : (r << 1);
+    if ((b >> i) & 1)
+      {
+      r ^= a;
+      }
+    }
+  return r;
+}
+
+
+/* Called once through crc64_initialize() */
+static void crc64_init(void)
+{
+  int i;
+  int k;
+
+  for (i = 0; i < 256; i ++)
+    {
+    crc64_slice_table[0][i] = crc64_table[i];
+    }
+  for (k = 1; k < 16; k ++)
+    {
+    for (i = 0; i < 256; i ++)
+      {
+      igtl_uint64 prev = crc64_slice_table[k-1][i];
+      crc64_slice_table[k][i] = (prev << 8) ^ crc64_table[prev >> 56];
+      }
+    }
+
+  crc64_fold_k512[0] = crc64_xpow_mod(576);
+  crc64_fold_k512[1] = crc64_xpow_mod(512);
+  crc64_fold_k384[0] = crc64_xpow_mod(448);
+  crc64_fold_k384[1] = crc64_xpow_mod(384);
+  crc64_fold_k256[0] = crc64_xpow_mod(320);
+  crc64_fold_k256[1] = crc64_xpow_mod(256);
+  crc64_fold_k128[0] = crc64_xpow_mod(192);
+  crc64_fold_k128[1] = crc64_xpow_mod(128);
+
+  crc64_shift_table[0] = crc64_xpow_mod(8);
+  for (k = 1; k < 64; k ++)
+    {
+    crc64_shift_table[k] = crc64_mul_mod(crc64_shift_table[k-1], crc64_shift_table[k-1]);
+    }
+
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+  /* CPUID can be expensive (e.g. trapped by a hypervisor); query it once */
+  crc64_has_clmul = crc64_cpu_has_clmul();
+#endif
+  crc64_select_implementation(IGTL_CRC64_IMPL_AUTO);
+}
+
+
+static void crc64_initialize()
+{
+  igtl_call_once(&crc64_once, crc64_init);
+}
+
+
+static igtl_uint64 crc64_load_be64(const unsigned char* p)
+{
+  return ((igtl_uint64)p[0] << 56) | ((igtl_uint64)p[1] << 48)
+    | ((igtl_uint64)p[2] << 40) | ((igtl_uint64)p[3] << 32)
+    | ((igtl_uint64)p[4] << 24) | ((igtl_uint64)p[5] << 16)
+    | ((igtl_uint64)p[6] << 8)  | ((igtl_uint64)p[7]);
+}
+
+
+igtl_uint64 igtl_export igtl_crc64_bytewise(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc)
+{
+  while (len > 0)
+    {
+    crc = crc64_table[*data ^ (unsigned char)(crc >> 56)] ^ (crc << 8);
+    data++;
+    len--;
+    }
+  return crc;
+}
+
+
+igtl_uint64 igtl_export igtl_crc64_slice8(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc)
+{
+  igtl_uint64 (*t)[256];
+
+  crc64_initialize();
+  t = crc64_slice_table;
+
+  while (len >= 8)
+    {
+    igtl_uint64 v = crc ^ crc64_load_be64(data);
+    crc = t[7][(v >> 56) & 0xFF] ^ t[6][(v >> 48) & 0xFF]
+      ^ t[5][(v >> 40) & 0xFF] ^ t[4][(v >> 32) & 0xFF]
+      ^ t[3][(v >> 24) & 0xFF] ^ t[2][(v >> 16) & 0xFF]
+      ^ t[1][(v >> 8) & 0xFF]  ^ t[0][v & 0xFF];
+    data += 8;
+    len  -= 8;
+    }
+
+  return igtl_crc64_bytewise(data, len, crc);
+}
+
+
+igtl_uint64 igtl_export igtl_crc64_slice16(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc)
+{
+  igtl_uint64 (*t)[256];
+
+  crc64_initialize();
+  t = crc64_slice_table;
+
+  while (len >= 16)
+    {
+    igtl_uint64 v1 = crc ^ crc64_load_be64(data);
+    igtl_uint64 v2 = crc64_load_be64(data + 8);
+    crc = t[15][(v1 >> 56) & 0xFF] ^ t[14][(v1 >> 48) & 0xFF]
+      ^ t[13][(v1 >> 40) & 0xFF] ^ t[12][(v1 >> 32) & 0xFF]
+      ^ t[11][(v1 >> 24) & 0xFF] ^ t[10][(v1 >> 16) & 0xFF]
+      ^ t[9][(v1 >> 8) & 0xFF]   ^ t[8][v1 & 0xFF]
+      ^ t[7][(v2 >> 56) & 0xFF]  ^ t[6][(v2 >> 48) & 0xFF]
+      ^ t[5][(v2 >> 40) & 0xFF]  ^ t[4][(v2 >> 32) & 0xFF]
+      ^ t[3][(v2 >> 24) & 0xFF]  ^ t[2][(v2 >> 16) & 0xFF]
+      ^ t[1][(v2 >> 8) & 0xFF]   ^ t[0][v2 & 0xFF];
+    data += 16;
+    len  -= 16;
+    }
+
+  return igtl_crc64_slice8(data, len, crc);
+}
+
+
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define IGTL_CRC64_TARGET_CLMUL
+#else
+#  include <cpuid.h>
+#  define IGTL_CRC64_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#endif
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+/*
+ * The message is treated as a polynomial with the first byte at the
+ * highest degree, so each 16-byte block is byte-reversed into a 128-bit
+ * register. A 128-bit accumulator X = X_hi * x^64 + X_lo is moved forward by
+ * d bits as X_hi * (x^(d+64) mod P) ^ X_lo * (x^d mod P), which is congruent
+ * to X * x^d modulo P and fits in 128 bits again. The final 128-bit remainder
+ * is reduced by running it through the table-driven CRC, which computes
+ * (X * x^64) mod P for a zero initial value.
+ */
+IGTL_CRC64_TARGET_CLMUL
+static __m128i crc64_clmul_fold(__m128i x, __m128i k)
+{
+  return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11),
+                       _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+
+IGTL_CRC64_TARGET_CLMUL
+static igtl_uint64 crc64_clmul_impl(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc)
+{
+  __m128i bswap;
+  __m128i k;
+  __m128i x0, x1, x2, x3;
+  unsigned char rem[16];
+  int i;
+
+  if (len < 64)
+    {
+    return igtl_crc64_slice16(data, len, crc);
+    }
+
+  crc64_initialize();
+  bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data)), bswap);
+  x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), bswap);
+  x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), bswap);
+  x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), bswap);
+  x0 = _mm_xor_si128(x0, _mm_set_epi64x((long long)crc, 0));
+  data += 64;
+  len  -= 64;
+
+  /* Four independent accumulators, each folded across 512 bits */
+  k = _mm_set_epi64x((long long)crc64_fold_k512[0], (long long)crc64_fold_k512[1]);
+  while (len >= 64)
+    {
+    x0 = _mm_xor_si128(crc64_clmul_fold(x0, k),
+                       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data)), bswap));
+    x1 = _mm_xor_si128(crc64_clmul_fold(x1, k),
+                       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), bswap));
+    x2 = _mm_xor_si128(crc64_clmul_fold(x2, k),
+                       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), bswap));
+    x3 = _mm_xor_si128(crc64_clmul_fold(x3, k),
+                       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), bswap));
+    data += 64;
+    len  -= 64;
+    }
+
+  /* Merge the accumulators into x3 */
+  k  = _mm_set_epi64x((long long)crc64_fold_k384[0], (long long)crc64_fold_k384[1]);
+  x3 = _mm_xor_si128(x3, crc64_clmul_fold(x0, k));
+  k  = _mm_set_epi64x((long long)crc64_fold_k256[0], (long long)crc64_fold_k256[1]);
+  x3 = _mm_xor_si128(x3, crc64_clmul_fold(x1, k));
+  k  = _mm_set_epi64x((long long)crc64_fold_k128[0], (long long)crc64_fold_k128[1]);
+  x3 = _mm_xor_si128(x3, crc64_clmul_fold(x2, k));
+
+  /* Remaining whole 16-byte blocks */
+  while (len >= 16)
+    {
+    x3 = _mm_xor_si128(crc64_clmul_fold(x3, k),
+                       _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data)), bswap));
+    data += 16;
+    len  -= 16;
+    }
+
+  /* Reduce the 128-bit remainder and process the tail */
+  _mm_storeu_si128((__m128i*)rem, _mm_shuffle_epi8(x3, bswap));
+  crc = 0;
+  for (i = 0; i < 16; i += 8)
+    {
+    crc = igtl_crc64_slice8(&rem[i], 8, crc);
+    }
+
+  return igtl_crc64_slice16(data, len, crc);
+}
+
+
+static int crc64_cpu_has_clmul()
+{
+  unsigned int ecx = 0;
+
+#if defined(_MSC_VER)
+    {
+    int info[4];
+    __cpuid(info, 1);
+    ecx = (unsigned int)info[2];
+    }
+#else
+    {
+    unsigned int eax, ebx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      {
+      ecx = 0;
+      }
+    }
+#endif
+  /* ECX bit 1: PCLMULQDQ, bit 9: SSSE3 */
+  return ((ecx & (1U << 1)) && (ecx & (1U << 9))) ? 1 : 0;
+}
+
+#endif /* OpenIGTLink_HAVE_PCLMUL */
+
+
+int igtl_export igtl_crc64_clmul_supported()
+{
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+  crc64_initialize();
+  return crc64_has_clmul;
+#else
+  return 0;
+#endif
+}
+
+
+igtl_uint64 igtl_export igtl_crc64_clmul(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc)
+{
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+  if (igtl_crc64_clmul_supported())
+    {
+    return crc64_clmul_impl(data, len, crc);
+    }
+#endif
+  return igtl_crc64_slice16(data, len, crc);
+}
+
+
+/* Called by crc64_init() and igtl_crc64_set_implementation() */
+static int crc64_select_implementation(int impl)
+{
+  int has_clmul = 0;
+
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+  has_clmul = crc64_has_clmul;
+#endif
+  if (impl == IGTL_CRC64_IMPL_AUTO)
+    {
+    impl = has_clmul ? IGTL_CRC64_IMPL_CLMUL : IGTL_CRC64_IMPL_SLICE16;
+    }
+  else if (impl == IGTL_CRC64_IMPL_CLMUL && !has_clmul)
+    {
+    impl = IGTL_CRC64_IMPL_SLICE16;
+    }
+
+  switch (impl)
+    {
+    case IGTL_CRC64_IMPL_BYTEWISE:
+      crc64_impl = igtl_crc64_bytewise;
+      break;
+    case IGTL_CRC64_IMPL_SLICE8:
+      crc64_impl = igtl_crc64_slice8;
+      break;
+#if defined(OpenIGTLink_HAVE_PCLMUL)
+    case IGTL_CRC64_IMPL_CLMUL:
+      crc64_impl = crc64_clmul_impl;
+      break;
+#endif
+    default:
+      impl = IGTL_CRC64_IMPL_SLICE16;
+      crc64_impl = igtl_crc64_slice16;
+      break;
+    }
+
+  crc64_impl_id = impl;
+  return impl;
+}
+
+
+int igtl_export igtl_crc64_set_implementation(int impl)
+{
+  crc64_initialize();
+  return crc64_select_implementation(impl);
+}
+
+
+int igtl_export igtl_crc64_get_implementation()
+{
+  crc64_initialize();
+  return crc64_impl_id;
+}
+
+
 igtl_uint64 igtl_export crc64(unsigned char *data,  igtl_uint64 len, igtl_uint64 crc)
 {
+  crc64_initialize();
+  return crc64_impl(data, len, crc);
+}
 
-    static const igtl_uint64 table[256] = {
-    0x0000000000000000ULL,0x42F0E1EBA9EA3693ULL,
-    0x85E1C3D753D46D26ULL,0xC711223CFA3E5BB5ULL,
-    0x493366450E42ECDFULL,0x0BC387AEA7A8DA4CULL,
-    0xCCD2A5925D9681F9ULL,0x8E224479F47CB76AULL,
-    0x9266CC8A1C85D9BEULL,0xD0962D61B56FEF2DULL,
-    0x17870F5D4F51B498ULL,0x5577EEB6E6BB820BULL,
-    0xDB55AACF12C73561ULL,0x99A54B24BB2D03F2ULL,
-    0x5EB4691841135847ULL,0x1C4488F3E8F96ED4ULL,
-    0x663D78FF90E185EFULL,0x24CD9914390BB37CULL,
-    0xE3DCBB28C335E8C9ULL,0xA12C5AC36ADFDE5AULL,
-    0x2F0E1EBA9EA36930ULL,0x6DFEFF5137495FA3ULL,
-    0xAAEFDD6DCD770416ULL,0xE81F3C86649D3285ULL,
-    0xF45BB4758C645C51ULL,0xB6AB559E258E6AC2ULL,
-    0x71BA77A2DFB03177ULL,0x334A9649765A07E4ULL,
-    0xBD68D2308226B08EULL,0xFF9833DB2BCC861DULL,
-    0x388911E7D1F2DDA8ULL,0x7A79F00C7818EB3BULL,
-    0xCC7AF1FF21C30BDEULL,0x8E8A101488293D4DULL,
-    0x499B3228721766F8ULL,0x0B6BD3C3DBFD506BULL,
-    0x854997BA2F81E701ULL,0xC7B97651866BD192ULL,
-    0x00A8546D7C558A27ULL,0x4258B586D5BFBCB4ULL,
-    0x5E1C3D753D46D260ULL,0x1CECDC9E94ACE4F3ULL,
-    0xDBFDFEA26E92BF46ULL,0x990D1F49C77889D5ULL,
-    0x172F5B3033043EBFULL,0x55DFBADB9AEE082CULL,
-    0x92CE98E760D05399ULL,0xD03E790CC93A650AULL,
-    0xAA478900B1228E31ULL,0xE8B768EB18C8B8A2ULL,
-    0x2FA64AD7E2F6E317ULL,0x6D56AB3C4B1CD584ULL,
-    0xE374EF45BF6062EEULL,0xA1840EAE168A547DULL,
-    0x66952C92ECB40FC8ULL,0x2465CD79455E395BULL,
-    0x3821458AADA7578FULL,0x7AD1A461044D611CULL,
-    0xBDC0865DFE733AA9ULL,0xFF3067B657990C3AULL,
-    0x711223CFA3E5BB50ULL,0x33E2C2240A0F8DC3ULL,
-    0xF4F3E018F031D676ULL,0xB60301F359DBE0E5ULL,
-    0xDA050215EA6C212FULL,0x98F5E3FE438617BCULL,
-    0x5FE4C1C2B9B84C09ULL,0x1D14202910527A9AULL,
-    0x93366450E42ECDF0ULL,0xD1C685BB4DC4FB63ULL,
-    0x16D7A787B7FAA0D6ULL,0x5427466C1E109645ULL,
-    0x4863CE9FF6E9F891ULL,0x0A932F745F03CE02ULL,
-    0xCD820D48A53D95B7ULL,0x8F72ECA30CD7A324ULL,
-    0x0150A8DAF8AB144EULL,0x43A04931514122DDULL,
-    0x84B16B0DAB7F7968ULL,0xC6418AE602954FFBULL,
-    0xBC387AEA7A8DA4C0ULL,0xFEC89B01D3679253ULL,
-    0x39D9B93D2959C9E6ULL,0x7B2958D680B3FF75ULL,
-    0xF50B1CAF74CF481FULL,0xB7FBFD44DD257E8CULL,
-    0x70EADF78271B2539ULL,0x321A3E938EF113AAULL,
-    0x2E5EB66066087D7EULL,0x6CAE578BCFE24BEDULL,
-    0xABBF75B735DC1058ULL,0xE94F945C9C3626CBULL,
-    0x676DD025684A91A1ULL,0x259D31CEC1A0A732ULL,
-    0xE28C13F23B9EFC87ULL,0xA07CF2199274CA14ULL,
-    0x167FF3EACBAF2AF1ULL,0x548F120162451C62ULL,
-    0x939E303D987B47D7ULL,0xD16ED1D631917144ULL,
-    0x5F4C95AFC5EDC62EULL,0x1DBC74446C07F0BDULL,
-    0xDAAD56789639AB08ULL,0x985DB7933FD39D9BULL,
-    0x84193F60D72AF34FULL,0xC6E9DE8B7EC0C5DCULL,
-    0x01F8FCB784FE9E69ULL,0x43081D5C2D14A8FAULL,
-    0xCD2A5925D9681F90ULL,0x8FDAB8CE70822903ULL,
-    0x48CB9AF28ABC72B6ULL,0x0A3B7B1923564425ULL,
-    0x70428B155B4EAF1EULL,0x32B26AFEF2A4998DULL,
-    0xF5A348C2089AC238ULL,0xB753A929A170F4ABULL,
-    0x3971ED50550C43C1ULL,0x7B810CBBFCE67552ULL,
-    0xBC902E8706D82EE7ULL,0xFE60CF6CAF321874ULL,
-    0xE224479F47CB76A0ULL,0xA0D4A674EE214033ULL,
-    0x67C58448141F1B86ULL,0x253565A3BDF52D15ULL,
-    0xAB1721DA49899A7FULL,0xE9E7C031E063ACECULL,
-    0x2EF6E20D1A5DF759ULL,0x6C0603E6B3B7C1CAULL,
-    0xF6FAE5C07D3274CDULL,0xB40A042BD4D8425EULL,
-    0x731B26172EE619EBULL,0x31EBC7FC870C2F78ULL,
-    0xBFC9838573709812ULL,0xFD39626EDA9AAE81ULL,
-    0x3A28405220A4F534ULL,0x78D8A1B9894EC3A7ULL,
-    0x649C294A61B7AD73ULL,0x266CC8A1C85D9BE0ULL,
-    0xE17DEA9D3263C055ULL,0xA38D0B769B89F6C6ULL,
-    0x2DAF4F0F6FF541ACULL,0x6F5FAEE4C61F773FULL,
-    0xA84E8CD83C212C8AULL,0xEABE6D3395CB1A19ULL,
-    0x90C79D3FEDD3F122ULL,0xD2377CD44439C7B1ULL,
-    0x15265EE8BE079C04ULL,0x57D6BF0317EDAA97ULL,
-    0xD9F4FB7AE3911DFDULL,0x9B041A914A7B2B6EULL,
-    0x5C1538ADB04570DBULL,0x1EE5D94619AF4648ULL,
-    0x02A151B5F156289CULL,0x4051B05E58BC1E0FULL,
-    0x87409262A28245BAULL,0xC5B073890B687329ULL,
-    0x4B9237F0FF14C443ULL,0x0962D61B56FEF2D0ULL,
-    0xCE73F427ACC0A965ULL,0x8C8315CC052A9FF6ULL,
-    0x3A80143F5CF17F13ULL,0x7870F5D4F51B4980ULL,
-    0xBF61D7E80F251235ULL,0xFD913603A6CF24A6ULL,
-    0x73B3727A52B393CCULL,0x31439391FB59A55FULL,
-    0xF652B1AD0167FEEAULL,0xB4A25046A88DC879ULL,
-    0xA8E6D8B54074A6ADULL,0xEA16395EE99E903EULL,
-    0x2D071B6213A0CB8BULL,0x6FF7FA89BA4AFD18ULL,
-    0xE1D5BEF04E364A72ULL,0xA3255F1BE7DC7CE1ULL,
-    0x64347D271DE22754ULL,0x26C49CCCB40811C7ULL,
-    0x5CBD6CC0CC10FAFCULL,0x1E4D8D2B65FACC6FULL,
-    0xD95CAF179FC497DAULL,0x9BAC4EFC362EA149ULL,
-    0x158E0A85C2521623ULL,0x577EEB6E6BB820B0ULL,
-    0x906FC95291867B05ULL,0xD29F28B9386C4D96ULL,
-    0xCEDBA04AD0952342ULL,0x8C2B41A1797F15D1ULL,
-    0x4B3A639D83414E64ULL,0x09CA82762AAB78F7ULL,
-    0x87E8C60FDED7CF9DULL,0xC51827E4773DF90EULL,
-    0x020905D88D03A2BBULL,0x40F9E43324E99428ULL,
-    0x2CFFE7D5975E55E2ULL,0x6E0F063E3EB46371ULL,
-    0xA91E2402C48A38C4ULL,0xEBEEC5E96D600E57ULL,
-    0x65CC8190991CB93DULL,0x273C607B30F68FAEULL,
-    0xE02D4247CAC8D41BULL,0xA2DDA3AC6322E288ULL,
-    0xBE992B5F8BDB8C5CULL,0xFC69CAB42231BACFULL,
-    0x3B78E888D80FE17AULL,0x7988096371E5D7E9ULL,
-    0xF7AA4D1A85996083ULL,0xB55AACF12C735610ULL,
-    0x724B8ECDD64D0DA5ULL,0x30BB6F267FA73B36ULL,
-    0x4AC29F2A07BFD00DULL,0x08327EC1AE55E69EULL,
-    0xCF235CFD546BBD2BULL,0x8DD3BD16FD818BB8ULL,
-    0x03F1F96F09FD3CD2ULL,0x41011884A0170A41ULL,
-    0x86103AB85A2951F4ULL,0xC4E0DB53F3C36767ULL,
-    0xD8A453A01B3A09B3ULL,0x9A54B24BB2D03F20ULL,
-    0x5D45907748EE6495ULL,0x1FB5719CE1045206ULL,
-    0x919735E51578E56CULL,0xD367D40EBC92D3FFULL,
-    0x1476F63246AC884AULL,0x568617D9EF46BED9ULL,
-    0xE085162AB69D5E3CULL,0xA275F7C11F7768AFULL,
-    0x6564D5FDE549331AULL,0x279434164CA30589ULL,
-    0xA9B6706FB8DFB2E3ULL,0xEB46918411358470ULL,
-    0x2C57B3B8EB0BDFC5ULL,0x6EA7525342E1E956ULL,
-    0x72E3DAA0AA188782ULL,0x30133B4B03F2B111ULL,
-    0xF7021977F9CCEAA4ULL,0xB5F2F89C5026DC37ULL,
-    0x3BD0BCE5A45A6B5DULL,0x79205D0E0DB05DCEULL,
-    0xBE317F32F78E067BULL,0xFCC19ED95E6430E8ULL,
-    0x86B86ED5267CDBD3ULL,0xC4488F3E8F96ED40ULL,
-    0x0359AD0275A8B6F5ULL,0x41A94CE9DC428066ULL,
-    0xCF8B0890283E370CULL,0x8D7BE97B81D4019FULL,
-    0x4A6ACB477BEA5A2AULL,0x089A2AACD2006CB9ULL,
-    0x14DEA25F3AF9026DULL,0x562E43B4931334FEULL,
-    0x913F6188692D6F4BULL,0xD3CF8063C0C759D8ULL,
-    0x5DEDC41A34BBEEB2ULL,0x1F1D25F19D51D821ULL,
-    0xD80C07CD676F8394ULL,0x9AFCE626CE85B507ULL,
-    };
-  
-    while (len > 0)
+
+igtl_uint64 igtl_export igtl_crc64_combine(igtl_uint64 crc1, igtl_uint64 crc2, igtl_uint64 len2)
+{
+  int k;
+
+  crc64_initialize();
+
+  /* The CRC is linear and has no final XOR, so CRC(A||B) is CRC(A) followed
+   * by len(B) zero bytes, XORed with CRC(B). */
+  for (k = 0; len2 > 0; k ++, len2 >>= 1)
+    {
+    if (len2 & 1)
+      {
+      crc1 = crc64_mul_mod(crc1, crc64_shift_table[k]);
+      }
+    }
+  return crc1 ^ crc2;
+}
+
+
+/*
+ * Byte order conversion with copy. igtl_convert_byte_order_copy() dispatches
+ * to one of the following variants, all of which produce identical results:
+ *   - scalar : one element per step. Elements are accessed with memcpy(), as
+ *              the fields of the (packed) message structures are not
+ *              necessarily aligned.
+ *   - ssse3  : 16 bytes per PSHUFB, 64 bytes per iteration.
+ *   - avx2   : 32 bytes per VPSHUFB, 128 bytes per iteration.
+ * The SIMD variants are only available when the compiler supports them
+ * (OpenIGTLink_HAVE_SSSE3 / OpenIGTLink_HAVE_AVX2) and the CPU reports the
+ * feature. All variants convert from the lowest address upwards, and each
+ * element or SIMD block is loaded before it is stored. Therefore 'dst' and
+ * 'src' may be equal, or 'dst' may precede 'src' in an overlapping area (as
+ * for the in-place conversion of received data); 'dst' must not follow 'src'
+ * in an overlapping area.
+ */
+
+/* Number of bytes converted before the CRC is updated in
+ * igtl_convert_byte_order_copy_crc64(). Small enough for the converted block
+ * to stay in the L1/L2 cache until the CRC has been computed. */
+#define IGTL_CONVERT_CRC64_BLOCK_SIZE 8192
+
+/* Conversions shorter than this (e.g. single header fields) are done by the
+ * scalar loop directly. */
+#define IGTL_BYTE_ORDER_SIMD_MIN_SIZE 16
+
+typedef void (*igtl_byte_order_copy_function)(unsigned char * dst, const unsigned char * src,
+                                              igtl_uint64 count, int element_size);
+
+static igtl_once_flag byte_order_once = IGTL_ONCE_INIT;
+static int byte_order_best_impl = IGTL_BYTE_ORDER_IMPL_SCALAR;
+static igtl_byte_order_copy_function byte_order_copy_impl = 0;
+static int byte_order_impl_id = IGTL_BYTE_ORDER_IMPL_SCALAR;
+
+
+static void byte_order_copy_scalar(unsigned char * dst, const unsigned char * src,
+                                   igtl_uint64 count, int element_size)
+{
+  igtl_uint16 v16;
+  igtl_uint32 v32;
+  igtl_uint64 v64;
+  igtl_uint64 i;
+
+  if (element_size == 2)
+    {
+    for (i = 0; i < count; i ++)
+      {
+      memcpy(&v16, src + 2 * i, 2);
+      v16 = BYTE_SWAP_INT16(v16);
+      memcpy(dst + 2 * i, &v16, 2);
+      }
+    }
+  else if (element_size == 4)
     {
-        crc = table[*data ^ (unsigned char)(crc >> 56)] ^ (crc << 8);
-        data++;
-        len--;
+    for (i = 0; i < count; i ++)
+      {
+      memcpy(&v32, src + 4 * i, 4);
+      v32 = BYTE_SWAP_INT32(v32);
+      memcpy(dst + 4 * i, &v32, 4);
+      }
     }
+  else if (element_size == 8)
+    {
+    for (i = 0; i < count; i ++)
+      {
+      memcpy(&v64, src + 8 * i, 8);
+      v64 = BYTE_SWAP_INT64(v64);
+      memcpy(dst + 8 * i, &v64, 8);
+      }
+    }
+}
+
+
+#if defined(OpenIGTLink_HAVE_SSSE3)
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  define IGTL_BYTE_ORDER_TARGET_SSSE3
+#  define IGTL_BYTE_ORDER_TARGET_AVX2
+#else
+#  include <cpuid.h>
+#  define IGTL_BYTE_ORDER_TARGET_SSSE3 __attribute__((target("ssse3")))
+#  define IGTL_BYTE_ORDER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(OpenIGTLink_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+
+/* PSHUFB mask reversing the bytes of each element in a 16-byte block */
+IGTL_BYTE_ORDER_TARGET_SSSE3
+static __m128i byte_order_shuffle_mask(int element_size)
+{
+  if (element_size == 2)
+    {
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    }
+  else if (element_size == 4)
+    {
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+  return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+}
+
+
+IGTL_BYTE_ORDER_TARGET_SSSE3
+static void byte_order_copy_ssse3(unsigned char * dst, const unsigned char * src,
+                                  igtl_uint64 count, int element_size)
+{
+  igtl_uint64 nbytes = count * element_size;
+  igtl_uint64 i = 0;
+  __m128i mask = byte_order_shuffle_mask(element_size);
+  __m128i x0, x1, x2, x3;
+
+  for (; i + 64 <= nbytes; i += 64)
+    {
+    x0 = _mm_loadu_si128((const __m128i *)(src + i));
+    x1 = _mm_loadu_si128((const __m128i *)(src + i + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(src + i + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(src + i + 48));
+    _mm_storeu_si128((__m128i *)(dst + i),      _mm_shuffle_epi8(x0, mask));
+    _mm_storeu_si128((__m128i *)(dst + i + 16), _mm_shuffle_epi8(x1, mask));
+    _mm_storeu_si128((__m128i *)(dst + i + 32), _mm_shuffle_epi8(x2, mask));
+    _mm_storeu_si128((__m128i *)(dst + i + 48), _mm_shuffle_epi8(x3, mask));
+    }
+  for (; i + 16 <= nbytes; i += 16)
+    {
+    x0 = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(x0, mask));
+    }
+
+  byte_order_copy_scalar(dst + i, src + i, (nbytes - i) / element_size, element_size);
+}
+
+
+#if defined(OpenIGTLink_HAVE_AVX2)
+
+IGTL_BYTE_ORDER_TARGET_AVX2
+static void byte_order_copy_avx2(unsigned char * dst, const unsigned char * src,
+                                 igtl_uint64 count, int element_size)
+{
+  igtl_uint64 nbytes = count * element_size;
+  igtl_uint64 i = 0;
+  /* VPSHUFB shuffles within each 128-bit lane, so the same mask is used twice */
+  __m256i mask = _mm256_broadcastsi128_si256(byte_order_shuffle_mask(element_size));
+  __m256i y0, y1, y2, y3;
+
+  for (; i + 128 <= nbytes; i += 128)
+    {
+    y0 = _mm256_loadu_si256((const __m256i *)(src + i));
+    y1 = _mm256_loadu_si256((const __m256i *)(src + i + 32));
+    y2 = _mm256_loadu_si256((const __m256i *)(src + i + 64));
+    y3 = _mm256_loadu_si256((const __m256i *)(src + i + 96));
+    _mm256_storeu_si256((__m256i *)(dst + i),      _mm256_shuffle_epi8(y0, mask));
+    _mm256_storeu_si256((__m256i *)(dst + i + 32), _mm256_shuffle_epi8(y1, mask));
+    _mm256_storeu_si256((__m256i *)(dst + i + 64), _mm256_shuffle_epi8(y2, mask));
+    _mm256_storeu_si256((__m256i *)(dst + i + 96), _mm256_shuffle_epi8(y3, mask));
+    }
+  for (; i + 32 <= nbytes; i += 32)
+    {
+    y0 = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(y0, mask));
+    }
+
+  /* Clear the upper halves of the YMM registers before running non-VEX SSE
+   * code, which would otherwise pay an AVX-SSE transition penalty. */
+  _mm256_zeroupper();
+  byte_order_copy_ssse3(dst + i, src + i, (nbytes - i) / element_size, element_size);
+}
+
+#endif /* OpenIGTLink_HAVE_AVX2 */
+
+
+static void byte_order_cpuid(unsigned int leaf, unsigned int * ebx, unsigned int * ecx)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, (int) leaf, 0);
+  *ebx = (unsigned int) info[1];
+  *ecx = (unsigned int) info[2];
+#else
+  unsigned int eax, edx;
+  if ((unsigned int) __get_cpuid_max(0, 0) < leaf)
+    {
+    *ebx = 0;
+    *ecx = 0;
+    return;
+    }
+  __cpuid_count(leaf, 0, eax, *ebx, *ecx, edx);
+#endif
+}
+
+
+/* Returns the fastest IGTL_BYTE_ORDER_IMPL_* supported by the CPU */
+static int byte_order_cpu_best_impl()
+{
+  int best = IGTL_BYTE_ORDER_IMPL_SCALAR;
+  unsigned int ebx = 0;
+  unsigned int ecx = 0;
+#if defined(OpenIGTLink_HAVE_AVX2)
+  unsigned int xcr0 = 0;
+#endif
+
+  byte_order_cpuid(1, &ebx, &ecx);
+  /* ECX bit 9: SSSE3 */
+  if (ecx & (1U << 9))
+    {
+    best = IGTL_BYTE_ORDER_IMPL_SSSE3;
+    }
+#if defined(OpenIGTLink_HAVE_AVX2)
+  /* ECX bit 27: OSXSAVE, bit 28: AVX. The OS must also save the YMM
+   * registers (XCR0 bits 1 and 2). */
+  if ((ecx & (1U << 27)) && (ecx & (1U << 28)))
+    {
+#if defined(_MSC_VER)
+    xcr0 = (unsigned int) _xgetbv(0);
+#else
+      {
+      unsigned int edx;
+      __asm__ __volatile__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+      }
+#endif
+    if ((xcr0 & 6) == 6)
+      {
+      byte_order_cpuid(7, &ebx, &ecx);
+      /* EBX bit 5: AVX2 */
+      if (ebx & (1U << 5))
+        {
+        best = IGTL_BYTE_ORDER_IMPL_AVX2;
+        }
+      }
+    }
+#endif
+  return best;
+}
+
+#endif /* OpenIGTLink_HAVE_SSSE3 */
+
+
+static int byte_order_select_implementation(int impl)
+{
+  if (impl == IGTL_BYTE_ORDER_IMPL_AUTO || impl > byte_order_best_impl)
+    {
+    impl = byte_order_best_impl;
+    }
+
+  switch (impl)
+    {
+#if defined(OpenIGTLink_HAVE_SSSE3)
+    case IGTL_BYTE_ORDER_IMPL_SSSE3:
+      byte_order_copy_impl = byte_order_copy_ssse3;
+      break;
+#if defined(OpenIGTLink_HAVE_AVX2)
+    case IGTL_BYTE_ORDER_IMPL_AVX2:
+      byte_order_copy_impl = byte_order_copy_avx2;
+      break;
+#endif
+#endif
+    default:
+      impl = IGTL_BYTE_ORDER_IMPL_SCALAR;
+      byte_order_copy_impl = byte_order_copy_scalar;
+      break;
+    }
+
+  byte_order_impl_id = impl;
+  return impl;
+}
+
+
+/* Called once through byte_order_initialize() */
+static void byte_order_init(void)
+{
+#if defined(OpenIGTLink_HAVE_SSSE3)
+  /* CPUID can be expensive (e.g. trapped by a hypervisor); query it once */
+  byte_order_best_impl = byte_order_cpu_best_impl();
+#endif
+  byte_order_select_implementation(IGTL_BYTE_ORDER_IMPL_AUTO);
+}
+
+
+static void byte_order_initialize()
+{
+  igtl_call_once(&byte_order_once, byte_order_init);
+}
+
+
+int igtl_export igtl_convert_byte_order_set_implementation(int impl)
+{
+  byte_order_initialize();
+  return byte_order_select_implementation(impl);
+}
+
+
+int igtl_export igtl_convert_byte_order_get_implementation()
+{
+  byte_order_initialize();
+  return byte_order_impl_id;
+}
+
+
+void igtl_export igtl_convert_byte_order_copy(void * dst, const void * src, igtl_uint64 count, int element_size)
+{
+  if (count == 0)
+    {
+    return;
+    }
+
+  if (element_size == 1 || !igtl_is_little_endian())
+    {
+    if (dst != src)
+      {
+      memmove(dst, src, (size_t)(count * element_size));
+      }
+    }
+  else if (count * element_size < IGTL_BYTE_ORDER_SIMD_MIN_SIZE)
+    {
+    byte_order_copy_scalar((unsigned char *) dst, (const unsigned char *) src, count, element_size);
+    }
+  else
+    {
+    byte_order_initialize();
+    byte_order_copy_impl((unsigned char *) dst, (const unsigned char *) src, count, element_size);
+    }
+}
+
+
+void igtl_export igtl_convert_byte_order(void * data, igtl_uint64 count, int element_size)
+{
+  igtl_convert_byte_order_copy(data, data, count, element_size);
+}
+
+
+igtl_uint64 igtl_export igtl_convert_byte_order_copy_crc64(void * dst, const void * src, igtl_uint64 count,
+                                                           int element_size, igtl_uint64 crc)
+{
+  unsigned char * ptr_dst;
+  const unsigned char * ptr_src;
+  igtl_uint64 block;
+  igtl_uint64 n;
+
+  if (element_size <= 0)
+    {
     return crc;
+    }
+
+  ptr_dst = (unsigned char *) dst;
+  ptr_src = (const unsigned char *) src;
+  block = IGTL_CONVERT_CRC64_BLOCK_SIZE / element_size;
+
+  while (count > 0)
+    {
+    n = (count < block) ? count : block;
+    igtl_convert_byte_order_copy(ptr_dst, ptr_src, n, element_size);
+    crc = crc64(ptr_dst, n * element_size, crc);
+    ptr_dst += n * element_size;
+    ptr_src += n * element_size;
+    count -= n;
+    }
+
+  return crc;
 }
 
 
@@ -49,6 +49,73 @@ extern "C" {
 int igtl_export igtl_is_little_endian();
 igtl_uint64 igtl_export crc64(unsigned char *data, igtl_uint64 len, igtl_uint64 crc);
 
+/** CRC-64 implementations. crc64() dispatches to the fastest variant
+ *  supported by the host CPU unless another one is selected with
+ *  igtl_crc64_set_implementation(). All variants return identical values. */
+#define IGTL_CRC64_IMPL_AUTO      0
+#define IGTL_CRC64_IMPL_BYTEWISE  1
+#define IGTL_CRC64_IMPL_SLICE8    2
+#define IGTL_CRC64_IMPL_SLICE16   3
+#define IGTL_CRC64_IMPL_CLMUL     4
+
+igtl_uint64 igtl_export igtl_crc64_bytewise(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc);
+igtl_uint64 igtl_export igtl_crc64_slice8(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc);
+igtl_uint64 igtl_export igtl_crc64_slice16(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc);
+
+/** Carry-less multiply (PCLMULQDQ) variant. Falls back to slicing-by-16
+ *  if the library or the CPU does not support it. */
+igtl_uint64 igtl_export igtl_crc64_clmul(const unsigned char* data, igtl_uint64 len, igtl_uint64 crc);
+int igtl_export igtl_crc64_clmul_supported();
+
+/** Selects the variant used by crc64(). Returns the IGTL_CRC64_IMPL_* value
+ *  actually selected, which differs from 'impl' for IGTL_CRC64_IMPL_AUTO or
+ *  when the requested variant is not available. The variant is initialized
+ *  once in a thread-safe way; selecting another one (e.g. in a benchmark) must
+ *  not be done while crc64() is running in other threads. */
+int igtl_export igtl_crc64_set_implementation(int impl);
+int igtl_export igtl_crc64_get_implementation();
+
+/** Combines the CRC-64 values of two consecutive blocks A and B into the CRC
+ *  of A||B. 'crc1' is the CRC of A computed with the caller's initial value,
+ *  'crc2' is the CRC of B computed with the initial value 0 (i.e. crc64(0, 0, 0))
+ *  and 'len2' is the length of B in bytes. This allows the blocks of a large
+ *  buffer to be checksummed independently (e.g. in parallel). */
+igtl_uint64 igtl_export igtl_crc64_combine(igtl_uint64 crc1, igtl_uint64 crc2, igtl_uint64 len2);
+
+/** Byte order conversion implementations. igtl_convert_byte_order_copy() uses the
+ *  fastest variant supported by the host CPU unless another one is selected with
+ *  igtl_convert_byte_order_set_implementation(). All variants produce identical data. */
+#define IGTL_BYTE_ORDER_IMPL_AUTO    0
+#define IGTL_BYTE_ORDER_IMPL_SCALAR  1
+#define IGTL_BYTE_ORDER_IMPL_SSSE3   2
+#define IGTL_BYTE_ORDER_IMPL_AVX2    3
+
+/** Selects the variant used by igtl_convert_byte_order_copy(). Returns the
+ *  IGTL_BYTE_ORDER_IMPL_* value actually selected, which differs from 'impl' for
+ *  IGTL_BYTE_ORDER_IMPL_AUTO or when the requested variant is not available.
+ *  As for igtl_crc64_set_implementation(), the default is selected once in a
+ *  thread-safe way, but switching must not overlap with conversions in other
+ *  threads. */
+int igtl_export igtl_convert_byte_order_set_implementation(int impl);
+int igtl_export igtl_convert_byte_order_get_implementation();
+
+/** Copies 'count' elements of 'element_size' bytes (1, 2, 4 or 8) from 'src' to 'dst'
+ *  converting them between host and network byte order. The data is copied as it is on
+ *  big-endian hosts. 'dst' and 'src' may point to the same memory area, or 'dst' may
+ *  precede 'src' in an overlapping area (the data is moved towards lower addresses);
+ *  'dst' must not follow 'src' in an overlapping area.
+ *  Neither needs to be aligned. */
+void igtl_export igtl_convert_byte_order_copy(void * dst, const void * src, igtl_uint64 count, int element_size);
+
+/** Converts 'count' elements of 'element_size' bytes at 'data' in place. */
+void igtl_export igtl_convert_byte_order(void * data, igtl_uint64 count, int element_size);
+
+/** Same as igtl_convert_byte_order_copy(), but also feeds the bytes written to 'dst'
+ *  to the CRC-64 'crc' and returns the updated value. The data is processed in small
+ *  blocks, so each block is checksummed while it is still in cache. */
+igtl_uint64 igtl_export igtl_convert_byte_order_copy_crc64(void * dst, const void * src, igtl_uint64 count,
+                                                           int element_size, igtl_uint64 crc);
+
 /** Converts nanosecond to fraction / fraction to nanosec. */
 igtl_uint32 igtl_export igtl_nanosec_to_frac(igtl_uint32 nanosec);
 igtl_uint32 igtl_export igtl_frac_to_nanosec(igtl_uint32 frac);
@@ -68,6 +68,7 @@ ExternalProject_Add( OpenIGTLink-lib
       -DOpenIGTLink_USE_AV1:BOOL=${OpenIGTLink_USE_AV1}
       -DOpenIGTLink_USE_WEBSOCKET:BOOL=${OpenIGTLink_USE_WEBSOCKET}
       -DOpenIGTLink_BUILD_EXAMPLES:BOOL=${OpenIGTLink_BUILD_EXAMPLES}
+      -DOpenIGTLink_BUILD_BENCHMARKS:BOOL=${OpenIGTLink_BUILD_BENCHMARKS}
       -DCMAKE_CXX_FLAGS:STRING=${CMAKE_CXX_FLAGS}
       -DCMAKE_C_FLAGS:STRING=${CMAKE_C_FLAGS}
       -DOpenH264_INCLUDE_DIR:STRING=${OpenH264_INCLUDE_DIR}
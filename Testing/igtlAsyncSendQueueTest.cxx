@@ -0,0 +1,248 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlClientSocket.h"
+#include "igtlServerSocket.h"
+#include "igtlMultiThreader.h"
+#include "igtlOSUtil.h"
+#include "igtlTransformMessage.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <stdio.h>
+#include <vector>
+
+struct ReceiverData
+{
+  igtl::ClientSocket* socket;
+  int numberOfMessages;
+  int received;
+  int errors;
+};
+
+// Receives the transforms sent by the client and checks their order.
+void* Receiver(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ReceiverData* data = static_cast<ReceiverData*>(info->UserData);
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  igtl::TransformMessage::Pointer transform = igtl::TransformMessage::New();
+  while (data->received < data->numberOfMessages)
+    {
+    header->InitPack();
+    if (data->socket->Receive(header->GetPackPointer(), header->GetPackSize()) != header->GetPackSize())
+      {
+      break;
+      }
+    header->Unpack();
+    transform->SetMessageHeader(header);
+    transform->AllocatePack();
+    if (data->socket->Receive(transform->GetPackBodyPointer(), transform->GetPackBodySize()) != transform->GetPackBodySize())
+      {
+      break;
+      }
+    char name[IGTL_HEADER_NAME_SIZE + 1];
+    sprintf(name, "T%d", data->received);
+    if (strcmp(header->GetDeviceName(), name) != 0 ||
+        !(transform->Unpack(1) & igtl::MessageHeader::UNPACK_BODY))
+      {
+      data->errors ++;
+      }
+    data->received ++;
+    }
+  return NULL;
+}
+
+void Connect(igtl::ServerSocket::Pointer& server, igtl::ClientSocket::Pointer& client,
+             igtl::ClientSocket::Pointer& peer)
+{
+  server = igtl::ServerSocket::New();
+  ASSERT_EQ(server->CreateServer(0), 0);
+  client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+  peer = server->WaitForConnection(1000);
+  ASSERT_TRUE(peer.IsNotNull());
+}
+
+TEST(AsyncSendQueueTest, CoalescingFormatVersion1)
+{
+  igtl::ServerSocket::Pointer server;
+  igtl::ClientSocket::Pointer client;
+  igtl::ClientSocket::Pointer peer;
+  Connect(server, client, peer);
+
+  igtl::AsyncSendStatistics statistics;
+  EXPECT_FALSE(client->GetAsyncSendStatistics(&statistics));
+  ASSERT_EQ(client->StartAsyncSend(16, igtl::AsyncSendQueue::Block, 4096), 0);
+  EXPECT_TRUE(client->GetAsyncSend());
+  EXPECT_EQ(client->StartAsyncSend(), -1);
+
+  ReceiverData data;
+  data.socket = peer.GetPointer();
+  data.numberOfMessages = 2000;
+  data.received = 0;
+  data.errors = 0;
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int id = threader->SpawnThread((igtl::ThreadFunctionType) &Receiver, &data);
+
+  // Send() and SendFragments() both go through the queue, in order.
+  igtl::TransformMessage::Pointer transform = igtl::TransformMessage::New();
+  for (int i = 0; i < data.numberOfMessages; i ++)
+    {
+    char name[16];
+    sprintf(name, "T%d", i);
+    transform->SetDeviceName(name);
+    transform->Pack();
+    if (i % 2)
+      {
+      EXPECT_EQ(client->Send(transform->GetPackPointer(), transform->GetPackSize()), 1);
+      }
+    else
+      {
+      EXPECT_EQ(client->SendFragments(transform), 1);
+      }
+    }
+  EXPECT_TRUE(client->FlushAsyncSend(1000));
+  threader->TerminateThread(id);
+  EXPECT_EQ(data.received, data.numberOfMessages);
+  EXPECT_EQ(data.errors, 0);
+
+  ASSERT_TRUE(client->GetAsyncSendStatistics(&statistics));
+  EXPECT_EQ(statistics.QueuedMessages, (igtl_uint64)data.numberOfMessages);
+  EXPECT_EQ(statistics.SentMessages, (igtl_uint64)data.numberOfMessages);
+  EXPECT_EQ(statistics.SentBytes, (igtl_uint64)(data.numberOfMessages * transform->GetPackSize()));
+  EXPECT_EQ(statistics.DroppedMessages, (igtl_uint64)0);
+  EXPECT_GT(statistics.SendCalls, (igtl_uint64)0);
+  EXPECT_LE(statistics.SendCalls, statistics.SentMessages);
+  EXPECT_LE(statistics.MaximumQueueLength, 16);
+  EXPECT_EQ(statistics.QueueLength, 0);
+  EXPECT_GE(statistics.TotalLatency, statistics.MaximumLatency);
+
+  client->ResetAsyncSendStatistics();
+  ASSERT_TRUE(client->GetAsyncSendStatistics(&statistics));
+  EXPECT_EQ(statistics.SentMessages, (igtl_uint64)0);
+
+  // After stopping, the data is sent by the calling thread again.
+  client->StopAsyncSend();
+  EXPECT_FALSE(client->GetAsyncSend());
+  EXPECT_EQ(client->Send(transform->GetPackPointer(), transform->GetPackSize()), 1);
+  client->CloseSocket();
+  peer->CloseSocket();
+  server->CloseSocket();
+}
+
+TEST(AsyncSendQueueTest, DropOldestFormatVersion1)
+{
+  igtl::ServerSocket::Pointer server;
+  igtl::ClientSocket::Pointer client;
+  igtl::ClientSocket::Pointer peer;
+  Connect(server, client, peer);
+  ASSERT_EQ(client->StartAsyncSend(4, igtl::AsyncSendQueue::DropOldest), 0);
+
+  // The peer does not read: once the socket buffers are full the I/O thread
+  // blocks, but Send() keeps returning and the oldest messages are dropped.
+  std::vector<char> buffer(256 * 1024);
+  const int numberOfMessages = 256;
+  for (int i = 0; i < numberOfMessages; i ++)
+    {
+    EXPECT_EQ(client->Send(&buffer[0], (int)buffer.size()), 1);
+    }
+  igtl::AsyncSendStatistics statistics;
+  ASSERT_TRUE(client->GetAsyncSendStatistics(&statistics));
+  EXPECT_EQ(statistics.QueuedMessages, (igtl_uint64)numberOfMessages);
+  EXPECT_GT(statistics.DroppedMessages, (igtl_uint64)0);
+  EXPECT_LT(statistics.SentMessages, (igtl_uint64)numberOfMessages);
+  EXPECT_LE(statistics.QueueLength, 4);
+
+  // Closing the socket interrupts the blocked send and discards the queue.
+  client->CloseSocket();
+  EXPECT_FALSE(client->GetAsyncSend());
+  EXPECT_EQ(client->Send(&buffer[0], (int)buffer.size()), 0);
+  peer->CloseSocket();
+  server->CloseSocket();
+}
+
+TEST(AsyncSendQueueTest, StopWithoutFlushFormatVersion1)
+{
+  igtl::ServerSocket::Pointer server;
+  igtl::ClientSocket::Pointer client;
+  igtl::ClientSocket::Pointer peer;
+  Connect(server, client, peer);
+  ASSERT_EQ(client->StartAsyncSend(), 0);
+
+  igtl::TransformMessage::Pointer transform = igtl::TransformMessage::New();
+  for (int i = 0; i < 100; i ++)
+    {
+    transform->SetDeviceName("Queued");
+    transform->Pack();
+    EXPECT_EQ(client->Send(transform->GetPackPointer(), transform->GetPackSize()), 1);
+    }
+
+  // The queued messages are discarded, but the connection stays usable.
+  client->StopAsyncSend(false);
+  EXPECT_FALSE(client->GetAsyncSend());
+  EXPECT_TRUE(client->GetConnected());
+  transform->SetDeviceName("Sync");
+  transform->Pack();
+  EXPECT_EQ(client->Send(transform->GetPackPointer(), transform->GetPackSize()), 1);
+
+  // Messages are sent or discarded as a whole, so the peer finds the
+  // synchronously sent message after the queued ones that were sent.
+  peer->SetReceiveTimeout(1000);
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  bool found = false;
+  for (int i = 0; i <= 100 && !found; i ++)
+    {
+    header->InitPack();
+    if (peer->Receive(header->GetPackPointer(), header->GetPackSize()) != header->GetPackSize())
+      {
+      break;
+      }
+    header->Unpack();
+    found = (strcmp(header->GetDeviceName(), "Sync") == 0);
+    peer->Skip(header->GetBodySizeToRead());
+    }
+  EXPECT_TRUE(found);
+  client->CloseSocket();
+  peer->CloseSocket();
+  server->CloseSocket();
+}
+
+TEST(AsyncSendQueueTest, PeerClosedFormatVersion1)
+{
+  igtl::ServerSocket::Pointer server;
+  igtl::ClientSocket::Pointer client;
+  igtl::ClientSocket::Pointer peer;
+  Connect(server, client, peer);
+  ASSERT_EQ(client->StartAsyncSend(), 0);
+  peer->CloseSocket();
+
+  // A failed send stops the queue; Send() then reports the error.
+  std::vector<char> buffer(64 * 1024);
+  int result = 1;
+  for (int i = 0; i < 1000 && result; i ++)
+    {
+    result = client->Send(&buffer[0], (int)buffer.size());
+    igtl::Sleep(1);
+    }
+  EXPECT_EQ(result, 0);
+  EXPECT_FALSE(client->FlushAsyncSend(100));
+  client->StopAsyncSend();
+  server->CloseSocket();
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
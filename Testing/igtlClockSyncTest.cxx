@@ -0,0 +1,145 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlClockSyncMessage.h"
+#include "igtlClockOffsetEstimator.h"
+#include "igtlClockSyncHandler.h"
+#include "igtlEventLoopServer.h"
+#include "igtlMessageFactory.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <math.h>
+
+TEST(ClockSyncTest, MessageFormatVersion1)
+{
+  igtl::ClockSyncMessage::Pointer sent = igtl::ClockSyncMessage::New();
+  sent->SetDeviceName("Tracker");
+  sent->SetOriginateTime(0x0102030405060708ULL);
+  EXPECT_TRUE(sent->IsRequest());
+  sent->SetReceiveTime(0x1112131415161718ULL);
+  sent->SetTransmitTime(0x2122232425262728ULL);
+  EXPECT_FALSE(sent->IsRequest());
+  sent->Pack();
+
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), sent->GetPackPointer(), IGTL_HEADER_SIZE);
+  header->Unpack();
+  EXPECT_STREQ(header->GetDeviceType(), "CLOCKSYNC");
+
+  igtl::MessageFactory::Pointer factory = igtl::MessageFactory::New();
+  igtl::MessageBase::Pointer base = factory->CreateReceiveMessage(header);
+  igtl::ClockSyncMessage::Pointer received = dynamic_cast<igtl::ClockSyncMessage*>(base.GetPointer());
+  ASSERT_TRUE(received.IsNotNull());
+  memcpy(received->GetPackBodyPointer(), sent->GetPackBodyPointer(), sent->GetPackBodySize());
+  EXPECT_TRUE(received->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(received->GetOriginateTime(), 0x0102030405060708ULL);
+  EXPECT_EQ(received->GetReceiveTime(), 0x1112131415161718ULL);
+  EXPECT_EQ(received->GetTransmitTime(), 0x2122232425262728ULL);
+}
+
+TEST(ClockSyncTest, EstimatorFormatVersion1)
+{
+  igtl::ClockOffsetEstimator::Pointer estimator = igtl::ClockOffsetEstimator::New();
+  estimator->SetWindowSize(4);
+  EXPECT_EQ(estimator->GetOffset(), 0.0);
+
+  // The peer clock is 5 s ahead. The first round trip is symmetric (100 us
+  // each way); the others are delayed by queuing on the way back.
+  const igtlUint64 t = 1700000000000000000ULL;
+  const igtlUint64 offset = 5000000000ULL;
+  estimator->AddSample(t, t + 100000 + offset, t + 150000 + offset, t + 250000);
+  EXPECT_NEAR(estimator->GetOffset(), 5.0, 1e-9);
+  EXPECT_NEAR(estimator->GetRoundTripDelay(), 200e-6, 1e-9);
+  EXPECT_EQ(estimator->GetJitter(), 0.0);
+
+  for (int i = 1; i <= 3; i ++)
+    {
+    igtlUint64 t0 = t + i * 1000000000ULL;
+    estimator->AddSample(t0, t0 + 100000 + offset, t0 + 150000 + offset, t0 + 250000 + i * 20000);
+    }
+  EXPECT_EQ(estimator->GetNumberOfSamples(), 4);
+  // The sample with the smallest delay is used; the others add jitter.
+  EXPECT_NEAR(estimator->GetOffset(), 5.0, 1e-9);
+  EXPECT_NEAR(estimator->GetRoundTripDelay(), 200e-6, 1e-9);
+  EXPECT_NEAR(estimator->GetJitter(), sqrt((1e-10 + 4e-10 + 9e-10) / 3.0), 1e-9);
+
+  // The symmetric sample leaves the window.
+  igtlUint64 t0 = t + 4000000000ULL;
+  estimator->AddSample(t0, t0 + 100000 + offset, t0 + 150000 + offset, t0 + 270000);
+  EXPECT_EQ(estimator->GetNumberOfSamples(), 4);
+  EXPECT_NEAR(estimator->GetRoundTripDelay(), 220e-6, 1e-9);
+  EXPECT_NEAR(estimator->GetOffset(), 5.0 - 10e-6, 1e-9);
+
+  // A peer time stamp is converted to the local clock.
+  igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+  ts->SetTimeInNanoseconds(t + offset);
+  estimator->ConvertToLocalTime(ts);
+  EXPECT_EQ(ts->GetTimeStampInNanoseconds(), t + 10000);
+
+  estimator->Reset();
+  EXPECT_EQ(estimator->GetNumberOfSamples(), 0);
+}
+
+TEST(ClockSyncTest, LoopbackFormatVersion1)
+{
+  // The server answers the requests; the client runs its own event loop
+  // on the connection and passes the replies to its estimator.
+  igtl::ClockSyncHandler::Pointer serverHandler = igtl::ClockSyncHandler::New();
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  server->AddMessageHandler(serverHandler);
+  ASSERT_EQ(server->CreateServer(0), 0);
+
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+  igtl::ClockSyncHandler::Pointer clientHandler = igtl::ClockSyncHandler::New();
+  igtl::EventLoopServer::Pointer clientLoop = igtl::EventLoopServer::New();
+  clientLoop->AddMessageHandler(clientHandler);
+  ASSERT_EQ(clientLoop->AddConnection(client), 1);
+
+  igtl::ClockOffsetEstimator* estimator = clientHandler->GetEstimator(client);
+  const int numberOfRequests = 8;
+  for (int i = 0; i < numberOfRequests; i ++)
+    {
+    ASSERT_EQ(clientHandler->SendRequest(client), 1);
+    for (int j = 0; j < 100 && estimator->GetNumberOfSamples() <= i; j ++)
+      {
+      server->ProcessEvents(10);
+      clientLoop->ProcessEvents(10);
+      }
+    }
+  EXPECT_EQ(estimator->GetNumberOfSamples(), numberOfRequests);
+
+  // Both ends use the same clock.
+  EXPECT_GE(estimator->GetRoundTripDelay(), 0.0);
+  EXPECT_LT(estimator->GetRoundTripDelay(), 0.1);
+  EXPECT_LE(fabs(estimator->GetOffset()), estimator->GetRoundTripDelay() / 2 + 1e-6);
+
+  // A reply that does not answer the last request is ignored.
+  igtl::ClockSyncMessage::Pointer stale = igtl::ClockSyncMessage::New();
+  stale->SetOriginateTime(1);
+  stale->SetTransmitTime(2);
+  EXPECT_EQ(estimator->AddReply(stale), 0);
+  EXPECT_EQ(estimator->GetNumberOfSamples(), numberOfRequests);
+
+  clientHandler->RemoveEstimator(client);
+  clientLoop->CloseServer();
+  server->CloseServer();
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlColorConversion.h"
+#include "igtlCodecCommonClasses.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Reference implementations of the fixed-point formulas in
+// igtlCodecCommonClasses.h, written independently of the kernels. For odd
+// sizes, the chroma planes have (width/2) x (height/2) samples, the V plane
+// starts width*height/4 bytes after the U plane, and the last row or column
+// uses the chroma of its neighbour.
+
+void ReferenceRGBToI420(const igtlUint8* rgb, igtlUint8* i420, int width, int height)
+{
+  igtlUint8* y = i420;
+  igtlUint8* u = i420 + width * height;
+  igtlUint8* v = u + width * height / 4;
+  for (int row = 0; row < height; row ++)
+    {
+    for (int col = 0; col < width; col ++)
+      {
+      const igtlUint8* p = rgb + 3 * (row * width + col);
+      y[row * width + col] = ((66 * p[0] + 129 * p[1] + 25 * p[2]) >> 8) + 16;
+      if (row % 2 == 0 && col % 2 == 0 && row / 2 < height / 2 && col / 2 < width / 2)
+        {
+        u[(row / 2) * (width / 2) + col / 2] = ((-38 * p[0] - 74 * p[1] + 112 * p[2]) >> 8) + 128;
+        v[(row / 2) * (width / 2) + col / 2] = ((112 * p[0] - 94 * p[1] - 18 * p[2]) >> 8) + 128;
+        }
+      }
+    }
+}
+
+
+int Clip(int value)
+{
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+
+void ReferenceI420ToRGB(const igtlUint8* i420, igtlUint8* rgb, int width, int height)
+{
+  const igtlUint8* y = i420;
+  const igtlUint8* u = i420 + width * height;
+  const igtlUint8* v = u + width * height / 4;
+  for (int row = 0; row < height; row ++)
+    {
+    for (int col = 0; col < width; col ++)
+      {
+      int chroma = std::min(row / 2, height / 2 - 1) * (width / 2) + std::min(col / 2, width / 2 - 1);
+      int c = 298 * (y[row * width + col] - 16);
+      int d = u[chroma] - 128;
+      int e = v[chroma] - 128;
+      igtlUint8* p = rgb + 3 * (row * width + col);
+      p[0] = Clip((c + 409 * e) >> 8);
+      p[1] = Clip((c - 100 * d - 208 * e) >> 8);
+      p[2] = Clip((c + 517 * d) >> 8);
+      }
+    }
+}
+
+
+std::vector<igtlUint8> RandomBytes(size_t size)
+{
+  std::vector<igtlUint8> data(size);
+  for (size_t i = 0; i < size; i ++)
+    {
+    data[i] = (igtlUint8)(rand() & 0xFF);
+    }
+  return data;
+}
+
+
+// Sizes cover the SIMD blocks (16 and 32 pixels), their tails, and frames
+// large enough for the row-parallel mode.
+static const int sizes[][2] = {{2, 2}, {16, 2}, {30, 6}, {34, 4}, {62, 10}, {640, 480}, {258, 260}};
+static const int numberOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+static const int implementations[] = {igtl::COLOR_CONVERSION_SCALAR, igtl::COLOR_CONVERSION_SSSE3,
+                                      igtl::COLOR_CONVERSION_AVX2};
+
+
+TEST(ColorConversionTest, RGBToI420FormatVersion1)
+{
+  srand(1);
+  for (int s = 0; s < numberOfSizes; s ++)
+    {
+    const int width = sizes[s][0];
+    const int height = sizes[s][1];
+    std::vector<igtlUint8> rgb = RandomBytes(width * height * 3);
+    std::vector<igtlUint8> expected(width * height * 3 / 2);
+    ReferenceRGBToI420(&rgb[0], &expected[0], width, height);
+    for (int i = 0; i < 3; i ++)
+      {
+      igtl::SetColorConversionImplementation(implementations[i]);
+      for (int threads = 1; threads <= 3; threads ++)
+        {
+        igtl::SetColorConversionNumberOfThreads(threads);
+        std::vector<igtlUint8> i420(expected.size(), 0);
+        igtl::ConvertRGBToI420(&rgb[0], &i420[0], width, height);
+        EXPECT_EQ(memcmp(&i420[0], &expected[0], expected.size()), 0)
+          << width << "x" << height << " impl " << igtl::GetColorConversionImplementation()
+          << " threads " << threads;
+        }
+      }
+    }
+  igtl::SetColorConversionImplementation(igtl::COLOR_CONVERSION_AUTO);
+  igtl::SetColorConversionNumberOfThreads(1);
+}
+
+
+TEST(ColorConversionTest, I420ToRGBFormatVersion1)
+{
+  srand(2);
+  for (int s = 0; s < numberOfSizes; s ++)
+    {
+    const int width = sizes[s][0];
+    const int height = sizes[s][1];
+    // Random planes include values outside the nominal Y/UV ranges, which
+    // exercise the clipping.
+    std::vector<igtlUint8> i420 = RandomBytes(width * height * 3 / 2);
+    std::vector<igtlUint8> expected(width * height * 3);
+    ReferenceI420ToRGB(&i420[0], &expected[0], width, height);
+    std::vector<igtlUint8> expectedGray(width * height * 3);
+    for (int p = 0; p < width * height; p ++)
+      {
+      expectedGray[3 * p] = expectedGray[3 * p + 1] = expectedGray[3 * p + 2] = i420[p];
+      }
+    for (int i = 0; i < 3; i ++)
+      {
+      igtl::SetColorConversionImplementation(implementations[i]);
+      for (int threads = 1; threads <= 3; threads ++)
+        {
+        igtl::SetColorConversionNumberOfThreads(threads);
+        std::vector<igtlUint8> rgb(expected.size(), 0);
+        igtl::ConvertI420ToRGB(&i420[0], &rgb[0], width, height);
+        EXPECT_EQ(memcmp(&rgb[0], &expected[0], expected.size()), 0)
+          << width << "x" << height << " impl " << igtl::GetColorConversionImplementation()
+          << " threads " << threads;
+        std::vector<igtlUint8> gray(expected.size(), 0);
+        igtl::ConvertI420ToGrayRGB(&i420[0], &gray[0], width, height);
+        EXPECT_EQ(memcmp(&gray[0], &expectedGray[0], expectedGray.size()), 0)
+          << width << "x" << height << " impl " << igtl::GetColorConversionImplementation()
+          << " threads " << threads;
+        }
+      }
+    }
+  igtl::SetColorConversionImplementation(igtl::COLOR_CONVERSION_AUTO);
+  igtl::SetColorConversionNumberOfThreads(1);
+}
+
+
+TEST(ColorConversionTest, CodecConversionFormatVersion1)
+{
+  // The codec helpers use the kernels for even sizes and keep their own loops
+  // for odd sizes; both must match the reference.
+  srand(3);
+  static const int codecSizes[][2] = {{100, 50}, {101, 51}, {101, 50}, {100, 51}};
+  for (int s = 0; s < 4; s ++)
+    {
+    const int width = codecSizes[s][0];
+    const int height = codecSizes[s][1];
+    std::vector<igtlUint8> rgb = RandomBytes(width * height * 3);
+    std::vector<igtlUint8> expected(width * height * 3 / 2, 0);
+    ReferenceRGBToI420(&rgb[0], &expected[0], width, height);
+    std::vector<igtlUint8> i420(expected.size(), 0);
+    igtl::GenericEncoder::ConvertRGBToYUV(&rgb[0], &i420[0], width, height);
+    EXPECT_EQ(memcmp(&i420[0], &expected[0], expected.size()), 0) << width << "x" << height;
+
+    std::vector<igtlUint8> expectedRGB(width * height * 3);
+    ReferenceI420ToRGB(&i420[0], &expectedRGB[0], width, height);
+    std::vector<igtlUint8> decoded(expectedRGB.size(), 0);
+    EXPECT_EQ(igtl::GenericDecoder::ConvertYUVToRGB(&i420[0], &decoded[0], height, width), 1);
+    EXPECT_EQ(memcmp(&decoded[0], &expectedRGB[0], expectedRGB.size()), 0) << width << "x" << height;
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlEventLoopServer.h"
+#include "igtlMessageHandlerMacro.h"
+#include "igtlClientSocket.h"
+#include "igtlTransformMessage.h"
+#include "igtlImageMessage.h"
+#include "igtlStatusMessage.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+struct ReceivedData
+{
+  std::vector<std::string> deviceNames;
+  int imagePixelSum;
+};
+
+igtlMessageHandlerClassMacro(igtl::TransformMessage, TestTransformHandler, ReceivedData);
+igtlMessageHandlerClassMacro(igtl::ImageMessage, TestImageHandler, ReceivedData);
+
+int TestTransformHandler::Process(igtl::TransformMessage* message, ReceivedData* data)
+{
+  data->deviceNames.push_back(message->GetDeviceName());
+  return 1;
+}
+
+int TestImageHandler::Process(igtl::ImageMessage* message, ReceivedData* data)
+{
+  data->deviceNames.push_back(message->GetDeviceName());
+  const unsigned char* p = (const unsigned char*)message->GetScalarPointer();
+  int sum = 0;
+  for (int i = 0; i < message->GetImageSize(); i ++)
+    {
+    sum += p[i];
+    }
+  data->imagePixelSum = sum;
+  return 1;
+}
+
+igtl::MessageBase::Pointer CreateTransform(const char* name, int headerVersion)
+{
+  igtl::TransformMessage::Pointer msg = igtl::TransformMessage::New();
+#if OpenIGTLink_PROTOCOL_VERSION >= 3
+  msg->SetHeaderVersion(headerVersion);
+  if (headerVersion >= IGTL_HEADER_VERSION_2)
+    {
+    msg->SetMetaDataElement("Source", IANA_TYPE_US_ASCII, "EventLoopServerTest");
+    }
+#else
+  (void)headerVersion;
+#endif
+  msg->SetDeviceName(name);
+  msg->Pack();
+  return igtl::MessageBase::Pointer(msg.GetPointer());
+}
+
+// Processes events until 'count' messages have been received or the wait times out.
+void ProcessUntil(igtl::EventLoopServer* server, ReceivedData& data, size_t count)
+{
+  for (int i = 0; i < 200 && data.deviceNames.size() < count; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+}
+
+void RunInterleavedClients(int headerVersion)
+{
+  ReceivedData data;
+  data.imagePixelSum = 0;
+  TestTransformHandler::Pointer transformHandler = TestTransformHandler::New();
+  transformHandler->SetData(&data);
+  TestImageHandler::Pointer imageHandler = TestImageHandler::New();
+  imageHandler->SetData(&data);
+
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  EXPECT_EQ(server->AddMessageHandler(transformHandler), 1);
+  EXPECT_EQ(server->AddMessageHandler(imageHandler), 1);
+  EXPECT_EQ(server->AddMessageHandler(TestTransformHandler::New()), 0);
+  ASSERT_EQ(server->CreateServer(0), 0);
+  int port = server->GetServerPort();
+  ASSERT_GT(port, 0);
+
+  const int numberOfClients = 3;
+  igtl::ClientSocket::Pointer clients[numberOfClients];
+  for (int i = 0; i < numberOfClients; i ++)
+    {
+    clients[i] = igtl::ClientSocket::New();
+    ASSERT_EQ(clients[i]->ConnectToServer("localhost", port), 0);
+    }
+  for (int i = 0; i < 100 && server->GetNumberOfConnections() < numberOfClients; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(server->GetNumberOfConnections(), numberOfClients);
+
+  // Client 0 sends a message one byte at a time while client 1 sends a
+  // message without a handler followed by two messages in a single write.
+  igtl::MessageBase::Pointer t0 = CreateTransform("Client0", headerVersion);
+  igtl::MessageBase::Pointer t1 = CreateTransform("Client1a", headerVersion);
+  igtl::MessageBase::Pointer t2 = CreateTransform("Client1b", headerVersion);
+  igtl::StatusMessage::Pointer status = igtl::StatusMessage::New();
+  status->SetDeviceName("Skipped");
+  status->SetStatusString("No handler for this message.");
+  status->Pack();
+
+  std::vector<char> stream;
+  stream.insert(stream.end(), (char*)status->GetPackPointer(), (char*)status->GetPackPointer() + status->GetPackSize());
+  stream.insert(stream.end(), (char*)t1->GetPackPointer(), (char*)t1->GetPackPointer() + t1->GetPackSize());
+  stream.insert(stream.end(), (char*)t2->GetPackPointer(), (char*)t2->GetPackPointer() + t2->GetPackSize());
+  clients[1]->Send(&stream[0], (int)stream.size());
+
+  const char* bytes = (const char*)t0->GetPackPointer();
+  for (int i = 0; i < t0->GetPackSize(); i ++)
+    {
+    clients[0]->Send(bytes + i, 1);
+    server->ProcessEvents(1);
+    }
+
+  // Client 2 sends an image larger than the shared receive buffer.
+  igtl::ImageMessage::Pointer image = igtl::ImageMessage::New();
+  int size[3] = {256, 256, 2};
+  image->SetDimensions(size);
+  image->SetScalarType(igtl::ImageMessage::TYPE_UINT8);
+  image->SetDeviceName("Client2");
+  image->AllocateScalars();
+  unsigned char* p = (unsigned char*)image->GetScalarPointer();
+  int sum = 0;
+  for (int i = 0; i < image->GetImageSize(); i ++)
+    {
+    p[i] = (unsigned char)(i % 251);
+    sum += p[i];
+    }
+  image->Pack();
+  clients[2]->Send(image->GetPackPointer(), image->GetPackSize());
+
+  ProcessUntil(server, data, 4);
+  ASSERT_EQ(data.deviceNames.size(), (size_t)4);
+  EXPECT_EQ(std::count(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client0")), 1);
+  EXPECT_EQ(std::count(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client2")), 1);
+  std::vector<std::string>::iterator a = std::find(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client1a"));
+  std::vector<std::string>::iterator b = std::find(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client1b"));
+  ASSERT_TRUE(a != data.deviceNames.end() && b != data.deviceNames.end());
+  EXPECT_TRUE(a < b);
+  EXPECT_EQ(data.imagePixelSum, sum);
+
+  // Closed connections are removed.
+  clients[0]->CloseSocket();
+  for (int i = 0; i < 100 && server->GetNumberOfConnections() == numberOfClients; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(server->GetNumberOfConnections(), numberOfClients - 1);
+
+  // Broadcast reaches the remaining clients.
+  EXPECT_EQ(server->Broadcast(t0), numberOfClients - 1);
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  EXPECT_EQ(clients[1]->Receive(header->GetPackPointer(), header->GetPackSize()), header->GetPackSize());
+  header->Unpack();
+  EXPECT_STREQ(header->GetDeviceName(), "Client0");
+
+  server->CloseServer();
+  EXPECT_EQ(server->GetNumberOfConnections(), 0);
+}
+
+TEST(EventLoopServerTest, InterleavedClientsFormatVersion1)
+{
+  RunInterleavedClients(IGTL_HEADER_VERSION_1);
+}
+
+#if OpenIGTLink_PROTOCOL_VERSION >= 3
+TEST(EventLoopServerTest, InterleavedClientsFormatVersion2)
+{
+  RunInterleavedClients(IGTL_HEADER_VERSION_2);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
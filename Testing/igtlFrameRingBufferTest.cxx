@@ -0,0 +1,255 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlFrameRingBuffer.h"
+#include "igtlMultiThreader.h"
+#include "igtlOSUtil.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <vector>
+
+void WriteFrame(igtl::FrameRingBuffer& ring, int value, igtl_uint64 size)
+{
+  igtl_uint8* slot = ring.BeginWrite(size);
+  ASSERT_TRUE(slot != NULL);
+  memset(slot, value, (size_t)size);
+  ring.EndWrite(size);
+}
+
+int ReadFrame(igtl::FrameRingBuffer& ring, igtl_uint64 expectedSize)
+{
+  igtl_uint64 size = 0;
+  igtl_uint8* frame = ring.BeginRead(&size, 100);
+  if (frame == NULL || size != expectedSize)
+    {
+    return -1;
+    }
+  int value = frame[0];
+  for (igtl_uint64 i = 1; i < size; i ++)
+    {
+    if (frame[i] != value)
+      {
+      value = -1;
+      break;
+      }
+    }
+  ring.EndRead();
+  return value;
+}
+
+TEST(FrameRingBufferTest, DropOldestFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(3, 16);
+  EXPECT_EQ(ring.GetNumberOfSlots(), 3);
+
+  // Frames larger than the slot grow the slot.
+  for (int i = 0; i < 5; i ++)
+    {
+    WriteFrame(ring, i, 64);
+    }
+  EXPECT_EQ(ring.GetNumberOfFrames(), 3);
+  EXPECT_EQ(ring.GetNumberOfDroppedFrames(), (igtl_uint64)2);
+  EXPECT_EQ(ReadFrame(ring, 64), 2);
+  EXPECT_EQ(ReadFrame(ring, 64), 3);
+
+  WriteFrame(ring, 5, 8);
+  EXPECT_EQ(ReadFrame(ring, 64), 4);
+  EXPECT_EQ(ReadFrame(ring, 8), 5);
+
+  // Times out on an empty ring.
+  igtl_uint64 size;
+  EXPECT_TRUE(ring.BeginRead(&size, 10) == NULL);
+  EXPECT_FALSE(ring.IsClosed());
+
+  // Pending frames can be read after the ring has been closed.
+  WriteFrame(ring, 6, 8);
+  ring.Close();
+  EXPECT_TRUE(ring.IsClosed());
+  EXPECT_TRUE(ring.BeginWrite(8) == NULL);
+  EXPECT_EQ(ReadFrame(ring, 8), 6);
+  EXPECT_TRUE(ring.BeginRead(&size) == NULL);
+
+  // Allocate() reopens the ring.
+  ring.Allocate(2, 8);
+  EXPECT_FALSE(ring.IsClosed());
+  EXPECT_EQ(ring.GetNumberOfFrames(), 0);
+  EXPECT_EQ(ring.GetNumberOfDroppedFrames(), (igtl_uint64)0);
+}
+
+TEST(FrameRingBufferTest, OldestFrameBeingReadFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(2, 8);
+  WriteFrame(ring, 1, 8);
+  WriteFrame(ring, 2, 8);
+
+  // The frame being read is never dropped; the next one is read in order.
+  igtl_uint64 size = 0;
+  igtl_uint8* frame = ring.BeginRead(&size);
+  ASSERT_TRUE(frame != NULL);
+  EXPECT_EQ(frame[0], 1);
+  ring.EndRead();
+  WriteFrame(ring, 3, 8);
+  EXPECT_EQ(ReadFrame(ring, 8), 2);
+  EXPECT_EQ(ReadFrame(ring, 8), 3);
+  EXPECT_EQ(ring.GetNumberOfDroppedFrames(), (igtl_uint64)0);
+}
+
+TEST(FrameRingBufferTest, BatchReadFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(4, 0);
+  for (int i = 1; i <= 4; i ++)
+    {
+    WriteFrame(ring, i, 10 * i);
+    }
+
+  // One slot is left to the producer, and the byte limit ends the batch
+  // after the frame that reaches it, except for the first frame.
+  igtl_uint8* frames[4];
+  igtl_uint64 sizes[4];
+  EXPECT_EQ(ring.BeginReadFrames(frames, sizes, NULL, 4, 5), 1);
+  EXPECT_EQ(frames[0][0], 1);
+  EXPECT_EQ(sizes[0], (igtl_uint64)10);
+  EXPECT_EQ(ring.BeginRead(sizes), (igtl_uint8*)NULL);
+  ring.EndRead();
+  EXPECT_EQ(ring.BeginReadFrames(frames, sizes, NULL, 4, 50), 2);
+  EXPECT_EQ(frames[0][0], 2);
+  EXPECT_EQ(frames[1][0], 3);
+
+  // While two frames are being read, new frames replace the oldest unread one.
+  WriteFrame(ring, 5, 8);
+  WriteFrame(ring, 6, 8);
+  WriteFrame(ring, 7, 8);
+  EXPECT_EQ(ring.GetNumberOfDroppedFrames(), (igtl_uint64)2);
+  EXPECT_EQ(frames[0][0], 2);
+  EXPECT_EQ(frames[1][0], 3);
+  ring.EndRead();
+  EXPECT_EQ(ring.GetNumberOfFrames(), 2);
+  EXPECT_EQ(ring.BeginReadFrames(frames, sizes, NULL, 4, 1000), 2);
+  EXPECT_EQ(frames[0][0], 6);
+  EXPECT_EQ(frames[1][0], 7);
+  ring.EndRead();
+  EXPECT_TRUE(ring.WaitUntilEmpty(100));
+}
+
+struct ProducerData
+{
+  igtl::FrameRingBuffer* ring;
+  int numberOfFrames;
+};
+
+void* Producer(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ProducerData* data = static_cast<ProducerData*>(info->UserData);
+  for (int i = 0; i < data->numberOfFrames; i ++)
+    {
+    igtl_uint64 size = 1 + i % 100;
+    igtl_uint8* slot = data->ring->BeginWrite(size);
+    if (slot == NULL)
+      {
+      break;
+      }
+    memset(slot, i % 256, (size_t)size);
+    data->ring->EndWrite(size);
+    }
+  data->ring->Close();
+  return NULL;
+}
+
+TEST(FrameRingBufferTest, BlockingFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(4, 0, igtl::FrameRingBuffer::Block);
+
+  ProducerData data;
+  data.ring = &ring;
+  data.numberOfFrames = 10000;
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int id = threader->SpawnThread((igtl::ThreadFunctionType) &Producer, &data);
+
+  // The consumer sleeps until a frame is available and gets every frame in order.
+  int received = 0;
+  int errors = 0;
+  igtl_uint64 size = 0;
+  igtl_uint8* frame;
+  while ((frame = ring.BeginRead(&size)) != NULL)
+    {
+    if (size != (igtl_uint64)(1 + received % 100) ||
+        frame[0] != received % 256 || frame[size - 1] != received % 256)
+      {
+      errors ++;
+      }
+    ring.EndRead();
+    received ++;
+    }
+  threader->TerminateThread(id);
+
+  EXPECT_EQ(received, data.numberOfFrames);
+  EXPECT_EQ(errors, 0);
+  EXPECT_EQ(ring.GetNumberOfDroppedFrames(), (igtl_uint64)0);
+}
+
+void* Closer(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  igtl::FrameRingBuffer* ring = static_cast<igtl::FrameRingBuffer*>(info->UserData);
+  igtl::Sleep(50);
+  ring->Close();
+  return NULL;
+}
+
+TEST(FrameRingBufferTest, CloseWakesConsumerFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(2, 8);
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int id = threader->SpawnThread((igtl::ThreadFunctionType) &Closer, &ring);
+  igtl_uint64 size;
+  EXPECT_TRUE(ring.BeginRead(&size) == NULL);
+  threader->TerminateThread(id);
+}
+
+TEST(FrameRingBufferTest, TimeStampFormatVersion1)
+{
+  igtl::FrameRingBuffer ring;
+  ring.Allocate(2, 8);
+  igtl_uint64 timeStamp = 0;
+  EXPECT_FALSE(ring.GetOldestTimeStamp(&timeStamp));
+
+  for (int i = 1; i <= 3; i ++)
+    {
+    igtl_uint8* slot = ring.BeginWrite(8);
+    ASSERT_TRUE(slot != NULL);
+    ring.EndWrite(8, 1000 * i);
+    }
+
+  // The first frame has been dropped.
+  EXPECT_TRUE(ring.GetOldestTimeStamp(&timeStamp));
+  EXPECT_EQ(timeStamp, (igtl_uint64)2000);
+  igtl_uint64 size = 0;
+  ASSERT_TRUE(ring.BeginRead(&size, 100, &timeStamp) != NULL);
+  EXPECT_EQ(timeStamp, (igtl_uint64)2000);
+  ring.EndRead();
+  EXPECT_TRUE(ring.GetOldestTimeStamp(&timeStamp));
+  EXPECT_EQ(timeStamp, (igtl_uint64)3000);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
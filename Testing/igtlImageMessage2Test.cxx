@@ -21,6 +21,8 @@
 #include "igtlTestConfig.h"
 #include "string.h"
 
+#include <vector>
+
 igtl::ImageMessage2::Pointer imageSendMsg2 = igtl::ImageMessage2::New();
 igtl::ImageMessage2::Pointer imageReceiveMsg2 = igtl::ImageMessage2::New();
 
@@ -70,6 +72,22 @@ TEST(ImageMessage2Test, Pack)
   EXPECT_EQ(r, 0);
 }
 
+TEST(ImageMessage2Test, BufferFragments)
+{
+  BuildUp();
+  int n = imageSendMsg2->GetNumberOfBufferFragments();
+  EXPECT_EQ(n, 3);
+  std::vector<unsigned char> stream;
+  for (int i = 0; i < n; i ++)
+    {
+    unsigned char* p = (unsigned char*)imageSendMsg2->GetBufferFragmentPointer(i);
+    stream.insert(stream.end(), p, p + imageSendMsg2->GetBufferFragmentSize(i));
+    }
+  EXPECT_EQ((int)stream.size(), imageSendMsg2->GetPackSize());
+  int r = memcmp(&stream[0], imageSendMsg2->GetPackPointer(), stream.size());
+  EXPECT_EQ(r, 0);
+}
+
 TEST(ImageMessage2Test, Unpack)
 {
   igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
@@ -13,9 +13,14 @@
 
 #include "igtlMessageBase.h"
 #include "igtlMessageHeader.h"
+#include "igtlBufferAllocator.h"
+#include "igtlStatusMessage.h"
 #include "igtlTestConfig.h"
 #include "string.h"
 
+#include <cstdio>
+#include <vector>
+
 TEST(MessageBaseTest, InitializationTest)
 {
   igtl::MessageBase::Pointer messageBaseTest = igtl::MessageBase::New();
@@ -67,6 +72,285 @@ TEST(MessageBaseTest, UNPACKTEST)
   EXPECT_EQ(status, static_cast<int>(messageBaseTest->UNPACK_HEADER));
 }
 
+TEST(MessageBaseTest, PooledBufferAllocatorTest)
+{
+  igtl::PooledBufferAllocator::Pointer allocator = igtl::PooledBufferAllocator::New();
+  igtlUint64 capacity = 0;
+  unsigned char* buffer = allocator->Allocate(1000, &capacity);
+  ASSERT_TRUE(buffer != NULL);
+  EXPECT_EQ(capacity, (igtlUint64)1024);
+  memset(buffer, 0, 1000);
+  allocator->Release(buffer, capacity);
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)1024);
+
+  // A request in the same size class reuses the buffer.
+  igtlUint64 capacity2 = 0;
+  EXPECT_EQ(allocator->Allocate(900, &capacity2), buffer);
+  EXPECT_EQ(capacity2, (igtlUint64)1024);
+  EXPECT_EQ(allocator->GetNumberOfHits(), (igtlUint64)1);
+  EXPECT_EQ(allocator->GetNumberOfMisses(), (igtlUint64)1);
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)0);
+
+  // Size classes are a quarter of a power of two apart.
+  igtlUint64 capacity3 = 0;
+  unsigned char* buffer3 = allocator->Allocate(1025, &capacity3);
+  EXPECT_EQ(capacity3, (igtlUint64)1280);
+  unsigned char* buffer4 = allocator->Allocate(1, &capacity);
+  EXPECT_EQ(capacity, (igtlUint64)igtl::PooledBufferAllocator::MINIMUM_BLOCK_SIZE);
+  allocator->Release(buffer4, capacity);
+
+  // Buffers are not kept beyond the pool size limit.
+  allocator->SetMaximumPoolSize(2048);
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)igtl::PooledBufferAllocator::MINIMUM_BLOCK_SIZE);
+  allocator->Release(buffer, capacity2);
+  allocator->Release(buffer3, capacity3);
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)(igtl::PooledBufferAllocator::MINIMUM_BLOCK_SIZE + 1024));
+  allocator->Trim();
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)0);
+
+  allocator->ResetCounters();
+  EXPECT_EQ(allocator->GetNumberOfHits(), (igtlUint64)0);
+  EXPECT_EQ(allocator->GetNumberOfMisses(), (igtlUint64)0);
+
+  // Huge pages are only a hint.
+  allocator->SetUseHugePages(true);
+  buffer = allocator->Allocate(3 * igtl::PooledBufferAllocator::HUGE_PAGE_SIZE, &capacity);
+  ASSERT_TRUE(buffer != NULL);
+  memset(buffer, 1, (size_t)capacity);
+  allocator->Release(buffer, capacity);
+}
+
+TEST(MessageBaseTest, BufferReuseTest)
+{
+  igtl::PooledBufferAllocator::Pointer allocator = igtl::PooledBufferAllocator::New();
+  igtl::StatusMessage::Pointer message = igtl::StatusMessage::New();
+  message->SetBufferAllocator(allocator);
+  EXPECT_EQ(message->GetBufferAllocator(), (igtl::BufferAllocator*)allocator);
+
+  std::string longString(500, 'a');
+  message->SetStatusString(longString.c_str());
+  message->Pack();
+  void* buffer = message->GetPackPointer();
+  EXPECT_EQ(allocator->GetNumberOfMisses(), (igtlUint64)1);
+
+  // A somewhat smaller message and the header for receiving fit in the same buffer.
+  std::string shorterString(400, 'b');
+  igtl::StatusMessage::Pointer shortMessage = igtl::StatusMessage::New();
+  shortMessage->SetStatusString(shorterString.c_str());
+  shortMessage->Pack();
+  message->InitPack();
+  EXPECT_EQ(message->GetPackPointer(), buffer);
+  memcpy(message->GetPackPointer(), shortMessage->GetPackPointer(), IGTL_HEADER_SIZE);
+  message->Unpack();
+  message->AllocatePack();
+  EXPECT_EQ(message->GetPackPointer(), buffer);
+  memcpy(message->GetPackBodyPointer(), shortMessage->GetPackBodyPointer(), shortMessage->GetPackBodySize());
+  EXPECT_EQ(message->Unpack(1), (int)igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(std::string(message->GetStatusString()), shorterString);
+  EXPECT_EQ(allocator->GetNumberOfMisses(), (igtlUint64)1);
+
+  // A released buffer is reused by the next message.
+  message->ReleaseBuffer();
+  EXPECT_TRUE(message->GetPackPointer() == NULL);
+  EXPECT_EQ(message->GetPackSize(), 0);
+  igtl::StatusMessage::Pointer nextMessage = igtl::StatusMessage::New();
+  nextMessage->SetBufferAllocator(allocator);
+  nextMessage->SetStatusString(longString.c_str());
+  nextMessage->Pack();
+  EXPECT_EQ(nextMessage->GetPackPointer(), buffer);
+  EXPECT_EQ(allocator->GetNumberOfHits(), (igtlUint64)1);
+}
+
+TEST(MessageBaseTest, BufferShrinkTest)
+{
+  igtl::PooledBufferAllocator::Pointer allocator = igtl::PooledBufferAllocator::New();
+  igtl::StatusMessage::Pointer message = igtl::StatusMessage::New();
+  message->SetBufferAllocator(allocator);
+
+  // A large message grows the buffer.
+  std::string longString(100000, 'a');
+  message->SetStatusString(longString.c_str());
+  message->Pack();
+  void* buffer = message->GetPackPointer();
+  EXPECT_EQ(allocator->GetPoolSize(), (igtlUint64)0);
+
+  // Receiving the header keeps the buffer for the next body.
+  igtl::StatusMessage::Pointer shortMessage = igtl::StatusMessage::New();
+  shortMessage->SetStatusString("short");
+  shortMessage->Pack();
+  message->InitPack();
+  EXPECT_EQ(message->GetPackPointer(), buffer);
+
+  // A body far smaller than the buffer returns it to the allocator.
+  memcpy(message->GetPackPointer(), shortMessage->GetPackPointer(), IGTL_HEADER_SIZE);
+  message->Unpack();
+  message->AllocatePack();
+  EXPECT_NE(message->GetPackPointer(), buffer);
+  EXPECT_GE(allocator->GetPoolSize(), (igtlUint64)(IGTL_HEADER_SIZE + 100000));
+  memcpy(message->GetPackBodyPointer(), shortMessage->GetPackBodyPointer(), shortMessage->GetPackBodySize());
+  EXPECT_EQ(message->Unpack(1), (int)igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_STREQ(message->GetStatusString(), "short");
+
+  // Packing a large message again grows the buffer.
+  message->InitPack();
+  message->SetStatusString(longString.c_str());
+  message->Pack();
+  EXPECT_EQ(std::string(message->GetStatusString()), longString);
+  EXPECT_GE(message->GetPackSize(), IGTL_HEADER_SIZE + 100000);
+}
+
+TEST(MessageBaseTest, DefaultBufferAllocatorTest)
+{
+  // Messages use the plain allocator unless pooling is enabled.
+  EXPECT_TRUE(dynamic_cast<igtl::PooledBufferAllocator*>(igtl::BufferAllocator::GetDefault()) == NULL);
+
+  igtl::PooledBufferAllocator::Pointer allocator = igtl::PooledBufferAllocator::New();
+  igtl::BufferAllocator::SetDefault(allocator);
+  igtl::StatusMessage::Pointer message = igtl::StatusMessage::New();
+  EXPECT_EQ(message->GetBufferAllocator(), (igtl::BufferAllocator*)allocator);
+
+  igtl::BufferAllocator::SetDefault(NULL);
+  igtl::StatusMessage::Pointer plainMessage = igtl::StatusMessage::New();
+  EXPECT_TRUE(dynamic_cast<igtl::PooledBufferAllocator*>(plainMessage->GetBufferAllocator()) == NULL);
+}
+
+
+#if OpenIGTLink_HEADER_VERSION >= 2
+// Receives the packed 'source' into 'destination' as a client would.
+void ReceiveMessage(igtl::MessageBase* source, igtl::MessageBase* destination)
+{
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), source->GetPackPointer(), IGTL_HEADER_SIZE);
+  header->Unpack();
+  destination->SetMessageHeader(header);
+  destination->AllocatePack();
+  memcpy(destination->GetPackBodyPointer(), source->GetPackBodyPointer(), source->GetPackBodySize());
+  EXPECT_EQ(destination->Unpack(1) & igtl::MessageHeader::UNPACK_BODY, (int)igtl::MessageHeader::UNPACK_BODY);
+}
+
+TEST(MessageBaseTest, MetaDataStoreTest)
+{
+  igtl::StatusMessage::Pointer sendMsg = igtl::StatusMessage::New();
+  sendMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  EXPECT_TRUE(sendMsg->SetMetaDataElement("Zeta", IANA_TYPE_US_ASCII, "last"));
+  EXPECT_TRUE(sendMsg->SetMetaDataElement("Alpha", IANA_TYPE_UTF_8, "a"));
+  EXPECT_TRUE(sendMsg->SetMetaDataElement("Mid", igtl_uint32(42)));
+  // Replaced values: longer, then shorter than the previous one.
+  EXPECT_TRUE(sendMsg->SetMetaDataElement("Alpha", IANA_TYPE_UTF_8, "first value"));
+  EXPECT_TRUE(sendMsg->SetMetaDataElement("Zeta", IANA_TYPE_US_ASCII, "z"));
+  EXPECT_EQ(sendMsg->GetMetaDataSize(), (igtlUint32)(5 + 11 + 3 + 2 + 4 + 1));
+  EXPECT_EQ(sendMsg->GetMetaDataHeaderSize(), (igtlUint16)(2 + 3 * 8));
+  sendMsg->Pack();
+
+  igtl::StatusMessage::Pointer receiveMsg = igtl::StatusMessage::New();
+  ReceiveMessage(sendMsg, receiveMsg);
+
+  std::string value;
+  IANA_ENCODING_TYPE encoding;
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Alpha", encoding, value));
+  EXPECT_EQ(encoding, IANA_TYPE_UTF_8);
+  EXPECT_EQ(value, "first value");
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Mid", value));
+  EXPECT_EQ(value, "42");
+  EXPECT_FALSE(receiveMsg->GetMetaDataElement("Mi", value));
+  EXPECT_EQ(receiveMsg->GetMetaDataSize(), sendMsg->GetMetaDataSize());
+
+  // The map is sorted by key as before.
+  const igtl::MessageBase::MetaDataMap& metaData = receiveMsg->GetMetaData();
+  ASSERT_EQ(metaData.size(), (size_t)3);
+  igtl::MessageBase::MetaDataMap::const_iterator it = metaData.begin();
+  EXPECT_EQ(it->first, "Alpha");
+  EXPECT_EQ((++it)->first, "Mid");
+  EXPECT_EQ((++it)->first, "Zeta");
+  EXPECT_EQ(it->second.second, "z");
+
+  // The meta data outlives the buffer it was received in.
+  igtl::MessageBase::Pointer clone = receiveMsg->Clone();
+  receiveMsg->ReleaseBuffer();
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Zeta", value));
+  EXPECT_EQ(value, "z");
+  EXPECT_TRUE(clone->GetMetaDataElement("Alpha", value));
+  EXPECT_EQ(value, "first value");
+
+  // A message received without being read is replaced by the next one.
+  igtl::StatusMessage::Pointer nextMsg = igtl::StatusMessage::New();
+  nextMsg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  nextMsg->SetMetaDataElement("Other", IANA_TYPE_US_ASCII, "1");
+  nextMsg->Pack();
+  ReceiveMessage(sendMsg, receiveMsg);
+  ReceiveMessage(nextMsg, receiveMsg);
+  EXPECT_FALSE(receiveMsg->GetMetaDataElement("Alpha", value));
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Other", value));
+  EXPECT_EQ(receiveMsg->GetMetaData().size(), (size_t)1);
+
+  // Elements can be added to the meta data of a received message.
+  ReceiveMessage(sendMsg, receiveMsg);
+  EXPECT_TRUE(receiveMsg->SetMetaDataElement("Beta", IANA_TYPE_US_ASCII, "b"));
+  EXPECT_EQ(receiveMsg->GetMetaData().size(), (size_t)4);
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Alpha", value));
+  EXPECT_EQ(value, "first value");
+  EXPECT_TRUE(receiveMsg->GetMetaDataElement("Beta", value));
+  EXPECT_EQ(value, "b");
+}
+
+TEST(MessageBaseTest, MetaDataStoreGrowthTest)
+{
+  // More entries and bytes than the inline storage holds.
+  igtl::MetaDataStore store;
+  std::string longValue(300, 'v');
+  for (int i = 0; i < 40; i ++)
+    {
+    char key[16];
+    sprintf(key, "key%02d", 39 - i);
+    store.Set(key, (igtlUint16)strlen(key), IANA_TYPE_US_ASCII, longValue.c_str(), (igtlUint32)(i + 1));
+    }
+  ASSERT_EQ(store.GetNumberOfEntries(), 40);
+  for (int i = 0; i < 40; i ++)
+    {
+    char key[16];
+    sprintf(key, "key%02d", i);
+    EXPECT_EQ(store.Find(key, strlen(key)), i);
+    EXPECT_EQ(store.GetValueSize(i), (igtlUint32)(40 - i));
+    }
+
+  // Replacing a value over and over does not grow the store without bound.
+  igtlUint32 dataSize = store.GetDataSize();
+  for (int n = 0; n < 1000; n ++)
+    {
+    store.Set("key00", 5, IANA_TYPE_US_ASCII, longValue.c_str(), (igtlUint32)(41 + n % 200));
+    }
+  EXPECT_EQ(store.GetDataSize(), dataSize - 40 + 41 + 999 % 200);
+  EXPECT_EQ(memcmp(store.GetValue(0), longValue.c_str(), store.GetValueSize(0)), 0);
+
+  igtl::MetaDataStore copy(store);
+  store.Clear();
+  EXPECT_EQ(store.GetNumberOfEntries(), 0);
+  EXPECT_EQ(copy.GetNumberOfEntries(), 40);
+  EXPECT_EQ(copy.Find("key39", 5), 39);
+  EXPECT_EQ(std::string(copy.GetKey(39), copy.GetKeySize(39)), "key39");
+
+  // Serialized meta data is attached without copying.
+  std::vector<unsigned char> header(2 + copy.GetNumberOfEntries() * 8);
+  std::vector<unsigned char> data(copy.GetDataSize());
+  copy.Serialize(&header[0], &data[0]);
+  EXPECT_TRUE(store.Attach(&header[0], header.size(), &data[0], data.size()));
+  EXPECT_TRUE(store.IsAttached());
+  EXPECT_EQ(store.GetNumberOfEntries(), 40);
+  EXPECT_EQ(store.GetKey(0), (const char*)&data[0]);
+  store.Detach();
+  EXPECT_FALSE(store.IsAttached());
+  memset(&data[0], 0, data.size());
+  EXPECT_EQ(store.Find("key05", 5), 5);
+  EXPECT_EQ(store.GetDataSize(), copy.GetDataSize());
+
+  // Truncated meta data keeps the complete entries.
+  copy.Serialize(&header[0], &data[0]);
+  EXPECT_FALSE(store.Attach(&header[0], header.size(), &data[0], 5 + copy.GetValueSize(0) + 3));
+  EXPECT_EQ(store.GetNumberOfEntries(), 1);
+}
+#endif
+
 
 int main(int argc, char **argv)
 {
@@ -0,0 +1,291 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlMessageCaptureWriter.h"
+#include "igtlMessageCaptureReader.h"
+#include "igtlMessageReplayer.h"
+#include "igtlEventLoopServer.h"
+#include "igtlMessageHandlerMacro.h"
+#include "igtlClientSocket.h"
+#include "igtlTransformMessage.h"
+#include "igtlImageMessage.h"
+#include "igtlStatusMessage.h"
+#include "igtlStringMessage.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#define CAPTURE_FILE  "igtlMessageCaptureTest.igtlcap"
+
+igtlMessageHandlerClassMacro(igtl::TransformMessage, CaptureTransformHandler, int);
+
+int CaptureTransformHandler::Process(igtl::TransformMessage*, int* count)
+{
+  (*count) ++;
+  return 1;
+}
+
+igtl::TransformMessage::Pointer CreateTransform(const char* name, float x)
+{
+  igtl::TransformMessage::Pointer transform = igtl::TransformMessage::New();
+  transform->SetDeviceName(name);
+  igtl::Matrix4x4 matrix;
+  igtl::IdentityMatrix(matrix);
+  matrix[0][3] = x;
+  transform->SetMatrix(matrix);
+  transform->Pack();
+  return transform;
+}
+
+igtl::ImageMessage::Pointer CreateImage()
+{
+  igtl::ImageMessage::Pointer image = igtl::ImageMessage::New();
+  image->SetDeviceName("Ultrasound");
+  image->SetDimensions(512, 256, 1);
+  image->SetScalarType(igtl::ImageMessage::TYPE_UINT8);
+  image->AllocateScalars();
+  unsigned char* p = (unsigned char*)image->GetScalarPointer();
+  for (int i = 0; i < image->GetImageSize(); i ++)
+    {
+    p[i] = (unsigned char)(i * 7);
+    }
+  image->Pack();
+  return image;
+}
+
+void ReadFile(const char* filename, std::vector<char>& data)
+{
+  std::ifstream file(filename, std::ios::binary);
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const char* filename, const char* data, size_t size)
+{
+  std::ofstream file(filename, std::ios::binary);
+  file.write(data, size);
+}
+
+TEST(MessageCaptureTest, WriteReadFormatVersion1)
+{
+  const igtlUint64 t0 = 1700000000000000000ULL;
+  igtl::TransformMessage::Pointer transform = CreateTransform("Tracker", 12.5f);
+  igtl::StringMessage::Pointer string = igtl::StringMessage::New();
+  string->SetDeviceName("Notes");
+  string->SetString("Capture test");
+  string->Pack();
+  igtl::ImageMessage::Pointer image = CreateImage();
+
+  igtl::MessageCaptureWriter::Pointer writer = igtl::MessageCaptureWriter::New();
+  ASSERT_EQ(writer->Open(CAPTURE_FILE), 0);
+  EXPECT_EQ(writer->WriteMessage(transform, t0), 1);
+  EXPECT_EQ(writer->WriteMessage(string, t0 + 10000000), 1);
+  EXPECT_EQ(writer->WriteMessage(image, t0 + 20000000), 1);
+  EXPECT_EQ(writer->GetNumberOfMessages(), 3);
+  writer->Close();
+
+  igtl::MessageCaptureReader::Pointer reader = igtl::MessageCaptureReader::New();
+  ASSERT_EQ(reader->Open(CAPTURE_FILE), 0);
+  EXPECT_FALSE(reader->GetIndexRecovered());
+  ASSERT_EQ(reader->GetNumberOfMessages(), 3);
+  igtl::MessageBase* sent[3] = { transform, string, image };
+  for (int i = 0; i < 3; i ++)
+    {
+    EXPECT_EQ(reader->GetMessageTime(i), t0 + i * 10000000);
+    ASSERT_EQ(reader->GetMessageSize(i), (igtlUint64)sent[i]->GetPackSize());
+    EXPECT_EQ(memcmp(reader->GetMessagePointer(i), sent[i]->GetPackPointer(), sent[i]->GetPackSize()), 0);
+    }
+  EXPECT_EQ(reader->FindMessage(0), 0);
+  EXPECT_EQ(reader->FindMessage(t0 + 5000000), 1);
+  EXPECT_EQ(reader->FindMessage(t0 + 20000000), 2);
+  EXPECT_EQ(reader->FindMessage(t0 + 30000000), 3);
+  EXPECT_TRUE(reader->CreateMessage(3).IsNull());
+
+  // A small message is copied.
+  igtl::MessageBase::Pointer message = reader->CreateMessage(0);
+  igtl::TransformMessage::Pointer receivedTransform = dynamic_cast<igtl::TransformMessage*>(message.GetPointer());
+  ASSERT_TRUE(receivedTransform.IsNotNull());
+  EXPECT_STREQ(receivedTransform->GetDeviceName(), "Tracker");
+  ASSERT_TRUE(receivedTransform->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  igtl::Matrix4x4 matrix;
+  receivedTransform->GetMatrix(matrix);
+  EXPECT_EQ(matrix[0][3], 12.5f);
+
+  // The image is mapped. Unpacking converts the mapped copy only; the file
+  // and other messages created from it are not affected.
+  for (int k = 0; k < 2; k ++)
+    {
+    message = reader->CreateMessage(2);
+    igtl::ImageMessage::Pointer receivedImage = dynamic_cast<igtl::ImageMessage*>(message.GetPointer());
+    ASSERT_TRUE(receivedImage.IsNotNull());
+    ASSERT_TRUE(receivedImage->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+    int size[3];
+    receivedImage->GetDimensions(size);
+    EXPECT_EQ(size[0], 512);
+    EXPECT_EQ(size[1], 256);
+    EXPECT_EQ(memcmp(receivedImage->GetScalarPointer(), image->GetScalarPointer(), image->GetImageSize()), 0);
+    }
+  EXPECT_EQ(memcmp(reader->GetMessagePointer(2), image->GetPackPointer(), image->GetPackSize()), 0);
+
+  // Messages remain valid after the reader has been closed.
+  message = reader->CreateMessage(2);
+  reader->Close();
+  EXPECT_EQ(reader->GetNumberOfMessages(), 0);
+  EXPECT_TRUE(message->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+}
+
+TEST(MessageCaptureTest, RecoveryFormatVersion1)
+{
+  igtl::MessageCaptureWriter::Pointer writer = igtl::MessageCaptureWriter::New();
+  ASSERT_EQ(writer->Open(CAPTURE_FILE), 0);
+  igtlUint64 end[3];
+  for (int i = 0; i < 3; i ++)
+    {
+    writer->WriteMessage(CreateTransform("Tracker", (float)i));
+    writer->Flush();
+    std::vector<char> data;
+    ReadFile(CAPTURE_FILE, data);
+    end[i] = data.size();
+    }
+  writer->Close();
+
+  // The writer has been terminated while writing the third message.
+  std::vector<char> data;
+  ReadFile(CAPTURE_FILE, data);
+  WriteFile(CAPTURE_FILE, &data[0], (size_t)(end[1] + end[2]) / 2);
+
+  igtl::MessageCaptureReader::Pointer reader = igtl::MessageCaptureReader::New();
+  ASSERT_EQ(reader->Open(CAPTURE_FILE), 0);
+  EXPECT_TRUE(reader->GetIndexRecovered());
+  ASSERT_EQ(reader->GetNumberOfMessages(), 2);
+  igtl::TransformMessage::Pointer transform = dynamic_cast<igtl::TransformMessage*>(reader->CreateMessage(1).GetPointer());
+  ASSERT_TRUE(transform.IsNotNull());
+  ASSERT_TRUE(transform->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  igtl::Matrix4x4 matrix;
+  transform->GetMatrix(matrix);
+  EXPECT_EQ(matrix[0][3], 1.0f);
+  reader->Close();
+
+  // Not a capture file
+  WriteFile(CAPTURE_FILE, "OpenIGTLink capture?", 20);
+  EXPECT_EQ(reader->Open(CAPTURE_FILE), -1);
+  EXPECT_FALSE(reader->IsOpen());
+}
+
+TEST(MessageCaptureTest, EventLoopServerFormatVersion1)
+{
+  int count = 0;
+  CaptureTransformHandler::Pointer handler = CaptureTransformHandler::New();
+  handler->SetData(&count);
+  igtl::MessageCaptureWriter::Pointer writer = igtl::MessageCaptureWriter::New();
+  ASSERT_EQ(writer->Open(CAPTURE_FILE), 0);
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  server->AddMessageHandler(handler);
+  server->SetCaptureWriter(writer);
+  ASSERT_EQ(server->CreateServer(0), 0);
+
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+
+  // The status message has no handler but is recorded as well.
+  igtl::StatusMessage::Pointer status = igtl::StatusMessage::New();
+  status->SetDeviceName("Device");
+  status->SetStatusString("Captured without a handler");
+  status->Pack();
+  igtl::TransformMessage::Pointer transform = CreateTransform("Tracker", 3.0f);
+  ASSERT_EQ(client->Send(status->GetPackPointer(), status->GetPackSize()), 1);
+  ASSERT_EQ(client->Send(transform->GetPackPointer(), transform->GetPackSize()), 1);
+  for (int i = 0; i < 200 && count < 1; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(count, 1);
+  client->CloseSocket();
+  server->CloseServer();
+  writer->Close();
+
+  igtl::MessageCaptureReader::Pointer reader = igtl::MessageCaptureReader::New();
+  ASSERT_EQ(reader->Open(CAPTURE_FILE), 0);
+  ASSERT_EQ(reader->GetNumberOfMessages(), 2);
+  ASSERT_EQ(reader->GetMessageSize(0), (igtlUint64)status->GetPackSize());
+  EXPECT_EQ(memcmp(reader->GetMessagePointer(0), status->GetPackPointer(), status->GetPackSize()), 0);
+  ASSERT_EQ(reader->GetMessageSize(1), (igtlUint64)transform->GetPackSize());
+  EXPECT_EQ(memcmp(reader->GetMessagePointer(1), transform->GetPackPointer(), transform->GetPackSize()), 0);
+  EXPECT_LE(reader->GetMessageTime(0), reader->GetMessageTime(1));
+}
+
+TEST(MessageCaptureTest, ReplayFormatVersion1)
+{
+  // Five messages 20 ms apart
+  const int numberOfMessages = 5;
+  const igtlUint64 t0 = 1700000000000000000ULL;
+  igtl::MessageCaptureWriter::Pointer writer = igtl::MessageCaptureWriter::New();
+  ASSERT_EQ(writer->Open(CAPTURE_FILE), 0);
+  for (int i = 0; i < numberOfMessages; i ++)
+    {
+    writer->WriteMessage(CreateTransform("Tracker", (float)i), t0 + i * 20000000ULL);
+    }
+  writer->Close();
+  igtl::MessageCaptureReader::Pointer reader = igtl::MessageCaptureReader::New();
+  ASSERT_EQ(reader->Open(CAPTURE_FILE), 0);
+
+  int count = 0;
+  CaptureTransformHandler::Pointer handler = CaptureTransformHandler::New();
+  handler->SetData(&count);
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  server->AddMessageHandler(handler);
+  ASSERT_EQ(server->CreateServer(0), 0);
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+
+  igtl::MessageReplayer::Pointer replayer = igtl::MessageReplayer::New();
+  EXPECT_EQ(replayer->Replay(), -1);
+  replayer->SetReader(reader);
+  replayer->SetSocket(client);
+
+  // At the maximum rate
+  replayer->SetSpeed(0);
+  EXPECT_EQ(replayer->Replay(), numberOfMessages);
+  for (int i = 0; i < 200 && count < numberOfMessages; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(count, numberOfMessages);
+
+  // Twice as fast as recorded: the last message is sent after 40 ms.
+  replayer->SetSpeed(2.0);
+  igtlUint64 start = igtl::TimeStamp::GetMonotonicTimeInNanoseconds();
+  EXPECT_EQ(replayer->Replay(1), numberOfMessages - 1);
+  igtlUint64 elapsed = igtl::TimeStamp::GetMonotonicTimeInNanoseconds() - start;
+  EXPECT_GE(elapsed, 30000000u);
+  EXPECT_LT(elapsed, 1000000000u);
+  for (int i = 0; i < 200 && count < 2 * numberOfMessages - 1; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(count, 2 * numberOfMessages - 1);
+
+  client->CloseSocket();
+  server->CloseServer();
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  int result = RUN_ALL_TESTS();
+  remove(CAPTURE_FILE);
+  return result;
+}
@@ -21,6 +21,8 @@
 #include "igtl_util.h"
 #include "igtlTestConfig.h"
 #include "string.h"
+#include <algorithm>
+#include <vector>
 
 igtl::ImageMessage::Pointer imageSendMsg = igtl::ImageMessage::New();
 igtl::ImageMessage::Pointer imageReceiveMsg = igtl::ImageMessage::New();
@@ -73,31 +75,38 @@ void BuildUp()
 TEST(MessageRTPWrapperTest, WrapMessageFormatVersion2)
 {
   BuildUp();
-  igtl::PacketBuffer bufferedMsg = messageWrapperSenderSide->GetOutGoingPackets();
+  const igtl::PacketBuffer& bufferedMsg = messageWrapperSenderSide->GetOutGoingPackets();
+  EXPECT_EQ(bufferedMsg.GetNumberOfPackets(), 3);
+  int packetLength = 0;
   //First Packet excluding time stamp comparison
-  int r = memcmp(bufferedMsg.pBsBuf.data(), (const void*)test_RTPWrapper_PacketBuffer, 4);
+  const unsigned char* packet = bufferedMsg.GetPacket(0, &packetLength);
+  EXPECT_EQ(packetLength, UDPPacketLength+RTP_HEADER_LENGTH);
+  int r = memcmp(packet, (const void*)test_RTPWrapper_PacketBuffer, 4);
   EXPECT_EQ(r, 0);
-  r = memcmp(bufferedMsg.pBsBuf.data()+8, (const void*)(test_RTPWrapper_PacketBuffer+8), 4);
+  r = memcmp(packet+8, (const void*)(test_RTPWrapper_PacketBuffer+8), 4);
   EXPECT_EQ(r, 0);
-  r = memcmp(bufferedMsg.pBsBuf.data()+RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+RTP_HEADER_LENGTH), UDPPacketLength);
+  r = memcmp(packet+RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+RTP_HEADER_LENGTH), UDPPacketLength);
   EXPECT_EQ(r, 0);
   
   //Second Packet excluding time stamp comparison
-  r = memcmp(bufferedMsg.pBsBuf.data()+UDPPacketLength+RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+RTP_HEADER_LENGTH), 4);
+  packet = bufferedMsg.GetPacket(1, &packetLength);
+  EXPECT_EQ(packetLength, UDPPacketLength+RTP_HEADER_LENGTH);
+  r = memcmp(packet, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+RTP_HEADER_LENGTH), 4);
   EXPECT_EQ(r, 0);
-  r = memcmp(bufferedMsg.pBsBuf.data()+UDPPacketLength+RTP_HEADER_LENGTH+8, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+RTP_HEADER_LENGTH+8), 4);
+  r = memcmp(packet+8, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+RTP_HEADER_LENGTH+8), 4);
   EXPECT_EQ(r, 0);//
-  r = memcmp(bufferedMsg.pBsBuf.data()+UDPPacketLength+2*RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+2*RTP_HEADER_LENGTH), UDPPacketLength);
+  r = memcmp(packet+RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+UDPPacketLength+2*RTP_HEADER_LENGTH), UDPPacketLength);
   EXPECT_EQ(r, 0);//
   
   //Third Packet excluding time stamp comparison
-  r = memcmp(bufferedMsg.pBsBuf.data()+2*UDPPacketLength+2*RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+2*RTP_HEADER_LENGTH), 4);
+  packet = bufferedMsg.GetPacket(2, &packetLength);
+  EXPECT_EQ(packetLength, bufferedMsg.GetTotalLength()-2*UDPPacketLength-2*RTP_HEADER_LENGTH);
+  r = memcmp(packet, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+2*RTP_HEADER_LENGTH), 4);
   EXPECT_EQ(r, 0);
-  r = memcmp(bufferedMsg.pBsBuf.data()+2*UDPPacketLength+2*RTP_HEADER_LENGTH+8, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+2*RTP_HEADER_LENGTH+8), 4);
+  r = memcmp(packet+8, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+2*RTP_HEADER_LENGTH+8), 4);
   EXPECT_EQ(r, 0);//
-  r = memcmp(bufferedMsg.pBsBuf.data()+2*UDPPacketLength+3*RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+3*RTP_HEADER_LENGTH),bufferedMsg.totalLength-2*UDPPacketLength-3*RTP_HEADER_LENGTH);
+  r = memcmp(packet+RTP_HEADER_LENGTH, (const void*)(test_RTPWrapper_PacketBuffer+2*UDPPacketLength+3*RTP_HEADER_LENGTH),packetLength-RTP_HEADER_LENGTH);
   EXPECT_EQ(r, 0);
-  //TestDebugCharArrayCmp(bufferedMsg.pBsBuf.data(), (igtlUint8*)test_RTPWrapper_PacketBuffer , bufferedMsg.totalLength);
 }
 
 TEST(MessageRTPWrapperTest, UnwrapMessageFormatVersion2)
@@ -105,12 +114,12 @@ TEST(MessageRTPWrapperTest, UnwrapMessageFormatVersion2)
   BuildUp();
   messageWrapperReceiverSide = igtl::MessageRTPWrapper::New();
   messageWrapperReceiverSide->SetRTPPayloadLength(UDPPacketLength);
-  igtl::PacketBuffer bufferedMsg = messageWrapperSenderSide->GetOutGoingPackets();
-  igtlUint8* UDPPacket = bufferedMsg.pBsBuf.data();
-  for (int i= 0; i<bufferedMsg.pPacketLengthInByte.size();i++)
+  const igtl::PacketBuffer& bufferedMsg = messageWrapperSenderSide->GetOutGoingPackets();
+  int packetLength = 0;
+  for (int i= 0; i<bufferedMsg.GetNumberOfPackets();i++)
   {
-    messageWrapperReceiverSide->PushDataIntoPacketBuffer(UDPPacket, bufferedMsg.pPacketLengthInByte[i]);
-    UDPPacket += bufferedMsg.pPacketLengthInByte[i];
+    const igtlUint8* UDPPacket = bufferedMsg.GetPacket(i, &packetLength);
+    messageWrapperReceiverSide->PushDataIntoPacketBuffer((igtlUint8*)UDPPacket, packetLength);
   }
   while(1)
   {
@@ -165,11 +174,10 @@ TEST(MessageRTPWrapperTest, UnwrapMessageFormatVersion2)
   // Test the packet reorder function of the RTP Wrapper. In the following lines, we reverse the order of received UDPPackets.
   messageWrapperReceiverSide = igtl::MessageRTPWrapper::New();
   messageWrapperReceiverSide->SetRTPPayloadLength(UDPPacketLength);
-  UDPPacket = bufferedMsg.pBsBuf.data()+bufferedMsg.totalLength;
-  for (int i = bufferedMsg.pPacketLengthInByte.size()-1; i>=0;i--)
+  for (int i = bufferedMsg.GetNumberOfPackets()-1; i>=0;i--)
   {
-    UDPPacket -= bufferedMsg.pPacketLengthInByte[i];
-    messageWrapperReceiverSide->PushDataIntoPacketBuffer(UDPPacket, bufferedMsg.pPacketLengthInByte[i]);
+    const igtlUint8* UDPPacket = bufferedMsg.GetPacket(i, &packetLength);
+    messageWrapperReceiverSide->PushDataIntoPacketBuffer((igtlUint8*)UDPPacket, packetLength);
   }
   while(1)
   {
@@ -219,6 +227,215 @@ TEST(MessageRTPWrapperTest, UnwrapMessageFormatVersion2)
   r = memcmp((const char*)imageReceiveMsg->GetPackBodyPointer() + IGTL_IMAGE_HEADER_SIZE + IGTL_EXTENDED_HEADER_SIZE, (const void*)(test_image), (size_t)(TEST_IMAGE_MESSAGE_SIZE));
   EXPECT_EQ(r, 0);
 }
+
+// Wraps 'numberOfMessages' image messages with message IDs 1, 2, ... and
+// returns the packets of each message and the packed messages.
+void WrapMessages(int numberOfMessages, std::vector<std::vector<std::vector<unsigned char> > >& packets,
+                  std::vector<std::vector<unsigned char> >& packs)
+{
+  packets.resize(numberOfMessages);
+  packs.resize(numberOfMessages);
+  for (int m = 0; m < numberOfMessages; m ++)
+    {
+    BuildUp();
+    imageSendMsg->SetMessageID(m + 1);
+    imageSendMsg->Pack();
+    unsigned char* pack = (unsigned char*)imageSendMsg->GetPackPointer();
+    packs[m].assign(pack, pack + imageSendMsg->GetPackSize());
+    igtl::MessageRTPWrapper::Pointer wrapper = igtl::MessageRTPWrapper::New();
+    wrapper->SetRTPPayloadLength(UDPPacketLength);
+    wrapper->WrapMessageAndPushToBuffer(pack, imageSendMsg->GetPackSize());
+    const igtl::PacketBuffer& buffered = wrapper->GetOutGoingPackets();
+    for (int i = 0; i < buffered.GetNumberOfPackets(); i ++)
+      {
+      int length = 0;
+      const unsigned char* packet = buffered.GetPacket(i, &length);
+      packets[m].push_back(std::vector<unsigned char>(packet, packet + length));
+      }
+    }
+}
+
+TEST(MessageRTPWrapperTest, ReassemblyUnderLossFormatVersion2)
+{
+  const int numberOfMessages = 300;
+  std::vector<std::vector<std::vector<unsigned char> > > packets;
+  std::vector<std::vector<unsigned char> > packs;
+  WrapMessages(numberOfMessages, packets, packs);
+  ASSERT_EQ(packets[0].size(), 3);
+
+  // The fragments of a message are held in pages of the fragment size, which
+  // the pooled allocator rounds up by at most 25%.
+  const igtl_uint64 maxFragmentMemory = 2 * (UDPPacketLength + RTP_HEADER_LENGTH) * 5 / 4;
+
+  // Drop the last fragment of every third message and deliver the fragments
+  // of the other messages out of order.
+  igtl::MessageRTPWrapper::Pointer receiver = igtl::MessageRTPWrapper::New();
+  receiver->SetRTPPayloadLength(UDPPacketLength);
+  int numberOfCompleteMessages = 0;
+  for (int m = 0; m < numberOfMessages; m ++)
+    {
+    std::vector<std::vector<unsigned char> > delivered = packets[m];
+    if (m % 3 == 0)
+      {
+      delivered.pop_back();
+      }
+    else
+      {
+      numberOfCompleteMessages ++;
+      }
+    if (m % 2 == 0)
+      {
+      std::reverse(delivered.begin(), delivered.end());
+      }
+    else
+      {
+      std::swap(delivered[0], delivered[1]);
+      }
+    for (size_t i = 0; i < delivered.size(); i ++)
+      {
+      receiver->PushDataIntoPacketBuffer(&delivered[i][0], (igtlUint16)delivered[i].size());
+      }
+    while (receiver->UnWrapPacketWithTypeAndName("IMAGE", "DeviceName"))
+      {
+      }
+    EXPECT_LE(receiver->GetNumberOfReorderBuffers(), ReorderBufferMaximumSize);
+    EXPECT_LE(receiver->GetReorderBufferMemorySize(), receiver->GetNumberOfReorderBuffers() * maxFragmentMemory);
+    }
+  EXPECT_EQ(receiver->unWrappedMessages.size(), numberOfCompleteMessages);
+
+  // The reassembled messages have the size of the sent messages and the same content.
+  int headerSize = IGTL_HEADER_SIZE + IGTL_EXTENDED_HEADER_SIZE;
+  std::map<igtl_uint32, igtl::UnWrappedMessage*>::iterator it;
+  for (it = receiver->unWrappedMessages.begin(); it != receiver->unWrappedMessages.end(); ++it)
+    {
+    igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+    header->InitPack();
+    memcpy(header->GetPackPointer(), it->second->messagePackPointer, IGTL_HEADER_SIZE);
+    header->Unpack();
+    ASSERT_EQ(it->second->messageDataLength, packs[0].size());
+    EXPECT_EQ(header->GetBodySizeToRead() + IGTL_HEADER_SIZE, it->second->messageDataLength);
+    EXPECT_EQ(memcmp(it->second->messagePackPointer + headerSize, &packs[0][headerSize], packs[0].size() - headerSize), 0);
+    }
+
+  // Without the last fragments no message completes; the number of messages
+  // waiting for fragments is limited and so is the memory they hold.
+  receiver = igtl::MessageRTPWrapper::New();
+  receiver->SetRTPPayloadLength(UDPPacketLength);
+  for (int m = 0; m < numberOfMessages; m ++)
+    {
+    for (size_t i = 0; i + 1 < packets[m].size(); i ++)
+      {
+      receiver->PushDataIntoPacketBuffer(&packets[m][i][0], (igtlUint16)packets[m][i].size());
+      }
+    while (receiver->UnWrapPacketWithTypeAndName("IMAGE", "DeviceName"))
+      {
+      }
+    }
+  EXPECT_EQ(receiver->unWrappedMessages.size(), 0);
+  EXPECT_EQ(receiver->GetNumberOfReorderBuffers(), ReorderBufferMaximumSize);
+  EXPECT_GT(receiver->GetReorderBufferMemorySize(), 0);
+  EXPECT_LE(receiver->GetReorderBufferMemorySize(), ReorderBufferMaximumSize * maxFragmentMemory);
+}
+
+TEST(MessageRTPWrapperTest, BatchedUDPTransferFormatVersion2)
+{
+  const int port = 48950;
+  igtl::UDPClientSocket::Pointer clientSocket = igtl::UDPClientSocket::New();
+  ASSERT_GE(clientSocket->JoinNetwork("127.0.0.1", port), 0);
+  clientSocket->SetReceiveTimeout(1000);
+  igtl::UDPServerSocket::Pointer serverSocket = igtl::UDPServerSocket::New();
+  ASSERT_EQ(serverSocket->CreateUDPServer(), 0);
+  const unsigned char* noPackets[1] = { NULL };
+  int noLengths[1] = { 0 };
+  EXPECT_EQ(serverSocket->WriteSocketBatch(noPackets, noLengths, 1), 0); // No destination
+  serverSocket->AddClient("127.0.0.1", port, 0);
+
+  BuildUp();
+  int numberOfPackets = messageWrapperSenderSide->GetOutGoingPackets().GetNumberOfPackets();
+  EXPECT_EQ(messageWrapperSenderSide->SendBufferedDataWithInterval(serverSocket, 0), 1);
+  EXPECT_EQ(messageWrapperSenderSide->GetOutGoingPackets().GetNumberOfPackets(), 0);
+
+  std::vector<unsigned char> buffer(PacketBatchMaximumNum * (UDPPacketLength + RTP_HEADER_LENGTH));
+  unsigned char* packets[PacketBatchMaximumNum];
+  int packetLengths[PacketBatchMaximumNum];
+  for (int i = 0; i < PacketBatchMaximumNum; i ++)
+    {
+    packets[i] = &buffer[i * (UDPPacketLength + RTP_HEADER_LENGTH)];
+    }
+  messageWrapperReceiverSide = igtl::MessageRTPWrapper::New();
+  messageWrapperReceiverSide->SetRTPPayloadLength(UDPPacketLength);
+  int numberOfReceived = 0;
+  while (numberOfReceived < numberOfPackets)
+    {
+    int n = clientSocket->ReadSocketBatch(packets, UDPPacketLength + RTP_HEADER_LENGTH, packetLengths, PacketBatchMaximumNum);
+    ASSERT_GT(n, 0);
+    EXPECT_EQ(messageWrapperReceiverSide->PushDataIntoPacketBuffer(packets, packetLengths, n), n);
+    numberOfReceived += n;
+    }
+  EXPECT_EQ(numberOfReceived, numberOfPackets);
+  while (messageWrapperReceiverSide->UnWrapPacketWithTypeAndName("IMAGE", "DeviceName"))
+    {
+    }
+  ASSERT_EQ(messageWrapperReceiverSide->unWrappedMessages.size(), 1);
+  igtl::UnWrappedMessage* message = messageWrapperReceiverSide->unWrappedMessages.begin()->second;
+  EXPECT_EQ(message->messageDataLength, imageSendMsg->GetPackSize());
+  int headerSize = IGTL_HEADER_SIZE + IGTL_EXTENDED_HEADER_SIZE;
+  EXPECT_EQ(memcmp(message->messagePackPointer + headerSize, (unsigned char*)imageSendMsg->GetPackPointer() + headerSize,
+                   imageSendMsg->GetPackSize() - headerSize), 0);
+
+  // Nothing is queued any more.
+  clientSocket->SetReceiveTimeout(10);
+  EXPECT_EQ(clientSocket->ReadSocketBatch(packets, UDPPacketLength + RTP_HEADER_LENGTH, packetLengths, PacketBatchMaximumNum), -1);
+  serverSocket->CloseSocket();
+  clientSocket->CloseSocket();
+}
+
+TEST(MessageRTPWrapperTest, PacketBufferRingFormatVersion2)
+{
+  igtl::PacketBuffer buffer(4, 16);
+  unsigned char packet[16];
+  unsigned char out[16];
+  int length = 0;
+
+  // A packet larger than a slot is rejected.
+  EXPECT_EQ(buffer.PushBack(packet, 17), 0);
+  EXPECT_EQ(buffer.PopFront(out), 0);
+
+  // Push six packets of 1 to 6 bytes filled with their index; the first two
+  // packets are dropped as the ring has four slots.
+  for (int i = 0; i < 6; i ++)
+    {
+    memset(packet, i, sizeof(packet));
+    EXPECT_EQ(buffer.PushBack(packet, i+1), 1);
+    }
+  EXPECT_EQ(buffer.GetNumberOfPackets(), 4);
+  EXPECT_EQ(buffer.GetNumberOfDroppedPackets(), 2);
+  EXPECT_EQ(buffer.GetTotalLength(), 3+4+5+6);
+  const unsigned char* p = buffer.GetPacket(0, &length);
+  EXPECT_EQ(length, 3);
+  EXPECT_EQ(p[0], 2);
+  p = buffer.GetPacket(3, &length);
+  EXPECT_EQ(length, 6);
+  EXPECT_EQ(p[5], 5);
+  EXPECT_TRUE(buffer.GetPacket(4, &length) == NULL);
+
+  // First come, first served from the front; last come, first served from the back.
+  EXPECT_EQ(buffer.PopFront(out), 3);
+  EXPECT_EQ(out[0], 2);
+  EXPECT_EQ(buffer.PopBack(out), 6);
+  EXPECT_EQ(out[0], 5);
+  memset(packet, 9, sizeof(packet));
+  EXPECT_EQ(buffer.PushBack(packet, 16), 1);
+  EXPECT_EQ(buffer.PopBack(out), 16);
+  EXPECT_EQ(out[15], 9);
+  EXPECT_EQ(buffer.PopFront(out), 4);
+  EXPECT_EQ(out[0], 3);
+  EXPECT_EQ(buffer.PopFront(out), 5);
+  EXPECT_EQ(out[0], 4);
+  EXPECT_EQ(buffer.PopFront(out), 0);
+  EXPECT_EQ(buffer.PopBack(out), 0);
+  EXPECT_EQ(buffer.GetTotalLength(), 0);
+}
 #endif
 
 int main(int argc, char **argv)
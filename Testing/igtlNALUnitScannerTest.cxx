@@ -0,0 +1,153 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlNALUnitScanner.h"
+#include "igtlTestConfig.h"
+
+#include <cstdlib>
+#include <vector>
+
+// Splits a stream by searching for start codes byte by byte: a unit ends
+// where a 4- or 3-byte start code begins after the start code of the unit.
+bool IsStartCode(const std::vector<igtlUint8>& stream, size_t pos, size_t length)
+{
+  if (pos + length > stream.size())
+    {
+    return false;
+    }
+  for (size_t i = 0; i < length - 1; i ++)
+    {
+    if (stream[pos + i] != 0)
+      {
+      return false;
+      }
+    }
+  return stream[pos + length - 1] == 1;
+}
+
+
+std::vector<igtlUint64> ReferenceUnitSizes(const std::vector<igtlUint8>& stream)
+{
+  std::vector<igtlUint64> sizes;
+  size_t pos = 0;
+  while (pos < stream.size())
+    {
+    size_t i = 1;
+    if (IsStartCode(stream, pos, 4))
+      {
+      i = 4;
+      }
+    else if (IsStartCode(stream, pos, 3))
+      {
+      i = 3;
+      }
+    for (; pos + i < stream.size(); i ++)
+      {
+      if (IsStartCode(stream, pos + i, 4) || IsStartCode(stream, pos + i, 3))
+        {
+        break;
+        }
+      }
+    sizes.push_back(i);
+    pos += i;
+    }
+  return sizes;
+}
+
+
+std::vector<igtlUint64> ScannerUnitSizes(const std::vector<igtlUint8>& stream)
+{
+  std::vector<igtlUint64> sizes;
+  igtl::NALUnitScanner scanner(stream.empty() ? NULL : &stream[0], stream.size());
+  const igtlUint8* unit = NULL;
+  igtlUint64 size = 0;
+  const igtlUint8* expected = stream.empty() ? NULL : &stream[0];
+  while (scanner.GetNextNALUnit(&unit, &size))
+    {
+    EXPECT_EQ(unit, expected);
+    expected += size;
+    sizes.push_back(size);
+    }
+  return sizes;
+}
+
+
+TEST(NALUnitScannerTest, FindStartCodeFormatVersion1)
+{
+  const igtlUint8 stream[] = {0x67, 0x00, 0x00, 0x01, 0x68, 0x00, 0x00, 0x00, 0x01, 0x65, 0x00, 0x00};
+  const igtlUint8* end = stream + sizeof(stream);
+  int length = 0;
+
+  EXPECT_EQ(igtl::FindNALStartCode(stream, end, &length), stream + 1);
+  EXPECT_EQ(length, 3);
+  EXPECT_EQ(igtl::FindNALStartCode(stream + 2, end, &length), stream + 5);
+  EXPECT_EQ(length, 4);
+  // The leading zero of a 4-byte start code before 'begin' is not part of it.
+  EXPECT_EQ(igtl::FindNALStartCode(stream + 6, end, &length), stream + 6);
+  EXPECT_EQ(length, 3);
+  EXPECT_EQ(igtl::FindNALStartCode(stream + 7, end, &length), end);
+  EXPECT_EQ(igtl::FindNALStartCode(stream, stream + 3, &length), stream + 3);
+  EXPECT_EQ(igtl::FindNALStartCode(stream, stream + 2, &length), stream + 2);
+}
+
+
+TEST(NALUnitScannerTest, SplitStreamFormatVersion1)
+{
+  // Random streams with a high density of zero and one bytes, so that every
+  // combination of start codes, zero runs and stream boundaries occurs.
+  srand(7);
+  for (int n = 0; n < 2000; n ++)
+    {
+    std::vector<igtlUint8> stream(rand() % 64);
+    for (size_t i = 0; i < stream.size(); i ++)
+      {
+      int r = rand() % 4;
+      stream[i] = r < 2 ? 0 : (r == 2 ? 1 : (igtlUint8)(rand() & 0xFF));
+      }
+    std::vector<igtlUint64> expected = ReferenceUnitSizes(stream);
+    std::vector<igtlUint64> sizes = ScannerUnitSizes(stream);
+    EXPECT_EQ(sizes, expected);
+    }
+
+  // A frame with parameter sets and several slices.
+  std::vector<igtlUint8> frame;
+  const int units = 5;
+  const int unitSize[units] = {12, 5, 3000, 70000, 2};
+  for (int u = 0; u < units; u ++)
+    {
+    if (u == 0 || u == 3)
+      {
+      frame.push_back(0);
+      }
+    frame.push_back(0);
+    frame.push_back(0);
+    frame.push_back(1);
+    for (int i = 0; i < unitSize[u]; i ++)
+      {
+      frame.push_back((igtlUint8)(2 + rand() % 254));
+      }
+    }
+  std::vector<igtlUint64> sizes = ScannerUnitSizes(frame);
+  ASSERT_EQ(sizes.size(), (size_t)units);
+  for (int u = 0; u < units; u ++)
+    {
+    EXPECT_EQ(sizes[u], (igtlUint64)(unitSize[u] + ((u == 0 || u == 3) ? 4 : 3)));
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
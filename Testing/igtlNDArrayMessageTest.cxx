@@ -15,6 +15,7 @@
 #include "igtlutil/igtl_test_data_ndarray.h"
 #include "igtl_ndarray.h"
 #include "igtl_header.h"
+#include "igtl_util.h"
 #include "igtlTestConfig.h"
 #include "string.h"
 
@@ -131,6 +132,197 @@ TEST(NDArrayMessageTest, 64BitConversion)
   EXPECT_EQ(r, 0);
 }
 
+TEST(NDArrayMessageTest, PackCRCFormatVersion2)
+{
+  // The array is larger than a CRC block of the fused pack path and the
+  // message carries meta data, so that the CRC covers every body segment.
+  std::vector<igtlUint16> largeSize(2);
+  largeSize[0] = 257;
+  largeSize[1] = 33;
+  igtl::Array<igtl_int16> largeArray;
+  largeArray.SetSize(largeSize);
+  igtl_int16* raw = (igtl_int16*)largeArray.GetRawArray();
+  for (int i = 0; i < 257 * 33; i ++)
+    {
+    raw[i] = (igtl_int16)(i * 7919);
+    }
+
+  igtl::NDArrayMessage::Pointer msg = igtl::NDArrayMessage::New();
+  msg->SetDeviceName("DeviceName");
+  msg->SetArray(igtl::NDArrayMessage::TYPE_INT16, &largeArray);
+#if OpenIGTLink_HEADER_VERSION >= 2
+  msg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  msg->SetMetaDataElement("First", IANA_TYPE_US_ASCII, "Value");
+  msg->SetMetaDataElement("Second", IANA_TYPE_US_ASCII, "AnotherValue");
+#endif
+  msg->Pack();
+
+  igtl_header header;
+  memcpy(&header, msg->GetPackPointer(), IGTL_HEADER_SIZE);
+  igtl_header_convert_byte_order(&header);
+  EXPECT_EQ(header.body_size, (igtl_uint64)msg->GetPackBodySize());
+  igtl_uint64 crc = crc64((unsigned char*)msg->GetPackBodyPointer(), msg->GetPackBodySize(), crc64(0, 0, 0LL));
+  EXPECT_EQ(header.crc, crc);
+
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->AllocatePack();
+  memcpy(headerMsg->GetPackPointer(), msg->GetPackPointer(), IGTL_HEADER_SIZE);
+  headerMsg->Unpack();
+  igtl::NDArrayMessage::Pointer receiveMsg = igtl::NDArrayMessage::New();
+  receiveMsg->SetMessageHeader(headerMsg);
+  receiveMsg->AllocatePack();
+  memcpy(receiveMsg->GetPackBodyPointer(), msg->GetPackBodyPointer(), msg->GetPackBodySize());
+  EXPECT_TRUE(receiveMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(memcmp(receiveMsg->GetArray()->GetRawArray(), largeArray.GetRawArray(), largeArray.GetRawArraySize()), 0);
+}
+
+TEST(NDArrayMessageTest, ParallelCRCFormatVersion2)
+{
+  // Large enough to be split into 4 blocks by igtl::ParallelCRC64()
+  std::vector<igtlUint16> largeSize(2);
+  largeSize[0] = 2048;
+  largeSize[1] = 1100;
+  igtl::Array<igtl_int16> largeArray;
+  largeArray.SetSize(largeSize);
+  igtl_int16* raw = (igtl_int16*)largeArray.GetRawArray();
+  for (int i = 0; i < 2048 * 1100; i ++)
+    {
+    raw[i] = (igtl_int16)(i * 7919);
+    }
+
+  igtl::NDArrayMessage::Pointer msg = igtl::NDArrayMessage::New();
+  msg->SetDeviceName("DeviceName");
+  msg->SetArray(igtl::NDArrayMessage::TYPE_INT16, &largeArray);
+#if OpenIGTLink_HEADER_VERSION >= 2
+  msg->SetHeaderVersion(IGTL_HEADER_VERSION_2);
+  msg->SetMetaDataElement("First", IANA_TYPE_US_ASCII, "Value");
+#endif
+  msg->SetCRCNumberOfThreads(4);
+  msg->SetParallelCRCThreshold(1024 * 1024);
+  msg->Pack();
+
+  igtl_header header;
+  memcpy(&header, msg->GetPackPointer(), IGTL_HEADER_SIZE);
+  igtl_header_convert_byte_order(&header);
+  igtl_uint64 crc = crc64((unsigned char*)msg->GetPackBodyPointer(), msg->GetPackBodySize(), crc64(0, 0, 0LL));
+  EXPECT_EQ(header.crc, crc);
+
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->AllocatePack();
+  memcpy(headerMsg->GetPackPointer(), msg->GetPackPointer(), IGTL_HEADER_SIZE);
+  headerMsg->Unpack();
+  igtl::NDArrayMessage::Pointer receiveMsg = igtl::NDArrayMessage::New();
+  receiveMsg->SetCRCNumberOfThreads(4);
+  receiveMsg->SetParallelCRCThreshold(1024 * 1024);
+  receiveMsg->SetMessageHeader(headerMsg);
+  receiveMsg->AllocatePack();
+  memcpy(receiveMsg->GetPackBodyPointer(), msg->GetPackBodyPointer(), msg->GetPackBodySize());
+  EXPECT_TRUE(receiveMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+
+  // A corrupted body must be detected by the parallel check as well
+  receiveMsg->SetMessageHeader(headerMsg);
+  receiveMsg->AllocatePack();
+  memcpy(receiveMsg->GetPackBodyPointer(), msg->GetPackBodyPointer(), msg->GetPackBodySize());
+  ((unsigned char*)receiveMsg->GetPackBodyPointer())[msg->GetPackBodySize() / 2] ^= 0x01;
+  EXPECT_FALSE(receiveMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+}
+
+
+// Sends an array of 'count' values of type T with the given size and checks the
+// arrays and views of a receiver with zero-copy unpacking.
+template <typename T>
+void TestZeroCopyUnpack(int type, const std::vector<igtlUint16>& arraySize, int headerVersion)
+{
+  igtl::Array<T> sendArray;
+  sendArray.SetSize(arraySize);
+  igtlUint64 count = sendArray.GetRawArraySize() / sizeof(T);
+  unsigned char* raw = (unsigned char*)sendArray.GetRawArray();
+  for (igtlUint64 i = 0; i < sendArray.GetRawArraySize(); i ++)
+    {
+    raw[i] = (unsigned char)(i * 37 + 11);
+    }
+
+  igtl::NDArrayMessage::Pointer msg = igtl::NDArrayMessage::New();
+  msg->SetHeaderVersion(headerVersion);
+  msg->SetDeviceName("DeviceName");
+  msg->SetArray(type, &sendArray);
+  msg->Pack();
+
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->AllocatePack();
+  memcpy(headerMsg->GetPackPointer(), msg->GetPackPointer(), IGTL_HEADER_SIZE);
+  headerMsg->Unpack();
+  igtl::NDArrayMessage::Pointer receiveMsg = igtl::NDArrayMessage::New();
+  receiveMsg->SetZeroCopyUnpack(true);
+  receiveMsg->SetMessageHeader(headerMsg);
+  receiveMsg->AllocatePack();
+  memcpy(receiveMsg->GetPackBodyPointer(), msg->GetPackBodyPointer(), msg->GetPackBodySize());
+  EXPECT_TRUE(receiveMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(receiveMsg->GetType(), type);
+  ASSERT_TRUE(receiveMsg->GetArray() != NULL);
+  EXPECT_TRUE(receiveMsg->GetArray()->GetSize() == arraySize);
+  EXPECT_EQ(memcmp(receiveMsg->GetArray()->GetRawArray(), raw, sendArray.GetRawArraySize()), 0);
+
+  // The array is a view unless it cannot be aligned in the buffer.
+  unsigned char* body = (unsigned char*)receiveMsg->GetPackBodyPointer();
+  unsigned char* array = (unsigned char*)receiveMsg->GetArray()->GetRawArray();
+  igtl::BufferView<T> view = receiveMsg->template GetArrayView<T>();
+  if (!receiveMsg->GetArray()->IsView())
+    {
+    EXPECT_TRUE(view.IsEmpty());
+    return;
+    }
+  EXPECT_TRUE(array > body && array < body + receiveMsg->GetPackBodySize());
+  EXPECT_EQ((size_t)array % (sizeof(T) > 8 ? 8 : sizeof(T)), (size_t)0);
+  ASSERT_EQ(view.GetSize(), count);
+  EXPECT_EQ((unsigned char*)view.GetPointer(), array);
+  EXPECT_TRUE(receiveMsg->template GetArrayView<igtlUint8>().IsEmpty() || sizeof(T) == 1);
+
+  // The view keeps the buffer after the message has been reused and deleted.
+  receiveMsg->SetMessageHeader(headerMsg);
+  receiveMsg->AllocatePack();
+  EXPECT_NE((unsigned char*)receiveMsg->GetPackBodyPointer(), body);
+  memset(receiveMsg->GetPackBodyPointer(), 0, msg->GetPackBodySize());
+  EXPECT_TRUE(receiveMsg->template GetArrayView<T>().IsEmpty());
+  receiveMsg = NULL;
+  EXPECT_EQ(memcmp(view.GetPointer(), raw, sendArray.GetRawArraySize()), 0);
+}
+
+
+void TestZeroCopyUnpack(int headerVersion)
+{
+  std::vector<igtlUint16> size1(1, 100);
+  std::vector<igtlUint16> size2(2);
+  size2[0] = 17;
+  size2[1] = 9;
+  std::vector<igtlUint16> size3(3);
+  size3[0] = 5;
+  size3[1] = 4;
+  size3[2] = 3;
+  TestZeroCopyUnpack<igtlUint8>(igtl::NDArrayMessage::TYPE_UINT8, size3, headerVersion);
+  TestZeroCopyUnpack<igtlInt16>(igtl::NDArrayMessage::TYPE_INT16, size1, headerVersion);
+  TestZeroCopyUnpack<igtlUint32>(igtl::NDArrayMessage::TYPE_UINT32, size2, headerVersion);
+  TestZeroCopyUnpack<igtlFloat32>(igtl::NDArrayMessage::TYPE_FLOAT32, size3, headerVersion);
+  TestZeroCopyUnpack<igtlFloat64>(igtl::NDArrayMessage::TYPE_FLOAT64, size1, headerVersion);
+  TestZeroCopyUnpack<igtlFloat64>(igtl::NDArrayMessage::TYPE_FLOAT64, size2, headerVersion);
+  TestZeroCopyUnpack<igtlFloat64>(igtl::NDArrayMessage::TYPE_FLOAT64, size3, headerVersion);
+  TestZeroCopyUnpack<igtlComplex>(igtl::NDArrayMessage::TYPE_COMPLEX, size2, headerVersion);
+}
+
+
+TEST(NDArrayMessageTest, ZeroCopyUnpackFormatVersion1)
+{
+  TestZeroCopyUnpack(IGTL_HEADER_VERSION_1);
+}
+
+
+#if OpenIGTLink_HEADER_VERSION >= 2
+TEST(NDArrayMessageTest, ZeroCopyUnpackFormatVersion2)
+{
+  TestZeroCopyUnpack(IGTL_HEADER_VERSION_2);
+}
+#endif
+
 
 int main(int argc, char **argv)
 {
@@ -19,6 +19,7 @@
 #include "igtlTestConfig.h"
 #include "string.h"
 
+#include <algorithm>
 #include <list>
 
 #define POLY_BODY_SIZE 300
@@ -125,6 +126,222 @@ TEST(PolyDataMessageTest, Unpack)
 }
 
 
+TEST(PolyDataMessageTest, ContiguousStorageFormatVersion1)
+{
+  // Build the same polydata as BuildUpElements() with the bulk setters.
+  igtl::PolyDataPointArray::Pointer pointArray = igtl::PolyDataPointArray::New();
+  pointArray->SetPoints(8, &points[0][0]);
+  igtl_uint32 offsets[7] = {0, 4, 8, 12, 16, 20, 24};
+  igtl::PolyDataCellArray::Pointer cellArray = igtl::PolyDataCellArray::New();
+  EXPECT_EQ(cellArray->SetCells(6, offsets, &polyArray[0][0]), 1);
+  EXPECT_EQ(cellArray->GetNumberOfCells(), (igtlUint32)6);
+  EXPECT_EQ(cellArray->GetConnectivitySize(), (igtlUint32)24);
+  EXPECT_EQ(cellArray->GetTotalSize(), (igtlUint32)(30 * sizeof(igtlUint32)));
+  igtl::PolyDataAttribute::Pointer attributeArray = igtl::PolyDataAttribute::New();
+  attributeArray->SetType(IGTL_POLY_ATTR_TYPE_SCALAR);
+  attributeArray->SetSize(8);
+  attributeArray->SetName("attr");
+  attributeArray->SetData(attribute);
+
+  igtl::PolyDataMessage::Pointer message = igtl::PolyDataMessage::New();
+  message->SetHeaderVersion(IGTL_HEADER_VERSION_1);
+  message->SetPoints(pointArray.GetPointer());
+  message->SetPolygons(cellArray.GetPointer());
+  message->AddAttribute(attributeArray.GetPointer());
+  message->SetDeviceName("DeviceName");
+  message->SetTimeStamp(0, 1234567892);
+  message->Pack();
+  EXPECT_EQ(memcmp(message->GetPackBodyPointer(), test_polydata_message_body, POLY_BODY_SIZE), 0);
+
+  // Iterating converts the arrays to per-element storage, which packs the same.
+  igtl::PolyDataPointArray::Point& point = *(pointArray->begin() + 2);
+  EXPECT_EQ(pointArray->GetStorageMode(), (int)igtl::PolyDataPointArray::ELEMENT_STORAGE);
+  EXPECT_EQ(point[1], 1.0f);
+  igtl::PolyDataCellArray::Cell& cell = *(cellArray->begin() + 5);
+  EXPECT_EQ(cellArray->GetStorageMode(), (int)igtl::PolyDataCellArray::ELEMENT_STORAGE);
+  EXPECT_EQ(cell.front(), (igtl_uint32)3);
+  EXPECT_EQ(cellArray->GetTotalSize(), (igtlUint32)(30 * sizeof(igtlUint32)));
+  message->Pack();
+  EXPECT_EQ(memcmp(message->GetPackBodyPointer(), test_polydata_message_body, POLY_BODY_SIZE), 0);
+
+  // Unpacked arrays are contiguous and can be read in bulk.
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->AllocatePack();
+  memcpy(headerMsg->GetPackPointer(), message->GetPackPointer(), IGTL_HEADER_SIZE);
+  headerMsg->Unpack();
+  igtl::PolyDataMessage::Pointer received = igtl::PolyDataMessage::New();
+  received->SetMessageHeader(headerMsg);
+  received->AllocatePack();
+  memcpy(received->GetPackBodyPointer(), message->GetPackBodyPointer(), POLY_BODY_SIZE);
+  EXPECT_EQ(received->Unpack() & igtl::MessageHeader::UNPACK_BODY, (int)igtl::MessageHeader::UNPACK_BODY);
+  igtl::PolyDataPointArray* receivedPoints = received->GetPoints();
+  EXPECT_EQ(receivedPoints->GetStorageMode(), (int)igtl::PolyDataPointArray::CONTIGUOUS_STORAGE);
+  EXPECT_TRUE(ArrayFloatComparison(receivedPoints->GetCoordinatePointer(), &points[0][0], 24, ABS_ERROR));
+  igtl_uint32 receivedOffsets[7];
+  igtl_uint32 receivedConnectivity[24];
+  received->GetPolygons()->GetCells(receivedOffsets, receivedConnectivity);
+  EXPECT_THAT(receivedOffsets, ::testing::ElementsAreArray(offsets));
+  EXPECT_EQ(memcmp(receivedConnectivity, polyArray, sizeof(receivedConnectivity)), 0);
+
+  // Iterating a const array reads the contiguous storage without converting it.
+  const igtl::PolyDataPointArray& constPoints = *receivedPoints;
+  const igtlFloat32* coordinates = receivedPoints->GetCoordinatePointer();
+  int pointIndex = 0;
+  for (igtl::PolyDataPointArray::const_iterator iter = constPoints.begin(); iter != constPoints.end(); iter ++)
+    {
+    EXPECT_TRUE(ArrayFloatComparison(&(*iter)[0], points[pointIndex], 3, ABS_ERROR));
+    pointIndex ++;
+    }
+  EXPECT_EQ(pointIndex, 8);
+  EXPECT_EQ((*constPoints.rbegin())[2], points[7][2]);
+  const igtl::PolyDataCellArray& constCells = *received->GetPolygons();
+  const igtlUint32* connectivity = received->GetPolygons()->GetConnectivityPointer();
+  int cellIndex = 0;
+  for (igtl::PolyDataCellArray::const_iterator iter = constCells.begin(); iter != constCells.end(); iter ++)
+    {
+    igtl::PolyDataCellArray::Cell cell = *iter;
+    ASSERT_EQ(cell.size(), (size_t)4);
+    EXPECT_TRUE(std::equal(cell.begin(), cell.end(), polyArray[cellIndex]));
+    cellIndex ++;
+    }
+  EXPECT_EQ(cellIndex, 6);
+  EXPECT_EQ(receivedPoints->GetStorageMode(), (int)igtl::PolyDataPointArray::CONTIGUOUS_STORAGE);
+  EXPECT_EQ(receivedPoints->GetCoordinatePointer(), coordinates);
+  EXPECT_EQ(constCells.GetStorageMode(), (int)igtl::PolyDataCellArray::CONTIGUOUS_STORAGE);
+  EXPECT_EQ(received->GetPolygons()->GetConnectivityPointer(), connectivity);
+  EXPECT_EQ(received->GetVertices()->GetNumberOfCells(), (igtlUint32)0);
+  EXPECT_TRUE(ArrayFloatComparison(received->GetAttribute(0)->GetDataPointer(), attribute, 8, ABS_ERROR));
+}
+
+
+TEST(PolyDataMessageTest, PackedCellsFormatVersion1)
+{
+  igtl::PolyDataCellArray::Pointer cellArray = igtl::PolyDataCellArray::New();
+  igtl_uint32 packed[] = {2, 0, 1, 3, 1, 2, 3};
+  EXPECT_EQ(cellArray->SetPackedCells(2, packed, sizeof(packed)), 1);
+  EXPECT_EQ(cellArray->GetCellSize(1), (igtlUint32)3);
+  igtl_uint32 repacked[7];
+  cellArray->GetPackedCells(repacked);
+  EXPECT_THAT(repacked, ::testing::ElementsAreArray(packed));
+
+  // A cell extending beyond the data is rejected.
+  packed[3] = 4;
+  EXPECT_EQ(cellArray->SetPackedCells(2, packed, sizeof(packed)), 0);
+  EXPECT_EQ(cellArray->GetNumberOfCells(), (igtlUint32)0);
+
+  // Offsets must start with 0 and must not decrease.
+  igtl_uint32 offsets[3] = {0, 2, 1};
+  EXPECT_EQ(cellArray->SetCells(2, offsets, packed), 0);
+}
+
+
+void TestZeroCopyUnpack(int headerVersion)
+{
+  BuildUpElements();
+  polyDataSendMsg = igtl::PolyDataMessage::New();
+  polyDataSendMsg->SetHeaderVersion(headerVersion);
+  polyDataSendMsg->SetPoints(polyPoint.GetPointer());
+  polyDataSendMsg->SetPolygons(polyGon.GetPointer());
+  polyDataSendMsg->AddAttribute(polyAttr.GetPointer());
+  polyDataSendMsg->SetDeviceName("DeviceName");
+#if OpenIGTLink_HEADER_VERSION >= 2
+  if (headerVersion == IGTL_HEADER_VERSION_2)
+    {
+    polyDataSendMsg->SetMetaDataElement("Key", IANA_TYPE_US_ASCII, "Value");
+    }
+#endif
+  polyDataSendMsg->Pack();
+
+  igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
+  headerMsg->AllocatePack();
+  memcpy(headerMsg->GetPackPointer(), polyDataSendMsg->GetPackPointer(), IGTL_HEADER_SIZE);
+  headerMsg->Unpack();
+  igtl::PolyDataMessage::Pointer received = igtl::PolyDataMessage::New();
+  received->SetZeroCopyUnpack(true);
+  received->SetMessageHeader(headerMsg);
+  received->AllocatePack();
+  memcpy(received->GetPackBodyPointer(), polyDataSendMsg->GetPackBodyPointer(), polyDataSendMsg->GetPackBodySize());
+  EXPECT_EQ(received->Unpack(1) & igtl::MessageHeader::UNPACK_BODY, (int)igtl::MessageHeader::UNPACK_BODY);
+
+  // The arrays are views of the receive buffer
+  unsigned char* body = (unsigned char*)received->GetPackBodyPointer();
+  igtl::BufferView<igtlFloat32> pointView = received->GetPointsView();
+  ASSERT_EQ(pointView.GetSize(), (igtlUint64)24);
+  EXPECT_TRUE((unsigned char*)pointView.GetPointer() > body &&
+              (unsigned char*)pointView.GetPointer() < body + received->GetPackBodySize());
+  EXPECT_EQ((size_t)pointView.GetPointer() % sizeof(igtlFloat32), (size_t)0);
+  EXPECT_TRUE(ArrayFloatComparison(pointView.GetPointer(), &points[0][0], 24, ABS_ERROR));
+  igtl::BufferView<igtlUint32> polygonView = received->GetPolygonsView();
+  ASSERT_EQ(polygonView.GetSize(), (igtlUint64)30);
+  for (int i = 0; i < 6; i ++)
+    {
+    EXPECT_EQ(polygonView[i * 5], (igtlUint32)4);
+    EXPECT_EQ(memcmp(&polygonView[i * 5 + 1], polyArray[i], 4 * sizeof(igtlUint32)), 0);
+    }
+  EXPECT_TRUE(received->GetVerticesView().IsEmpty());
+  EXPECT_TRUE(received->GetLinesView().IsEmpty());
+  EXPECT_TRUE(received->GetTriangleStripsView().IsEmpty());
+  EXPECT_EQ(received->GetPoints()->GetNumberOfPoints(), 0);
+  EXPECT_EQ(received->GetPolygons()->GetNumberOfCells(), (igtlUint32)0);
+
+  // The attribute data is not aligned in the body and is moved to be aligned.
+  ASSERT_EQ(received->GetNumberOfAttributes(), 1);
+  EXPECT_STREQ(received->GetAttribute(0)->GetName(), "attr");
+  EXPECT_EQ(received->GetAttribute(0)->GetType(), IGTL_POLY_ATTR_TYPE_SCALAR);
+  igtl::BufferView<igtlFloat32> attributeView = received->GetAttributeView(0);
+  ASSERT_EQ(attributeView.GetSize(), (igtlUint64)8);
+  EXPECT_EQ((size_t)attributeView.GetPointer() % sizeof(igtlFloat32), (size_t)0);
+  EXPECT_TRUE(ArrayFloatComparison(attributeView.GetPointer(), attribute, 8, ABS_ERROR));
+  EXPECT_TRUE(received->GetAttributeView(1).IsEmpty());
+#if OpenIGTLink_HEADER_VERSION >= 2
+  if (headerVersion == IGTL_HEADER_VERSION_2)
+    {
+    std::string value;
+    EXPECT_TRUE(received->GetMetaDataElement("Key", value));
+    EXPECT_EQ(value, "Value");
+    }
+#endif
+
+  // The views keep the buffer after the message receives the next body.
+  received->SetMessageHeader(headerMsg);
+  received->AllocatePack();
+  EXPECT_NE((unsigned char*)received->GetPackBodyPointer(), body);
+  memset(received->GetPackBodyPointer(), 0, polyDataSendMsg->GetPackBodySize());
+  EXPECT_TRUE(received->GetPointsView().IsEmpty());
+  EXPECT_TRUE(ArrayFloatComparison(pointView.GetPointer(), &points[0][0], 24, ABS_ERROR));
+  EXPECT_TRUE(ArrayFloatComparison(attributeView.GetPointer(), attribute, 8, ABS_ERROR));
+
+  // Without views, the buffer is reused.
+  memcpy(received->GetPackBodyPointer(), polyDataSendMsg->GetPackBodyPointer(), polyDataSendMsg->GetPackBodySize());
+  EXPECT_EQ(received->Unpack(1) & igtl::MessageHeader::UNPACK_BODY, (int)igtl::MessageHeader::UNPACK_BODY);
+  body = (unsigned char*)received->GetPackBodyPointer();
+  received->SetMessageHeader(headerMsg);
+  received->AllocatePack();
+  EXPECT_EQ((unsigned char*)received->GetPackBodyPointer(), body);
+
+  // Copy mode leaves the views empty.
+  received->SetZeroCopyUnpack(false);
+  memcpy(received->GetPackBodyPointer(), polyDataSendMsg->GetPackBodyPointer(), polyDataSendMsg->GetPackBodySize());
+  EXPECT_EQ(received->Unpack(1) & igtl::MessageHeader::UNPACK_BODY, (int)igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_TRUE(received->GetPointsView().IsEmpty());
+  EXPECT_EQ(received->GetPoints()->GetNumberOfPoints(), 8);
+}
+
+
+TEST(PolyDataMessageTest, ZeroCopyUnpackFormatVersion1)
+{
+  TestZeroCopyUnpack(IGTL_HEADER_VERSION_1);
+}
+
+
+#if OpenIGTLink_HEADER_VERSION >= 2
+TEST(PolyDataMessageTest, ZeroCopyUnpackFormatVersion2)
+{
+  TestZeroCopyUnpack(IGTL_HEADER_VERSION_2);
+}
+#endif
+
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
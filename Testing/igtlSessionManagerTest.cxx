@@ -0,0 +1,406 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlSessionManager.h"
+#include "igtlEventLoopServer.h"
+#include "igtlMessageHandlerMap.h"
+#include "igtlMessageHandlerMacro.h"
+#include "igtlClientSocket.h"
+#include "igtlMultiThreader.h"
+#include "igtlOSUtil.h"
+#include "igtlTransformMessage.h"
+#include "igtlStatusMessage.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct ReceivedNames
+{
+  std::vector<std::string> deviceNames;
+};
+
+igtlMessageHandlerClassMacro(igtl::TransformMessage, TestTransformHandler, ReceivedNames);
+
+int TestTransformHandler::Process(igtl::TransformMessage* message, ReceivedNames* data)
+{
+  data->deviceNames.push_back(message->GetDeviceName());
+  return 1;
+}
+
+// Handler with a configurable message type for testing MessageHandlerMap.
+class TypeHandler : public igtl::MessageHandler
+{
+public:
+  igtlTypeMacro(TypeHandler, igtl::MessageHandler);
+  igtlNewMacro(TypeHandler);
+
+  void SetType(const std::string& type) { this->m_Type = type; }
+  virtual const char* GetMessageType() { return this->m_Type.c_str(); }
+#if OpenIGTLink_HEADER_VERSION >= 2
+  virtual std::string GetMessageType() const { return this->m_Type; }
+#endif
+
+protected:
+  TypeHandler() {}
+  ~TypeHandler() {}
+  std::string m_Type;
+};
+
+igtlMessageHandlerClassMacro(igtl::StatusMessage, TestStatusHandler, ReceivedNames);
+
+int TestStatusHandler::Process(igtl::StatusMessage* message, ReceivedNames* data)
+{
+  data->deviceNames.push_back(message->GetDeviceName());
+  return 1;
+}
+
+// Handler that only implements ReceiveMessage() and reads the body itself.
+class ReceivingTransformHandler : public igtl::MessageHandler
+{
+public:
+  igtlTypeMacro(ReceivingTransformHandler, igtl::MessageHandler);
+  igtlNewMacro(ReceivingTransformHandler);
+
+  virtual const char* GetMessageType() { return "TRANSFORM"; }
+#if OpenIGTLink_HEADER_VERSION >= 2
+  virtual std::string GetMessageType() const { return std::string("TRANSFORM"); }
+#endif
+  virtual int ReceiveMessage(igtl::Socket* socket, igtl::MessageBase* header, int pos)
+  {
+    if (pos == 0)
+      {
+      this->m_Message->SetMessageHeader(header);
+      this->m_Message->AllocateBuffer();
+      }
+    int s = socket->Receive((char*)this->m_Message->GetBufferBodyPointer() + pos,
+                            this->m_Message->GetBufferBodySize() - pos);
+    if (s < 0)
+      {
+      return pos;
+      }
+    if (s + pos >= this->m_Message->GetBufferBodySize())
+      {
+      if (!this->m_Message->Unpack())
+        {
+        return -1;
+        }
+      this->m_Data.deviceNames.push_back(this->m_Message->GetDeviceName());
+      }
+    return s + pos;
+  }
+
+  ReceivedNames* GetData() { return &this->m_Data; }
+
+protected:
+  ReceivingTransformHandler() { this->m_Message = igtl::TransformMessage::New(); }
+  ~ReceivingTransformHandler() {}
+  igtl::TransformMessage::Pointer m_Message;
+  ReceivedNames m_Data;
+};
+
+igtl::MessageBase::Pointer CreateTransform(const char* name)
+{
+  igtl::TransformMessage::Pointer msg = igtl::TransformMessage::New();
+  msg->SetDeviceName(name);
+  msg->Pack();
+  return igtl::MessageBase::Pointer(msg.GetPointer());
+}
+
+TEST(SessionManagerTest, HandlerMapFormatVersion1)
+{
+  igtl::MessageHandlerMap map;
+  std::vector<TypeHandler::Pointer> handlers;
+  for (int i = 0; i < 100; i ++)
+    {
+    std::ostringstream type;
+    type << "TYPE" << i;
+    TypeHandler::Pointer handler = TypeHandler::New();
+    handler->SetType(type.str());
+    handlers.push_back(handler);
+    EXPECT_EQ(map.Add(handler), 1);
+    }
+  EXPECT_EQ(map.GetNumberOfEntries(), 100);
+  EXPECT_EQ(map.Add(handlers[5]), 0);
+
+  // A handler registered for a device takes precedence over the type-only handler.
+  TypeHandler::Pointer deviceHandler = TypeHandler::New();
+  deviceHandler->SetType("TYPE5");
+  EXPECT_EQ(map.Add(deviceHandler, "Needle"), 1);
+  EXPECT_EQ(map.Add(deviceHandler, "Needle"), 0);
+
+  for (int i = 0; i < 100; i ++)
+    {
+    std::ostringstream type;
+    type << "TYPE" << i;
+    EXPECT_EQ(map.Find(type.str().c_str(), "Tracker"), (igtl::MessageHandler*)handlers[i]);
+    }
+  EXPECT_EQ(map.Find("TYPE5", "Needle"), (igtl::MessageHandler*)deviceHandler);
+  EXPECT_EQ(map.Find("TYPE6", "Needle"), (igtl::MessageHandler*)handlers[6]);
+  EXPECT_TRUE(map.Find("UNKNOWN", NULL) == NULL);
+
+  // Names are compared at their length in the header.
+  EXPECT_EQ(map.Find("TYPE5", "NeedleNeedleNeedleNeedle-longer-than-20"), (igtl::MessageHandler*)handlers[5]);
+
+  EXPECT_EQ(map.Remove(deviceHandler), 1);
+  EXPECT_EQ(map.Remove(deviceHandler), 0);
+  EXPECT_EQ(map.Find("TYPE5", "Needle"), (igtl::MessageHandler*)handlers[5]);
+  EXPECT_EQ(map.Remove(handlers[7]), 1);
+  EXPECT_TRUE(map.Find("TYPE7", NULL) == NULL);
+  EXPECT_EQ(map.Find("TYPE8", NULL), (igtl::MessageHandler*)handlers[8]);
+  EXPECT_EQ(map.GetNumberOfEntries(), 99);
+}
+
+TEST(SessionManagerTest, HandlerWithoutCreateMessageFormatVersion1)
+{
+  // A handler that only implements ReceiveMessage() is served together with
+  // the handlers that create their messages.
+  ReceivingTransformHandler::Pointer transformHandler = ReceivingTransformHandler::New();
+  ReceivedNames statusData;
+  TestStatusHandler::Pointer statusHandler = TestStatusHandler::New();
+  statusHandler->SetData(&statusData);
+
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  EXPECT_EQ(server->AddMessageHandler(transformHandler), 1);
+  EXPECT_EQ(server->AddMessageHandler(statusHandler), 1);
+  ASSERT_EQ(server->CreateServer(0), 0);
+
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+
+  // The messages are sent at once, so that they arrive together.
+  igtl::MessageBase::Pointer first = CreateTransform("First");
+  igtl::StatusMessage::Pointer status = igtl::StatusMessage::New();
+  status->SetDeviceName("Status");
+  status->Pack();
+  igtl::MessageBase::Pointer second = CreateTransform("Second");
+  std::string bytes;
+  bytes.append((const char*)first->GetPackPointer(), first->GetPackSize());
+  bytes.append((const char*)status->GetPackPointer(), status->GetPackSize());
+  bytes.append((const char*)second->GetPackPointer(), second->GetPackSize());
+  bytes.append((const char*)status->GetPackPointer(), status->GetPackSize());
+  ASSERT_EQ(client->Send(bytes.data(), (int)bytes.size()), 1);
+
+  ReceivedNames* data = transformHandler->GetData();
+  for (int i = 0; i < 200 && (data->deviceNames.size() < 2 || statusData.deviceNames.size() < 2); i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  ASSERT_EQ(data->deviceNames.size(), (size_t)2);
+  EXPECT_EQ(data->deviceNames[0], std::string("First"));
+  EXPECT_EQ(data->deviceNames[1], std::string("Second"));
+  EXPECT_EQ(statusData.deviceNames.size(), (size_t)2);
+
+  // After the handler has been removed, its messages are skipped again.
+  EXPECT_EQ(server->RemoveMessageHandler(transformHandler), 1);
+  ASSERT_EQ(client->Send(bytes.data(), (int)bytes.size()), 1);
+  for (int i = 0; i < 200 && statusData.deviceNames.size() < 4; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(statusData.deviceNames.size(), (size_t)4);
+  EXPECT_EQ(data->deviceNames.size(), (size_t)2);
+  server->CloseServer();
+
+  // No connection and no server.
+  igtl::SessionManager::Pointer sm = igtl::SessionManager::New();
+  EXPECT_EQ(sm->ProcessMessage(), 0);
+}
+
+TEST(SessionManagerTest, PollingFormatVersion1)
+{
+  // By default, ProcessMessage() returns at once when no message has arrived.
+  igtl::EventLoopServer::Pointer peer = igtl::EventLoopServer::New();
+  ASSERT_EQ(peer->CreateServer(0), 0);
+
+  igtl::SessionManager::Pointer sm = igtl::SessionManager::New();
+  sm->SetMode(igtl::SessionManager::MODE_CLIENT);
+  sm->SetHostname("localhost");
+  sm->SetPort(peer->GetServerPort());
+  ASSERT_EQ(sm->Connect(), 1);
+  for (int i = 0; i < 10; i ++)
+    {
+    EXPECT_EQ(sm->ProcessMessage(), -1);
+    }
+  peer->CloseServer();
+}
+
+TEST(SessionManagerTest, MultipleServersFormatVersion1)
+{
+  // Two peers, each running its own server.
+  ReceivedNames peerData;
+  TestTransformHandler::Pointer peerHandler = TestTransformHandler::New();
+  peerHandler->SetData(&peerData);
+  igtl::EventLoopServer::Pointer peers[2];
+  for (int i = 0; i < 2; i ++)
+    {
+    peers[i] = igtl::EventLoopServer::New();
+    peers[i]->AddMessageHandler(peerHandler);
+    ASSERT_EQ(peers[i]->CreateServer(0), 0);
+    }
+
+  ReceivedNames data;
+  ReceivedNames needleData;
+  TestTransformHandler::Pointer transformHandler = TestTransformHandler::New();
+  transformHandler->SetData(&data);
+  TestTransformHandler::Pointer needleHandler = TestTransformHandler::New();
+  needleHandler->SetData(&needleData);
+
+  igtl::SessionManager::Pointer sm = igtl::SessionManager::New();
+  sm->SetMode(igtl::SessionManager::MODE_CLIENT);
+  sm->SetHostname("localhost");
+  sm->SetPort(peers[0]->GetServerPort());
+  EXPECT_EQ(sm->AddMessageHandler(transformHandler), 1);
+  EXPECT_EQ(sm->AddMessageHandler(needleHandler, "Needle"), 1);
+  EXPECT_EQ(sm->AddMessageHandler(needleHandler, "Needle"), 0);
+  ASSERT_EQ(sm->Connect(), 1);
+  ASSERT_EQ(sm->AddConnection("localhost", peers[1]->GetServerPort()), 1);
+  EXPECT_EQ(sm->GetNumberOfConnections(), 2);
+
+  for (int i = 0; i < 100 && (peers[0]->GetNumberOfConnections() == 0 || peers[1]->GetNumberOfConnections() == 0); i ++)
+    {
+    peers[0]->ProcessEvents(1);
+    peers[1]->ProcessEvents(1);
+    }
+  ASSERT_EQ(peers[0]->GetNumberOfConnections(), 1);
+  ASSERT_EQ(peers[1]->GetNumberOfConnections(), 1);
+
+  // Peer 0 sends a message one byte at a time, interleaved with complete
+  // messages from peer 1, including one without a handler.
+  igtl::MessageBase::Pointer tracker = CreateTransform("Tracker");
+  igtl::MessageBase::Pointer needle = CreateTransform("Needle");
+  igtl::StatusMessage::Pointer status = igtl::StatusMessage::New();
+  status->SetDeviceName("Needle");
+  status->Pack();
+
+  const char* bytes = (const char*)tracker->GetPackPointer();
+  for (int i = 0; i < tracker->GetPackSize(); i ++)
+    {
+    peers[0]->GetConnection(0)->Send(bytes + i, 1);
+    if (i % 20 == 0)
+      {
+      peers[1]->Broadcast(status);
+      peers[1]->Broadcast(needle);
+      }
+    sm->ProcessMessage(1);
+    }
+  for (int i = 0; i < 200 && (data.deviceNames.size() < 1 || needleData.deviceNames.size() < 5); i ++)
+    {
+    sm->ProcessMessage(10);
+    }
+  ASSERT_EQ(data.deviceNames.size(), (size_t)1);
+  EXPECT_EQ(data.deviceNames[0], std::string("Tracker"));
+  EXPECT_EQ(needleData.deviceNames.size(), (size_t)((tracker->GetPackSize() + 19) / 20));
+
+  // Messages pushed by the session manager reach all peers.
+  igtl::MessageBase::Pointer command = CreateTransform("Command");
+  EXPECT_EQ(sm->PushMessage(command), 1);
+  for (int i = 0; i < 100 && peerData.deviceNames.size() < 2; i ++)
+    {
+    peers[0]->ProcessEvents(1);
+    peers[1]->ProcessEvents(1);
+    }
+  ASSERT_EQ(peerData.deviceNames.size(), (size_t)2);
+  EXPECT_EQ(peerData.deviceNames[0], std::string("Command"));
+  EXPECT_EQ(peerData.deviceNames[1], std::string("Command"));
+
+  // The session ends when all peers have disconnected.
+  peers[0]->CloseServer();
+  for (int i = 0; i < 100 && sm->GetNumberOfConnections() == 2; i ++)
+    {
+    sm->ProcessMessage(10);
+    }
+  EXPECT_EQ(sm->GetNumberOfConnections(), 1);
+  peers[1]->CloseServer();
+  int r = -1;
+  for (int i = 0; i < 100 && r != 0; i ++)
+    {
+    r = sm->ProcessMessage(10);
+    }
+  EXPECT_EQ(r, 0);
+}
+
+struct ClientThreadData
+{
+  int port;
+  volatile int done;
+};
+
+void* ClientThread(void* ptr)
+{
+  igtl::MultiThreader::ThreadInfo* info = static_cast<igtl::MultiThreader::ThreadInfo*>(ptr);
+  ClientThreadData* data = static_cast<ClientThreadData*>(info->UserData);
+
+  igtl::ClientSocket::Pointer clients[2];
+  for (int i = 0; i < 2; i ++)
+    {
+    clients[i] = igtl::ClientSocket::New();
+    // Retry until the server has been started.
+    for (int j = 0; j < 100 && clients[i]->ConnectToServer("localhost", data->port, false) != 0; j ++)
+      {
+      igtl::Sleep(50);
+      }
+    std::ostringstream name;
+    name << "Client" << i;
+    igtl::MessageBase::Pointer msg = CreateTransform(name.str().c_str());
+    clients[i]->Send(msg->GetPackPointer(), msg->GetPackSize());
+    }
+  while (!data->done)
+    {
+    igtl::Sleep(10);
+    }
+  return NULL;
+}
+
+TEST(SessionManagerTest, ServerModeFormatVersion1)
+{
+  ReceivedNames data;
+  TestTransformHandler::Pointer transformHandler = TestTransformHandler::New();
+  transformHandler->SetData(&data);
+
+  ClientThreadData threadData;
+  threadData.port = 18999;
+  threadData.done = 0;
+
+  igtl::SessionManager::Pointer sm = igtl::SessionManager::New();
+  sm->SetMode(igtl::SessionManager::MODE_SERVER);
+  sm->SetPort(threadData.port);
+  sm->AddMessageHandler(transformHandler);
+
+  igtl::MultiThreader::Pointer threader = igtl::MultiThreader::New();
+  int id = threader->SpawnThread((igtl::ThreadFunctionType) &ClientThread, &threadData);
+
+  EXPECT_EQ(sm->Connect(), 1);
+  for (int i = 0; i < 200 && data.deviceNames.size() < 2; i ++)
+    {
+    sm->ProcessMessage(10);
+    }
+  EXPECT_EQ(sm->GetNumberOfConnections(), 2);
+  ASSERT_EQ(data.deviceNames.size(), (size_t)2);
+  EXPECT_EQ(std::count(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client0")), 1);
+  EXPECT_EQ(std::count(data.deviceNames.begin(), data.deviceNames.end(), std::string("Client1")), 1);
+
+  threadData.done = 1;
+  threader->TerminateThread(id);
+  sm->Disconnect();
+  EXPECT_EQ(sm->GetNumberOfConnections(), 0);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
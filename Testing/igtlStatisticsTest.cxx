@@ -0,0 +1,266 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlStatistics.h"
+#include "igtlEventLoopServer.h"
+#include "igtlMessageHandlerMacro.h"
+#include "igtlClientSocket.h"
+#include "igtlServerSocket.h"
+#include "igtlTransformMessage.h"
+#include "igtlStringMessage.h"
+#include "igtlOSUtil.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <sstream>
+
+igtlMessageHandlerClassMacro(igtl::TransformMessage, StatisticsTransformHandler, int);
+
+int StatisticsTransformHandler::Process(igtl::TransformMessage*, int* count)
+{
+  (*count) ++;
+  return 1;
+}
+
+TEST(StatisticsTest, HistogramFormatVersion1)
+{
+  typedef igtl::LatencyHistogram H;
+
+  // Exact buckets below 16, then 8 buckets per power of two.
+  EXPECT_EQ(H::GetBucketIndex(0), 0);
+  EXPECT_EQ(H::GetBucketIndex(15), 15);
+  EXPECT_EQ(H::GetBucketIndex(16), 16);
+  EXPECT_EQ(H::GetBucketIndex(17), 16);
+  EXPECT_EQ(H::GetBucketIndex(18), 17);
+  EXPECT_EQ(H::GetBucketIndex(1000), H::GetBucketIndex(1023));
+  EXPECT_EQ(H::GetBucketIndex((1ULL << 40) - 1), H::NumberOfBuckets - 1);
+  EXPECT_EQ(H::GetBucketIndex(1ULL << 50), H::NumberOfBuckets - 1);
+  for (int i = 0; i < H::NumberOfBuckets; i ++)
+    {
+    igtl_uint64 lower = H::GetBucketLowerBound(i);
+    igtl_uint64 upper = H::GetBucketUpperBound(i);
+    ASSERT_LT(lower, upper);
+    EXPECT_EQ(H::GetBucketIndex(lower), i);
+    EXPECT_EQ(H::GetBucketIndex(upper - 1), i);
+    if (i > 0)
+      {
+      EXPECT_EQ(H::GetBucketUpperBound(i - 1), lower);
+      }
+    // Buckets above 16 ns are at most 12.5% wide.
+    if (lower >= 16)
+      {
+      EXPECT_LE((upper - lower) * 8, lower);
+      }
+    }
+
+  igtl::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.GetPercentile(50), 0u);
+  EXPECT_EQ(histogram.GetMean(), 0.0);
+
+  // 99 durations of 1 us and one of 1 ms.
+  for (int i = 0; i < 99; i ++)
+    {
+    histogram.Add(1000);
+    }
+  histogram.Add(1000000);
+  EXPECT_EQ(histogram.GetCount(), 100u);
+  EXPECT_EQ(histogram.GetTotal(), 99u * 1000 + 1000000);
+  EXPECT_DOUBLE_EQ(histogram.GetMean(), 10990.0);
+  EXPECT_EQ(histogram.GetBucketCount(H::GetBucketIndex(1000)), 99u);
+  EXPECT_EQ(histogram.GetPercentile(50), H::GetBucketUpperBound(H::GetBucketIndex(1000)));
+  EXPECT_EQ(histogram.GetPercentile(99), H::GetBucketUpperBound(H::GetBucketIndex(1000)));
+  EXPECT_EQ(histogram.GetPercentile(100), H::GetBucketUpperBound(H::GetBucketIndex(1000000)));
+
+  histogram.Reset();
+  EXPECT_EQ(histogram.GetCount(), 0u);
+  EXPECT_EQ(histogram.GetBucketCount(H::GetBucketIndex(1000)), 0u);
+}
+
+TEST(StatisticsTest, PackUnpackFormatVersion1)
+{
+  EXPECT_FALSE(igtl::Statistics::GetEnabled());
+  igtl::Statistics::Reset();
+  igtl::TrafficStatistics* statistics = igtl::Statistics::GetMessageTypeStatistics("STRING");
+  EXPECT_EQ(statistics->GetName(), "STRING");
+  EXPECT_EQ(igtl::Statistics::GetMessageTypeStatistics("STRING"), statistics);
+
+  // Nothing is counted while the statistics are disabled.
+  igtl::StringMessage::Pointer message = igtl::StringMessage::New();
+  message->SetString("Statistics");
+  message->Pack();
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::PackedMessages), 0u);
+
+  igtl::Statistics::SetEnabled(true);
+  message = igtl::StringMessage::New();
+  message->SetString("Statistics enabled");
+  message->Pack();
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::PackedMessages), 1u);
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::PackedBytes), (igtl_uint64)message->GetPackSize());
+  EXPECT_EQ(statistics->GetHistogram(igtl::TrafficStatistics::Pack).GetCount(), 1u);
+
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), message->GetPackPointer(), IGTL_HEADER_SIZE);
+  header->Unpack();
+  igtl::StringMessage::Pointer received = igtl::StringMessage::New();
+  received->SetMessageHeader(header);
+  received->AllocatePack();
+  memcpy(received->GetPackBodyPointer(), message->GetPackBodyPointer(), message->GetPackBodySize());
+  EXPECT_TRUE(received->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::UnpackedMessages), 1u);
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::UnpackedBytes), (igtl_uint64)message->GetPackBodySize());
+  EXPECT_EQ(statistics->GetHistogram(igtl::TrafficStatistics::CRC).GetCount(), 1u);
+  EXPECT_EQ(statistics->GetHistogram(igtl::TrafficStatistics::Unpack).GetCount(), 1u);
+
+  // A corrupted body is counted as a CRC error.
+  igtl::StringMessage::Pointer corrupted = igtl::StringMessage::New();
+  corrupted->SetMessageHeader(header);
+  corrupted->AllocatePack();
+  memcpy(corrupted->GetPackBodyPointer(), message->GetPackBodyPointer(), message->GetPackBodySize());
+  ((unsigned char*)corrupted->GetPackBodyPointer())[4] ^= 0xFF;
+  EXPECT_FALSE(corrupted->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::CRCErrors), 1u);
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::UnpackedMessages), 1u);
+
+  std::ostringstream os;
+  igtl::Statistics::Print(os);
+  EXPECT_NE(os.str().find("STRING"), std::string::npos);
+  EXPECT_EQ(os.str().find("TRANSFORM"), std::string::npos);
+
+  igtl::Statistics::Reset();
+  EXPECT_EQ(statistics->GetCounter(igtl::TrafficStatistics::PackedMessages), 0u);
+  EXPECT_EQ(statistics->GetHistogram(igtl::TrafficStatistics::Pack).GetCount(), 0u);
+  igtl::Statistics::SetEnabled(false);
+}
+
+size_t CountConnections()
+{
+  std::vector<igtl::TrafficStatistics::Pointer> connections;
+  igtl::Statistics::GetConnectionStatistics(connections);
+  return connections.size();
+}
+
+TEST(StatisticsTest, ConnectionFormatVersion1)
+{
+  igtl::Statistics::Reset();
+  igtl::Statistics::SetEnabled(true);
+
+  int count = 0;
+  StatisticsTransformHandler::Pointer handler = StatisticsTransformHandler::New();
+  handler->SetData(&count);
+  igtl::EventLoopServer::Pointer server = igtl::EventLoopServer::New();
+  server->AddMessageHandler(handler);
+  ASSERT_EQ(server->CreateServer(0), 0);
+
+  igtl::ClientSocket::Pointer client = igtl::ClientSocket::New();
+  ASSERT_EQ(client->ConnectToServer("localhost", server->GetServerPort()), 0);
+  // The statistics of a connection are created on first use.
+  size_t numberOfConnections = CountConnections();
+
+  const int numberOfMessages = 5;
+  igtl::TransformMessage::Pointer message = igtl::TransformMessage::New();
+  message->SetDeviceName("Tracker");
+  message->Pack();
+  for (int i = 0; i < numberOfMessages; i ++)
+    {
+    ASSERT_EQ(client->Send(message->GetPackPointer(), message->GetPackSize()), 1);
+    }
+  std::vector<igtl::TrafficStatistics::Pointer> connections;
+  igtl::Statistics::GetConnectionStatistics(connections);
+  EXPECT_EQ(connections.size(), numberOfConnections + 1);
+  bool listed = false;
+  for (size_t i = 0; i < connections.size(); i ++)
+    {
+    listed = listed || connections[i].GetPointer() == client->GetStatistics();
+    }
+  EXPECT_TRUE(listed);
+  for (int i = 0; i < 200 && count < numberOfMessages; i ++)
+    {
+    server->ProcessEvents(10);
+    }
+  EXPECT_EQ(count, numberOfMessages);
+
+  igtl_uint64 size = (igtl_uint64)message->GetPackSize();
+  igtl::TrafficStatistics* sent = client->GetStatistics();
+  EXPECT_EQ(sent->GetCounter(igtl::TrafficStatistics::SendCalls), (igtl_uint64)numberOfMessages);
+  EXPECT_EQ(sent->GetCounter(igtl::TrafficStatistics::SentBytes), numberOfMessages * size);
+  EXPECT_EQ(sent->GetHistogram(igtl::TrafficStatistics::Send).GetCount(), (igtl_uint64)numberOfMessages);
+
+  // The server side of the connection, and the message type.
+  connections.clear();
+  igtl::Statistics::GetConnectionStatistics(connections);
+  igtl::TrafficStatistics* received = NULL;
+  for (size_t i = 0; i < connections.size(); i ++)
+    {
+    if (connections[i]->GetCounter(igtl::TrafficStatistics::ReceivedMessages) > 0)
+      {
+      received = connections[i];
+      }
+    }
+  ASSERT_TRUE(received != NULL);
+  EXPECT_EQ(received->GetCounter(igtl::TrafficStatistics::ReceivedMessages), (igtl_uint64)numberOfMessages);
+  EXPECT_EQ(received->GetCounter(igtl::TrafficStatistics::ReceivedBytes), numberOfMessages * size);
+  EXPECT_EQ(received->GetHistogram(igtl::TrafficStatistics::ReceiveBody).GetCount(), (igtl_uint64)numberOfMessages);
+  igtl::TrafficStatistics* type = igtl::Statistics::GetMessageTypeStatistics("TRANSFORM");
+  EXPECT_EQ(type->GetCounter(igtl::TrafficStatistics::ReceivedMessages), (igtl_uint64)numberOfMessages);
+  EXPECT_EQ(type->GetCounter(igtl::TrafficStatistics::UnpackedMessages), (igtl_uint64)numberOfMessages);
+
+  // A blocking Receive() counts the bytes as well.
+  igtl::ServerSocket::Pointer serverSocket = igtl::ServerSocket::New();
+  ASSERT_EQ(serverSocket->CreateServer(0), 0);
+  igtl::ClientSocket::Pointer client2 = igtl::ClientSocket::New();
+  ASSERT_EQ(client2->ConnectToServer("localhost", serverSocket->GetServerPort()), 0);
+  igtl::ClientSocket::Pointer accepted = serverSocket->WaitForConnection(1000);
+  ASSERT_TRUE(accepted.IsNotNull());
+  ASSERT_EQ(client2->Send(message->GetPackPointer(), message->GetPackSize()), 1);
+  std::vector<char> buffer(message->GetPackSize());
+  EXPECT_EQ(accepted->Receive(&buffer[0], (int)buffer.size()), (int)buffer.size());
+  EXPECT_EQ(accepted->GetStatistics()->GetCounter(igtl::TrafficStatistics::ReceivedBytes), size);
+
+  accepted->CloseSocket();
+  client2->CloseSocket();
+  serverSocket->CloseSocket();
+  client->CloseSocket();
+  server->CloseServer();
+  igtl::Statistics::SetEnabled(false);
+}
+
+TEST(StatisticsTest, PeriodicDumpFormatVersion1)
+{
+  igtl::Statistics::Reset();
+  igtl::Statistics::SetEnabled(true);
+  igtl::StringMessage::Pointer message = igtl::StringMessage::New();
+  message->SetString("Dump");
+  message->Pack();
+
+  std::ostringstream os;
+  ASSERT_EQ(igtl::Statistics::StartPeriodicDump(&os, 20, true), 0);
+  EXPECT_EQ(igtl::Statistics::StartPeriodicDump(&os, 20), -1);
+  igtl::Sleep(100);
+  igtl::Statistics::StopPeriodicDump();
+
+  // The first dump includes the message; the statistics are reset after it.
+  EXPECT_NE(os.str().find("STRING"), std::string::npos);
+  EXPECT_EQ(igtl::Statistics::GetMessageTypeStatistics("STRING")->GetCounter(igtl::TrafficStatistics::PackedMessages), 0u);
+
+  // The dump can be restarted.
+  ASSERT_EQ(igtl::Statistics::StartPeriodicDump(&os, 1000), 0);
+  igtl::Statistics::StopPeriodicDump();
+  igtl::Statistics::SetEnabled(false);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
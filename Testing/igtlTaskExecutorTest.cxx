@@ -0,0 +1,180 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlTaskExecutor.h"
+#include "igtlParallelCRC64.h"
+#include "igtlMutexLock.h"
+#include "igtlTestConfig.h"
+#include "igtl_util.h"
+#include "string.h"
+
+#include <vector>
+
+void Square(void* data)
+{
+  int* value = static_cast<int*>(data);
+  *value = *value * *value;
+}
+
+TEST(TaskExecutorTest, FutureFormatVersion1)
+{
+  igtl::TaskExecutor::Pointer executor = igtl::TaskExecutor::New();
+  for (int workers = 0; workers <= 3; workers += 3)
+    {
+    executor->SetNumberOfWorkers(workers);
+    EXPECT_EQ(executor->GetNumberOfWorkers(), workers);
+
+    std::vector<int> values(100);
+    std::vector<igtl::TaskFuture::Pointer> futures;
+    for (int i = 0; i < 100; i ++)
+      {
+      values[i] = i;
+      futures.push_back(executor->Submit(&Square, &values[i]));
+      }
+    for (int i = 0; i < 100; i ++)
+      {
+      futures[i]->Wait();
+      EXPECT_TRUE(futures[i]->IsDone());
+      EXPECT_EQ(values[i], i * i);
+      }
+    }
+}
+
+struct CountData
+{
+  igtl::SimpleMutexLock   Lock;
+  std::vector<int>        Counts;
+  igtl::TaskExecutor*     Executor;
+};
+
+void CountRange(void* data, igtlInt64 begin, igtlInt64 end)
+{
+  CountData* count = static_cast<CountData*>(data);
+  count->Lock.Lock();
+  for (igtlInt64 i = begin; i < end; i ++)
+    {
+    count->Counts[(size_t)i] ++;
+    }
+  count->Lock.Unlock();
+}
+
+TEST(TaskExecutorTest, ParallelForFormatVersion1)
+{
+  igtl::TaskExecutor::Pointer executor = igtl::TaskExecutor::New();
+  executor->SetNumberOfWorkers(3);
+
+  // Every index is visited exactly once, for any size and grain.
+  const igtlInt64 sizes[] = {1, 2, 7, 16, 1000};
+  for (int s = 0; s < 5; s ++)
+    {
+    for (igtlInt64 grain = 1; grain <= 64; grain *= 4)
+      {
+      CountData data;
+      data.Counts.resize(10 + (size_t)sizes[s], 0);
+      executor->ParallelFor(10, 10 + sizes[s], &CountRange, &data, grain);
+      int errors = 0;
+      for (size_t i = 0; i < data.Counts.size(); i ++)
+        {
+        errors += data.Counts[i] != (i < 10 ? 0 : 1);
+        }
+      EXPECT_EQ(errors, 0);
+      }
+    }
+}
+
+void NestedTask(void* data)
+{
+  // Waits for other tasks from a worker; the worker runs them meanwhile.
+  CountData* count = static_cast<CountData*>(data);
+  count->Executor->ParallelFor(0, (igtlInt64)count->Counts.size(), &CountRange, count);
+}
+
+TEST(TaskExecutorTest, NestedFormatVersion1)
+{
+  igtl::TaskExecutor::Pointer executor = igtl::TaskExecutor::New();
+  executor->SetNumberOfWorkers(2);
+
+  const int numberOfTasks = 16;
+  std::vector<CountData*> data(numberOfTasks);
+  igtl::TaskGroup group;
+  for (int i = 0; i < numberOfTasks; i ++)
+    {
+    data[i] = new CountData;
+    data[i]->Counts.resize(100, 0);
+    data[i]->Executor = executor;
+    executor->Submit(&NestedTask, data[i], &group);
+    }
+  executor->Wait(&group);
+  EXPECT_EQ(group.GetNumberOfPendingTasks(), 0);
+
+  int errors = 0;
+  for (int i = 0; i < numberOfTasks; i ++)
+    {
+    for (size_t j = 0; j < data[i]->Counts.size(); j ++)
+      {
+      errors += data[i]->Counts[j] != 1;
+      }
+    delete data[i];
+    }
+  EXPECT_EQ(errors, 0);
+}
+
+TEST(TaskExecutorTest, CoreAffinityFormatVersion1)
+{
+  igtl::TaskExecutor::Pointer executor = igtl::TaskExecutor::New();
+  executor->SetNumberOfWorkers(2);
+
+  // Binding all workers to the first core only changes where they run.
+  int core = 0;
+#if defined(_WIN32) || defined(__linux__)
+  EXPECT_EQ(executor->SetCoreAffinity(&core, 1), 0);
+#else
+  executor->SetCoreAffinity(&core, 1);
+#endif
+  CountData data;
+  data.Counts.resize(1000, 0);
+  executor->ParallelFor(0, 1000, &CountRange, &data);
+  executor->SetCoreAffinity(NULL, 0);
+  executor->ParallelFor(0, 1000, &CountRange, &data);
+  int errors = 0;
+  for (size_t i = 0; i < data.Counts.size(); i ++)
+    {
+    errors += data.Counts[i] != 2;
+    }
+  EXPECT_EQ(errors, 0);
+}
+
+TEST(TaskExecutorTest, GlobalExecutorFormatVersion1)
+{
+  igtl::TaskExecutor* executor = igtl::TaskExecutor::GetGlobalExecutor();
+  ASSERT_TRUE(executor != NULL);
+  EXPECT_EQ(executor, igtl::TaskExecutor::GetGlobalExecutor());
+
+  // ParallelCRC64() runs on the global executor and matches crc64().
+  std::vector<unsigned char> buffer(5 * 1024 * 1024 + 13);
+  for (size_t i = 0; i < buffer.size(); i ++)
+    {
+    buffer[i] = (unsigned char)(i * 7 + (i >> 11));
+    }
+  igtlUint64 serial = crc64(&buffer[0], buffer.size(), 0LL);
+  int workers = executor->GetNumberOfWorkers();
+  executor->SetNumberOfWorkers(3);
+  EXPECT_EQ(igtl::ParallelCRC64(&buffer[0], buffer.size(), 0LL, 4), serial);
+  executor->SetNumberOfWorkers(workers);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
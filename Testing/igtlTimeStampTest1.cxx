@@ -35,6 +35,31 @@ int main(int, char * [] )
     return EXIT_FAILURE;
     }
 
+  // Nanosecond values are converted without rounding.
+  igtlUint64 nanos = 1700000000123456789ULL;
+  ts->SetTimeInNanoseconds(nanos);
+  if (ts->GetSecond() != 1700000000 || ts->GetNanosecond() != 123456789 ||
+      ts->GetTimeStampInNanoseconds() != nanos)
+    {
+    std::cerr << "Expected " << nanos << " but got " << ts->GetTimeStampInNanoseconds() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The monotonic clock never goes back.
+  ts->GetMonotonicTime();
+  igtlUint64 previous = ts->GetTimeStampInNanoseconds();
+  for (int i = 0; i < 1000; i ++)
+    {
+    ts->GetMonotonicTime();
+    igtlUint64 current = ts->GetTimeStampInNanoseconds();
+    if (current < previous)
+      {
+      std::cerr << "Monotonic time went back from " << previous << " to " << current << std::endl;
+      return EXIT_FAILURE;
+      }
+    previous = current;
+    }
+
   return EXIT_SUCCESS;
 }
 
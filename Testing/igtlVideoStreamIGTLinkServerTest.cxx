@@ -0,0 +1,151 @@
+/*=========================================================================
+
+  Program:   OpenIGTLink Library
+  Language:  C++
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+
+  This software is distributed WITHOUT ANY WARRANTY; without even
+  the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+  PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "igtlVideoStreamIGTLinkServer.h"
+#include "igtlI420Encoder.h"
+#include "igtlClientSocket.h"
+#include "igtlServerSocket.h"
+#include "igtlTestConfig.h"
+#include "string.h"
+
+#include <map>
+#include <vector>
+
+TEST(VideoStreamIGTLinkServerTest, MultipleStreamsFormatVersion2)
+{
+  const int port = 48952;
+  const int numberOfStreams = 3;
+  const int numberOfFrames = 20;
+  const int width = 64;
+  const int height = 48;
+  const int frameSize = width * height * 3 / 2;
+
+  igtl::ServerSocket::Pointer serverSocket = igtl::ServerSocket::New();
+  ASSERT_GE(serverSocket->CreateServer(port), 0);
+  igtl::ClientSocket::Pointer clientSocket = igtl::ClientSocket::New();
+  ASSERT_EQ(clientSocket->ConnectToServer("127.0.0.1", port), 0);
+  igtl::ClientSocket::Pointer connection = serverSocket->WaitForConnection(1000);
+  ASSERT_TRUE(connection.IsNotNull());
+
+  // No configuration file; the streams are set up explicitly.
+  char configFile[] = "";
+  igtl::VideoStreamIGTLinkServer server(configFile);
+  server.socket = connection;
+  server.transportMethod = igtl::VideoStreamIGTLinkServer::UseTCP;
+
+  std::vector<igtl::I420Encoder::Pointer> encoders;
+  const char* names[numberOfStreams] = {"Endoscope", "Ultrasound", "Microscope"};
+  for (int s = 0; s < numberOfStreams; s ++)
+    {
+    encoders.push_back(igtl::I420Encoder::New());
+    EXPECT_EQ(server.AddVideoStream(names[s], encoders[s], width, height), s);
+    }
+  EXPECT_EQ(server.GetNumberOfVideoStreams(), numberOfStreams);
+  EXPECT_EQ(server.GetVideoStreamIndex("Ultrasound"), 1);
+  EXPECT_EQ(server.GetVideoStreamIndex("Unknown"), -1);
+  EXPECT_GE(server.StartVideoStreamThreads(), 1);
+  EXPECT_EQ(server.AddVideoStream("Late", encoders[0], width, height), -1);
+
+  // Each frame is filled with a value that identifies the stream and the frame.
+  std::vector<igtl_uint8> frame(frameSize);
+  for (int f = 0; f < numberOfFrames; f ++)
+    {
+    for (int s = 0; s < numberOfStreams; s ++)
+      {
+      memset(&frame[0], s * numberOfFrames + f, frameSize);
+      EXPECT_EQ(server.PushFrame(s, &frame[0]), 0);
+      }
+    }
+  EXPECT_EQ(server.PushFrame(numberOfStreams, &frame[0]), -1);
+
+  // Frames are either sent or dropped by the queues.
+  std::map<std::string, int> lastValue;
+  std::map<std::string, igtlUint64> lastTimeStamp;
+  int received = 0;
+  for (int wait = 0; wait < 500; wait ++)
+    {
+    int sent = 0;
+    int done = 0;
+    for (int s = 0; s < numberOfStreams; s ++)
+      {
+      sent += (int)server.GetNumberOfSentFrames(s);
+      done += (int)(server.GetNumberOfSentFrames(s) + server.GetNumberOfDroppedFrames(s));
+      }
+    while (received < sent)
+      {
+      igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+      header->InitPack();
+      ASSERT_EQ(clientSocket->Receive(header->GetPackPointer(), header->GetPackSize()), header->GetPackSize());
+      header->Unpack();
+      ASSERT_STREQ(header->GetDeviceType(), "VIDEO");
+      igtl::VideoMessage::Pointer videoMsg = igtl::VideoMessage::New();
+      videoMsg->SetMessageHeader(header);
+      videoMsg->AllocatePack();
+      clientSocket->Receive(videoMsg->GetPackBodyPointer(), videoMsg->GetPackBodySize());
+      ASSERT_TRUE(videoMsg->Unpack(1) & igtl::MessageHeader::UNPACK_BODY);
+      ASSERT_EQ(videoMsg->GetBitStreamSize(), frameSize);
+
+      // The frames of a stream arrive in order and intact.
+      std::string name = videoMsg->GetDeviceName();
+      int s = server.GetVideoStreamIndex(name);
+      ASSERT_GE(s, 0);
+      const igtl_uint8* data = videoMsg->GetPackFragmentPointer(2);
+      int value = data[0];
+      for (int i = 1; i < frameSize; i ++)
+        {
+        ASSERT_EQ(data[i], value);
+        }
+      EXPECT_GE(value, s * numberOfFrames);
+      EXPECT_LT(value, (s + 1) * numberOfFrames);
+      if (lastValue.count(name))
+        {
+        EXPECT_GT(value, lastValue[name]);
+        }
+      lastValue[name] = value;
+
+      igtl::TimeStamp::Pointer ts = igtl::TimeStamp::New();
+      videoMsg->GetTimeStamp(ts);
+      igtlUint64 timeStamp = ts->GetTimeStampInNanoseconds();
+      if (lastTimeStamp.count(name))
+        {
+        EXPECT_GE(timeStamp, lastTimeStamp[name]);
+        }
+      lastTimeStamp[name] = timeStamp;
+      received ++;
+      }
+    if (done == numberOfStreams * numberOfFrames)
+      {
+      break;
+      }
+    igtl::Sleep(10);
+    }
+  EXPECT_GT(received, 0);
+  for (int s = 0; s < numberOfStreams; s ++)
+    {
+    EXPECT_EQ(server.GetNumberOfSentFrames(s) + server.GetNumberOfDroppedFrames(s), (igtl_uint64)numberOfFrames);
+    // The last frame of each stream is never dropped.
+    EXPECT_EQ(lastValue[names[s]], (s + 1) * numberOfFrames - 1);
+    }
+
+  server.Stop();
+  EXPECT_EQ(server.PushFrame(0, &frame[0]), -1);
+  clientSocket->CloseSocket();
+  serverSocket->CloseSocket();
+}
+
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
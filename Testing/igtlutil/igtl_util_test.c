@@ -14,13 +14,178 @@
 
 =========================================================================*/
 
+#include <stdio.h>
+#include <string.h>
 #include "igtl_util.h"
 
 #define EXIT_SUCCESS 0
 #define EXIT_FAILURE 1
 
+#define TEST_BUFFER_SIZE 4096
+
+/* Check value of CRC-64/ECMA-182 for "123456789" */
+#define CRC64_CHECK_VALUE 0x6C40DF5F0B497347ULL
+
+int test_crc64_variants(const unsigned char* data, igtl_uint64 len, igtl_uint64 init)
+{
+  igtl_uint64 ref = igtl_crc64_bytewise(data, len, init);
+
+  if (igtl_crc64_slice8(data, len, init) != ref ||
+      igtl_crc64_slice16(data, len, init) != ref ||
+      igtl_crc64_clmul(data, len, init) != ref ||
+      crc64((unsigned char*)data, len, init) != ref)
+    {
+    fprintf(stdout, "CRC-64 mismatch (length = %d).\n", (int)len);
+    return 0;
+    }
+  return 1;
+}
+
+/* Converts 'count' elements of 'size' bytes with the selected implementation,
+ * out of place and in place, and compares the result with the reversed bytes. */
+int test_byte_order(const unsigned char* src, int count, int size)
+{
+  unsigned char expected[TEST_BUFFER_SIZE];
+  unsigned char converted[TEST_BUFFER_SIZE + 16];
+  int i;
+  int j;
+
+  for (i = 0; i < count; i ++)
+    {
+    for (j = 0; j < size; j ++)
+      {
+      expected[i * size + j] = igtl_is_little_endian() ? src[i * size + size - 1 - j] : src[i * size + j];
+      }
+    }
+
+  /* Out of place; the destination is misaligned by one byte */
+  memset(converted, 0xAA, sizeof(converted));
+  igtl_convert_byte_order_copy(&converted[1], src, count, size);
+  if (memcmp(&converted[1], expected, count * size) != 0 || converted[count * size + 1] != 0xAA)
+    {
+    fprintf(stdout, "Byte order conversion mismatch (count = %d, size = %d).\n", count, size);
+    return 0;
+    }
+
+  /* In place */
+  memcpy(converted, src, count * size);
+  igtl_convert_byte_order(converted, count, size);
+  if (memcmp(converted, expected, count * size) != 0)
+    {
+    fprintf(stdout, "In-place byte order conversion mismatch (count = %d, size = %d).\n", count, size);
+    return 0;
+    }
+  return 1;
+}
+
 int main( int argc, char * argv [] )
 {
+  unsigned char buffer[TEST_BUFFER_SIZE + 16];
+  igtl_uint64 crc;
+  int i;
+  int offset;
+  int impl;
+
+  /* Known answer */
+  if (igtl_crc64_bytewise((const unsigned char*)"123456789", 9, 0) != CRC64_CHECK_VALUE)
+    {
+    fprintf(stdout, "Invalid CRC-64 check value.\n");
+    return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < (int)sizeof(buffer); i ++)
+    {
+    buffer[i] = (unsigned char)((i * 167 + 13) ^ (i >> 3));
+    }
+
+  /* All lengths around the block boundaries of each variant, at different alignments */
+  for (offset = 0; offset < 8; offset ++)
+    {
+    for (i = 0; i <= 300; i ++)
+      {
+      if (!test_crc64_variants(&buffer[offset], i, 0) ||
+          !test_crc64_variants(&buffer[offset], i, 0x0123456789ABCDEFULL))
+        {
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  if (!test_crc64_variants(buffer, TEST_BUFFER_SIZE, 0) ||
+      !test_crc64_variants(&buffer[3], TEST_BUFFER_SIZE - 5, 0))
+    {
+    return EXIT_FAILURE;
+    }
+
+  /* Incremental computation must match a single pass */
+  crc = crc64(buffer, 1000, 0);
+  crc = crc64(&buffer[1000], TEST_BUFFER_SIZE - 1000, crc);
+  if (crc != igtl_crc64_bytewise(buffer, TEST_BUFFER_SIZE, 0))
+    {
+    fprintf(stdout, "Incremental CRC-64 mismatch.\n");
+    return EXIT_FAILURE;
+    }
+
+  /* Combining the CRCs of two blocks must match a single pass */
+  for (i = 0; i <= TEST_BUFFER_SIZE; i += (i < 64) ? 1 : 61)
+    {
+    igtl_uint64 crc1 = crc64(buffer, i, 0x0123456789ABCDEFULL);
+    igtl_uint64 crc2 = crc64(&buffer[i], TEST_BUFFER_SIZE - i, 0);
+    if (igtl_crc64_combine(crc1, crc2, TEST_BUFFER_SIZE - i) !=
+        crc64(buffer, TEST_BUFFER_SIZE, 0x0123456789ABCDEFULL))
+      {
+      fprintf(stdout, "Combined CRC-64 mismatch (split = %d).\n", i);
+      return EXIT_FAILURE;
+      }
+    }
+
+  /* Explicit selection */
+  for (impl = IGTL_CRC64_IMPL_BYTEWISE; impl <= IGTL_CRC64_IMPL_CLMUL; impl ++)
+    {
+    int selected = igtl_crc64_set_implementation(impl);
+    if (selected != igtl_crc64_get_implementation() ||
+        (impl != IGTL_CRC64_IMPL_CLMUL && selected != impl))
+      {
+      fprintf(stdout, "Failed to select CRC-64 implementation %d.\n", impl);
+      return EXIT_FAILURE;
+      }
+    if (!test_crc64_variants(buffer, TEST_BUFFER_SIZE, 0))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  igtl_crc64_set_implementation(IGTL_CRC64_IMPL_AUTO);
+
+  /* Byte order conversion: every implementation, all element sizes, lengths
+   * around the SIMD block sizes and different source alignments */
+  for (impl = IGTL_BYTE_ORDER_IMPL_SCALAR; impl <= IGTL_BYTE_ORDER_IMPL_AVX2; impl ++)
+    {
+    int selected = igtl_convert_byte_order_set_implementation(impl);
+    int size;
+    if (selected != igtl_convert_byte_order_get_implementation() || selected > impl ||
+        (impl == IGTL_BYTE_ORDER_IMPL_SCALAR && selected != impl))
+      {
+      fprintf(stdout, "Failed to select byte order implementation %d.\n", impl);
+      return EXIT_FAILURE;
+      }
+    for (size = 2; size <= 8; size *= 2)
+      {
+      for (offset = 0; offset < 8; offset ++)
+        {
+        for (i = 0; i * size <= 300; i ++)
+          {
+          if (!test_byte_order(&buffer[offset], i, size))
+            {
+            return EXIT_FAILURE;
+            }
+          }
+        }
+      if (!test_byte_order(&buffer[3], (TEST_BUFFER_SIZE - 8) / size, size))
+        {
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  igtl_convert_byte_order_set_implementation(IGTL_BYTE_ORDER_IMPL_AUTO);
 
   return EXIT_SUCCESS;
 }